@@ -117,6 +117,23 @@ AC_DEFUN([WITH_MCACHE_PATH],
     AC_DEFINE_UNQUOTED(MCACHE_PATH, "$config_mcpath", [Where to store mmap cache files for the SSSD interconnects])
   ])
 
+AC_DEFUN([WITH_METRICS_PATH],
+  [ AC_ARG_WITH([metrics-path],
+                [AC_HELP_STRING([--with-metrics-path=PATH],
+                                [Where to store metrics snapshots of the SSSD processes [/var/lib/sss/metrics]]
+                               )
+                ]
+               )
+    config_metricspath="\"SSS_STATEDIR\"/metrics"
+    metricspath="${localstatedir}/lib/sss/metrics"
+    if test x"$with_metrics_path" != x; then
+        config_metricspath=$with_metrics_path
+        metricspath=$with_metrics_path
+    fi
+    AC_SUBST(metricspath)
+    AC_DEFINE_UNQUOTED(METRICS_PATH, "$config_metricspath", [Where to store metrics snapshots of the SSSD processes])
+  ])
+
 AC_DEFUN([WITH_INITSCRIPT],
   [ AC_ARG_WITH([initscript],
                 [AC_HELP_STRING([--with-initscript=INITSCRIPT_TYPE],
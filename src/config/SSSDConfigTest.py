@@ -377,7 +377,9 @@ class SSSDConfigTestSSSDService(unittest.TestCase):
             'debug_level',
             'debug_timestamps',
             'debug_microseconds',
+            'debug_backtrace_enabled',
             'debug_to_files',
+            'metrics_snapshot_interval',
             'command',
             'reconnection_retries',
             'fd_limit',
@@ -611,6 +613,9 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'dns_resolver_op_timeout',
             'dns_resolver_timeout',
             'dns_discovery_domain',
+            'failover_latency_aware',
+            'failover_probe_interval',
+            'failover_health_check_interval',
             'dyndns_update',
             'dyndns_ttl',
             'dyndns_iface',
@@ -729,7 +734,9 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
              'krb5_canonicalize',
              'krb5_use_enterprise_principal',
              'krb5_use_kdcinfo',
-             'krb5_map_user'])
+             'krb5_map_user',
+             'krb5_child_pool_size',
+             'krb5_child_pool_max'])
 
         options = domain.list_options()
 
@@ -891,7 +898,9 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'krb5_canonicalize',
             'krb5_use_enterprise_principal',
             'krb5_use_kdcinfo',
-            'krb5_map_user']
+            'krb5_map_user',
+            'krb5_child_pool_size',
+            'krb5_child_pool_max']
 
         self.assertTrue(type(options) == dict,
                         "Options should be a dictionary")
@@ -983,6 +992,9 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'dns_resolver_op_timeout',
             'dns_resolver_timeout',
             'dns_discovery_domain',
+            'failover_latency_aware',
+            'failover_probe_interval',
+            'failover_health_check_interval',
             'dyndns_update',
             'dyndns_ttl',
             'dyndns_iface',
@@ -1102,7 +1114,9 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
              'krb5_canonicalize',
              'krb5_use_enterprise_principal',
              'krb5_use_kdcinfo',
-             'krb5_map_user'])
+             'krb5_map_user',
+             'krb5_child_pool_size',
+             'krb5_child_pool_max'])
 
         options = domain.list_options()
 
@@ -1398,6 +1398,180 @@ done:
     return ret;
 }
 
+errno_t sysdb_get_enum_checkpoint(struct sss_domain_info *domain,
+                                  const char *attr_name,
+                                  uint32_t *_checkpoint)
+{
+    errno_t ret;
+    struct ldb_dn *dn;
+    uint32_t checkpoint = 0;
+
+    dn = sysdb_domain_dn(NULL, domain);
+    if (dn == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_get_uint(domain->sysdb, dn, attr_name, &checkpoint);
+    talloc_free(dn);
+    if (ret == ENOENT) {
+        checkpoint = 0;
+    } else if (ret != EOK) {
+        return ret;
+    }
+
+    *_checkpoint = checkpoint;
+    return EOK;
+}
+
+errno_t sysdb_set_enum_checkpoint(struct sss_domain_info *domain,
+                                  const char *attr_name,
+                                  uint32_t checkpoint)
+{
+    errno_t ret;
+    struct ldb_dn *dn;
+
+    dn = sysdb_domain_dn(NULL, domain);
+    if (dn == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_set_uint(domain->sysdb, dn, domain->name,
+                         attr_name, checkpoint);
+    talloc_free(dn);
+    return ret;
+}
+
+errno_t sysdb_get_dirsync_cookie(TALLOC_CTX *mem_ctx,
+                                 struct sss_domain_info *domain,
+                                 uint8_t **_cookie,
+                                 size_t *_cookie_len)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_dn *dn;
+    struct ldb_result *res;
+    const struct ldb_val *val;
+    const char *attrs[] = { SYSDB_DIRSYNC_COOKIE, NULL };
+    uint8_t *cookie;
+    errno_t ret;
+    int lret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    dn = sysdb_domain_dn(tmp_ctx, domain);
+    if (dn == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    lret = ldb_search(domain->sysdb->ldb, tmp_ctx, &res, dn, LDB_SCOPE_BASE,
+                      attrs, NULL);
+    if (lret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+
+    if (res->count == 0) {
+        ret = ENOENT;
+        goto done;
+    } else if (res->count != 1) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Got more than one reply for base search!\n");
+        ret = EIO;
+        goto done;
+    }
+
+    val = ldb_msg_find_ldb_val(res->msgs[0], SYSDB_DIRSYNC_COOKIE);
+    if (val == NULL || val->length == 0) {
+        ret = ENOENT;
+        goto done;
+    }
+
+    cookie = talloc_memdup(mem_ctx, val->data, val->length);
+    if (cookie == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    *_cookie = cookie;
+    *_cookie_len = val->length;
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+errno_t sysdb_set_dirsync_cookie(struct sss_domain_info *domain,
+                                 const uint8_t *cookie,
+                                 size_t cookie_len)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_message *msg;
+    struct ldb_val val;
+    errno_t ret;
+    int lret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    msg = ldb_msg_new(tmp_ctx);
+    if (msg == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    msg->dn = sysdb_domain_dn(msg, domain);
+    if (msg->dn == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (cookie == NULL || cookie_len == 0) {
+        lret = ldb_msg_add_empty(msg, SYSDB_DIRSYNC_COOKIE,
+                                 LDB_FLAG_MOD_DELETE, NULL);
+        if (lret != LDB_SUCCESS) {
+            ret = sysdb_error_to_errno(lret);
+            goto done;
+        }
+    } else {
+        lret = ldb_msg_add_empty(msg, SYSDB_DIRSYNC_COOKIE,
+                                 LDB_FLAG_MOD_REPLACE, NULL);
+        if (lret != LDB_SUCCESS) {
+            ret = sysdb_error_to_errno(lret);
+            goto done;
+        }
+
+        val.data = discard_const(cookie);
+        val.length = cookie_len;
+        lret = ldb_msg_add_value(msg, SYSDB_DIRSYNC_COOKIE, &val, NULL);
+        if (lret != LDB_SUCCESS) {
+            ret = sysdb_error_to_errno(lret);
+            goto done;
+        }
+    }
+
+    lret = ldb_modify(domain->sysdb->ldb, msg);
+    if (lret == LDB_ERR_NO_SUCH_ATTRIBUTE && cookie == NULL) {
+        /* Nothing to remove */
+        lret = LDB_SUCCESS;
+    }
+    if (lret != LDB_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "ldb_modify failed: [%s](%d)[%s]\n",
+              ldb_strerror(lret), lret, ldb_errstring(domain->sysdb->ldb));
+    }
+    ret = sysdb_error_to_errno(lret);
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
 errno_t sysdb_attrs_primary_name(struct sysdb_ctx *sysdb,
                                  struct sysdb_attrs *attrs,
                                  const char *ldap_attr,
@@ -228,6 +228,11 @@
 #define SYSDB_HAS_ENUMERATED "has_enumerated"
 #define SYSDB_HAS_ENUMERATED_ID       0x00000001
 
+#define SYSDB_DIRSYNC_COOKIE "dirsyncCookie"
+
+#define SYSDB_ENUM_USERS_CHECKPOINT "enumUsersCheckpoint"
+#define SYSDB_ENUM_GROUPS_CHECKPOINT "enumGroupsCheckpoint"
+
 #define SYSDB_DEFAULT_ATTRS SYSDB_LAST_UPDATE, \
                             SYSDB_CACHE_EXPIRE, \
                             SYSDB_INITGR_EXPIRE, \
@@ -1312,6 +1317,30 @@ errno_t sysdb_set_enumerated(struct sss_domain_info *domain,
                              uint32_t provider,
                              bool has_enumerated);
 
+/* Position of an interrupted enumeration, attr_name is one of the
+ * SYSDB_ENUM_*_CHECKPOINT attributes. 0 means the next enumeration starts
+ * from the beginning. */
+errno_t sysdb_get_enum_checkpoint(struct sss_domain_info *domain,
+                                  const char *attr_name,
+                                  uint32_t *_checkpoint);
+
+errno_t sysdb_set_enum_checkpoint(struct sss_domain_info *domain,
+                                  const char *attr_name,
+                                  uint32_t checkpoint);
+
+/* The DirSync cookie is an opaque blob issued by Active Directory that
+ * marks the point in the change history the cache was last synchronized
+ * to. Returns ENOENT if no cookie was stored yet. */
+errno_t sysdb_get_dirsync_cookie(TALLOC_CTX *mem_ctx,
+                                 struct sss_domain_info *domain,
+                                 uint8_t **_cookie,
+                                 size_t *_cookie_len);
+
+/* Passing a NULL cookie removes the stored one */
+errno_t sysdb_set_dirsync_cookie(struct sss_domain_info *domain,
+                                 const uint8_t *cookie,
+                                 size_t cookie_len);
+
 errno_t sysdb_remove_attrs(struct sss_domain_info *domain,
                            const char *name,
                            enum sysdb_member_type type,
@@ -22,6 +22,7 @@
 
 #include <talloc.h>
 #include <time.h>
+#include <sys/time.h>
 
 #include "db/sysdb.h"
 #include "db/sysdb_private.h"
@@ -520,9 +521,9 @@ done:
     return ret;
 }
 
-static errno_t sysdb_sudo_set_refresh_time(struct sss_domain_info *domain,
-                                           const char *attr_name,
-                                           time_t value)
+static errno_t sysdb_sudo_set_container_attr(struct sss_domain_info *domain,
+                                            const char *attr_name,
+                                            long long value)
 {
     TALLOC_CTX *tmp_ctx;
     struct ldb_dn *dn;
@@ -578,7 +579,7 @@ static errno_t sysdb_sudo_set_refresh_time(struct sss_domain_info *domain,
         }
     }
 
-    lret = ldb_msg_add_fmt(msg, attr_name, "%lld", (long long)value);
+    lret = ldb_msg_add_fmt(msg, attr_name, "%lld", value);
     if (lret != LDB_SUCCESS) {
         ret = sysdb_error_to_errno(lret);
         goto done;
@@ -602,9 +603,9 @@ done:
     return ret;
 }
 
-static errno_t sysdb_sudo_get_refresh_time(struct sss_domain_info *domain,
-                                           const char *attr_name,
-                                           time_t *value)
+static errno_t sysdb_sudo_get_container_attr(struct sss_domain_info *domain,
+                                            const char *attr_name,
+                                            long long *value)
 {
     TALLOC_CTX *tmp_ctx;
     struct ldb_dn *dn;
@@ -648,7 +649,7 @@ static errno_t sysdb_sudo_get_refresh_time(struct sss_domain_info *domain,
         goto done;
     }
 
-    *value = ldb_msg_find_attr_as_int(res->msgs[0], attr_name, 0);
+    *value = ldb_msg_find_attr_as_int64(res->msgs[0], attr_name, 0);
 
     ret = EOK;
 
@@ -660,15 +661,72 @@ done:
 errno_t sysdb_sudo_set_last_full_refresh(struct sss_domain_info *domain,
                                          time_t value)
 {
-    return sysdb_sudo_set_refresh_time(domain,
-                                       SYSDB_SUDO_AT_LAST_FULL_REFRESH, value);
+    return sysdb_sudo_set_container_attr(domain,
+                                         SYSDB_SUDO_AT_LAST_FULL_REFRESH,
+                                         value);
 }
 
 errno_t sysdb_sudo_get_last_full_refresh(struct sss_domain_info *domain,
                                          time_t *value)
 {
-    return sysdb_sudo_get_refresh_time(domain,
-                                       SYSDB_SUDO_AT_LAST_FULL_REFRESH, value);
+    long long stored;
+    errno_t ret;
+
+    ret = sysdb_sudo_get_container_attr(domain,
+                                        SYSDB_SUDO_AT_LAST_FULL_REFRESH,
+                                        &stored);
+    if (ret == EOK) {
+        *value = stored;
+    }
+
+    return ret;
+}
+
+errno_t sysdb_sudo_get_generation(struct sss_domain_info *domain,
+                                  uint64_t *_generation)
+{
+    long long stored;
+    errno_t ret;
+
+    ret = sysdb_sudo_get_container_attr(domain, SYSDB_SUDO_AT_GENERATION,
+                                        &stored);
+    if (ret == EOK) {
+        *_generation = stored;
+    }
+
+    return ret;
+}
+
+/* Called whenever the cached rules change. The sudo responder compares the
+ * generation to decide whether its in-memory copy of the rules is still
+ * current. A purge of all rules removes the container together with the
+ * generation, so the new value is based on the current time rather than
+ * on a counter that would start again from zero. */
+static errno_t sysdb_sudo_bump_generation(struct sss_domain_info *domain)
+{
+    struct timeval tv;
+    long long generation;
+    long long now;
+    errno_t ret;
+
+    ret = sysdb_sudo_get_container_attr(domain, SYSDB_SUDO_AT_GENERATION,
+                                        &generation);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    gettimeofday(&tv, NULL);
+    now = (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+    generation = MAX(generation + 1, now);
+
+    ret = sysdb_sudo_set_container_attr(domain, SYSDB_SUDO_AT_GENERATION,
+                                        generation);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to update sudo rules generation "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+    }
+
+    return ret;
 }
 
 /* ====================  Purge functions ==================== */
@@ -835,6 +893,11 @@ errno_t sysdb_sudo_purge(struct sss_domain_info *domain,
         goto done;
     }
 
+    ret = sysdb_sudo_bump_generation(domain);
+    if (ret != EOK) {
+        goto done;
+    }
+
     ret = sysdb_transaction_commit(domain->sysdb);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
@@ -1028,6 +1091,11 @@ sysdb_sudo_store(struct sss_domain_info *domain,
         }
     }
 
+    ret = sysdb_sudo_bump_generation(domain);
+    if (ret != EOK) {
+        goto done;
+    }
+
     ret = sysdb_transaction_commit(domain->sysdb);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
@@ -1142,6 +1210,11 @@ sysdb_set_sudo_rule_attr(struct sss_domain_info *domain,
     NULL_CHECK(dn, ret, done);
 
     ret = sysdb_set_entry_attr(domain->sysdb, dn, attrs, mod_op);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_sudo_bump_generation(domain);
 
 done:
     talloc_free(tmp_ctx);
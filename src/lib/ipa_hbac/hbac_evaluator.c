@@ -142,76 +142,620 @@ enum hbac_eval_result_int hbac_evaluate_rule(struct hbac_rule *rule,
                                              struct hbac_eval_req *hbac_req,
                                              enum hbac_error_code *error);
 
+static bool hbac_info_new(struct hbac_info **info)
+{
+    if (info) {
+        *info = malloc(sizeof(struct hbac_info));
+        if (!*info) {
+            HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
+            return false;
+        }
+        (*info)->code = HBAC_ERROR_UNKNOWN;
+        (*info)->rule_name = NULL;
+    }
+
+    return true;
+}
+
+/* Evaluates a single rule on behalf of hbac_evaluate() and
+ * hbac_evaluate_compiled(). Returns true if no further rules have to be
+ * checked, the outcome is then stored in result and info.
+ */
+static bool hbac_evaluate_one(struct hbac_rule *rule,
+                              struct hbac_eval_req *hbac_req,
+                              struct hbac_info **info,
+                              enum hbac_eval_result *result)
+{
+    enum hbac_error_code ret;
+    enum hbac_eval_result_int intermediate_result;
+
+    hbac_rule_debug_print(rule);
+    intermediate_result = hbac_evaluate_rule(rule, hbac_req, &ret);
+    if (intermediate_result == HBAC_EVAL_UNMATCHED) {
+        /* This rule did not match at all. Skip it */
+        HBAC_DEBUG(HBAC_DBG_INFO, "The rule [%s] did not match.\n",
+                   rule->name);
+        return false;
+    } else if (intermediate_result == HBAC_EVAL_MATCHED) {
+        HBAC_DEBUG(HBAC_DBG_INFO, "ALLOWED by rule [%s].\n", rule->name);
+        *result = HBAC_EVAL_ALLOW;
+        if (info) {
+            (*info)->code = HBAC_SUCCESS;
+            (*info)->rule_name = strdup(rule->name);
+            if (!(*info)->rule_name) {
+                HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
+                *result = HBAC_EVAL_ERROR;
+                (*info)->code = HBAC_ERROR_OUT_OF_MEMORY;
+            }
+        }
+        return true;
+    }
+
+    /* An error occurred processing this rule */
+    HBAC_DEBUG(HBAC_DBG_ERROR,
+               "Error %d occurred during evaluating of rule [%s].\n",
+               ret, rule->name);
+    *result = HBAC_EVAL_ERROR;
+    if (info) {
+        (*info)->code = ret;
+        (*info)->rule_name = strdup(rule->name);
+    }
+    /* Explicitly not checking the result of strdup(), since if
+     * it's NULL, we can't do anything anyway.
+     */
+    return true;
+}
+
 enum hbac_eval_result hbac_evaluate(struct hbac_rule **rules,
                                     struct hbac_eval_req *hbac_req,
                                     struct hbac_info **info)
 {
     uint32_t i;
 
-    enum hbac_error_code ret;
     enum hbac_eval_result result = HBAC_EVAL_DENY;
-    enum hbac_eval_result_int intermediate_result;
 
     HBAC_DEBUG(HBAC_DBG_INFO, "[< hbac_evaluate()\n");
     hbac_req_debug_print(hbac_req);
 
-    if (info) {
-        *info = malloc(sizeof(struct hbac_info));
-        if (!*info) {
-            HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
-            return HBAC_EVAL_OOM;
-        }
-        (*info)->code = HBAC_ERROR_UNKNOWN;
-        (*info)->rule_name = NULL;
+    if (!hbac_info_new(info)) {
+        return HBAC_EVAL_OOM;
     }
 
     for (i = 0; rules[i]; i++) {
-        hbac_rule_debug_print(rules[i]);
-        intermediate_result = hbac_evaluate_rule(rules[i], hbac_req, &ret);
-        if (intermediate_result == HBAC_EVAL_UNMATCHED) {
-            /* This rule did not match at all. Skip it */
-            HBAC_DEBUG(HBAC_DBG_INFO, "The rule [%s] did not match.\n",
-                       rules[i]->name);
-            continue;
-        } else if (intermediate_result == HBAC_EVAL_MATCHED) {
-            HBAC_DEBUG(HBAC_DBG_INFO, "ALLOWED by rule [%s].\n", rules[i]->name);
-            result = HBAC_EVAL_ALLOW;
-            if (info) {
-                (*info)->code = HBAC_SUCCESS;
-                (*info)->rule_name = strdup(rules[i]->name);
-                if (!(*info)->rule_name) {
-                    HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
-                    result = HBAC_EVAL_ERROR;
-                    (*info)->code = HBAC_ERROR_OUT_OF_MEMORY;
-                }
-            }
+        if (hbac_evaluate_one(rules[i], hbac_req, info, &result)) {
             break;
-        } else {
-            /* An error occurred processing this rule */
-            HBAC_DEBUG(HBAC_DBG_ERROR,
-                       "Error %d occurred during evaluating of rule [%s].\n",
-                       ret, rules[i]->name);
-            result = HBAC_EVAL_ERROR;
-            if (info) {
-                (*info)->code = ret;
-                (*info)->rule_name = strdup(rules[i]->name);
-            }
-            /* Explicitly not checking the result of strdup(), since if
-             * it's NULL, we can't do anything anyway.
-             */
-            goto done;
         }
     }
 
     /* If we've reached the end of the loop, we have either set the
      * result to ALLOW explicitly or we'll stick with the default DENY.
      */
-done:
 
     HBAC_DEBUG(HBAC_DBG_INFO, "hbac_evaluate() >]\n");
     return result;
 }
 
+/* Compiled rules
+ *
+ * For each of the users, services and target hosts elements the rules are
+ * indexed by the names and groups they contain, so that a request only
+ * needs to look at the rules that mention one of its names or groups. The
+ * candidate rules are then evaluated with hbac_evaluate_rule() in their
+ * original order, which keeps the results identical to hbac_evaluate().
+ *
+ * Names are compared with full Unicode case folding, so only ASCII names
+ * are used as index keys. Rules with other names in an element are always
+ * candidates for that element and requests with other names fall back to
+ * hbac_evaluate().
+ */
+
+#define HBAC_INDEX_USERS        0
+#define HBAC_INDEX_SERVICES     1
+#define HBAC_INDEX_TARGETHOSTS  2
+#define HBAC_INDEX_COUNT        3
+
+#define HBAC_INDEX_ALL_BITS     ((1 << HBAC_INDEX_COUNT) - 1)
+
+struct hbac_index_entry {
+    /* lower-cased ASCII name */
+    char *key;
+    /* position of the rule in the rule list */
+    size_t rule;
+};
+
+struct hbac_key_index {
+    struct hbac_index_entry *entries;
+    size_t count;
+};
+
+struct hbac_element_index {
+    struct hbac_key_index names;
+    struct hbac_key_index groups;
+
+    /* Rules which are candidates for any request, either because of
+     * category all or because one of their names cannot be indexed */
+    size_t *any;
+    size_t any_count;
+};
+
+struct hbac_compiled_rules {
+    struct hbac_rule **rules;
+    size_t num_rules;
+
+    struct hbac_element_index elements[HBAC_INDEX_COUNT];
+
+    /* Enabled rules with missing elements, evaluating them is an error */
+    size_t *broken;
+    size_t broken_count;
+};
+
+static struct hbac_rule_element *hbac_index_element(struct hbac_rule *rule,
+                                                    int idx)
+{
+    switch (idx) {
+    case HBAC_INDEX_USERS:
+        return rule->users;
+    case HBAC_INDEX_SERVICES:
+        return rule->services;
+    case HBAC_INDEX_TARGETHOSTS:
+        return rule->targethosts;
+    }
+
+    return NULL;
+}
+
+static struct hbac_request_element *
+hbac_index_request_element(struct hbac_eval_req *hbac_req, int idx)
+{
+    switch (idx) {
+    case HBAC_INDEX_USERS:
+        return hbac_req->user;
+    case HBAC_INDEX_SERVICES:
+        return hbac_req->service;
+    case HBAC_INDEX_TARGETHOSTS:
+        return hbac_req->targethost;
+    }
+
+    return NULL;
+}
+
+static bool hbac_is_ascii(const char *str)
+{
+    const unsigned char *c;
+
+    for (c = (const unsigned char *) str; *c != '\0'; c++) {
+        if (*c >= 0x80) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool hbac_list_is_ascii(const char **list)
+{
+    size_t i;
+
+    if (list == NULL) {
+        return true;
+    }
+
+    for (i = 0; list[i] != NULL; i++) {
+        if (!hbac_is_ascii(list[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static char hbac_ascii_lower(char c)
+{
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A' + 'a';
+    }
+
+    return c;
+}
+
+/* Compares an ASCII string in any case with a lower-cased index key */
+static int hbac_key_cmp(const char *str, const char *key)
+{
+    unsigned char a;
+    unsigned char b;
+
+    do {
+        a = (unsigned char) hbac_ascii_lower(*str++);
+        b = (unsigned char) *key++;
+    } while (a == b && a != '\0');
+
+    return a - b;
+}
+
+static int hbac_index_entry_cmp(const void *a, const void *b)
+{
+    const struct hbac_index_entry *x = a;
+    const struct hbac_index_entry *y = b;
+    int ret;
+
+    ret = strcmp(x->key, y->key);
+    if (ret != 0) {
+        return ret;
+    }
+
+    return x->rule < y->rule ? -1 : (x->rule > y->rule ? 1 : 0);
+}
+
+static int hbac_rule_pos_cmp(const void *a, const void *b)
+{
+    size_t x = *(const size_t *) a;
+    size_t y = *(const size_t *) b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static size_t hbac_list_count(const char **list)
+{
+    size_t i;
+
+    if (list == NULL) {
+        return 0;
+    }
+
+    for (i = 0; list[i] != NULL; i++);
+
+    return i;
+}
+
+static errno_t hbac_key_index_add(struct hbac_key_index *index,
+                                  const char **list,
+                                  size_t rule)
+{
+    size_t i;
+    size_t j;
+    char *key;
+
+    if (list == NULL) {
+        return EOK;
+    }
+
+    for (i = 0; list[i] != NULL; i++) {
+        key = strdup(list[i]);
+        if (key == NULL) {
+            return ENOMEM;
+        }
+
+        for (j = 0; key[j] != '\0'; j++) {
+            key[j] = hbac_ascii_lower(key[j]);
+        }
+
+        index->entries[index->count].key = key;
+        index->entries[index->count].rule = rule;
+        index->count++;
+    }
+
+    return EOK;
+}
+
+static void hbac_key_index_free(struct hbac_key_index *index)
+{
+    size_t i;
+
+    if (index->entries == NULL) {
+        return;
+    }
+
+    for (i = 0; i < index->count; i++) {
+        free(index->entries[i].key);
+    }
+    free(index->entries);
+}
+
+static errno_t hbac_element_index_build(struct hbac_compiled_rules *compiled,
+                                        int idx)
+{
+    struct hbac_element_index *elidx = &compiled->elements[idx];
+    struct hbac_rule_element *el;
+    struct hbac_rule *rule;
+    size_t num_names = 0;
+    size_t num_groups = 0;
+    size_t i;
+    errno_t ret;
+
+    /* Only complete, enabled rules end up here */
+    for (i = 0; i < compiled->num_rules; i++) {
+        rule = compiled->rules[i];
+        if (!rule->enabled || rule->users == NULL || rule->services == NULL
+                || rule->targethosts == NULL || rule->srchosts == NULL) {
+            continue;
+        }
+
+        el = hbac_index_element(rule, idx);
+        if ((el->category & HBAC_CATEGORY_ALL)
+                || !hbac_list_is_ascii(el->names)
+                || !hbac_list_is_ascii(el->groups)) {
+            elidx->any[elidx->any_count++] = i;
+            continue;
+        }
+
+        num_names += hbac_list_count(el->names);
+        num_groups += hbac_list_count(el->groups);
+    }
+
+    elidx->names.entries = malloc(sizeof(struct hbac_index_entry)
+                                  * (num_names + 1));
+    elidx->groups.entries = malloc(sizeof(struct hbac_index_entry)
+                                   * (num_groups + 1));
+    if (elidx->names.entries == NULL || elidx->groups.entries == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < compiled->num_rules; i++) {
+        rule = compiled->rules[i];
+        if (!rule->enabled || rule->users == NULL || rule->services == NULL
+                || rule->targethosts == NULL || rule->srchosts == NULL) {
+            continue;
+        }
+
+        el = hbac_index_element(rule, idx);
+        if ((el->category & HBAC_CATEGORY_ALL)
+                || !hbac_list_is_ascii(el->names)
+                || !hbac_list_is_ascii(el->groups)) {
+            continue;
+        }
+
+        ret = hbac_key_index_add(&elidx->names, el->names, i);
+        if (ret != EOK) {
+            return ret;
+        }
+
+        ret = hbac_key_index_add(&elidx->groups, el->groups, i);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    qsort(elidx->names.entries, elidx->names.count,
+          sizeof(struct hbac_index_entry), hbac_index_entry_cmp);
+    qsort(elidx->groups.entries, elidx->groups.count,
+          sizeof(struct hbac_index_entry), hbac_index_entry_cmp);
+
+    return EOK;
+}
+
+void hbac_free_compiled_rules(struct hbac_compiled_rules *compiled)
+{
+    int idx;
+
+    if (compiled == NULL) return;
+
+    for (idx = 0; idx < HBAC_INDEX_COUNT; idx++) {
+        hbac_key_index_free(&compiled->elements[idx].names);
+        hbac_key_index_free(&compiled->elements[idx].groups);
+        free(compiled->elements[idx].any);
+    }
+    free(compiled->broken);
+    free(compiled);
+}
+
+enum hbac_error_code hbac_compile_rules(struct hbac_rule **rules,
+                                        struct hbac_compiled_rules **_compiled)
+{
+    struct hbac_compiled_rules *compiled;
+    struct hbac_rule *rule;
+    size_t i;
+    int idx;
+    errno_t ret;
+
+    if (rules == NULL || _compiled == NULL) {
+        return HBAC_ERROR_UNKNOWN;
+    }
+
+    compiled = calloc(1, sizeof(struct hbac_compiled_rules));
+    if (compiled == NULL) {
+        return HBAC_ERROR_OUT_OF_MEMORY;
+    }
+
+    compiled->rules = rules;
+    for (i = 0; rules[i] != NULL; i++);
+    compiled->num_rules = i;
+
+    compiled->broken = malloc(sizeof(size_t) * (compiled->num_rules + 1));
+    if (compiled->broken == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < compiled->num_rules; i++) {
+        rule = rules[i];
+        if (rule->enabled && (rule->users == NULL || rule->services == NULL
+                              || rule->targethosts == NULL
+                              || rule->srchosts == NULL)) {
+            compiled->broken[compiled->broken_count++] = i;
+        }
+    }
+
+    for (idx = 0; idx < HBAC_INDEX_COUNT; idx++) {
+        compiled->elements[idx].any = malloc(sizeof(size_t)
+                                             * (compiled->num_rules + 1));
+        if (compiled->elements[idx].any == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = hbac_element_index_build(compiled, idx);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    HBAC_DEBUG(HBAC_DBG_INFO, "Compiled %lu HBAC rules.\n",
+               (unsigned long) compiled->num_rules);
+
+    *_compiled = compiled;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
+        hbac_free_compiled_rules(compiled);
+        return HBAC_ERROR_OUT_OF_MEMORY;
+    }
+
+    return HBAC_SUCCESS;
+}
+
+static bool hbac_request_is_indexable(struct hbac_eval_req *hbac_req)
+{
+    struct hbac_request_element *req_el;
+    int idx;
+
+    for (idx = 0; idx < HBAC_INDEX_COUNT; idx++) {
+        req_el = hbac_index_request_element(hbac_req, idx);
+        if (req_el == NULL) {
+            return false;
+        }
+
+        if ((req_el->name != NULL && !hbac_is_ascii(req_el->name))
+                || !hbac_list_is_ascii(req_el->groups)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void hbac_candidate_mark(unsigned char *marks,
+                                size_t *candidates,
+                                size_t *num_candidates,
+                                size_t rule,
+                                int idx)
+{
+    unsigned char bit = 1 << idx;
+
+    if (marks[rule] & bit) {
+        return;
+    }
+
+    marks[rule] |= bit;
+    if (marks[rule] == HBAC_INDEX_ALL_BITS) {
+        candidates[(*num_candidates)++] = rule;
+    }
+}
+
+static void hbac_key_index_lookup(struct hbac_key_index *index,
+                                  const char *name,
+                                  unsigned char *marks,
+                                  size_t *candidates,
+                                  size_t *num_candidates,
+                                  int idx)
+{
+    size_t lo = 0;
+    size_t hi = index->count;
+    size_t mid;
+
+    /* first entry not smaller than name */
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (hbac_key_cmp(name, index->entries[mid].key) > 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (; lo < index->count
+           && hbac_key_cmp(name, index->entries[lo].key) == 0; lo++) {
+        hbac_candidate_mark(marks, candidates, num_candidates,
+                            index->entries[lo].rule, idx);
+    }
+}
+
+enum hbac_eval_result
+hbac_evaluate_compiled(struct hbac_compiled_rules *compiled,
+                       struct hbac_eval_req *hbac_req,
+                       struct hbac_info **info)
+{
+    struct hbac_element_index *elidx;
+    struct hbac_request_element *req_el;
+    enum hbac_eval_result result = HBAC_EVAL_DENY;
+    unsigned char *marks = NULL;
+    size_t *candidates = NULL;
+    size_t num_candidates = 0;
+    size_t i;
+    int idx;
+
+    if (!hbac_request_is_indexable(hbac_req)) {
+        HBAC_DEBUG(HBAC_DBG_INFO, "Request cannot use the rule index, "
+                   "evaluating all rules.\n");
+        return hbac_evaluate(compiled->rules, hbac_req, info);
+    }
+
+    HBAC_DEBUG(HBAC_DBG_INFO, "[< hbac_evaluate_compiled()\n");
+    hbac_req_debug_print(hbac_req);
+
+    if (!hbac_info_new(info)) {
+        return HBAC_EVAL_OOM;
+    }
+
+    marks = calloc(compiled->num_rules + 1, sizeof(unsigned char));
+    candidates = malloc(sizeof(size_t) * (compiled->num_rules + 1));
+    if (marks == NULL || candidates == NULL) {
+        HBAC_DEBUG(HBAC_DBG_ERROR, "Out of memory.\n");
+        result = HBAC_EVAL_ERROR;
+        if (info) {
+            (*info)->code = HBAC_ERROR_OUT_OF_MEMORY;
+        }
+        goto done;
+    }
+
+    for (i = 0; i < compiled->broken_count; i++) {
+        candidates[num_candidates++] = compiled->broken[i];
+    }
+
+    for (idx = 0; idx < HBAC_INDEX_COUNT; idx++) {
+        elidx = &compiled->elements[idx];
+        req_el = hbac_index_request_element(hbac_req, idx);
+
+        for (i = 0; i < elidx->any_count; i++) {
+            hbac_candidate_mark(marks, candidates, &num_candidates,
+                                elidx->any[i], idx);
+        }
+
+        if (req_el->name != NULL) {
+            hbac_key_index_lookup(&elidx->names, req_el->name,
+                                  marks, candidates, &num_candidates, idx);
+        }
+
+        for (i = 0; req_el->groups != NULL && req_el->groups[i] != NULL;
+             i++) {
+            hbac_key_index_lookup(&elidx->groups, req_el->groups[i],
+                                  marks, candidates, &num_candidates, idx);
+        }
+    }
+
+    HBAC_DEBUG(HBAC_DBG_INFO, "%lu of %lu rules are candidates.\n",
+               (unsigned long) num_candidates,
+               (unsigned long) compiled->num_rules);
+
+    /* The first rule in the original order decides */
+    qsort(candidates, num_candidates, sizeof(size_t), hbac_rule_pos_cmp);
+
+    for (i = 0; i < num_candidates; i++) {
+        if (hbac_evaluate_one(compiled->rules[candidates[i]], hbac_req,
+                              info, &result)) {
+            break;
+        }
+    }
+
+done:
+    free(marks);
+    free(candidates);
+
+    HBAC_DEBUG(HBAC_DBG_INFO, "hbac_evaluate_compiled() >]\n");
+    return result;
+}
+
 static errno_t hbac_evaluate_element(struct hbac_rule_element *rule_el,
                                      struct hbac_request_element *req_el,
                                      bool *matched);
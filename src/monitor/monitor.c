@@ -1321,7 +1321,7 @@ static void monitor_hup(struct tevent_context *ev,
     struct mt_ctx *ctx = talloc_get_type(private_data, struct mt_ctx);
     struct mt_svc *cur_svc;
 
-    DEBUG(SSSDBG_CRIT_FAILURE, "Received SIGHUP.\n");
+    DEBUG(SSSDBG_IMPORTANT_INFO, "Received SIGHUP.\n");
 
     /* Send D-Bus message to other services to rotate their logs.
      * NSS service receives also message to clear memory caches. */
@@ -1340,6 +1340,33 @@ static void monitor_hup(struct tevent_context *ev,
 
 }
 
+static void monitor_backtrace(struct tevent_context *ev,
+                              struct tevent_signal *se,
+                              int signum,
+                              int count,
+                              void *siginfo,
+                              void *private_data)
+{
+    struct mt_ctx *ctx = talloc_get_type(private_data, struct mt_ctx);
+    struct mt_svc *cur_svc;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Asking services to write the debug backtrace\n");
+
+    /* Only services that have registered are sure to handle the signal,
+     * it would terminate the others. The monitor itself handles it in
+     * server_setup(). */
+    for (cur_svc = ctx->svc_list; cur_svc; cur_svc = cur_svc->next) {
+        if (cur_svc->pid == 0 || cur_svc->conn == NULL) {
+            continue;
+        }
+
+        if (kill(cur_svc->pid, signum) != 0) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Could not signal service [%s]: %s\n",
+                  cur_svc->name, strerror(errno));
+        }
+    }
+}
+
 static int monitor_cleanup(void)
 {
     int ret;
@@ -1962,6 +1989,13 @@ static int monitor_process_init(struct mt_ctx *ctx,
         return EIO;
     }
 
+    /* Pass requests for the debug backtrace on to the services */
+    tes = tevent_add_signal(ctx->ev, ctx, SSSDBG_BACKTRACE_SIGNAL, 0,
+                            monitor_backtrace, ctx);
+    if (tes == NULL) {
+        return EIO;
+    }
+
     /* Set up the SIGCHLD handler */
     ret = sss_sigchld_init(ctx, ctx->ev, &ctx->sigchld_ctx);
     if (ret != EOK) return ret;
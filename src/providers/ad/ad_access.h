@@ -25,6 +25,9 @@
 
 #include "providers/data_provider.h"
 
+struct ad_gpo_decision_cache;
+struct sss_child_pool;
+
 struct ad_access_ctx {
     struct dp_option *ad_options;
     struct sdap_access_ctx *sdap_access_ctx;
@@ -49,6 +52,11 @@ struct ad_access_ctx {
     } gpo_map_type;
     hash_table_t *gpo_map_options_table;
     enum gpo_map_type gpo_default_right;
+    /* NULL unless ad_gpo_decision_cache_timeout is set */
+    struct ad_gpo_decision_cache *gpo_decision_cache;
+    /* gpo_child processes, persistent unless ad_gpo_child_idle_timeout
+     * is 0 */
+    struct sss_child_pool *gpo_child_pool;
 };
 
 struct tevent_req *
@@ -782,6 +782,26 @@ ad_failover_init(TALLOC_CTX *mem_ctx, struct be_ctx *bectx,
         goto done;
     }
 
+    ret = be_fo_set_default_port(bectx, ad_service, LDAP_PORT);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = be_fo_set_default_port(bectx, ad_gc_service, AD_GC_PORT);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = be_fo_set_reports_rtt(bectx, ad_service);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = be_fo_set_reports_rtt(bectx, ad_gc_service);
+    if (ret != EOK) {
+        goto done;
+    }
+
     service->sdap->kinit_service_name = service->krb5_service->name;
     service->gc->kinit_service_name = service->krb5_service->name;
 
@@ -67,6 +67,10 @@ enum ad_basic_opt {
     AD_KRB5_CONFD_PATH,
     AD_MAXIMUM_MACHINE_ACCOUNT_PASSWORD_AGE,
     AD_MACHINE_ACCOUNT_PASSWORD_RENEWAL_OPTS,
+    AD_ENUM_USE_DIRSYNC,
+    AD_GPO_DECISION_CACHE_TIMEOUT,
+    AD_GPO_CHILD_IDLE_TIMEOUT,
+    AD_PAC_AUTHORITATIVE,
 
     AD_OPTS_BASIC /* opts counter */
 };
@@ -92,6 +96,8 @@ struct ad_options {
     /* ID Provider */
     struct sdap_options *id;
     struct ad_id_ctx *id_ctx;
+    /* Running background resolutions of PAC group SIDs, one per user */
+    struct ad_pac_resolve_sids_ctx *pac_resolve_sids;
 
     /* Auth and chpass Provider */
     struct krb5_ctx *auth_ctx;
@@ -0,0 +1,1191 @@
+/*
+    SSSD
+
+    AD DirSync based incremental enumeration
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/util.h"
+#include "db/sysdb.h"
+#include "providers/ad/ad_common.h"
+#include "providers/ad/ad_dirsync.h"
+#include "providers/ldap/sdap_async.h"
+#include "providers/ldap/sdap_async_enum.h"
+#include "util/sss_ldap.h"
+
+/* How many objects are re-read from the server with a single search */
+#define AD_DIRSYNC_REFETCH_BATCH 50
+
+#define AD_DIRSYNC_ATTR_IS_DELETED "isDeleted"
+#define AD_DIRSYNC_ATTR_INSTANCE_TYPE "instanceType"
+#define AD_DIRSYNC_ATTR_PARENT_GUID "parentGUID"
+
+struct ad_dirsync_enum_state {
+    struct tevent_context *ev;
+    struct ad_id_ctx *id_ctx;
+    struct sdap_options *opts;
+    struct sdap_domain *sdom;
+    struct sdap_id_conn_ctx *user_conn;
+    struct sdap_id_op *op;
+    int timeout;
+
+    /* DirSync searches must be rooted at the naming context, the
+     * configured search bases are applied to the changes afterwards */
+    char *naming_context;
+    char *filter;
+    const char **attrs;
+    int flags;
+
+    /* No cookie was stored yet, the cache is populated by a full
+     * enumeration and DirSync is only used to obtain the cookie */
+    bool full;
+
+    uint8_t *cookie;
+    size_t cookie_len;
+
+    size_t num_changes;
+    struct sdap_dirsync_entry **changes;
+
+    /* Escaped objectGUID filter values of objects to re-read */
+    char **user_guids;
+    size_t num_user_guids;
+    char **group_guids;
+    size_t num_group_guids;
+    size_t refetch_idx;
+};
+
+static void ad_dirsync_enum_connected(struct tevent_req *subreq);
+static void ad_dirsync_enum_rootdse_done(struct tevent_req *subreq);
+static errno_t ad_dirsync_enum_start(struct tevent_req *req);
+static errno_t ad_dirsync_enum_step(struct tevent_req *req);
+static void ad_dirsync_enum_step_done(struct tevent_req *subreq);
+static void ad_dirsync_enum_full_done(struct tevent_req *subreq);
+static errno_t ad_dirsync_enum_refetch_next(struct tevent_req *req);
+static void ad_dirsync_enum_refetch_users_done(struct tevent_req *subreq);
+static void ad_dirsync_enum_refetch_groups_done(struct tevent_req *subreq);
+static errno_t ad_dirsync_enum_finish(struct tevent_req *req);
+
+struct tevent_req *
+ad_dirsync_enum_send(TALLOC_CTX *mem_ctx,
+                     struct tevent_context *ev,
+                     struct ad_id_ctx *id_ctx,
+                     struct sdap_domain *sdom,
+                     struct sdap_id_conn_ctx *user_conn)
+{
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+    struct ad_dirsync_enum_state *state;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct ad_dirsync_enum_state);
+    if (req == NULL) return NULL;
+
+    state->ev = ev;
+    state->id_ctx = id_ctx;
+    state->opts = id_ctx->sdap_id_ctx->opts;
+    state->sdom = sdom;
+    state->user_conn = user_conn;
+    state->timeout = dp_opt_get_int(state->opts->basic,
+                                    SDAP_ENUM_SEARCH_TIMEOUT);
+
+    /* DirSync requires the search to be rooted at the naming context, so
+     * it is always performed against the LDAP port, never the GC */
+    state->op = sdap_id_op_create(state, id_ctx->ldap_ctx->conn_cache);
+    if (state->op == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "sdap_id_op_create failed.\n");
+        ret = ENOMEM;
+        goto fail;
+    }
+
+    subreq = sdap_id_op_connect_send(state->op, state, &ret);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "sdap_id_op_connect_send failed: %d(%s).\n",
+                                  ret, strerror(ret));
+        goto fail;
+    }
+    tevent_req_set_callback(subreq, ad_dirsync_enum_connected, req);
+
+    return req;
+
+fail:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+    return req;
+}
+
+static errno_t ad_dirsync_build_attrs(TALLOC_CTX *mem_ctx,
+                                      struct sdap_options *opts,
+                                      const char ***_attrs)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char **user_attrs;
+    const char **group_attrs;
+    const char **attrs;
+    size_t num_user_attrs;
+    size_t num_group_attrs;
+    size_t num;
+    size_t i;
+    size_t j;
+    errno_t ret;
+    /* Attributes that change with every modification of the object would
+     * make DirSync report any change, memberOf is a backlink and is never
+     * returned by DirSync */
+    const char *skip[] = { opts->user_map[SDAP_AT_USER_USN].name,
+                           opts->user_map[SDAP_AT_USER_MODSTAMP].name,
+                           opts->user_map[SDAP_AT_USER_MEMBEROF].name,
+                           opts->group_map[SDAP_AT_GROUP_USN].name,
+                           opts->group_map[SDAP_AT_GROUP_MODSTAMP].name,
+                           NULL };
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = build_attrs_from_map(tmp_ctx, opts->user_map, opts->user_map_cnt,
+                               skip, &user_attrs, &num_user_attrs);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = build_attrs_from_map(tmp_ctx, opts->group_map, SDAP_OPTS_GROUP,
+                               skip, &group_attrs, &num_group_attrs);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    attrs = talloc_zero_array(tmp_ctx, const char *,
+                              num_user_attrs + num_group_attrs + 2);
+    if (attrs == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    num = 0;
+    for (i = 0; i < num_user_attrs; i++) {
+        attrs[num++] = user_attrs[i];
+    }
+
+    for (i = 0; i < num_group_attrs; i++) {
+        for (j = 0; j < num; j++) {
+            if (strcasecmp(attrs[j], group_attrs[i]) == 0) {
+                break;
+            }
+        }
+        if (j == num) {
+            attrs[num++] = group_attrs[i];
+        }
+    }
+    attrs[num++] = AD_DIRSYNC_ATTR_IS_DELETED;
+    attrs[num] = NULL;
+
+    talloc_steal(attrs, user_attrs);
+    talloc_steal(attrs, group_attrs);
+    *_attrs = talloc_steal(mem_ctx, attrs);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static void ad_dirsync_enum_connected(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct ad_dirsync_enum_state *state = tevent_req_data(req,
+                                                struct ad_dirsync_enum_state);
+    const char *rootdse_attrs[] = { SDAP_ROOTDSE_ATTR_DEFAULT_NAMING_CONTEXT,
+                                    NULL };
+    int dp_error;
+    errno_t ret;
+
+    ret = sdap_id_op_connect_recv(subreq, &dp_error);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        if (dp_error == DP_ERR_OFFLINE) {
+            DEBUG(SSSDBG_TRACE_FUNC,
+                  "Backend is marked offline, retry later!\n");
+            tevent_req_done(req);
+        } else {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "DirSync enumeration failed to connect to "
+                  "LDAP server: (%d)[%s]\n", ret, strerror(ret));
+            tevent_req_error(req, ret);
+        }
+        return;
+    }
+
+    if (!sdap_is_control_supported(sdap_id_op_handle(state->op),
+                                   LDAP_SERVER_DIRSYNC_OID)) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "The server does not support DirSync, falling back to "
+              "regular enumeration of domain %s\n", state->sdom->dom->name);
+        state->full = true;
+        subreq = sdap_dom_enum_ex_send(state, state->ev,
+                                       state->id_ctx->sdap_id_ctx,
+                                       state->sdom,
+                                       state->user_conn,
+                                       state->id_ctx->ldap_ctx,
+                                       state->id_ctx->ldap_ctx);
+        if (subreq == NULL) {
+            tevent_req_error(req, ENOMEM);
+            return;
+        }
+        tevent_req_set_callback(subreq, ad_dirsync_enum_full_done, req);
+        return;
+    }
+
+    subreq = sdap_get_generic_send(state, state->ev, state->opts,
+                                   sdap_id_op_handle(state->op),
+                                   "", LDAP_SCOPE_BASE, "(objectclass=*)",
+                                   rootdse_attrs, NULL, 0, state->timeout,
+                                   false);
+    if (subreq == NULL) {
+        tevent_req_error(req, ENOMEM);
+        return;
+    }
+    tevent_req_set_callback(subreq, ad_dirsync_enum_rootdse_done, req);
+}
+
+static void ad_dirsync_enum_rootdse_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct ad_dirsync_enum_state *state = tevent_req_data(req,
+                                                struct ad_dirsync_enum_state);
+    struct sysdb_attrs **reply;
+    size_t reply_count;
+    const char *naming_context = NULL;
+    int dp_error;
+    errno_t ret;
+
+    ret = sdap_get_generic_recv(subreq, state, &reply_count, &reply);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        ret = sdap_id_op_done(state->op, ret, &dp_error);
+        if (dp_error == DP_ERR_OFFLINE) {
+            DEBUG(SSSDBG_TRACE_FUNC, "Backend is offline, retrying later\n");
+            tevent_req_done(req);
+            return;
+        }
+
+        DEBUG(SSSDBG_OP_FAILURE, "Cannot read the rootDSE [%d]: %s\n",
+              ret, sss_strerror(ret));
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    if (reply_count == 1) {
+        ret = sysdb_attrs_get_string(reply[0],
+                                     SDAP_ROOTDSE_ATTR_DEFAULT_NAMING_CONTEXT,
+                                     &naming_context);
+        if (ret != EOK && ret != ENOENT) {
+            tevent_req_error(req, ret);
+            return;
+        }
+    }
+
+    if (naming_context == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "The rootDSE has no %s, using [%s]\n",
+              SDAP_ROOTDSE_ATTR_DEFAULT_NAMING_CONTEXT, state->sdom->basedn);
+        naming_context = state->sdom->basedn;
+    }
+
+    state->naming_context = talloc_strdup(state, naming_context);
+    talloc_free(reply);
+    if (state->naming_context == NULL) {
+        tevent_req_error(req, ENOMEM);
+        return;
+    }
+
+    ret = ad_dirsync_enum_start(req);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+}
+
+static errno_t ad_dirsync_enum_start(struct tevent_req *req)
+{
+    struct ad_dirsync_enum_state *state = tevent_req_data(req,
+                                                struct ad_dirsync_enum_state);
+    struct sdap_options *opts = state->opts;
+    errno_t ret;
+
+    ret = sysdb_get_dirsync_cookie(state, state->sdom->dom,
+                                   &state->cookie, &state->cookie_len);
+    if (ret == ENOENT) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "No DirSync cookie for domain %s, running full enumeration\n",
+              state->sdom->dom->name);
+        state->full = true;
+    } else if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Cannot read DirSync cookie [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    state->filter = talloc_asprintf(state,
+                                    "(|(objectclass=%s)(objectclass=%s))",
+                                    opts->user_map[SDAP_OC_USER].name,
+                                    opts->group_map[SDAP_OC_GROUP].name);
+    if (state->filter == NULL) {
+        return ENOMEM;
+    }
+
+    state->flags = LDAP_DIRSYNC_OBJECT_SECURITY;
+    if (state->full) {
+        /* We only walk the change history to obtain an up-to-date cookie,
+         * the data itself is read by the regular enumeration afterwards */
+        state->attrs = talloc_zero_array(state, const char *, 2);
+        if (state->attrs == NULL) {
+            return ENOMEM;
+        }
+        state->attrs[0] = opts->user_map[SDAP_AT_USER_UUID].name;
+    } else {
+        state->flags |= LDAP_DIRSYNC_INCREMENTAL_VALUES;
+        ret = ad_dirsync_build_attrs(state, opts, &state->attrs);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    return ad_dirsync_enum_step(req);
+}
+
+static errno_t ad_dirsync_enum_step(struct tevent_req *req)
+{
+    struct ad_dirsync_enum_state *state = tevent_req_data(req,
+                                                struct ad_dirsync_enum_state);
+    struct tevent_req *subreq;
+
+    subreq = sdap_dirsync_search_send(state, state->ev, state->opts,
+                                      sdap_id_op_handle(state->op),
+                                      state->naming_context,
+                                      state->filter, state->attrs,
+                                      state->flags,
+                                      state->cookie, state->cookie_len,
+                                      state->timeout);
+    if (subreq == NULL) {
+        return ENOMEM;
+    }
+    tevent_req_set_callback(subreq, ad_dirsync_enum_step_done, req);
+
+    return EOK;
+}
+
+static errno_t ad_dirsync_add_changes(struct ad_dirsync_enum_state *state,
+                                      struct sdap_dirsync_entry **entries,
+                                      size_t num_entries)
+{
+    struct sdap_dirsync_entry **changes;
+    size_t i;
+
+    if (num_entries == 0) {
+        return EOK;
+    }
+
+    changes = talloc_realloc(state, state->changes,
+                             struct sdap_dirsync_entry *,
+                             state->num_changes + num_entries);
+    if (changes == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < num_entries; i++) {
+        changes[state->num_changes + i] = talloc_steal(changes, entries[i]);
+    }
+
+    state->changes = changes;
+    state->num_changes += num_entries;
+    return EOK;
+}
+
+static errno_t ad_dirsync_apply_changes(struct ad_dirsync_enum_state *state);
+
+static void ad_dirsync_enum_step_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct ad_dirsync_enum_state *state = tevent_req_data(req,
+                                                struct ad_dirsync_enum_state);
+    struct sdap_dirsync_entry **entries;
+    size_t num_entries;
+    uint8_t *cookie;
+    size_t cookie_len;
+    bool more_results;
+    bool cookie_rejected;
+    int dp_error;
+    errno_t ret;
+
+    ret = sdap_dirsync_search_recv(subreq, state, &num_entries, &entries,
+                                   &cookie, &cookie_len, &more_results);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        cookie_rejected = (ret == ERR_DIRSYNC_COOKIE_REJECTED);
+        ret = sdap_id_op_done(state->op, ret, &dp_error);
+        if (dp_error == DP_ERR_OFFLINE) {
+            DEBUG(SSSDBG_TRACE_FUNC, "Backend is offline, retrying later\n");
+            tevent_req_done(req);
+            return;
+        }
+
+        if (state->cookie != NULL && cookie_rejected) {
+            /* The server refused our cookie, e.g. because the domain was
+             * restored from a backup. Start over with a full enumeration
+             * next time. Any other error keeps the cookie, so that a
+             * transient failure does not cost a full enumeration. */
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "DirSync cookie was rejected, dropping it\n");
+            if (sysdb_set_dirsync_cookie(state->sdom->dom, NULL, 0) != EOK) {
+                DEBUG(SSSDBG_MINOR_FAILURE, "Cannot drop DirSync cookie\n");
+            }
+        }
+
+        DEBUG(SSSDBG_OP_FAILURE, "DirSync search failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    if (cookie != NULL) {
+        talloc_free(state->cookie);
+        state->cookie = cookie;
+        state->cookie_len = cookie_len;
+    }
+
+    if (state->full) {
+        talloc_free(entries);
+    } else {
+        ret = ad_dirsync_add_changes(state, entries, num_entries);
+        talloc_free(entries);
+        if (ret != EOK) {
+            tevent_req_error(req, ret);
+            return;
+        }
+    }
+
+    if (more_results) {
+        ret = ad_dirsync_enum_step(req);
+        if (ret != EOK) {
+            tevent_req_error(req, ret);
+        }
+        return;
+    }
+
+    if (state->full) {
+        subreq = sdap_dom_enum_ex_send(state, state->ev,
+                                       state->id_ctx->sdap_id_ctx,
+                                       state->sdom,
+                                       state->user_conn,
+                                       state->id_ctx->ldap_ctx,
+                                       state->id_ctx->ldap_ctx);
+        if (subreq == NULL) {
+            tevent_req_error(req, ENOMEM);
+            return;
+        }
+        tevent_req_set_callback(subreq, ad_dirsync_enum_full_done, req);
+        return;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "DirSync reported %zu changed objects\n",
+          state->num_changes);
+    state->id_ctx->sdap_id_ctx->last_enum = tevent_timeval_current();
+
+    ret = ad_dirsync_apply_changes(state);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Cannot apply DirSync changes [%d]: %s\n",
+              ret, sss_strerror(ret));
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    ret = ad_dirsync_enum_refetch_next(req);
+    if (ret == EOK) {
+        ret = ad_dirsync_enum_finish(req);
+        if (ret != EOK) {
+            tevent_req_error(req, ret);
+            return;
+        }
+        tevent_req_done(req);
+        return;
+    } else if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    /* Continues in ad_dirsync_enum_refetch_{users,groups}_done */
+}
+
+static void ad_dirsync_enum_full_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    errno_t ret;
+
+    ret = sdap_dom_enum_ex_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    ret = ad_dirsync_enum_finish(req);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+static errno_t ad_dirsync_add_guid(TALLOC_CTX *mem_ctx,
+                                   const struct ldb_val *guid,
+                                   char ***_guids,
+                                   size_t *_num_guids)
+{
+    char **guids;
+    char *value;
+    size_t i;
+
+    /* Every byte is escaped as \xx, so the value can be used in a filter */
+    value = talloc_zero_array(mem_ctx, char, 3 * guid->length + 1);
+    if (value == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < guid->length; i++) {
+        snprintf(&value[3 * i], 4, "\\%02x", guid->data[i]);
+    }
+
+    guids = talloc_realloc(mem_ctx, *_guids, char *, *_num_guids + 1);
+    if (guids == NULL) {
+        talloc_free(value);
+        return ENOMEM;
+    }
+
+    guids[*_num_guids] = talloc_steal(guids, value);
+    *_guids = guids;
+    (*_num_guids)++;
+
+    return EOK;
+}
+
+/* Only the objectGUID, the instanceType and the parentGUID are sent by the
+ * server on every change, anything else means the object itself changed */
+static bool ad_dirsync_has_attr_changes(struct sdap_options *opts,
+                                        struct sdap_dirsync_entry *entry)
+{
+    const char *name;
+    size_t i;
+
+    for (i = 0; i < entry->attrs->num; i++) {
+        name = entry->attrs->a[i].name;
+        if (strcmp(name, SYSDB_ORIG_DN) == 0
+                || strcasecmp(name,
+                              opts->user_map[SDAP_AT_USER_UUID].name) == 0
+                || strcasecmp(name, AD_DIRSYNC_ATTR_INSTANCE_TYPE) == 0
+                || strcasecmp(name, AD_DIRSYNC_ATTR_PARENT_GUID) == 0) {
+            continue;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+static bool ad_dirsync_has_objectclass(struct ldb_message_element *el,
+                                       const char *objectclass)
+{
+    size_t i;
+
+    for (i = 0; i < el->num_values; i++) {
+        if (strcasecmp((const char *) el->values[i].data, objectclass) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool ad_dirsync_is_deleted(struct sdap_dirsync_entry *entry)
+{
+    const char *is_deleted;
+    errno_t ret;
+
+    ret = sysdb_attrs_get_string(entry->attrs, AD_DIRSYNC_ATTR_IS_DELETED,
+                                 &is_deleted);
+    if (ret != EOK) {
+        return false;
+    }
+
+    return strcasecmp(is_deleted, "TRUE") == 0;
+}
+
+static errno_t ad_dirsync_find_member(TALLOC_CTX *mem_ctx,
+                                      struct sss_domain_info *dom,
+                                      const char *orig_dn,
+                                      struct ldb_dn **_member_dn)
+{
+    const char *attrs[] = { SYSDB_NAME, NULL };
+    struct ldb_message **msgs;
+    size_t count;
+    errno_t ret;
+
+    ret = sysdb_search_users_by_orig_dn(mem_ctx, dom, orig_dn, attrs,
+                                        &count, &msgs);
+    if (ret == ENOENT) {
+        ret = sysdb_search_groups_by_orig_dn(mem_ctx, dom, orig_dn, attrs,
+                                             &count, &msgs);
+    }
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (count != 1) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Member [%s] matched %zu cached objects\n", orig_dn, count);
+        return ENOENT;
+    }
+
+    *_member_dn = msgs[0]->dn;
+    return EOK;
+}
+
+/* Returns EAGAIN if the member list cannot be patched, because a new member
+ * is not cached yet, and the group has to be re-read instead */
+static errno_t ad_dirsync_patch_members(struct sss_domain_info *dom,
+                                        struct ldb_dn *group_dn,
+                                        struct sdap_options *opts,
+                                        struct sdap_dirsync_entry *entry)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char *member_attr = opts->group_map[SDAP_AT_GROUP_MEMBER].name;
+    struct ldb_message_element *el;
+    struct ldb_dn **added_dns = NULL;
+    struct ldb_dn *member_dn;
+    size_t num_added = 0;
+    const char *orig_dn;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    /* Resolve all new members before the first modification, so that we
+     * don't leave the group half-updated if we have to fall back to
+     * re-reading it */
+    ret = sysdb_attrs_get_el_ext(entry->added, member_attr, false, &el);
+    if (ret == EOK) {
+        added_dns = talloc_array(tmp_ctx, struct ldb_dn *, el->num_values);
+        if (added_dns == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        for (i = 0; i < el->num_values; i++) {
+            orig_dn = (const char *) el->values[i].data;
+            ret = ad_dirsync_find_member(tmp_ctx, dom, orig_dn,
+                                         &added_dns[num_added]);
+            if (ret == ENOENT) {
+                DEBUG(SSSDBG_TRACE_FUNC,
+                      "New member [%s] is not cached\n", orig_dn);
+                ret = EAGAIN;
+                goto done;
+            } else if (ret != EOK) {
+                goto done;
+            }
+            num_added++;
+        }
+    } else if (ret != ENOENT) {
+        goto done;
+    }
+
+    for (i = 0; i < num_added; i++) {
+        ret = sysdb_mod_group_member(dom, added_dns[i], group_dn,
+                                     SYSDB_MOD_ADD);
+        if (ret != EOK && ret != EEXIST) {
+            goto done;
+        }
+    }
+
+    ret = sysdb_attrs_get_el_ext(entry->removed, member_attr, false, &el);
+    if (ret == EOK) {
+        for (i = 0; i < el->num_values; i++) {
+            orig_dn = (const char *) el->values[i].data;
+            ret = ad_dirsync_find_member(tmp_ctx, dom, orig_dn, &member_dn);
+            if (ret == ENOENT) {
+                /* Nothing to remove */
+                continue;
+            } else if (ret != EOK) {
+                goto done;
+            }
+
+            ret = sysdb_mod_group_member(dom, member_dn, group_dn,
+                                         SYSDB_MOD_DEL);
+            if (ret != EOK) {
+                /* The member might already be gone from the cached group */
+                DEBUG(SSSDBG_MINOR_FAILURE,
+                      "Cannot remove [%s] from group [%s]\n", orig_dn,
+                      ldb_dn_get_linearized(group_dn));
+            }
+        }
+    } else if (ret != ENOENT) {
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t ad_dirsync_remove_cached(struct sss_domain_info *dom,
+                                        const char *category,
+                                        const char *name)
+{
+    errno_t ret;
+
+    if (strcmp(category, SYSDB_GROUP_CLASS) == 0) {
+        ret = sysdb_delete_group(dom, name, 0);
+    } else {
+        ret = sysdb_delete_user(dom, name, 0);
+    }
+    if (ret == ENOENT) {
+        ret = EOK;
+    }
+
+    return ret;
+}
+
+/* Without search bases, e.g. before they were read from the rootDSE, the
+ * whole naming context is used */
+static bool ad_dirsync_in_search_bases(TALLOC_CTX *mem_ctx,
+                                       const char *dn,
+                                       struct sdap_search_base **bases)
+{
+    if (bases == NULL) {
+        return true;
+    }
+
+    return sss_ldap_dn_in_search_bases(mem_ctx, dn, bases, NULL);
+}
+
+static errno_t ad_dirsync_apply_change(TALLOC_CTX *mem_ctx,
+                                       struct ad_dirsync_enum_state *state,
+                                       struct sdap_dirsync_entry *entry)
+{
+    struct sss_domain_info *dom = state->sdom->dom;
+    struct sdap_options *opts = state->opts;
+    const char *attrs[] = { SYSDB_NAME, SYSDB_OBJECTCATEGORY, NULL };
+    char guid_str[GUID_STR_BUF_SIZE];
+    struct ldb_message_element *guid_el;
+    struct ldb_message_element *el;
+    struct ldb_result *res;
+    const char *category = NULL;
+    const char *name = NULL;
+    const char *orig_dn;
+    bool is_group;
+    errno_t ret;
+
+    ret = sysdb_attrs_get_el_ext(entry->attrs,
+                                 opts->user_map[SDAP_AT_USER_UUID].name,
+                                 false, &guid_el);
+    if (ret != EOK || guid_el->num_values != 1
+            || guid_el->values[0].length != GUID_BIN_LENGTH) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "DirSync entry without objectGUID\n");
+        return EOK;
+    }
+
+    ret = guid_blob_to_string_buf(guid_el->values[0].data, guid_str,
+                                  GUID_STR_BUF_SIZE);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sysdb_search_object_by_uuid(mem_ctx, dom, guid_str, attrs, &res);
+    if (ret == EOK && res->count == 1) {
+        name = ldb_msg_find_attr_as_string(res->msgs[0], SYSDB_NAME, NULL);
+        category = ldb_msg_find_attr_as_string(res->msgs[0],
+                                               SYSDB_OBJECTCATEGORY, NULL);
+    } else if (ret != EOK && ret != ENOENT) {
+        return ret;
+    }
+
+    if (ad_dirsync_is_deleted(entry)) {
+        if (name == NULL || category == NULL) {
+            DEBUG(SSSDBG_TRACE_ALL,
+                  "Deleted object [%s] is not cached\n", guid_str);
+            return EOK;
+        }
+
+        DEBUG(SSSDBG_TRACE_FUNC, "Removing deleted %s [%s] from cache\n",
+              category, name);
+        return ad_dirsync_remove_cached(dom, category, name);
+    }
+
+    if (category != NULL) {
+        is_group = strcmp(category, SYSDB_GROUP_CLASS) == 0;
+    } else {
+        /* A new object, which carries its objectClass */
+        ret = sysdb_attrs_get_el_ext(entry->attrs, SYSDB_OBJECTCLASS,
+                                     false, &el);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_TRACE_ALL,
+                  "Object [%s] has no objectClass, skipping\n", guid_str);
+            return EOK;
+        }
+
+        is_group = ad_dirsync_has_objectclass(el,
+                                        opts->group_map[SDAP_OC_GROUP].name);
+    }
+
+    /* The search covers the whole naming context */
+    ret = sysdb_attrs_get_string(entry->attrs, SYSDB_ORIG_DN, &orig_dn);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "DirSync entry [%s] without DN\n",
+              guid_str);
+        return EOK;
+    }
+
+    if (!ad_dirsync_in_search_bases(mem_ctx, orig_dn,
+                                    is_group ? state->sdom->group_search_bases
+                                             : state->sdom->user_search_bases)) {
+        if (name == NULL || category == NULL) {
+            DEBUG(SSSDBG_TRACE_ALL,
+                  "[%s] is outside of the search bases\n", orig_dn);
+            return EOK;
+        }
+
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Removing %s [%s] which moved out of the search bases\n",
+              category, name);
+        return ad_dirsync_remove_cached(dom, category, name);
+    }
+
+    if (is_group && category != NULL
+            && !ad_dirsync_has_attr_changes(opts, entry)) {
+        ret = ad_dirsync_patch_members(dom, res->msgs[0]->dn, opts, entry);
+        if (ret == EOK) {
+            DEBUG(SSSDBG_TRACE_FUNC,
+                  "Updated members of group [%s] incrementally\n", name);
+            return EOK;
+        } else if (ret != EAGAIN) {
+            return ret;
+        }
+    }
+
+    if (is_group) {
+        ret = ad_dirsync_add_guid(state, &guid_el->values[0],
+                                  &state->group_guids,
+                                  &state->num_group_guids);
+    } else {
+        ret = ad_dirsync_add_guid(state, &guid_el->values[0],
+                                  &state->user_guids,
+                                  &state->num_user_guids);
+    }
+
+    return ret;
+}
+
+static errno_t ad_dirsync_apply_changes(struct ad_dirsync_enum_state *state)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sysdb_ctx *sysdb = state->sdom->dom->sysdb;
+    bool in_transaction = false;
+    errno_t ret;
+    errno_t sret;
+    size_t i;
+
+    if (state->num_changes == 0) {
+        return EOK;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    /* All the deletions and membership deltas are written at once */
+    ret = sysdb_transaction_start(sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start transaction\n");
+        goto done;
+    }
+    in_transaction = true;
+
+    for (i = 0; i < state->num_changes; i++) {
+        ret = ad_dirsync_apply_change(tmp_ctx, state, state->changes[i]);
+        if (ret != EOK) {
+            goto done;
+        }
+        talloc_free_children(tmp_ctx);
+    }
+
+    ret = sysdb_transaction_commit(sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
+        goto done;
+    }
+    in_transaction = false;
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "%zu users and %zu groups have to be re-read\n",
+          state->num_user_guids, state->num_group_guids);
+
+    talloc_zfree(state->changes);
+    state->num_changes = 0;
+    ret = EOK;
+
+done:
+    if (in_transaction) {
+        sret = sysdb_transaction_cancel(sysdb);
+        if (sret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Could not cancel transaction\n");
+        }
+    }
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static char *ad_dirsync_guid_filter(TALLOC_CTX *mem_ctx,
+                                    const char *base_filter,
+                                    const char *guid_attr,
+                                    char **guids,
+                                    size_t num_guids,
+                                    size_t *_idx)
+{
+    char *filter;
+    size_t i;
+
+    filter = talloc_asprintf(mem_ctx, "(&%s(|", base_filter);
+    for (i = 0; filter != NULL
+                && i < AD_DIRSYNC_REFETCH_BATCH
+                && *_idx < num_guids; i++, (*_idx)++) {
+        filter = talloc_asprintf_append_buffer(filter, "(%s=%s)",
+                                               guid_attr, guids[*_idx]);
+    }
+
+    if (filter != NULL) {
+        filter = talloc_asprintf_append_buffer(filter, "))");
+    }
+
+    return filter;
+}
+
+/* Returns EAGAIN if a search was started, EOK if there is nothing left to
+ * be re-read */
+static errno_t ad_dirsync_enum_refetch_next(struct tevent_req *req)
+{
+    struct ad_dirsync_enum_state *state = tevent_req_data(req,
+                                                struct ad_dirsync_enum_state);
+    struct sdap_options *opts = state->opts;
+    struct tevent_req *subreq;
+    const char **attrs;
+    char *base_filter;
+    char *filter;
+    errno_t ret;
+
+    if (state->refetch_idx < state->num_user_guids) {
+        base_filter = talloc_asprintf(state, "(objectclass=%s)(%s=*)",
+                                      opts->user_map[SDAP_OC_USER].name,
+                                      opts->user_map[SDAP_AT_USER_NAME].name);
+        if (base_filter == NULL) {
+            return ENOMEM;
+        }
+
+        filter = ad_dirsync_guid_filter(state, base_filter,
+                                        opts->user_map[SDAP_AT_USER_UUID].name,
+                                        state->user_guids,
+                                        state->num_user_guids,
+                                        &state->refetch_idx);
+        talloc_free(base_filter);
+        if (filter == NULL) {
+            return ENOMEM;
+        }
+
+        ret = build_attrs_from_map(state, opts->user_map, opts->user_map_cnt,
+                                   NULL, &attrs, NULL);
+        if (ret != EOK) {
+            return ret;
+        }
+
+        subreq = sdap_get_users_send(state, state->ev,
+                                     state->sdom->dom,
+                                     state->sdom->dom->sysdb,
+                                     opts,
+                                     state->sdom->user_search_bases,
+                                     sdap_id_op_handle(state->op),
+                                     attrs, filter, state->timeout,
+                                     SDAP_LOOKUP_ENUMERATE, NULL);
+        if (subreq == NULL) {
+            return ENOMEM;
+        }
+        tevent_req_set_callback(subreq, ad_dirsync_enum_refetch_users_done,
+                                req);
+        return EAGAIN;
+    }
+
+    if (state->refetch_idx < state->num_user_guids + state->num_group_guids) {
+        base_filter = talloc_asprintf(state, "(objectclass=%s)(%s=*)",
+                                      opts->group_map[SDAP_OC_GROUP].name,
+                                      opts->group_map[SDAP_AT_GROUP_NAME].name);
+        if (base_filter == NULL) {
+            return ENOMEM;
+        }
+
+        /* Group GUIDs are indexed after the user ones */
+        state->refetch_idx -= state->num_user_guids;
+        filter = ad_dirsync_guid_filter(state, base_filter,
+                                       opts->group_map[SDAP_AT_GROUP_UUID].name,
+                                       state->group_guids,
+                                       state->num_group_guids,
+                                       &state->refetch_idx);
+        state->refetch_idx += state->num_user_guids;
+        talloc_free(base_filter);
+        if (filter == NULL) {
+            return ENOMEM;
+        }
+
+        ret = build_attrs_from_map(state, opts->group_map, SDAP_OPTS_GROUP,
+                                   NULL, &attrs, NULL);
+        if (ret != EOK) {
+            return ret;
+        }
+
+        subreq = sdap_get_groups_send(state, state->ev, state->sdom, opts,
+                                      sdap_id_op_handle(state->op),
+                                      attrs, filter, state->timeout,
+                                      SDAP_LOOKUP_ENUMERATE, false);
+        if (subreq == NULL) {
+            return ENOMEM;
+        }
+        tevent_req_set_callback(subreq, ad_dirsync_enum_refetch_groups_done,
+                                req);
+        return EAGAIN;
+    }
+
+    return EOK;
+}
+
+static void ad_dirsync_enum_refetch_done(struct tevent_req *req, errno_t ret)
+{
+    struct ad_dirsync_enum_state *state = tevent_req_data(req,
+                                                struct ad_dirsync_enum_state);
+    int dp_error;
+
+    if (ret != EOK && ret != ENOENT) {
+        ret = sdap_id_op_done(state->op, ret, &dp_error);
+        if (dp_error == DP_ERR_OFFLINE) {
+            /* The cookie is not stored, so the same changes will be
+             * delivered again */
+            DEBUG(SSSDBG_TRACE_FUNC, "Backend is offline, retrying later\n");
+            tevent_req_done(req);
+            return;
+        }
+
+        DEBUG(SSSDBG_OP_FAILURE, "Cannot re-read changed objects [%d]: %s\n",
+              ret, sss_strerror(ret));
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    ret = ad_dirsync_enum_refetch_next(req);
+    if (ret == EAGAIN) {
+        return;
+    } else if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    ret = ad_dirsync_enum_finish(req);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+static void ad_dirsync_enum_refetch_users_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    errno_t ret;
+
+    ret = sdap_get_users_recv(subreq, NULL, NULL);
+    talloc_zfree(subreq);
+
+    ad_dirsync_enum_refetch_done(req, ret);
+}
+
+static void ad_dirsync_enum_refetch_groups_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    errno_t ret;
+
+    ret = sdap_get_groups_recv(subreq, NULL, NULL);
+    talloc_zfree(subreq);
+
+    ad_dirsync_enum_refetch_done(req, ret);
+}
+
+static errno_t ad_dirsync_enum_finish(struct tevent_req *req)
+{
+    struct ad_dirsync_enum_state *state = tevent_req_data(req,
+                                                struct ad_dirsync_enum_state);
+    errno_t ret;
+
+    if (state->cookie != NULL) {
+        /* Only remember the new position once all changes are in the cache,
+         * otherwise they would be lost */
+        ret = sysdb_set_dirsync_cookie(state->sdom->dom, state->cookie,
+                                       state->cookie_len);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Cannot store DirSync cookie [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            return ret;
+        }
+    }
+
+    if (!state->full) {
+        /* The regular enumeration marks the domain on its own */
+        ret = sysdb_set_enumerated(state->sdom->dom, SYSDB_HAS_ENUMERATED_ID,
+                                   true);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Could not mark domain as having enumerated.\n");
+            /* This error is non-fatal, so continue */
+        }
+    }
+
+    return EOK;
+}
+
+errno_t ad_dirsync_enum_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
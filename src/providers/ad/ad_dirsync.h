@@ -0,0 +1,41 @@
+/*
+    SSSD
+
+    AD DirSync based incremental enumeration
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AD_DIRSYNC_H_
+#define AD_DIRSYNC_H_
+
+#include "providers/ad/ad_common.h"
+
+/* Enumerates the domain using the DirSync control. The first run (no cookie
+ * stored in the cache yet) performs a regular full enumeration and records
+ * the DirSync cookie, subsequent runs only fetch the objects that changed
+ * since then. Deleted objects are removed from the cache and changes to the
+ * member attribute of cached groups are applied as deltas. */
+struct tevent_req *
+ad_dirsync_enum_send(TALLOC_CTX *mem_ctx,
+                     struct tevent_context *ev,
+                     struct ad_id_ctx *id_ctx,
+                     struct sdap_domain *sdom,
+                     struct sdap_id_conn_ctx *user_conn);
+
+errno_t ad_dirsync_enum_recv(struct tevent_req *req);
+
+#endif /* AD_DIRSYNC_H_ */
@@ -38,6 +38,8 @@
 #include "util/util.h"
 #include "util/strtonum.h"
 #include "util/child_common.h"
+#include "util/sss_ptr_hash.h"
+#include "util/probes.h"
 #include "providers/data_provider.h"
 #include "providers/backend.h"
 #include "providers/ad/ad_access.h"
@@ -65,6 +67,7 @@
 #define AD_AT_MACHINE_EXT_NAMES "gPCMachineExtensionNames"
 #define AD_AT_FUNC_VERSION "gPCFunctionalityVersion"
 #define AD_AT_FLAGS "flags"
+#define AD_AT_VERSION_NUMBER "versionNumber"
 
 #define UAC_WORKSTATION_TRUST_ACCOUNT 0x00001000
 #define UAC_SERVER_TRUST_ACCOUNT 0x00002000
@@ -130,6 +133,7 @@ struct gp_gpo {
     int num_gpo_cse_guids;
     int gpo_func_version;
     int gpo_flags;
+    int gpo_container_version;
     bool send_to_child;
     const char *policy_filename;
 };
@@ -171,6 +175,7 @@ int ad_gpo_process_gpo_recv(struct tevent_req *req,
 
 struct tevent_req *ad_gpo_process_cse_send(TALLOC_CTX *mem_ctx,
                                            struct tevent_context *ev,
+                                           struct sss_child_pool *child_pool,
                                            bool send_to_child,
                                            struct sss_domain_info *domain,
                                            const char *gpo_guid,
@@ -1583,6 +1588,377 @@ ad_gpo_perform_hbac_processing(TALLOC_CTX *mem_ctx,
     return ret;
 }
 
+/* extract the host name of the AD server the connection is bound to */
+static errno_t
+ad_gpo_get_server_hostname(TALLOC_CTX *mem_ctx,
+                           struct sdap_id_conn_ctx *conn,
+                           char **_server_hostname)
+{
+    char *server_uri;
+    char *server_hostname;
+    LDAPURLDesc *lud;
+    errno_t ret;
+
+    server_uri = conn->service->uri;
+    ret = ldap_url_parse(server_uri, &lud);
+    if (ret != LDAP_SUCCESS) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Failed to parse ldap URI (%s)!\n", server_uri);
+        return EINVAL;
+    }
+
+    if (lud->lud_host == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "The LDAP URI (%s) did not contain a host name\n", server_uri);
+        ldap_free_urldesc(lud);
+        return EINVAL;
+    }
+
+    server_hostname = talloc_strdup(mem_ctx, lud->lud_host);
+    ldap_free_urldesc(lud);
+    if (server_hostname == NULL) {
+        return ENOMEM;
+    }
+    DEBUG(SSSDBG_TRACE_ALL, "server_hostname from uri: %s\n",
+          server_hostname);
+
+    *_server_hostname = server_hostname;
+    return EOK;
+}
+
+/* search for the machine account, which is the target of the policies */
+static struct tevent_req *
+ad_gpo_target_dn_search_send(TALLOC_CTX *mem_ctx,
+                             struct tevent_context *ev,
+                             struct sdap_options *opts,
+                             struct sdap_id_op *sdap_op,
+                             struct sss_domain_info *host_domain,
+                             int timeout)
+{
+    struct tevent_req *subreq;
+    const char *sam_account_name;
+    char *domain_dn;
+    char *filter;
+    errno_t ret;
+
+    const char *attrs[] = {AD_AT_DN, AD_AT_UAC, NULL};
+
+    /* SDAP_SASL_AUTHID contains the name used for kinit and SASL bind which
+     * in the AD case is the NetBIOS name. */
+    sam_account_name = dp_opt_get_string(opts->basic, SDAP_SASL_AUTHID);
+    if (sam_account_name == NULL) {
+        return NULL;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "sam_account_name is %s\n", sam_account_name);
+
+    /* Convert the domain name into domain DN */
+    ret = domain_to_basedn(mem_ctx, host_domain->name, &domain_dn);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot convert domain name [%s] to base DN [%d]: %s\n",
+               host_domain->name, ret, sss_strerror(ret));
+        return NULL;
+    }
+
+    /* SDAP_OC_USER objectclass covers both users and computers */
+    filter = talloc_asprintf(mem_ctx,
+                             "(&(objectclass=%s)(%s=%s))",
+                             opts->user_map[SDAP_OC_USER].name,
+                             opts->user_map[SDAP_AT_USER_NAME].name,
+                             sam_account_name);
+    if (filter == NULL) {
+        return NULL;
+    }
+
+    subreq = sdap_get_generic_send(mem_ctx, ev, opts,
+                                   sdap_id_op_handle(sdap_op),
+                                   domain_dn, LDAP_SCOPE_SUBTREE,
+                                   filter, attrs, NULL, 0,
+                                   timeout,
+                                   false);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "sdap_get_generic_send failed.\n");
+    }
+
+    return subreq;
+}
+
+static errno_t
+ad_gpo_target_dn_parse(TALLOC_CTX *mem_ctx,
+                       size_t reply_count,
+                       struct sysdb_attrs **reply,
+                       const char **_target_dn)
+{
+    const char *target_dn = NULL;
+    uint32_t uac;
+    errno_t ret;
+
+    /* make sure there is only one non-NULL reply returned */
+
+    if (reply_count < 1) {
+        DEBUG(SSSDBG_OP_FAILURE, "No DN retrieved for policy target.\n");
+        return ENOENT;
+    } else if (reply_count > 1) {
+        DEBUG(SSSDBG_OP_FAILURE, "Multiple replies for policy target\n");
+        return ERR_INTERNAL;
+    } else if (reply == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "reply_count is 1, but reply is NULL\n");
+        return ERR_INTERNAL;
+    }
+
+    /* reply[0] holds requested attributes of single reply */
+    ret = sysdb_attrs_get_string(reply[0], AD_AT_DN, &target_dn);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "sysdb_attrs_get_string failed: [%d](%s)\n",
+               ret, sss_strerror(ret));
+        return ret;
+    }
+
+    ret = sysdb_attrs_get_uint32_t(reply[0], AD_AT_UAC, &uac);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "sysdb_attrs_get_uint32_t failed: [%d](%s)\n",
+               ret, sss_strerror(ret));
+        return ret;
+    }
+
+    /* we only support computer policy targets, not users */
+    if (!(uac & UAC_WORKSTATION_TRUST_ACCOUNT ||
+          uac & UAC_SERVER_TRUST_ACCOUNT)) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Invalid userAccountControl (%x) value for machine account.\n",
+              uac);
+        return EINVAL;
+    }
+
+    *_target_dn = talloc_strdup(mem_ctx, target_dn);
+    if (*_target_dn == NULL) {
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+/* == ad_gpo decision cache ================================================ */
+
+/*
+ * The outcome of the HBAC processing only depends on the GPOs that apply to
+ * the host, on the logon right the PAM service maps to and on the SIDs of
+ * the user. Decisions are remembered per logon right and SID set; the GPOs
+ * are summarized in a fingerprint of the candidate GPO list, which includes
+ * the version of each GPO. Whenever a different fingerprint is seen, either
+ * by an access request or by the periodic check, all decisions are dropped
+ * and the generation is bumped so that requests which were already running
+ * do not store results computed from the old policies.
+ */
+struct ad_gpo_decision {
+    errno_t result;
+    time_t expire;
+};
+
+struct ad_gpo_decision_cache {
+    hash_table_t *decisions;
+    char *fingerprint;
+    uint32_t generation;
+    int timeout;
+};
+
+static int
+ad_gpo_sid_cmp(const void *a, const void *b)
+{
+    return strcmp(*(const char **)a, *(const char **)b);
+}
+
+static char *
+ad_gpo_decision_key(TALLOC_CTX *mem_ctx,
+                    enum gpo_map_type gpo_map_type,
+                    const char *user_sid,
+                    const char **group_sids,
+                    int group_size)
+{
+    const char **sorted;
+    char *key;
+    int i;
+
+    sorted = talloc_memdup(mem_ctx, group_sids,
+                           sizeof(const char *) * group_size);
+    if (sorted == NULL && group_size > 0) {
+        return NULL;
+    }
+    qsort(sorted, group_size, sizeof(const char *), ad_gpo_sid_cmp);
+
+    key = talloc_asprintf(mem_ctx, "%d:%s", gpo_map_type, user_sid);
+    for (i = 0; key != NULL && i < group_size; i++) {
+        /* the same group may be reached through several paths */
+        if (i > 0 && strcmp(sorted[i], sorted[i - 1]) == 0) {
+            continue;
+        }
+        key = talloc_asprintf_append(key, ",%s", sorted[i]);
+    }
+
+    talloc_free(sorted);
+    return key;
+}
+
+static char *
+ad_gpo_policy_fingerprint(TALLOC_CTX *mem_ctx,
+                          struct gp_gpo **candidate_gpos,
+                          int num_candidate_gpos)
+{
+    char *fingerprint;
+    int i;
+
+    /* the order matters, it reflects the precedence of the GPOs */
+    fingerprint = talloc_strdup(mem_ctx, "");
+    for (i = 0; fingerprint != NULL && i < num_candidate_gpos; i++) {
+        fingerprint = talloc_asprintf_append(fingerprint, "%s:%d:%d;",
+                                    candidate_gpos[i]->gpo_dn,
+                                    candidate_gpos[i]->gpo_container_version,
+                                    candidate_gpos[i]->gpo_flags);
+    }
+
+    return fingerprint;
+}
+
+static errno_t
+ad_gpo_decision_cache_set_policy(struct ad_gpo_decision_cache *cache,
+                                 const char *fingerprint)
+{
+    char *dup;
+
+    if (cache->fingerprint != NULL
+            && strcmp(cache->fingerprint, fingerprint) == 0) {
+        return EOK;
+    }
+
+    dup = talloc_strdup(cache, fingerprint);
+    if (dup == NULL) {
+        return ENOMEM;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "GPOs applying to this host changed, "
+          "dropping cached access decisions\n");
+
+    talloc_free(cache->fingerprint);
+    cache->fingerprint = dup;
+    cache->generation++;
+    sss_ptr_hash_delete_all(cache->decisions, true);
+
+    return EOK;
+}
+
+static errno_t
+ad_gpo_decision_cache_get(TALLOC_CTX *mem_ctx,
+                          struct ad_gpo_decision_cache *cache,
+                          const char *user,
+                          struct sss_domain_info *domain,
+                          enum gpo_map_type gpo_map_type,
+                          char **_key,
+                          errno_t *_result)
+{
+    struct ad_gpo_decision *decision;
+    const char *user_sid = NULL;
+    const char **group_sids = NULL;
+    int group_size = 0;
+    char *key;
+    errno_t ret;
+
+    ret = ad_gpo_get_sids(mem_ctx, user, domain, &user_sid,
+                          &group_sids, &group_size);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (user_sid == NULL) {
+        talloc_free(group_sids);
+        return EINVAL;
+    }
+
+    key = ad_gpo_decision_key(mem_ctx, gpo_map_type, user_sid,
+                              group_sids, group_size);
+    talloc_free(discard_const(user_sid));
+    talloc_free(group_sids);
+    if (key == NULL) {
+        return ENOMEM;
+    }
+
+    *_key = key;
+
+    decision = sss_ptr_hash_lookup(cache->decisions, key,
+                                   struct ad_gpo_decision);
+    if (decision == NULL) {
+        return ENOENT;
+    }
+
+    if (decision->expire < time(NULL)) {
+        talloc_free(decision);
+        return ENOENT;
+    }
+
+    *_result = decision->result;
+    return EOK;
+}
+
+static void
+ad_gpo_decision_cache_add(struct ad_gpo_decision_cache *cache,
+                          const char *key,
+                          uint32_t generation,
+                          errno_t result)
+{
+    struct ad_gpo_decision *decision;
+    errno_t ret;
+
+    if (generation != cache->generation) {
+        /* the policies changed while the request was running */
+        return;
+    }
+
+    decision = talloc_zero(cache->decisions, struct ad_gpo_decision);
+    if (decision == NULL) {
+        return;
+    }
+
+    decision->result = result;
+    decision->expire = time(NULL) + cache->timeout;
+
+    ret = sss_ptr_hash_add_or_override(cache->decisions, key, decision,
+                                       struct ad_gpo_decision);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to cache GPO access decision "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        talloc_free(decision);
+    }
+}
+
+static void
+ad_gpo_decision_cache_purge(struct ad_gpo_decision_cache *cache)
+{
+    struct ad_gpo_decision *decision;
+    hash_value_t *values;
+    unsigned long count;
+    unsigned long i;
+    time_t now;
+    int hret;
+
+    hret = hash_values(cache->decisions, &count, &values);
+    if (hret != HASH_SUCCESS) {
+        return;
+    }
+
+    now = time(NULL);
+    for (i = 0; i < count; i++) {
+        decision = sss_ptr_get_value(&values[i], struct ad_gpo_decision);
+        if (decision != NULL && decision->expire < now) {
+            /* freeing the decision removes it from the table */
+            talloc_free(decision);
+        }
+    }
+
+    talloc_free(values);
+}
+
 /* == ad_gpo_access_send/recv implementation ================================*/
 
 struct ad_gpo_access_state {
@@ -1608,6 +1984,9 @@ struct ad_gpo_access_state {
     struct gp_gpo **cse_filtered_gpos;
     int num_cse_filtered_gpos;
     int cse_gpo_index;
+    char *decision_key;
+    bool decision_cacheable;
+    uint32_t decision_generation;
 };
 
 static void ad_gpo_connect_done(struct tevent_req *subreq);
@@ -1618,6 +1997,8 @@ static void ad_gpo_process_gpo_done(struct tevent_req *subreq);
 static errno_t ad_gpo_cse_step(struct tevent_req *req);
 static void ad_gpo_cse_done(struct tevent_req *subreq);
 
+static void ad_gpo_access_done(struct tevent_req *req, errno_t ret);
+
 struct tevent_req *
 ad_gpo_access_send(TALLOC_CTX *mem_ctx,
                    struct tevent_context *ev,
@@ -1634,6 +2015,7 @@ ad_gpo_access_send(TALLOC_CTX *mem_ctx,
     hash_key_t key;
     hash_value_t val;
     enum gpo_map_type gpo_map_type;
+    errno_t result;
 
     /* setup logging for gpo child */
     gpo_child_init();
@@ -1699,6 +2081,23 @@ ad_gpo_access_send(TALLOC_CTX *mem_ctx,
         }
     }
 
+    if (ctx->gpo_decision_cache != NULL) {
+        ret = ad_gpo_decision_cache_get(state, ctx->gpo_decision_cache,
+                                        user, domain, gpo_map_type,
+                                        &state->decision_key, &result);
+        if (ret == EOK) {
+            DEBUG(SSSDBG_TRACE_FUNC,
+                  "Using cached GPO access decision for %s\n", user);
+            ret = result;
+            goto immediately;
+        } else if (ret != ENOENT) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Unable to look up cached GPO access decision [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            state->decision_key = NULL;
+        }
+    }
+
     /* GPO Operations all happen against the enrolled domain,
      * not the user's domain (which may be a trusted realm)
      */
@@ -1788,15 +2187,8 @@ ad_gpo_connect_done(struct tevent_req *subreq)
 {
     struct tevent_req *req;
     struct ad_gpo_access_state *state;
-    char *filter;
-    const char *sam_account_name;
-    char *domain_dn;
     int dp_error;
     errno_t ret;
-    char *server_uri;
-    LDAPURLDesc *lud;
-
-    const char *attrs[] = {AD_AT_DN, AD_AT_UAC, NULL};
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct ad_gpo_access_state);
@@ -1832,75 +2224,19 @@ ad_gpo_connect_done(struct tevent_req *subreq)
         }
     }
 
-    /* extract server_hostname from server_uri */
-    server_uri = state->conn->service->uri;
-    ret = ldap_url_parse(server_uri, &lud);
-    if (ret != LDAP_SUCCESS) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "Failed to parse ldap URI (%s)!\n", server_uri);
-        ret = EINVAL;
-        goto done;
-    }
-
-    if (lud->lud_host == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "The LDAP URI (%s) did not contain a host name\n", server_uri);
-        ldap_free_urldesc(lud);
-        ret = EINVAL;
+    ret = ad_gpo_get_server_hostname(state, state->conn,
+                                     &state->server_hostname);
+    if (ret != EOK) {
         goto done;
     }
 
-    state->server_hostname = talloc_strdup(state, lud->lud_host);
-    ldap_free_urldesc(lud);
-    if (!state->server_hostname) {
+    subreq = ad_gpo_target_dn_search_send(state, state->ev, state->opts,
+                                          state->sdap_op, state->host_domain,
+                                          state->timeout);
+    if (subreq == NULL) {
         ret = ENOMEM;
         goto done;
     }
-    DEBUG(SSSDBG_TRACE_ALL, "server_hostname from uri: %s\n",
-          state->server_hostname);
-
-    /* SDAP_SASL_AUTHID contains the name used for kinit and SASL bind which
-     * in the AD case is the NetBIOS name. */
-    sam_account_name = dp_opt_get_string(state->opts->basic, SDAP_SASL_AUTHID);
-    if (sam_account_name == NULL) {
-        ret = ENOMEM;
-        goto done;
-    }
-
-    DEBUG(SSSDBG_TRACE_FUNC, "sam_account_name is %s\n", sam_account_name);
-
-    /* Convert the domain name into domain DN */
-    ret = domain_to_basedn(state, state->host_domain->name, &domain_dn);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE,
-              "Cannot convert domain name [%s] to base DN [%d]: %s\n",
-               state->host_domain->name, ret, sss_strerror(ret));
-        goto done;
-    }
-
-    /* SDAP_OC_USER objectclass covers both users and computers */
-    filter = talloc_asprintf(state,
-                             "(&(objectclass=%s)(%s=%s))",
-                             state->opts->user_map[SDAP_OC_USER].name,
-                             state->opts->user_map[SDAP_AT_USER_NAME].name,
-                             sam_account_name);
-    if (filter == NULL) {
-        ret = ENOMEM;
-        goto done;
-    }
-
-    subreq = sdap_get_generic_send(state, state->ev, state->opts,
-                                   sdap_id_op_handle(state->sdap_op),
-                                   domain_dn, LDAP_SCOPE_SUBTREE,
-                                   filter, attrs, NULL, 0,
-                                   state->timeout,
-                                   false);
-
-    if (subreq == NULL) {
-        DEBUG(SSSDBG_OP_FAILURE, "sdap_get_generic_send failed.\n");
-        ret = EIO;
-        goto done;
-    }
 
     tevent_req_set_callback(subreq, ad_gpo_target_dn_retrieval_done, req);
 
@@ -1922,8 +2258,6 @@ ad_gpo_target_dn_retrieval_done(struct tevent_req *subreq)
     int dp_error;
     size_t reply_count;
     struct sysdb_attrs **reply;
-    const char *target_dn = NULL;
-    uint32_t uac;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct ad_gpo_access_state);
@@ -1960,51 +2294,9 @@ ad_gpo_target_dn_retrieval_done(struct tevent_req *subreq)
         goto done;
     }
 
-    /* make sure there is only one non-NULL reply returned */
-
-    if (reply_count < 1) {
-        DEBUG(SSSDBG_OP_FAILURE, "No DN retrieved for policy target.\n");
-        ret = ENOENT;
-        goto done;
-    } else if (reply_count > 1) {
-        DEBUG(SSSDBG_OP_FAILURE, "Multiple replies for policy target\n");
-        ret = ERR_INTERNAL;
-        goto done;
-    } else if (reply == NULL) {
-        DEBUG(SSSDBG_OP_FAILURE, "reply_count is 1, but reply is NULL\n");
-        ret = ERR_INTERNAL;
-        goto done;
-    }
-
-    /* reply[0] holds requested attributes of single reply */
-    ret = sysdb_attrs_get_string(reply[0], AD_AT_DN, &target_dn);
+    ret = ad_gpo_target_dn_parse(state, reply_count, reply,
+                                 &state->target_dn);
     if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE,
-              "sysdb_attrs_get_string failed: [%d](%s)\n",
-               ret, sss_strerror(ret));
-        goto done;
-    }
-    state->target_dn = talloc_steal(state, target_dn);
-    if (state->target_dn == NULL) {
-        ret = ENOMEM;
-        goto done;
-    }
-
-    ret = sysdb_attrs_get_uint32_t(reply[0], AD_AT_UAC, &uac);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE,
-              "sysdb_attrs_get_uint32_t failed: [%d](%s)\n",
-               ret, sss_strerror(ret));
-        goto done;
-    }
-
-    /* we only support computer policy targets, not users */
-    if (!(uac & UAC_WORKSTATION_TRUST_ACCOUNT ||
-          uac & UAC_SERVER_TRUST_ACCOUNT)) {
-        DEBUG(SSSDBG_OP_FAILURE,
-              "Invalid userAccountControl (%x) value for machine account.\n",
-              uac);
-        ret = EINVAL;
         goto done;
     }
 
@@ -2080,6 +2372,42 @@ ad_gpo_process_som_done(struct tevent_req *subreq)
     }
 }
 
+/*
+ * Tell the decision cache which GPOs currently apply to the host. The
+ * decision of this request is only cached if the policies did not change
+ * again before it completed.
+ */
+static errno_t
+ad_gpo_access_set_policy(struct ad_gpo_access_state *state,
+                         struct gp_gpo **candidate_gpos,
+                         int num_candidate_gpos)
+{
+    struct ad_gpo_decision_cache *cache;
+    char *fingerprint;
+    errno_t ret;
+
+    cache = state->access_ctx->gpo_decision_cache;
+    if (cache == NULL || state->decision_key == NULL) {
+        return EOK;
+    }
+
+    fingerprint = ad_gpo_policy_fingerprint(state, candidate_gpos,
+                                            num_candidate_gpos);
+    if (fingerprint == NULL) {
+        return ENOMEM;
+    }
+
+    ret = ad_gpo_decision_cache_set_policy(cache, fingerprint);
+    talloc_free(fingerprint);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    state->decision_generation = cache->generation;
+    state->decision_cacheable = true;
+    return EOK;
+}
+
 /*
  * This function retrieves a list of candidate_gpos and potentially reduces it
  * to a list of dacl_filtered_gpos, based on each GPO's DACL.
@@ -2101,6 +2429,7 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
     int dp_error;
     struct gp_gpo **candidate_gpos = NULL;
     int num_candidate_gpos = 0;
+    bool no_gpos;
     int i = 0;
     const char **cse_filtered_gpo_guids;
 
@@ -2118,7 +2447,17 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
               "Unable to get GPO list: [%d](%s)\n",
               ret, sss_strerror(ret));
         goto done;
-    } else if (ret == ENOENT) {
+    }
+
+    no_gpos = (ret == ENOENT);
+
+    ret = ad_gpo_access_set_policy(state, candidate_gpos,
+                                   no_gpos ? 0 : num_candidate_gpos);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (no_gpos) {
         DEBUG(SSSDBG_TRACE_FUNC,
               "No GPOs found that apply to this system.\n");
         /*
@@ -2263,10 +2602,8 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
 
  done:
 
-    if (ret == EOK) {
-        tevent_req_done(req);
-    } else if (ret != EAGAIN) {
-        tevent_req_error(req, ret);
+    if (ret != EAGAIN) {
+        ad_gpo_access_done(req, ret);
     }
 }
 
@@ -2350,112 +2687,466 @@ ad_gpo_cse_step(struct tevent_req *req)
         return ret;
     }
 
-    DEBUG(SSSDBG_TRACE_FUNC, "send_to_child: %d\n", send_to_child);
-    DEBUG(SSSDBG_TRACE_FUNC, "cached_gpt_version: %d\n", cached_gpt_version);
+    DEBUG(SSSDBG_TRACE_FUNC, "send_to_child: %d\n", send_to_child);
+    DEBUG(SSSDBG_TRACE_FUNC, "cached_gpt_version: %d\n", cached_gpt_version);
+
+    cse_filtered_gpo->send_to_child = send_to_child;
+
+    subreq = ad_gpo_process_cse_send(state,
+                                     state->ev,
+                                     state->access_ctx->gpo_child_pool,
+                                     send_to_child,
+                                     state->host_domain,
+                                     cse_filtered_gpo->gpo_guid,
+                                     cse_filtered_gpo->smb_server,
+                                     cse_filtered_gpo->smb_share,
+                                     cse_filtered_gpo->smb_path,
+                                     GP_EXT_GUID_SECURITY_SUFFIX,
+                                     cached_gpt_version,
+                                     state->gpo_timeout_option);
+
+    tevent_req_set_callback(subreq, ad_gpo_cse_done, req);
+    return EAGAIN;
+}
+
+/*
+ * This cse-specific function (GP_EXT_GUID_SECURITY) increments the
+ * cse_gpo_index until the policy settings for all applicable GPOs have been
+ * stored as part of the GPO Result object in the sysdb cache. Once all
+ * GPOs have been processed, this functions performs HBAC processing by
+ * comparing the resultant policy setting values in the GPO Result object
+ * with the user_sid/group_sids of interest.
+ */
+static void
+ad_gpo_cse_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req;
+    struct ad_gpo_access_state *state;
+    int ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct ad_gpo_access_state);
+
+    struct gp_gpo *cse_filtered_gpo =
+        state->cse_filtered_gpos[state->cse_gpo_index];
+
+    const char *gpo_guid = cse_filtered_gpo->gpo_guid;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "gpo_guid: %s\n", gpo_guid);
+
+    ret = ad_gpo_process_cse_recv(subreq);
+
+    talloc_zfree(subreq);
+
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to retrieve policy data: [%d](%s}\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    /*
+     * now that the policy file for this gpo have been downloaded to the
+     * GPO CACHE, we store all of the supported keys present in the file
+     * (as part of the GPO Result object in the sysdb cache).
+     */
+    ret = ad_gpo_store_policy_settings(state->host_domain,
+                                       cse_filtered_gpo->policy_filename);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "ad_gpo_store_policy_settings failed: [%d](%s)\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    state->cse_gpo_index++;
+    ret = ad_gpo_cse_step(req);
+
+    if (ret == EOK) {
+        /* ret is EOK only after all GPO policy files have been downloaded */
+        ret = ad_gpo_perform_hbac_processing(state,
+                                             state->gpo_mode,
+                                             state->gpo_map_type,
+                                             state->user,
+                                             state->user_domain,
+                                             state->host_domain);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "HBAC processing failed: [%d](%s}\n",
+                  ret, sss_strerror(ret));
+            goto done;
+        }
+
+    }
+
+ done:
+
+    if (ret != EAGAIN) {
+        ad_gpo_access_done(req, ret);
+    }
+}
+
+static void
+ad_gpo_access_done(struct tevent_req *req, errno_t ret)
+{
+    struct ad_gpo_access_state *state;
+
+    state = tevent_req_data(req, struct ad_gpo_access_state);
+
+    /* only definite decisions are cached, not failures to reach one */
+    if (state->decision_cacheable
+            && (ret == EOK || ret == ERR_ACCESS_DENIED)) {
+        ad_gpo_decision_cache_add(state->access_ctx->gpo_decision_cache,
+                                  state->decision_key,
+                                  state->decision_generation,
+                                  ret);
+    }
+
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
+        tevent_req_error(req, ret);
+    }
+}
+
+errno_t
+ad_gpo_access_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+/* == ad_gpo_policy_check_send/recv implementation ========================= */
+
+/*
+ * Periodically looks up the GPOs that apply to the host, without evaluating
+ * them, so that cached access decisions are dropped as soon as a GPO is
+ * linked, unlinked or edited (which bumps its version).
+ */
+struct ad_gpo_policy_check_state {
+    struct tevent_context *ev;
+    struct ad_access_ctx *access_ctx;
+    struct sdap_id_conn_ctx *conn;
+    struct sdap_id_op *sdap_op;
+    struct sdap_options *opts;
+    struct sss_domain_info *host_domain;
+    char *server_hostname;
+    const char *target_dn;
+    int timeout;
+};
+
+static void ad_gpo_policy_check_connect_done(struct tevent_req *subreq);
+static void ad_gpo_policy_check_target_done(struct tevent_req *subreq);
+static void ad_gpo_policy_check_som_done(struct tevent_req *subreq);
+static void ad_gpo_policy_check_gpo_done(struct tevent_req *subreq);
+
+static struct tevent_req *
+ad_gpo_policy_check_send(TALLOC_CTX *mem_ctx,
+                         struct tevent_context *ev,
+                         struct be_ctx *be_ctx,
+                         struct be_ptask *be_ptask,
+                         void *pvt)
+{
+    struct ad_gpo_policy_check_state *state;
+    struct ad_access_ctx *access_ctx;
+    struct tevent_req *subreq;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct ad_gpo_policy_check_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    access_ctx = talloc_get_type(pvt, struct ad_access_ctx);
+
+    ad_gpo_decision_cache_purge(access_ctx->gpo_decision_cache);
+
+    state->ev = ev;
+    state->access_ctx = access_ctx;
+    state->host_domain = be_ctx->domain;
+    state->opts = access_ctx->sdap_access_ctx->id_ctx->opts;
+    state->timeout = dp_opt_get_int(state->opts->basic, SDAP_SEARCH_TIMEOUT);
+    state->conn = ad_get_dom_ldap_conn(access_ctx->ad_id_ctx,
+                                       state->host_domain);
+    state->sdap_op = sdap_id_op_create(state, state->conn->conn_cache);
+    if (state->sdap_op == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "sdap_id_op_create failed.\n");
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    subreq = sdap_id_op_connect_send(state->sdap_op, state, &ret);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "sdap_id_op_connect_send failed: [%d](%s)\n",
+               ret, sss_strerror(ret));
+        goto immediately;
+    }
+    tevent_req_set_callback(subreq, ad_gpo_policy_check_connect_done, req);
+
+    return req;
+
+immediately:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+    return req;
+}
+
+static void
+ad_gpo_policy_check_connect_done(struct tevent_req *subreq)
+{
+    struct ad_gpo_policy_check_state *state;
+    struct tevent_req *req;
+    int dp_error;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct ad_gpo_policy_check_state);
+
+    ret = sdap_id_op_connect_recv(subreq, &dp_error);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Failed to connect to AD server: [%d](%s)\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = ad_gpo_get_server_hostname(state, state->conn,
+                                     &state->server_hostname);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    subreq = ad_gpo_target_dn_search_send(state, state->ev, state->opts,
+                                          state->sdap_op, state->host_domain,
+                                          state->timeout);
+    if (subreq == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(subreq, ad_gpo_policy_check_target_done, req);
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+    }
+}
+
+static void
+ad_gpo_policy_check_target_done(struct tevent_req *subreq)
+{
+    struct ad_gpo_policy_check_state *state;
+    struct tevent_req *req;
+    size_t reply_count;
+    struct sysdb_attrs **reply;
+    int dp_error;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct ad_gpo_policy_check_state);
+
+    ret = sdap_get_generic_recv(subreq, state, &reply_count, &reply);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        sdap_id_op_done(state->sdap_op, ret, &dp_error);
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Unable to get policy target's DN: [%d](%s)\n",
+               ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = ad_gpo_target_dn_parse(state, reply_count, reply,
+                                 &state->target_dn);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    subreq = ad_gpo_process_som_send(state,
+                                     state->ev,
+                                     state->conn,
+                                     sysdb_ctx_get_ldb(state->host_domain->sysdb),
+                                     state->sdap_op,
+                                     state->opts,
+                                     state->access_ctx->ad_options,
+                                     state->timeout,
+                                     state->target_dn,
+                                     state->host_domain->name);
+    if (subreq == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(subreq, ad_gpo_policy_check_som_done, req);
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+    }
+}
+
+static void
+ad_gpo_policy_check_som_done(struct tevent_req *subreq)
+{
+    struct ad_gpo_policy_check_state *state;
+    struct tevent_req *req;
+    struct gp_som **som_list;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct ad_gpo_policy_check_state);
 
-    cse_filtered_gpo->send_to_child = send_to_child;
+    ret = ad_gpo_process_som_recv(subreq, state, &som_list);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Unable to get som list: [%d](%s)\n",
+               ret, sss_strerror(ret));
+        tevent_req_error(req, ret);
+        return;
+    }
 
-    subreq = ad_gpo_process_cse_send(state,
+    subreq = ad_gpo_process_gpo_send(state,
                                      state->ev,
-                                     send_to_child,
+                                     state->sdap_op,
+                                     state->opts,
+                                     state->server_hostname,
                                      state->host_domain,
-                                     cse_filtered_gpo->gpo_guid,
-                                     cse_filtered_gpo->smb_server,
-                                     cse_filtered_gpo->smb_share,
-                                     cse_filtered_gpo->smb_path,
-                                     GP_EXT_GUID_SECURITY_SUFFIX,
-                                     cached_gpt_version,
-                                     state->gpo_timeout_option);
+                                     state->access_ctx,
+                                     state->timeout,
+                                     som_list);
+    if (subreq == NULL) {
+        tevent_req_error(req, ENOMEM);
+        return;
+    }
 
-    tevent_req_set_callback(subreq, ad_gpo_cse_done, req);
-    return EAGAIN;
+    tevent_req_set_callback(subreq, ad_gpo_policy_check_gpo_done, req);
 }
 
-/*
- * This cse-specific function (GP_EXT_GUID_SECURITY) increments the
- * cse_gpo_index until the policy settings for all applicable GPOs have been
- * stored as part of the GPO Result object in the sysdb cache. Once all
- * GPOs have been processed, this functions performs HBAC processing by
- * comparing the resultant policy setting values in the GPO Result object
- * with the user_sid/group_sids of interest.
- */
 static void
-ad_gpo_cse_done(struct tevent_req *subreq)
+ad_gpo_policy_check_gpo_done(struct tevent_req *subreq)
 {
+    struct ad_gpo_policy_check_state *state;
     struct tevent_req *req;
-    struct ad_gpo_access_state *state;
-    int ret;
+    struct gp_gpo **candidate_gpos = NULL;
+    int num_candidate_gpos = 0;
+    char *fingerprint;
+    int dp_error;
+    errno_t ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
-    state = tevent_req_data(req, struct ad_gpo_access_state);
-
-    struct gp_gpo *cse_filtered_gpo =
-        state->cse_filtered_gpos[state->cse_gpo_index];
-
-    const char *gpo_guid = cse_filtered_gpo->gpo_guid;
-
-    DEBUG(SSSDBG_TRACE_FUNC, "gpo_guid: %s\n", gpo_guid);
-
-    ret = ad_gpo_process_cse_recv(subreq);
+    state = tevent_req_data(req, struct ad_gpo_policy_check_state);
 
+    ret = ad_gpo_process_gpo_recv(subreq, state, &candidate_gpos,
+                                  &num_candidate_gpos);
     talloc_zfree(subreq);
 
-    if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "Unable to retrieve policy data: [%d](%s}\n",
-              ret, sss_strerror(ret));
-        goto done;
-    }
-
-    /*
-     * now that the policy file for this gpo have been downloaded to the
-     * GPO CACHE, we store all of the supported keys present in the file
-     * (as part of the GPO Result object in the sysdb cache).
-     */
-    ret = ad_gpo_store_policy_settings(state->host_domain,
-                                       cse_filtered_gpo->policy_filename);
-    if (ret != EOK) {
+    ret = sdap_id_op_done(state->sdap_op, ret, &dp_error);
+    if (ret == ENOENT) {
+        num_candidate_gpos = 0;
+    } else if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE,
-              "ad_gpo_store_policy_settings failed: [%d](%s)\n",
+              "Unable to get GPO list: [%d](%s)\n",
               ret, sss_strerror(ret));
-        goto done;
+        tevent_req_error(req, ret);
+        return;
     }
 
-    state->cse_gpo_index++;
-    ret = ad_gpo_cse_step(req);
-
-    if (ret == EOK) {
-        /* ret is EOK only after all GPO policy files have been downloaded */
-        ret = ad_gpo_perform_hbac_processing(state,
-                                             state->gpo_mode,
-                                             state->gpo_map_type,
-                                             state->user,
-                                             state->user_domain,
-                                             state->host_domain);
-        if (ret != EOK) {
-            DEBUG(SSSDBG_OP_FAILURE, "HBAC processing failed: [%d](%s}\n",
-                  ret, sss_strerror(ret));
-            goto done;
-        }
-
+    fingerprint = ad_gpo_policy_fingerprint(state, candidate_gpos,
+                                            num_candidate_gpos);
+    if (fingerprint == NULL) {
+        tevent_req_error(req, ENOMEM);
+        return;
     }
 
- done:
-
-    if (ret == EOK) {
-        tevent_req_done(req);
-    } else if (ret != EAGAIN) {
+    ret = ad_gpo_decision_cache_set_policy(
+                                    state->access_ctx->gpo_decision_cache,
+                                    fingerprint);
+    if (ret != EOK) {
         tevent_req_error(req, ret);
+        return;
     }
+
+    tevent_req_done(req);
 }
 
-errno_t
-ad_gpo_access_recv(struct tevent_req *req)
+static errno_t
+ad_gpo_policy_check_recv(struct tevent_req *req)
 {
     TEVENT_REQ_RETURN_ON_ERROR(req);
 
     return EOK;
 }
 
+errno_t
+ad_gpo_decision_cache_init(struct be_ctx *be_ctx,
+                           struct ad_access_ctx *access_ctx)
+{
+    struct ad_gpo_decision_cache *cache;
+    int timeout;
+    time_t period;
+    errno_t ret;
+
+    timeout = dp_opt_get_int(access_ctx->ad_options,
+                             AD_GPO_DECISION_CACHE_TIMEOUT);
+    if (timeout <= 0) {
+        return EOK;
+    }
+
+    if (access_ctx->gpo_access_control_mode != GPO_ACCESS_CONTROL_ENFORCING) {
+        DEBUG(SSSDBG_CONF_SETTINGS, "GPO decisions are only cached in "
+              "enforcing mode, ignoring ad_gpo_decision_cache_timeout\n");
+        return EOK;
+    }
+
+    cache = talloc_zero(access_ctx, struct ad_gpo_decision_cache);
+    if (cache == NULL) {
+        return ENOMEM;
+    }
+
+    cache->timeout = timeout;
+    cache->decisions = sss_ptr_hash_create(cache, NULL, NULL);
+    if (cache->decisions == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* the cached GPT versions are trusted for ad_gpo_cache_timeout seconds,
+     * check the GPOs applying to the host just as often */
+    period = access_ctx->gpo_cache_timeout > 0
+                    ? access_ctx->gpo_cache_timeout : timeout;
+
+    ret = be_ptask_create(cache, be_ctx, period, period, 0, 0, period, 0,
+                          ad_gpo_policy_check_send, ad_gpo_policy_check_recv,
+                          access_ctx,
+                          "GPO policy check",
+                          BE_PTASK_OFFLINE_DISABLE |
+                          BE_PTASK_SCHEDULE_FROM_LAST,
+                          NULL);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to setup ptask "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        goto done;
+    }
+
+    access_ctx->gpo_decision_cache = cache;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(cache);
+    }
+
+    return ret;
+}
+
 /* == ad_gpo_process_som_send/recv helpers ================================= */
 
 /*
@@ -4027,6 +4718,21 @@ ad_gpo_sd_process_attrs(struct tevent_req *req,
 
     DEBUG(SSSDBG_TRACE_ALL, "gpo_flags: %d\n", gp_gpo->gpo_flags);
 
+    /* retrieve AD_AT_VERSION_NUMBER, only used to notice policy changes */
+    ret = sysdb_attrs_get_int32_t(result, AD_AT_VERSION_NUMBER,
+                                  &gp_gpo->gpo_container_version);
+    if (ret == ENOENT) {
+        gp_gpo->gpo_container_version = -1;
+    } else if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "sysdb_attrs_get_int32_t failed: [%d](%s)\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_ALL, "gpo_container_version: %d\n",
+                            gp_gpo->gpo_container_version);
+
     /* retrieve AD_AT_NT_SEC_DESC */
     ret = sysdb_attrs_get_el(result, AD_AT_NT_SEC_DESC, &el);
     if (ret != EOK && ret != ENOENT) {
@@ -4192,6 +4898,59 @@ ad_gpo_parse_gpo_child_response(uint8_t *buf,
     return ret;
 }
 
+/* == gpo_child pool ====================================================== */
+
+/*
+ * With ad_gpo_child_idle_timeout set, one gpo_child is kept running in
+ * persistent mode so that its SMB connections to the domain controllers
+ * survive between the logins. The requests are passed to it one at a time,
+ * the child is replaced after GPO_CHILD_MAX_REQUESTS requests and stopped
+ * once it was idle for ad_gpo_child_idle_timeout seconds. Otherwise a new
+ * gpo_child is started for each request.
+ */
+#define GPO_CHILD_REQUEST_TIMEOUT 60
+#define GPO_CHILD_MAX_REQUESTS 1000
+
+errno_t
+ad_gpo_child_pool_init(struct be_ctx *be_ctx,
+                       struct ad_access_ctx *access_ctx)
+{
+    static const char *persistent_argv[] = { "--persistent", NULL };
+    struct sss_child_pool_opts opts = { 0 };
+    int idle_timeout;
+    errno_t ret;
+
+    ret = gpo_child_init();
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Could not set gpo_child debugging.\n");
+    }
+
+    idle_timeout = dp_opt_get_int(access_ctx->ad_options,
+                                  AD_GPO_CHILD_IDLE_TIMEOUT);
+
+    opts.name = "gpo_child";
+    opts.binary = GPO_CHILD;
+    opts.debug_fd = gpo_child_debug_fd;
+    opts.child_out_fd = AD_GPO_CHILD_OUT_FILENO;
+    opts.timeout = GPO_CHILD_REQUEST_TIMEOUT;
+
+    if (idle_timeout > 0) {
+        opts.extra_argv = persistent_argv;
+        opts.max_running = 1;
+        opts.max_requests = GPO_CHILD_MAX_REQUESTS;
+        opts.idle_timeout = idle_timeout;
+        /* downloading the policy files again is harmless */
+        opts.retry = true;
+    } else {
+        DEBUG(SSSDBG_CONF_SETTINGS,
+              "gpo_child will be started for each request\n");
+        opts.max_requests = 1;
+    }
+
+    return sss_child_pool_create(access_ctx, be_ctx->ev, &opts,
+                                 &access_ctx->gpo_child_pool);
+}
+
 /* == ad_gpo_process_cse_send/recv implementation ========================== */
 
 struct ad_gpo_process_cse_state {
@@ -4201,14 +4960,12 @@ struct ad_gpo_process_cse_state {
     const char *gpo_guid;
     const char *smb_path;
     const char *smb_cse_suffix;
-    pid_t child_pid;
     uint8_t *buf;
     ssize_t len;
-    struct child_io_fds *io;
+    struct timeval start;
+    bool child_started;
 };
 
-static errno_t gpo_fork_child(struct tevent_req *req);
-static void gpo_cse_step(struct tevent_req *subreq);
 static void gpo_cse_done(struct tevent_req *subreq);
 
 /*
@@ -4221,6 +4978,7 @@ static void gpo_cse_done(struct tevent_req *subreq);
 struct tevent_req *
 ad_gpo_process_cse_send(TALLOC_CTX *mem_ctx,
                         struct tevent_context *ev,
+                        struct sss_child_pool *child_pool,
                         bool send_to_child,
                         struct sss_domain_info *domain,
                         const char *gpo_guid,
@@ -4253,6 +5011,7 @@ ad_gpo_process_cse_send(TALLOC_CTX *mem_ctx,
     }
 
     state->ev = ev;
+    state->start = tevent_timeval_current();
     state->buf = NULL;
     state->len = 0;
     state->domain = domain;
@@ -4260,16 +5019,6 @@ ad_gpo_process_cse_send(TALLOC_CTX *mem_ctx,
     state->gpo_guid = gpo_guid;
     state->smb_path = smb_path;
     state->smb_cse_suffix = smb_cse_suffix;
-    state->io = talloc(state, struct child_io_fds);
-    if (state->io == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "talloc failed.\n");
-        ret = ENOMEM;
-        goto immediately;
-    }
-
-    state->io->write_to_child_fd = -1;
-    state->io->read_from_child_fd = -1;
-    talloc_set_destructor((void *) state->io, child_io_destructor);
 
     /* prepare the data to pass to child */
     ret = create_cse_send_buffer(state, smb_server, smb_share, smb_path,
@@ -4279,19 +5028,14 @@ ad_gpo_process_cse_send(TALLOC_CTX *mem_ctx,
         goto immediately;
     }
 
-    ret = gpo_fork_child(req);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "gpo_fork_child failed.\n");
-        goto immediately;
-    }
+    PROBE(GPO_CSE_SEND, gpo_guid);
 
-    subreq = write_pipe_send(state, ev, buf->data, buf->size,
-                             state->io->write_to_child_fd);
+    subreq = sss_child_pool_send(state, ev, child_pool, buf->data, buf->size);
     if (subreq == NULL) {
         ret = ENOMEM;
         goto immediately;
     }
-    tevent_req_set_callback(subreq, gpo_cse_step, req);
+    tevent_req_set_callback(subreq, gpo_cse_done, req);
 
     return req;
 
@@ -4308,53 +5052,39 @@ immediately:
     return req;
 }
 
-static void gpo_cse_step(struct tevent_req *subreq)
+static void gpo_cse_finish(struct tevent_req *req, errno_t ret)
 {
-    struct tevent_req *req;
     struct ad_gpo_process_cse_state *state;
-    int ret;
+    struct timeval now;
+    uint64_t duration_us;
 
-    req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct ad_gpo_process_cse_state);
 
-    ret = write_pipe_recv(subreq);
-    talloc_zfree(subreq);
+    now = tevent_timeval_current();
+    duration_us = (now.tv_sec - state->start.tv_sec) * 1000000
+                  + now.tv_usec - state->start.tv_usec;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "gpo_child request for [%s] finished in "
+          "%"PRIu64" us (new child: %s): [%d]: %s\n", state->gpo_guid,
+          duration_us, state->child_started ? "yes" : "no",
+          ret, sss_strerror(ret));
+    PROBE(GPO_CSE_RECV, state->gpo_guid, ret, duration_us,
+          state->child_started);
+
     if (ret != EOK) {
         tevent_req_error(req, ret);
         return;
     }
 
-    PIPE_FD_CLOSE(state->io->write_to_child_fd);
-
-    subreq = read_pipe_send(state, state->ev, state->io->read_from_child_fd);
-
-    if (subreq == NULL) {
-        tevent_req_error(req, ENOMEM);
-        return;
-    }
-    tevent_req_set_callback(subreq, gpo_cse_done, req);
+    tevent_req_done(req);
 }
 
-static void gpo_cse_done(struct tevent_req *subreq)
+static errno_t gpo_cse_process_response(struct ad_gpo_process_cse_state *state)
 {
-    struct tevent_req *req;
-    struct ad_gpo_process_cse_state *state;
     uint32_t sysvol_gpt_version = -1;
     uint32_t child_result;
     time_t now;
-
-    req = tevent_req_callback_data(subreq, struct tevent_req);
-    state = tevent_req_data(req, struct ad_gpo_process_cse_state);
-    int ret;
-
-    ret = read_pipe_recv(subreq, state, &state->buf, &state->len);
-    talloc_zfree(subreq);
-    if (ret != EOK) {
-        tevent_req_error(req, ret);
-        return;
-    }
-
-    PIPE_FD_CLOSE(state->io->read_from_child_fd);
+    errno_t ret;
 
     ret = ad_gpo_parse_gpo_child_response(state->buf, state->len,
                                           &sysvol_gpt_version, &child_result);
@@ -4362,14 +5092,12 @@ static void gpo_cse_done(struct tevent_req *subreq)
         DEBUG(SSSDBG_CRIT_FAILURE,
               "ad_gpo_parse_gpo_child_response failed: [%d][%s]\n",
               ret, sss_strerror(ret));
-        tevent_req_error(req, ret);
-        return;
+        return ret;
     } else if (child_result != 0){
         DEBUG(SSSDBG_CRIT_FAILURE,
               "Error in gpo_child: [%d][%s]\n",
               child_result, strerror(child_result));
-        tevent_req_error(req, child_result);
-        return;
+        return child_result;
     }
 
     now = time(NULL);
@@ -4379,84 +5107,35 @@ static void gpo_cse_done(struct tevent_req *subreq)
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "Unable to store gpo cache entry: [%d](%s}\n",
               ret, sss_strerror(ret));
-        tevent_req_error(req, ret);
-        return;
+        return ret;
     }
 
-    tevent_req_done(req);
-    return;
-}
-
-int ad_gpo_process_cse_recv(struct tevent_req *req)
-{
-    TEVENT_REQ_RETURN_ON_ERROR(req);
     return EOK;
 }
 
-static errno_t
-gpo_fork_child(struct tevent_req *req)
+static void gpo_cse_done(struct tevent_req *subreq)
 {
-    int pipefd_to_child[2] = PIPE_INIT;
-    int pipefd_from_child[2] = PIPE_INIT;
-    pid_t pid;
-    errno_t ret;
+    struct tevent_req *req;
     struct ad_gpo_process_cse_state *state;
+    errno_t ret;
 
+    req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct ad_gpo_process_cse_state);
 
-    ret = pipe(pipefd_from_child);
-    if (ret == -1) {
-        ret = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "pipe failed [%d][%s].\n", errno, strerror(errno));
-        goto fail;
-    }
-    ret = pipe(pipefd_to_child);
-    if (ret == -1) {
-        ret = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "pipe failed [%d][%s].\n", errno, strerror(errno));
-        goto fail;
+    ret = sss_child_pool_recv(subreq, state, &state->buf, &state->len,
+                              &state->child_started);
+    talloc_zfree(subreq);
+    if (ret == EOK) {
+        ret = gpo_cse_process_response(state);
     }
 
-    pid = fork();
-
-    if (pid == 0) { /* child */
-        exec_child_ex(state,
-                      pipefd_to_child, pipefd_from_child,
-                      GPO_CHILD, gpo_child_debug_fd, NULL, false,
-                      STDIN_FILENO, AD_GPO_CHILD_OUT_FILENO);
-
-        /* We should never get here */
-        DEBUG(SSSDBG_CRIT_FAILURE, "BUG: Could not exec gpo_child:\n");
-    } else if (pid > 0) { /* parent */
-        state->child_pid = pid;
-        state->io->read_from_child_fd = pipefd_from_child[0];
-        PIPE_FD_CLOSE(pipefd_from_child[1]);
-        state->io->write_to_child_fd = pipefd_to_child[1];
-        PIPE_FD_CLOSE(pipefd_to_child[0]);
-        sss_fd_nonblocking(state->io->read_from_child_fd);
-        sss_fd_nonblocking(state->io->write_to_child_fd);
-
-        ret = child_handler_setup(state->ev, pid, NULL, NULL, NULL);
-        if (ret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE,
-                  "Could not set up child signal handler\n");
-            goto fail;
-        }
-    } else { /* error */
-        ret = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "fork failed [%d][%s].\n", errno, strerror(errno));
-        goto fail;
-    }
+    gpo_cse_finish(req, ret);
+}
 
+int ad_gpo_process_cse_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
     return EOK;
-
-fail:
-    PIPE_CLOSE(pipefd_from_child);
-    PIPE_CLOSE(pipefd_to_child);
-    return ret;
 }
 
 struct ad_gpo_get_sd_referral_state {
@@ -592,6 +592,32 @@ copy_smb_file_to_gpo_cache(SMBCCTX *smbc_ctx,
 }
 
 
+static errno_t
+gpo_smbc_context_new(SMBCCTX **_smbc_ctx)
+{
+    SMBCCTX *smbc_ctx;
+
+    smbc_ctx = smbc_new_context();
+    if (smbc_ctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not allocate new smbc context\n");
+        return ENOMEM;
+    }
+
+    smbc_setOptionDebugToStderr(smbc_ctx, 1);
+    smbc_setFunctionAuthData(smbc_ctx, sssd_krb_get_auth_data_fn);
+    smbc_setOptionUseKerberos(smbc_ctx, 1);
+
+    /* Initialize the context using the previously specified options */
+    if (smbc_init_context(smbc_ctx) == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not initialize smbc context\n");
+        smbc_free_context(smbc_ctx, 0);
+        return ENOMEM;
+    }
+
+    *_smbc_ctx = smbc_ctx;
+    return EOK;
+}
+
 /*
  * Using its smb_uri components and cached_gpt_version inputs, this function
  * does several things:
@@ -614,35 +640,17 @@ copy_smb_file_to_gpo_cache(SMBCCTX *smbc_ctx,
  * - backend will read the policy file from the GPO_CACHE
  */
 static errno_t
-perform_smb_operations(int cached_gpt_version,
+perform_smb_operations(SMBCCTX *smbc_ctx,
+                       int cached_gpt_version,
                        const char *smb_server,
                        const char *smb_share,
                        const char *smb_path,
                        const char *smb_cse_suffix,
                        int *_sysvol_gpt_version)
 {
-    SMBCCTX *smbc_ctx;
     int ret;
     int sysvol_gpt_version;
 
-    smbc_ctx = smbc_new_context();
-    if (smbc_ctx == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Could not allocate new smbc context\n");
-        ret = ENOMEM;
-        goto done;
-    }
-
-    smbc_setOptionDebugToStderr(smbc_ctx, 1);
-    smbc_setFunctionAuthData(smbc_ctx, sssd_krb_get_auth_data_fn);
-    smbc_setOptionUseKerberos(smbc_ctx, 1);
-
-    /* Initialize the context using the previously specified options */
-    if (smbc_init_context(smbc_ctx) == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Could not initialize smbc context\n");
-        ret = ENOMEM;
-        goto done;
-    }
-
     /* download ini file */
     ret = copy_smb_file_to_gpo_cache(smbc_ctx, smb_server, smb_share, smb_path,
                                      GPT_INI);
@@ -677,7 +685,150 @@ perform_smb_operations(int cached_gpt_version,
     *_sysvol_gpt_version = sysvol_gpt_version;
 
  done:
-    smbc_free_context(smbc_ctx, 0);
+    return ret;
+}
+
+/*
+ * In persistent mode the child serves requests until its stdin is closed.
+ * Every request and response is prefixed with its length as uint32_t. The
+ * SMB context, and with it the connections and Kerberos sessions to the
+ * servers, is kept between the requests. It is only thrown away after a
+ * failed request in case one of the connections went bad.
+ */
+static errno_t
+read_request(int fd, uint8_t *buf, size_t buf_size, size_t *_len)
+{
+    uint32_t len;
+    ssize_t nread;
+
+    errno = 0;
+    nread = sss_atomic_read_s(fd, &len, sizeof(uint32_t));
+    if (nread == 0) {
+        return ENODATA;
+    } else if (nread == -1) {
+        return errno;
+    } else if (nread != sizeof(uint32_t)) {
+        return EIO;
+    }
+
+    if (len > buf_size) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Request too large [%u]\n", len);
+        return EINVAL;
+    }
+
+    errno = 0;
+    nread = sss_atomic_read_s(fd, buf, len);
+    if (nread == -1) {
+        return errno;
+    } else if (nread != (ssize_t) len) {
+        return EIO;
+    }
+
+    *_len = len;
+    return EOK;
+}
+
+static errno_t
+write_response(int fd, struct response *resp)
+{
+    uint32_t len = resp->size;
+    ssize_t written;
+
+    errno = 0;
+    written = sss_atomic_write_s(fd, &len, sizeof(uint32_t));
+    if (written == -1) {
+        return errno;
+    } else if (written != sizeof(uint32_t)) {
+        return EIO;
+    }
+
+    errno = 0;
+    written = sss_atomic_write_s(fd, resp->buf, resp->size);
+    if (written == -1) {
+        return errno;
+    } else if (written != resp->size) {
+        return EIO;
+    }
+
+    return EOK;
+}
+
+static errno_t
+serve_requests(TALLOC_CTX *mem_ctx, uint8_t *buf)
+{
+    SMBCCTX *smbc_ctx = NULL;
+    TALLOC_CTX *tmp_ctx;
+    struct input_buffer *ibuf;
+    struct response *resp;
+    int sysvol_gpt_version;
+    size_t len;
+    int result;
+    errno_t ret;
+
+    while (true) {
+        ret = read_request(STDIN_FILENO, buf, IN_BUF_SIZE, &len);
+        if (ret == ENODATA) {
+            DEBUG(SSSDBG_TRACE_FUNC, "stdin closed, exiting\n");
+            ret = EOK;
+            break;
+        } else if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "read_request failed [%d][%s].\n", ret, strerror(ret));
+            break;
+        }
+
+        tmp_ctx = talloc_new(mem_ctx);
+        if (tmp_ctx == NULL) {
+            ret = ENOMEM;
+            break;
+        }
+
+        sysvol_gpt_version = -1;
+        ibuf = talloc_zero(tmp_ctx, struct input_buffer);
+        if (ibuf == NULL) {
+            result = ENOMEM;
+        } else {
+            result = unpack_buffer(buf, len, ibuf);
+        }
+
+        if (result == EOK && smbc_ctx == NULL) {
+            result = gpo_smbc_context_new(&smbc_ctx);
+        }
+
+        if (result == EOK) {
+            DEBUG(SSSDBG_TRACE_FUNC, "performing smb operations\n");
+            result = perform_smb_operations(smbc_ctx,
+                                            ibuf->cached_gpt_version,
+                                            ibuf->smb_server,
+                                            ibuf->smb_share,
+                                            ibuf->smb_path,
+                                            ibuf->smb_cse_suffix,
+                                            &sysvol_gpt_version);
+            if (result != EOK) {
+                DEBUG(SSSDBG_CRIT_FAILURE,
+                      "perform_smb_operations failed.[%d][%s].\n",
+                      result, strerror(result));
+                smbc_free_context(smbc_ctx, 1);
+                smbc_ctx = NULL;
+            }
+        }
+
+        ret = prepare_response(tmp_ctx, sysvol_gpt_version, result, &resp);
+        if (ret == EOK) {
+            ret = write_response(AD_GPO_CHILD_OUT_FILENO, resp);
+        }
+        talloc_free(tmp_ctx);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Cannot send response [%d][%s].\n", ret, strerror(ret));
+            break;
+        }
+    }
+
+    if (smbc_ctx != NULL) {
+        smbc_free_context(smbc_ctx, 1);
+    }
+
     return ret;
 }
 
@@ -691,6 +842,8 @@ main(int argc, const char *argv[])
     errno_t ret;
     int sysvol_gpt_version;
     int result;
+    int persistent = 0;
+    SMBCCTX *smbc_ctx = NULL;
     TALLOC_CTX *main_ctx = NULL;
     uint8_t *buf = NULL;
     ssize_t len = 0;
@@ -711,6 +864,8 @@ main(int argc, const char *argv[])
         {"debug-to-stderr", 0, POPT_ARG_NONE | POPT_ARGFLAG_DOC_HIDDEN,
          &debug_to_stderr, 0,
          _("Send the debug output to stderr directly."), NULL },
+        {"persistent", 0, POPT_ARG_NONE, &persistent, 0,
+         _("Serve requests until stdin is closed"), NULL},
         SSSD_LOGGER_OPTS
         POPT_TABLEEND
     };
@@ -773,6 +928,18 @@ main(int argc, const char *argv[])
 
     DEBUG(SSSDBG_TRACE_FUNC, "context initialized\n");
 
+    if (persistent) {
+        ret = serve_requests(main_ctx, buf);
+        if (ret != EOK) {
+            goto fail;
+        }
+
+        DEBUG(SSSDBG_TRACE_FUNC, "gpo_child completed successfully\n");
+        close(AD_GPO_CHILD_OUT_FILENO);
+        talloc_free(main_ctx);
+        return EXIT_SUCCESS;
+    }
+
     errno = 0;
     len = sss_atomic_read_s(STDIN_FILENO, buf, IN_BUF_SIZE);
     if (len == -1) {
@@ -792,12 +959,19 @@ main(int argc, const char *argv[])
 
     DEBUG(SSSDBG_TRACE_FUNC, "performing smb operations\n");
 
-    result = perform_smb_operations(ibuf->cached_gpt_version,
+    result = gpo_smbc_context_new(&smbc_ctx);
+    if (result != EOK) {
+        goto fail;
+    }
+
+    result = perform_smb_operations(smbc_ctx,
+                                    ibuf->cached_gpt_version,
                                     ibuf->smb_server,
                                     ibuf->smb_share,
                                     ibuf->smb_path,
                                     ibuf->smb_cse_suffix,
                                     &sysvol_gpt_version);
+    smbc_free_context(smbc_ctx, 0);
     if (result != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "perform_smb_operations failed.[%d][%s].\n",
@@ -25,6 +25,7 @@
 #include "providers/ad/ad_id.h"
 #include "providers/ad/ad_domain_info.h"
 #include "providers/ad/ad_pac.h"
+#include "providers/ad/ad_dirsync.h"
 #include "providers/ldap/sdap_async_enum.h"
 #include "providers/ldap/sdap_idmap.h"
 #include "providers/ldap/sdap_async.h"
@@ -210,6 +211,7 @@ ad_handle_acct_info_step(struct tevent_req *req)
                                                state->sdom,
                                                state->conn[state->cindex],
                                                noexist_delete,
+                                               state->ad_options,
                                                msg);
             if (subreq == NULL) {
                 DEBUG(SSSDBG_OP_FAILURE, "ad_handle_pac_initgr_send failed.\n");
@@ -569,6 +571,7 @@ struct ad_enumeration_state {
     const char *realm;
     struct sdap_domain *sdom;
     struct sdap_domain *sditer;
+    bool dirsync;
 };
 
 static void ad_enumeration_conn_done(struct tevent_req *subreq);
@@ -731,6 +734,19 @@ ad_enum_sdom(struct tevent_req *req,
         user_conn = id_ctx->ldap_ctx;
     }
 
+    state->dirsync = dp_opt_get_bool(id_ctx->ad_options->basic,
+                                     AD_ENUM_USE_DIRSYNC);
+    if (state->dirsync) {
+        subreq = ad_dirsync_enum_send(state, state->ev, id_ctx, sd, user_conn);
+        if (subreq == NULL) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "Failed to schedule enumeration, retrying later!\n");
+            return ENOMEM;
+        }
+        tevent_req_set_callback(subreq, ad_enumeration_done, req);
+        return EOK;
+    }
+
     /* Groups are searched for in LDAP, users in GC. Services (if present,
      * which is unlikely in AD) from LDAP as well
      */
@@ -764,7 +780,11 @@ ad_enumeration_done(struct tevent_req *subreq)
     struct ad_enumeration_state *state = tevent_req_data(req,
                                                 struct ad_enumeration_state);
 
-    ret = sdap_dom_enum_ex_recv(subreq);
+    if (state->dirsync) {
+        ret = ad_dirsync_enum_recv(subreq);
+    } else {
+        ret = sdap_dom_enum_ex_recv(subreq);
+    }
     talloc_zfree(subreq);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE,
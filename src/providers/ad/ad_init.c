@@ -259,6 +259,10 @@ static errno_t ad_init_sdap_access_ctx(struct ad_access_ctx *access_ctx)
 }
 
 errno_t ad_gpo_parse_map_options(struct ad_access_ctx *access_ctx);
+errno_t ad_gpo_decision_cache_init(struct be_ctx *be_ctx,
+                                   struct ad_access_ctx *access_ctx);
+errno_t ad_gpo_child_pool_init(struct be_ctx *be_ctx,
+                               struct ad_access_ctx *access_ctx);
 
 static errno_t ad_init_gpo(struct ad_access_ctx *access_ctx)
 {
@@ -606,6 +610,20 @@ errno_t sssm_ad_access_init(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
+    ret = ad_gpo_decision_cache_init(be_ctx, access_ctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not initialize GPO decision "
+              "cache [%d]: %s\n", ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = ad_gpo_child_pool_init(be_ctx, access_ctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not initialize gpo_child "
+              "pool [%d]: %s\n", ret, sss_strerror(ret));
+        goto done;
+    }
+
     dp_set_method(dp_methods, DPM_ACCESS_HANDLER,
                   ad_pam_access_handler_send, ad_pam_access_handler_recv, access_ctx,
                   struct ad_access_ctx, struct pam_data, struct pam_data *);
@@ -53,6 +53,10 @@ struct dp_option ad_basic_opts[] = {
     { "krb5_confd_path", DP_OPT_STRING, { KRB5_MAPPING_DIR }, NULL_STRING },
     { "ad_maximum_machine_account_password_age", DP_OPT_NUMBER, { .number = 30 }, NULL_NUMBER },
     { "ad_machine_account_password_renewal_opts", DP_OPT_STRING, { "86400:750" }, NULL_STRING },
+    { "ad_enumeration_use_dirsync", DP_OPT_BOOL, BOOL_FALSE, BOOL_FALSE },
+    { "ad_gpo_decision_cache_timeout", DP_OPT_NUMBER, NULL_NUMBER, NULL_NUMBER },
+    { "ad_gpo_child_idle_timeout", DP_OPT_NUMBER, { .number = 300 }, NULL_NUMBER },
+    { "ad_pac_authoritative", DP_OPT_BOOL, BOOL_FALSE, BOOL_FALSE },
     DP_OPTION_TERMINATOR
 };
 
@@ -151,6 +155,12 @@ struct dp_option ad_def_ldap_opts[] = {
     { "ldap_max_id", DP_OPT_NUMBER, NULL_NUMBER, NULL_NUMBER},
     { "ldap_pwdlockout_dn", DP_OPT_STRING, NULL_STRING, NULL_STRING },
     { "wildcard_limit", DP_OPT_NUMBER, { .number = 1000 }, NULL_NUMBER},
+    { "ldap_enumeration_resumable", DP_OPT_BOOL, BOOL_FALSE, BOOL_FALSE },
+    { "ldap_enumeration_chunk_delay", DP_OPT_NUMBER, { .number = 1 }, NULL_NUMBER },
+    { "ldap_page_size_adaptive", DP_OPT_BOOL, BOOL_FALSE, BOOL_FALSE },
+    { "ldap_rootdse_cache_timeout", DP_OPT_NUMBER, { .number = 0 }, NULL_NUMBER },
+    { "ldap_connection_race_servers", DP_OPT_NUMBER, { .number = 1 }, NULL_NUMBER },
+    { "ldap_connection_race_delay", DP_OPT_NUMBER, { .number = 250 }, NULL_NUMBER },
     DP_OPTION_TERMINATOR
 };
 
@@ -176,6 +186,8 @@ struct dp_option ad_def_krb5_opts[] = {
     { "krb5_use_kdcinfo", DP_OPT_BOOL, BOOL_TRUE, BOOL_TRUE },
     { "krb5_kdcinfo_lookahead", DP_OPT_STRING, NULL_STRING, NULL_STRING },
     { "krb5_map_user", DP_OPT_STRING, NULL_STRING, NULL_STRING },
+    { "krb5_child_pool_size", DP_OPT_NUMBER, NULL_NUMBER, NULL_NUMBER },
+    { "krb5_child_pool_max", DP_OPT_NUMBER, NULL_NUMBER, NULL_NUMBER },
     DP_OPTION_TERMINATOR
 };
 
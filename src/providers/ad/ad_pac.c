@@ -26,6 +26,7 @@
 #include "providers/ad/ad_id.h"
 #include "providers/ldap/sdap_idmap.h"
 #include "providers/ldap/sdap_async_ad.h"
+#include "providers/ldap/sdap_async_private.h"
 
 static errno_t find_user_entry(TALLOC_CTX *mem_ctx, struct sss_domain_info *dom,
                                struct dp_id_data *ar,
@@ -537,6 +538,7 @@ struct tevent_req *ad_handle_pac_initgr_send(TALLOC_CTX *mem_ctx,
                                              struct sdap_domain *sdom,
                                              struct sdap_id_conn_ctx *conn,
                                              bool noexist_delete,
+                                             struct ad_options *ad_options,
                                              struct ldb_message *msg)
 {
     int ret;
@@ -628,6 +630,41 @@ struct tevent_req *ad_handle_pac_initgr_send(TALLOC_CTX *mem_ctx,
             goto done;
         }
 
+        if (dp_opt_get_bool(ad_options->basic, AD_PAC_AUTHORITATIVE)
+                && state->num_missing_sids > 0) {
+            /* The PAC is verified and recent, so it is trusted as the
+             * complete list of groups. The memberships of the groups
+             * which are already cached are stored right away and the
+             * request finishes without waiting for LDAP, the unknown SIDs
+             * are resolved afterwards. */
+            ret = sdap_ad_tokengroups_update_members(state->username,
+                                                     sdom->dom->sysdb,
+                                                     sdom->dom,
+                                                     state->cached_groups);
+            if (ret != EOK) {
+                DEBUG(SSSDBG_OP_FAILURE,
+                      "Membership update failed [%d]: %s\n",
+                      ret, sss_strerror(ret));
+                goto done;
+            }
+
+            ret = ad_pac_resolve_sids_background(ad_options, id_ctx,
+                                                 be_ctx->ev, conn,
+                                                 sdom->dom, state->username,
+                                                 state->missing_sids,
+                                                 state->cached_groups);
+            if (ret != EOK) {
+                /* The next lookup of the user will try again */
+                DEBUG(SSSDBG_MINOR_FAILURE,
+                      "Cannot resolve %zu SIDs of [%s] in the background "
+                      "[%d]: %s\n", state->num_missing_sids, state->username,
+                      ret, sss_strerror(ret));
+                ret = EOK;
+            }
+
+            goto done;
+        }
+
         /* download missing SIDs */
         subreq = sdap_ad_resolve_sids_send(state, be_ctx->ev, id_ctx,
                                            conn,
@@ -719,6 +756,272 @@ done:
     tevent_req_done(req);
 }
 
+/* Resolution of the SIDs from a PAC which are not cached yet, running after
+ * the initgroups request finished. Once the groups are known the memberships
+ * of the user are updated with a single write.
+ *
+ * Only one resolution per user runs at a time. The running resolutions are
+ * listed in ad_options so that they are freed together with the connections
+ * they use. */
+struct ad_pac_resolve_sids_ctx {
+    struct ad_pac_resolve_sids_ctx *prev;
+    struct ad_pac_resolve_sids_ctx *next;
+    struct ad_options *ad_options;
+
+    struct sss_domain_info *dom;
+    char *username;
+    char **missing_sids;
+    size_t num_missing_sids;
+    char **cached_groups;
+    /* Groups of the user when the resolution started */
+    char **start_groups;
+};
+
+static errno_t ad_pac_string_lists_differ(char **list1, char **list2,
+                                          bool *_differ)
+{
+    TALLOC_CTX *tmp_ctx;
+    char **list1_only;
+    char **list2_only;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = diff_string_lists(tmp_ctx, list1, list2,
+                            &list1_only, &list2_only, NULL);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    *_differ = (list1_only[0] != NULL || list2_only[0] != NULL);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static struct ad_pac_resolve_sids_ctx *
+ad_pac_resolve_sids_find(struct ad_options *ad_options,
+                         struct sss_domain_info *dom,
+                         const char *username)
+{
+    struct ad_pac_resolve_sids_ctx *bg_ctx;
+
+    DLIST_FOR_EACH(bg_ctx, ad_options->pac_resolve_sids) {
+        if (bg_ctx->dom == dom && strcmp(bg_ctx->username, username) == 0) {
+            return bg_ctx;
+        }
+    }
+
+    return NULL;
+}
+
+static int ad_pac_resolve_sids_destructor(struct ad_pac_resolve_sids_ctx *bg_ctx)
+{
+    DLIST_REMOVE(bg_ctx->ad_options->pac_resolve_sids, bg_ctx);
+    return 0;
+}
+
+static void ad_pac_resolve_sids_background_done(struct tevent_req *subreq);
+
+errno_t ad_pac_resolve_sids_background(struct ad_options *ad_options,
+                                       struct sdap_id_ctx *id_ctx,
+                                       struct tevent_context *ev,
+                                       struct sdap_id_conn_ctx *conn,
+                                       struct sss_domain_info *dom,
+                                       const char *username,
+                                       char **missing_sids,
+                                       char **cached_groups)
+{
+    struct ad_pac_resolve_sids_ctx *bg_ctx;
+    struct tevent_req *subreq;
+    bool sids_differ;
+    bool groups_differ;
+    errno_t ret;
+
+    bg_ctx = ad_pac_resolve_sids_find(ad_options, dom, username);
+    if (bg_ctx != NULL) {
+        ret = ad_pac_string_lists_differ(bg_ctx->missing_sids, missing_sids,
+                                         &sids_differ);
+        if (ret != EOK) {
+            return ret;
+        }
+
+        ret = ad_pac_string_lists_differ(bg_ctx->cached_groups, cached_groups,
+                                         &groups_differ);
+        if (ret != EOK) {
+            return ret;
+        }
+
+        if (!sids_differ && !groups_differ) {
+            DEBUG(SSSDBG_TRACE_FUNC,
+                  "The SIDs of [%s] are already being resolved.\n", username);
+            return EOK;
+        }
+
+        /* The running resolution was started for an older PAC, its result
+         * would overwrite the memberships which were just stored. */
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Restarting the resolution of the SIDs of [%s] for a newer "
+              "PAC.\n", username);
+        talloc_free(bg_ctx);
+    }
+
+    bg_ctx = talloc_zero(ad_options, struct ad_pac_resolve_sids_ctx);
+    if (bg_ctx == NULL) {
+        return ENOMEM;
+    }
+    bg_ctx->ad_options = ad_options;
+    bg_ctx->dom = dom;
+
+    bg_ctx->username = talloc_strdup(bg_ctx, username);
+    if (bg_ctx->username == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    bg_ctx->missing_sids = discard_const(dup_string_list(bg_ctx,
+                                            (const char **) missing_sids));
+    bg_ctx->cached_groups = discard_const(dup_string_list(bg_ctx,
+                                            (const char **) cached_groups));
+    if (bg_ctx->missing_sids == NULL || bg_ctx->cached_groups == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (bg_ctx->num_missing_sids = 0;
+         bg_ctx->missing_sids[bg_ctx->num_missing_sids] != NULL;
+         bg_ctx->num_missing_sids++);
+
+    ret = get_sysdb_grouplist_dn(bg_ctx, dom->sysdb, dom, username,
+                                 &bg_ctx->start_groups);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    subreq = sdap_ad_resolve_sids_send(bg_ctx, ev, id_ctx, conn, id_ctx->opts,
+                                       dom, bg_ctx->missing_sids);
+    if (subreq == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    tevent_req_set_callback(subreq, ad_pac_resolve_sids_background_done,
+                            bg_ctx);
+
+    DLIST_ADD(ad_options->pac_resolve_sids, bg_ctx);
+    talloc_set_destructor(bg_ctx, ad_pac_resolve_sids_destructor);
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Resolving %zu SIDs of [%s] in the background.\n",
+          bg_ctx->num_missing_sids, username);
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(bg_ctx);
+    }
+
+    return ret;
+}
+
+static void ad_pac_resolve_sids_background_done(struct tevent_req *subreq)
+{
+    struct ad_pac_resolve_sids_ctx *bg_ctx;
+    char **cached_groups;
+    size_t num_cached_groups;
+    size_t num_groups;
+    char **current_groups;
+    bool groups_differ;
+    errno_t ret;
+
+    bg_ctx = tevent_req_callback_data(subreq, struct ad_pac_resolve_sids_ctx);
+
+    ret = sdap_ad_resolve_sids_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to resolve the missing SIDs of [%s] [%d]: %s\n",
+              bg_ctx->username, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = sdap_ad_tokengroups_get_posix_members(bg_ctx, bg_ctx->dom,
+                                                bg_ctx->num_missing_sids,
+                                                bg_ctx->missing_sids,
+                                                NULL, NULL,
+                                                &num_cached_groups,
+                                                &cached_groups);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "sdap_ad_tokengroups_get_posix_members failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    if (num_cached_groups == 0) {
+        goto done;
+    }
+
+    /* Another lookup may have stored the groups of the user in the meantime,
+     * the groups from the PAC must not replace a newer result. */
+    ret = get_sysdb_grouplist_dn(bg_ctx, bg_ctx->dom->sysdb, bg_ctx->dom,
+                                 bg_ctx->username, &current_groups);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Cannot read the groups of [%s] [%d]: %s\n",
+              bg_ctx->username, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = ad_pac_string_lists_differ(bg_ctx->start_groups, current_groups,
+                                     &groups_differ);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (groups_differ) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "The groups of [%s] changed while the SIDs were resolved, "
+              "not updating them.\n", bg_ctx->username);
+        goto done;
+    }
+
+    for (num_groups = 0; bg_ctx->cached_groups[num_groups] != NULL;
+         num_groups++);
+
+    bg_ctx->cached_groups = concatenate_string_array(bg_ctx,
+                                                     bg_ctx->cached_groups,
+                                                     num_groups,
+                                                     cached_groups,
+                                                     num_cached_groups);
+    if (bg_ctx->cached_groups == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sdap_ad_tokengroups_update_members(bg_ctx->username,
+                                             bg_ctx->dom->sysdb,
+                                             bg_ctx->dom,
+                                             bg_ctx->cached_groups);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Membership update failed [%d]: %s\n",
+                                     ret, sss_strerror(ret));
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Added [%s] to %zu groups resolved in the background.\n",
+          bg_ctx->username, num_cached_groups);
+
+done:
+    talloc_free(bg_ctx);
+}
+
 errno_t ad_handle_pac_initgr_recv(struct tevent_req *req,
                                   int *_dp_error, const char **_err,
                                   int *sdap_ret)
@@ -40,6 +40,8 @@
 #include "util/util.h"
 #include "providers/ldap/ldap_common.h"
 
+struct ad_options;
+
 errno_t check_if_pac_is_available(TALLOC_CTX *mem_ctx,
                                   struct sss_domain_info *dom,
                                   struct dp_id_data *ar,
@@ -73,10 +75,24 @@ struct tevent_req *ad_handle_pac_initgr_send(TALLOC_CTX *mem_ctx,
                                              struct sdap_domain *sdom,
                                              struct sdap_id_conn_ctx *conn,
                                              bool noexist_delete,
+                                             struct ad_options *ad_options,
                                              struct ldb_message *msg);
 
 errno_t ad_handle_pac_initgr_recv(struct tevent_req *req,
                                   int *_dp_error, const char **_err,
                                   int *sdap_ret);
 
+/* Resolves the SIDs from a PAC which are not cached yet after the initgroups
+ * request finished and adds the user to the groups. A resolution which is
+ * already running for the same user is kept if the PAC did not change and
+ * restarted otherwise. Exported for unit tests. */
+errno_t ad_pac_resolve_sids_background(struct ad_options *ad_options,
+                                       struct sdap_id_ctx *id_ctx,
+                                       struct tevent_context *ev,
+                                       struct sdap_id_conn_ctx *conn,
+                                       struct sss_domain_info *dom,
+                                       const char *username,
+                                       char **missing_sids,
+                                       char **cached_groups);
+
 #endif /* AD_PAC_H_ */
@@ -60,6 +60,9 @@ struct be_svc_data {
 
     struct be_svc_callback *callbacks;
     struct fo_server *first_resolved;
+
+    /* Port health checks use for servers added without a port */
+    int default_port;
 };
 
 struct be_failover_ctx {
@@ -166,6 +169,15 @@ int be_fo_service_add_callback(TALLOC_CTX *memctx,
                                be_svc_callback_fn_t *fn, void *private_data);
 int be_fo_get_server_count(struct be_ctx *ctx, const char *service_name);
 
+/* Sets the port the servers of the service listen on when they were added
+ * without a port, so that the background health checks can reach them */
+int be_fo_set_default_port(struct be_ctx *ctx, const char *service_name,
+                           int port);
+
+/* Declares that the connection code of the service feeds the round trip
+ * time of successful requests, so its servers can be ordered by score */
+int be_fo_set_reports_rtt(struct be_ctx *ctx, const char *service_name);
+
 void be_fo_set_srv_lookup_plugin(struct be_ctx *ctx,
                                  fo_srv_lookup_plugin_send_t send_fn,
                                  fo_srv_lookup_plugin_recv_t recv_fn,
@@ -194,6 +206,42 @@ int be_resolve_server_recv(struct tevent_req *req,
                            TALLOC_CTX *ref_ctx,
                            struct fo_server **srv);
 
+/*
+ * Get up to 'max' servers to connect to in parallel, starting with 'first'
+ * which was returned by be_resolve_server_send(). The addresses of the other
+ * servers may not be resolved yet, use be_resolve_candidate_send() for that.
+ */
+errno_t be_fo_get_candidate_servers(TALLOC_CTX *mem_ctx,
+                                    struct be_ctx *ctx,
+                                    const char *service_name,
+                                    struct fo_server *first,
+                                    size_t max,
+                                    struct fo_server ***_servers,
+                                    size_t *_count);
+
+struct tevent_req *be_resolve_candidate_send(TALLOC_CTX *memctx,
+                                             struct tevent_context *ev,
+                                             struct be_ctx *ctx,
+                                             struct fo_server *srv);
+int be_resolve_candidate_recv(struct tevent_req *req);
+
+/*
+ * Run the service callbacks for 'srv' if it is not the server they were
+ * run for last time, so they can update e.g. the URI of the service.
+ */
+errno_t be_fo_run_server_callbacks(struct be_ctx *ctx,
+                                   const char *service_name,
+                                   struct fo_server *srv);
+
+/*
+ * Make 'srv' the current server of the service as if it was returned by
+ * be_resolve_server_send(): run the service callbacks and schedule the
+ * lookup of a primary server if 'srv' is a backup one.
+ */
+errno_t be_fo_use_server(struct be_ctx *ctx,
+                         const char *service_name,
+                         struct fo_server *srv);
+
 #define be_fo_set_port_status(ctx, service_name, server, status) \
     _be_fo_set_port_status(ctx, service_name, server, status, \
                            __LINE__, __FILE__, __FUNCTION__)
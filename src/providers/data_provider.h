@@ -267,6 +267,9 @@ enum dp_res_opts {
     DP_RES_OPT_RESOLVER_OP_TIMEOUT,
     DP_RES_OPT_RESOLVER_SERVER_TIMEOUT,
     DP_RES_OPT_DNS_DOMAIN,
+    DP_RES_OPT_FAILOVER_LATENCY_AWARE,
+    DP_RES_OPT_FAILOVER_PROBE_INTERVAL,
+    DP_RES_OPT_FAILOVER_HEALTH_CHECK_INTERVAL,
 
     DP_RES_OPTS /* attrs counter */
 };
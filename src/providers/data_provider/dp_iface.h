@@ -34,7 +34,8 @@ dp_get_account_info_send(TALLOC_CTX *mem_ctx,
                          uint32_t entry_type,
                          const char *filter,
                          const char *domain,
-                         const char *extra);
+                         const char *extra,
+                         const char *trace_id);
 
 errno_t
 dp_get_account_info_recv(TALLOC_CTX *mem_ctx,
@@ -208,6 +209,16 @@ dp_failover_list_servers(TALLOC_CTX *mem_ctx,
                          const char *service_name,
                          const char ***_servers);
 
+errno_t
+dp_failover_list_server_scores(TALLOC_CTX *mem_ctx,
+                               struct sbus_request *sbus_req,
+                               struct be_ctx *be_ctx,
+                               const char *service_name,
+                               const char ***_servers,
+                               uint32_t **_rtt_usec,
+                               uint32_t **_error_permille,
+                               uint32_t **_samples);
+
 /* sssd.DataProvider.AccessControl */
 struct tevent_req *
 dp_access_control_refresh_rules_send(TALLOC_CTX *mem_ctx,
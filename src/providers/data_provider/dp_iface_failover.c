@@ -326,3 +326,64 @@ dp_failover_list_servers(TALLOC_CTX *mem_ctx,
 
     return EOK;
 }
+
+errno_t
+dp_failover_list_server_scores(TALLOC_CTX *mem_ctx,
+                               struct sbus_request *sbus_req,
+                               struct be_ctx *be_ctx,
+                               const char *service_name,
+                               const char ***_servers,
+                               uint32_t **_rtt_usec,
+                               uint32_t **_error_permille,
+                               uint32_t **_samples)
+{
+    struct fo_server_score *scores;
+    struct be_svc_data *svc;
+    const char **servers;
+    uint32_t *rtt_usec;
+    uint32_t *error_permille;
+    uint32_t *samples;
+    bool found = false;
+    size_t count;
+    size_t i;
+
+    DLIST_FOR_EACH(svc, be_ctx->be_fo->svcs) {
+        if (strcmp(svc->name, service_name) == 0) {
+            found = true;
+            break;
+        }
+    }
+
+    if (!found) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to get server scores\n");
+        return ENOENT;
+    }
+
+    scores = fo_svc_server_scores(sbus_req, svc->fo_service, &count);
+    if (scores == NULL) {
+        return ENOMEM;
+    }
+
+    servers = talloc_zero_array(sbus_req, const char *, count + 1);
+    rtt_usec = talloc_array(sbus_req, uint32_t, count);
+    error_permille = talloc_array(sbus_req, uint32_t, count);
+    samples = talloc_array(sbus_req, uint32_t, count);
+    if (servers == NULL || rtt_usec == NULL
+            || error_permille == NULL || samples == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < count; i++) {
+        servers[i] = scores[i].name;
+        rtt_usec[i] = scores[i].rtt_usec;
+        error_permille[i] = scores[i].error_permille;
+        samples[i] = scores[i].samples;
+    }
+
+    *_servers = servers;
+    *_rtt_usec = rtt_usec;
+    *_error_permille = error_permille;
+    *_samples = samples;
+
+    return EOK;
+}
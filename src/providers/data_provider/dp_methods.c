@@ -126,3 +126,41 @@ errno_t dp_find_method(struct data_provider *provider,
 
     return EOK;
 }
+
+const char *dp_method_to_string(enum dp_methods method)
+{
+    switch (method) {
+    case DPM_CHECK_ONLINE:
+        return "check_online";
+    case DPM_ACCOUNT_HANDLER:
+        return "account";
+    case DPM_AUTH_HANDLER:
+        return "auth";
+    case DPM_ACCESS_HANDLER:
+        return "access";
+    case DPM_SELINUX_HANDLER:
+        return "selinux";
+    case DPM_SUDO_HANDLER:
+        return "sudo";
+    case DPM_HOSTID_HANDLER:
+        return "hostid";
+    case DPM_DOMAINS_HANDLER:
+        return "domains";
+    case DPM_SESSION_HANDLER:
+        return "session";
+    case DPM_ACCT_DOMAIN_HANDLER:
+        return "acct_domain";
+    case DPM_REFRESH_ACCESS_RULES:
+        return "refresh_access_rules";
+    case DPM_AUTOFS_GET_MAP:
+        return "autofs_get_map";
+    case DPM_AUTOFS_GET_ENTRY:
+        return "autofs_get_entry";
+    case DPM_AUTOFS_ENUMERATE:
+        return "autofs_enumerate";
+    case DP_METHOD_SENTINEL:
+        return NULL;
+    }
+
+    return NULL;
+}
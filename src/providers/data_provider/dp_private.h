@@ -71,6 +71,9 @@ struct dp_method {
     const char *request_dtype;
     const char *output_dtype;
     uint32_t output_size;
+
+    /* Latency of the requests, created on first use. */
+    struct sss_metric *latency;
 };
 
 struct data_provider {
@@ -111,6 +114,8 @@ errno_t dp_init_modules(TALLOC_CTX *mem_ctx, struct dp_module ***_modules);
 
 const char *dp_target_to_string(enum dp_targets target);
 
+const char *dp_method_to_string(enum dp_methods method);
+
 bool dp_target_initialized(struct dp_target **targets, enum dp_targets type);
 
 errno_t dp_init_targets(TALLOC_CTX *mem_ctx,
@@ -27,6 +27,8 @@
 #include "util/dlinklist.h"
 #include "util/util.h"
 #include "util/probes.h"
+#include "util/sss_trace.h"
+#include "util/sss_metrics.h"
 
 struct dp_req {
     struct data_provider *provider;
@@ -44,6 +46,10 @@ struct dp_req {
     struct tevent_req *handler_req;
     void *request_data;
 
+    /* The handler request is allocated under the trace. */
+    struct sss_trace *trace;
+    struct timeval start;
+
     /* Active request list. */
     struct dp_req *prev;
     struct dp_req *next;
@@ -139,6 +145,7 @@ dp_req_new(TALLOC_CTX *mem_ctx,
            struct tevent_req *req,
            struct dp_req **_dp_req)
 {
+    struct sss_trace *parent;
     struct dp_req *dp_req;
     struct be_ctx *be_ctx;
     errno_t ret;
@@ -157,6 +164,7 @@ dp_req_new(TALLOC_CTX *mem_ctx,
     dp_req->method = method;
     dp_req->request_data = request_data;
     dp_req->req = req;
+    dp_req->start = tevent_timeval_current();
 
     ret = dp_attach_req(dp_req, provider, name, dp_flags);
     if (ret != EOK) {
@@ -166,6 +174,20 @@ dp_req_new(TALLOC_CTX *mem_ctx,
         return ret;
     }
 
+    /* Requests sent by a responder continue its trace so the records
+     * can be matched, the others are traced on their own. */
+    parent = sss_trace_find(mem_ctx);
+    if (parent != NULL) {
+        dp_req->trace = sss_trace_new(dp_req, "%s", sss_trace_id(parent));
+    } else {
+        dp_req->trace = sss_trace_new(dp_req, "be:%d:%u",
+                                      getpid(), dp_req->num);
+    }
+    if (dp_req->trace == NULL) {
+        talloc_free(dp_req);
+        return ENOMEM;
+    }
+
     /* Now the request is created. We will return it even in case of error
      * so we can get better debug messages. */
 
@@ -247,7 +269,8 @@ file_dp_request(TALLOC_CTX *mem_ctx,
     dp_params->method = dp_req->method;
 
     send_fn = dp_req->execute->send_fn;
-    dp_req->handler_req = send_fn(dp_req, dp_req->execute->method_data,
+    dp_req->handler_req = send_fn(dp_req->trace,
+                                  dp_req->execute->method_data,
                                   dp_req->request_data, dp_params);
     if (dp_req->handler_req == NULL) {
         ret = ENOMEM;
@@ -344,6 +367,23 @@ immediately:
     return req;
 }
 
+static void dp_req_observe_latency(struct dp_req *dp_req)
+{
+    struct dp_method *execute = dp_req->execute;
+
+    if (execute == NULL) {
+        return;
+    }
+
+    if (execute->latency == NULL) {
+        execute->latency = sss_metric_histogram("dp_req.%s.%s.latency",
+                                    dp_target_to_string(dp_req->target),
+                                    dp_method_to_string(dp_req->method));
+    }
+
+    sss_metric_observe_since(execute->latency, &dp_req->start);
+}
+
 static void dp_req_done(struct tevent_req *subreq)
 {
     struct dp_req_state *state;
@@ -362,6 +402,11 @@ static void dp_req_done(struct tevent_req *subreq)
     PROBE(DP_REQ_DONE, state->dp_req->name, state->dp_req->target,
           state->dp_req->method, ret, sss_strerror(ret));
 
+    sss_trace_report(state->dp_req->trace, state->dp_req->name,
+                     state->dp_req->domain->name, ret);
+
+    dp_req_observe_latency(state->dp_req);
+
     DP_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->dp_req->name,
                  "Request handler finished [%d]: %s", ret, sss_strerror(ret));
 
@@ -27,6 +27,7 @@
 #include "providers/data_provider/dp_iface.h"
 #include "providers/backend.h"
 #include "util/util.h"
+#include "util/sss_trace.h"
 
 #define FILTER_TYPE(str, type) {str "=", sizeof(str "=") - 1, type}
 
@@ -432,11 +433,13 @@ dp_get_account_info_send(TALLOC_CTX *mem_ctx,
                          uint32_t entry_type,
                          const char *filter,
                          const char *domain,
-                         const char *extra)
+                         const char *extra,
+                         const char *trace_id)
 {
     struct dp_get_account_info_state *state;
     struct tevent_req *subreq;
     struct tevent_req *req;
+    TALLOC_CTX *dp_req_ctx;
     errno_t ret;
 
     req = tevent_req_create(mem_ctx, &state, struct dp_get_account_info_state);
@@ -478,8 +481,18 @@ dp_get_account_info_send(TALLOC_CTX *mem_ctx,
         }
     }
 
-    subreq = dp_req_send(state, provider, domain, state->request_name, DPT_ID,
-                         DPM_ACCOUNT_HANDLER, dp_flags, state->data,
+    /* The data provider request continues the responder trace. */
+    dp_req_ctx = state;
+    if (trace_id != NULL && trace_id[0] != '\0') {
+        dp_req_ctx = sss_trace_new(state, "%s", trace_id);
+        if (dp_req_ctx == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    subreq = dp_req_send(dp_req_ctx, provider, domain, state->request_name,
+                         DPT_ID, DPM_ACCOUNT_HANDLER, dp_flags, state->data,
                          &state->request_name);
     if (subreq == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create subrequest!\n");
@@ -20,9 +20,16 @@
 */
 
 #include <netdb.h>
+#include <unistd.h>
 #include <arpa/inet.h>
 #include "providers/backend.h"
+#include "providers/be_ptask.h"
 #include "resolv/async_resolv.h"
+#include "util/sss_sockets.h"
+
+/* How many seconds a health check waits for the server to accept
+ * the connection */
+#define BE_FO_PROBE_TIMEOUT 5
 
 struct be_svc_callback {
     struct be_svc_callback *prev;
@@ -49,6 +56,10 @@ static int be_fo_get_options(struct be_ctx *ctx,
     opts->retry_timeout = 30;
     opts->srv_retry_neg_timeout = 15;
     opts->family_order = ctx->be_res->family_order;
+    opts->latency_aware = dp_opt_get_bool(ctx->be_res->opts,
+                                          DP_RES_OPT_FAILOVER_LATENCY_AWARE);
+    opts->probe_interval = dp_opt_get_int(ctx->be_res->opts,
+                                          DP_RES_OPT_FAILOVER_PROBE_INTERVAL);
 
     return EOK;
 }
@@ -91,6 +102,9 @@ int be_init_failover(struct be_ctx *ctx)
     return EOK;
 }
 
+static errno_t be_fo_probe_setup(struct be_ctx *ctx,
+                                 struct be_svc_data *svc);
+
 static int be_svc_data_destroy(void *memptr)
 {
     struct be_svc_data *svc;
@@ -167,6 +181,13 @@ int be_fo_add_service(struct be_ctx *ctx, const char *service_name,
 
     DLIST_ADD(ctx->be_fo->svcs, svc);
 
+    ret = be_fo_probe_setup(ctx, svc);
+    if (ret != EOK) {
+        /* The health checks are optional */
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to set up health checks of "
+              "service '%s' [%d]: %s\n", service_name, ret, sss_strerror(ret));
+    }
+
     return EOK;
 }
 
@@ -210,6 +231,35 @@ int be_fo_service_add_callback(TALLOC_CTX *memctx,
     return EOK;
 }
 
+int be_fo_set_default_port(struct be_ctx *ctx, const char *service_name,
+                           int port)
+{
+    struct be_svc_data *svc;
+
+    svc = be_fo_find_svc_data(ctx, service_name);
+    if (svc == NULL) {
+        return ENOENT;
+    }
+
+    svc->default_port = port;
+
+    return EOK;
+}
+
+int be_fo_set_reports_rtt(struct be_ctx *ctx, const char *service_name)
+{
+    struct be_svc_data *svc;
+
+    svc = be_fo_find_svc_data(ctx, service_name);
+    if (svc == NULL) {
+        return ENOENT;
+    }
+
+    fo_set_service_reports_rtt(svc->fo_service, true);
+
+    return EOK;
+}
+
 void be_fo_set_srv_lookup_plugin(struct be_ctx *ctx,
                                  fo_srv_lookup_plugin_send_t send_fn,
                                  fo_srv_lookup_plugin_recv_t recv_fn,
@@ -379,6 +429,8 @@ struct be_primary_server_ctx {
 errno_t be_resolve_server_process(struct tevent_req *subreq,
                                   struct be_resolve_server_state *state,
                                   struct tevent_req **new_subreq);
+static errno_t be_svc_use_server(struct be_svc_data *svc,
+                                 struct fo_server *srv);
 static void be_primary_server_done(struct tevent_req *subreq);
 static errno_t
 be_primary_server_timeout_activate(TALLOC_CTX *mem_ctx,
@@ -586,9 +638,6 @@ errno_t be_resolve_server_process(struct tevent_req *subreq,
                                   struct tevent_req **new_subreq)
 {
     errno_t ret;
-    time_t srv_status_change;
-    struct be_svc_callback *callback;
-    char *srvname;
 
     ret = fo_resolve_service_recv(subreq, state, &state->srv);
     switch (ret) {
@@ -664,30 +713,40 @@ errno_t be_resolve_server_process(struct tevent_req *subreq,
               srvaddr->addr_list[0]->ttl);
     }
 
-    srv_status_change = fo_get_server_hostname_last_change(state->srv);
+    return be_svc_use_server(state->svc, state->srv);
+}
+
+static errno_t be_svc_use_server(struct be_svc_data *svc,
+                                 struct fo_server *srv)
+{
+    time_t srv_status_change;
+    struct be_svc_callback *callback;
+    char *srvname;
+
+    srv_status_change = fo_get_server_hostname_last_change(srv);
 
     /* now call all svc callbacks if server changed or if it is explicitly
      * requested or if the server is the same but changed status since last time*/
-    if (state->svc->last_good_srv == NULL ||
-        strcmp(fo_get_server_name(state->srv), state->svc->last_good_srv) != 0 ||
-        fo_get_server_port(state->srv) != state->svc->last_good_port ||
-        state->svc->run_callbacks ||
-        srv_status_change > state->svc->last_status_change) {
-        state->svc->last_status_change = srv_status_change;
-        state->svc->run_callbacks = false;
-
-        srvname = talloc_strdup(state->svc, fo_get_server_name(state->srv));
+    if (svc->last_good_srv == NULL ||
+        strcmp(fo_get_server_name(srv), svc->last_good_srv) != 0 ||
+        fo_get_server_port(srv) != svc->last_good_port ||
+        svc->run_callbacks ||
+        srv_status_change > svc->last_status_change) {
+        svc->last_status_change = srv_status_change;
+        svc->run_callbacks = false;
+
+        srvname = talloc_strdup(svc, fo_get_server_name(srv));
         if (srvname == NULL) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Unable to copy server name\n");
             return ENOMEM;
         }
 
-        talloc_free(state->svc->last_good_srv);
-        state->svc->last_good_srv = srvname;
-        state->svc->last_good_port = fo_get_server_port(state->srv);
+        talloc_free(svc->last_good_srv);
+        svc->last_good_srv = srvname;
+        svc->last_good_port = fo_get_server_port(srv);
 
-        DLIST_FOR_EACH(callback, state->svc->callbacks) {
-            callback->fn(callback->private_data, state->srv);
+        DLIST_FOR_EACH(callback, svc->callbacks) {
+            callback->fn(callback->private_data, srv);
         }
     }
 
@@ -711,6 +770,83 @@ int be_resolve_server_recv(struct tevent_req *req,
     return EOK;
 }
 
+errno_t be_fo_get_candidate_servers(TALLOC_CTX *mem_ctx,
+                                    struct be_ctx *ctx,
+                                    const char *service_name,
+                                    struct fo_server *first,
+                                    size_t max,
+                                    struct fo_server ***_servers,
+                                    size_t *_count)
+{
+    struct be_svc_data *svc;
+
+    svc = be_fo_find_svc_data(ctx, service_name);
+    if (svc == NULL) {
+        return EINVAL;
+    }
+
+    return fo_get_candidate_servers(mem_ctx, svc->fo_service, first, max,
+                                    _servers, _count);
+}
+
+struct tevent_req *be_resolve_candidate_send(TALLOC_CTX *memctx,
+                                             struct tevent_context *ev,
+                                             struct be_ctx *ctx,
+                                             struct fo_server *srv)
+{
+    return fo_resolve_server_send(memctx, ev, ctx->be_fo->be_res->resolv,
+                                  ctx->be_fo->fo_ctx, srv);
+}
+
+int be_resolve_candidate_recv(struct tevent_req *req)
+{
+    return fo_resolve_server_recv(req);
+}
+
+errno_t be_fo_run_server_callbacks(struct be_ctx *ctx,
+                                   const char *service_name,
+                                   struct fo_server *srv)
+{
+    struct be_svc_data *svc;
+
+    svc = be_fo_find_svc_data(ctx, service_name);
+    if (svc == NULL) {
+        return EINVAL;
+    }
+
+    return be_svc_use_server(svc, srv);
+}
+
+errno_t be_fo_use_server(struct be_ctx *ctx,
+                         const char *service_name,
+                         struct fo_server *srv)
+{
+    struct be_svc_data *svc;
+    time_t timeout;
+    errno_t ret;
+
+    svc = be_fo_find_svc_data(ctx, service_name);
+    if (svc == NULL) {
+        return EINVAL;
+    }
+
+    ret = be_svc_use_server(svc, srv);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (!fo_is_server_primary(srv)) {
+        timeout = fo_get_service_retry_timeout(svc->fo_service) + 1;
+        ret = be_primary_server_timeout_activate(ctx, ctx->ev, ctx, svc,
+                                                 timeout);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    return EOK;
+}
+
 void be_fo_try_next_server(struct be_ctx *ctx, const char *service_name)
 {
     struct be_svc_data *svc;
@@ -830,6 +966,247 @@ void _be_fo_set_port_status(struct be_ctx *ctx,
     }
 }
 
+/* Background health checks of the servers that are not in use */
+
+struct be_fo_probe_state {
+    struct be_svc_data *svc;
+    size_t running;
+};
+
+struct be_fo_probe_server_state {
+    struct tevent_req *req;
+    struct tevent_context *ev;
+    struct be_ctx *be_ctx;
+    struct fo_server *srv;
+};
+
+static void be_fo_probe_resolve_done(struct tevent_req *subreq);
+static void be_fo_probe_connect_done(struct tevent_req *subreq);
+static void be_fo_probe_server_done(struct be_fo_probe_server_state *probe);
+
+static struct tevent_req *
+be_fo_probe_send(TALLOC_CTX *mem_ctx,
+                 struct tevent_context *ev,
+                 struct be_ctx *be_ctx,
+                 struct be_ptask *be_ptask,
+                 void *pvt)
+{
+    struct be_fo_probe_server_state *probe;
+    struct be_fo_probe_state *state;
+    struct fo_server **servers;
+    struct tevent_req *subreq;
+    struct tevent_req *req;
+    size_t count;
+    size_t i;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct be_fo_probe_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
+        return NULL;
+    }
+
+    state->svc = talloc_get_type(pvt, struct be_svc_data);
+
+    servers = fo_svc_probe_servers(state, state->svc->fo_service, &count);
+    if (servers == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Checking %zu servers of service '%s'\n",
+          count, state->svc->name);
+
+    for (i = 0; i < count; i++) {
+        probe = talloc_zero(state, struct be_fo_probe_server_state);
+        if (probe == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        probe->req = req;
+        probe->ev = ev;
+        probe->be_ctx = be_ctx;
+        probe->srv = servers[i];
+
+        subreq = be_resolve_candidate_send(probe, ev, be_ctx, probe->srv);
+        if (subreq == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        tevent_req_set_callback(subreq, be_fo_probe_resolve_done, probe);
+
+        state->running++;
+    }
+
+    ret = state->running == 0 ? EOK : EAGAIN;
+
+done:
+    if (ret == EOK) {
+        tevent_req_done(req);
+        tevent_req_post(req, ev);
+    } else if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+        tevent_req_post(req, ev);
+    }
+
+    return req;
+}
+
+static void be_fo_probe_resolve_done(struct tevent_req *subreq)
+{
+    struct be_fo_probe_server_state *probe;
+    struct be_fo_probe_state *state;
+    struct resolv_hostent *hostent;
+    struct sockaddr_storage *sockaddr;
+    int port;
+    errno_t ret;
+
+    probe = tevent_req_callback_data(subreq, struct be_fo_probe_server_state);
+    state = tevent_req_data(probe->req, struct be_fo_probe_state);
+
+    /* A server whose name cannot be resolved is marked by fail over */
+    ret = be_resolve_candidate_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        be_fo_probe_server_done(probe);
+        return;
+    }
+
+    hostent = fo_get_server_hostent(probe->srv);
+    if (hostent == NULL) {
+        be_fo_probe_server_done(probe);
+        return;
+    }
+
+    port = fo_get_server_port(probe->srv);
+    if (port <= 0) {
+        port = state->svc->default_port;
+    }
+    if (port <= 0) {
+        DEBUG(SSSDBG_TRACE_FUNC, "No port known for server '%s', "
+              "not checking it\n", fo_get_server_str_name(probe->srv));
+        be_fo_probe_server_done(probe);
+        return;
+    }
+
+    sockaddr = resolv_get_sockaddr_address(probe, hostent, port);
+    if (sockaddr == NULL) {
+        be_fo_probe_server_done(probe);
+        return;
+    }
+
+    subreq = sssd_async_socket_init_send(probe, probe->ev, sockaddr,
+                                         sizeof(struct sockaddr_storage),
+                                         BE_FO_PROBE_TIMEOUT);
+    if (subreq == NULL) {
+        be_fo_probe_server_done(probe);
+        return;
+    }
+    tevent_req_set_callback(subreq, be_fo_probe_connect_done, probe);
+}
+
+static void be_fo_probe_connect_done(struct tevent_req *subreq)
+{
+    struct be_fo_probe_server_state *probe;
+    struct be_fo_probe_state *state;
+    errno_t ret;
+    int fd = -1;
+
+    probe = tevent_req_callback_data(subreq, struct be_fo_probe_server_state);
+    state = tevent_req_data(probe->req, struct be_fo_probe_state);
+
+    ret = sssd_async_socket_init_recv(subreq, &fd);
+    talloc_zfree(subreq);
+    if (fd != -1) {
+        close(fd);
+    }
+
+    /* The server list may have changed while we were waiting */
+    if (!fo_svc_has_server(state->svc->fo_service, probe->srv)) {
+        be_fo_probe_server_done(probe);
+        return;
+    }
+
+    if (ret == EOK) {
+        fo_set_server_alive(probe->srv);
+    } else {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Health check of server '%s' "
+              "failed [%d]: %s\n", fo_get_server_str_name(probe->srv),
+              ret, sss_strerror(ret));
+
+        /* The server status is shared with the other services of the
+         * host, so only the port of this service is marked, the same as
+         * a failed connection of a request does */
+        be_fo_set_port_status(probe->be_ctx, state->svc->name, probe->srv,
+                              PORT_NOT_WORKING);
+    }
+
+    be_fo_probe_server_done(probe);
+}
+
+static void be_fo_probe_server_done(struct be_fo_probe_server_state *probe)
+{
+    struct tevent_req *req = probe->req;
+    struct be_fo_probe_state *state;
+
+    state = tevent_req_data(req, struct be_fo_probe_state);
+
+    talloc_free(probe);
+    state->running--;
+    if (state->running == 0) {
+        tevent_req_done(req);
+    }
+}
+
+static errno_t be_fo_probe_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+static errno_t be_fo_probe_setup(struct be_ctx *ctx,
+                                 struct be_svc_data *svc)
+{
+    time_t period;
+    time_t timeout;
+    char *name;
+    errno_t ret;
+
+    period = dp_opt_get_int(ctx->be_fo->be_res->opts,
+                            DP_RES_OPT_FAILOVER_HEALTH_CHECK_INTERVAL);
+    if (period <= 0) {
+        return EOK;
+    }
+
+    /* resolve the name and wait for the connection */
+    timeout = dp_opt_get_int(ctx->be_fo->be_res->opts,
+                             DP_RES_OPT_RESOLVER_TIMEOUT)
+              + BE_FO_PROBE_TIMEOUT;
+
+    name = talloc_asprintf(svc, "Health check of %s servers", svc->name);
+    if (name == NULL) {
+        return ENOMEM;
+    }
+
+    /* The checks run offline as well, so that the servers that are back
+     * are known by the time we try to go online */
+    ret = be_ptask_create(svc, ctx, period, period, 0, period / 10, timeout,
+                          0, be_fo_probe_send, be_fo_probe_recv, svc, name,
+                          BE_PTASK_OFFLINE_EXECUTE | BE_PTASK_SCHEDULE_FROM_LAST,
+                          NULL);
+    talloc_free(name);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    DEBUG(SSSDBG_CONF_SETTINGS, "Servers of service '%s' are checked every "
+          "%ld seconds\n", svc->name, (long)period);
+
+    return EOK;
+}
+
 /* Resolver back end interface */
 static struct dp_option dp_res_default_opts[] = {
     { "lookup_family_order", DP_OPT_STRING, { "ipv4_first" }, NULL_STRING },
@@ -837,6 +1214,9 @@ static struct dp_option dp_res_default_opts[] = {
     { "dns_resolver_op_timeout", DP_OPT_NUMBER, { .number = 3 }, NULL_NUMBER },
     { "dns_resolver_server_timeout", DP_OPT_NUMBER, { .number = 1000 }, NULL_NUMBER },
     { "dns_discovery_domain", DP_OPT_STRING, NULL_STRING, NULL_STRING },
+    { "failover_latency_aware", DP_OPT_BOOL, BOOL_TRUE, BOOL_TRUE },
+    { "failover_probe_interval", DP_OPT_NUMBER, { .number = 300 }, NULL_NUMBER },
+    { "failover_health_check_interval", DP_OPT_NUMBER, { .number = 0 }, NULL_NUMBER },
     DP_OPTION_TERMINATOR
 };
 
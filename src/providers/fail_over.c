@@ -33,6 +33,7 @@
 #include "util/dlinklist.h"
 #include "util/refcount.h"
 #include "util/util.h"
+#include "util/sss_metrics.h"
 #include "providers/fail_over.h"
 #include "resolv/async_resolv.h"
 
@@ -43,6 +44,13 @@
 #define DEFAULT_SERVER_STATUS SERVER_NAME_NOT_RESOLVED
 #define DEFAULT_SRV_STATUS SRV_NEUTRAL
 
+/* Weight of a new sample in the moving averages */
+#define FO_SAMPLE_WEIGHT 0.3
+/* A failure weighs as much as a round trip of this many microseconds */
+#define FO_ERROR_PENALTY_USEC 5000000.0
+/* Leave a working server only for one with at least 25 % better score */
+#define FO_SCORE_SWITCH_RATIO 0.75
+
 enum srv_lookup_status {
     SRV_NEUTRAL,        /* We didn't try this SRV lookup yet */
     SRV_RESOLVED,       /* This SRV lookup is resolved       */
@@ -76,6 +84,26 @@ struct fo_service {
      * is needed in fail over duplicate servers detection.
      */
     datacmp_fn user_data_cmp;
+
+    /* The servers are only ordered by score if the users of the service
+     * report the round trip time of their successful requests */
+    bool reports_rtt;
+};
+
+struct fo_server_stats {
+    double rtt_usec;
+    double error_rate;
+    unsigned int samples;
+    unsigned int rtt_samples;
+    time_t last_sample;
+};
+
+/* Statistics of a server expanded from a SRV query, kept while the query
+ * is refreshed */
+struct fo_saved_stats {
+    char *name;
+    int port;
+    struct fo_server_stats stats;
 };
 
 struct fo_server {
@@ -93,6 +121,12 @@ struct fo_server {
     struct timeval last_status_change;
     struct server_common *common;
 
+    /* SRV priority, servers that share it may be reordered by score */
+    unsigned short priority;
+
+    /* Moving averages, see fo_add_server_sample() */
+    struct fo_server_stats stats;
+
     TALLOC_CTX *fo_internal_owner;
 };
 
@@ -123,6 +157,9 @@ struct srv_data {
     int srv_lookup_status;
     int ttl;
     struct timeval last_status_change;
+
+    struct fo_saved_stats *saved_stats;
+    size_t num_saved_stats;
 };
 
 struct resolve_service_request {
@@ -159,6 +196,8 @@ fo_context_init(TALLOC_CTX *mem_ctx, struct fo_options *opts)
     ctx->opts->retry_timeout = opts->retry_timeout;
     ctx->opts->family_order  = opts->family_order;
     ctx->opts->service_resolv_timeout = opts->service_resolv_timeout;
+    ctx->opts->latency_aware = opts->latency_aware;
+    ctx->opts->probe_interval = opts->probe_interval;
 
     DEBUG(SSSDBG_TRACE_FUNC,
           "Created new fail over context, retry timeout is %ld\n",
@@ -217,6 +256,38 @@ str_server_status(enum server_status status)
     return "unknown server status";
 }
 
+/* Same as str_server_status() but usable in a metric name */
+static const char *
+metric_server_status(enum server_status status)
+{
+    switch (status) {
+    case SERVER_NAME_NOT_RESOLVED:
+        return "name_not_resolved";
+    case SERVER_RESOLVING_NAME:
+        return "resolving_name";
+    case SERVER_NAME_RESOLVED:
+        return "name_resolved";
+    case SERVER_WORKING:
+        return "working";
+    case SERVER_NOT_WORKING:
+        return "not_working";
+    }
+
+    return "unknown";
+}
+
+/* Same as SERVER_NAME() but usable in a metric name. Servers that were
+ * not expanded from a SRV query yet have no name. */
+static const char *
+metric_server_name(struct fo_server *server)
+{
+    if (server->common == NULL || server->common->name == NULL) {
+        return "unnamed";
+    }
+
+    return server->common->name;
+}
+
 int fo_is_srv_lookup(struct fo_server *s)
 {
     return s && s->srv_data;
@@ -231,6 +302,54 @@ static void fo_server_free(struct fo_server *server)
     talloc_free(server->fo_internal_owner);
 }
 
+/* Remember the statistics of a server that is going to be removed so
+ * they can be restored if the refreshed SRV query returns it again. */
+static void
+fo_save_stats(struct srv_data *data, struct fo_server *server)
+{
+    struct fo_saved_stats *saved;
+
+    if (server->common == NULL || server->stats.samples == 0) {
+        return;
+    }
+
+    saved = talloc_realloc(data, data->saved_stats, struct fo_saved_stats,
+                           data->num_saved_stats + 1);
+    if (saved == NULL) {
+        /* The statistics are only a hint */
+        return;
+    }
+    data->saved_stats = saved;
+
+    saved = &data->saved_stats[data->num_saved_stats];
+    saved->name = talloc_strdup(data->saved_stats, server->common->name);
+    if (saved->name == NULL) {
+        return;
+    }
+    saved->port = server->port;
+    saved->stats = server->stats;
+    data->num_saved_stats++;
+}
+
+static void
+fo_restore_stats(struct srv_data *data, struct fo_server *server)
+{
+    size_t i;
+
+    if (server->common == NULL) {
+        return;
+    }
+
+    for (i = 0; i < data->num_saved_stats; i++) {
+        if (data->saved_stats[i].port == server->port
+                && strcasecmp(data->saved_stats[i].name,
+                              server->common->name) == 0) {
+            server->stats = data->saved_stats[i].stats;
+            return;
+        }
+    }
+}
+
 static struct fo_server *
 collapse_srv_lookup(struct fo_server **_server)
 {
@@ -242,14 +361,19 @@ collapse_srv_lookup(struct fo_server **_server)
               meta->srv_data->dns_domain);
 
     if (server != meta) {
+        talloc_zfree(meta->srv_data->saved_stats);
+        meta->srv_data->num_saved_stats = 0;
+
         while (server->prev && server->prev->srv_data == meta->srv_data) {
             tmp = server->prev;
             DLIST_REMOVE(server->service->server_list, tmp);
+            fo_save_stats(meta->srv_data, tmp);
             fo_server_free(tmp);
         }
         while (server->next && server->next->srv_data == meta->srv_data) {
             tmp = server->next;
             DLIST_REMOVE(server->service->server_list, tmp);
+            fo_save_stats(meta->srv_data, tmp);
             fo_server_free(tmp);
         }
 
@@ -263,6 +387,7 @@ collapse_srv_lookup(struct fo_server **_server)
         /* add back the meta server to denote SRV lookup */
         DLIST_ADD_AFTER(server->service->server_list, meta, server);
         DLIST_REMOVE(server->service->server_list, server);
+        fo_save_stats(meta->srv_data, server);
         fo_server_free(server);
     }
 
@@ -577,6 +702,9 @@ fo_server_alloc(struct fo_service *service, int port,
     server->port_status = DEFAULT_PORT_STATUS;
     server->primary = primary;
 
+    server->priority = 0;
+    memset(&server->stats, 0, sizeof(server->stats));
+
     return server;
 }
 
@@ -688,6 +816,12 @@ create_fo_server(struct fo_service *service, const char *name,
     return server;
 }
 
+void
+fo_set_service_reports_rtt(struct fo_service *service, bool reports_rtt)
+{
+    service->reports_rtt = reports_rtt;
+}
+
 int
 fo_get_server_count(struct fo_service *service)
 {
@@ -817,6 +951,8 @@ static errno_t fo_add_server_list(struct fo_service *service,
         }
 
         server->srv_data = srv_data;
+        server->priority = servers[i].priority;
+        fo_restore_stats(srv_data, server);
 
         ret = fo_add_server_to_list(&srv_list, service->server_list,
                                     server, service->name);
@@ -869,6 +1005,86 @@ void fo_ref_server(TALLOC_CTX *ref_ctx,
     }
 }
 
+static double
+fo_server_score(struct fo_server *server)
+{
+    return server->stats.rtt_usec
+           + server->stats.error_rate * FO_ERROR_PENALTY_USEC;
+}
+
+/* Servers discovered by the same SRV query with the same priority are
+ * equal from the point of view of the administrator, so they can be
+ * reordered. Configured servers always keep their order. */
+static bool
+fo_same_priority(struct fo_server *a, struct fo_server *b)
+{
+    return a->srv_data != NULL && a->srv_data == b->srv_data
+           && a->srv_data->meta != a && b->srv_data->meta != b
+           && a->primary == b->primary && a->priority == b->priority;
+}
+
+static bool
+fo_server_needs_probe(struct fo_server *server, time_t now)
+{
+    time_t interval = server->service->ctx->opts->probe_interval;
+
+    return server->stats.samples == 0
+           || (interval > 0 && now - server->stats.last_sample >= interval);
+}
+
+/*
+ * Pick the server to use instead of @server among the working servers of
+ * the same priority. A server whose score is unknown or too old is tried
+ * first so it gets measured, otherwise the server with the best score is
+ * picked if it is clearly better than @server.
+ */
+static struct fo_server *
+fo_pick_by_score(struct fo_server *server)
+{
+    struct fo_server *best = server;
+    struct fo_server *iter;
+    time_t now;
+
+    if (!server->service->ctx->opts->latency_aware
+            || !server->service->reports_rtt
+            || !fo_same_priority(server, server)) {
+        return server;
+    }
+
+    now = time(NULL);
+    if (fo_server_needs_probe(server, now)) {
+        return server;
+    }
+
+    DLIST_FOR_EACH(iter, server->service->server_list) {
+        if (iter == server || !fo_same_priority(iter, server)
+                || !service_works(iter)) {
+            continue;
+        }
+
+        if (fo_server_needs_probe(iter, now)) {
+            DEBUG(SSSDBG_TRACE_FUNC, "Probing server '%s'\n",
+                  SERVER_NAME(iter));
+            return iter;
+        }
+
+        if (fo_server_score(iter) < fo_server_score(best)) {
+            best = iter;
+        }
+    }
+
+    if (best != server && fo_server_score(best)
+                          < fo_server_score(server) * FO_SCORE_SWITCH_RATIO) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Preferring server '%s' (score %.0f) "
+              "over '%s' (score %.0f)\n", SERVER_NAME(best),
+              fo_server_score(best), SERVER_NAME(server),
+              fo_server_score(server));
+        return best;
+    }
+
+    return server;
+}
+
 static int
 get_first_server_entity(struct fo_service *service, struct fo_server **_server)
 {
@@ -934,6 +1150,7 @@ get_first_server_entity(struct fo_service *service, struct fo_server **_server)
     return ENOENT;
 
 done:
+    server = fo_pick_by_score(server);
     service->last_tried_server = server;
     *_server = server;
     return EOK;
@@ -1243,6 +1460,121 @@ fo_resolve_service_recv(struct tevent_req *req,
     return EOK;
 }
 
+/*******************************************************************
+ * Get several servers to connect to in parallel.                  *
+ *******************************************************************/
+
+errno_t
+fo_get_candidate_servers(TALLOC_CTX *mem_ctx,
+                         struct fo_service *service,
+                         struct fo_server *first,
+                         size_t max,
+                         struct fo_server ***_servers,
+                         size_t *_count)
+{
+    struct fo_server **servers;
+    struct fo_server *server;
+    size_t count = 0;
+    bool primary;
+    int pass;
+
+    if (max == 0 || !fo_svc_has_server(service, first)) {
+        return EINVAL;
+    }
+
+    servers = talloc_zero_array(mem_ctx, struct fo_server *, max);
+    if (servers == NULL) {
+        return ENOMEM;
+    }
+
+    fo_ref_server(servers, first);
+    servers[count++] = first;
+
+    /* Walk the list from the server after 'first' around to the server
+     * before it, primary servers in the first pass, backup ones next. */
+    for (pass = 0; pass < 2 && count < max; pass++) {
+        primary = (pass == 0);
+        if (primary && !first->primary) {
+            continue;
+        }
+
+        server = first->next;
+        while (count < max) {
+            if (server == NULL) {
+                server = service->server_list;
+            }
+            if (server == first) {
+                break;
+            }
+
+            if (server->primary == primary && server->common != NULL
+                    && service_works(server)) {
+                fo_ref_server(servers, server);
+                servers[count++] = server;
+            }
+
+            server = server->next;
+        }
+    }
+
+    *_servers = servers;
+    *_count = count;
+    return EOK;
+}
+
+struct tevent_req *
+fo_resolve_server_send(TALLOC_CTX *mem_ctx, struct tevent_context *ev,
+                       struct resolv_ctx *resolv, struct fo_ctx *ctx,
+                       struct fo_server *server)
+{
+    struct resolve_service_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct resolve_service_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->resolv = resolv;
+    state->ev = ev;
+    state->fo_ctx = ctx;
+    state->server = server;
+
+    if (server->common == NULL) {
+        /* Not expanded SRV query */
+        ret = EINVAL;
+        goto done;
+    }
+
+    ret = fo_resolve_service_activate_timeout(req, ev,
+                                        ctx->opts->service_resolv_timeout);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Could not set service timeout\n");
+        goto done;
+    }
+
+    if (fo_resolve_service_server(req)) {
+        tevent_req_post(req, ev);
+    }
+
+    ret = EOK;
+done:
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        tevent_req_post(req, ev);
+    }
+    return req;
+}
+
+int
+fo_resolve_server_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
 /*******************************************************************
  * Resolve the server to connect to using a SRV query.             *
  *******************************************************************/
@@ -1515,6 +1847,13 @@ fo_set_server_status(struct fo_server *server, enum server_status status)
         return;
     }
 
+    /* Count the transitions, not the repeated confirmations */
+    if (server->common->server_status != status) {
+        sss_metric_add(sss_metric_counter("fo.%s.%s",
+                                          metric_server_name(server),
+                                          metric_server_status(status)), 1);
+    }
+
     set_server_common_status(server->common, status);
 }
 
@@ -1529,6 +1868,9 @@ fo_set_port_status(struct fo_server *server, enum port_status status)
 
     server->port_status = status;
     gettimeofday(&server->last_status_change, NULL);
+    if (status == PORT_NOT_WORKING) {
+        fo_add_server_sample(server, 0, false);
+    }
     if (status == PORT_WORKING) {
         fo_set_server_status(server, SERVER_WORKING);
         server->service->active_server = server;
@@ -1551,6 +1893,60 @@ fo_set_port_status(struct fo_server *server, enum port_status status)
     }
 }
 
+void
+fo_add_server_sample(struct fo_server *server, uint64_t rtt_usec, bool success)
+{
+    struct fo_server_stats *stats;
+    double error = success ? 0 : 1;
+
+    if (server == NULL) {
+        return;
+    }
+
+    stats = &server->stats;
+    if (stats->samples == 0) {
+        stats->error_rate = error;
+    } else {
+        stats->error_rate += FO_SAMPLE_WEIGHT * (error - stats->error_rate);
+    }
+    stats->samples++;
+    stats->last_sample = time(NULL);
+
+    if (success) {
+        if (stats->rtt_samples == 0) {
+            stats->rtt_usec = rtt_usec;
+        } else {
+            stats->rtt_usec += FO_SAMPLE_WEIGHT
+                               * ((double) rtt_usec - stats->rtt_usec);
+        }
+        stats->rtt_samples++;
+    }
+
+    DEBUG(SSSDBG_TRACE_ALL, "Server '%s': rtt %.0f us, error rate %.3f\n",
+          SERVER_NAME(server), stats->rtt_usec, stats->error_rate);
+}
+
+void
+fo_set_server_alive(struct fo_server *server)
+{
+    if (server == NULL || server->common == NULL) {
+        return;
+    }
+
+    if (server->common->server_status == SERVER_NOT_WORKING) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Server '%s' is reachable again\n",
+              SERVER_NAME(server));
+        fo_set_server_status(server, SERVER_NAME_RESOLVED);
+    }
+
+    if (server->port_status == PORT_NOT_WORKING) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Port %d of server '%s' answers again\n",
+              server->port, SERVER_NAME(server));
+        server->port_status = PORT_NEUTRAL;
+        gettimeofday(&server->last_status_change, NULL);
+    }
+}
+
 struct fo_server *fo_get_active_server(struct fo_service *service)
 {
     return service->active_server;
@@ -1756,6 +2152,88 @@ const char **fo_svc_server_list(TALLOC_CTX *mem_ctx,
     return list;
 }
 
+struct fo_server **fo_svc_probe_servers(TALLOC_CTX *mem_ctx,
+                                        struct fo_service *service,
+                                        size_t *_count)
+{
+    struct fo_server **servers;
+    struct fo_server *srv;
+    size_t count;
+
+    count = 0;
+    DLIST_FOR_EACH(srv, service->server_list) {
+        count++;
+    }
+
+    servers = talloc_zero_array(mem_ctx, struct fo_server *, count + 1);
+    if (servers == NULL) {
+        return NULL;
+    }
+
+    count = 0;
+    DLIST_FOR_EACH(srv, service->server_list) {
+        if (srv == service->active_server || srv->common == NULL) {
+            /* in use or not expanded SRV query */
+            continue;
+        }
+
+        fo_ref_server(servers, srv);
+        servers[count++] = srv;
+    }
+
+    if (_count != NULL) {
+        *_count = count;
+    }
+
+    return servers;
+}
+
+struct fo_server_score *fo_svc_server_scores(TALLOC_CTX *mem_ctx,
+                                             struct fo_service *service,
+                                             size_t *_count)
+{
+    struct fo_server_score *scores;
+    const char *server;
+    struct fo_server *srv;
+    size_t count;
+
+    count = 0;
+    DLIST_FOR_EACH(srv, service->server_list) {
+        count++;
+    }
+
+    scores = talloc_zero_array(mem_ctx, struct fo_server_score, count + 1);
+    if (scores == NULL) {
+        return NULL;
+    }
+
+    count = 0;
+    DLIST_FOR_EACH(srv, service->server_list) {
+        server = fo_get_server_name(srv);
+        if (server == NULL) {
+            /* _srv_ */
+            continue;
+        }
+
+        scores[count].name = talloc_strdup(scores, server);
+        if (scores[count].name == NULL) {
+            talloc_free(scores);
+            return NULL;
+        }
+        scores[count].rtt_usec = srv->stats.rtt_usec > UINT32_MAX
+                                 ? UINT32_MAX : srv->stats.rtt_usec;
+        scores[count].error_permille = srv->stats.error_rate * 1000;
+        scores[count].samples = srv->stats.samples;
+        count++;
+    }
+
+    if (_count != NULL) {
+        *_count = count;
+    }
+
+    return scores;
+}
+
 bool fo_set_srv_lookup_plugin(struct fo_ctx *ctx,
                               fo_srv_lookup_plugin_send_t send_fn,
                               fo_srv_lookup_plugin_recv_t recv_fn,
@@ -26,6 +26,7 @@
 #define __FAIL_OVER_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <talloc.h>
 
 #include "resolv/async_resolv.h"
@@ -76,12 +77,20 @@ struct fo_server;
  *
  * The family_order member specifies the order of address families to
  * try when looking up the service.
+ *
+ * The 'latency_aware' member enables preferring the server with the best
+ * score among servers discovered with the same SRV priority.
+ *
+ * The 'probe_interval' member specifies after how many seconds without
+ * a sample a server of such group is tried again to refresh its score.
  */
 struct fo_options {
     time_t srv_retry_neg_timeout;
     time_t retry_timeout;
     int service_resolv_timeout;
     enum restrict_family family_order;
+    bool latency_aware;
+    time_t probe_interval;
 };
 
 /*
@@ -115,6 +124,14 @@ int fo_get_service(struct fo_ctx *ctx,
                    const char *name,
                    struct fo_service **_service);
 
+/*
+ * Declare that the users of 'service' report the round trip time of their
+ * successful requests with fo_add_server_sample(). Only the servers of
+ * such services are ordered by score, the others would only ever collect
+ * failures.
+ */
+void fo_set_service_reports_rtt(struct fo_service *service, bool reports_rtt);
+
 /*
  * Get number of servers registered for the 'service'.
  */
@@ -150,6 +167,31 @@ int fo_resolve_service_recv(struct tevent_req *req,
                             TALLOC_CTX *ref_ctx,
                             struct fo_server **server);
 
+/*
+ * Return up to 'max' servers of the service in the order in which they
+ * would be tried, starting with 'first'. Servers marked as not working and
+ * SRV queries that were not expanded yet are skipped. Backup servers are
+ * only returned after all primary servers. The returned servers are
+ * referenced by the array.
+ */
+errno_t fo_get_candidate_servers(TALLOC_CTX *mem_ctx,
+                                 struct fo_service *service,
+                                 struct fo_server *first,
+                                 size_t max,
+                                 struct fo_server ***_servers,
+                                 size_t *_count);
+
+/*
+ * Resolve the address of a server returned by fo_get_candidate_servers().
+ */
+struct tevent_req *fo_resolve_server_send(TALLOC_CTX *mem_ctx,
+                                          struct tevent_context *ev,
+                                          struct resolv_ctx *resolv,
+                                          struct fo_ctx *ctx,
+                                          struct fo_server *server);
+
+int fo_resolve_server_recv(struct tevent_req *req);
+
 
 /* To be used by async consumers of fo_resolve_service. If a server should be returned
  * to an outer request, it should be referenced by a memory from that outer request,
@@ -179,6 +221,26 @@ void fo_set_server_status(struct fo_server *server,
 void fo_set_port_status(struct fo_server *server,
                         enum port_status status);
 
+/*
+ * Report how long a request sent to the server took or that it failed.
+ * Exponentially weighted moving averages of the round trip time and of
+ * the error rate are kept for each server and combined into its score.
+ * Marking the port as not working counts as a failure automatically.
+ */
+void fo_add_server_sample(struct fo_server *server,
+                          uint64_t rtt_usec,
+                          bool success);
+
+/*
+ * Record that 'server' answered a background health check. A server or
+ * port that was marked as not working is usable again right away instead
+ * of after the retry timeout.
+ *
+ * The check is not a sample for the score of the server: it only opens a
+ * TCP connection, which says nothing about how fast requests are answered.
+ */
+void fo_set_server_alive(struct fo_server *server);
+
 /*
  * Instruct fail-over to try next server on the next connect attempt.
  * Should be used after connection to service was unexpectedly dropped
@@ -216,6 +278,29 @@ const char **fo_svc_server_list(TALLOC_CTX *mem_ctx,
                                 struct fo_service *service,
                                 size_t *_count);
 
+/*
+ * Return the servers of the service that should be health checked in the
+ * background: all servers with a known name except the active one. The
+ * returned servers are referenced by the NULL terminated array.
+ */
+struct fo_server **fo_svc_probe_servers(TALLOC_CTX *mem_ctx,
+                                        struct fo_service *service,
+                                        size_t *_count);
+
+struct fo_server_score {
+    const char *name;
+    uint32_t rtt_usec;          /* average round trip time */
+    uint32_t error_permille;    /* average error rate */
+    uint32_t samples;           /* number of samples */
+};
+
+/*
+ * Return the scores of the servers listed by fo_svc_server_list().
+ */
+struct fo_server_score *fo_svc_server_scores(TALLOC_CTX *mem_ctx,
+                                             struct fo_service *service,
+                                             size_t *_count);
+
 /*
  * Folowing functions allow to iterate trough list of servers.
  */
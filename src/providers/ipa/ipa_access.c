@@ -429,6 +429,7 @@ static void ipa_fetch_hbac_rules_done(struct tevent_req *subreq)
 
     if (found == false) {
         /* No rules were found that apply to this host. */
+        talloc_zfree(state->access_ctx->hbac_compiled);
         ret = ipa_common_purge_rules(state->be_ctx->domain,
                                      HBAC_RULES_SUBDIR);
         if (ret != EOK) {
@@ -440,6 +441,8 @@ static void ipa_fetch_hbac_rules_done(struct tevent_req *subreq)
         goto done;
     }
 
+    /* The compiled rules are rebuilt from the cache on the next check */
+    talloc_zfree(state->access_ctx->hbac_compiled);
     ret = ipa_common_save_rules(state->be_ctx->domain,
                                 state->hosts, state->services, state->rules,
                                 &state->access_ctx->last_update);
@@ -468,16 +471,14 @@ static errno_t ipa_fetch_hbac_recv(struct tevent_req *req)
 }
 
 errno_t ipa_hbac_evaluate_rules(struct be_ctx *be_ctx,
-                                struct dp_option *ipa_options,
+                                struct ipa_access_ctx *access_ctx,
                                 struct pam_data *pd)
 {
     TALLOC_CTX *tmp_ctx;
     struct hbac_ctx hbac_ctx;
-    struct hbac_rule **hbac_rules;
     struct hbac_eval_req *eval_req;
     enum hbac_eval_result result;
     struct hbac_info *info = NULL;
-    const char **attrs_get_cached_rules;
     errno_t ret;
 
     tmp_ctx = talloc_new(NULL);
@@ -486,40 +487,35 @@ errno_t ipa_hbac_evaluate_rules(struct be_ctx *be_ctx,
     }
 
     hbac_ctx.be_ctx = be_ctx;
-    hbac_ctx.ipa_options = ipa_options;
+    hbac_ctx.ipa_options = access_ctx->ipa_options;
     hbac_ctx.pd = pd;
+    hbac_ctx.rule_count = 0;
+    hbac_ctx.rules = NULL;
 
-    /* Get HBAC rules from the sysdb */
-    attrs_get_cached_rules = hbac_get_attrs_to_get_cached_rules(tmp_ctx);
-    if (attrs_get_cached_rules == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "hbac_get_attrs_to_get_cached_rules() failed\n");
-        ret = ENOMEM;
-        goto done;
-    }
-    ret = ipa_common_get_cached_rules(tmp_ctx, be_ctx->domain,
-                                      IPA_HBAC_RULE, HBAC_RULES_SUBDIR,
-                                      attrs_get_cached_rules,
-                                      &hbac_ctx.rule_count, &hbac_ctx.rules);
+    hbac_enable_debug(hbac_debug_messages);
+
+    /* The compiled rules are reused until the cache changes */
+    ret = ipa_hbac_get_compiled_rules(access_ctx, &hbac_ctx,
+                                      &access_ctx->hbac_compiled);
     if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Could not retrieve rules from the cache\n");
         goto done;
     }
 
-    ret = hbac_ctx_to_rules(tmp_ctx, &hbac_ctx, &hbac_rules, &eval_req);
-    if (ret == EPERM) {
+    if (access_ctx->hbac_compiled->deny_rules) {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "DENY rules detected. Denying access to all users\n");
         ret = ERR_ACCESS_DENIED;
         goto done;
-    } else if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Could not construct HBAC rules\n");
-        goto done;
     }
 
-    hbac_enable_debug(hbac_debug_messages);
+    ret = hbac_ctx_to_eval_request(tmp_ctx, &hbac_ctx, &eval_req);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not construct eval request\n");
+        goto done;
+    }
 
-    result = hbac_evaluate(hbac_rules, eval_req, &info);
+    result = hbac_evaluate_compiled(access_ctx->hbac_compiled->compiled,
+                                    eval_req, &info);
     if (result == HBAC_EVAL_ALLOW) {
         DEBUG(SSSDBG_MINOR_FAILURE, "Access granted by HBAC rule [%s]\n",
               info->rule_name);
@@ -665,8 +661,8 @@ static void ipa_pam_access_handler_done(struct tevent_req *subreq)
         goto done;
     }
 
-    ret = ipa_hbac_evaluate_rules(state->be_ctx,
-                                  state->access_ctx->ipa_options, state->pd);
+    ret = ipa_hbac_evaluate_rules(state->be_ctx, state->access_ctx,
+                                  state->pd);
     if (ret == EOK) {
         state->pd->pam_status = PAM_SUCCESS;
     } else if (ret == ERR_ACCESS_DENIED) {
@@ -42,6 +42,10 @@ struct ipa_access_ctx {
     struct sdap_attr_map *hostgroup_map;
     struct sdap_search_base **host_search_bases;
     struct sdap_search_base **hbac_search_bases;
+
+    /* Cached HBAC rules prepared for evaluation, rebuilt when the
+     * cache changes */
+    struct ipa_hbac_compiled *hbac_compiled;
 };
 
 struct hbac_ctx {
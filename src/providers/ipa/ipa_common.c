@@ -1049,6 +1049,16 @@ int ipa_service_init(TALLOC_CTX *memctx, struct be_ctx *ctx,
         goto done;
     }
 
+    ret = be_fo_set_default_port(ctx, "IPA", LDAP_PORT);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = be_fo_set_reports_rtt(ctx, "IPA");
+    if (ret != EOK) {
+        goto done;
+    }
+
     service->sdap->name = talloc_strdup(service, "IPA");
     if (!service->sdap->name) {
         ret = ENOMEM;
@@ -23,8 +23,11 @@
 #include "providers/ipa/ipa_deskprofile_rules_util.h"
 #include "providers/ipa/ipa_deskprofile_private.h"
 #include "providers/ipa/ipa_rules_common.h"
+#include "util/atomic_io.h"
 #include <ctype.h>
+#include <dirent.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 
 #define DESKPROFILE_GLOBAL_POLICY_MIN_VALUE 1
 #define DESKPROFILE_GLOBAL_POLICY_MAX_VALUE 24
@@ -677,6 +680,116 @@ done:
 }
 
 
+/* Returns true if the file already holds exactly the rule data, in which
+ * case it does not have to be written again. */
+static bool
+ipa_deskprofile_rules_file_is_current(const char *filename_path,
+                                      const char *data)
+{
+    struct stat st;
+    size_t len;
+    char *buf;
+    ssize_t nread;
+    bool current = false;
+    int fd;
+
+    fd = open(filename_path, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd == -1) {
+        return false;
+    }
+
+    len = strlen(data);
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)
+            || st.st_size != (off_t) len) {
+        goto done;
+    }
+
+    buf = talloc_size(NULL, len + 1);
+    if (buf == NULL) {
+        goto done;
+    }
+
+    nread = sss_atomic_read_s(fd, buf, len + 1);
+    current = (nread == (ssize_t) len && memcmp(buf, data, len) == 0);
+    talloc_free(buf);
+
+done:
+    close(fd);
+    return current;
+}
+
+/* Replaces the file atomically, so the Desktop Profile client never sees
+ * a partially written rule. */
+static errno_t
+ipa_deskprofile_rules_write_file(TALLOC_CTX *mem_ctx,
+                                 const char *filename_path,
+                                 const char *data)
+{
+    char *tmp_path;
+    size_t len;
+    ssize_t written;
+    mode_t old_umask;
+    int fd = -1;
+    errno_t ret;
+
+    tmp_path = talloc_asprintf(mem_ctx, "%s.XXXXXX", filename_path);
+    if (tmp_path == NULL) {
+        return ENOMEM;
+    }
+
+    old_umask = umask(0077);
+    fd = mkstemp(tmp_path);
+    umask(old_umask);
+    if (fd == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Failed to create the Desktop Profile rule file \"%s\" "
+              "[%d]: %s\n",
+              filename_path, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    len = strlen(data);
+    written = sss_atomic_write_s(fd, discard_const(data), len);
+    if (written != (ssize_t) len) {
+        ret = written == -1 ? errno : EIO;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Failed to write the content of the Desktop Profile rule for "
+              "the \"%s\" file.\n",
+              filename_path);
+        goto done;
+    }
+
+    ret = fchmod(fd, 0400);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "fchmod() failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = rename(tmp_path, filename_path);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Failed to rename \"%s\" to \"%s\" [%d]: %s\n",
+              tmp_path, filename_path, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    if (fd != -1) {
+        close(fd);
+    }
+    if (ret != EOK && fd != -1) {
+        unlink(tmp_path);
+    }
+    talloc_free(tmp_path);
+    return ret;
+}
+
 errno_t
 ipa_deskprofile_rules_save_rule_to_disk(
                                     TALLOC_CTX *mem_ctx,
@@ -686,7 +799,8 @@ ipa_deskprofile_rules_save_rule_to_disk(
                                     const char *hostname,
                                     const char *username, /* fully-qualified */
                                     uid_t uid,
-                                    gid_t gid)
+                                    gid_t gid,
+                                    char **_filename)
 {
     TALLOC_CTX *tmp_ctx;
     const char *rule_name;
@@ -705,7 +819,6 @@ ipa_deskprofile_rules_save_rule_to_disk(
     char *filename_path = NULL;
     const char *extension = "json";
     uint32_t prio;
-    int fd = -1;
     gid_t orig_gid;
     uid_t orig_uid;
     errno_t ret;
@@ -900,24 +1013,15 @@ ipa_deskprofile_rules_save_rule_to_disk(
         goto done;
     }
 
-    fd = open(filename_path, O_WRONLY | O_CREAT | O_TRUNC, 0400);
-    if (fd == -1) {
-        ret = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "Failed to create the Desktop Profile rule file \"%s\" "
-              "[%d]: %s\n",
-              filename_path, ret, sss_strerror(ret));
-        goto done;
-    }
-
-    ret = dprintf(fd, "%s", data);
-    if (ret < 0) {
-        ret = EIO;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "Failed to write the content of the Desktop Profile rule for "
-              "the \"%s\" file.\n",
+    if (ipa_deskprofile_rules_file_is_current(filename_path, data)) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "The Desktop Profile rule file \"%s\" is up to date\n",
               filename_path);
-        goto done;
+    } else {
+        ret = ipa_deskprofile_rules_write_file(tmp_ctx, filename_path, data);
+        if (ret != EOK) {
+            goto done;
+        }
     }
 
     ret = seteuid(orig_uid);
@@ -940,12 +1044,15 @@ ipa_deskprofile_rules_save_rule_to_disk(
         goto done;
     }
 
+    *_filename = talloc_strdup(mem_ctx, strrchr(filename_path, '/') + 1);
+    if (*_filename == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
     ret = EOK;
 
 done:
-    if (fd != -1) {
-        close(fd);
-    }
     if (geteuid() != orig_uid) {
         ret = seteuid(orig_uid);
         if (ret == -1) {
@@ -1078,6 +1185,111 @@ done:
     return ret;
 }
 
+errno_t
+ipa_deskprofile_rules_remove_stale_files(const char *user_dir,
+                                         const char **keep,
+                                         uid_t uid,
+                                         gid_t gid)
+{
+    DIR *dir = NULL;
+    struct dirent *entry;
+    gid_t orig_gid;
+    uid_t orig_uid;
+    size_t i;
+    errno_t ret;
+
+    orig_gid = getegid();
+    orig_uid = geteuid();
+
+    ret = setegid(gid);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Unable to set effective group id (%"PRIu32") of the domain's "
+              "process [%d]: %s\n",
+              gid, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = seteuid(uid);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Unable to set effective user id (%"PRIu32") of the domain's "
+              "process [%d]: %s\n",
+              uid, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    dir = opendir(user_dir);
+    if (dir == NULL) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot open \"%s\" directory [%d]: %s\n",
+              user_dir, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0
+                || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        for (i = 0; keep != NULL && keep[i] != NULL; i++) {
+            if (strcmp(entry->d_name, keep[i]) == 0) {
+                break;
+            }
+        }
+        if (keep != NULL && keep[i] != NULL) {
+            continue;
+        }
+
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Removing outdated Desktop Profile rule file \"%s/%s\"\n",
+              user_dir, entry->d_name);
+
+        ret = unlinkat(dirfd(dir), entry->d_name, 0);
+        if (ret == -1) {
+            ret = errno;
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "Cannot remove \"%s/%s\" [%d]: %s\n",
+                  user_dir, entry->d_name, ret, sss_strerror(ret));
+        }
+    }
+
+    ret = EOK;
+
+done:
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    if (geteuid() != orig_uid) {
+        if (seteuid(orig_uid) == -1) {
+            ret = errno;
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Unable to set effective user id (%"PRIu32") of the "
+                  "domain's process [%d]: %s\n",
+                  orig_uid, ret, sss_strerror(ret));
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Sending SIGUSR2 to the process: %d\n", getpid());
+            kill(getpid(), SIGUSR2);
+        }
+    }
+    if (getegid() != orig_gid) {
+        if (setegid(orig_gid) == -1) {
+            ret = errno;
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Unable to set effective group id (%"PRIu32") of the "
+                  "domain's process [%d]: %s\n",
+                  orig_gid, ret, sss_strerror(ret));
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Sending SIGUSR2 to the process: %d\n", getpid());
+            kill(getpid(), SIGUSR2);
+        }
+    }
+    return ret;
+}
+
 errno_t
 deskprofile_get_cached_priority(struct sss_domain_info *domain,
                                 uint16_t *_priority)
@@ -58,12 +58,21 @@ ipa_deskprofile_rules_save_rule_to_disk(
                                     const char *hostname,
                                     const char *username, /* fully-qualified */
                                     uid_t uid,
-                                    gid_t gid);
+                                    gid_t gid,
+                                    char **_filename);
 errno_t
 ipa_deskprofile_rules_remove_user_dir(const char *user_dir,
                                       uid_t uid,
                                       gid_t gid);
 
+/* Removes all files from the user directory that are not listed in the
+ * NULL-terminated keep array. */
+errno_t
+ipa_deskprofile_rules_remove_stale_files(const char *user_dir,
+                                         const char **keep,
+                                         uid_t uid,
+                                         gid_t gid);
+
 errno_t
 deskprofile_get_cached_priority(struct sss_domain_info *domain,
                                 uint16_t *_priority);
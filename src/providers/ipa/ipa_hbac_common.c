@@ -64,11 +64,6 @@ hbac_attrs_to_rule(TALLOC_CTX *mem_ctx,
                    size_t index,
                    struct hbac_rule **rule);
 
-static errno_t
-hbac_ctx_to_eval_request(TALLOC_CTX *mem_ctx,
-                         struct hbac_ctx *hbac_ctx,
-                         struct hbac_eval_req **request);
-
 errno_t
 hbac_ctx_to_rules(TALLOC_CTX *mem_ctx,
                   struct hbac_ctx *hbac_ctx,
@@ -81,7 +76,7 @@ hbac_ctx_to_rules(TALLOC_CTX *mem_ctx,
     size_t i;
     TALLOC_CTX *tmp_ctx = NULL;
 
-    if (!rules || !request) return EINVAL;
+    if (!rules) return EINVAL;
 
     tmp_ctx = talloc_new(mem_ctx);
     if (tmp_ctx == NULL) return ENOMEM;
@@ -106,15 +101,17 @@ hbac_ctx_to_rules(TALLOC_CTX *mem_ctx,
     }
     new_rules[i] = NULL;
 
-    /* Create the eval request */
-    ret = hbac_ctx_to_eval_request(tmp_ctx, hbac_ctx, &new_request);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Could not construct eval request\n");
-        goto done;
+    /* Create the eval request, unless only the rules are needed */
+    if (request != NULL) {
+        ret = hbac_ctx_to_eval_request(tmp_ctx, hbac_ctx, &new_request);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Could not construct eval request\n");
+            goto done;
+        }
+        *request = talloc_steal(mem_ctx, new_request);
     }
 
     *rules = talloc_steal(mem_ctx, new_rules);
-    *request = talloc_steal(mem_ctx, new_request);
     ret = EOK;
 
 done:
@@ -282,7 +279,7 @@ hbac_eval_host_element(TALLOC_CTX *mem_ctx,
                        const char *hostname,
                        struct hbac_request_element **host_element);
 
-static errno_t
+errno_t
 hbac_ctx_to_eval_request(TALLOC_CTX *mem_ctx,
                          struct hbac_ctx *hbac_ctx,
                          struct hbac_eval_req **request)
@@ -746,3 +743,124 @@ hbac_get_attrs_to_get_cached_rules(TALLOC_CTX *mem_ctx)
 done:
     return attrs;
 }
+
+static int ipa_hbac_compiled_destructor(struct ipa_hbac_compiled *cache)
+{
+    hbac_free_compiled_rules(cache->compiled);
+    return 0;
+}
+
+static errno_t ipa_hbac_cache_seq(struct sss_domain_info *domain,
+                                  uint64_t *_seq)
+{
+    int ret;
+
+    ret = ldb_sequence_number(sysdb_ctx_get_ldb(domain->sysdb),
+                              LDB_SEQ_HIGHEST_SEQ, _seq);
+    if (ret != LDB_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to read the sequence number of "
+              "the cache [%d]: %s\n", ret, ldb_strerror(ret));
+        return sysdb_error_to_errno(ret);
+    }
+
+    return EOK;
+}
+
+static errno_t ipa_hbac_compile_cached_rules(TALLOC_CTX *mem_ctx,
+                                             struct hbac_ctx *hbac_ctx,
+                                             uint64_t cache_seq,
+                                             struct ipa_hbac_compiled **_cache)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct ipa_hbac_compiled *cache;
+    const char **attrs_get_cached_rules;
+    enum hbac_error_code hret;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    cache = talloc_zero(tmp_ctx, struct ipa_hbac_compiled);
+    if (cache == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    talloc_set_destructor(cache, ipa_hbac_compiled_destructor);
+    cache->cache_seq = cache_seq;
+
+    /* Get HBAC rules from the sysdb */
+    attrs_get_cached_rules = hbac_get_attrs_to_get_cached_rules(tmp_ctx);
+    if (attrs_get_cached_rules == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "hbac_get_attrs_to_get_cached_rules() failed\n");
+        ret = ENOMEM;
+        goto done;
+    }
+    ret = ipa_common_get_cached_rules(tmp_ctx, hbac_ctx->be_ctx->domain,
+                                      IPA_HBAC_RULE, HBAC_RULES_SUBDIR,
+                                      attrs_get_cached_rules,
+                                      &hbac_ctx->rule_count, &hbac_ctx->rules);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not retrieve rules from the cache\n");
+        goto done;
+    }
+
+    ret = hbac_ctx_to_rules(cache, hbac_ctx, &cache->rules, NULL);
+    if (ret == EPERM) {
+        cache->deny_rules = true;
+    } else if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not construct HBAC rules\n");
+        goto done;
+    } else {
+        hret = hbac_compile_rules(cache->rules, &cache->compiled);
+        if (hret != HBAC_SUCCESS) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Could not compile HBAC rules [%s]\n",
+                  hbac_error_string(hret));
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Prepared %zu HBAC rules for evaluation\n",
+          hbac_ctx->rule_count);
+
+    *_cache = talloc_steal(mem_ctx, cache);
+    ret = EOK;
+
+done:
+    hbac_ctx->rule_count = 0;
+    hbac_ctx->rules = NULL;
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+errno_t
+ipa_hbac_get_compiled_rules(TALLOC_CTX *mem_ctx,
+                            struct hbac_ctx *hbac_ctx,
+                            struct ipa_hbac_compiled **_compiled)
+{
+    uint64_t cache_seq;
+    errno_t ret;
+
+    ret = ipa_hbac_cache_seq(hbac_ctx->be_ctx->domain, &cache_seq);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (*_compiled != NULL) {
+        if ((*_compiled)->cache_seq == cache_seq) {
+            return EOK;
+        }
+
+        /* A user or group that a rule refers to may have been cached,
+         * renamed or removed since the rules were compiled */
+        DEBUG(SSSDBG_TRACE_FUNC, "The cache has changed, "
+              "compiling the HBAC rules again\n");
+        talloc_zfree(*_compiled);
+    }
+
+    return ipa_hbac_compile_cached_rules(mem_ctx, hbac_ctx, cache_seq,
+                                         _compiled);
+}
@@ -53,17 +53,35 @@
 #define HBAC_SERVICES_SUBDIR "hbac_services"
 #define HBAC_SERVICEGROUPS_SUBDIR "hbac_servicegroups"
 
+/* HBAC rules of a domain prepared for evaluation */
+struct ipa_hbac_compiled {
+    struct hbac_rule **rules;
+    struct hbac_compiled_rules *compiled;
+
+    /* DENY rules are not supported, access is denied to everyone */
+    bool deny_rules;
+
+    /* Sequence number of the cache the rules were built from */
+    uint64_t cache_seq;
+};
+
 /* From ipa_hbac_common.c */
 errno_t
 replace_attribute_name(const char *old_name,
                        const char *new_name, const size_t count,
                        struct sysdb_attrs **list);
 
+/* request may be NULL if only the rules are needed */
 errno_t hbac_ctx_to_rules(TALLOC_CTX *mem_ctx,
                           struct hbac_ctx *hbac_ctx,
                           struct hbac_rule ***rules,
                           struct hbac_eval_req **request);
 
+errno_t
+hbac_ctx_to_eval_request(TALLOC_CTX *mem_ctx,
+                         struct hbac_ctx *hbac_ctx,
+                         struct hbac_eval_req **request);
+
 errno_t
 hbac_get_category(struct sysdb_attrs *attrs,
                   const char *category_attr,
@@ -87,6 +105,15 @@ hbac_shost_attrs_to_rule(TALLOC_CTX *mem_ctx,
 const char **
 hbac_get_attrs_to_get_cached_rules(TALLOC_CTX *mem_ctx);
 
+/* Reads and compiles the cached HBAC rules of hbac_ctx->be_ctx->domain
+ * unless *_compiled is still up to date. The rules name their users and
+ * groups as they were found in the cache, so any change of the cache
+ * makes them stale. */
+errno_t
+ipa_hbac_get_compiled_rules(TALLOC_CTX *mem_ctx,
+                            struct hbac_ctx *hbac_ctx,
+                            struct ipa_hbac_compiled **_compiled);
+
 /* From ipa_hbac_services.c */
 struct tevent_req *
 ipa_hbac_service_info_send(TALLOC_CTX *mem_ctx,
@@ -1170,29 +1170,46 @@ static const char *ipa_s2n_reqinp2str(TALLOC_CTX *mem_ctx,
     return str;
 }
 
+/* ipa_s2n_get_list_send() resolves a list of objects, e.g. the members of a
+ * group which are not cached yet. Each object needs its own extdom request,
+ * so instead of waiting for every reply before sending the next request up
+ * to ipa_extdom_window requests are outstanding on the connection. */
 struct ipa_s2n_get_list_state {
     struct tevent_context *ev;
     struct ipa_id_ctx *ipa_ctx;
     struct sss_domain_info *dom;
     struct sdap_handle *sh;
     enum extdom_protocol protocol;
-    struct req_input req_input;
+    enum req_input_type list_type;
     char **list;
     size_t list_idx;
     int exop_timeout;
     int entry_type;
     enum request_types request_type;
+    struct sysdb_attrs *mapped_attrs;
+
+    size_t window;
+    size_t outstanding;
+    /* parent of the outstanding lookups */
+    TALLOC_CTX *lookups;
+};
+
+struct ipa_s2n_get_list_lookup_state {
+    struct ipa_s2n_get_list_state *list_state;
+    const char *name;
+    struct req_input req_input;
     struct resp_attrs *attrs;
     struct sss_domain_info *obj_domain;
     struct sysdb_attrs *override_attrs;
-    struct sysdb_attrs *mapped_attrs;
 };
 
+static struct tevent_req *
+ipa_s2n_get_list_lookup_send(TALLOC_CTX *mem_ctx,
+                             struct ipa_s2n_get_list_state *list_state,
+                             const char *name);
+static errno_t ipa_s2n_get_list_lookup_recv(struct tevent_req *req);
 static errno_t ipa_s2n_get_list_step(struct tevent_req *req);
-static void ipa_s2n_get_list_get_override_done(struct tevent_req *subreq);
 static void ipa_s2n_get_list_next(struct tevent_req *subreq);
-static void ipa_s2n_get_list_ipa_next(struct tevent_req *subreq);
-static errno_t ipa_s2n_get_list_save_step(struct tevent_req *req);
 
 static struct tevent_req *ipa_s2n_get_list_send(TALLOC_CTX *mem_ctx,
                                                 struct tevent_context *ev,
@@ -1207,6 +1224,7 @@ static struct tevent_req *ipa_s2n_get_list_send(TALLOC_CTX *mem_ctx,
                                                 struct sysdb_attrs *mapped_attrs)
 {
     int ret;
+    int window;
     struct ipa_s2n_get_list_state *state;
     struct tevent_req *req;
 
@@ -1228,37 +1246,158 @@ static struct tevent_req *ipa_s2n_get_list_send(TALLOC_CTX *mem_ctx,
     state->dom = dom;
     state->sh = sh;
     state->protocol = extdom_preferred_protocol(sh);
+    state->list_type = list_type;
     state->list = list;
     state->list_idx = 0;
-    state->req_input.type = list_type;
-    state->req_input.inp.name = NULL;
     state->exop_timeout = exop_timeout;
     state->entry_type = entry_type;
     state->request_type = request_type;
-    state->attrs = NULL;
-    state->override_attrs = NULL;
     state->mapped_attrs = mapped_attrs;
 
+    window = dp_opt_get_int(ipa_ctx->ipa_options->basic, IPA_EXTDOM_WINDOW);
+    state->window = window > 0 ? window : 1;
+
+    state->lookups = talloc_new(state);
+    if (state->lookups == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (list == NULL || list[0] == NULL) {
+        ret = EOK;
+        goto done;
+    }
+
     ret = ipa_s2n_get_list_step(req);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_step failed.\n");
         goto done;
     }
 
+    return req;
+
 done:
-    if (ret != EOK) {
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else {
         tevent_req_error(req, ret);
-        tevent_req_post(req, ev);
     }
+    tevent_req_post(req, ev);
 
     return req;
 }
 
+/* Fill the window with lookups of the next list entries */
 static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
+{
+    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
+                                               struct ipa_s2n_get_list_state);
+    struct tevent_req *subreq;
+
+    while (state->outstanding < state->window
+                && state->list[state->list_idx] != NULL) {
+        subreq = ipa_s2n_get_list_lookup_send(state->lookups, state,
+                                              state->list[state->list_idx]);
+        if (subreq == NULL) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "ipa_s2n_get_list_lookup_send failed.\n");
+            return ENOMEM;
+        }
+        tevent_req_set_callback(subreq, ipa_s2n_get_list_next, req);
+
+        state->list_idx++;
+        state->outstanding++;
+    }
+
+    DEBUG(SSSDBG_TRACE_INTERNAL,
+          "%zu extdom lookups outstanding, %zu entries processed.\n",
+          state->outstanding, state->list_idx);
+
+    return EOK;
+}
+
+static void ipa_s2n_get_list_next(struct tevent_req *subreq)
 {
     int ret;
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
     struct ipa_s2n_get_list_state *state = tevent_req_data(req,
                                                struct ipa_s2n_get_list_state);
+
+    ret = ipa_s2n_get_list_lookup_recv(subreq);
+    talloc_zfree(subreq);
+    state->outstanding--;
+    if (ret != EOK) {
+        goto fail;
+    }
+
+    ret = ipa_s2n_get_list_step(req);
+    if (ret != EOK) {
+        goto fail;
+    }
+
+    if (state->outstanding == 0) {
+        tevent_req_done(req);
+    }
+
+    return;
+
+fail:
+    /* The remaining lookups would only add to the failed request */
+    talloc_zfree(state->lookups);
+    tevent_req_error(req, ret);
+    return;
+}
+
+static int ipa_s2n_get_list_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+static errno_t ipa_s2n_get_list_lookup_step(struct tevent_req *req);
+static void ipa_s2n_get_list_lookup_exop_done(struct tevent_req *subreq);
+static void ipa_s2n_get_list_lookup_ipa_done(struct tevent_req *subreq);
+static void ipa_s2n_get_list_lookup_override_done(struct tevent_req *subreq);
+static errno_t ipa_s2n_get_list_lookup_save(struct tevent_req *req);
+
+static struct tevent_req *
+ipa_s2n_get_list_lookup_send(TALLOC_CTX *mem_ctx,
+                             struct ipa_s2n_get_list_state *list_state,
+                             const char *name)
+{
+    int ret;
+    struct ipa_s2n_get_list_lookup_state *state;
+    struct tevent_req *req;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct ipa_s2n_get_list_lookup_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->list_state = list_state;
+    state->name = name;
+    state->req_input.type = list_state->list_type;
+    state->req_input.inp.name = NULL;
+
+    ret = ipa_s2n_get_list_lookup_step(req);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_lookup_step failed.\n");
+        tevent_req_error(req, ret);
+        tevent_req_post(req, list_state->ev);
+    }
+
+    return req;
+}
+
+static errno_t ipa_s2n_get_list_lookup_step(struct tevent_req *req)
+{
+    int ret;
+    struct ipa_s2n_get_list_lookup_state *state = tevent_req_data(req,
+                                        struct ipa_s2n_get_list_lookup_state);
+    struct ipa_s2n_get_list_state *ls = state->list_state;
     struct berval *bv_req;
     struct tevent_req *subreq;
     struct sss_domain_info *parent_domain;
@@ -1268,16 +1407,15 @@ static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
     char *endptr;
     struct dp_id_data *ar;
 
-    parent_domain = get_domains_head(state->dom);
+    parent_domain = get_domains_head(ls->dom);
     switch (state->req_input.type) {
     case REQ_INP_NAME:
 
-        ret = sss_parse_name(state, state->dom->names, state->list[state->list_idx],
+        ret = sss_parse_name(state, ls->dom->names, state->name,
                              &domain_name, &short_name);
         if (ret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Unable to parse name '%s' [%d]: %s\n",
-                                        state->list[state->list_idx],
-                                        ret, sss_strerror(ret));
+                                        state->name, ret, sss_strerror(ret));
             return ret;
         }
 
@@ -1295,30 +1433,29 @@ static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
         state->req_input.inp.name = short_name;
 
         if (strcmp(state->obj_domain->name,
-            state->ipa_ctx->sdap_id_ctx->be->domain->name) == 0) {
+            ls->ipa_ctx->sdap_id_ctx->be->domain->name) == 0) {
             DEBUG(SSSDBG_TRACE_INTERNAL,
-                  "Looking up IPA object [%s] from LDAP.\n",
-                  state->list[state->list_idx]);
-            ret = get_dp_id_data_for_user_name(state,
-                                               state->list[state->list_idx],
+                  "Looking up IPA object [%s] from LDAP.\n", state->name);
+            ret = get_dp_id_data_for_user_name(state, state->name,
                                                state->obj_domain->name,
                                                &ar);
             if (ret != EOK) {
                 DEBUG(SSSDBG_OP_FAILURE,
                       "Failed to create lookup date for IPA object [%s].\n",
-                      state->list[state->list_idx]);
+                      state->name);
                 return ret;
             }
-            ar->entry_type = state->entry_type;
+            ar->entry_type = ls->entry_type;
 
-            subreq = ipa_id_get_account_info_send(state, state->ev,
-                                                  state->ipa_ctx, ar);
+            subreq = ipa_id_get_account_info_send(state, ls->ev,
+                                                  ls->ipa_ctx, ar);
             if (subreq == NULL) {
                 DEBUG(SSSDBG_OP_FAILURE,
                       "ipa_id_get_account_info_send failed.\n");
                 return ENOMEM;
             }
-            tevent_req_set_callback(subreq, ipa_s2n_get_list_ipa_next, req);
+            tevent_req_set_callback(subreq, ipa_s2n_get_list_lookup_ipa_done,
+                                    req);
 
             return EOK;
         }
@@ -1326,18 +1463,17 @@ static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
         break;
     case REQ_INP_ID:
         errno = 0;
-        id = strtouint32(state->list[state->list_idx], &endptr, 10);
-        if (errno != 0 || *endptr != '\0'
-                || (state->list[state->list_idx] == endptr)) {
+        id = strtouint32(state->name, &endptr, 10);
+        if (errno != 0 || *endptr != '\0' || (state->name == endptr)) {
             DEBUG(SSSDBG_OP_FAILURE, "strtouint32 failed.\n");
             return EINVAL;
         }
         state->req_input.inp.id = id;
-        state->obj_domain = state->dom;
+        state->obj_domain = ls->dom;
 
         break;
     case REQ_INP_SECID:
-        state->req_input.inp.secid = state->list[state->list_idx];
+        state->req_input.inp.secid = state->name;
         state->obj_domain = find_domain_by_sid(parent_domain,
                                                state->req_input.inp.secid);
         if (state->obj_domain == NULL) {
@@ -1354,15 +1490,16 @@ static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
         return EINVAL;
     }
 
-    ret = s2n_encode_request(state, state->obj_domain->name, state->entry_type,
-                             state->request_type, &state->req_input,
-                             state->protocol, &bv_req);
+    ret = s2n_encode_request(state, state->obj_domain->name, ls->entry_type,
+                             ls->request_type, &state->req_input,
+                             ls->protocol, &bv_req);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "s2n_encode_request failed.\n");
         return ret;
     }
 
-    if (state->request_type == REQ_FULL_WITH_MEMBERS && state->protocol == EXTDOM_V0) {
+    if (ls->request_type == REQ_FULL_WITH_MEMBERS
+            && ls->protocol == EXTDOM_V0) {
         DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_exop failed, protocol > V0 needed for this request.\n");
         return EINVAL;
     }
@@ -1371,28 +1508,28 @@ static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
             && state->req_input.inp.name != NULL) {
         DEBUG(SSSDBG_TRACE_FUNC,
               "Sending request_type: [%s] for object [%s].\n",
-              ipa_s2n_reqtype2str(state->request_type),
-              state->list[state->list_idx]);
+              ipa_s2n_reqtype2str(ls->request_type), state->name);
     }
 
-    subreq = ipa_s2n_exop_send(state, state->ev, state->sh, state->protocol,
-                               state->exop_timeout, bv_req);
+    subreq = ipa_s2n_exop_send(state, ls->ev, ls->sh, ls->protocol,
+                               ls->exop_timeout, bv_req);
     if (subreq == NULL) {
         DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_exop_send failed.\n");
         return ENOMEM;
     }
-    tevent_req_set_callback(subreq, ipa_s2n_get_list_next, req);
+    tevent_req_set_callback(subreq, ipa_s2n_get_list_lookup_exop_done, req);
 
     return EOK;
 }
 
-static void ipa_s2n_get_list_next(struct tevent_req *subreq)
+static void ipa_s2n_get_list_lookup_exop_done(struct tevent_req *subreq)
 {
     int ret;
     struct tevent_req *req = tevent_req_callback_data(subreq,
                                                       struct tevent_req);
-    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
-                                               struct ipa_s2n_get_list_state);
+    struct ipa_s2n_get_list_lookup_state *state = tevent_req_data(req,
+                                        struct ipa_s2n_get_list_lookup_state);
+    struct ipa_s2n_get_list_state *ls = state->list_state;
     char *retoid = NULL;
     struct berval *retdata = NULL;
     const char *sid_str;
@@ -1405,8 +1542,7 @@ static void ipa_s2n_get_list_next(struct tevent_req *subreq)
         goto fail;
     }
 
-    talloc_zfree(state->attrs);
-    ret = s2n_response_to_attrs(state, state->dom, retoid, retdata,
+    ret = s2n_response_to_attrs(state, ls->dom, retoid, retdata,
                                 &state->attrs);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "s2n_response_to_attrs failed.\n");
@@ -1416,15 +1552,13 @@ static void ipa_s2n_get_list_next(struct tevent_req *subreq)
     DEBUG(SSSDBG_TRACE_FUNC, "Received [%s] attributes from IPA server.\n",
                              state->attrs->a.name);
 
-    if (is_default_view(state->ipa_ctx->view_name)) {
-        ret = ipa_s2n_get_list_save_step(req);
-        if (ret == EOK) {
-            tevent_req_done(req);
-        } else if (ret != EAGAIN) {
-            DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_save_step failed.\n");
+    if (is_default_view(ls->ipa_ctx->view_name)) {
+        ret = ipa_s2n_get_list_lookup_save(req);
+        if (ret != EOK) {
             goto fail;
         }
 
+        tevent_req_done(req);
         return;
     }
 
@@ -1444,19 +1578,20 @@ static void ipa_s2n_get_list_next(struct tevent_req *subreq)
         goto fail;
     }
 
-    subreq = ipa_get_ad_override_send(state, state->ev,
-                           state->ipa_ctx->sdap_id_ctx,
-                           state->ipa_ctx->ipa_options,
-                           dp_opt_get_string(state->ipa_ctx->ipa_options->basic,
+    subreq = ipa_get_ad_override_send(state, ls->ev,
+                           ls->ipa_ctx->sdap_id_ctx,
+                           ls->ipa_ctx->ipa_options,
+                           dp_opt_get_string(ls->ipa_ctx->ipa_options->basic,
                                              IPA_KRB5_REALM),
-                           state->ipa_ctx->view_name,
+                           ls->ipa_ctx->view_name,
                            ar);
     if (subreq == NULL) {
         DEBUG(SSSDBG_OP_FAILURE, "ipa_get_ad_override_send failed.\n");
         ret = ENOMEM;
         goto fail;
     }
-    tevent_req_set_callback(subreq, ipa_s2n_get_list_get_override_done, req);
+    tevent_req_set_callback(subreq, ipa_s2n_get_list_lookup_override_done,
+                            req);
 
     return;
 
@@ -1465,49 +1600,32 @@ fail:
     return;
 }
 
-static void ipa_s2n_get_list_ipa_next(struct tevent_req *subreq)
+static void ipa_s2n_get_list_lookup_ipa_done(struct tevent_req *subreq)
 {
     int ret;
     int dp_error;
     struct tevent_req *req = tevent_req_callback_data(subreq,
                                                       struct tevent_req);
-    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
-                                               struct ipa_s2n_get_list_state);
 
     ret = ipa_id_get_account_info_recv(subreq, &dp_error);
     talloc_zfree(subreq);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "ipa_id_get_account_info failed: %d %d\n", ret,
                                  dp_error);
-        goto done;
-    }
-
-    state->list_idx++;
-    if (state->list[state->list_idx] == NULL) {
-        tevent_req_done(req);
+        tevent_req_error(req, ret);
         return;
     }
 
-    ret = ipa_s2n_get_list_step(req);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_step failed.\n");
-        goto done;
-    }
-
-    return;
-
-done:
-    tevent_req_error(req,ret);
-    return;
+    tevent_req_done(req);
 }
 
-static void ipa_s2n_get_list_get_override_done(struct tevent_req *subreq)
+static void ipa_s2n_get_list_lookup_override_done(struct tevent_req *subreq)
 {
     int ret;
     struct tevent_req *req = tevent_req_callback_data(subreq,
                                                       struct tevent_req);
-    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
-                                               struct ipa_s2n_get_list_state);
+    struct ipa_s2n_get_list_lookup_state *state = tevent_req_data(req,
+                                        struct ipa_s2n_get_list_lookup_state);
 
     ret = ipa_get_ad_override_recv(subreq, NULL, state, &state->override_attrs);
     talloc_zfree(subreq);
@@ -1516,14 +1634,12 @@ static void ipa_s2n_get_list_get_override_done(struct tevent_req *subreq)
         goto fail;
     }
 
-    ret = ipa_s2n_get_list_save_step(req);
-    if (ret == EOK) {
-        tevent_req_done(req);
-    } else if (ret != EAGAIN) {
-        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_save_step failed.\n");
+    ret = ipa_s2n_get_list_lookup_save(req);
+    if (ret != EOK) {
         goto fail;
     }
 
+    tevent_req_done(req);
     return;
 
 fail:
@@ -1531,36 +1647,26 @@ fail:
     return;
 }
 
-static errno_t ipa_s2n_get_list_save_step(struct tevent_req *req)
+static errno_t ipa_s2n_get_list_lookup_save(struct tevent_req *req)
 {
     int ret;
-    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
-                                               struct ipa_s2n_get_list_state);
+    struct ipa_s2n_get_list_lookup_state *state = tevent_req_data(req,
+                                        struct ipa_s2n_get_list_lookup_state);
+    struct ipa_s2n_get_list_state *ls = state->list_state;
 
-    ret = ipa_s2n_save_objects(state->dom, &state->req_input, state->attrs,
-                               NULL, state->ipa_ctx->view_name,
-                               state->override_attrs, state->mapped_attrs,
+    ret = ipa_s2n_save_objects(ls->dom, &state->req_input, state->attrs,
+                               NULL, ls->ipa_ctx->view_name,
+                               state->override_attrs, ls->mapped_attrs,
                                false);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_save_objects failed.\n");
         return ret;
     }
 
-    state->list_idx++;
-    if (state->list[state->list_idx] == NULL) {
-        return EOK;
-    }
-
-    ret = ipa_s2n_get_list_step(req);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_step failed.\n");
-        return ret;
-    }
-
-    return EAGAIN;
+    return EOK;
 }
 
-static int ipa_s2n_get_list_recv(struct tevent_req *req)
+static errno_t ipa_s2n_get_list_lookup_recv(struct tevent_req *req)
 {
     TEVENT_REQ_RETURN_ON_ERROR(req);
 
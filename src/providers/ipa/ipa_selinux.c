@@ -35,6 +35,7 @@
 #include "providers/ipa/ipa_hbac_private.h"
 #include "providers/ipa/ipa_access.h"
 #include "providers/ipa/ipa_selinux_maps.h"
+#include "providers/ipa/ipa_selinux_applied.h"
 #include "providers/ipa/ipa_subdomains.h"
 #include "providers/ipa/ipa_rules_common.h"
 
@@ -562,20 +563,21 @@ struct selinux_child_state {
     struct selinux_child_input *sci;
     struct tevent_context *ev;
     struct io_buffer *buf;
-    struct child_io_fds *io;
 };
 
 static errno_t selinux_child_init(void);
 static errno_t selinux_child_create_buffer(struct selinux_child_state *state);
-static errno_t selinux_fork_child(struct selinux_child_state *state);
-static void selinux_child_step(struct tevent_req *subreq);
+static errno_t selinux_child_pool_init(struct ipa_selinux_ctx *selinux_ctx,
+                                       struct tevent_context *ev);
 static void selinux_child_done(struct tevent_req *subreq);
 static errno_t selinux_child_parse_response(uint8_t *buf, ssize_t len,
                                             uint32_t *_child_result);
 
-static struct tevent_req *selinux_child_send(TALLOC_CTX *mem_ctx,
-                                             struct tevent_context *ev,
-                                             struct selinux_child_input *sci)
+static struct tevent_req *
+selinux_child_send(TALLOC_CTX *mem_ctx,
+                   struct tevent_context *ev,
+                   struct ipa_selinux_ctx *selinux_ctx,
+                   struct selinux_child_input *sci)
 {
     struct tevent_req *req;
     struct tevent_req *subreq;
@@ -590,18 +592,13 @@ static struct tevent_req *selinux_child_send(TALLOC_CTX *mem_ctx,
 
     state->sci = sci;
     state->ev = ev;
-    state->io = talloc(state, struct child_io_fds);
     state->buf = talloc(state, struct io_buffer);
-    if (state->io == NULL || state->buf == NULL) {
+    if (state->buf == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "talloc failed.\n");
         ret = ENOMEM;
         goto immediately;
     }
 
-    state->io->write_to_child_fd = -1;
-    state->io->read_from_child_fd = -1;
-    talloc_set_destructor((void *) state->io, child_io_destructor);
-
     ret = selinux_child_init();
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "Failed to init the child\n");
@@ -615,19 +612,21 @@ static struct tevent_req *selinux_child_send(TALLOC_CTX *mem_ctx,
         goto immediately;
     }
 
-    ret = selinux_fork_child(state);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "Failed to fork the child\n");
-        goto immediately;
+    if (selinux_ctx->child_pool == NULL) {
+        ret = selinux_child_pool_init(selinux_ctx, ev);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Failed to set up the child pool\n");
+            goto immediately;
+        }
     }
 
-    subreq = write_pipe_send(state, ev, state->buf->data, state->buf->size,
-                             state->io->write_to_child_fd);
+    subreq = sss_child_pool_send(state, ev, selinux_ctx->child_pool,
+                                 state->buf->data, state->buf->size);
     if (subreq == NULL) {
         ret = ENOMEM;
         goto immediately;
     }
-    tevent_req_set_callback(subreq, selinux_child_step, req);
+    tevent_req_set_callback(subreq, selinux_child_done, req);
 
     ret = EOK;
 immediately:
@@ -685,87 +684,22 @@ static errno_t selinux_child_create_buffer(struct selinux_child_state *state)
     return EOK;
 }
 
-static errno_t selinux_fork_child(struct selinux_child_state *state)
-{
-    int pipefd_to_child[2];
-    int pipefd_from_child[2];
-    pid_t pid;
-    errno_t ret;
-
-    ret = pipe(pipefd_from_child);
-    if (ret == -1) {
-        ret = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "pipe failed [%d][%s].\n", errno, sss_strerror(errno));
-        return ret;
-    }
-
-    ret = pipe(pipefd_to_child);
-    if (ret == -1) {
-        ret = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "pipe failed [%d][%s].\n", errno, sss_strerror(errno));
-        return ret;
-    }
-
-    pid = fork();
-
-    if (pid == 0) { /* child */
-        exec_child(state, pipefd_to_child, pipefd_from_child,
-                   SELINUX_CHILD, selinux_child_debug_fd);
-        DEBUG(SSSDBG_CRIT_FAILURE, "Could not exec selinux_child: [%d][%s].\n",
-              ret, sss_strerror(ret));
-        return ret;
-    } else if (pid > 0) { /* parent */
-        state->io->read_from_child_fd = pipefd_from_child[0];
-        close(pipefd_from_child[1]);
-        state->io->write_to_child_fd = pipefd_to_child[1];
-        close(pipefd_to_child[0]);
-        sss_fd_nonblocking(state->io->read_from_child_fd);
-        sss_fd_nonblocking(state->io->write_to_child_fd);
-
-        ret = child_handler_setup(state->ev, pid, NULL, NULL, NULL);
-        if (ret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE,
-                  "Could not set up child signal handler\n");
-            return ret;
-        }
-    } else { /* error */
-        ret = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "fork failed [%d][%s].\n", errno, sss_strerror(errno));
-        return ret;
-    }
-
-    return EOK;
-}
-
-static void selinux_child_step(struct tevent_req *subreq)
+/* Each selinux_child runs its own semanage transaction. They would only
+ * compete for the semanage lock, so one request is handled at a time. */
+static errno_t selinux_child_pool_init(struct ipa_selinux_ctx *selinux_ctx,
+                                       struct tevent_context *ev)
 {
-    struct tevent_req *req;
-    errno_t ret;
-    struct selinux_child_state *state;
-
-
-    req = tevent_req_callback_data(subreq, struct tevent_req);
-    state = tevent_req_data(req, struct selinux_child_state);
-
-    ret = write_pipe_recv(subreq);
-    talloc_zfree(subreq);
-    if (ret != EOK) {
-        tevent_req_error(req, ret);
-        return;
-    }
+    struct sss_child_pool_opts opts = { 0 };
 
-    close(state->io->write_to_child_fd);
-    state->io->write_to_child_fd = -1;
+    opts.name = "selinux_child";
+    opts.binary = SELINUX_CHILD;
+    opts.debug_fd = selinux_child_debug_fd;
+    opts.child_out_fd = STDOUT_FILENO;
+    opts.max_running = 1;
+    opts.max_requests = 1;
 
-    subreq = read_pipe_send(state, state->ev, state->io->read_from_child_fd);
-    if (subreq == NULL) {
-        tevent_req_error(req, ENOMEM);
-        return;
-    }
-    tevent_req_set_callback(subreq, selinux_child_done, req);
+    return sss_child_pool_create(selinux_ctx, ev, &opts,
+                                 &selinux_ctx->child_pool);
 }
 
 static void selinux_child_done(struct tevent_req *subreq)
@@ -780,16 +714,13 @@ static void selinux_child_done(struct tevent_req *subreq)
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct selinux_child_state);
 
-    ret = read_pipe_recv(subreq, state, &buf, &len);
+    ret = sss_child_pool_recv(subreq, state, &buf, &len, NULL);
     talloc_zfree(subreq);
     if (ret != EOK) {
         tevent_req_error(req, ret);
         return;
     }
 
-    close(state->io->read_from_child_fd);
-    state->io->read_from_child_fd = -1;
-
     ret = selinux_child_parse_response(buf, len, &child_result);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE,
@@ -1528,6 +1459,8 @@ struct ipa_selinux_handler_state {
 
     struct sysdb_attrs *user;
     struct sysdb_attrs *host;
+
+    struct selinux_child_input *sci;
 };
 
 static void ipa_selinux_handler_get_done(struct tevent_req *subreq);
@@ -1638,10 +1571,22 @@ static void ipa_selinux_handler_get_done(struct tevent_req *subreq)
         goto done;
     }
 
+    if (ipa_selinux_label_is_applied(state->selinux_ctx, sci->username,
+                                     sci->seuser, sci->mls_range)) {
+        DEBUG(SSSDBG_TRACE_FUNC, "SELinux label of [%s] is up to date, "
+              "not starting selinux_child\n", sci->username);
+        if (!be_is_offline(state->be_ctx)) {
+            state->selinux_ctx->last_update = time(NULL);
+        }
+        state->pd->pam_status = PAM_SUCCESS;
+        goto done;
+    }
+    state->sci = sci;
+
     /* Update the SELinux context in a privileged child as the back end is
      * running unprivileged
      */
-    subreq = selinux_child_send(state, state->ev, sci);
+    subreq = selinux_child_send(state, state->ev, state->selinux_ctx, sci);
     if (subreq == NULL) {
         ret = ENOMEM;
         goto done;
@@ -1666,10 +1611,14 @@ static void ipa_selinux_handler_done(struct tevent_req *subreq)
     ret = selinux_child_recv(subreq);
     talloc_free(subreq);
     if (ret != EOK) {
+        ipa_selinux_label_forget(state->selinux_ctx, state->sci->username);
         state->pd->pam_status = PAM_SYSTEM_ERR;
         goto done;
     }
 
+    ipa_selinux_label_remember(state->selinux_ctx, state->sci->username,
+                               state->sci->seuser, state->sci->mls_range);
+
     if (!be_is_offline(state->be_ctx)) {
         state->selinux_ctx->last_update = time(NULL);
     }
@@ -27,9 +27,15 @@
 
 #include "providers/ldap/ldap_common.h"
 
+struct sss_child_pool;
+
 struct ipa_selinux_ctx {
     struct ipa_id_ctx *id_ctx;
     time_t last_update;
+    /* selinux_child processes, set up by the first request */
+    struct sss_child_pool *child_pool;
+    /* user name -> label installed by selinux_child */
+    hash_table_t *applied;
 
     struct sdap_search_base **selinux_search_bases;
     struct sdap_search_base **host_search_bases;
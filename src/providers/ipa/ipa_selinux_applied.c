@@ -0,0 +1,193 @@
+/*
+    SSSD
+
+    IPA Backend Module -- SELinux labels installed by selinux_child
+
+    Copyright (C) 2019 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <sys/stat.h>
+#include <selinux/selinux.h>
+
+#include "util/util.h"
+#include "providers/ipa/ipa_selinux_applied.h"
+
+/* selinux_child only modifies the SELinux login mappings when they differ
+ * from the label it is asked to install. The label installed for a user is
+ * therefore remembered together with the state of the seusers file of the
+ * policy, which semanage rewrites on each change. As long as the file is
+ * unchanged, installing the same label again would be a no-op and the child
+ * does not need to be started at all. */
+struct selinux_seusers_stamp {
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+};
+
+struct selinux_applied_label {
+    char *seuser;
+    char *mls_range;
+    struct selinux_seusers_stamp stamp;
+};
+
+static errno_t selinux_seusers_stamp(struct selinux_seusers_stamp *stamp)
+{
+    const char *path;
+    struct stat st;
+    errno_t ret;
+
+    path = selinux_usersconf_path();
+    if (path == NULL) {
+        return ENOENT;
+    }
+
+    ret = stat(path, &st);
+    if (ret != 0) {
+        ret = errno;
+        DEBUG(SSSDBG_TRACE_INTERNAL, "Cannot stat [%s] [%d]: %s\n",
+              path, ret, sss_strerror(ret));
+        return ret;
+    }
+
+    memset(stamp, 0, sizeof(struct selinux_seusers_stamp));
+    stamp->dev = st.st_dev;
+    stamp->ino = st.st_ino;
+    stamp->size = st.st_size;
+    stamp->mtime = st.st_mtim;
+
+    return EOK;
+}
+
+static bool selinux_seusers_stamp_equal(struct selinux_seusers_stamp *a,
+                                        struct selinux_seusers_stamp *b)
+{
+    return a->dev == b->dev
+        && a->ino == b->ino
+        && a->size == b->size
+        && a->mtime.tv_sec == b->mtime.tv_sec
+        && a->mtime.tv_nsec == b->mtime.tv_nsec;
+}
+
+bool ipa_selinux_label_is_applied(struct ipa_selinux_ctx *selinux_ctx,
+                                  const char *username,
+                                  const char *seuser,
+                                  const char *mls_range)
+{
+    struct selinux_applied_label *applied;
+    struct selinux_seusers_stamp stamp;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+
+    if (selinux_ctx->applied == NULL) {
+        return false;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(username);
+
+    if (hash_lookup(selinux_ctx->applied, &key, &value) != HASH_SUCCESS) {
+        return false;
+    }
+    applied = talloc_get_type(value.ptr, struct selinux_applied_label);
+
+    if (strcmp(applied->seuser, seuser) != 0
+            || strcmp(applied->mls_range, mls_range) != 0) {
+        return false;
+    }
+
+    ret = selinux_seusers_stamp(&stamp);
+    if (ret != EOK) {
+        return false;
+    }
+
+    return selinux_seusers_stamp_equal(&applied->stamp, &stamp);
+}
+
+void ipa_selinux_label_forget(struct ipa_selinux_ctx *selinux_ctx,
+                              const char *username)
+{
+    hash_key_t key;
+    hash_value_t value;
+
+    if (selinux_ctx->applied == NULL) {
+        return;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(username);
+
+    if (hash_lookup(selinux_ctx->applied, &key, &value) == HASH_SUCCESS) {
+        talloc_free(value.ptr);
+        hash_delete(selinux_ctx->applied, &key);
+    }
+}
+
+void ipa_selinux_label_remember(struct ipa_selinux_ctx *selinux_ctx,
+                                const char *username,
+                                const char *seuser,
+                                const char *mls_range)
+{
+    struct selinux_applied_label *applied;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    ipa_selinux_label_forget(selinux_ctx, username);
+
+    if (selinux_ctx->applied != NULL
+            && hash_count(selinux_ctx->applied) >= SELINUX_APPLIED_MAX) {
+        talloc_zfree(selinux_ctx->applied);
+    }
+
+    if (selinux_ctx->applied == NULL) {
+        ret = sss_hash_create(selinux_ctx, 0, &selinux_ctx->applied);
+        if (ret != EOK) {
+            return;
+        }
+    }
+
+    applied = talloc_zero(selinux_ctx->applied, struct selinux_applied_label);
+    if (applied == NULL) {
+        return;
+    }
+
+    ret = selinux_seusers_stamp(&applied->stamp);
+    if (ret != EOK) {
+        /* nothing to compare against later */
+        talloc_free(applied);
+        return;
+    }
+
+    applied->seuser = talloc_strdup(applied, seuser);
+    applied->mls_range = talloc_strdup(applied, mls_range);
+    if (applied->seuser == NULL || applied->mls_range == NULL) {
+        talloc_free(applied);
+        return;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(username);
+    value.type = HASH_VALUE_PTR;
+    value.ptr = applied;
+
+    hret = hash_enter(selinux_ctx->applied, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        talloc_free(applied);
+    }
+}
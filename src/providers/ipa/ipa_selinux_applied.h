@@ -0,0 +1,43 @@
+/*
+    SSSD
+
+    IPA Backend Module -- SELinux labels installed by selinux_child
+
+    Copyright (C) 2019 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _IPA_SELINUX_APPLIED_H_
+#define _IPA_SELINUX_APPLIED_H_
+
+#include "providers/ipa/ipa_selinux.h"
+
+/* Upper limit of users whose installed label is remembered */
+#define SELINUX_APPLIED_MAX 1024
+
+bool ipa_selinux_label_is_applied(struct ipa_selinux_ctx *selinux_ctx,
+                                  const char *username,
+                                  const char *seuser,
+                                  const char *mls_range);
+
+void ipa_selinux_label_remember(struct ipa_selinux_ctx *selinux_ctx,
+                                const char *username,
+                                const char *seuser,
+                                const char *mls_range);
+
+void ipa_selinux_label_forget(struct ipa_selinux_ctx *selinux_ctx,
+                              const char *username);
+
+#endif /* _IPA_SELINUX_APPLIED_H_ */
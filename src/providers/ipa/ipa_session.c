@@ -525,19 +525,6 @@ ipa_pam_session_handler_send(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
-    /* As no proper merging mechanism has been implemented yet ...
-     * let's just remove the user directory stored in the disk as it's
-     * going to be created again in case there's any rule fetched. */
-    ret = ipa_deskprofile_rules_remove_user_dir(state->user_dir,
-                                                state->uid,
-                                                state->gid);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "ipa_deskprofile_rules_remove_user_dir() failed.\n");
-        state->pd->pam_status = PAM_SESSION_ERR;
-        goto done;
-    }
-
     subreq = ipa_fetch_deskprofile_send(state, state->ev, state->be_ctx,
                                         state->session_ctx, pd->user);
     if (subreq == NULL) {
@@ -569,6 +556,19 @@ ipa_pam_session_handler_done(struct tevent_req *subreq)
     ret = ipa_fetch_deskprofile_recv(subreq);
     talloc_free(subreq);
 
+    if (ret != EOK) {
+        /* The rule files from the previous session must not be applied,
+         * so the user directory is removed. */
+        if (ipa_deskprofile_rules_remove_user_dir(state->user_dir,
+                                                  state->uid,
+                                                  state->gid) != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "ipa_deskprofile_rules_remove_user_dir() failed.\n");
+            state->pd->pam_status = PAM_SESSION_ERR;
+            goto done;
+        }
+    }
+
     if (ret == ENOENT) {
         DEBUG(SSSDBG_IMPORTANT_INFO, "No Desktop Profile rules found\n");
         if (!state->session_ctx->no_rules_found) {
@@ -711,6 +711,9 @@ ipa_pam_session_handler_save_deskprofile_rules(
     const char **attrs_get_cached_rules;
     size_t rule_count;
     struct sysdb_attrs **rules;
+    const char **files;
+    size_t file_count = 0;
+    char *filename;
     uint16_t priority;
     errno_t ret;
 
@@ -758,7 +761,14 @@ ipa_pam_session_handler_save_deskprofile_rules(
         goto done;
     }
 
-    /* Save the rules to the disk */
+    files = talloc_zero_array(tmp_ctx, const char *, rule_count + 1);
+    if (files == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* Save the rules to the disk. Files whose content did not change since
+     * the previous session are left untouched. */
     for (size_t i = 0; i < rule_count; i++) {
         ret = ipa_deskprofile_rules_save_rule_to_disk(tmp_ctx,
                                                       priority,
@@ -767,13 +777,24 @@ ipa_pam_session_handler_save_deskprofile_rules(
                                                       hostname,
                                                       username,
                                                       uid,
-                                                      gid);
+                                                      gid,
+                                                      &filename);
         if (ret != EOK) {
             DEBUG(SSSDBG_OP_FAILURE,
                   "Failed to save a Desktop Profile Rule to disk [%d]: %s\n",
                   ret, sss_strerror(ret));
             continue;
         }
+        files[file_count++] = filename;
+    }
+
+    /* Remove the files of rules that no longer apply */
+    ret = ipa_deskprofile_rules_remove_stale_files(user_dir, files, uid, gid);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Cannot remove outdated Desktop Profile rules [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
     }
 
     /* Notify FleetCommander that our side is done */
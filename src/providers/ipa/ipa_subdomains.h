@@ -79,6 +79,9 @@ ipa_server_create_trusts_send(TALLOC_CTX *mem_ctx,
 
 errno_t ipa_server_create_trusts_recv(struct tevent_req *req);
 
+/* Trusted forests whose keytabs are retrieved at the same time */
+#define IPA_TRUST_SETUP_MAX_RUNNING 4
+
 void ipa_ad_subdom_remove(struct be_ctx *be_ctx,
                           struct ipa_id_ctx *id_ctx,
                           struct sss_domain_info *subdom);
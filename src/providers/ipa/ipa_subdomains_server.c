@@ -849,16 +849,38 @@ errno_t ipa_server_trusted_dom_setup_recv(struct tevent_req *req)
     return EOK;
 }
 
+/* All new subdomains of one trusted forest share the forest keytab, so it
+ * is only retrieved once for all of them. */
+struct ipa_server_trust_forest {
+    struct ipa_server_trust_forest *prev;
+    struct ipa_server_trust_forest *next;
+    struct tevent_req *req;
+
+    const char *forest;
+    struct sss_domain_info **doms;
+    size_t num_doms;
+
+    /* ID contexts were created using the keytab of a previous run */
+    bool has_ctx;
+};
+
 struct ipa_server_create_trusts_state {
     struct tevent_context *ev;
     struct be_ctx *be_ctx;
     struct ipa_id_ctx *id_ctx;
-    struct sss_domain_info *domiter;
+
+    struct ipa_server_trust_forest *pending;
+    size_t running;
+    errno_t error;
 };
 
+static errno_t ipa_server_create_trusts_group(struct tevent_req *req,
+                                             struct sss_domain_info *parent);
+static errno_t ipa_server_create_trusts_ctx(struct tevent_req *req,
+                                            struct ipa_server_trust_forest *f);
 static errno_t ipa_server_create_trusts_step(struct tevent_req *req);
-static errno_t ipa_server_create_trusts_ctx(struct tevent_req *req);
 static void ipa_server_create_trusts_done(struct tevent_req *subreq);
+static void ipa_server_create_trusts_finish(struct tevent_req *req);
 
 struct tevent_req *
 ipa_server_create_trusts_send(TALLOC_CTX *mem_ctx,
@@ -869,6 +891,7 @@ ipa_server_create_trusts_send(TALLOC_CTX *mem_ctx,
 {
     struct tevent_req *req = NULL;
     struct ipa_server_create_trusts_state *state = NULL;
+    struct ipa_server_trust_forest *forest;
     errno_t ret;
 
     req = tevent_req_create(mem_ctx, &state,
@@ -880,14 +903,46 @@ ipa_server_create_trusts_send(TALLOC_CTX *mem_ctx,
     state->ev = ev;
     state->be_ctx = be_ctx;
     state->id_ctx = id_ctx;
-    state->domiter = parent;
 
-    ret = ipa_server_create_trusts_step(req);
-    if (ret != EAGAIN) {
+    ret = ipa_server_create_trusts_group(req, parent);
+    if (ret != EOK) {
         goto immediate;
     }
 
-    return req;
+    /* Subdomains from the previous run can be used right away if the keytab
+     * of their forest is still there. The keytab is refreshed anyway. */
+    DLIST_FOR_EACH(forest, state->pending) {
+        char *keytab;
+
+        keytab = forest_keytab(state, forest->forest);
+        if (keytab == NULL) {
+            ret = ENOMEM;
+            goto immediate;
+        }
+
+        ret = ipa_check_keytab(keytab, id_ctx->server_mode->kt_owner_uid,
+                               id_ctx->server_mode->kt_owner_gid);
+        talloc_free(keytab);
+        if (ret != EOK) {
+            continue;
+        }
+
+        DEBUG(SSSDBG_TRACE_FUNC, "Using the existing keytab of forest %s "
+              "while it is being refreshed\n", forest->forest);
+        ret = ipa_server_create_trusts_ctx(req, forest);
+        if (ret != EOK) {
+            goto immediate;
+        }
+        forest->has_ctx = true;
+    }
+
+    ret = ipa_server_create_trusts_step(req);
+    if (ret == EAGAIN) {
+        return req;
+    } else if (ret == EOK) {
+        ipa_server_create_trusts_finish(req);
+        ret = state->error;
+    }
 
 immediate:
     if (ret != EOK) {
@@ -899,131 +954,238 @@ immediate:
     return req;
 }
 
-static errno_t ipa_server_create_trusts_step(struct tevent_req *req)
+static errno_t ipa_server_create_trusts_group(struct tevent_req *req,
+                                             struct sss_domain_info *parent)
 {
-    struct tevent_req *subreq = NULL;
+    struct ipa_server_create_trusts_state *state;
+    struct ipa_server_trust_forest *forest;
     struct ipa_ad_server_ctx *trust_iter;
-    struct ipa_ad_server_ctx *trust_i;
-    struct ipa_server_create_trusts_state *state = NULL;
+    struct sss_domain_info **doms;
+    struct sss_domain_info *dom;
 
     state = tevent_req_data(req, struct ipa_server_create_trusts_state);
 
-    for (state->domiter = get_next_domain(state->domiter, SSS_GND_DESCEND);
-         state->domiter && IS_SUBDOMAIN(state->domiter);
-         state->domiter = get_next_domain(state->domiter, 0)) {
+    for (dom = get_next_domain(parent, SSS_GND_DESCEND);
+         dom && IS_SUBDOMAIN(dom);
+         dom = get_next_domain(dom, 0)) {
 
         /* Check if we already have an ID context for this subdomain */
         DLIST_FOR_EACH(trust_iter, state->id_ctx->server_mode->trusts) {
-            if (trust_iter->dom == state->domiter) {
+            if (trust_iter->dom == dom) {
                 break;
             }
         }
 
-        /* Newly detected trust */
-        if (trust_iter == NULL) {
-            subreq = ipa_server_trusted_dom_setup_send(state,
-                                                       state->ev,
-                                                       state->be_ctx,
-                                                       state->id_ctx,
-                                                       state->domiter);
-            if (subreq == NULL) {
-                return ENOMEM;
-            }
-            tevent_req_set_callback(subreq, ipa_server_create_trusts_done, req);
-            return EAGAIN;
+        if (trust_iter != NULL) {
+            continue;
         }
-    }
 
-    /* Refresh all sdap_dom lists in all ipa_ad_server_ctx contexts */
-    DLIST_FOR_EACH(trust_iter, state->id_ctx->server_mode->trusts) {
-        struct sdap_domain *sdom_a;
-
-        sdom_a = sdap_domain_get(trust_iter->ad_id_ctx->sdap_id_ctx->opts,
-                                 trust_iter->dom);
-        if (sdom_a == NULL) {
+        /* Newly detected trust, trusts are only established with forest
+         * roots */
+        if (dom->forest_root == NULL || dom->forest_root->forest == NULL) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "Subdomain %s has no forest root?\n", dom->name);
+            if (state->error == EOK) {
+                state->error = ERR_TRUST_FOREST_UNKNOWN;
+            }
             continue;
         }
 
-        DLIST_FOR_EACH(trust_i, state->id_ctx->server_mode->trusts) {
-            struct sdap_domain *sdom_b;
-
-            if (strcmp(trust_iter->dom->name, trust_i->dom->name) == 0) {
-                continue;
+        DLIST_FOR_EACH(forest, state->pending) {
+            if (strcasecmp(forest->forest, dom->forest_root->forest) == 0) {
+                break;
             }
+        }
 
-            sdom_b = sdap_domain_get(trust_i->ad_id_ctx->sdap_id_ctx->opts,
-                                     sdom_a->dom);
-            if (sdom_b == NULL) {
-                continue;
+        if (forest == NULL) {
+            forest = talloc_zero(state, struct ipa_server_trust_forest);
+            if (forest == NULL) {
+                return ENOMEM;
             }
+            forest->req = req;
+            forest->forest = dom->forest_root->forest;
+            DLIST_ADD_END(state->pending, forest,
+                          struct ipa_server_trust_forest *);
+        }
 
-            /* Replace basedn and search bases from sdom_b with values
-             * from sdom_a */
-            sdap_domain_copy_search_bases(sdom_b, sdom_a);
+        doms = talloc_realloc(forest, forest->doms, struct sss_domain_info *,
+                              forest->num_doms + 1);
+        if (doms == NULL) {
+            return ENOMEM;
         }
+        doms[forest->num_doms] = dom;
+        forest->doms = doms;
+        forest->num_doms++;
     }
 
     return EOK;
 }
 
+static errno_t ipa_server_create_trusts_step(struct tevent_req *req)
+{
+    struct ipa_server_create_trusts_state *state;
+    struct ipa_server_trust_forest *forest;
+    struct tevent_req *subreq;
+
+    state = tevent_req_data(req, struct ipa_server_create_trusts_state);
+
+    while (state->pending != NULL
+            && state->running < IPA_TRUST_SETUP_MAX_RUNNING) {
+        forest = state->pending;
+        DLIST_REMOVE(state->pending, forest);
+
+        DEBUG(SSSDBG_TRACE_FUNC, "Setting up trust with forest %s "
+              "(%zu subdomains)\n", forest->forest, forest->num_doms);
+
+        /* The keytab only depends on the forest, any of its subdomains
+         * will do. */
+        subreq = ipa_server_trusted_dom_setup_send(forest,
+                                                   state->ev,
+                                                   state->be_ctx,
+                                                   state->id_ctx,
+                                                   forest->doms[0]);
+        if (subreq == NULL) {
+            return ENOMEM;
+        }
+        tevent_req_set_callback(subreq, ipa_server_create_trusts_done,
+                                forest);
+        state->running++;
+    }
+
+    return state->running > 0 ? EAGAIN : EOK;
+}
+
 static void ipa_server_create_trusts_done(struct tevent_req *subreq)
 {
+    struct ipa_server_create_trusts_state *state;
+    struct ipa_server_trust_forest *forest;
+    struct tevent_req *req;
     errno_t ret;
-    struct tevent_req *req = tevent_req_callback_data(subreq,
-                                                      struct tevent_req);
+
+    forest = tevent_req_callback_data(subreq, struct ipa_server_trust_forest);
+    req = forest->req;
+    state = tevent_req_data(req, struct ipa_server_create_trusts_state);
+    state->running--;
 
     ret = ipa_server_trusted_dom_setup_recv(subreq);
     talloc_zfree(subreq);
     if (ret != EOK) {
-        tevent_req_error(req, ret);
-        return;
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to set up trust with forest %s "
+              "[%d]: %s\n", forest->forest, ret, sss_strerror(ret));
+        if (state->error == EOK) {
+            state->error = ret;
+        }
+    } else if (!forest->has_ctx) {
+        ret = ipa_server_create_trusts_ctx(req, forest);
+        if (ret != EOK && state->error == EOK) {
+            state->error = ret;
+        }
     }
+    talloc_free(forest);
 
-    ret = ipa_server_create_trusts_ctx(req);
-    if (ret != EOK) {
+    ret = ipa_server_create_trusts_step(req);
+    if (ret == EAGAIN) {
+        /* Will cycle back */
+        return;
+    } else if (ret != EOK) {
         tevent_req_error(req, ret);
         return;
     }
 
-    ret = ipa_server_create_trusts_step(req);
-    if (ret == EOK) {
-        tevent_req_done(req);
-        return;
-    } else if (ret != EAGAIN) {
-        tevent_req_error(req, ret);
+    ipa_server_create_trusts_finish(req);
+
+    if (state->error != EOK) {
+        tevent_req_error(req, state->error);
         return;
     }
 
-    /* Will cycle back */
+    tevent_req_done(req);
 }
 
-static errno_t ipa_server_create_trusts_ctx(struct tevent_req *req)
+static errno_t ipa_server_create_trusts_ctx(struct tevent_req *req,
+                                            struct ipa_server_trust_forest *f)
 {
     struct ipa_ad_server_ctx *trust_ctx;
+    struct ipa_ad_server_ctx *trust_iter;
     struct ad_id_ctx *ad_id_ctx;
     errno_t ret;
+    size_t i;
     struct ipa_server_create_trusts_state *state = NULL;
 
     state = tevent_req_data(req, struct ipa_server_create_trusts_state);
 
-    ret = ipa_ad_ctx_new(state->be_ctx, state->id_ctx, state->domiter, &ad_id_ctx);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE,
-              "Cannot create ad_id_ctx for subdomain %s\n", state->domiter->name);
-        return ret;
-    }
+    for (i = 0; i < f->num_doms; i++) {
+        /* Might have been created by a concurrent request meanwhile */
+        DLIST_FOR_EACH(trust_iter, state->id_ctx->server_mode->trusts) {
+            if (trust_iter->dom == f->doms[i]) {
+                break;
+            }
+        }
+        if (trust_iter != NULL) {
+            continue;
+        }
 
-    trust_ctx = talloc(state->id_ctx->server_mode, struct ipa_ad_server_ctx);
-    if (trust_ctx == NULL) {
-        return ENOMEM;
+        ret = ipa_ad_ctx_new(state->be_ctx, state->id_ctx, f->doms[i],
+                             &ad_id_ctx);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "Cannot create ad_id_ctx for subdomain %s\n",
+                  f->doms[i]->name);
+            return ret;
+        }
+
+        trust_ctx = talloc(state->id_ctx->server_mode,
+                           struct ipa_ad_server_ctx);
+        if (trust_ctx == NULL) {
+            return ENOMEM;
+        }
+        trust_ctx->dom = f->doms[i];
+        trust_ctx->ad_id_ctx = ad_id_ctx;
+
+        DLIST_ADD(state->id_ctx->server_mode->trusts, trust_ctx);
     }
-    trust_ctx->dom = state->domiter;
-    trust_ctx->ad_id_ctx = ad_id_ctx;
 
-    DLIST_ADD(state->id_ctx->server_mode->trusts, trust_ctx);
     return EOK;
 }
 
+static void ipa_server_create_trusts_finish(struct tevent_req *req)
+{
+    struct ipa_server_create_trusts_state *state;
+    struct ipa_ad_server_ctx *trust_iter;
+    struct ipa_ad_server_ctx *trust_i;
+
+    state = tevent_req_data(req, struct ipa_server_create_trusts_state);
+
+    /* Refresh all sdap_dom lists in all ipa_ad_server_ctx contexts */
+    DLIST_FOR_EACH(trust_iter, state->id_ctx->server_mode->trusts) {
+        struct sdap_domain *sdom_a;
+
+        sdom_a = sdap_domain_get(trust_iter->ad_id_ctx->sdap_id_ctx->opts,
+                                 trust_iter->dom);
+        if (sdom_a == NULL) {
+            continue;
+        }
+
+        DLIST_FOR_EACH(trust_i, state->id_ctx->server_mode->trusts) {
+            struct sdap_domain *sdom_b;
+
+            if (strcmp(trust_iter->dom->name, trust_i->dom->name) == 0) {
+                continue;
+            }
+
+            sdom_b = sdap_domain_get(trust_i->ad_id_ctx->sdap_id_ctx->opts,
+                                     sdom_a->dom);
+            if (sdom_b == NULL) {
+                continue;
+            }
+
+            /* Replace basedn and search bases from sdom_b with values
+             * from sdom_a */
+            sdap_domain_copy_search_bases(sdom_b, sdom_a);
+        }
+    }
+}
+
 errno_t ipa_server_create_trusts_recv(struct tevent_req *req)
 {
     TEVENT_REQ_RETURN_ON_ERROR(req);
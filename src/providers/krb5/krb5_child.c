@@ -2778,6 +2778,8 @@ static errno_t k5c_recv_data(struct krb5_req *kr, int fd, uint32_t *offline)
         DEBUG(SSSDBG_CRIT_FAILURE,
               "read failed [%d][%s].\n", ret, strerror(ret));
         return ret;
+    } else if (len == 0) {
+        return ENODATA;
     }
 
     ret = unpack_buffer(buf, len, kr, offline);
@@ -3128,10 +3130,12 @@ static krb5_error_code privileged_krb5_setup(struct krb5_req *kr,
         DEBUG(SSSDBG_MINOR_FAILURE, "Realm not available.\n");
     }
 
-    kerr = krb5_init_context(&kr->ctx);
-    if (kerr != 0) {
-        KRB5_CHILD_DEBUG(SSSDBG_CRIT_FAILURE, kerr);
-        return kerr;
+    if (kr->ctx == NULL) {
+        kerr = krb5_init_context(&kr->ctx);
+        if (kerr != 0) {
+            KRB5_CHILD_DEBUG(SSSDBG_CRIT_FAILURE, kerr);
+            return kerr;
+        }
     }
 
     kerr = sss_krb5_get_init_creds_opt_alloc(kr->ctx, &kr->options);
@@ -3225,6 +3229,7 @@ int main(int argc, const char *argv[])
     gid_t fast_gid = 0;
     struct cli_opts cli_opts = { 0 };
     int sss_creds_password = 0;
+    int preforked = 0;
 
     struct poptOption long_options[] = {
         POPT_AUTOHELP
@@ -3259,6 +3264,8 @@ int main(int argc, const char *argv[])
          _("Requests canonicalization of the principal name"), NULL},
         {CHILD_OPT_SSS_CREDS_PASSWORD, 0, POPT_ARG_NONE, &sss_creds_password,
          0, _("Use custom version of krb5_get_init_creds_password"), NULL},
+        {CHILD_OPT_PREFORKED, 0, POPT_ARG_NONE, &preforked, 0,
+         _("Initialize Kerberos before waiting for the request"), NULL},
         POPT_TABLEEND
     };
 
@@ -3322,8 +3329,23 @@ int main(int argc, const char *argv[])
         kr->krb5_get_init_creds_password = krb5_get_init_creds_password;
     }
 
+    if (preforked) {
+        /* Started ahead of time by sssd_be, the request may arrive much
+         * later. Do everything which does not depend on it now. */
+        kerr = krb5_init_context(&kr->ctx);
+        if (kerr != 0) {
+            KRB5_CHILD_DEBUG(SSSDBG_CRIT_FAILURE, kerr);
+            ret = EFAULT;
+            goto done;
+        }
+    }
+
     ret = k5c_recv_data(kr, STDIN_FILENO, &offline);
-    if (ret != EOK) {
+    if (ret == ENODATA && preforked) {
+        DEBUG(SSSDBG_TRACE_FUNC, "No request received, exiting.\n");
+        ret = EOK;
+        goto done;
+    } else if (ret != EOK) {
         goto done;
     }
 
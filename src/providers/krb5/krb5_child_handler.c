@@ -22,8 +22,6 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <signal.h>
-
 #include "util/util.h"
 #include "util/child_common.h"
 #include "providers/krb5/krb5_common.h"
@@ -43,16 +41,15 @@
 #define TIME_T_MAX LONG_MAX
 #define int64_to_time_t(val) ((time_t)((val) < TIME_T_MAX ? val : TIME_T_MAX))
 
+/* Idle pre-forked children are replaced after this many seconds so that
+ * changes of krb5.conf are picked up */
+#define KRB5_CHILD_POOL_MAX_AGE 300
+
 struct handle_child_state {
     struct tevent_context *ev;
     struct krb5child_req *kr;
     uint8_t *buf;
     ssize_t len;
-
-    struct tevent_timer *timeout_handler;
-    pid_t child_pid;
-
-    struct child_io_fds *io;
 };
 
 static errno_t pack_authtok(struct io_buffer *buf, size_t *rp,
@@ -252,53 +249,6 @@ static errno_t create_send_buffer(struct krb5child_req *kr,
 }
 
 
-static void krb5_child_timeout(struct tevent_context *ev,
-                               struct tevent_timer *te,
-                               struct timeval tv, void *pvt)
-{
-    struct tevent_req *req = talloc_get_type(pvt, struct tevent_req);
-    struct handle_child_state *state = tevent_req_data(req,
-                                                     struct handle_child_state);
-    int ret;
-
-    if (state->timeout_handler == NULL) {
-        return;
-    }
-
-    DEBUG(SSSDBG_IMPORTANT_INFO,
-          "Timeout for child [%d] reached. In case KDC is distant or network "
-           "is slow you may consider increasing value of krb5_auth_timeout.\n",
-           state->child_pid);
-
-    ret = kill(state->child_pid, SIGKILL);
-    if (ret == -1) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "kill failed [%d][%s].\n", errno, strerror(errno));
-    }
-
-    tevent_req_error(req, ETIMEDOUT);
-}
-
-static errno_t activate_child_timeout_handler(struct tevent_req *req,
-                                              struct tevent_context *ev,
-                                              const uint32_t timeout_seconds)
-{
-    struct timeval tv;
-    struct handle_child_state *state = tevent_req_data(req,
-                                                     struct handle_child_state);
-
-    tv = tevent_timeval_current();
-    tv = tevent_timeval_add(&tv, timeout_seconds, 0);
-    state->timeout_handler = tevent_add_timer(ev, state, tv,
-                                           krb5_child_timeout, req);
-    if (state->timeout_handler == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_add_timer failed.\n");
-        return ENOMEM;
-    }
-
-    return EOK;
-}
-
 errno_t set_extra_args(TALLOC_CTX *mem_ctx, struct krb5_ctx *krb5_ctx,
                        const char ***krb5_child_extra_args)
 {
@@ -429,97 +379,92 @@ done:
     return ret;
 }
 
-static errno_t fork_child(struct tevent_req *req)
+/*
+ * krb5_child switches to the user it authenticates, so a child can only serve
+ * a single request. The pool hides the fork, exec and Kerberos initialization
+ * by starting krb5_child_pool_size children ahead of time. They initialize
+ * their krb5 context and then block on stdin until they receive the usual
+ * create_send_buffer() request. The pool also caps the number of krb5_child
+ * processes working on requests at krb5_child_pool_max.
+ */
+errno_t krb5_child_pool_init(TALLOC_CTX *mem_ctx,
+                             struct tevent_context *ev,
+                             struct krb5_ctx *krb5_ctx,
+                             struct sss_child_pool **_pool)
 {
-    int pipefd_to_child[2] = PIPE_INIT;
-    int pipefd_from_child[2] = PIPE_INIT;
-    pid_t pid;
+    TALLOC_CTX *tmp_ctx;
+    struct sss_child_pool_opts opts = { 0 };
+    const char **extra_args;
+    size_t c;
+    int size;
+    int max;
     errno_t ret;
-    const char **krb5_child_extra_args;
-    struct handle_child_state *state = tevent_req_data(req,
-                                                     struct handle_child_state);
 
-    ret = set_extra_args(state, state->kr->krb5_ctx, &krb5_child_extra_args);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "set_extra_args failed.\n");
-        goto fail;
+    size = dp_opt_get_int(krb5_ctx->opts, KRB5_CHILD_POOL_SIZE);
+    max = dp_opt_get_int(krb5_ctx->opts, KRB5_CHILD_POOL_MAX);
+    if (size < 0 || max < 0) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "krb5_child_pool_size and "
+              "krb5_child_pool_max must not be negative.\n");
+        return EINVAL;
     }
 
-    ret = pipe(pipefd_from_child);
-    if (ret == -1) {
-        ret = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "pipe failed [%d][%s].\n", errno, strerror(errno));
-        goto fail;
+    if (max > 0 && size > max) {
+        DEBUG(SSSDBG_CONF_SETTINGS, "krb5_child_pool_size is larger than "
+              "krb5_child_pool_max, using %d.\n", max);
+        size = max;
     }
-    ret = pipe(pipefd_to_child);
-    if (ret == -1) {
-        ret = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "pipe failed [%d][%s].\n", errno, strerror(errno));
-        goto fail;
-    }
-
-    pid = fork();
 
-    if (pid == 0) { /* child */
-        exec_child_ex(state,
-                      pipefd_to_child, pipefd_from_child,
-                      KRB5_CHILD, state->kr->krb5_ctx->child_debug_fd,
-                      krb5_child_extra_args, false,
-                      STDIN_FILENO, STDOUT_FILENO);
-
-        /* We should never get here */
-        DEBUG(SSSDBG_CRIT_FAILURE, "BUG: Could not exec KRB5 child\n");
-    } else if (pid > 0) { /* parent */
-        state->child_pid = pid;
-        state->io->read_from_child_fd = pipefd_from_child[0];
-        PIPE_FD_CLOSE(pipefd_from_child[1]);
-        state->io->write_to_child_fd = pipefd_to_child[1];
-        PIPE_FD_CLOSE(pipefd_to_child[0]);
-        sss_fd_nonblocking(state->io->read_from_child_fd);
-        sss_fd_nonblocking(state->io->write_to_child_fd);
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
 
-        ret = child_handler_setup(state->ev, pid, NULL, NULL, NULL);
-        if (ret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE,
-                  "Could not set up child signal handler\n");
-            goto fail;
-        }
+    ret = set_extra_args(tmp_ctx, krb5_ctx, &extra_args);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "set_extra_args failed.\n");
+        goto done;
+    }
 
-        ret = activate_child_timeout_handler(req, state->ev,
-                  dp_opt_get_int(state->kr->krb5_ctx->opts, KRB5_AUTH_TIMEOUT));
-        if (ret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE,
-                  "activate_child_timeout_handler failed.\n");
+    if (size > 0) {
+        for (c = 0; extra_args[c] != NULL; c++);
+        extra_args = talloc_realloc(tmp_ctx, extra_args, const char *, c + 2);
+        if (extra_args == NULL) {
+            ret = ENOMEM;
+            goto done;
         }
-
-    } else { /* error */
-        ret = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "fork failed [%d][%s].\n", errno, strerror(ret));
-        goto fail;
+        extra_args[c] = "--" CHILD_OPT_PREFORKED;
+        extra_args[c + 1] = NULL;
     }
 
-    return EOK;
+    opts.name = "krb5_child";
+    opts.binary = KRB5_CHILD;
+    opts.extra_argv = extra_args;
+    opts.debug_fd = krb5_ctx->child_debug_fd;
+    opts.child_out_fd = STDOUT_FILENO;
+    opts.prefork = size;
+    opts.max_running = max;
+    opts.max_requests = 1;
+    opts.timeout = dp_opt_get_int(krb5_ctx->opts, KRB5_AUTH_TIMEOUT);
+    opts.idle_timeout = KRB5_CHILD_POOL_MAX_AGE;
 
-fail:
-    PIPE_CLOSE(pipefd_from_child);
-    PIPE_CLOSE(pipefd_to_child);
+    ret = sss_child_pool_create(mem_ctx, ev, &opts, _pool);
+
+done:
+    talloc_free(tmp_ctx);
     return ret;
 }
 
-static void handle_child_step(struct tevent_req *subreq);
 static void handle_child_done(struct tevent_req *subreq);
 
 struct tevent_req *handle_child_send(TALLOC_CTX *mem_ctx,
                                      struct tevent_context *ev,
                                      struct krb5child_req *kr)
 {
-    struct tevent_req *req, *subreq;
+    struct tevent_req *req;
+    struct tevent_req *subreq;
     struct handle_child_state *state;
-    int ret;
     struct io_buffer *buf = NULL;
+    int ret;
 
     req = tevent_req_create(mem_ctx, &state, struct handle_child_state);
     if (req == NULL) {
@@ -530,18 +475,16 @@ struct tevent_req *handle_child_send(TALLOC_CTX *mem_ctx,
     state->kr = kr;
     state->buf = NULL;
     state->len = 0;
-    state->child_pid = -1;
-    state->timeout_handler = NULL;
 
-    state->io = talloc(state, struct child_io_fds);
-    if (state->io == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "talloc failed.\n");
-        ret = ENOMEM;
-        goto fail;
+    /* krb5_child_init() is not called by all users of the krb5 context */
+    if (kr->krb5_ctx->child_pool == NULL) {
+        ret = krb5_child_pool_init(kr->krb5_ctx, ev, kr->krb5_ctx,
+                                   &kr->krb5_ctx->child_pool);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "krb5_child_pool_init failed.\n");
+            goto fail;
+        }
     }
-    state->io->write_to_child_fd = -1;
-    state->io->read_from_child_fd = -1;
-    talloc_set_destructor((void *) state->io, child_io_destructor);
 
     ret = create_send_buffer(kr, &buf);
     if (ret != EOK) {
@@ -549,19 +492,14 @@ struct tevent_req *handle_child_send(TALLOC_CTX *mem_ctx,
         goto fail;
     }
 
-    ret = fork_child(req);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "fork_child failed.\n");
-        goto fail;
-    }
-
-    subreq = write_pipe_send(state, ev, buf->data, buf->size,
-                             state->io->write_to_child_fd);
-    if (!subreq) {
+    subreq = sss_child_pool_send(state, ev, kr->krb5_ctx->child_pool,
+                                 buf->data, buf->size);
+    talloc_free(buf);
+    if (subreq == NULL) {
         ret = ENOMEM;
         goto fail;
     }
-    tevent_req_set_callback(subreq, handle_child_step, req);
+    tevent_req_set_callback(subreq, handle_child_done, req);
 
     return req;
 
@@ -571,31 +509,6 @@ fail:
     return req;
 }
 
-static void handle_child_step(struct tevent_req *subreq)
-{
-    struct tevent_req *req = tevent_req_callback_data(subreq,
-                                                      struct tevent_req);
-    struct handle_child_state *state = tevent_req_data(req,
-                                                    struct handle_child_state);
-    int ret;
-
-    ret = write_pipe_recv(subreq);
-    talloc_zfree(subreq);
-    if (ret != EOK) {
-        tevent_req_error(req, ret);
-        return;
-    }
-
-    PIPE_FD_CLOSE(state->io->write_to_child_fd);
-
-    subreq = read_pipe_send(state, state->ev, state->io->read_from_child_fd);
-    if (!subreq) {
-        tevent_req_error(req, ENOMEM);
-        return;
-    }
-    tevent_req_set_callback(subreq, handle_child_done, req);
-}
-
 static void handle_child_done(struct tevent_req *subreq)
 {
     struct tevent_req *req = tevent_req_callback_data(subreq,
@@ -604,17 +517,19 @@ static void handle_child_done(struct tevent_req *subreq)
                                                     struct handle_child_state);
     int ret;
 
-    talloc_zfree(state->timeout_handler);
-
-    ret = read_pipe_recv(subreq, state, &state->buf, &state->len);
+    ret = sss_child_pool_recv(subreq, state, &state->buf, &state->len, NULL);
     talloc_zfree(subreq);
+    if (ret == ETIMEDOUT) {
+        DEBUG(SSSDBG_IMPORTANT_INFO,
+              "Timeout for krb5_child reached. In case KDC is distant or "
+              "network is slow you may consider increasing value of "
+              "krb5_auth_timeout.\n");
+    }
     if (ret != EOK) {
         tevent_req_error(req, ret);
         return;
     }
 
-    PIPE_FD_CLOSE(state->io->read_from_child_fd);
-
     tevent_req_done(req);
     return;
 }
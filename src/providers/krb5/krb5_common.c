@@ -1026,6 +1026,15 @@ int krb5_service_init(TALLOC_CTX *memctx, struct be_ctx *ctx,
         goto done;
     }
 
+    ret = be_fo_set_default_port(ctx, service_name,
+                                 strcmp(service_name,
+                                        SSS_KRB5KPASSWD_FO_SRV) == 0
+                                        ? SSS_KRB5KPASSWD_PORT
+                                        : SSS_KRB5KDC_PORT);
+    if (ret != EOK) {
+        goto done;
+    }
+
     if (!primary_servers) {
         DEBUG(SSSDBG_CONF_SETTINGS,
               "No primary servers defined, using service discovery\n");
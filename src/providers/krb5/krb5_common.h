@@ -38,6 +38,8 @@
 
 #define SSS_KRB5KDC_FO_SRV "KERBEROS"
 #define SSS_KRB5KPASSWD_FO_SRV "KPASSWD"
+#define SSS_KRB5KDC_PORT 88
+#define SSS_KRB5KPASSWD_PORT 464
 #define SSS_KRB5_LOOKAHEAD_PRIMARY_DEFAULT 3
 #define SSS_KRB5_LOOKAHEAD_BACKUP_DEFAULT 1
 
@@ -63,6 +65,8 @@ enum krb5_opts {
     KRB5_USE_KDCINFO,
     KRB5_KDCINFO_LOOKAHEAD,
     KRB5_MAP_USER,
+    KRB5_CHILD_POOL_SIZE,
+    KRB5_CHILD_POOL_MAX,
 
     KRB5_OPTS
 };
@@ -82,6 +86,7 @@ struct krb5_service {
 struct fo_service;
 struct deferred_auth_ctx;
 struct renew_tgt_ctx;
+struct sss_child_pool;
 
 enum krb5_config_type {
     K5C_GENERIC,
@@ -145,6 +150,9 @@ struct krb5_ctx {
     const char *fast_principal;
 
     bool canonicalize;
+
+    /* Set up by krb5_child_init() or by the first request */
+    struct sss_child_pool *child_pool;
 };
 
 struct remove_info_files_ctx {
@@ -246,4 +254,9 @@ krb5_error_code copy_keytab_into_memory(TALLOC_CTX *mem_ctx, krb5_context kctx,
 
 errno_t set_extra_args(TALLOC_CTX *mem_ctx, struct krb5_ctx *krb5_ctx,
                        const char ***krb5_child_extra_args);
+
+errno_t krb5_child_pool_init(TALLOC_CTX *mem_ctx,
+                             struct tevent_context *ev,
+                             struct krb5_ctx *krb5_ctx,
+                             struct sss_child_pool **_pool);
 #endif /* __KRB5_COMMON_H__ */
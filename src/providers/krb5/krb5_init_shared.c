@@ -90,6 +90,14 @@ errno_t krb5_child_init(struct krb5_ctx *krb5_auth_ctx,
         goto done;
     }
 
+    ret = krb5_child_pool_init(krb5_auth_ctx, bectx->ev, krb5_auth_ctx,
+                               &krb5_auth_ctx->child_pool);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Cannot set up krb5_child pool: %s:[%d]\n",
+              sss_strerror(ret), ret);
+        goto done;
+    }
+
     ret = EOK;
 
 done:
@@ -521,6 +521,16 @@ int sdap_service_init(TALLOC_CTX *memctx, struct be_ctx *ctx,
         goto done;
     }
 
+    ret = be_fo_set_default_port(ctx, service_name, LDAP_PORT);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = be_fo_set_reports_rtt(ctx, service_name);
+    if (ret != EOK) {
+        goto done;
+    }
+
     service->name = talloc_strdup(service, service_name);
     if (!service->name) {
         ret = ENOMEM;
@@ -19,6 +19,8 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <ctype.h>
+
 #include "util/util.h"
 #include "util/crypto/sss_crypto.h"
 #include "confdb/confdb.h"
@@ -387,25 +389,241 @@ int sdap_get_map(TALLOC_CTX *memctx,
 
 /* =Parse-msg============================================================= */
 
+/* Open addressing hash table from the (case-insensitive) LDAP attribute
+ * name to the first map entry using it. Map entries sharing the same LDAP
+ * name are chained through the next array. */
+struct sdap_attr_map_index {
+    struct sdap_attr_map *map;
+    int num_attrs;
+
+    uint32_t mask;
+    int *slots;
+    int *next;
+};
+
+static uint32_t sdap_attr_name_hash(const char *name)
+{
+    /* FNV-1a over the lower case name */
+    uint32_t hash = 2166136261U;
+
+    for (; *name != '\0'; name++) {
+        hash ^= (uint8_t) tolower((unsigned char) *name);
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+errno_t sdap_attr_map_index_create(TALLOC_CTX *mem_ctx,
+                                   struct sdap_attr_map *map,
+                                   int num_attrs,
+                                   struct sdap_attr_map_index **_idx)
+{
+    struct sdap_attr_map_index *idx;
+    uint32_t size;
+    uint32_t pos;
+    int *tail;
+    int i;
+
+    idx = talloc_zero(mem_ctx, struct sdap_attr_map_index);
+    if (idx == NULL) {
+        return ENOMEM;
+    }
+
+    idx->map = map;
+    idx->num_attrs = num_attrs;
+
+    /* Keep the load factor at or below 50% */
+    for (size = 8; size < 2 * (uint32_t) num_attrs; size <<= 1);
+    idx->mask = size - 1;
+
+    idx->slots = talloc_array(idx, int, size);
+    idx->next = talloc_array(idx, int, num_attrs > 0 ? num_attrs : 1);
+    if (idx->slots == NULL || idx->next == NULL) {
+        talloc_free(idx);
+        return ENOMEM;
+    }
+
+    for (pos = 0; pos < size; pos++) {
+        idx->slots[pos] = -1;
+    }
+    idx->next[0] = -1;
+
+    /* The first entry is the objectclass, it is never parsed as attribute */
+    for (i = 1; i < num_attrs; i++) {
+        idx->next[i] = -1;
+        if (map[i].name == NULL) continue;
+
+        pos = sdap_attr_name_hash(map[i].name) & idx->mask;
+        while (idx->slots[pos] != -1
+                && strcasecmp(map[idx->slots[pos]].name, map[i].name) != 0) {
+            pos = (pos + 1) & idx->mask;
+        }
+
+        if (idx->slots[pos] == -1) {
+            idx->slots[pos] = i;
+            continue;
+        }
+
+        /* Keep the map order, the values are stored in that order */
+        for (tail = &idx->slots[pos]; *tail != -1; tail = &idx->next[*tail]);
+        *tail = i;
+    }
+
+    *_idx = idx;
+    return EOK;
+}
+
+static int sdap_attr_map_index_lookup(struct sdap_attr_map_index *idx,
+                                      const char *name)
+{
+    uint32_t pos;
+
+    pos = sdap_attr_name_hash(name) & idx->mask;
+    while (idx->slots[pos] != -1) {
+        if (strcasecmp(idx->map[idx->slots[pos]].name, name) == 0) {
+            return idx->slots[pos];
+        }
+        pos = (pos + 1) & idx->mask;
+    }
+
+    return -1;
+}
+
+/* Returns the index of the first map entry for the LDAP attribute or -1 */
+static int sdap_parse_map_first(struct sdap_attr_map *map, int attrs_num,
+                                struct sdap_attr_map_index *idx,
+                                const char *name)
+{
+    int i;
+
+    if (idx != NULL) {
+        return sdap_attr_map_index_lookup(idx, name);
+    }
+
+    for (i = 1; i < attrs_num; i++) {
+        /* check if this attr is valid with the chosen schema */
+        if (!map[i].name) continue;
+        /* check if it is an attr we are interested in */
+        if (strcasecmp(name, map[i].name) == 0) return i;
+    }
+
+    return -1;
+}
+
+static int sdap_parse_map_next(struct sdap_attr_map *map, int attrs_num,
+                               struct sdap_attr_map_index *idx,
+                               const char *name, int cur)
+{
+    int i;
+
+    if (idx != NULL) {
+        return idx->next[cur];
+    }
+
+    for (i = cur + 1; i < attrs_num; i++) {
+        if (!map[i].name) continue;
+        if (strcasecmp(name, map[i].name) == 0) return i;
+    }
+
+    return -1;
+}
+
+/* Appends all values of an LDAP attribute at once. The values array is only
+ * grown once and every value is copied exactly once, directly from the
+ * buffer returned by libldap. */
+static errno_t sdap_parse_add_vals(struct sysdb_attrs *attrs,
+                                   const char *name,
+                                   const char *ldap_name,
+                                   struct berval **vals,
+                                   size_t num_vals,
+                                   bool base64)
+{
+    struct ldb_message_element *el;
+    struct ldb_val *values;
+    struct ldb_val *v;
+    size_t num_nonempty = 0;
+    size_t i;
+    errno_t ret;
+
+    for (i = 0; i < num_vals; i++) {
+        if (vals[i]->bv_len != 0) {
+            num_nonempty++;
+        }
+    }
+
+    if (num_nonempty == 0) {
+        DEBUG(SSSDBG_TRACE_LIBS,
+              "All values of attribute [%s] are empty, skipping.\n",
+              ldap_name);
+        return EOK;
+    }
+
+    ret = sysdb_attrs_get_el(attrs, name, &el);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    values = talloc_realloc(attrs->a, el->values, struct ldb_val,
+                            el->num_values + num_nonempty);
+    if (values == NULL) {
+        return ENOMEM;
+    }
+    el->values = values;
+
+    for (i = 0; i < num_vals; i++) {
+        if (vals[i]->bv_len == 0) {
+            DEBUG(SSSDBG_TRACE_LIBS,
+                  "Value of attribute [%s] is empty. "
+                   "Skipping this value.\n", ldap_name);
+            continue;
+        }
+
+        v = &el->values[el->num_values];
+        if (base64) {
+            v->data = (uint8_t *) sss_base64_encode(el->values,
+                                 (uint8_t *) vals[i]->bv_val, vals[i]->bv_len);
+            if (v->data == NULL) {
+                return ENOMEM;
+            }
+            v->length = strlen((const char *) v->data);
+        } else {
+            /* Keep the values NULL terminated like ldb_val_dup() does */
+            v->data = talloc_size(el->values, vals[i]->bv_len + 1);
+            if (v->data == NULL) {
+                return ENOMEM;
+            }
+            memcpy(v->data, vals[i]->bv_val, vals[i]->bv_len);
+            v->data[vals[i]->bv_len] = '\0';
+            v->length = vals[i]->bv_len;
+        }
+        PROBE(SDAP_PARSE_ENTRY, ldap_name, v->data, v->length);
+
+        el->num_values++;
+    }
+
+    return EOK;
+}
+
 static bool objectclass_matched(struct sdap_attr_map *map,
                                 const char *objcl, int len);
-int sdap_parse_entry(TALLOC_CTX *memctx,
-                     struct sdap_handle *sh, struct sdap_msg *sm,
-                     struct sdap_attr_map *map, int attrs_num,
-                     struct sysdb_attrs **_attrs,
-                     bool disable_range_retrieval)
+static int sdap_parse_entry_int(TALLOC_CTX *memctx,
+                                struct sdap_handle *sh, struct sdap_msg *sm,
+                                struct sdap_attr_map *map, int attrs_num,
+                                struct sdap_attr_map_index *idx,
+                                struct sysdb_attrs **_attrs,
+                                bool disable_range_retrieval)
 {
     struct sysdb_attrs *attrs;
     BerElement *ber = NULL;
     struct berval **vals;
-    struct ldb_val v;
+    size_t num_vals;
     char *str;
     int lerrno;
     int i, ret, ai;
     int base_attr_idx = 0;
     const char *name;
     bool store;
-    bool base64;
     char *base_attr;
     uint32_t range_offset;
     TALLOC_CTX *tmp_ctx = talloc_new(NULL);
@@ -478,8 +696,6 @@ int sdap_parse_entry(TALLOC_CTX *memctx,
         }
     }
     while (str) {
-        base64 = false;
-
         ret = sdap_parse_range(tmp_ctx, str, &base_attr, &range_offset,
                                disable_range_retrieval);
         switch(ret) {
@@ -502,20 +718,12 @@ int sdap_parse_entry(TALLOC_CTX *memctx,
         }
 
         if (map) {
-            for (i = 1; i < attrs_num; i++) {
-                /* check if this attr is valid with the chosen schema */
-                if (!map[i].name) continue;
-                /* check if it is an attr we are interested in */
-                if (strcasecmp(base_attr, map[i].name) == 0) break;
-            }
+            base_attr_idx = sdap_parse_map_first(map, attrs_num, idx,
+                                                 base_attr);
             /* interesting attr */
-            if (i < attrs_num) {
+            if (base_attr_idx != -1) {
                 store = true;
-                name = map[i].sys_name;
-                base_attr_idx = i;
-                if (strcmp(name, SYSDB_SSH_PUBKEY) == 0) {
-                    base64 = true;
-                }
+                name = map[base_attr_idx].sys_name;
             } else {
                 store = false;
                 name = NULL;
@@ -552,57 +760,33 @@ int sdap_parse_entry(TALLOC_CTX *memctx,
                     ret = EINVAL;
                     goto done;
                 }
-                for (i = 0; vals[i]; i++) {
-                    if (vals[i]->bv_len == 0) {
-                        DEBUG(SSSDBG_TRACE_LIBS,
-                              "Value of attribute [%s] is empty. "
-                               "Skipping this value.\n", str);
-                        continue;
-                    }
-                    if (base64) {
-                        v.data = (uint8_t *) sss_base64_encode(attrs,
-                                 (uint8_t *) vals[i]->bv_val, vals[i]->bv_len);
-                        if (!v.data) {
-                            ldap_value_free_len(vals);
-                            ret = ENOMEM;
-                            goto done;
-                        }
-                        v.length = strlen((const char *)v.data);
-                    } else {
-                        v.data = (uint8_t *)vals[i]->bv_val;
-                        v.length = vals[i]->bv_len;
-                    }
-                    PROBE(SDAP_PARSE_ENTRY, str, v.data, v.length);
-
-                    if (map) {
-                        /* The same LDAP attr might be used for more sysdb
-                         * attrs in case there is a map. Find all that match
-                         * and copy the value
-                         */
-                        for (ai = base_attr_idx; ai < attrs_num; ai++) {
-                            /* check if this attr is valid with the chosen
-                             * schema */
-                            if (!map[ai].name) continue;
-
-                            /* check if it is an attr we are interested in */
-                            if (strcasecmp(base_attr, map[ai].name) == 0) {
-                                ret = sysdb_attrs_add_val(attrs,
-                                                          map[ai].sys_name,
-                                                          &v);
-                                if (ret) {
-                                    ldap_value_free_len(vals);
-                                    goto done;
-                                }
-                            }
-                        }
-                    } else {
-                        /* No map, just store the attribute */
-                        ret = sysdb_attrs_add_val(attrs, name, &v);
+                num_vals = ldap_count_values_len(vals);
+
+                if (map) {
+                    /* The same LDAP attr might be used for more sysdb
+                     * attrs in case there is a map. Copy the values to
+                     * all of them.
+                     */
+                    for (ai = base_attr_idx; ai != -1;
+                         ai = sdap_parse_map_next(map, attrs_num, idx,
+                                                  base_attr, ai)) {
+                        ret = sdap_parse_add_vals(attrs, map[ai].sys_name,
+                                        str, vals, num_vals,
+                                        strcmp(map[ai].sys_name,
+                                               SYSDB_SSH_PUBKEY) == 0);
                         if (ret) {
                             ldap_value_free_len(vals);
                             goto done;
                         }
                     }
+                } else {
+                    /* No map, just store the attribute */
+                    ret = sdap_parse_add_vals(attrs, name, str,
+                                              vals, num_vals, false);
+                    if (ret) {
+                        ldap_value_free_len(vals);
+                        goto done;
+                    }
                 }
                 ldap_value_free_len(vals);
             }
@@ -632,6 +816,26 @@ done:
     return ret;
 }
 
+int sdap_parse_entry(TALLOC_CTX *memctx,
+                     struct sdap_handle *sh, struct sdap_msg *sm,
+                     struct sdap_attr_map *map, int attrs_num,
+                     struct sysdb_attrs **_attrs,
+                     bool disable_range_retrieval)
+{
+    return sdap_parse_entry_int(memctx, sh, sm, map, attrs_num, NULL,
+                                _attrs, disable_range_retrieval);
+}
+
+int sdap_parse_entry_idx(TALLOC_CTX *memctx,
+                         struct sdap_handle *sh, struct sdap_msg *sm,
+                         struct sdap_attr_map_index *idx,
+                         struct sysdb_attrs **_attrs,
+                         bool disable_range_retrieval)
+{
+    return sdap_parse_entry_int(memctx, sh, sm, idx->map, idx->num_attrs, idx,
+                                _attrs, disable_range_retrieval);
+}
+
 static bool objectclass_matched(struct sdap_attr_map *map,
                                 const char *objcl, int len)
 {
@@ -816,6 +1020,62 @@ done:
     return ret;
 }
 
+ber_int_t sdap_adapt_page_size(ber_int_t cur_size,
+                               ber_int_t max_size,
+                               size_t num_entries,
+                               size_t num_bytes,
+                               uint64_t elapsed_usec,
+                               uint64_t target_usec)
+{
+    uint64_t next;
+    uint64_t entry_size;
+    ber_int_t min_size;
+
+    if (max_size <= 0) {
+        return max_size;
+    }
+
+    if (cur_size <= 0 || cur_size > max_size) {
+        cur_size = max_size;
+    }
+
+    next = cur_size;
+    if (target_usec > 0 && elapsed_usec > target_usec) {
+        /* The server was too slow, shrink proportionally */
+        next = cur_size * target_usec / elapsed_usec;
+    } else if (num_entries >= (size_t) cur_size) {
+        /* A full page that came back in time, there is room to grow. A short
+         * page is the end of the result set and says nothing about that. */
+        if (target_usec == 0 || elapsed_usec == 0) {
+            next = (uint64_t) cur_size * 2;
+        } else {
+            next = cur_size * target_usec / elapsed_usec;
+        }
+    }
+
+    /* Do not let a single page move the size too much */
+    next = MIN(next, (uint64_t) cur_size * 2);
+    next = MAX(next, (uint64_t) cur_size / 2);
+
+    /* Keep the memory needed for one page bounded, entries with huge member
+     * lists can easily be several kilobytes each */
+    if (num_entries > 0 && num_bytes > 0) {
+        entry_size = MAX(num_bytes / num_entries, 1);
+        if (next * entry_size > SDAP_PAGE_MAX_BYTES) {
+            next = SDAP_PAGE_MAX_BYTES / entry_size;
+        }
+    }
+
+    min_size = MIN(SDAP_PAGE_SIZE_MIN, max_size);
+    if (next < (uint64_t) min_size) {
+        next = min_size;
+    } else if (next > (uint64_t) max_size) {
+        next = max_size;
+    }
+
+    return (ber_int_t) next;
+}
+
 errno_t setup_tls_config(struct dp_option *basic_opts)
 {
     int ret;
@@ -1475,7 +1735,9 @@ void sdap_steal_server_opts(struct sdap_id_ctx *id_ctx,
     /* discard if same as previous so we do not reset max usn values
      * unnecessarily, only update last_usn. */
     if (strcmp(id_ctx->srv_opts->server_id, (*srv_opts)->server_id) == 0) {
-        id_ctx->srv_opts->last_usn = (*srv_opts)->last_usn;
+        if (!(*srv_opts)->cached_last_usn) {
+            id_ctx->srv_opts->last_usn = (*srv_opts)->last_usn;
+        }
         talloc_zfree(*srv_opts);
         return;
     }
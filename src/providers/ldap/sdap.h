@@ -49,9 +49,19 @@ struct sdap_op {
     sdap_op_callback_t *callback;
     void *data;
 
+    /* Optional, called when the final result of the operation arrives
+     * while earlier replies are still queued. It must not free the
+     * operation, the result is still delivered through callback later. */
+    sdap_op_callback_t *queued_result_cb;
+
     struct tevent_context *ev;
     struct sdap_msg *list;
     struct sdap_msg *last;
+
+    /* When the operation was sent, for request tracing */
+    struct timeval start;
+    /* The first reply was already accounted to the server latency */
+    bool replied;
 };
 
 struct fd_event_item {
@@ -79,6 +89,9 @@ struct sdap_handle {
     /* Authentication ticket expiration time (if any) */
     time_t expire_time;
     ber_int_t page_size;
+    /* page_size is tuned by sdap_adapt_page_size() up to this limit */
+    bool page_size_adaptive;
+    ber_int_t page_size_max;
     bool disable_deref;
 
     struct sdap_fd_events *sdap_fd_events;
@@ -89,6 +102,14 @@ struct sdap_handle {
 
     struct sdap_op *ops;
 
+    /* Per server operation metrics, NULL if not known */
+    struct sss_metric *op_latency;
+    struct sss_metric *op_timeouts;
+
+    /* Server the handle is connected to, it receives the round trip
+     * samples of the operations. NULL if not known */
+    struct fo_server *fo_server;
+
     /* during release we need to lock access to the handler
      * from the destructor to avoid recursion */
     bool destructor_lock;
@@ -236,6 +257,12 @@ enum sdap_basic_opt {
     SDAP_MAX_ID,
     SDAP_PWDLOCKOUT_DN,
     SDAP_WILDCARD_LIMIT,
+    SDAP_ENUM_RESUMABLE,
+    SDAP_ENUM_CHUNK_DELAY,
+    SDAP_PAGE_SIZE_ADAPTIVE,
+    SDAP_ROOTDSE_CACHE_TIMEOUT,
+    SDAP_CONNECTION_RACE_SERVERS,
+    SDAP_CONNECTION_RACE_DELAY,
 
     SDAP_OPTS_BASIC /* opts counter */
 };
@@ -501,12 +528,17 @@ struct sdap_options {
 
     /* Certificate mapping support */
     struct sdap_certmap_ctx *sdap_certmap_ctx;
+
+    /* rootDSE of the servers, see ldap_rootdse_cache_timeout */
+    struct sdap_rootdse_cache *rootdse_cache;
 };
 
 struct sdap_server_opts {
     char *server_id;
     bool supports_usn;
     unsigned long last_usn;
+    /* last_usn was read from a cached rootDSE and may be outdated */
+    bool cached_last_usn;
     char *max_user_value;
     char *max_group_value;
     char *max_service_value;
@@ -587,12 +619,45 @@ int sdap_parse_entry(TALLOC_CTX *memctx,
                      struct sysdb_attrs **_attrs,
                      bool disable_range_retrieval);
 
+/* Precompiled lookup table from LDAP attribute names to map entries. It
+ * keeps a pointer to the map, so it must not outlive it. */
+struct sdap_attr_map_index;
+
+errno_t sdap_attr_map_index_create(TALLOC_CTX *mem_ctx,
+                                   struct sdap_attr_map *map,
+                                   int num_attrs,
+                                   struct sdap_attr_map_index **_idx);
+
+/* Same as sdap_parse_entry(), but uses the precompiled index of the map,
+ * which is worth it when a lot of entries are parsed with the same map */
+int sdap_parse_entry_idx(TALLOC_CTX *memctx,
+                         struct sdap_handle *sh, struct sdap_msg *sm,
+                         struct sdap_attr_map_index *idx,
+                         struct sysdb_attrs **_attrs,
+                         bool disable_range_retrieval);
+
 errno_t sdap_parse_deref(TALLOC_CTX *mem_ctx,
                          struct sdap_attr_map_info *minfo,
                          size_t num_maps,
                          LDAPDerefRes *dref,
                          struct sdap_deref_attrs ***_deref_res);
 
+/* Lower bound of the adaptive page size and the amount of data a single
+ * page should not exceed */
+#define SDAP_PAGE_SIZE_MIN 50
+#define SDAP_PAGE_MAX_BYTES (4 * 1024 * 1024)
+
+/* Returns the size of the next page based on the last page, which returned
+ * num_entries entries with num_bytes bytes in elapsed_usec. The result aims
+ * at pages that take about target_usec and stays between SDAP_PAGE_SIZE_MIN
+ * and max_size. */
+ber_int_t sdap_adapt_page_size(ber_int_t cur_size,
+                               ber_int_t max_size,
+                               size_t num_entries,
+                               size_t num_bytes,
+                               uint64_t elapsed_usec,
+                               uint64_t target_usec);
+
 errno_t setup_tls_config(struct dp_option *basic_opts);
 
 int sdap_set_rootdse_supported_lists(struct sysdb_attrs *rootdse,
@@ -24,6 +24,8 @@
 #include "util/util.h"
 #include "util/strtonum.h"
 #include "util/probes.h"
+#include "util/sss_trace.h"
+#include "util/sss_metrics.h"
 #include "providers/ldap/sdap_async_private.h"
 
 #define REPLY_REALLOC_INCREMENT 10
@@ -252,6 +254,27 @@ static const char *sdap_ldap_result_str(int msgtype)
     return "Unknown result type!";
 }
 
+/* The time to the first reply is used as the server round trip time so
+ * that large searches do not make a server look slow */
+static void sdap_op_add_server_sample(struct sdap_op *op, bool success)
+{
+    struct timeval now;
+    struct timeval diff;
+    uint64_t usec = 0;
+
+    if (op->sh == NULL || op->sh->fo_server == NULL) {
+        return;
+    }
+
+    if (success) {
+        now = tevent_timeval_current();
+        diff = tevent_timeval_until(&op->start, &now);
+        usec = diff.tv_sec * 1000000ULL + diff.tv_usec;
+    }
+
+    fo_add_server_sample(op->sh->fo_server, usec, success);
+}
+
 /* process a message calling the right operation callback.
  * msg is completely taken care of (including freeing it)
  * NOTE: this function may even end up freeing the sdap_handle
@@ -298,6 +321,11 @@ static void sdap_process_message(struct tevent_context *ev,
     DEBUG(SSSDBG_TRACE_ALL,
           "Message type: [%s]\n", sdap_ldap_result_str(msgtype));
 
+    if (!op->replied) {
+        op->replied = true;
+        sdap_op_add_server_sample(op, true);
+    }
+
     switch (msgtype) {
     case LDAP_RES_SEARCH_ENTRY:
     case LDAP_RES_SEARCH_REFERENCE:
@@ -315,6 +343,8 @@ static void sdap_process_message(struct tevent_context *ev,
     case LDAP_RES_INTERMEDIATE:
         /* no more results expected with this msgid */
         op->done = true;
+        sss_trace_add(sss_trace_find(op), SSS_TRACE_LDAP, &op->start);
+        sss_metric_observe_since(op->sh->op_latency, &op->start);
         break;
 
     default:
@@ -344,6 +374,11 @@ static void sdap_process_message(struct tevent_context *ev,
         op->last->next = reply;
         op->last = reply;
 
+        /* let the operation look at its result ahead of the queued replies */
+        if (op->done && reply != NULL && op->queued_result_cb != NULL) {
+            op->queued_result_cb(op, reply, EOK, op->data);
+        }
+
     } else {
         /* create list, then call callback */
         op->list = op->last = reply;
@@ -432,6 +467,8 @@ static void sdap_op_timeout(struct tevent_req *req)
 
     /* signal the caller that we have a timeout */
     DEBUG(SSSDBG_TRACE_LIBS, "Issuing timeout for %d\n", op->msgid);
+    sss_metric_add(op->sh->op_timeouts, 1);
+    sdap_op_add_server_sample(op, false);
     op->callback(op, NULL, ETIMEDOUT, op->data);
 }
 
@@ -450,6 +487,7 @@ int sdap_op_add(TALLOC_CTX *memctx, struct tevent_context *ev,
     op->callback = callback;
     op->data = data;
     op->ev = ev;
+    op->start = tevent_timeval_current();
 
     DEBUG(SSSDBG_TRACE_INTERNAL,
           "New operation %d timeout %d\n", op->msgid, timeout);
@@ -1264,6 +1302,13 @@ struct sdap_get_generic_ext_state {
     int sizelimit;
 
     struct sdap_op *op;
+    /* Operation of the previous page if the current page was requested
+     * before all entries of the previous one were parsed */
+    struct sdap_op *prev_op;
+    bool last_page;
+    /* The statistics of the current page were already taken by
+     * sdap_get_generic_result_queued() */
+    bool page_accounted;
 
     struct berval cookie;
 
@@ -1277,14 +1322,32 @@ struct sdap_get_generic_ext_state {
     sdap_parse_cb parse_cb;
     void *cb_data;
 
+    /* Result code and controls returned with the last search result */
+    int result;
+    LDAPControl **returned_controls;
+
     unsigned int flags;
+
+    /* Statistics of the current page and of the whole search */
+    struct timeval start_time;
+    struct timeval page_time;
+    ber_int_t page_size;
+    size_t page_entries;
+    size_t page_bytes;
+    size_t num_pages;
+    size_t num_entries;
+    size_t num_bytes;
 };
 
 static errno_t sdap_get_generic_ext_step(struct tevent_req *req);
+static int sdap_get_generic_ext_state_destructor(void *ptr);
 
 static void sdap_get_generic_op_finished(struct sdap_op *op,
                                          struct sdap_msg *reply,
                                          int error, void *pvt);
+static void sdap_get_generic_result_queued(struct sdap_op *op,
+                                           struct sdap_msg *reply,
+                                           int error, void *pvt);
 
 enum {
     /* Be silent about exceeded size limit */
@@ -1339,6 +1402,9 @@ sdap_get_generic_ext_send(TALLOC_CTX *memctx,
     state->cb_data = cb_data;
     state->clientctrls = clientctrls;
     state->flags = flags;
+    state->start_time = tevent_timeval_current();
+    talloc_set_destructor((TALLOC_CTX *) state,
+                          sdap_get_generic_ext_state_destructor);
 
     if (state->sh == NULL || state->sh->ldap == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE,
@@ -1410,6 +1476,19 @@ sdap_get_generic_ext_send(TALLOC_CTX *memctx,
     return req;
 }
 
+static int sdap_get_generic_ext_state_destructor(void *ptr)
+{
+    struct sdap_get_generic_ext_state *state =
+            talloc_get_type(ptr, struct sdap_get_generic_ext_state);
+
+    if (state->returned_controls != NULL) {
+        ldap_controls_free(state->returned_controls);
+        state->returned_controls = NULL;
+    }
+
+    return 0;
+}
+
 static errno_t sdap_get_generic_ext_step(struct tevent_req *req)
 {
     struct sdap_get_generic_ext_state *state =
@@ -1422,6 +1501,7 @@ static errno_t sdap_get_generic_ext_step(struct tevent_req *req)
     bool disable_paging;
 
     LDAPControl *page_control = NULL;
+    ber_int_t page_size = 0;
 
     /* Make sure to free any previous operations so
      * if we are handling a large number of pages we
@@ -1450,8 +1530,9 @@ static errno_t sdap_get_generic_ext_step(struct tevent_req *req)
             && (state->flags & SDAP_SRCH_FLG_PAGING)
             && sdap_is_control_supported(state->sh,
                                          LDAP_CONTROL_PAGEDRESULTS)) {
+        page_size = state->sh->page_size;
         lret = ldap_create_page_control(state->sh->ldap,
-                                        state->sh->page_size,
+                                        page_size,
                                         state->cookie.bv_val ?
                                             &state->cookie :
                                             NULL,
@@ -1465,6 +1546,7 @@ static errno_t sdap_get_generic_ext_step(struct tevent_req *req)
         state->serverctrls[state->nserverctrls+1] = NULL;
     }
 
+    state->page_time = tevent_timeval_current();
     lret = ldap_search_ext(state->sh->ldap, state->search_base,
                            state->scope, state->filter,
                            discard_const(state->attrs),
@@ -1503,13 +1585,202 @@ static errno_t sdap_get_generic_ext_step(struct tevent_req *req)
                       &state->op);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Failed to set up operation!\n");
+        /* Nobody would read the reply of the search that was just sent */
+        ldap_abandon_ext(state->sh->ldap, msgid, NULL, NULL);
         goto done;
     }
 
+    state->page_size = page_size;
+    state->page_accounted = false;
+    state->page_entries = 0;
+    state->page_bytes = 0;
+    state->num_pages++;
+
+    if (page_size > 0) {
+        /* With paging the next page can be requested as soon as the result
+         * of this one arrives */
+        state->op->queued_result_cb = sdap_get_generic_result_queued;
+    }
+
 done:
     return ret;
 }
 
+/* Size of the encoded message as received from the server */
+static size_t sdap_msg_size(struct sdap_msg *msg)
+{
+    BerElement *ber;
+    ber_len_t len = 0;
+
+    ber = ldap_get_message_ber(msg->msg);
+    if (ber == NULL
+            || ber_get_option(ber, LBER_OPT_BER_TOTAL_BYTES,
+                              &len) != LBER_OPT_SUCCESS) {
+        return 0;
+    }
+
+    return len;
+}
+
+static uint64_t sdap_usec_since(struct timeval *tv)
+{
+    struct timeval now;
+    struct timeval diff;
+
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(tv, &now);
+
+    return (uint64_t) diff.tv_sec * 1000000 + diff.tv_usec;
+}
+
+/* Called when the server has sent the final result of the current page.
+ * The entries of the page that are not parsed yet are still queued on op. */
+static void sdap_get_generic_ext_page_done(struct sdap_get_generic_ext_state *state,
+                                           struct sdap_op *op)
+{
+    struct sdap_msg *msg;
+    size_t entries;
+    size_t bytes;
+    uint64_t elapsed;
+    uint64_t target;
+    ber_int_t page_size;
+
+    entries = state->page_entries;
+    bytes = state->page_bytes;
+    for (msg = op->list; msg != NULL; msg = msg->next) {
+        if (ldap_msgtype(msg->msg) == LDAP_RES_SEARCH_ENTRY) {
+            entries++;
+            bytes += sdap_msg_size(msg);
+        }
+    }
+    state->page_entries = 0;
+    state->page_bytes = 0;
+
+    if (state->page_size == 0 || !state->sh->page_size_adaptive) {
+        return;
+    }
+
+    /* Leave plenty of the operation timeout to a slow page */
+    elapsed = sdap_usec_since(&state->page_time);
+    target = state->timeout > 0 ? (uint64_t) state->timeout * 1000000 / 4
+                                : 1000000;
+
+    page_size = sdap_adapt_page_size(state->page_size,
+                                     state->sh->page_size_max,
+                                     entries, bytes, elapsed, target);
+    if (page_size != state->sh->page_size) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Page of %zu entries (%zu bytes) took %"PRIu64" ms, "
+              "changing page size from %d to %d\n",
+              entries, bytes, elapsed / 1000,
+              state->sh->page_size, page_size);
+        state->sh->page_size = page_size;
+    }
+}
+
+static errno_t
+sdap_get_generic_ext_set_cookie(struct sdap_get_generic_ext_state *state,
+                                struct berval *cookie)
+{
+    talloc_zfree(state->cookie.bv_val);
+    state->cookie.bv_len = cookie->bv_len;
+    state->cookie.bv_val = talloc_memdup(state, cookie->bv_val, cookie->bv_len);
+    if (state->cookie.bv_val == NULL) {
+        state->cookie.bv_len = 0;
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+static void sdap_get_generic_ext_finish(struct tevent_req *req)
+{
+    struct sdap_get_generic_ext_state *state =
+            tevent_req_data(req, struct sdap_get_generic_ext_state);
+
+    if (state->prev_op != NULL) {
+        /* Entries of the previous page are still waiting to be parsed */
+        state->last_page = true;
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+/* The result of a page arrived while its entries are still being parsed.
+ * The cookie it carries is all that is needed to request the next page, so
+ * do it right away and let the server prepare it while we catch up. */
+static void sdap_get_generic_result_queued(struct sdap_op *op,
+                                           struct sdap_msg *reply,
+                                           int error, void *pvt)
+{
+    struct tevent_req *req = talloc_get_type(pvt, struct tevent_req);
+    struct sdap_get_generic_ext_state *state = tevent_req_data(req,
+                                            struct sdap_get_generic_ext_state);
+    LDAPControl **returned_controls = NULL;
+    LDAPControl *page_control;
+    struct berval cookie = { 0, NULL };
+    ber_int_t total_count;
+    int result;
+    int lret;
+    errno_t ret;
+
+    if (error != EOK || op != state->op || state->prev_op != NULL
+            || ldap_msgtype(reply->msg) != LDAP_RES_SEARCH_RESULT) {
+        return;
+    }
+
+    lret = ldap_parse_result(state->sh->ldap, reply->msg, &result,
+                             NULL, NULL, NULL, &returned_controls, 0);
+    if (lret != LDAP_SUCCESS || result != LDAP_SUCCESS) {
+        /* The regular processing takes care of errors */
+        goto done;
+    }
+
+    page_control = ldap_control_find(LDAP_CONTROL_PAGEDRESULTS,
+                                     returned_controls, NULL);
+    if (page_control == NULL) {
+        goto done;
+    }
+
+    lret = ldap_parse_pageresponse_control(state->sh->ldap, page_control,
+                                           &total_count, &cookie);
+    if (lret != LDAP_SUCCESS || cookie.bv_val == NULL || cookie.bv_len == 0) {
+        goto done;
+    }
+
+    ret = sdap_get_generic_ext_set_cookie(state, &cookie);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    sdap_get_generic_ext_page_done(state, op);
+    state->page_accounted = true;
+
+    state->prev_op = state->op;
+    state->op = NULL;
+    ret = sdap_get_generic_ext_step(req);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Cannot request the next page in advance [%d]: %s\n",
+              ret, sss_strerror(ret));
+        /* Retry once the result is processed regularly, which must not
+         * take the statistics of this page a second time */
+        talloc_zfree(state->op);
+        state->op = state->prev_op;
+        state->prev_op = NULL;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_INTERNAL,
+          "Requested the next page while %d is still being parsed\n",
+          op->msgid);
+
+done:
+    ber_memfree(cookie.bv_val);
+    ldap_controls_free(returned_controls);
+}
+
 static errno_t
 sdap_get_generic_ext_add_references(struct sdap_get_generic_ext_state *state,
                                     char **refs)
@@ -1567,6 +1838,7 @@ static void sdap_get_generic_op_finished(struct sdap_op *op,
     struct berval cookie;
     LDAPControl **returned_controls = NULL;
     LDAPControl *page_control;
+    size_t size;
 
     if (error) {
         tevent_req_error(req, error);
@@ -1579,7 +1851,7 @@ static void sdap_get_generic_op_finished(struct sdap_op *op,
                                    &refs, NULL, 0);
         if (ret != LDAP_SUCCESS) {
             DEBUG(SSSDBG_OP_FAILURE,
-                  "ldap_parse_reference failed (%d)\n", state->op->msgid);
+                  "ldap_parse_reference failed (%d)\n", op->msgid);
             tevent_req_error(req, EIO);
             return;
         }
@@ -1598,7 +1870,7 @@ static void sdap_get_generic_op_finished(struct sdap_op *op,
         ldap_memvfree((void **)refs);
 
         /* unlock the operation so that we can proceed with the next result */
-        sdap_unlock_next_reply(state->op);
+        sdap_unlock_next_reply(op);
         break;
 
     case LDAP_RES_SEARCH_ENTRY:
@@ -1609,20 +1881,39 @@ static void sdap_get_generic_op_finished(struct sdap_op *op,
             return;
         }
 
-        sdap_unlock_next_reply(state->op);
+        size = sdap_msg_size(reply);
+        state->num_entries++;
+        state->num_bytes += size;
+        if (op == state->op) {
+            state->page_entries++;
+            state->page_bytes += size;
+        }
+
+        sdap_unlock_next_reply(op);
         break;
 
     case LDAP_RES_SEARCH_RESULT:
+        if (op == state->prev_op) {
+            /* The next page was already requested when this result
+             * arrived, all entries of this page are parsed now */
+            talloc_zfree(state->prev_op);
+            if (state->last_page) {
+                tevent_req_done(req);
+            }
+            return;
+        }
+
         ret = ldap_parse_result(state->sh->ldap, reply->msg,
                                 &result, NULL, &errmsg, &refs,
                                 &returned_controls, 0);
         if (ret != LDAP_SUCCESS) {
             DEBUG(SSSDBG_OP_FAILURE,
-                  "ldap_parse_result failed (%d)\n", state->op->msgid);
+                  "ldap_parse_result failed (%d)\n", op->msgid);
             tevent_req_error(req, EIO);
             return;
         }
 
+        state->result = result;
         DEBUG(SSSDBG_TRACE_FUNC, "Search result: %s(%d), %s\n",
                   sss_ldap_err2string(result), result,
                   errmsg ? errmsg : "no errmsg set");
@@ -1672,18 +1963,28 @@ static void sdap_get_generic_op_finished(struct sdap_op *op,
         }
         ldap_memfree(errmsg);
 
+        /* Keep the controls of the last result around, some callers
+         * (e.g. DirSync) need to inspect them once the search is done */
+        if (state->returned_controls != NULL) {
+            ldap_controls_free(state->returned_controls);
+        }
+        state->returned_controls = returned_controls;
+
+        if (!state->page_accounted) {
+            sdap_get_generic_ext_page_done(state, op);
+        }
+
         /* Determine if there are more pages to retrieve */
         page_control = ldap_control_find(LDAP_CONTROL_PAGEDRESULTS,
                                          returned_controls, NULL );
         if (!page_control) {
             /* No paging support. We are done */
-            tevent_req_done(req);
+            sdap_get_generic_ext_finish(req);
             return;
         }
 
         lret = ldap_parse_pageresponse_control(state->sh->ldap, page_control,
                                                &total_count, &cookie);
-        ldap_controls_free(returned_controls);
         if (lret != LDAP_SUCCESS) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Could not determine page control\n");
             tevent_req_error(req, EIO);
@@ -1695,16 +1996,12 @@ static void sdap_get_generic_op_finished(struct sdap_op *op,
             /* Cookie contains data, which means there are more requests
              * to be processed.
              */
-            talloc_zfree(state->cookie.bv_val);
-            state->cookie.bv_len = cookie.bv_len;
-            state->cookie.bv_val = talloc_memdup(state,
-                                                 cookie.bv_val,
-                                                 cookie.bv_len);
-            if (!state->cookie.bv_val) {
-                tevent_req_error(req, ENOMEM);
+            ret = sdap_get_generic_ext_set_cookie(state, &cookie);
+            ber_memfree(cookie.bv_val);
+            if (ret != EOK) {
+                tevent_req_error(req, ret);
                 return;
             }
-            ber_memfree(cookie.bv_val);
 
             ret = sdap_get_generic_ext_step(req);
             if (ret != EOK) {
@@ -1719,7 +2016,7 @@ static void sdap_get_generic_op_finished(struct sdap_op *op,
 
         /* This was the last page. We're done */
 
-        tevent_req_done(req);
+        sdap_get_generic_ext_finish(req);
         return;
 
     default:
@@ -1739,7 +2036,8 @@ sdap_get_generic_ext_recv(struct tevent_req *req,
             tevent_req_data(req, struct sdap_get_generic_ext_state);
 
     PROBE(SDAP_GET_GENERIC_EXT_RECV, state->search_base,
-          state->scope, state->filter);
+          state->scope, state->filter, state->num_entries, state->num_pages,
+          state->num_bytes, sdap_usec_since(&state->start_time));
 
     TEVENT_REQ_RETURN_ON_ERROR(req);
 
@@ -1754,6 +2052,35 @@ sdap_get_generic_ext_recv(struct tevent_req *req,
     return EOK;
 }
 
+/* Returns a control of the given OID that the server attached to the final
+ * search result. The control is owned by the request and is only valid until
+ * the request is freed. */
+static LDAPControl *
+sdap_get_generic_ext_result_control(struct tevent_req *req,
+                                    const char *oid)
+{
+    struct sdap_get_generic_ext_state *state =
+            tevent_req_data(req, struct sdap_get_generic_ext_state);
+
+    if (state->returned_controls == NULL) {
+        return NULL;
+    }
+
+    return ldap_control_find(oid, state->returned_controls, NULL);
+}
+
+/* Returns the LDAP result code of the final search result, or LDAP_SUCCESS
+ * if no result was parsed. Unlike the controls, the result code is also
+ * available if the request failed. */
+static int
+sdap_get_generic_ext_result_code(struct tevent_req *req)
+{
+    struct sdap_get_generic_ext_state *state =
+            tevent_req_data(req, struct sdap_get_generic_ext_state);
+
+    return state->result;
+}
+
 /* This search handler can be used by most calls */
 static void generic_ext_search_handler(struct tevent_req *subreq,
                                        struct sdap_options *opts)
@@ -1794,6 +2121,7 @@ static void generic_ext_search_handler(struct tevent_req *subreq,
 struct sdap_get_and_parse_generic_state {
     struct sdap_attr_map *map;
     int map_num_attrs;
+    struct sdap_attr_map_index *map_idx;
 
     struct sdap_reply sreply;
     struct sdap_options *opts;
@@ -1825,6 +2153,7 @@ struct tevent_req *sdap_get_and_parse_generic_send(TALLOC_CTX *memctx,
     struct tevent_req *subreq = NULL;
     struct sdap_get_and_parse_generic_state *state = NULL;
     unsigned int flags = 0;
+    errno_t ret;
 
     req = tevent_req_create(memctx, &state,
                             struct sdap_get_and_parse_generic_state);
@@ -1834,6 +2163,17 @@ struct tevent_req *sdap_get_and_parse_generic_send(TALLOC_CTX *memctx,
     state->map_num_attrs = map_num_attrs;
     state->opts = opts;
 
+    if (map != NULL) {
+        /* Compile the map once, every returned entry is parsed with it */
+        ret = sdap_attr_map_index_create(state, map, map_num_attrs,
+                                         &state->map_idx);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Cannot index the attribute map\n");
+            talloc_zfree(req);
+            return NULL;
+        }
+    }
+
     if (allow_paging) {
         flags |= SDAP_SRCH_FLG_PAGING;
     }
@@ -1868,9 +2208,13 @@ static errno_t sdap_get_and_parse_generic_parse_entry(struct sdap_handle *sh,
     bool disable_range_rtrvl = dp_opt_get_bool(state->opts->basic,
                                                SDAP_DISABLE_RANGE_RETRIEVAL);
 
-    ret = sdap_parse_entry(state, sh, msg,
-                           state->map, state->map_num_attrs,
-                           &attrs, disable_range_rtrvl);
+    if (state->map_idx != NULL) {
+        ret = sdap_parse_entry_idx(state, sh, msg, state->map_idx,
+                                   &attrs, disable_range_rtrvl);
+    } else {
+        ret = sdap_parse_entry(state, sh, msg, NULL, 0,
+                               &attrs, disable_range_rtrvl);
+    }
     if (ret != EOK) {
         DEBUG(SSSDBG_MINOR_FAILURE,
               "sdap_parse_entry failed [%d]: %s\n", ret, strerror(ret));
@@ -2423,6 +2767,413 @@ int sdap_sd_search_recv(struct tevent_req *req,
     return EOK;
 }
 
+/* ==DirSync search===================================================== */
+#define SDAP_DIRSYNC_RANGE_ADD "range=1-1"
+#define SDAP_DIRSYNC_RANGE_DEL "range=0-0"
+
+struct sdap_dirsync_search_state {
+    LDAPControl **ctrls;
+    struct sdap_options *opts;
+
+    size_t reply_count;
+    struct sdap_dirsync_entry **reply;
+
+    bool more_results;
+    uint8_t *cookie;
+    size_t cookie_len;
+};
+
+static int sdap_dirsync_search_ctrls_destructor(void *ptr);
+static errno_t sdap_dirsync_search_parse_entry(struct sdap_handle *sh,
+                                               struct sdap_msg *msg,
+                                               void *pvt);
+static void sdap_dirsync_search_done(struct tevent_req *subreq);
+
+struct tevent_req *
+sdap_dirsync_search_send(TALLOC_CTX *memctx,
+                         struct tevent_context *ev,
+                         struct sdap_options *opts,
+                         struct sdap_handle *sh,
+                         const char *base_dn,
+                         const char *filter,
+                         const char **attrs,
+                         int dirsync_flags,
+                         const uint8_t *cookie,
+                         size_t cookie_len,
+                         int timeout)
+{
+    struct tevent_req *req = NULL;
+    struct tevent_req *subreq = NULL;
+    struct sdap_dirsync_search_state *state;
+    struct berval *dsval = NULL;
+    int ret;
+
+    req = tevent_req_create(memctx, &state, struct sdap_dirsync_search_state);
+    if (!req) return NULL;
+
+    state->opts = opts;
+    state->ctrls = talloc_zero_array(state, LDAPControl *, 2);
+    if (state->ctrls == NULL) {
+        ret = ENOMEM;
+        goto fail;
+    }
+    talloc_set_destructor((TALLOC_CTX *) state->ctrls,
+                          sdap_dirsync_search_ctrls_destructor);
+
+    ret = sdap_dirsync_create_control_value(dirsync_flags,
+                                            SDAP_DIRSYNC_MAX_BYTES,
+                                            cookie, cookie_len, &dsval);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not encode DirSync control\n");
+        goto fail;
+    }
+
+    ret = sdap_control_create(sh, LDAP_SERVER_DIRSYNC_OID, 1, dsval, 1,
+                              &state->ctrls[0]);
+    ber_bvfree(dsval);
+    if (ret != LDAP_SUCCESS) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not create DirSync control\n");
+        ret = ret == LDAP_NOT_SUPPORTED ? ENOTSUP : EIO;
+        goto fail;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Searching [%s] using DirSync, cookie is %zu bytes long\n",
+          base_dn, cookie_len);
+    /* DirSync replaces paging, the server bounds the size of each reply
+     * and tells us through the response control if there is more */
+    subreq = sdap_get_generic_ext_send(state, ev, opts, sh, base_dn,
+                                       LDAP_SCOPE_SUBTREE, filter, attrs,
+                                       state->ctrls, NULL, 0, timeout,
+                                       sdap_dirsync_search_parse_entry,
+                                       state, 0);
+    if (!subreq) {
+        ret = ENOMEM;
+        goto fail;
+    }
+    tevent_req_set_callback(subreq, sdap_dirsync_search_done, req);
+    return req;
+
+fail:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+    return req;
+}
+
+errno_t sdap_dirsync_create_control_value(int flags,
+                                          int max_bytes,
+                                          const uint8_t *cookie,
+                                          size_t cookie_len,
+                                          struct berval **_value)
+{
+    BerElement *ber = NULL;
+    struct berval cookie_bv;
+    int ret;
+
+    cookie_bv.bv_val = discard_const(cookie);
+    cookie_bv.bv_len = cookie == NULL ? 0 : cookie_len;
+
+    ber = ber_alloc_t(LBER_USE_DER);
+    if (ber == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "ber_alloc_t failed.\n");
+        return ENOMEM;
+    }
+
+    ret = ber_printf(ber, "{iiO}", (ber_int_t) flags, (ber_int_t) max_bytes,
+                     &cookie_bv);
+    if (ret == -1) {
+        DEBUG(SSSDBG_OP_FAILURE, "ber_printf failed.\n");
+        ber_free(ber, 1);
+        return EIO;
+    }
+
+    ret = ber_flatten(ber, _value);
+    ber_free(ber, 1);
+    if (ret == -1) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "ber_flatten failed.\n");
+        return EIO;
+    }
+
+    return EOK;
+}
+
+errno_t sdap_dirsync_parse_control_value(TALLOC_CTX *mem_ctx,
+                                         struct berval *value,
+                                         bool *_more_results,
+                                         uint8_t **_cookie,
+                                         size_t *_cookie_len)
+{
+    BerElement *ber;
+    ber_int_t more_results;
+    ber_int_t unused;
+    struct berval cookie_bv = { 0, NULL };
+    uint8_t *cookie = NULL;
+    ber_tag_t tag;
+
+    if (value == NULL || value->bv_val == NULL) {
+        return EINVAL;
+    }
+
+    ber = ber_init(value);
+    if (ber == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "ber_init failed.\n");
+        return ENOMEM;
+    }
+
+    tag = ber_scanf(ber, "{iio}", &more_results, &unused, &cookie_bv);
+    ber_free(ber, 1);
+    if (tag == LBER_ERROR) {
+        DEBUG(SSSDBG_OP_FAILURE, "Malformed DirSync control value.\n");
+        return EINVAL;
+    }
+
+    if (cookie_bv.bv_len > 0) {
+        cookie = talloc_memdup(mem_ctx, cookie_bv.bv_val, cookie_bv.bv_len);
+        if (cookie == NULL) {
+            ber_memfree(cookie_bv.bv_val);
+            return ENOMEM;
+        }
+    }
+
+    *_more_results = (more_results != 0);
+    *_cookie = cookie;
+    *_cookie_len = cookie_bv.bv_len;
+    ber_memfree(cookie_bv.bv_val);
+
+    return EOK;
+}
+
+errno_t sdap_dirsync_parse_attr_desc(TALLOC_CTX *mem_ctx,
+                                     const char *attr_desc,
+                                     char **_base_attr,
+                                     enum sdap_dirsync_value_op *_op)
+{
+    const char *opt;
+    char *base_attr;
+    enum sdap_dirsync_value_op op = SDAP_DIRSYNC_VALUE_REPLACE;
+
+    opt = strchr(attr_desc, ';');
+    if (opt != NULL) {
+        if (strcasecmp(opt + 1, SDAP_DIRSYNC_RANGE_ADD) == 0) {
+            op = SDAP_DIRSYNC_VALUE_ADD;
+        } else if (strcasecmp(opt + 1, SDAP_DIRSYNC_RANGE_DEL) == 0) {
+            op = SDAP_DIRSYNC_VALUE_DELETE;
+        }
+    }
+
+    if (op == SDAP_DIRSYNC_VALUE_REPLACE) {
+        /* Any other attribute option is returned untouched */
+        base_attr = talloc_strdup(mem_ctx, attr_desc);
+    } else {
+        base_attr = talloc_strndup(mem_ctx, attr_desc, opt - attr_desc);
+    }
+    if (base_attr == NULL) {
+        return ENOMEM;
+    }
+
+    *_base_attr = base_attr;
+    *_op = op;
+    return EOK;
+}
+
+static errno_t sdap_dirsync_search_parse_entry(struct sdap_handle *sh,
+                                               struct sdap_msg *msg,
+                                               void *pvt)
+{
+    struct sdap_dirsync_search_state *state =
+                talloc_get_type(pvt, struct sdap_dirsync_search_state);
+    struct sdap_dirsync_entry *entry;
+    struct sdap_dirsync_entry **reply;
+    struct sysdb_attrs *target;
+    enum sdap_dirsync_value_op op;
+    BerElement *ber = NULL;
+    struct berval **vals;
+    struct ldb_val v;
+    char *base_attr;
+    char *str;
+    size_t i;
+    errno_t ret;
+    TALLOC_CTX *tmp_ctx;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) return ENOMEM;
+
+    entry = talloc_zero(tmp_ctx, struct sdap_dirsync_entry);
+    if (entry == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    entry->attrs = sysdb_new_attrs(entry);
+    entry->added = sysdb_new_attrs(entry);
+    entry->removed = sysdb_new_attrs(entry);
+    if (entry->attrs == NULL || entry->added == NULL
+            || entry->removed == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    str = ldap_get_dn(sh->ldap, msg->msg);
+    if (str == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "ldap_get_dn failed\n");
+        ret = EIO;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_LIBS, "DirSync change for [%s].\n", str);
+    ret = sysdb_attrs_add_string(entry->attrs, SYSDB_ORIG_DN, str);
+    ldap_memfree(str);
+    if (ret != EOK) goto done;
+
+    for (str = ldap_first_attribute(sh->ldap, msg->msg, &ber);
+         str != NULL;
+         str = ldap_next_attribute(sh->ldap, msg->msg, ber)) {
+        ret = sdap_dirsync_parse_attr_desc(tmp_ctx, str, &base_attr, &op);
+        if (ret != EOK) {
+            ldap_memfree(str);
+            goto done;
+        }
+
+        switch (op) {
+        case SDAP_DIRSYNC_VALUE_ADD:
+            target = entry->added;
+            break;
+        case SDAP_DIRSYNC_VALUE_DELETE:
+            target = entry->removed;
+            break;
+        default:
+            target = entry->attrs;
+            break;
+        }
+
+        vals = ldap_get_values_len(sh->ldap, msg->msg, str);
+        ldap_memfree(str);
+        if (vals == NULL) {
+            /* With incremental values an attribute that was cleared is
+             * sent without any values */
+            continue;
+        }
+
+        for (i = 0; vals[i] != NULL; i++) {
+            if (vals[i]->bv_len == 0) {
+                continue;
+            }
+
+            v.data = (uint8_t *) vals[i]->bv_val;
+            v.length = vals[i]->bv_len;
+            ret = sysdb_attrs_add_val(target, base_attr, &v);
+            if (ret != EOK) {
+                ldap_value_free_len(vals);
+                goto done;
+            }
+        }
+        ldap_value_free_len(vals);
+    }
+
+    reply = talloc_realloc(state, state->reply, struct sdap_dirsync_entry *,
+                           state->reply_count + 1);
+    if (reply == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    state->reply = reply;
+    state->reply[state->reply_count] = talloc_steal(state->reply, entry);
+    state->reply_count++;
+
+    ret = EOK;
+
+done:
+    if (ber) ber_free(ber, 0);
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static void sdap_dirsync_search_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    struct sdap_dirsync_search_state *state =
+                tevent_req_data(req, struct sdap_dirsync_search_state);
+    LDAPControl *dirsync_ctrl;
+    int lret;
+    int ret;
+
+    ret = sdap_get_generic_ext_recv(subreq, state, NULL, NULL);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "sdap_get_generic_ext_recv failed [%d]: %s\n",
+              ret, sss_strerror(ret));
+
+        /* Active Directory refuses a cookie it cannot use, e.g. one issued
+         * before the domain was restored, with one of these results */
+        lret = sdap_get_generic_ext_result_code(subreq);
+        if (lret == LDAP_UNWILLING_TO_PERFORM || lret == LDAP_PROTOCOL_ERROR) {
+            ret = ERR_DIRSYNC_COOKIE_REJECTED;
+        }
+
+        talloc_zfree(subreq);
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    dirsync_ctrl = sdap_get_generic_ext_result_control(subreq,
+                                                       LDAP_SERVER_DIRSYNC_OID);
+    if (dirsync_ctrl == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "The server did not return a DirSync response control\n");
+        talloc_zfree(subreq);
+        tevent_req_error(req, EIO);
+        return;
+    }
+
+    ret = sdap_dirsync_parse_control_value(state, &dirsync_ctrl->ldctl_value,
+                                           &state->more_results,
+                                           &state->cookie,
+                                           &state->cookie_len);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "DirSync returned %zu changes, more results: %s\n",
+          state->reply_count, state->more_results ? "yes" : "no");
+    tevent_req_done(req);
+}
+
+static int sdap_dirsync_search_ctrls_destructor(void *ptr)
+{
+    LDAPControl **ctrls = talloc_get_type(ptr, LDAPControl *);
+
+    if (ctrls && ctrls[0]) {
+        ldap_control_free(ctrls[0]);
+    }
+
+    return 0;
+}
+
+int sdap_dirsync_search_recv(struct tevent_req *req,
+                             TALLOC_CTX *mem_ctx,
+                             size_t *_reply_count,
+                             struct sdap_dirsync_entry ***_reply,
+                             uint8_t **_cookie,
+                             size_t *_cookie_len,
+                             bool *_more_results)
+{
+    struct sdap_dirsync_search_state *state = tevent_req_data(req,
+                                            struct sdap_dirsync_search_state);
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_reply_count = state->reply_count;
+    *_reply = talloc_steal(mem_ctx, state->reply);
+    *_cookie = talloc_steal(mem_ctx, state->cookie);
+    *_cookie_len = state->cookie_len;
+    *_more_results = state->more_results;
+
+    return EOK;
+}
+
 /* ==Attribute scoped search============================================ */
 struct sdap_asq_search_state {
     struct sdap_attr_map_info *maps;
@@ -214,6 +214,10 @@ int sdap_cli_connect_recv(struct tevent_req *req,
                           struct sdap_handle **gsh,
                           struct sdap_server_opts **srv_opts);
 
+/* Forget the rootDSE data cached in memory, the next connection to each
+ * server reads the rootDSE again */
+void sdap_rootdse_cache_flush(struct sdap_options *opts);
+
 /* Exposes all options of generic send while allowing to parse by map */
 struct tevent_req *sdap_get_and_parse_generic_send(TALLOC_CTX *memctx,
                                                    struct tevent_context *ev,
@@ -313,6 +317,60 @@ int sdap_sd_search_recv(struct tevent_req *req,
                         size_t *_ref_count,
                         char ***_refs);
 
+/* Upper bound of the size of a single DirSync reply */
+#define SDAP_DIRSYNC_MAX_BYTES (1024 * 1024)
+
+enum sdap_dirsync_value_op {
+    SDAP_DIRSYNC_VALUE_REPLACE = 0,
+    SDAP_DIRSYNC_VALUE_ADD,
+    SDAP_DIRSYNC_VALUE_DELETE
+};
+
+struct sdap_dirsync_entry {
+    /* Changed attributes keyed by their LDAP name, including the
+     * originalDN of the entry */
+    struct sysdb_attrs *attrs;
+    /* Linked values (e.g. member) added or removed since the cookie was
+     * issued. Only populated with LDAP_DIRSYNC_INCREMENTAL_VALUES. */
+    struct sysdb_attrs *added;
+    struct sysdb_attrs *removed;
+};
+
+struct tevent_req *
+sdap_dirsync_search_send(TALLOC_CTX *memctx,
+                         struct tevent_context *ev,
+                         struct sdap_options *opts,
+                         struct sdap_handle *sh,
+                         const char *base_dn,
+                         const char *filter,
+                         const char **attrs,
+                         int dirsync_flags,
+                         const uint8_t *cookie,
+                         size_t cookie_len,
+                         int timeout);
+int sdap_dirsync_search_recv(struct tevent_req *req,
+                             TALLOC_CTX *mem_ctx,
+                             size_t *_reply_count,
+                             struct sdap_dirsync_entry ***_reply,
+                             uint8_t **_cookie,
+                             size_t *_cookie_len,
+                             bool *_more_results);
+
+errno_t sdap_dirsync_create_control_value(int flags,
+                                          int max_bytes,
+                                          const uint8_t *cookie,
+                                          size_t cookie_len,
+                                          struct berval **_value);
+errno_t sdap_dirsync_parse_control_value(TALLOC_CTX *mem_ctx,
+                                         struct berval *value,
+                                         bool *_more_results,
+                                         uint8_t **_cookie,
+                                         size_t *_cookie_len);
+errno_t sdap_dirsync_parse_attr_desc(TALLOC_CTX *mem_ctx,
+                                     const char *attr_desc,
+                                     char **_base_attr,
+                                     enum sdap_dirsync_value_op *_op);
+
 errno_t
 sdap_attrs_add_ldap_attr(struct sysdb_attrs *ldap_attrs,
                          const char *attr_name,
@@ -27,6 +27,7 @@
 #include "util/sss_krb5.h"
 #include "util/sss_ldap.h"
 #include "util/strtonum.h"
+#include "util/sss_metrics.h"
 #include "providers/ldap/sdap_async_private.h"
 #include "providers/ldap/ldap_common.h"
 
@@ -105,6 +106,14 @@ struct tevent_req *sdap_connect_send(TALLOC_CTX *memctx,
 
     state->sh->page_size = dp_opt_get_int(state->opts->basic,
                                           SDAP_PAGE_SIZE);
+    state->sh->page_size_max = state->sh->page_size;
+    state->sh->page_size_adaptive = dp_opt_get_bool(state->opts->basic,
+                                                    SDAP_PAGE_SIZE_ADAPTIVE);
+
+    state->sh->op_latency = sss_metric_histogram("sdap_op.%s.latency",
+                                                 state->uri);
+    state->sh->op_timeouts = sss_metric_counter("sdap_op.%s.timeouts",
+                                                state->uri);
 
     timeout = dp_opt_get_int(state->opts->basic, SDAP_NETWORK_TIMEOUT);
 
@@ -1413,6 +1422,441 @@ errno_t sdap_auth_recv(struct tevent_req *req,
     return EOK;
 }
 
+/* ==rootDSE cache============================================= */
+
+#define SDAP_ROOTDSE_SUBTREE "ldap_rootdse"
+
+struct sdap_rootdse_cache_entry {
+    struct sdap_rootdse_cache_entry *prev;
+    struct sdap_rootdse_cache_entry *next;
+
+    char *uri;
+    struct sysdb_attrs *rootdse;
+    time_t expire;
+};
+
+struct sdap_rootdse_cache {
+    struct sdap_rootdse_cache_entry *entries;
+};
+
+/* Only the attributes consumed by sdap_cli_use_rootdse() are cached */
+static const char *sdap_rootdse_cache_attrs[] = {
+    "altServer",
+    "supportedControl",
+    "supportedExtension",
+    "supportedFeatures",
+    "supportedLDAPVersion",
+    "supportedSASLMechanisms",
+    SDAP_ROOTDSE_ATTR_NAMING_CONTEXTS,
+    SDAP_ROOTDSE_ATTR_DEFAULT_NAMING_CONTEXT,
+    SDAP_ROOTDSE_ATTR_AD_VERSION,
+    SDAP_ROOTDSE_ATTR_AD_SCHEMA_NC,
+    SDAP_IPA_LAST_USN,
+    SDAP_AD_LAST_USN,
+    NULL
+};
+
+static errno_t sdap_rootdse_cache_copy_attr(struct sysdb_attrs *src,
+                                            struct sysdb_attrs *dst,
+                                            const char *name)
+{
+    struct ldb_message_element *el;
+    unsigned int i;
+    errno_t ret;
+
+    /* Unlike sysdb_attrs_copy_values() this does not add an empty
+     * element to src if the attribute is missing */
+    ret = sysdb_attrs_get_el_ext(src, name, false, &el);
+    if (ret == ENOENT) {
+        return EOK;
+    } else if (ret != EOK) {
+        return ret;
+    }
+
+    for (i = 0; i < el->num_values; i++) {
+        ret = sysdb_attrs_add_val(dst, name, &el->values[i]);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    return EOK;
+}
+
+static errno_t sdap_rootdse_cache_filter(TALLOC_CTX *mem_ctx,
+                                         struct sdap_options *opts,
+                                         struct sysdb_attrs *src,
+                                         struct sysdb_attrs **_dst)
+{
+    struct sysdb_attrs *dst;
+    const char *last_usn;
+    errno_t ret;
+    int i;
+
+    dst = sysdb_new_attrs(mem_ctx);
+    if (dst == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; sdap_rootdse_cache_attrs[i] != NULL; i++) {
+        ret = sdap_rootdse_cache_copy_attr(src, dst,
+                                           sdap_rootdse_cache_attrs[i]);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    /* ldap_rootdse_last_usn may point to a non-standard attribute */
+    last_usn = opts->gen_map[SDAP_AT_LAST_USN].name;
+    if (last_usn != NULL && !string_in_list(last_usn,
+                                 discard_const(sdap_rootdse_cache_attrs),
+                                 false)) {
+        ret = sdap_rootdse_cache_copy_attr(src, dst, last_usn);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    *_dst = dst;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(dst);
+    }
+    return ret;
+}
+
+static struct sdap_rootdse_cache_entry *
+sdap_rootdse_cache_find(struct sdap_rootdse_cache *cache, const char *uri)
+{
+    struct sdap_rootdse_cache_entry *entry;
+
+    for (entry = cache->entries; entry != NULL; entry = entry->next) {
+        if (strcmp(entry->uri, uri) == 0) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static errno_t sdap_rootdse_cache_set(struct sdap_rootdse_cache *cache,
+                                      const char *uri,
+                                      struct sysdb_attrs *rootdse,
+                                      time_t expire)
+{
+    struct sdap_rootdse_cache_entry *entry;
+
+    entry = sdap_rootdse_cache_find(cache, uri);
+    if (entry == NULL) {
+        entry = talloc_zero(cache, struct sdap_rootdse_cache_entry);
+        if (entry == NULL) {
+            return ENOMEM;
+        }
+
+        entry->uri = talloc_strdup(entry, uri);
+        if (entry->uri == NULL) {
+            talloc_free(entry);
+            return ENOMEM;
+        }
+
+        DLIST_ADD(cache->entries, entry);
+    }
+
+    talloc_free(entry->rootdse);
+    entry->rootdse = talloc_steal(entry, rootdse);
+    entry->expire = expire;
+
+    return EOK;
+}
+
+/* Reads the copies saved by sdap_rootdse_cache_save() so that the rootDSE
+ * does not need to be searched after a restart of the backend */
+static errno_t sdap_rootdse_cache_load(struct sdap_rootdse_cache *cache,
+                                       struct sdap_options *opts,
+                                       struct sss_domain_info *dom)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char *attrs[] = { "*", NULL };
+    struct ldb_message **msgs;
+    struct sysdb_attrs **all;
+    struct sysdb_attrs *rootdse;
+    const char *uri;
+    time_t expire;
+    size_t count;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_search_custom(tmp_ctx, dom, "(" SYSDB_NAME "=*)",
+                              SDAP_ROOTDSE_SUBTREE, attrs, &count, &msgs);
+    if (ret == ENOENT) {
+        ret = EOK;
+        goto done;
+    } else if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_msg2attrs(tmp_ctx, count, msgs, &all);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    for (i = 0; i < count; i++) {
+        uri = ldb_msg_find_attr_as_string(msgs[i], SYSDB_NAME, NULL);
+        expire = ldb_msg_find_attr_as_uint64(msgs[i], SYSDB_CACHE_EXPIRE, 0);
+        if (uri == NULL) {
+            continue;
+        }
+
+        ret = sdap_rootdse_cache_filter(tmp_ctx, opts, all[i], &rootdse);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        ret = sdap_rootdse_cache_set(cache, uri, rootdse, expire);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        DEBUG(SSSDBG_TRACE_FUNC, "Loaded cached rootDSE of [%s]\n", uri);
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t sdap_rootdse_cache_save(struct sss_domain_info *dom,
+                                       const char *uri,
+                                       struct sysdb_attrs *rootdse,
+                                       time_t expire)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sysdb_attrs *attrs;
+    bool in_transaction = false;
+    errno_t ret;
+    errno_t sret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    attrs = sysdb_new_attrs(tmp_ctx);
+    if (attrs == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sysdb_attrs_copy(rootdse, attrs);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_attrs_add_string(attrs, SYSDB_NAME, uri);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_attrs_add_time_t(attrs, SYSDB_CACHE_EXPIRE, expire);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_transaction_start(dom->sysdb);
+    if (ret != EOK) {
+        goto done;
+    }
+    in_transaction = true;
+
+    /* Replace the whole object so that no attribute the server stopped
+     * announcing is left behind */
+    ret = sysdb_delete_custom(dom, uri, SDAP_ROOTDSE_SUBTREE);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_store_custom(dom, uri, SDAP_ROOTDSE_SUBTREE, attrs);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_transaction_commit(dom->sysdb);
+    if (ret != EOK) {
+        goto done;
+    }
+    in_transaction = false;
+
+done:
+    if (in_transaction) {
+        sret = sysdb_transaction_cancel(dom->sysdb);
+        if (sret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Could not cancel transaction\n");
+        }
+    }
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static struct sdap_rootdse_cache *
+sdap_rootdse_cache_get(struct sdap_options *opts)
+{
+    struct sdap_rootdse_cache *cache;
+    errno_t ret;
+
+    if (dp_opt_get_int(opts->basic, SDAP_ROOTDSE_CACHE_TIMEOUT) <= 0
+            || opts->sdom == NULL || opts->sdom->dom == NULL) {
+        return NULL;
+    }
+
+    if (opts->rootdse_cache != NULL) {
+        return opts->rootdse_cache;
+    }
+
+    cache = talloc_zero(opts, struct sdap_rootdse_cache);
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    ret = sdap_rootdse_cache_load(cache, opts, opts->sdom->dom);
+    if (ret != EOK) {
+        /* Not fatal, the rootDSE is just read from the servers */
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Cannot load cached rootDSE data [%d]: %s\n",
+              ret, sss_strerror(ret));
+    }
+
+    opts->rootdse_cache = cache;
+    return cache;
+}
+
+static void sdap_rootdse_cache_store(struct sdap_options *opts,
+                                     const char *uri,
+                                     struct sysdb_attrs *rootdse)
+{
+    struct sdap_rootdse_cache *cache;
+    struct sysdb_attrs *copy;
+    time_t expire;
+    errno_t ret;
+
+    cache = sdap_rootdse_cache_get(opts);
+    if (cache == NULL || uri == NULL || rootdse == NULL) {
+        return;
+    }
+
+    ret = sdap_rootdse_cache_filter(cache, opts, rootdse, &copy);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    expire = time(NULL)
+                + dp_opt_get_int(opts->basic, SDAP_ROOTDSE_CACHE_TIMEOUT);
+
+    ret = sdap_rootdse_cache_save(opts->sdom->dom, uri, copy, expire);
+    if (ret != EOK) {
+        /* The copy in memory is still useful */
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Cannot save rootDSE of [%s] to the cache [%d]: %s\n",
+              uri, ret, sss_strerror(ret));
+    }
+
+    ret = sdap_rootdse_cache_set(cache, uri, copy, expire);
+
+done:
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Cannot cache rootDSE of [%s] [%d]: %s\n",
+              uri, ret, sss_strerror(ret));
+    }
+}
+
+void sdap_rootdse_cache_flush(struct sdap_options *opts)
+{
+    if (opts == NULL || opts->rootdse_cache == NULL) {
+        return;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Flushing cached rootDSE data\n");
+
+    /* Do not load the copies from sysdb again */
+    talloc_free_children(opts->rootdse_cache);
+    opts->rootdse_cache->entries = NULL;
+}
+
+struct sdap_rootdse_refresh_state {
+    struct sdap_options *opts;
+    char *uri;
+};
+
+static void sdap_rootdse_refresh_done(struct tevent_req *subreq);
+
+/* Reads the rootDSE on an established connection without blocking its
+ * users. The request lives on the handle, so it goes away together with
+ * the connection. */
+static errno_t sdap_rootdse_refresh(struct tevent_context *ev,
+                                    struct sdap_options *opts,
+                                    struct sdap_handle *sh,
+                                    const char *uri)
+{
+    struct sdap_rootdse_refresh_state *state;
+    struct tevent_req *subreq;
+
+    state = talloc_zero(sh, struct sdap_rootdse_refresh_state);
+    if (state == NULL) {
+        return ENOMEM;
+    }
+
+    state->opts = opts;
+    state->uri = talloc_strdup(state, uri);
+    if (state->uri == NULL) {
+        talloc_free(state);
+        return ENOMEM;
+    }
+
+    subreq = sdap_get_rootdse_send(state, ev, opts, sh);
+    if (subreq == NULL) {
+        talloc_free(state);
+        return ENOMEM;
+    }
+    tevent_req_set_callback(subreq, sdap_rootdse_refresh_done, state);
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Refreshing cached rootDSE of [%s]\n", uri);
+    return EOK;
+}
+
+static void sdap_rootdse_refresh_done(struct tevent_req *subreq)
+{
+    struct sdap_rootdse_refresh_state *state;
+    struct sysdb_attrs *rootdse;
+    errno_t ret;
+
+    state = tevent_req_callback_data(subreq,
+                                     struct sdap_rootdse_refresh_state);
+
+    ret = sdap_get_rootdse_recv(subreq, state, &rootdse);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        /* The stale copy is tried again after the grace period */
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Cannot refresh rootDSE of [%s] [%d]: %s\n",
+              state->uri, ret, sss_strerror(ret));
+        goto done;
+    }
+
+    sdap_rootdse_cache_store(state->opts, state->uri, rootdse);
+
+done:
+    talloc_free(state);
+}
+
 /* ==Client connect============================================ */
 
 struct sdap_cli_connect_state {
@@ -1423,6 +1867,9 @@ struct sdap_cli_connect_state {
 
     bool use_rootdse;
     struct sysdb_attrs *rootdse;
+    /* rootdse comes from the cache, refresh it once connected if stale */
+    bool rootdse_cached;
+    bool rootdse_refresh;
 
     struct sdap_handle *sh;
 
@@ -1440,7 +1887,9 @@ static void sdap_cli_resolve_done(struct tevent_req *subreq);
 static void sdap_cli_connect_done(struct tevent_req *subreq);
 static void sdap_cli_rootdse_step(struct tevent_req *req);
 static void sdap_cli_rootdse_done(struct tevent_req *subreq);
+static errno_t sdap_cli_cached_rootdse(struct sdap_cli_connect_state *state);
 static errno_t sdap_cli_use_rootdse(struct sdap_cli_connect_state *state);
+static void sdap_cli_finish(struct tevent_req *req);
 static void sdap_cli_kinit_step(struct tevent_req *req);
 static void sdap_cli_kinit_done(struct tevent_req *subreq);
 static void sdap_cli_auth_step(struct tevent_req *req);
@@ -1449,7 +1898,7 @@ static errno_t sdap_cli_auth_reconnect(struct tevent_req *subreq);
 static void sdap_cli_auth_reconnect_done(struct tevent_req *subreq);
 static void sdap_cli_rootdse_auth_done(struct tevent_req *subreq);
 
-static errno_t
+errno_t
 decide_tls_usage(enum connect_tls force_tls, struct dp_option *basic,
                  const char *uri, bool *_use_tls)
 {
@@ -1554,18 +2003,9 @@ static void sdap_cli_resolve_done(struct tevent_req *subreq)
         return;
     }
 
-    ret = decide_tls_usage(state->force_tls, state->opts->basic,
-                           state->service->uri, &state->use_tls);
-
-    if (ret != EOK) {
-        tevent_req_error(req, EINVAL);
-        return;
-    }
-
-    subreq = sdap_connect_send(state, state->ev, state->opts,
-                               state->service->uri,
-                               state->service->sockaddr,
-                               state->use_tls);
+    subreq = sdap_connect_race_send(state, state->ev, state->opts,
+                                    state->be, state->service, state->srv,
+                                    state->force_tls);
     if (!subreq) {
         tevent_req_error(req, ENOMEM);
         return;
@@ -1583,12 +2023,11 @@ static void sdap_cli_connect_done(struct tevent_req *subreq)
     int ret;
 
     talloc_zfree(state->sh);
-    ret = sdap_connect_recv(subreq, state, &state->sh);
+    ret = sdap_connect_race_recv(subreq, state, &state->sh, &state->srv,
+                                 &state->use_tls);
     talloc_zfree(subreq);
     if (ret) {
-        /* retry another server */
-        be_fo_set_port_status(state->be, state->service->name,
-                              state->srv, PORT_NOT_WORKING);
+        /* retry another server, the failed ones were already marked */
         ret = sdap_cli_resolve_next(req);
         if (ret != EOK) {
             tevent_req_error(req, ret);
@@ -1596,10 +2035,20 @@ static void sdap_cli_connect_done(struct tevent_req *subreq)
         return;
     }
 
+    /* Let the operations on this connection score the server as well */
+    fo_ref_server(state->sh, state->srv);
+    state->sh->fo_server = state->srv;
+
     if (state->use_rootdse) {
-        /* fetch the rootDSE this time */
-        sdap_cli_rootdse_step(req);
-        return;
+        ret = sdap_cli_cached_rootdse(state);
+        if (ret == ENOENT) {
+            /* fetch the rootDSE this time */
+            sdap_cli_rootdse_step(req);
+            return;
+        } else if (ret != EOK) {
+            tevent_req_error(req, ret);
+            return;
+        }
     }
 
     sasl_mech = dp_opt_get_string(state->opts->basic, SDAP_SASL_MECH);
@@ -1707,10 +2156,76 @@ static void sdap_cli_rootdse_done(struct tevent_req *subreq)
     sdap_cli_auth_step(req);
 }
 
+/* Uses the cached rootDSE of the server if there is one. Returns ENOENT if
+ * the rootDSE has to be read from the server. */
+static errno_t sdap_cli_cached_rootdse(struct sdap_cli_connect_state *state)
+{
+    struct sdap_rootdse_cache *cache;
+    struct sdap_rootdse_cache_entry *entry;
+    time_t now;
+    errno_t ret;
+
+    cache = sdap_rootdse_cache_get(state->opts);
+    if (cache == NULL) {
+        return ENOENT;
+    }
+
+    entry = sdap_rootdse_cache_find(cache, state->service->uri);
+    if (entry == NULL) {
+        return ENOENT;
+    }
+
+    state->rootdse = sysdb_new_attrs(state);
+    if (state->rootdse == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_attrs_copy(entry->rootdse, state->rootdse);
+    if (ret != EOK) {
+        talloc_zfree(state->rootdse);
+        return ret;
+    }
+
+    now = time(NULL);
+    state->rootdse_cached = true;
+    if (entry->expire <= now) {
+        state->rootdse_refresh = true;
+        /* Let other connections use the stale copy while this one refreshes
+         * it, they try again if the refresh does not succeed in time */
+        entry->expire = now + dp_opt_get_int(state->opts->basic,
+                                             SDAP_SEARCH_TIMEOUT);
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Using %s cached rootDSE of [%s]\n",
+          state->rootdse_refresh ? "expired" : "valid", state->service->uri);
+
+    if (!state->sh->connected) {
+        /* sdap_cli_rootdse_step() would have done this, it allows the
+         * anonymous bind below */
+        ret = sdap_set_connected(state->sh, state->ev);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    ret = sdap_cli_use_rootdse(state);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "sdap_cli_use_rootdse failed\n");
+        return ret;
+    }
+
+    return EOK;
+}
+
 static errno_t sdap_cli_use_rootdse(struct sdap_cli_connect_state *state)
 {
     errno_t ret;
 
+    if (state->rootdse && !state->rootdse_cached) {
+        sdap_rootdse_cache_store(state->opts, state->service->uri,
+                                 state->rootdse);
+    }
+
     if (state->rootdse) {
         /* save rootdse data about supported features */
         ret = sdap_set_rootdse_supported_lists(state->rootdse, state->sh);
@@ -1739,10 +2254,31 @@ static errno_t sdap_cli_use_rootdse(struct sdap_cli_connect_state *state)
               "sdap_get_server_opts_from_rootdse failed.\n");
         return ret;
     }
+    state->srv_opts->cached_last_usn = state->rootdse_cached;
 
     return EOK;
 }
 
+static void sdap_cli_finish(struct tevent_req *req)
+{
+    struct sdap_cli_connect_state *state = tevent_req_data(req,
+                                             struct sdap_cli_connect_state);
+    errno_t ret;
+
+    if (state->rootdse_refresh) {
+        /* Only now, the connection must not be used during the bind */
+        ret = sdap_rootdse_refresh(state->ev, state->opts, state->sh,
+                                   state->service->uri);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Cannot refresh the cached rootDSE [%d]: %s\n",
+                  ret, sss_strerror(ret));
+        }
+    }
+
+    tevent_req_done(req);
+}
+
 static void sdap_cli_kinit_step(struct tevent_req *req)
 {
     struct sdap_cli_connect_state *state = tevent_req_data(req,
@@ -1843,7 +2379,7 @@ static void sdap_cli_auth_step(struct tevent_req *req)
         (sasl_mech == NULL && user_dn == NULL)) {
         DEBUG(SSSDBG_TRACE_LIBS,
               "No authentication requested or SASL auth forced off\n");
-        tevent_req_done(req);
+        sdap_cli_finish(req);
         return;
     }
 
@@ -1993,7 +2529,7 @@ static void sdap_cli_auth_done(struct tevent_req *subreq)
         return;
     }
 
-    tevent_req_done(req);
+    sdap_cli_finish(req);
 }
 
 static void sdap_cli_rootdse_auth_done(struct tevent_req *subreq)
@@ -417,6 +417,160 @@ errno_t sdap_dom_enum_recv(struct tevent_req *req)
     return sdap_dom_enum_ex_recv(req);
 }
 
+/* ==Resumable-Enumeration-Chunks========================================= */
+
+/* Full enumerations can be split into chunks by the first character of the
+ * name. Unlike a paged results cookie, the index of the next chunk remains
+ * valid across reconnects and restarts, so it is stored in the cache after
+ * each chunk was saved and an interrupted enumeration continues from there.
+ * The last chunk catches names starting with any other character. */
+static const char *sdap_enum_chunk_prefixes[] = {
+    "a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k", "l", "m",
+    "n", "o", "p", "q", "r", "s", "t", "u", "v", "w", "x", "y", "z",
+    "0", "1", "2", "3", "4", "5", "6", "7", "8", "9", NULL
+};
+
+#define SDAP_ENUM_NUM_CHUNKS \
+    (sizeof(sdap_enum_chunk_prefixes) / sizeof(sdap_enum_chunk_prefixes[0]))
+
+static errno_t sdap_enum_chunk_start(struct sdap_id_ctx *ctx,
+                                     struct sdap_domain *sdom,
+                                     const char *checkpoint_attr,
+                                     bool full,
+                                     bool *_chunked,
+                                     uint32_t *_chunk)
+{
+    uint32_t chunk;
+    errno_t ret;
+
+    if (!dp_opt_get_bool(ctx->opts->basic, SDAP_ENUM_RESUMABLE)) {
+        *_chunked = false;
+        *_chunk = 0;
+        return EOK;
+    }
+
+    ret = sysdb_get_enum_checkpoint(sdom->dom, checkpoint_attr, &chunk);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Cannot read enumeration checkpoint "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        return ret;
+    }
+
+    if (chunk >= SDAP_ENUM_NUM_CHUNKS) {
+        chunk = 0;
+    }
+
+    if (chunk > 0) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Resuming interrupted enumeration of %s "
+              "at chunk %u\n", sdom->dom->name, chunk);
+    }
+
+    /* An interrupted full enumeration is always finished first */
+    *_chunked = full || chunk > 0;
+    *_chunk = chunk;
+    return EOK;
+}
+
+static char *sdap_enum_chunk_filter(TALLOC_CTX *mem_ctx,
+                                    const char *filter,
+                                    const char *name_attr,
+                                    uint32_t chunk)
+{
+    char *chunk_filter;
+    size_t i;
+
+    if (sdap_enum_chunk_prefixes[chunk] != NULL) {
+        return talloc_asprintf(mem_ctx, "(&%s(%s=%s*))", filter, name_attr,
+                               sdap_enum_chunk_prefixes[chunk]);
+    }
+
+    chunk_filter = talloc_asprintf(mem_ctx, "(&%s(!(|", filter);
+    for (i = 0; chunk_filter != NULL && sdap_enum_chunk_prefixes[i]; i++) {
+        chunk_filter = talloc_asprintf_append_buffer(chunk_filter, "(%s=%s*)",
+                                                 name_attr,
+                                                 sdap_enum_chunk_prefixes[i]);
+    }
+
+    if (chunk_filter != NULL) {
+        chunk_filter = talloc_asprintf_append_buffer(chunk_filter, ")))");
+    }
+
+    return chunk_filter;
+}
+
+/* Records the finished chunk. Returns EAGAIN if another chunk should be
+ * fetched after the delay, EOK if the enumeration is complete. */
+static errno_t sdap_enum_chunk_done(struct sdap_id_ctx *ctx,
+                                    struct sdap_domain *sdom,
+                                    const char *checkpoint_attr,
+                                    uint32_t *_chunk)
+{
+    uint32_t next = *_chunk + 1;
+    errno_t ret;
+
+    if (next >= SDAP_ENUM_NUM_CHUNKS) {
+        next = 0;
+    }
+
+    ret = sysdb_set_enum_checkpoint(sdom->dom, checkpoint_attr, next);
+    if (ret != EOK) {
+        /* Not fatal, the enumeration would just start over next time */
+        DEBUG(SSSDBG_MINOR_FAILURE, "Cannot store enumeration checkpoint "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+    }
+
+    *_chunk = next;
+    return next == 0 ? EOK : EAGAIN;
+}
+
+static struct tevent_req *sdap_enum_chunk_wait_send(TALLOC_CTX *mem_ctx,
+                                                    struct tevent_context *ev,
+                                                    struct sdap_id_ctx *ctx)
+{
+    int delay;
+
+    delay = dp_opt_get_int(ctx->opts->basic, SDAP_ENUM_CHUNK_DELAY);
+    if (delay < 0) {
+        delay = 0;
+    }
+
+    return tevent_wakeup_send(mem_ctx, ev, tevent_timeval_current_ofs(delay, 0));
+}
+
+/* During a chunked enumeration every chunk reports its own highest USN */
+static void sdap_enum_update_usn(struct sdap_id_ctx *ctx,
+                                 char **_max_value,
+                                 char *usn_value,
+                                 bool keep_highest)
+{
+    char *endptr = NULL;
+    unsigned long usn_number;
+    unsigned long max_number;
+
+    if (keep_highest && *_max_value != NULL) {
+        usn_number = strtoul(usn_value, &endptr, 10);
+        if (*endptr != '\0' || endptr == usn_value) {
+            return;
+        }
+
+        max_number = strtoul(*_max_value, &endptr, 10);
+        if (*endptr == '\0' && endptr != *_max_value
+                && usn_number <= max_number) {
+            return;
+        }
+    }
+
+    talloc_zfree(*_max_value);
+    *_max_value = talloc_steal(ctx, usn_value);
+
+    endptr = NULL;
+    usn_number = strtoul(usn_value, &endptr, 10);
+    if ((endptr == NULL || (*endptr == '\0' && endptr != usn_value))
+        && (usn_number > ctx->srv_opts->last_usn)) {
+        ctx->srv_opts->last_usn = usn_number;
+    }
+}
+
 /* ==User-Enumeration===================================================== */
 struct enum_users_state {
     struct tevent_context *ev;
@@ -426,9 +580,14 @@ struct enum_users_state {
 
     char *filter;
     const char **attrs;
+
+    bool chunked;
+    uint32_t chunk;
 };
 
+static errno_t enum_users_step(struct tevent_req *req);
 static void enum_users_done(struct tevent_req *subreq);
+static void enum_users_wait_done(struct tevent_req *subreq);
 
 static struct tevent_req *enum_users_send(TALLOC_CTX *memctx,
                                           struct tevent_context *ev,
@@ -488,7 +647,16 @@ static struct tevent_req *enum_users_send(TALLOC_CTX *memctx,
         goto fail;
     }
 
-    if (ctx->srv_opts && ctx->srv_opts->max_user_value && !purge) {
+    ret = sdap_enum_chunk_start(ctx, sdom, SYSDB_ENUM_USERS_CHECKPOINT,
+                                purge || ctx->srv_opts == NULL
+                                      || ctx->srv_opts->max_user_value == NULL,
+                                &state->chunked, &state->chunk);
+    if (ret != EOK) {
+        goto fail;
+    }
+
+    if (ctx->srv_opts && ctx->srv_opts->max_user_value && !purge
+            && !state->chunked) {
         /* If we have lastUSN available and we're not doing a full
          * refresh, limit to changes with a higher entryUSN value.
          */
@@ -521,6 +689,37 @@ static struct tevent_req *enum_users_send(TALLOC_CTX *memctx,
                                NULL, &state->attrs, NULL);
     if (ret != EOK) goto fail;
 
+    ret = enum_users_step(req);
+    if (ret != EOK) goto fail;
+
+    return req;
+
+fail:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+    return req;
+}
+
+static errno_t enum_users_step(struct tevent_req *req)
+{
+    struct enum_users_state *state = tevent_req_data(req,
+                                                     struct enum_users_state);
+    struct tevent_req *subreq;
+    char *filter;
+
+    if (state->chunked) {
+        filter = sdap_enum_chunk_filter(state, state->filter,
+                            state->ctx->opts->user_map[SDAP_AT_USER_NAME].name,
+                            state->chunk);
+        if (filter == NULL) {
+            return ENOMEM;
+        }
+        DEBUG(SSSDBG_TRACE_FUNC, "Enumerating users, chunk %u\n",
+              state->chunk);
+    } else {
+        filter = state->filter;
+    }
+
     /* TODO: restrict the enumerations to using a single
      * search base at a time.
      */
@@ -531,22 +730,16 @@ static struct tevent_req *enum_users_send(TALLOC_CTX *memctx,
                                  state->ctx->opts,
                                  state->sdom->user_search_bases,
                                  sdap_id_op_handle(state->op),
-                                 state->attrs, state->filter,
+                                 state->attrs, filter,
                                  dp_opt_get_int(state->ctx->opts->basic,
                                                 SDAP_ENUM_SEARCH_TIMEOUT),
                                  SDAP_LOOKUP_ENUMERATE, NULL);
     if (!subreq) {
-        ret = ENOMEM;
-        goto fail;
+        return ENOMEM;
     }
     tevent_req_set_callback(subreq, enum_users_done, req);
 
-    return req;
-
-fail:
-    tevent_req_error(req, ret);
-    tevent_req_post(req, ev);
-    return req;
+    return EOK;
 }
 
 static void enum_users_done(struct tevent_req *subreq)
@@ -556,35 +749,65 @@ static void enum_users_done(struct tevent_req *subreq)
     struct enum_users_state *state = tevent_req_data(req,
                                                      struct enum_users_state);
     char *usn_value;
-    char *endptr = NULL;
-    unsigned usn_number;
     int ret;
 
     ret = sdap_get_users_recv(subreq, state, &usn_value);
     talloc_zfree(subreq);
-    if (ret) {
+    if (ret == ENOENT && state->chunked) {
+        /* No user in this chunk */
+        usn_value = NULL;
+    } else if (ret) {
         tevent_req_error(req, ret);
         return;
     }
 
     if (usn_value) {
-        talloc_zfree(state->ctx->srv_opts->max_user_value);
-        state->ctx->srv_opts->max_user_value =
-                                        talloc_steal(state->ctx, usn_value);
-
-        usn_number = strtoul(usn_value, &endptr, 10);
-        if ((endptr == NULL || (*endptr == '\0' && endptr != usn_value))
-            && (usn_number > state->ctx->srv_opts->last_usn)) {
-            state->ctx->srv_opts->last_usn = usn_number;
-        }
+        sdap_enum_update_usn(state->ctx,
+                             &state->ctx->srv_opts->max_user_value,
+                             usn_value, state->chunked);
     }
 
     DEBUG(SSSDBG_CONF_SETTINGS, "Users higher USN value: [%s]\n",
               state->ctx->srv_opts->max_user_value);
 
+    if (state->chunked) {
+        ret = sdap_enum_chunk_done(state->ctx, state->sdom,
+                                   SYSDB_ENUM_USERS_CHECKPOINT,
+                                   &state->chunk);
+        if (ret == EAGAIN) {
+            subreq = sdap_enum_chunk_wait_send(state, state->ev, state->ctx);
+            if (subreq == NULL) {
+                tevent_req_error(req, ENOMEM);
+                return;
+            }
+            tevent_req_set_callback(subreq, enum_users_wait_done, req);
+            return;
+        }
+    }
+
     tevent_req_done(req);
 }
 
+static void enum_users_wait_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    errno_t ret;
+
+    if (!tevent_wakeup_recv(subreq)) {
+        talloc_zfree(subreq);
+        tevent_req_error(req, EIO);
+        return;
+    }
+    talloc_zfree(subreq);
+
+    ret = enum_users_step(req);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+}
+
 static errno_t enum_users_recv(struct tevent_req *req)
 {
     TEVENT_REQ_RETURN_ON_ERROR(req);
@@ -601,9 +824,14 @@ struct enum_groups_state {
 
     char *filter;
     const char **attrs;
+
+    bool chunked;
+    uint32_t chunk;
 };
 
+static errno_t enum_groups_step(struct tevent_req *req);
 static void enum_groups_done(struct tevent_req *subreq);
+static void enum_groups_wait_done(struct tevent_req *subreq);
 
 static struct tevent_req *enum_groups_send(TALLOC_CTX *memctx,
                                           struct tevent_context *ev,
@@ -674,7 +902,16 @@ static struct tevent_req *enum_groups_send(TALLOC_CTX *memctx,
         goto fail;
     }
 
-    if (ctx->srv_opts && ctx->srv_opts->max_group_value && !purge) {
+    ret = sdap_enum_chunk_start(ctx, sdom, SYSDB_ENUM_GROUPS_CHECKPOINT,
+                                purge || ctx->srv_opts == NULL
+                                      || ctx->srv_opts->max_group_value == NULL,
+                                &state->chunked, &state->chunk);
+    if (ret != EOK) {
+        goto fail;
+    }
+
+    if (ctx->srv_opts && ctx->srv_opts->max_group_value && !purge
+            && !state->chunked) {
         state->filter = talloc_asprintf_append_buffer(
                 state->filter,
                 "(%s>=%s)(!(%s=%s))",
@@ -703,6 +940,37 @@ static struct tevent_req *enum_groups_send(TALLOC_CTX *memctx,
                                NULL, &state->attrs, NULL);
     if (ret != EOK) goto fail;
 
+    ret = enum_groups_step(req);
+    if (ret != EOK) goto fail;
+
+    return req;
+
+fail:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+    return req;
+}
+
+static errno_t enum_groups_step(struct tevent_req *req)
+{
+    struct enum_groups_state *state = tevent_req_data(req,
+                                                 struct enum_groups_state);
+    struct tevent_req *subreq;
+    char *filter;
+
+    if (state->chunked) {
+        filter = sdap_enum_chunk_filter(state, state->filter,
+                          state->ctx->opts->group_map[SDAP_AT_GROUP_NAME].name,
+                          state->chunk);
+        if (filter == NULL) {
+            return ENOMEM;
+        }
+        DEBUG(SSSDBG_TRACE_FUNC, "Enumerating groups, chunk %u\n",
+              state->chunk);
+    } else {
+        filter = state->filter;
+    }
+
     /* TODO: restrict the enumerations to using a single
      * search base at a time.
      */
@@ -711,22 +979,16 @@ static struct tevent_req *enum_groups_send(TALLOC_CTX *memctx,
                                   state->sdom,
                                   state->ctx->opts,
                                   sdap_id_op_handle(state->op),
-                                  state->attrs, state->filter,
+                                  state->attrs, filter,
                                   dp_opt_get_int(state->ctx->opts->basic,
                                                  SDAP_ENUM_SEARCH_TIMEOUT),
                                   SDAP_LOOKUP_ENUMERATE, false);
     if (!subreq) {
-        ret = ENOMEM;
-        goto fail;
+        return ENOMEM;
     }
     tevent_req_set_callback(subreq, enum_groups_done, req);
 
-    return req;
-
-fail:
-    tevent_req_error(req, ret);
-    tevent_req_post(req, ev);
-    return req;
+    return EOK;
 }
 
 static void enum_groups_done(struct tevent_req *subreq)
@@ -736,34 +998,65 @@ static void enum_groups_done(struct tevent_req *subreq)
     struct enum_groups_state *state = tevent_req_data(req,
                                                  struct enum_groups_state);
     char *usn_value;
-    char *endptr = NULL;
-    unsigned usn_number;
     int ret;
 
     ret = sdap_get_groups_recv(subreq, state, &usn_value);
     talloc_zfree(subreq);
-    if (ret) {
+    if (ret == ENOENT && state->chunked) {
+        /* No group in this chunk */
+        usn_value = NULL;
+    } else if (ret) {
         tevent_req_error(req, ret);
         return;
     }
 
     if (usn_value) {
-        talloc_zfree(state->ctx->srv_opts->max_group_value);
-        state->ctx->srv_opts->max_group_value =
-                                        talloc_steal(state->ctx, usn_value);
-        usn_number = strtoul(usn_value, &endptr, 10);
-        if ((endptr == NULL || (*endptr == '\0' && endptr != usn_value))
-            && (usn_number > state->ctx->srv_opts->last_usn)) {
-            state->ctx->srv_opts->last_usn = usn_number;
-        }
+        sdap_enum_update_usn(state->ctx,
+                             &state->ctx->srv_opts->max_group_value,
+                             usn_value, state->chunked);
     }
 
     DEBUG(SSSDBG_CONF_SETTINGS, "Groups higher USN value: [%s]\n",
               state->ctx->srv_opts->max_group_value);
 
+    if (state->chunked) {
+        ret = sdap_enum_chunk_done(state->ctx, state->sdom,
+                                   SYSDB_ENUM_GROUPS_CHECKPOINT,
+                                   &state->chunk);
+        if (ret == EAGAIN) {
+            subreq = sdap_enum_chunk_wait_send(state, state->ev, state->ctx);
+            if (subreq == NULL) {
+                tevent_req_error(req, ENOMEM);
+                return;
+            }
+            tevent_req_set_callback(subreq, enum_groups_wait_done, req);
+            return;
+        }
+    }
+
     tevent_req_done(req);
 }
 
+static void enum_groups_wait_done(struct tevent_req *subreq)
+{
+    struct tevent_req *req = tevent_req_callback_data(subreq,
+                                                      struct tevent_req);
+    errno_t ret;
+
+    if (!tevent_wakeup_recv(subreq)) {
+        talloc_zfree(subreq);
+        tevent_req_error(req, EIO);
+        return;
+    }
+    talloc_zfree(subreq);
+
+    ret = enum_groups_step(req);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+}
+
 static errno_t enum_groups_recv(struct tevent_req *req)
 {
     TEVENT_REQ_RETURN_ON_ERROR(req);
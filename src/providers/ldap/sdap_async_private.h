@@ -71,6 +71,25 @@ int sdap_get_rootdse_recv(struct tevent_req *req,
 
 errno_t deref_string_to_val(const char *str, int *val);
 
+errno_t
+decide_tls_usage(enum connect_tls force_tls, struct dp_option *basic,
+                 const char *uri, bool *_use_tls);
+
+/* from sdap_connect_race.c */
+struct tevent_req *
+sdap_connect_race_send(TALLOC_CTX *memctx,
+                       struct tevent_context *ev,
+                       struct sdap_options *opts,
+                       struct be_ctx *be,
+                       struct sdap_service *service,
+                       struct fo_server *srv,
+                       enum connect_tls force_tls);
+int sdap_connect_race_recv(struct tevent_req *req,
+                           TALLOC_CTX *memctx,
+                           struct sdap_handle **_sh,
+                           struct fo_server **_srv,
+                           bool *_use_tls);
+
 /* from sdap_child_helpers.c */
 
 struct tevent_req *sdap_get_tgt_send(TALLOC_CTX *mem_ctx,
@@ -0,0 +1,404 @@
+/*
+    SSSD
+
+    Connect to several LDAP servers in parallel
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "util/util.h"
+#include "providers/backend.h"
+#include "providers/ldap/sdap_async_private.h"
+#include "providers/ldap/ldap_common.h"
+
+/*
+ * The servers are connected to in the fail over order. The next server is
+ * tried when the previous attempt failed or did not finish within
+ * ldap_connection_race_delay milliseconds, the first connection established
+ * wins and the other attempts are cancelled.
+ */
+
+struct sdap_connect_race_attempt {
+    struct tevent_req *req;
+    struct fo_server *srv;
+    struct timeval start;
+    bool use_tls;
+};
+
+struct sdap_connect_race_state {
+    struct tevent_context *ev;
+    struct sdap_options *opts;
+    struct be_ctx *be;
+    struct sdap_service *service;
+    enum connect_tls force_tls;
+
+    struct fo_server **servers;
+    size_t num_servers;
+    size_t next_server;
+    size_t running;
+    int delay;
+
+    /* Parent of all attempts, freed when the race is decided */
+    TALLOC_CTX *attempts;
+    struct tevent_timer *delay_timer;
+
+    struct sdap_handle *sh;
+    struct fo_server *srv;
+    bool use_tls;
+};
+
+static errno_t sdap_connect_race_start(struct tevent_req *req);
+static void sdap_connect_race_continue(struct tevent_req *req, errno_t ret);
+static void sdap_connect_race_delay_done(struct tevent_context *ev,
+                                         struct tevent_timer *te,
+                                         struct timeval tv, void *pvt);
+static void sdap_connect_race_resolve_done(struct tevent_req *subreq);
+static errno_t
+sdap_connect_race_connect(struct sdap_connect_race_attempt *attempt);
+static void sdap_connect_race_connect_done(struct tevent_req *subreq);
+static void
+sdap_connect_race_failed(struct sdap_connect_race_attempt *attempt,
+                         errno_t ret);
+
+struct tevent_req *
+sdap_connect_race_send(TALLOC_CTX *memctx,
+                       struct tevent_context *ev,
+                       struct sdap_options *opts,
+                       struct be_ctx *be,
+                       struct sdap_service *service,
+                       struct fo_server *srv,
+                       enum connect_tls force_tls)
+{
+    struct sdap_connect_race_state *state;
+    struct tevent_req *req;
+    int max;
+    errno_t ret;
+
+    req = tevent_req_create(memctx, &state, struct sdap_connect_race_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->ev = ev;
+    state->opts = opts;
+    state->be = be;
+    state->service = service;
+    state->force_tls = force_tls;
+    state->delay = dp_opt_get_int(opts->basic, SDAP_CONNECTION_RACE_DELAY);
+
+    state->attempts = talloc_new(state);
+    if (state->attempts == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    max = dp_opt_get_int(opts->basic, SDAP_CONNECTION_RACE_SERVERS);
+    if (max > 1) {
+        ret = be_fo_get_candidate_servers(state, be, service->name, srv, max,
+                                          &state->servers,
+                                          &state->num_servers);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to get servers to connect "
+                  "to in parallel, using only one [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            state->servers = NULL;
+        }
+    }
+
+    if (state->servers == NULL) {
+        state->servers = talloc_zero_array(state, struct fo_server *, 1);
+        if (state->servers == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        state->servers[0] = srv;
+        state->num_servers = 1;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Connecting to up to %zu servers\n",
+          state->num_servers);
+
+    ret = sdap_connect_race_start(req);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Cannot connect to '%s' [%d]: %s\n",
+              fo_get_server_str_name(srv), ret, sss_strerror(ret));
+
+        /* The other candidates can still win the race */
+        sdap_connect_race_continue(req, ret);
+        if (!tevent_req_is_in_progress(req)) {
+            tevent_req_post(req, ev);
+        }
+        return req;
+    }
+
+done:
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        tevent_req_post(req, ev);
+    }
+
+    return req;
+}
+
+static errno_t sdap_connect_race_start(struct tevent_req *req)
+{
+    struct sdap_connect_race_state *state;
+    struct sdap_connect_race_attempt *attempt;
+    struct tevent_req *subreq;
+    struct timeval tv;
+    bool first;
+    errno_t ret;
+
+    state = tevent_req_data(req, struct sdap_connect_race_state);
+
+    first = (state->next_server == 0);
+
+    attempt = talloc_zero(state->attempts, struct sdap_connect_race_attempt);
+    if (attempt == NULL) {
+        return ENOMEM;
+    }
+    attempt->req = req;
+    attempt->srv = state->servers[state->next_server++];
+
+    if (first) {
+        /* The address was resolved by be_resolve_server_send() already */
+        ret = sdap_connect_race_connect(attempt);
+    } else {
+        DEBUG(SSSDBG_TRACE_FUNC, "Trying also server '%s'\n",
+              fo_get_server_str_name(attempt->srv));
+
+        subreq = be_resolve_candidate_send(attempt, state->ev, state->be,
+                                           attempt->srv);
+        if (subreq == NULL) {
+            ret = ENOMEM;
+        } else {
+            tevent_req_set_callback(subreq, sdap_connect_race_resolve_done,
+                                    attempt);
+            ret = EOK;
+        }
+    }
+
+    if (ret != EOK) {
+        talloc_free(attempt);
+        return ret;
+    }
+
+    state->running++;
+
+    talloc_zfree(state->delay_timer);
+    if (state->next_server < state->num_servers) {
+        tv = tevent_timeval_current_ofs(state->delay / 1000,
+                                        (state->delay % 1000) * 1000);
+        state->delay_timer = tevent_add_timer(state->ev, state, tv,
+                                              sdap_connect_race_delay_done,
+                                              req);
+        if (state->delay_timer == NULL) {
+            /* The next server is still tried if this attempt fails */
+            DEBUG(SSSDBG_MINOR_FAILURE, "tevent_add_timer() failed\n");
+        }
+    }
+
+    return EOK;
+}
+
+/* Start the remaining attempts until one of them is running */
+static void sdap_connect_race_continue(struct tevent_req *req, errno_t ret)
+{
+    struct sdap_connect_race_state *state;
+
+    state = tevent_req_data(req, struct sdap_connect_race_state);
+
+    while (state->next_server < state->num_servers) {
+        ret = sdap_connect_race_start(req);
+        if (ret == EOK) {
+            return;
+        }
+    }
+
+    if (state->running == 0) {
+        tevent_req_error(req, ret);
+    }
+}
+
+static void sdap_connect_race_delay_done(struct tevent_context *ev,
+                                         struct tevent_timer *te,
+                                         struct timeval tv, void *pvt)
+{
+    struct tevent_req *req;
+    struct sdap_connect_race_state *state;
+    errno_t ret;
+
+    req = talloc_get_type(pvt, struct tevent_req);
+    state = tevent_req_data(req, struct sdap_connect_race_state);
+
+    state->delay_timer = NULL;
+
+    ret = sdap_connect_race_start(req);
+    if (ret != EOK) {
+        sdap_connect_race_continue(req, ret);
+    }
+}
+
+static void sdap_connect_race_resolve_done(struct tevent_req *subreq)
+{
+    struct sdap_connect_race_attempt *attempt;
+    errno_t ret;
+
+    attempt = tevent_req_callback_data(subreq,
+                                       struct sdap_connect_race_attempt);
+
+    ret = be_resolve_candidate_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to resolve server '%s' [%d]: %s\n",
+              fo_get_server_str_name(attempt->srv), ret, sss_strerror(ret));
+        sdap_connect_race_failed(attempt, ret);
+        return;
+    }
+
+    ret = sdap_connect_race_connect(attempt);
+    if (ret != EOK) {
+        sdap_connect_race_failed(attempt, ret);
+        return;
+    }
+}
+
+static errno_t
+sdap_connect_race_connect(struct sdap_connect_race_attempt *attempt)
+{
+    struct sdap_connect_race_state *state;
+    struct tevent_req *subreq;
+    errno_t ret;
+
+    state = tevent_req_data(attempt->req, struct sdap_connect_race_state);
+
+    /* Let the provider construct the URI of this server */
+    ret = be_fo_run_server_callbacks(state->be, state->service->name,
+                                     attempt->srv);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = decide_tls_usage(state->force_tls, state->opts->basic,
+                           state->service->uri, &attempt->use_tls);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    attempt->start = tevent_timeval_current();
+    subreq = sdap_connect_send(attempt, state->ev, state->opts,
+                               state->service->uri,
+                               state->service->sockaddr,
+                               attempt->use_tls);
+    if (subreq == NULL) {
+        return ENOMEM;
+    }
+
+    tevent_req_set_callback(subreq, sdap_connect_race_connect_done, attempt);
+    return EOK;
+}
+
+static void sdap_connect_race_connect_done(struct tevent_req *subreq)
+{
+    struct sdap_connect_race_attempt *attempt;
+    struct sdap_connect_race_state *state;
+    struct tevent_req *req;
+    struct sdap_handle *sh;
+    struct timeval now;
+    struct timeval diff;
+    errno_t ret;
+
+    attempt = tevent_req_callback_data(subreq,
+                                       struct sdap_connect_race_attempt);
+    req = attempt->req;
+    state = tevent_req_data(req, struct sdap_connect_race_state);
+
+    ret = sdap_connect_recv(subreq, state, &sh);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        be_fo_set_port_status(state->be, state->service->name,
+                              attempt->srv, PORT_NOT_WORKING);
+        sdap_connect_race_failed(attempt, ret);
+        return;
+    }
+
+    now = tevent_timeval_current();
+    diff = tevent_timeval_until(&attempt->start, &now);
+    fo_add_server_sample(attempt->srv,
+                         diff.tv_sec * 1000000ULL + diff.tv_usec, true);
+
+    state->sh = sh;
+    state->srv = attempt->srv;
+    state->use_tls = attempt->use_tls;
+
+    if (state->running > 1) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Connected to '%s', cancelling %zu other "
+              "connection attempts\n", fo_get_server_str_name(state->srv),
+              state->running - 1);
+    }
+
+    /* The servers are referenced by state->servers, the attempt and the
+     * connections of the losers can go away */
+    talloc_zfree(state->delay_timer);
+    talloc_zfree(state->attempts);
+    state->running = 0;
+
+    /* Point the service back to the winner */
+    ret = be_fo_use_server(state->be, state->service->name, state->srv);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+static void
+sdap_connect_race_failed(struct sdap_connect_race_attempt *attempt,
+                         errno_t ret)
+{
+    struct tevent_req *req = attempt->req;
+    struct sdap_connect_race_state *state;
+
+    state = tevent_req_data(req, struct sdap_connect_race_state);
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Connection to '%s' failed [%d]: %s\n",
+          fo_get_server_str_name(attempt->srv), ret, sss_strerror(ret));
+
+    state->running--;
+    talloc_free(attempt);
+
+    /* Do not wait for the delay, start the next attempt right away */
+    sdap_connect_race_continue(req, ret);
+}
+
+int sdap_connect_race_recv(struct tevent_req *req,
+                           TALLOC_CTX *memctx,
+                           struct sdap_handle **_sh,
+                           struct fo_server **_srv,
+                           bool *_use_tls)
+{
+    struct sdap_connect_race_state *state;
+
+    state = tevent_req_data(req, struct sdap_connect_race_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    fo_ref_server(memctx, state->srv);
+    *_srv = state->srv;
+    *_sh = talloc_steal(memctx, state->sh);
+    *_use_tls = state->use_tls;
+
+    return EOK;
+}
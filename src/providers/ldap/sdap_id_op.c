@@ -25,6 +25,7 @@
 #include "providers/ldap/ldap_common.h"
 #include "providers/ldap/sdap_async.h"
 #include "providers/ldap/sdap_id_op.h"
+#include "util/sss_trace.h"
 
 /* LDAP async connection cache */
 struct sdap_id_conn_cache {
@@ -368,6 +369,8 @@ struct sdap_id_op_connect_state {
     struct sdap_id_op *op;
     int dp_error;
     int result;
+
+    struct timeval start;
 };
 
 /* Destructor for operation connection request */
@@ -417,6 +420,7 @@ struct tevent_req *sdap_id_op_connect_send(struct sdap_id_op *op,
     state->id_conn = op->conn_cache->id_conn;
     state->ev = state->id_conn->id_ctx->be->ev;
     state->op = op;
+    state->start = tevent_timeval_current();
     op->connect_req = req;
 
     if (op->conn_data) {
@@ -579,6 +583,7 @@ static void sdap_id_op_connect_done(struct tevent_req *subreq)
 
             if (strcmp(srv_opts->server_id, current_srv_opts->server_id) == 0 &&
                 srv_opts->supports_usn &&
+                !srv_opts->cached_last_usn &&
                 current_srv_opts->last_usn > srv_opts->last_usn) {
                 DEBUG(SSSDBG_FUNC_DATA, "Server was probably re-initialized\n");
 
@@ -784,6 +789,8 @@ static void sdap_id_op_connect_req_complete(struct sdap_id_op *op, int dp_error,
     state->dp_error = dp_error;
     state->result = ret;
 
+    sss_trace_add(sss_trace_find(req), SSS_TRACE_CONNECT, &state->start);
+
     if (ret == EOK) {
         tevent_req_done(req);
     } else {
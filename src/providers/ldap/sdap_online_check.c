@@ -52,6 +52,10 @@ static struct tevent_req *sdap_online_check_send(TALLOC_CTX *mem_ctx,
     state->id_ctx = id_ctx;
     state->be_ctx = be_ctx = id_ctx->be;
 
+    /* The server might have been re-initialized while we were offline,
+     * which can only be detected with its current rootDSE */
+    sdap_rootdse_cache_flush(id_ctx->opts);
+
     subreq = sdap_cli_connect_send(state, be_ctx->ev, id_ctx->opts, be_ctx,
                                    id_ctx->conn->service, false,
                                    CON_TLS_DFL, false);
@@ -106,6 +110,7 @@ static void sdap_online_check_connect_done(struct tevent_req *subreq)
             srv_opts->max_sudo_value = 0;
         } else if (strcmp(srv_opts->server_id, id_ctx->srv_opts->server_id) == 0
                    && srv_opts->supports_usn
+                   && !srv_opts->cached_last_usn
                    && id_ctx->srv_opts->last_usn > srv_opts->last_usn) {
             id_ctx->srv_opts->max_user_value = 0;
             id_ctx->srv_opts->max_group_value = 0;
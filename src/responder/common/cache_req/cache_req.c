@@ -112,6 +112,18 @@ cache_req_dom_type_as_str(struct cache_req *cr)
     return "Unknown";
 }
 
+static const char *cache_req_service_name(struct resp_ctx *rctx)
+{
+    const char *name;
+
+    if (rctx->confdb_service_path == NULL) {
+        return "responder";
+    }
+
+    name = strrchr(rctx->confdb_service_path, '/');
+    return name == NULL ? rctx->confdb_service_path : name + 1;
+}
+
 static struct cache_req *
 cache_req_create(TALLOC_CTX *mem_ctx,
                  struct resp_ctx *rctx,
@@ -120,14 +132,30 @@ cache_req_create(TALLOC_CTX *mem_ctx,
                  int midpoint,
                  enum cache_req_dom_type req_dom_type)
 {
+    struct sss_trace *trace;
     struct cache_req *cr;
+    uint32_t reqid;
     errno_t ret;
 
-    cr = talloc_zero(mem_ctx, struct cache_req);
+    /* It is perfectly fine to just overflow here. */
+    reqid = rctx->cache_req_num++;
+
+    /* The request is allocated under its trace so that the data provider
+     * requests sent on its behalf can find it. */
+    trace = sss_trace_new(mem_ctx, "%s:%d:%u",
+                          cache_req_service_name(rctx), getpid(), reqid);
+    if (trace == NULL) {
+        return NULL;
+    }
+
+    cr = talloc_zero(trace, struct cache_req);
     if (cr == NULL) {
+        talloc_free(trace);
         return NULL;
     }
 
+    cr->trace = trace;
+    cr->reqid = reqid;
     cr->rctx = rctx;
     cr->data = data;
     cr->ncache = ncache;
@@ -135,12 +163,9 @@ cache_req_create(TALLOC_CTX *mem_ctx,
     cr->req_dom_type = req_dom_type;
     cr->req_start = time(NULL);
 
-    /* It is perfectly fine to just overflow here. */
-    cr->reqid = rctx->cache_req_num++;
-
     ret = cache_req_set_plugin(cr, data->type);
     if (ret != EOK) {
-        talloc_free(cr);
+        talloc_free(trace);
         return NULL;
     }
 
@@ -150,13 +175,19 @@ cache_req_create(TALLOC_CTX *mem_ctx,
     if (cr->bypass_cache && cr->bypass_dp) {
         CACHE_REQ_DEBUG(SSSDBG_CRIT_FAILURE, cr,
                         "Cannot bypass cache and dp at the same time!");
-        talloc_free(cr);
+        talloc_free(trace);
         return NULL;
     }
 
     return cr;
 }
 
+static void
+cache_req_trace_report(struct cache_req *cr, errno_t ret)
+{
+    sss_trace_report(cr->trace, cr->reqname, cr->debugobj, ret);
+}
+
 static errno_t
 cache_req_set_name(struct cache_req *cr, const char *name)
 {
@@ -1467,11 +1498,13 @@ static void cache_req_process_result(struct tevent_req *subreq)
         break;
     case ENOENT:
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr, "Finished: Not found\n");
+        cache_req_trace_report(state->cr, ret);
         tevent_req_error(req, ret);
         break;
     default:
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
                         "Finished: Error %d: %s\n", ret, sss_strerror(ret));
+        cache_req_trace_report(state->cr, ret);
         tevent_req_error(req, ret);
         break;
     }
@@ -1493,11 +1526,13 @@ static void cache_req_done(struct tevent_req *subreq)
     switch (ret) {
     case EOK:
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr, "Finished: Success\n");
+        cache_req_trace_report(state->cr, ret);
         tevent_req_done(req);
         break;
     default:
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
                         "Finished: Error %d: %s\n", ret, sss_strerror(ret));
+        cache_req_trace_report(state->cr, ret);
         tevent_req_error(req, ret);
         break;
     }
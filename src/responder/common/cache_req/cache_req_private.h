@@ -23,6 +23,8 @@
 
 #include <stdint.h>
 
+#include "util/sss_trace.h"
+#include "util/sss_metrics.h"
 #include "responder/common/responder.h"
 #include "responder/common/cache_req/cache_req.h"
 
@@ -50,6 +52,8 @@ struct cache_req {
     uint32_t reqid;
     const char *reqname;
     const char *debugobj;
+    /* The request is allocated under its trace */
+    struct sss_trace *trace;
 
     /* Time when the request started. Useful for by-filter lookups */
     time_t req_start;
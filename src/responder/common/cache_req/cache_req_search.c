@@ -46,6 +46,7 @@ static errno_t cache_req_search_ncache(struct cache_req *cr)
         CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr,
                         "[%s] does not exist (negative cache)\n",
                         cr->debugobj);
+        sss_metrics_inc("cache_req.negcache_hit");
         return ENOENT;
     } else if (ret != EOK && ret != ENOENT) {
         CACHE_REQ_DEBUG(SSSDBG_CRIT_FAILURE, cr,
@@ -199,6 +200,7 @@ static errno_t cache_req_search_cache(TALLOC_CTX *mem_ctx,
                                       struct ldb_result **_result)
 {
     struct ldb_result *result = NULL;
+    struct timeval start;
     errno_t ret;
 
     if (cr->plugin->lookup_fn == NULL) {
@@ -211,7 +213,9 @@ static errno_t cache_req_search_cache(TALLOC_CTX *mem_ctx,
                     "Looking up [%s] in cache\n",
                     cr->debugobj);
 
+    start = tevent_timeval_current();
     ret = cr->plugin->lookup_fn(mem_ctx, cr, cr->data, cr->domain, &result);
+    sss_trace_add(cr->trace, SSS_TRACE_CACHE, &start);
     if (ret == EOK && (result == NULL || result->count == 0)) {
         ret = ENOENT;
     }
@@ -281,6 +285,22 @@ cache_req_expiration_status(struct cache_req *cr,
     return CACHE_OBJECT_EXPIRED;
 }
 
+static void cache_req_search_count(enum cache_object_status status)
+{
+    switch (status) {
+    case CACHE_OBJECT_VALID:
+    case CACHE_OBJECT_MIDPOINT:
+        sss_metrics_inc("cache_req.hit");
+        break;
+    case CACHE_OBJECT_EXPIRED:
+        sss_metrics_inc("cache_req.expired");
+        break;
+    case CACHE_OBJECT_MISSING:
+        sss_metrics_inc("cache_req.miss");
+        break;
+    }
+}
+
 struct cache_req_search_state {
     /* input data */
     struct tevent_context *ev;
@@ -290,6 +310,8 @@ struct cache_req_search_state {
     /* output data */
     struct ldb_result *result;
     bool dp_success;
+
+    struct timeval dp_start;
 };
 
 static errno_t cache_req_search_dp(struct tevent_req *req,
@@ -342,6 +364,7 @@ cache_req_search_send(TALLOC_CTX *mem_ctx,
         }
 
         status = cache_req_expiration_status(cr, state->result);
+        cache_req_search_count(status);
         if (status == CACHE_OBJECT_VALID) {
             CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, cr,
                             "Returning [%s] from cache\n", cr->debugobj);
@@ -426,6 +449,9 @@ static errno_t cache_req_search_dp(struct tevent_req *req,
                         "Looking up [%s] in data provider\n",
                         state->cr->debugobj);
 
+        /* Allocated under the request so its trace is passed on
+         * to the data provider. */
+        state->dp_start = tevent_timeval_current();
         subreq = state->cr->plugin->dp_send_fn(state->cr, state->cr,
                                                state->cr->data,
                                                state->cr->domain,
@@ -470,6 +496,7 @@ static void cache_req_search_done(struct tevent_req *subreq)
 
     state->dp_success = state->cr->plugin->dp_recv_fn(subreq, state->cr);
     talloc_zfree(subreq);
+    sss_trace_add(state->cr->trace, SSS_TRACE_BACKEND, &state->dp_start);
 
     /* Get result from cache again. */
     ret = cache_req_search_cache(state, state->cr, &state->result);
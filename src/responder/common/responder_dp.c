@@ -23,6 +23,7 @@
 #include <sys/time.h>
 #include <time.h>
 #include "util/util.h"
+#include "util/sss_trace.h"
 #include "responder/common/responder_packet.h"
 #include "responder/common/responder.h"
 #include "providers/data_provider.h"
@@ -181,6 +182,7 @@ sss_dp_get_account_send(TALLOC_CTX *mem_ctx,
     struct tevent_req *subreq;
     struct tevent_req *req;
     struct be_conn *be_conn;
+    const char *trace_id;
     uint32_t entry_type;
     uint32_t dp_flags;
     char *filter;
@@ -262,9 +264,14 @@ sss_dp_get_account_send(TALLOC_CTX *mem_ctx,
           dom->name, entry_type, be_req2str(entry_type),
           filter, extra == NULL ? "-" : extra);
 
+    /* Requests sent on behalf of a traced request carry its identifier so
+     * that the backend records can be matched with the responder ones. */
+    trace_id = sss_trace_id(sss_trace_find(mem_ctx));
+
     subreq = sbus_call_dp_dp_getAccountInfo_send(state, be_conn->conn,
                  be_conn->bus_name, SSS_BUS_PATH, dp_flags,
-                 entry_type, filter, dom->name, extra);
+                 entry_type, filter, dom->name, extra,
+                 trace_id == NULL ? "" : trace_id);
     if (subreq == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create subrequest!\n");
         ret = ENOMEM;
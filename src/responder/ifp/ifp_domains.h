@@ -180,6 +180,21 @@ ifp_domains_domain_list_servers_recv(TALLOC_CTX *mem_ctx,
                                       struct tevent_req *req,
                                       const char ***_servers);
 
+struct tevent_req *
+ifp_domains_domain_list_server_scores_send(TALLOC_CTX *mem_ctx,
+                                           struct tevent_context *ev,
+                                           struct sbus_request *sbus_req,
+                                           struct ifp_ctx *ifp_ctx,
+                                           const char *service);
+
+errno_t
+ifp_domains_domain_list_server_scores_recv(TALLOC_CTX *mem_ctx,
+                                           struct tevent_req *req,
+                                           const char ***_servers,
+                                           uint32_t **_rtt_usec,
+                                           uint32_t **_error_permille,
+                                           uint32_t **_samples);
+
 struct tevent_req *
 ifp_domains_domain_refresh_access_rules_send(TALLOC_CTX *mem_ctx,
                                              struct tevent_context *ev,
@@ -58,6 +58,24 @@ _sbus_ifp_invoker_write_as
    (DBusMessageIter *iter,
     struct _sbus_ifp_invoker_args_as *args);
 
+struct _sbus_ifp_invoker_args_asauauau {
+    const char ** arg0;
+    uint32_t * arg1;
+    uint32_t * arg2;
+    uint32_t * arg3;
+};
+
+errno_t
+_sbus_ifp_invoker_read_asauauau
+   (TALLOC_CTX *mem_ctx,
+    DBusMessageIter *iter,
+    struct _sbus_ifp_invoker_args_asauauau *args);
+
+errno_t
+_sbus_ifp_invoker_write_asauauau
+   (DBusMessageIter *iter,
+    struct _sbus_ifp_invoker_args_asauauau *args);
+
 struct _sbus_ifp_invoker_args_b {
     bool arg0;
 };
@@ -375,6 +375,67 @@ done:
     return ret;
 }
 
+static errno_t
+sbus_method_in_s_out_asauauau
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_sync_connection *conn,
+     const char *bus,
+     const char *path,
+     const char *iface,
+     const char *method,
+     const char * arg0,
+     const char *** _arg0,
+     uint32_t ** _arg1,
+     uint32_t ** _arg2,
+     uint32_t ** _arg3)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct _sbus_ifp_invoker_args_s in;
+    struct _sbus_ifp_invoker_args_asauauau *out;
+    DBusMessage *reply;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Out of memory!\n");
+        return ENOMEM;
+    }
+
+    out = talloc_zero(tmp_ctx, struct _sbus_ifp_invoker_args_asauauau);
+    if (out == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Unable to allocate space for output parameters!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    in.arg0 = arg0;
+
+    ret = sbus_sync_call_method(tmp_ctx, conn, NULL,
+                                (sbus_invoker_writer_fn)_sbus_ifp_invoker_write_s,
+                                bus, path, iface, method, &in, &reply);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sbus_read_output(out, reply, (sbus_invoker_reader_fn)_sbus_ifp_invoker_read_asauauau, out);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    *_arg0 = talloc_steal(mem_ctx, out->arg0);
+    *_arg1 = talloc_steal(mem_ctx, out->arg1);
+    *_arg2 = talloc_steal(mem_ctx, out->arg2);
+    *_arg3 = talloc_steal(mem_ctx, out->arg3);
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+
+    return ret;
+}
+
 static errno_t
 sbus_method_in_s_out_o
     (TALLOC_CTX *mem_ctx,
@@ -998,6 +1059,26 @@ sbus_call_ifp_domain_IsOnline
           _arg_status);
 }
 
+errno_t
+sbus_call_ifp_domain_ListServerScores
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_sync_connection *conn,
+     const char *busname,
+     const char *object_path,
+     const char * arg_service_name,
+     const char *** _arg_servers,
+     uint32_t ** _arg_rtt_usec,
+     uint32_t ** _arg_error_permille,
+     uint32_t ** _arg_samples)
+{
+     return sbus_method_in_s_out_asauauau(mem_ctx, conn,
+          busname, object_path, "org.freedesktop.sssd.infopipe.Domains.Domain", "ListServerScores", arg_service_name,
+          _arg_servers,
+          _arg_rtt_usec,
+          _arg_error_permille,
+          _arg_samples);
+}
+
 errno_t
 sbus_call_ifp_domain_ListServers
     (TALLOC_CTX *mem_ctx,
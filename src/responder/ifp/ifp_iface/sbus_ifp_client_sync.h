@@ -170,6 +170,18 @@ sbus_call_ifp_domain_IsOnline
      const char *object_path,
      bool* _arg_status);
 
+errno_t
+sbus_call_ifp_domain_ListServerScores
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_sync_connection *conn,
+     const char *busname,
+     const char *object_path,
+     const char * arg_service_name,
+     const char *** _arg_servers,
+     uint32_t ** _arg_rtt_usec,
+     uint32_t ** _arg_error_permille,
+     uint32_t ** _arg_samples);
+
 errno_t
 sbus_call_ifp_domain_ListServers
     (TALLOC_CTX *mem_ctx,
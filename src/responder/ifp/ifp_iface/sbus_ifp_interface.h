@@ -1100,6 +1100,28 @@
         (handler_send), (handler_recv), (data)); \
 })
 
+/* Method: org.freedesktop.sssd.infopipe.Domains.Domain.ListServerScores */
+#define SBUS_METHOD_SYNC_org_freedesktop_sssd_infopipe_Domains_Domain_ListServerScores(handler, data) ({ \
+    SBUS_CHECK_SYNC((handler), (data), const char *, const char ***, uint32_t **, uint32_t **, uint32_t **); \
+    sbus_method_sync("ListServerScores", \
+        &_sbus_ifp_args_org_freedesktop_sssd_infopipe_Domains_Domain_ListServerScores, \
+        NULL, \
+        _sbus_ifp_invoke_in_s_out_asauauau_send, \
+        _sbus_ifp_key_s_0, \
+        (handler), (data)); \
+})
+
+#define SBUS_METHOD_ASYNC_org_freedesktop_sssd_infopipe_Domains_Domain_ListServerScores(handler_send, handler_recv, data) ({ \
+    SBUS_CHECK_SEND((handler_send), (data), const char *); \
+    SBUS_CHECK_RECV((handler_recv), const char ***, uint32_t **, uint32_t **, uint32_t **); \
+    sbus_method_async("ListServerScores", \
+        &_sbus_ifp_args_org_freedesktop_sssd_infopipe_Domains_Domain_ListServerScores, \
+        NULL, \
+        _sbus_ifp_invoke_in_s_out_asauauau_send, \
+        _sbus_ifp_key_s_0, \
+        (handler_send), (handler_recv), (data)); \
+})
+
 /* Method: org.freedesktop.sssd.infopipe.Domains.Domain.ListServers */
 #define SBUS_METHOD_SYNC_org_freedesktop_sssd_infopipe_Domains_Domain_ListServers(handler, data) ({ \
     SBUS_CHECK_SYNC((handler), (data), const char *, const char ***); \
@@ -49,6 +49,7 @@ _sbus_ifp_declare_invoker(, s);
 _sbus_ifp_declare_invoker(, u);
 _sbus_ifp_declare_invoker(s, ao);
 _sbus_ifp_declare_invoker(s, as);
+_sbus_ifp_declare_invoker(s, asauauau);
 _sbus_ifp_declare_invoker(s, o);
 _sbus_ifp_declare_invoker(s, s);
 _sbus_ifp_declare_invoker(sas, raw);
@@ -216,6 +216,21 @@ _sbus_ifp_args_org_freedesktop_sssd_infopipe_Domains_Domain_IsOnline = {
     }
 };
 
+const struct sbus_method_arguments
+_sbus_ifp_args_org_freedesktop_sssd_infopipe_Domains_Domain_ListServerScores = {
+    .input = (const struct sbus_argument[]){
+        {.type = "s", .name = "service_name"},
+        {NULL}
+    },
+    .output = (const struct sbus_argument[]){
+        {.type = "as", .name = "servers"},
+        {.type = "au", .name = "rtt_usec"},
+        {.type = "au", .name = "error_permille"},
+        {.type = "au", .name = "samples"},
+        {NULL}
+    }
+};
+
 const struct sbus_method_arguments
 _sbus_ifp_args_org_freedesktop_sssd_infopipe_Domains_Domain_ListServers = {
     .input = (const struct sbus_argument[]){
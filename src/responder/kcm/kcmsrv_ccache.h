@@ -329,6 +329,11 @@ const char *sec_key_create(TALLOC_CTX *mem_ctx,
                            const char *name,
                            uuid_t uuid);
 
+errno_t sec_key_parse(TALLOC_CTX *mem_ctx,
+                      const char *sec_key,
+                      const char **_name,
+                      uuid_t uuid);
+
 /*
  * sec_key is a concatenation of the ccache's UUID and name
  * sec_value is the JSON dump of the ccache contents
@@ -345,4 +350,31 @@ errno_t kcm_ccache_to_sec_input(TALLOC_CTX *mem_ctx,
                                 struct cli_creds *client,
                                 struct sss_iobuf **_payload);
 
+/*
+ * ccache marshalling to and from a binary format. This is used when the
+ * ccaches are stored in the local secrets database. The credentials are
+ * stored as separate records at the end of the value, so a credential
+ * can be added without converting the whole ccache.
+ *
+ * Values written by older versions are in JSON, use
+ * kcm_ccache_sec_value_is_binary to tell them apart.
+ */
+bool kcm_ccache_sec_value_is_binary(struct sss_iobuf *sec_value);
+
+errno_t kcm_ccache_to_sec_binary(TALLOC_CTX *mem_ctx,
+                                 struct kcm_ccache *cc,
+                                 struct sss_iobuf **_payload);
+
+errno_t sec_binary_to_ccache(TALLOC_CTX *mem_ctx,
+                             const char *sec_key,
+                             struct sss_iobuf *sec_value,
+                             struct cli_creds *client,
+                             struct kcm_ccache **_cc);
+
+/* Returns a new binary value with crd appended to sec_value */
+errno_t kcm_ccache_sec_binary_add_cred(TALLOC_CTX *mem_ctx,
+                                       struct sss_iobuf *sec_value,
+                                       struct kcm_cred *crd,
+                                       struct sss_iobuf **_payload);
+
 #endif /* _KCMSRV_CCACHE_H_ */
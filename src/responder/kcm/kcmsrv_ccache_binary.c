@@ -0,0 +1,579 @@
+/*
+   SSSD
+
+   KCM Server - ccache binary (un)marshalling for storing ccaches in
+                the secrets database
+
+   Copyright (C) Red Hat, 2026
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <talloc.h>
+
+#include "util/util.h"
+#include "util/util_creds.h"
+#include "responder/kcm/kcmsrv_ccache_pvt.h"
+
+/*
+ * The ccache is stored as:
+ *
+ *      magic       4 bytes, "KCMB"
+ *      version     uint32
+ *      kdc_offset  int32
+ *      principal   uint32 number of components or UINT32_MAX if the
+ *                  ccache has no principal, followed by:
+ *                      type    int32
+ *                      realm   data
+ *                      component data for each component
+ *      creds       until the end of the buffer, one record per
+ *                  credential, oldest first:
+ *                      uuid    16 bytes
+ *                      payload data
+ *
+ * where data is an uint32 length followed by that many bytes. All the
+ * integers are in network byte order.
+ *
+ * Since the credentials are the last part of the value and their number
+ * is not recorded, a credential is stored by appending a record to the
+ * existing value without parsing the others.
+ */
+#define KCM_BINARY_MAGIC        "KCMB"
+#define KCM_BINARY_MAGIC_LEN    (sizeof(KCM_BINARY_MAGIC) - 1)
+#define KCM_BINARY_VERSION      1
+#define KCM_BINARY_NO_PRINC     UINT32_MAX
+
+#define KCM_BINARY_HDR_LEN      (KCM_BINARY_MAGIC_LEN \
+                                 + sizeof(uint32_t) + sizeof(int32_t))
+
+static size_t data_len(size_t len)
+{
+    return sizeof(uint32_t) + len;
+}
+
+static size_t princ_len(krb5_principal princ)
+{
+    size_t len;
+    krb5_int32 i;
+
+    len = sizeof(uint32_t);
+    if (princ == NULL) {
+        return len;
+    }
+
+    len += sizeof(int32_t) + data_len(princ->realm.length);
+    for (i = 0; i < princ->length; i++) {
+        len += data_len(princ->data[i].length);
+    }
+
+    return len;
+}
+
+static size_t cred_len(struct kcm_cred *crd)
+{
+    return sizeof(uuid_t) + data_len(sss_iobuf_get_size(crd->cred_blob));
+}
+
+static errno_t write_uint32(struct sss_iobuf *buf, uint32_t val)
+{
+    return sss_iobuf_write_uint32(buf, htobe32(val));
+}
+
+static errno_t write_data(struct sss_iobuf *buf,
+                          const void *data,
+                          size_t len)
+{
+    errno_t ret;
+
+    if (len > UINT32_MAX) {
+        return EINVAL;
+    }
+
+    ret = write_uint32(buf, len);
+    if (ret != EOK || len == 0) {
+        return ret;
+    }
+
+    return sss_iobuf_write_len(buf, discard_const(data), len);
+}
+
+static errno_t write_princ(struct sss_iobuf *buf,
+                           krb5_principal princ)
+{
+    errno_t ret;
+    krb5_int32 i;
+
+    if (princ == NULL) {
+        return write_uint32(buf, KCM_BINARY_NO_PRINC);
+    }
+
+    ret = write_uint32(buf, princ->length);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = write_uint32(buf, (uint32_t) princ->type);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = write_data(buf, princ->realm.data, princ->realm.length);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    for (i = 0; i < princ->length; i++) {
+        ret = write_data(buf, princ->data[i].data, princ->data[i].length);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    return EOK;
+}
+
+static errno_t write_cred(struct sss_iobuf *buf,
+                          struct kcm_cred *crd)
+{
+    errno_t ret;
+
+    ret = sss_iobuf_write_len(buf, crd->uuid, sizeof(uuid_t));
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return write_data(buf,
+                      sss_iobuf_get_data(crd->cred_blob),
+                      sss_iobuf_get_size(crd->cred_blob));
+}
+
+/* The value is parsed in place, the parsed data is not copied until
+ * it is stored in the ccache */
+struct binary_reader {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+};
+
+static errno_t read_bytes(struct binary_reader *rd,
+                          size_t len,
+                          const uint8_t **_data)
+{
+    if (len > rd->size - rd->pos) {
+        return ENOBUFS;
+    }
+
+    *_data = rd->data + rd->pos;
+    rd->pos += len;
+    return EOK;
+}
+
+static errno_t read_uint32(struct binary_reader *rd, uint32_t *_val)
+{
+    const uint8_t *data;
+    uint32_t val;
+    errno_t ret;
+
+    ret = read_bytes(rd, sizeof(uint32_t), &data);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    memcpy(&val, data, sizeof(uint32_t));
+    *_val = be32toh(val);
+    return EOK;
+}
+
+static errno_t read_data(struct binary_reader *rd,
+                         const uint8_t **_data,
+                         uint32_t *_len)
+{
+    uint32_t len;
+    errno_t ret;
+
+    ret = read_uint32(rd, &len);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = read_bytes(rd, len, _data);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_len = len;
+    return EOK;
+}
+
+static errno_t read_krb5_data(TALLOC_CTX *mem_ctx,
+                              struct binary_reader *rd,
+                              krb5_data *kdata)
+{
+    const uint8_t *data;
+    uint32_t len;
+    errno_t ret;
+
+    ret = read_data(rd, &data, &len);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    /* The data may contain NUL bytes, keep a terminator after it anyway
+     * like krb5 does */
+    kdata->magic = 0;
+    kdata->length = len;
+    kdata->data = talloc_size(mem_ctx, len + 1);
+    if (kdata->data == NULL) {
+        return ENOMEM;
+    }
+    memcpy(kdata->data, data, len);
+    kdata->data[len] = '\0';
+
+    return EOK;
+}
+
+static errno_t read_princ(TALLOC_CTX *mem_ctx,
+                          struct binary_reader *rd,
+                          krb5_principal *_princ)
+{
+    krb5_principal princ;
+    uint32_t ncomps;
+    uint32_t type;
+    uint32_t i;
+    errno_t ret;
+
+    ret = read_uint32(rd, &ncomps);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (ncomps == KCM_BINARY_NO_PRINC) {
+        *_princ = NULL;
+        return EOK;
+    }
+
+    /* Each component takes at least its length */
+    if (ncomps > INT32_MAX || ncomps > rd->size / sizeof(uint32_t)) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Too many principal components.\n");
+        return EINVAL;
+    }
+
+    princ = talloc_zero(mem_ctx, struct krb5_principal_data);
+    if (princ == NULL) {
+        return ENOMEM;
+    }
+    princ->magic = KV5M_PRINCIPAL;
+
+    ret = read_uint32(rd, &type);
+    if (ret != EOK) {
+        goto fail;
+    }
+    princ->type = (krb5_int32) type;
+
+    ret = read_krb5_data(princ, rd, &princ->realm);
+    if (ret != EOK) {
+        goto fail;
+    }
+
+    if (ncomps > 0) {
+        princ->data = talloc_zero_array(princ, krb5_data, ncomps);
+        if (princ->data == NULL) {
+            ret = ENOMEM;
+            goto fail;
+        }
+    }
+
+    for (i = 0; i < ncomps; i++) {
+        ret = read_krb5_data(princ->data, rd, &princ->data[i]);
+        if (ret != EOK) {
+            goto fail;
+        }
+    }
+    princ->length = (krb5_int32) ncomps;
+
+    *_princ = princ;
+    return EOK;
+
+fail:
+    talloc_free(princ);
+    return ret;
+}
+
+static errno_t read_cred(TALLOC_CTX *mem_ctx,
+                         struct binary_reader *rd,
+                         struct kcm_cred **_crd)
+{
+    struct sss_iobuf *cred_blob;
+    struct kcm_cred *crd;
+    const uint8_t *data;
+    uint32_t len;
+    uuid_t uuid;
+    errno_t ret;
+
+    ret = read_bytes(rd, sizeof(uuid_t), &data);
+    if (ret != EOK) {
+        return ret;
+    }
+    memcpy(uuid, data, sizeof(uuid_t));
+
+    ret = read_data(rd, &data, &len);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    cred_blob = sss_iobuf_init_readonly(mem_ctx, data, len);
+    if (cred_blob == NULL) {
+        return ENOMEM;
+    }
+
+    crd = kcm_cred_new(mem_ctx, uuid, cred_blob);
+    if (crd == NULL) {
+        talloc_free(cred_blob);
+        return ENOMEM;
+    }
+
+    *_crd = crd;
+    return EOK;
+}
+
+static errno_t read_header(struct binary_reader *rd,
+                           int32_t *_kdc_offset)
+{
+    const uint8_t *magic;
+    uint32_t version;
+    uint32_t offset;
+    errno_t ret;
+
+    ret = read_bytes(rd, KCM_BINARY_MAGIC_LEN, &magic);
+    if (ret != EOK
+            || memcmp(magic, KCM_BINARY_MAGIC, KCM_BINARY_MAGIC_LEN) != 0) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Not a binary ccache\n");
+        return EINVAL;
+    }
+
+    ret = read_uint32(rd, &version);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (version != KCM_BINARY_VERSION) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Expected version %d, received version %"PRIu32"\n",
+              KCM_BINARY_VERSION, version);
+        return EINVAL;
+    }
+
+    ret = read_uint32(rd, &offset);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_kdc_offset = (int32_t) offset;
+    return EOK;
+}
+
+bool kcm_ccache_sec_value_is_binary(struct sss_iobuf *sec_value)
+{
+    if (sss_iobuf_get_size(sec_value) < KCM_BINARY_HDR_LEN) {
+        return false;
+    }
+
+    return memcmp(sss_iobuf_get_data(sec_value),
+                  KCM_BINARY_MAGIC, KCM_BINARY_MAGIC_LEN) == 0;
+}
+
+errno_t kcm_ccache_to_sec_binary(TALLOC_CTX *mem_ctx,
+                                 struct kcm_ccache *cc,
+                                 struct sss_iobuf **_payload)
+{
+    struct sss_iobuf *payload;
+    struct kcm_cred *last = NULL;
+    struct kcm_cred *crd;
+    size_t len;
+    errno_t ret;
+
+    len = KCM_BINARY_HDR_LEN + princ_len(cc->client);
+    for (crd = cc->creds; crd != NULL; crd = crd->next) {
+        len += cred_len(crd);
+        last = crd;
+    }
+
+    /* Sized exactly so that the size of the iobuf is the size of the
+     * value */
+    payload = sss_iobuf_init_empty(mem_ctx, len, len);
+    if (payload == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sss_iobuf_write_len(payload,
+                              discard_const(KCM_BINARY_MAGIC),
+                              KCM_BINARY_MAGIC_LEN);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = write_uint32(payload, KCM_BINARY_VERSION);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = write_uint32(payload, (uint32_t) cc->kdc_offset);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = write_princ(payload, cc->client);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    /* The newest credential is the list head, store the oldest first
+     * so that new ones can be appended */
+    for (crd = last; crd != NULL; crd = crd->prev) {
+        ret = write_cred(payload, crd);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    ret = EOK;
+    *_payload = payload;
+done:
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Cannot convert ccache %s to binary [%d]: %s\n",
+              cc->name, ret, sss_strerror(ret));
+        talloc_free(payload);
+    }
+    return ret;
+}
+
+errno_t sec_binary_to_ccache(TALLOC_CTX *mem_ctx,
+                             const char *sec_key,
+                             struct sss_iobuf *sec_value,
+                             struct cli_creds *client,
+                             struct kcm_ccache **_cc)
+{
+    struct kcm_ccache *cc = NULL;
+    struct binary_reader rd;
+    struct kcm_cred *crd;
+    TALLOC_CTX *tmp_ctx;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(mem_ctx);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    rd.data = sss_iobuf_get_data(sec_value);
+    rd.size = sss_iobuf_get_size(sec_value);
+    rd.pos = 0;
+
+    cc = talloc_zero(tmp_ctx, struct kcm_ccache);
+    if (cc == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* We rely on the secrets database only searching the user's subtree
+     * so we set the ownership to the client
+     */
+    cc->owner.uid = cli_creds_get_uid(client);
+    cc->owner.gid = cli_creds_get_gid(client);
+
+    ret = sec_key_parse(cc, sec_key, &cc->name, cc->uuid);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Cannot parse secret key [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = read_header(&rd, &cc->kdc_offset);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = read_princ(cc, &rd, &cc->client);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Cannot read the principal [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    while (rd.pos < rd.size) {
+        ret = read_cred(cc, &rd, &crd);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Cannot read a credential [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            goto done;
+        }
+
+        ret = kcm_cc_store_creds(cc, crd);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    ret = EOK;
+    *_cc = talloc_steal(mem_ctx, cc);
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+errno_t kcm_ccache_sec_binary_add_cred(TALLOC_CTX *mem_ctx,
+                                       struct sss_iobuf *sec_value,
+                                       struct kcm_cred *crd,
+                                       struct sss_iobuf **_payload)
+{
+    struct sss_iobuf *payload;
+    size_t len;
+    errno_t ret;
+
+    if (!kcm_ccache_sec_value_is_binary(sec_value)) {
+        return EINVAL;
+    }
+
+    len = sss_iobuf_get_size(sec_value) + cred_len(crd);
+    payload = sss_iobuf_init_empty(mem_ctx, len, len);
+    if (payload == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sss_iobuf_write_len(payload,
+                              sss_iobuf_get_data(sec_value),
+                              sss_iobuf_get_size(sec_value));
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = write_cred(payload, crd);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = EOK;
+    *_payload = payload;
+done:
+    if (ret != EOK) {
+        talloc_free(payload);
+    }
+    return ret;
+}
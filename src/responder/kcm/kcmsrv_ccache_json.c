@@ -84,10 +84,10 @@ static bool sec_key_valid(const char *sec_key)
     return true;
 }
 
-static errno_t sec_key_parse(TALLOC_CTX *mem_ctx,
-                             const char *sec_key,
-                             const char **_name,
-                             uuid_t uuid)
+errno_t sec_key_parse(TALLOC_CTX *mem_ctx,
+                      const char *sec_key,
+                      const char **_name,
+                      uuid_t uuid)
 {
     char uuid_str[UUID_STR_SIZE];
 
@@ -206,7 +206,7 @@ static errno_t kcm_ccache_to_secdb_kv(TALLOC_CTX *mem_ctx,
         goto done;
     }
 
-    ret = kcm_ccache_to_sec_input(mem_ctx, cc, client, &payload);
+    ret = kcm_ccache_to_sec_binary(mem_ctx, cc, &payload);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "Cannot convert ccache to a secret [%d][%s]\n", ret, sss_strerror(ret));
@@ -222,8 +222,81 @@ done:
     return ret;
 }
 
+/* Modified ccaches are written to the database after this delay, so that
+ * the changes done by a sequence of operations are written at once */
+#define KCM_SECDB_FLUSH_DELAY_USEC  200000
+
+/* A ccache whose delayed write failed this many times in a row is read
+ * from the database again */
+#define KCM_SECDB_FLUSH_MAX_ATTEMPTS 3
+
+/* A change is written right away instead if the ccache is this close to
+ * the payload quota, in eighths of the quota, so that the client learns
+ * that the change did not fit */
+#define KCM_SECDB_QUOTA_MARGIN      1
+
+/*
+ * All the ccaches of a user are loaded into memory on the first operation
+ * by that user. Lookups, listing and reading the default ccache are then
+ * served from memory. Creating and deleting ccaches is written to the
+ * database right away, the other changes are kept pending in memory and
+ * written after a short delay, unless the ccache is close to the payload
+ * quota. A change that cannot be written stays pending and is retried.
+ *
+ * The delay is not a journal: changes that were already confirmed to the
+ * client are lost if the KCM responder is killed before they are written.
+ * They are written when the responder shuts down normally.
+ */
+struct secdb_cc_entry {
+    struct secdb_cc_entry *prev;
+    struct secdb_cc_entry *next;
+
+    const char *key;
+    const char *name;
+    uuid_t uuid;
+
+    /* Parsed on first use */
+    struct kcm_ccache *cc;
+    /* The binary value stored in the database, NULL if not known */
+    struct sss_iobuf *value;
+
+    /* Changes not written to the database yet. If credentials were only
+     * added, they are appended to the stored value, otherwise the whole
+     * ccache is written again. */
+    bool dirty;
+    bool rewrite;
+    size_t num_appended;
+    /* Estimated size of the appended credentials */
+    size_t appended_size;
+    unsigned int failed_flushes;
+};
+
+struct secdb_uid_index {
+    /* List of indexes with changes not written yet */
+    struct secdb_uid_index *prev;
+    struct secdb_uid_index *next;
+    bool in_pending;
+
+    struct cli_creds client;
+    struct secdb_cc_entry *entries;
+
+    /* Cleared if there is no default ccache */
+    uuid_t dfl;
+    bool dfl_dirty;
+    unsigned int dfl_failed_flushes;
+};
+
 struct ccdb_secdb {
     struct sss_sec_ctx *sctx;
+    struct tevent_context *ev;
+
+    /* uid -> struct secdb_uid_index */
+    hash_table_t *indexes;
+    struct secdb_uid_index *pending;
+    struct tevent_timer *flush_te;
+
+    /* In bytes, 0 if unlimited */
+    size_t max_payload_size;
 };
 
 /* Since with the synchronous database, the database operations are just
@@ -365,161 +438,696 @@ done:
     return ret;
 }
 
-static errno_t key_by_uuid(TALLOC_CTX *mem_ctx,
-                           struct sss_sec_ctx *sctx,
-                           struct cli_creds *client,
-                           uuid_t uuid,
-                           char **_key)
+static errno_t secdb_get_cc_value(TALLOC_CTX *mem_ctx,
+                                  struct sss_sec_ctx *sctx,
+                                  const char *secdb_key,
+                                  struct cli_creds *client,
+                                  struct sss_iobuf **_ccbuf)
 {
-    TALLOC_CTX *tmp_ctx;
     errno_t ret;
-    char *key_match = NULL;
-    char **keys = NULL;
-    size_t nkeys;
+    TALLOC_CTX *tmp_ctx = NULL;
     struct sss_sec_req *sreq = NULL;
+    struct sss_iobuf *ccbuf;
 
     tmp_ctx = talloc_new(mem_ctx);
     if (tmp_ctx == NULL) {
         return ENOMEM;
     }
 
-    ret = secdb_container_url_req(tmp_ctx, sctx, client, &sreq);
+    ret = secdb_cc_key_req(tmp_ctx, sctx, client, secdb_key, &sreq);
     if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot create secdb request [%d][%s]\n", ret, sss_strerror(ret));
         goto done;
     }
 
-    ret = sss_sec_list(tmp_ctx, sreq, &keys, &nkeys);
-    if (ret == ENOENT) {
-        DEBUG(SSSDBG_MINOR_FAILURE, "The container was not found\n");
-        goto done;
-    } else if (ret != EOK) {
+    ret = sec_get_b64(tmp_ctx, sreq, &ccbuf);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get the secret [%d][%s]\n", ret, sss_strerror(ret));
         goto done;
     }
 
-    for (size_t i = 0; i < nkeys; i++) {
-        if (sec_key_match_uuid(keys[i], uuid)) {
-            key_match = keys[i];
-            break;
+    ret = EOK;
+    *_ccbuf = talloc_steal(mem_ctx, ccbuf);
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+/* ccaches written by older versions are stored in JSON, they are
+ * converted to the binary format the next time they are written */
+static errno_t secdb_cc_value_to_ccache(TALLOC_CTX *mem_ctx,
+                                        const char *secdb_key,
+                                        struct sss_iobuf *ccbuf,
+                                        struct cli_creds *client,
+                                        struct kcm_ccache **_cc)
+{
+    errno_t ret;
+
+    if (kcm_ccache_sec_value_is_binary(ccbuf)) {
+        ret = sec_binary_to_ccache(mem_ctx, secdb_key, ccbuf, client, _cc);
+    } else {
+        ret = sec_kv_to_ccache(mem_ctx,
+                               secdb_key,
+                               (const char *) sss_iobuf_get_data(ccbuf),
+                               client,
+                               _cc);
+    }
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot convert the secret to a ccache [%d]: %s\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    return EOK;
+}
+
+static struct secdb_cc_entry *secdb_entry_by_uuid(struct secdb_uid_index *uidx,
+                                                  uuid_t uuid)
+{
+    struct secdb_cc_entry *entry;
+
+    DLIST_FOR_EACH(entry, uidx->entries) {
+        if (uuid_compare(entry->uuid, uuid) == 0) {
+            return entry;
         }
     }
 
-    if (key_match == NULL) {
-        DEBUG(SSSDBG_TRACE_INTERNAL, "No key matched\n");
-        ret = ENOENT;
+    return NULL;
+}
+
+static struct secdb_cc_entry *secdb_entry_by_name(struct secdb_uid_index *uidx,
+                                                  const char *name)
+{
+    struct secdb_cc_entry *entry;
+
+    DLIST_FOR_EACH(entry, uidx->entries) {
+        if (strcmp(entry->name, name) == 0) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static errno_t secdb_entry_add(struct secdb_uid_index *uidx,
+                               const char *key,
+                               struct secdb_cc_entry **_entry)
+{
+    struct secdb_cc_entry *entry;
+    const char *name;
+    errno_t ret;
+
+    entry = talloc_zero(uidx, struct secdb_cc_entry);
+    if (entry == NULL) {
+        return ENOMEM;
+    }
+
+    entry->key = talloc_strdup(entry, key);
+    if (entry->key == NULL) {
+        ret = ENOMEM;
+        goto fail;
+    }
+
+    ret = sec_key_get_uuid(entry->key, entry->uuid);
+    if (ret != EOK) {
+        goto fail;
+    }
+
+    name = sec_key_get_name(entry->key);
+    if (name == NULL) {
+        ret = EINVAL;
+        goto fail;
+    }
+    entry->name = name;
+
+    DLIST_ADD_END(uidx->entries, entry, struct secdb_cc_entry *);
+    if (_entry != NULL) {
+        *_entry = entry;
+    }
+    return EOK;
+
+fail:
+    DEBUG(SSSDBG_CRIT_FAILURE, "Malformed key %s, skipping\n", key);
+    talloc_free(entry);
+    return ret;
+}
+
+static errno_t secdb_dfl_load(struct ccdb_secdb *secdb,
+                              struct secdb_uid_index *uidx)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sss_sec_req *sreq;
+    struct sss_iobuf *dfl_iobuf;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = secdb_dfl_url_req(tmp_ctx, secdb->sctx, &uidx->client, &sreq);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sec_get_b64(tmp_ctx, sreq, &dfl_iobuf);
+    if (ret == ENOENT) {
+        uuid_clear(uidx->dfl);
+    } else if (ret != EOK) {
+        goto done;
+    } else if (sss_iobuf_get_size(dfl_iobuf) != UUID_STR_SIZE) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unexpected UUID size %zu\n",
+              sss_iobuf_get_size(dfl_iobuf));
+        ret = EIO;
         goto done;
+    } else {
+        uuid_parse((const char *) sss_iobuf_get_data(dfl_iobuf), uidx->dfl);
     }
 
+    uidx->dfl_dirty = false;
+    uidx->dfl_failed_flushes = 0;
     ret = EOK;
-    DEBUG(SSSDBG_TRACE_INTERNAL, "Found key %s\n", key_match);
-    *_key = talloc_steal(mem_ctx, key_match);
 done:
     talloc_free(tmp_ctx);
     return ret;
 }
 
-static errno_t key_by_name(TALLOC_CTX *mem_ctx,
-                           struct sss_sec_ctx *sctx,
-                           struct cli_creds *client,
-                           const char *name,
-                           char **_key)
+static errno_t secdb_uid_index_load(struct ccdb_secdb *secdb,
+                                    struct secdb_uid_index *uidx)
 {
     TALLOC_CTX *tmp_ctx;
-    errno_t ret;
-    char *key_match = NULL;
+    struct sss_sec_req *sreq;
     char **keys = NULL;
-    size_t nkeys;
-    struct sss_sec_req *sreq = NULL;
+    size_t nkeys = 0;
+    errno_t ret;
 
-    tmp_ctx = talloc_new(mem_ctx);
+    tmp_ctx = talloc_new(NULL);
     if (tmp_ctx == NULL) {
         return ENOMEM;
     }
 
-    ret = secdb_container_url_req(tmp_ctx, sctx, client, &sreq);
+    ret = secdb_container_url_req(tmp_ctx, secdb->sctx, &uidx->client, &sreq);
     if (ret != EOK) {
         goto done;
     }
 
     ret = sss_sec_list(tmp_ctx, sreq, &keys, &nkeys);
     if (ret == ENOENT) {
-        DEBUG(SSSDBG_MINOR_FAILURE, "The container was not found\n");
-        goto done;
+        nkeys = 0;
     } else if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot list keys [%d]: %s\n", ret, sss_strerror(ret));
         goto done;
     }
 
     for (size_t i = 0; i < nkeys; i++) {
-        if (sec_key_match_name(keys[i], name)) {
-            key_match = keys[i];
-            break;
+        ret = secdb_entry_add(uidx, keys[i], NULL);
+        if (ret == ENOMEM) {
+            goto done;
         }
     }
 
-    if (key_match == NULL) {
-        DEBUG(SSSDBG_TRACE_INTERNAL, "No key matched\n");
-        ret = ENOENT;
+    ret = secdb_dfl_load(secdb, uidx);
+    if (ret != EOK) {
         goto done;
     }
 
+    DEBUG(SSSDBG_TRACE_INTERNAL, "Loaded %zu ccaches of user %"SPRIuid"\n",
+          nkeys, cli_creds_get_uid(&uidx->client));
     ret = EOK;
-    DEBUG(SSSDBG_TRACE_INTERNAL, "Found key %s\n", key_match);
-    *_key = talloc_steal(mem_ctx, key_match);
 done:
     talloc_free(tmp_ctx);
     return ret;
 }
 
-static errno_t secdb_get_cc(TALLOC_CTX *mem_ctx,
-                            struct sss_sec_ctx *sctx,
-                            const char *secdb_key,
-                            struct cli_creds *client,
-                            struct kcm_ccache **_cc)
+static errno_t secdb_uid_index_get(struct ccdb_secdb *secdb,
+                                   struct cli_creds *client,
+                                   struct secdb_uid_index **_uidx)
 {
+    struct secdb_uid_index *uidx;
+    hash_key_t key;
+    hash_value_t value;
     errno_t ret;
-    TALLOC_CTX *tmp_ctx = NULL;
-    struct kcm_ccache *cc = NULL;
-    struct sss_sec_req *sreq = NULL;
-    struct sss_iobuf *ccbuf;
+    int hret;
 
-    tmp_ctx = talloc_new(mem_ctx);
+    key.type = HASH_KEY_ULONG;
+    key.ul = cli_creds_get_uid(client);
+
+    hret = hash_lookup(secdb->indexes, &key, &value);
+    if (hret == HASH_SUCCESS) {
+        *_uidx = talloc_get_type(value.ptr, struct secdb_uid_index);
+        return EOK;
+    } else if (hret != HASH_ERROR_KEY_NOT_FOUND) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "hash_lookup failed [%d]: %s\n",
+              hret, hash_error_string(hret));
+        return EIO;
+    }
+
+    uidx = talloc_zero(secdb, struct secdb_uid_index);
+    if (uidx == NULL) {
+        return ENOMEM;
+    }
+
+    /* Only the identity is needed to build the database URLs */
+    uidx->client = *client;
+    uidx->client.selinux_ctx = NULL;
+
+    ret = secdb_uid_index_load(secdb, uidx);
+    if (ret != EOK) {
+        talloc_free(uidx);
+        return ret;
+    }
+
+    value.type = HASH_VALUE_PTR;
+    value.ptr = uidx;
+
+    hret = hash_enter(secdb->indexes, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "hash_enter failed [%d]: %s\n",
+              hret, hash_error_string(hret));
+        talloc_free(uidx);
+        return EIO;
+    }
+
+    *_uidx = uidx;
+    return EOK;
+}
+
+/* Forget everything about the user, it is loaded from the database again
+ * on the next operation */
+static void secdb_uid_index_drop(struct ccdb_secdb *secdb,
+                                 struct secdb_uid_index *uidx)
+{
+    hash_key_t key;
+
+    key.type = HASH_KEY_ULONG;
+    key.ul = cli_creds_get_uid(&uidx->client);
+    hash_delete(secdb->indexes, &key);
+
+    if (uidx->in_pending) {
+        DLIST_REMOVE(secdb->pending, uidx);
+    }
+    talloc_free(uidx);
+}
+
+static errno_t secdb_entry_get_cc(struct ccdb_secdb *secdb,
+                                  struct secdb_uid_index *uidx,
+                                  struct secdb_cc_entry *entry,
+                                  struct kcm_ccache **_cc)
+{
+    struct sss_iobuf *value;
+    errno_t ret;
+
+    if (entry->cc != NULL) {
+        *_cc = entry->cc;
+        return EOK;
+    }
+
+    value = entry->value;
+    if (value == NULL) {
+        ret = secdb_get_cc_value(entry, secdb->sctx, entry->key,
+                                 &uidx->client, &value);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    ret = secdb_cc_value_to_ccache(entry, entry->key, value,
+                                   &uidx->client, &entry->cc);
+    if (ret != EOK) {
+        if (value != entry->value) {
+            talloc_free(value);
+        }
+        return ret;
+    }
+
+    /* Values in the old format are written again on the next change */
+    if (kcm_ccache_sec_value_is_binary(value)) {
+        entry->value = value;
+    } else {
+        talloc_free(value);
+    }
+
+    *_cc = entry->cc;
+    return EOK;
+}
+
+/* Forgets the changes of the ccache that were not written, it is read from
+ * the database again on the next use. Copies handed out to clients keep
+ * the old ccache alive. */
+static void secdb_entry_reset(struct secdb_cc_entry *entry)
+{
+    if (entry->cc != NULL) {
+        talloc_unlink(entry, entry->cc);
+        entry->cc = NULL;
+    }
+    talloc_zfree(entry->value);
+
+    entry->dirty = false;
+    entry->rewrite = false;
+    entry->num_appended = 0;
+    entry->appended_size = 0;
+    entry->failed_flushes = 0;
+}
+
+/* In order to provide a consistent interface, we need to let the caller
+ * of getbyXXX own the ccache, therefore we return a shallow copy of the
+ * ccache like the memory back end does. The owner is the client, like
+ * when the ccache was read from the database. The copy keeps the ccache
+ * alive in case the index of the user is dropped in the meantime. */
+static struct kcm_ccache *secdb_cc_dup(TALLOC_CTX *mem_ctx,
+                                       struct kcm_ccache *in,
+                                       struct cli_creds *client)
+{
+    struct kcm_ccache *out;
+
+    out = talloc_zero(mem_ctx, struct kcm_ccache);
+    if (out == NULL) {
+        return NULL;
+    }
+    memcpy(out, in, sizeof(struct kcm_ccache));
+
+    if (talloc_reference(out, in) == NULL) {
+        talloc_free(out);
+        return NULL;
+    }
+
+    out->owner.uid = cli_creds_get_uid(client);
+    out->owner.gid = cli_creds_get_gid(client);
+
+    return out;
+}
+
+static errno_t secdb_entry_flush(struct ccdb_secdb *secdb,
+                                 struct secdb_uid_index *uidx,
+                                 struct secdb_cc_entry *entry)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sss_sec_req *sreq;
+    struct sss_iobuf *payload;
+    struct sss_iobuf *appended;
+    struct kcm_cred *crd;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
     if (tmp_ctx == NULL) {
         return ENOMEM;
     }
 
-    ret = secdb_cc_key_req(tmp_ctx, sctx, client, secdb_key, &sreq);
+    if (!entry->rewrite && entry->value != NULL) {
+        /* The newest credentials are at the head of the list, append them
+         * oldest first */
+        crd = entry->cc->creds;
+        for (i = 1; i < entry->num_appended && crd != NULL; i++) {
+            crd = crd->next;
+        }
+
+        payload = entry->value;
+        for (i = 0; i < entry->num_appended && crd != NULL; i++) {
+            ret = kcm_ccache_sec_binary_add_cred(tmp_ctx, payload, crd,
+                                                 &appended);
+            if (ret != EOK) {
+                goto done;
+            }
+            payload = appended;
+            crd = crd->prev;
+        }
+    } else {
+        ret = kcm_ccache_to_sec_binary(tmp_ctx, entry->cc, &payload);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    ret = secdb_cc_key_req(tmp_ctx, secdb->sctx, &uidx->client, entry->key,
+                           &sreq);
     if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE,
-              "Cannot create secdb request [%d][%s]\n", ret, sss_strerror(ret));
         goto done;
     }
 
-    ret = sec_get_b64(tmp_ctx, sreq, &ccbuf);
+    ret = sec_update_b64(tmp_ctx, sreq, payload);
     if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE,
-              "Cannot get the secret [%d][%s]\n", ret, sss_strerror(ret));
         goto done;
     }
 
-    ret = sec_kv_to_ccache(tmp_ctx,
-                           secdb_key,
-                           (const char *) sss_iobuf_get_data(ccbuf),
-                           client,
-                           &cc);
+    if (payload != entry->value) {
+        talloc_free(entry->value);
+        entry->value = talloc_steal(entry, payload);
+    }
+    entry->dirty = false;
+    entry->rewrite = false;
+    entry->num_appended = 0;
+    entry->appended_size = 0;
+    entry->failed_flushes = 0;
+    ret = EOK;
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t secdb_dfl_flush(struct ccdb_secdb *secdb,
+                               struct secdb_uid_index *uidx)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sss_sec_req *sreq;
+    struct sss_iobuf *iobuf;
+    char uuid_str[UUID_STR_SIZE];
+    char *cur_default;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = secdb_dfl_url_req(tmp_ctx, secdb->sctx, &uidx->client, &sreq);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    uuid_unparse(uidx->dfl, uuid_str);
+    iobuf = sss_iobuf_init_readonly(tmp_ctx,
+                                    (const uint8_t *) uuid_str,
+                                    UUID_STR_SIZE);
+    if (iobuf == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sss_sec_get(tmp_ctx, sreq, &cur_default);
+    if (ret == ENOENT) {
+        ret = sec_put_b64(tmp_ctx, sreq, iobuf);
+    } else if (ret == EOK) {
+        ret = sec_update_b64(tmp_ctx, sreq, iobuf);
+    }
     if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE,
-              "Cannot convert JSON keyval to ccache blob [%d]: %s\n",
-              ret, sss_strerror(ret));
         goto done;
     }
 
+    uidx->dfl_dirty = false;
+    uidx->dfl_failed_flushes = 0;
     ret = EOK;
-    DEBUG(SSSDBG_TRACE_INTERNAL, "Fetched the ccache\n");
-    *_cc = talloc_steal(mem_ctx, cc);
 done:
     talloc_free(tmp_ctx);
     return ret;
 }
 
+/* Writes the pending changes of a user. The changes of each ccache and of
+ * the default ccache are written independently, one that fails stays
+ * pending so that it is tried again. Returns true if anything is still
+ * pending. */
+static bool secdb_uid_index_flush(struct ccdb_secdb *secdb,
+                                  struct secdb_uid_index *uidx)
+{
+    struct secdb_cc_entry *entry;
+    bool pending = false;
+    errno_t ret;
+
+    DLIST_FOR_EACH(entry, uidx->entries) {
+        if (!entry->dirty) {
+            continue;
+        }
+
+        ret = secdb_entry_flush(secdb, uidx, entry);
+        if (ret == EOK) {
+            continue;
+        }
+
+        entry->failed_flushes++;
+        if (entry->failed_flushes < KCM_SECDB_FLUSH_MAX_ATTEMPTS) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "Cannot write ccache %s [%d]: %s, will retry\n",
+                  entry->name, ret, sss_strerror(ret));
+            pending = true;
+            continue;
+        }
+
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Cannot write ccache %s [%d]: %s, dropping its changes\n",
+              entry->name, ret, sss_strerror(ret));
+        secdb_entry_reset(entry);
+    }
+
+    if (uidx->dfl_dirty) {
+        ret = secdb_dfl_flush(secdb, uidx);
+        if (ret != EOK) {
+            uidx->dfl_failed_flushes++;
+            if (uidx->dfl_failed_flushes < KCM_SECDB_FLUSH_MAX_ATTEMPTS) {
+                DEBUG(SSSDBG_OP_FAILURE,
+                      "Cannot write the default ccache [%d]: %s, "
+                      "will retry\n", ret, sss_strerror(ret));
+                pending = true;
+            } else {
+                DEBUG(SSSDBG_CRIT_FAILURE,
+                      "Cannot write the default ccache [%d]: %s, "
+                      "reading it again\n", ret, sss_strerror(ret));
+                ret = secdb_dfl_load(secdb, uidx);
+                if (ret != EOK) {
+                    uuid_clear(uidx->dfl);
+                    uidx->dfl_dirty = false;
+                    uidx->dfl_failed_flushes = 0;
+                }
+            }
+        }
+    }
+
+    return pending;
+}
+
+static void secdb_flush_handler(struct tevent_context *ev,
+                                struct tevent_timer *te,
+                                struct timeval current_time,
+                                void *pvt);
+
+static void secdb_schedule_flush(struct ccdb_secdb *secdb)
+{
+    if (secdb->flush_te != NULL) {
+        return;
+    }
+
+    secdb->flush_te = tevent_add_timer(secdb->ev, secdb,
+                            tevent_timeval_current_ofs(0,
+                                                KCM_SECDB_FLUSH_DELAY_USEC),
+                            secdb_flush_handler, secdb);
+    if (secdb->flush_te == NULL) {
+        /* Written with the next change or at shutdown */
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot schedule the write\n");
+    }
+}
+
+static void secdb_flush(struct ccdb_secdb *secdb)
+{
+    struct secdb_uid_index *retry = NULL;
+    struct secdb_uid_index *uidx;
+
+    talloc_zfree(secdb->flush_te);
+
+    while ((uidx = secdb->pending) != NULL) {
+        DLIST_REMOVE(secdb->pending, uidx);
+
+        if (secdb_uid_index_flush(secdb, uidx)) {
+            DLIST_ADD_END(retry, uidx, struct secdb_uid_index *);
+        } else {
+            uidx->in_pending = false;
+        }
+    }
+
+    secdb->pending = retry;
+    if (secdb->pending != NULL) {
+        secdb_schedule_flush(secdb);
+    }
+}
+
+static void secdb_flush_handler(struct tevent_context *ev,
+                                struct tevent_timer *te,
+                                struct timeval current_time,
+                                void *pvt)
+{
+    struct ccdb_secdb *secdb = talloc_get_type(pvt, struct ccdb_secdb);
+
+    /* The timer is freed by tevent after the handler returns */
+    secdb->flush_te = NULL;
+    secdb_flush(secdb);
+}
+
+static void secdb_pending_add(struct ccdb_secdb *secdb,
+                              struct secdb_uid_index *uidx)
+{
+    if (!uidx->in_pending) {
+        DLIST_ADD_END(secdb->pending, uidx, struct secdb_uid_index *);
+        uidx->in_pending = true;
+    }
+
+    secdb_schedule_flush(secdb);
+}
+
+/* Whether writing the entry might exceed the payload quota. The estimate
+ * is based on the stored value, a ccache whose value is not known is
+ * always considered close to the quota. */
+static bool secdb_entry_near_quota(struct ccdb_secdb *secdb,
+                                   struct secdb_cc_entry *entry)
+{
+    size_t size;
+
+    if (secdb->max_payload_size == 0) {
+        return false;
+    }
+
+    if (entry->value == NULL) {
+        return true;
+    }
+
+    size = sss_iobuf_get_size(entry->value) + entry->appended_size;
+    /* The value is stored base64 encoded */
+    size = (size + 2) / 3 * 4;
+
+    return size + secdb->max_payload_size / 8 * KCM_SECDB_QUOTA_MARGIN
+                >= secdb->max_payload_size;
+}
+
+/* Records a change of the entry to be written later. If the change might
+ * not fit into the quota, it is written right away and the error is
+ * returned, otherwise the client would be told that a change succeeded
+ * which is then lost. A ccache that cannot be written is read from the
+ * database again, together with its earlier changes, which cannot be
+ * written separately. */
+static errno_t secdb_entry_changed(struct ccdb_secdb *secdb,
+                                   struct secdb_uid_index *uidx,
+                                   struct secdb_cc_entry *entry)
+{
+    errno_t ret;
+
+    entry->dirty = true;
+
+    if (secdb_entry_near_quota(secdb, entry)) {
+        DEBUG(SSSDBG_TRACE_INTERNAL,
+              "ccache %s is close to the quota, writing it now\n",
+              entry->name);
+        ret = secdb_entry_flush(secdb, uidx, entry);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "Cannot write ccache %s [%d]: %s\n",
+                  entry->name, ret, sss_strerror(ret));
+            secdb_entry_reset(entry);
+        }
+        return ret;
+    }
+
+    secdb_pending_add(secdb, uidx);
+    return EOK;
+}
+
+static int ccdb_secdb_destructor(struct ccdb_secdb *secdb)
+{
+    /* Write what is pending before shutting down */
+    secdb_flush(secdb);
+    return 0;
+}
+
 static errno_t ccdb_secdb_init(struct kcm_ccdb *db,
                                struct confdb_ctx *cdb,
                                const char *confdb_service_path)
@@ -591,7 +1199,10 @@ static errno_t ccdb_secdb_init(struct kcm_ccdb *db,
         kcm_section_quota[0]->quota.max_uid_secrets += 2;
     }
 
-    ret = sss_sec_init(db, kcm_section_quota, &secdb->sctx);
+    secdb->max_payload_size =
+                (size_t) kcm_section_quota[0]->quota.max_payload_size * 1024;
+
+    ret = sss_sec_init(secdb, kcm_section_quota, &secdb->sctx);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "Cannot initialize the security database\n");
@@ -599,6 +1210,16 @@ static errno_t ccdb_secdb_init(struct kcm_ccdb *db,
         return ret;
     }
 
+    ret = sss_hash_create(secdb, 0, &secdb->indexes);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Cannot create the ccache index\n");
+        talloc_free(secdb);
+        return ret;
+    }
+
+    secdb->ev = db->ev;
+    talloc_set_destructor(secdb, ccdb_secdb_destructor);
+
     DEBUG(SSSDBG_TRACE_INTERNAL, "secdb initialized\n");
     db->db_handle = secdb;
     return EOK;
@@ -608,17 +1229,6 @@ struct ccdb_secdb_nextid_state {
     unsigned int nextid;
 };
 
-static bool is_in_use(char **keys, size_t nkeys, const char *nextid_name)
-{
-    for (size_t i = 0; i < nkeys; i++) {
-        if (sec_key_match_name(keys[i], nextid_name) == true) {
-            return true;
-        }
-    }
-
-    return false;
-}
-
 static struct tevent_req *ccdb_secdb_nextid_send(TALLOC_CTX *mem_ctx,
                                                struct tevent_context *ev,
                                                struct kcm_ccdb *db,
@@ -627,12 +1237,10 @@ static struct tevent_req *ccdb_secdb_nextid_send(TALLOC_CTX *mem_ctx,
     struct tevent_req *req = NULL;
     struct ccdb_secdb_nextid_state *state = NULL;
     struct ccdb_secdb *secdb = NULL;
+    struct secdb_uid_index *uidx;
     const int maxtries = 3;
     int numtry;
     errno_t ret;
-    struct sss_sec_req *sreq = NULL;
-    char **keys = NULL;
-    size_t nkeys;
     char *nextid_name = NULL;
 
     DEBUG(SSSDBG_TRACE_LIBS, "Generating a new ID\n");
@@ -648,24 +1256,14 @@ static struct tevent_req *ccdb_secdb_nextid_send(TALLOC_CTX *mem_ctx,
         goto immediate;
     }
 
-    ret = secdb_container_url_req(state, secdb->sctx, client, &sreq);
+    ret = secdb_uid_index_get(secdb, client, &uidx);
     if (ret != EOK) {
         goto immediate;
     }
 
-    ret = sss_sec_list(state, sreq, &keys, &nkeys);
-    if (ret == ENOENT) {
-        keys = NULL;
-        nkeys = 0;
-    } else if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE,
-              "Cannot list keys [%d]: %s\n",
-              ret, sss_strerror(ret));
-        goto immediate;
-    }
-
     for (numtry = 0; numtry  < maxtries; numtry++) {
         state->nextid = sss_rand() % MAX_CC_NUM;
+        talloc_free(nextid_name);
         nextid_name = talloc_asprintf(state, "%"SPRIuid":%u",
                                       cli_creds_get_uid(client),
                                       state->nextid);
@@ -674,7 +1272,7 @@ static struct tevent_req *ccdb_secdb_nextid_send(TALLOC_CTX *mem_ctx,
             goto immediate;
         }
 
-        if (!is_in_use(keys, nkeys, nextid_name)) {
+        if (secdb_entry_by_name(uidx, nextid_name) == NULL) {
             break;
         }
     }
@@ -718,43 +1316,25 @@ static struct tevent_req *ccdb_secdb_set_default_send(TALLOC_CTX *mem_ctx,
     struct tevent_req *req = NULL;
     struct ccdb_secdb_state *state = NULL;
     struct ccdb_secdb *secdb = talloc_get_type(db->db_handle, struct ccdb_secdb);
+    struct secdb_uid_index *uidx;
     errno_t ret;
-    char uuid_str[UUID_STR_SIZE];
-    struct sss_sec_req *sreq = NULL;
-    struct sss_iobuf *iobuf;
-    char *cur_default;
 
-    uuid_unparse(uuid, uuid_str);
-    DEBUG(SSSDBG_TRACE_INTERNAL,
-          "Setting the default ccache to %s\n", uuid_str);
+    DEBUG(SSSDBG_TRACE_INTERNAL, "Setting the default ccache\n");
 
     req = tevent_req_create(mem_ctx, &state, struct ccdb_secdb_state);
     if (req == NULL) {
         return NULL;
     }
 
-    ret = secdb_dfl_url_req(state, secdb->sctx, client, &sreq);
+    ret = secdb_uid_index_get(secdb, client, &uidx);
     if (ret != EOK) {
         goto immediate;
     }
 
-    iobuf = sss_iobuf_init_readonly(state,
-                                    (const uint8_t *) uuid_str,
-                                    UUID_STR_SIZE);
-    if (iobuf == NULL) {
-        ret = ENOMEM;
-        goto immediate;
-    }
-
-    ret = sss_sec_get(state, sreq, &cur_default);
-    if (ret == ENOENT) {
-        ret = sec_put_b64(state, sreq, iobuf);
-    } else if (ret == EOK) {
-        ret = sec_update_b64(state, sreq, iobuf);
-    }
-
-    if (ret != EOK) {
-        goto immediate;
+    if (uidx->dfl_dirty || uuid_compare(uidx->dfl, uuid) != 0) {
+        uuid_copy(uidx->dfl, uuid);
+        uidx->dfl_dirty = true;
+        secdb_pending_add(secdb, uidx);
     }
 
     ret = EOK;
@@ -787,10 +1367,8 @@ static struct tevent_req *ccdb_secdb_get_default_send(TALLOC_CTX *mem_ctx,
     struct ccdb_secdb *secdb = talloc_get_type(db->db_handle, struct ccdb_secdb);
     struct tevent_req *req = NULL;
     struct ccdb_secdb_get_default_state *state = NULL;
+    struct secdb_uid_index *uidx;
     errno_t ret;
-    struct sss_sec_req *sreq = NULL;
-    struct sss_iobuf *dfl_iobuf = NULL;
-    size_t uuid_size;
 
     DEBUG(SSSDBG_TRACE_INTERNAL, "Getting the default ccache\n");
 
@@ -799,28 +1377,12 @@ static struct tevent_req *ccdb_secdb_get_default_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    ret = secdb_dfl_url_req(state, secdb->sctx, client, &sreq);
+    ret = secdb_uid_index_get(secdb, client, &uidx);
     if (ret != EOK) {
         goto immediate;
     }
 
-    ret = sec_get_b64(state, sreq, &dfl_iobuf);
-    if (ret == ENOENT) {
-        uuid_clear(state->uuid);
-        ret = EOK;
-        goto immediate;
-    } else if (ret != EOK) {
-        goto immediate;
-    }
-
-    uuid_size = sss_iobuf_get_size(dfl_iobuf);
-    if (uuid_size != UUID_STR_SIZE) {
-        DEBUG(SSSDBG_OP_FAILURE, "Unexpected UUID size %zu\n", uuid_size);
-        ret = EIO;
-        goto immediate;
-    }
-
-    uuid_parse((const char *) sss_iobuf_get_data(dfl_iobuf), state->uuid);
+    uuid_copy(state->uuid, uidx->dfl);
     DEBUG(SSSDBG_TRACE_INTERNAL, "Got the default ccache\n");
     ret = EOK;
 immediate:
@@ -857,10 +1419,11 @@ static struct tevent_req *ccdb_secdb_list_send(TALLOC_CTX *mem_ctx,
     struct ccdb_secdb *secdb = talloc_get_type(db->db_handle, struct ccdb_secdb);
     struct tevent_req *req = NULL;
     struct ccdb_secdb_list_state *state = NULL;
+    struct secdb_uid_index *uidx;
+    struct secdb_cc_entry *entry;
+    size_t nkeys = 0;
+    size_t i = 0;
     errno_t ret;
-    char **keys = NULL;
-    size_t nkeys;
-    struct sss_sec_req *sreq = NULL;
 
     DEBUG(SSSDBG_TRACE_INTERNAL, "Listing all ccaches\n");
 
@@ -869,17 +1432,13 @@ static struct tevent_req *ccdb_secdb_list_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    ret = secdb_container_url_req(state, secdb->sctx, client, &sreq);
+    ret = secdb_uid_index_get(secdb, client, &uidx);
     if (ret != EOK) {
         goto immediate;
     }
 
-    ret = sss_sec_list(state, sreq, &keys, &nkeys);
-    if (ret == ENOENT) {
-        nkeys = 0;
-        /* Fall through and return an empty list */
-    } else if (ret != EOK) {
-        goto immediate;
+    DLIST_FOR_EACH(entry, uidx->entries) {
+        nkeys++;
     }
     DEBUG(SSSDBG_TRACE_INTERNAL, "Found %zu ccaches\n", nkeys);
 
@@ -889,12 +1448,9 @@ static struct tevent_req *ccdb_secdb_list_send(TALLOC_CTX *mem_ctx,
         goto immediate;
     }
 
-    for (size_t i = 0; i < nkeys; i++) {
-        ret = sec_key_get_uuid(keys[i],
-                               state->uuid_list[i]);
-        if (ret != EOK) {
-            goto immediate;
-        }
+    DLIST_FOR_EACH(entry, uidx->entries) {
+        uuid_copy(state->uuid_list[i], entry->uuid);
+        i++;
     }
     /* Sentinel */
     uuid_clear(state->uuid_list[nkeys]);
@@ -936,8 +1492,10 @@ static struct tevent_req *ccdb_secdb_getbyuuid_send(TALLOC_CTX *mem_ctx,
     struct ccdb_secdb *secdb = talloc_get_type(db->db_handle, struct ccdb_secdb);
     struct tevent_req *req = NULL;
     struct ccdb_secdb_getbyuuid_state *state = NULL;
+    struct secdb_uid_index *uidx;
+    struct secdb_cc_entry *entry;
+    struct kcm_ccache *cc;
     errno_t ret;
-    char *secdb_key = NULL;
 
     DEBUG(SSSDBG_TRACE_INTERNAL, "Getting ccache by UUID\n");
 
@@ -946,20 +1504,29 @@ static struct tevent_req *ccdb_secdb_getbyuuid_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    ret = key_by_uuid(state, secdb->sctx, client, uuid, &secdb_key);
-    if (ret == ENOENT) {
+    ret = secdb_uid_index_get(secdb, client, &uidx);
+    if (ret != EOK) {
+        goto immediate;
+    }
+
+    entry = secdb_entry_by_uuid(uidx, uuid);
+    if (entry == NULL) {
         state->cc = NULL;
         ret = EOK;
         goto immediate;
-    } else if (ret != EOK) {
-        goto immediate;
     }
 
-    ret = secdb_get_cc(state, secdb->sctx, secdb_key, client, &state->cc);
+    ret = secdb_entry_get_cc(secdb, uidx, entry, &cc);
     if (ret != EOK) {
         goto immediate;
     }
 
+    state->cc = secdb_cc_dup(state, cc, client);
+    if (state->cc == NULL) {
+        ret = ENOMEM;
+        goto immediate;
+    }
+
     DEBUG(SSSDBG_TRACE_INTERNAL, "Got ccache by UUID\n");
     ret = EOK;
 immediate:
@@ -997,8 +1564,10 @@ static struct tevent_req *ccdb_secdb_getbyname_send(TALLOC_CTX *mem_ctx,
     struct ccdb_secdb *secdb = talloc_get_type(db->db_handle, struct ccdb_secdb);
     struct tevent_req *req = NULL;
     struct ccdb_secdb_getbyname_state *state = NULL;
+    struct secdb_uid_index *uidx;
+    struct secdb_cc_entry *entry;
+    struct kcm_ccache *cc;
     errno_t ret;
-    char *secdb_key = NULL;
 
     DEBUG(SSSDBG_TRACE_INTERNAL, "Getting ccache by name\n");
 
@@ -1007,20 +1576,29 @@ static struct tevent_req *ccdb_secdb_getbyname_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    ret = key_by_name(state, secdb->sctx, client, name, &secdb_key);
-    if (ret == ENOENT) {
+    ret = secdb_uid_index_get(secdb, client, &uidx);
+    if (ret != EOK) {
+        goto immediate;
+    }
+
+    entry = secdb_entry_by_name(uidx, name);
+    if (entry == NULL) {
         state->cc = NULL;
         ret = EOK;
         goto immediate;
-    } else if (ret != EOK) {
-        goto immediate;
     }
 
-    ret = secdb_get_cc(state, secdb->sctx, secdb_key, client, &state->cc);
+    ret = secdb_entry_get_cc(secdb, uidx, entry, &cc);
     if (ret != EOK) {
         goto immediate;
     }
 
+    state->cc = secdb_cc_dup(state, cc, client);
+    if (state->cc == NULL) {
+        ret = ENOMEM;
+        goto immediate;
+    }
+
     DEBUG(SSSDBG_TRACE_INTERNAL, "Got ccache by name\n");
     ret = EOK;
 immediate:
@@ -1059,9 +1637,9 @@ struct tevent_req *ccdb_secdb_name_by_uuid_send(TALLOC_CTX *mem_ctx,
     struct ccdb_secdb *secdb = talloc_get_type(db->db_handle, struct ccdb_secdb);
     struct tevent_req *req = NULL;
     struct ccdb_secdb_name_by_uuid_state *state = NULL;
+    struct secdb_uid_index *uidx;
+    struct secdb_cc_entry *entry;
     errno_t ret;
-    char *key;
-    const char *name;
 
     DEBUG(SSSDBG_TRACE_INTERNAL, "Translating UUID to name\n");
 
@@ -1070,22 +1648,18 @@ struct tevent_req *ccdb_secdb_name_by_uuid_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    ret = key_by_uuid(state, secdb->sctx, client, uuid, &key);
-    if (ret == ENOENT) {
-        ret = ERR_NO_CREDS;
-        goto immediate;
-    } else if (ret != EOK) {
+    ret = secdb_uid_index_get(secdb, client, &uidx);
+    if (ret != EOK) {
         goto immediate;
     }
 
-    name = sec_key_get_name(key);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "Malformed key, cannot get name\n");
+    entry = secdb_entry_by_uuid(uidx, uuid);
+    if (entry == NULL) {
+        ret = ERR_NO_CREDS;
         goto immediate;
     }
 
-    state->name = talloc_strdup(state, name);
+    state->name = talloc_strdup(state, entry->name);
     if (state->name == NULL) {
         ret = ENOMEM;
         goto immediate;
@@ -1127,8 +1701,9 @@ struct tevent_req *ccdb_secdb_uuid_by_name_send(TALLOC_CTX *mem_ctx,
     struct ccdb_secdb *secdb = talloc_get_type(db->db_handle, struct ccdb_secdb);
     struct tevent_req *req = NULL;
     struct ccdb_secdb_uuid_by_name_state *state = NULL;
+    struct secdb_uid_index *uidx;
+    struct secdb_cc_entry *entry;
     errno_t ret;
-    char *key;
 
     DEBUG(SSSDBG_TRACE_INTERNAL, "Translating name to UUID\n");
 
@@ -1137,21 +1712,18 @@ struct tevent_req *ccdb_secdb_uuid_by_name_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    ret = key_by_name(state, secdb->sctx, client, name, &key);
-    if (ret == ENOENT) {
-        ret = ERR_NO_CREDS;
-        goto immediate;
-    } else if (ret != EOK) {
+    ret = secdb_uid_index_get(secdb, client, &uidx);
+    if (ret != EOK) {
         goto immediate;
     }
 
-    ret = sec_key_get_uuid(key, state->uuid);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-                "Malformed key, cannot get UUID\n");
+    entry = secdb_entry_by_name(uidx, name);
+    if (entry == NULL) {
+        ret = ERR_NO_CREDS;
         goto immediate;
     }
 
+    uuid_copy(state->uuid, entry->uuid);
     DEBUG(SSSDBG_TRACE_INTERNAL, "Got ccache by UUID\n");
     ret = EOK;
 immediate:
@@ -1188,7 +1760,10 @@ static struct tevent_req *ccdb_secdb_create_send(TALLOC_CTX *mem_ctx,
     errno_t ret;
     struct sss_sec_req *container_req = NULL;
     struct sss_sec_req *ccache_req = NULL;
+    struct secdb_uid_index *uidx;
+    struct secdb_cc_entry *entry;
     const char *url;
+    const char *key;
     struct sss_iobuf *ccache_payload;
 
     DEBUG(SSSDBG_TRACE_INTERNAL, "Creating ccache storage for %s\n", cc->name);
@@ -1198,6 +1773,11 @@ static struct tevent_req *ccdb_secdb_create_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
+    ret = secdb_uid_index_get(secdb, client, &uidx);
+    if (ret != EOK) {
+        goto immediate;
+    }
+
     /* Do the encoding asap so that if we fail, we don't even attempt any
      * writes */
     ret = kcm_ccache_to_secdb_kv(state, cc, client, &url, &ccache_payload);
@@ -1208,6 +1788,12 @@ static struct tevent_req *ccdb_secdb_create_send(TALLOC_CTX *mem_ctx,
         goto immediate;
     }
 
+    key = sec_key_create(state, cc->name, cc->uuid);
+    if (key == NULL) {
+        ret = ENOMEM;
+        goto immediate;
+    }
+
     DEBUG(SSSDBG_TRACE_INTERNAL, "Creating the ccache container\n");
     ret = secdb_container_url_req(state, secdb->sctx, client, &container_req);
     if (ret != EOK) {
@@ -1236,6 +1822,15 @@ static struct tevent_req *ccdb_secdb_create_send(TALLOC_CTX *mem_ctx,
         goto immediate;
     }
 
+    /* The ccache is parsed from the payload when it is first read */
+    ret = secdb_entry_add(uidx, key, &entry);
+    if (ret != EOK) {
+        /* Already in the database, read it from there next time */
+        secdb_uid_index_drop(secdb, uidx);
+        goto immediate;
+    }
+    entry->value = talloc_steal(entry, ccache_payload);
+
     DEBUG(SSSDBG_TRACE_INTERNAL, "payload created\n");
     ret = EOK;
 immediate:
@@ -1264,11 +1859,10 @@ static struct tevent_req *ccdb_secdb_mod_send(TALLOC_CTX *mem_ctx,
     struct ccdb_secdb *secdb = talloc_get_type(db->db_handle, struct ccdb_secdb);
     struct tevent_req *req = NULL;
     struct ccdb_secdb_state *state = NULL;
-    errno_t ret;
-    char *secdb_key = NULL;
+    struct secdb_uid_index *uidx;
+    struct secdb_cc_entry *entry;
     struct kcm_ccache *cc = NULL;
-    struct sss_iobuf *payload = NULL;
-    struct sss_sec_req *sreq = NULL;
+    errno_t ret;
 
     DEBUG(SSSDBG_TRACE_INTERNAL, "Modifying ccache\n");
 
@@ -1277,15 +1871,18 @@ static struct tevent_req *ccdb_secdb_mod_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    ret = key_by_uuid(state, secdb->sctx, client, uuid, &secdb_key);
-    if (ret == ENOENT) {
-        ret = ERR_NO_CREDS;
+    ret = secdb_uid_index_get(secdb, client, &uidx);
+    if (ret != EOK) {
         goto immediate;
-    } else if (ret != EOK) {
+    }
+
+    entry = secdb_entry_by_uuid(uidx, uuid);
+    if (entry == NULL) {
+        ret = ERR_NO_CREDS;
         goto immediate;
     }
 
-    ret = secdb_get_cc(state, secdb->sctx, secdb_key, client, &cc);
+    ret = secdb_entry_get_cc(secdb, uidx, entry, &cc);
     if (ret != EOK) {
         goto immediate;
     }
@@ -1298,22 +1895,8 @@ static struct tevent_req *ccdb_secdb_mod_send(TALLOC_CTX *mem_ctx,
         goto immediate;
     }
 
-    ret = kcm_ccache_to_sec_input(state, cc, client, &payload);
-    if (ret != EOK) {
-        goto immediate;
-    }
-
-    ret = secdb_cc_key_req(state, secdb->sctx, client, secdb_key, &sreq);
-    if (ret != EOK) {
-        goto immediate;
-    }
-
-    ret = sec_update_b64(state, sreq, payload);
-    if (ret != EOK) {
-        goto immediate;
-    }
-
-    ret = EOK;
+    entry->rewrite = true;
+    ret = secdb_entry_changed(secdb, uidx, entry);
 immediate:
     if (ret == EOK) {
         tevent_req_done(req);
@@ -1340,10 +1923,9 @@ static struct tevent_req *ccdb_secdb_store_cred_send(TALLOC_CTX *mem_ctx,
     struct ccdb_secdb *secdb = talloc_get_type(db->db_handle, struct ccdb_secdb);
     struct tevent_req *req = NULL;
     struct ccdb_secdb_state *state = NULL;
-    char *secdb_key = NULL;
+    struct secdb_uid_index *uidx;
+    struct secdb_cc_entry *entry;
     struct kcm_ccache *cc = NULL;
-    struct sss_iobuf *payload = NULL;
-    struct sss_sec_req *sreq = NULL;
     errno_t ret;
 
     DEBUG(SSSDBG_TRACE_INTERNAL, "Storing creds in ccache\n");
@@ -1353,15 +1935,18 @@ static struct tevent_req *ccdb_secdb_store_cred_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    ret = key_by_uuid(state, secdb->sctx, client, uuid, &secdb_key);
-    if (ret == ENOENT) {
-        ret = ERR_NO_CREDS;
+    ret = secdb_uid_index_get(secdb, client, &uidx);
+    if (ret != EOK) {
         goto immediate;
-    } else if (ret != EOK) {
+    }
+
+    entry = secdb_entry_by_uuid(uidx, uuid);
+    if (entry == NULL) {
+        ret = ERR_NO_CREDS;
         goto immediate;
     }
 
-    ret = secdb_get_cc(state, secdb->sctx, secdb_key, client, &cc);
+    ret = secdb_entry_get_cc(secdb, uidx, entry, &cc);
     if (ret != EOK) {
         goto immediate;
     }
@@ -1374,22 +1959,10 @@ static struct tevent_req *ccdb_secdb_store_cred_send(TALLOC_CTX *mem_ctx,
         goto immediate;
     }
 
-    ret = kcm_ccache_to_sec_input(state, cc, client, &payload);
-    if (ret != EOK) {
-        goto immediate;
-    }
-
-    ret = secdb_cc_key_req(state, secdb->sctx, client, secdb_key, &sreq);
-    if (ret != EOK) {
-        goto immediate;
-    }
-
-    ret = sec_update_b64(state, sreq, payload);
-    if (ret != EOK) {
-        goto immediate;
-    }
-
-    ret = EOK;
+    /* Appended to the stored value when written */
+    entry->num_appended++;
+    entry->appended_size += sss_iobuf_get_size(cred_blob);
+    ret = secdb_entry_changed(secdb, uidx, entry);
 immediate:
     if (ret == EOK) {
         tevent_req_done(req);
@@ -1417,9 +1990,8 @@ static struct tevent_req *ccdb_secdb_delete_send(TALLOC_CTX *mem_ctx,
     struct ccdb_secdb *secdb = talloc_get_type(db->db_handle, struct ccdb_secdb);
     struct sss_sec_req *container_req = NULL;
     struct sss_sec_req *sreq = NULL;
-    char *secdb_key = NULL;
-    char **keys = NULL;
-    size_t nkeys;
+    struct secdb_uid_index *uidx;
+    struct secdb_cc_entry *entry;
     errno_t ret;
 
     DEBUG(SSSDBG_TRACE_INTERNAL, "Deleting ccache\n");
@@ -1429,32 +2001,29 @@ static struct tevent_req *ccdb_secdb_delete_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    ret = secdb_container_url_req(state, secdb->sctx, client, &container_req);
+    ret = secdb_uid_index_get(secdb, client, &uidx);
     if (ret != EOK) {
         goto immediate;
     }
 
-    ret = sss_sec_list(state, container_req, &keys, &nkeys);
-    if (ret != EOK) {
+    if (uidx->entries == NULL) {
         DEBUG(SSSDBG_MINOR_FAILURE, "No ccaches to delete\n");
+        ret = ENOENT;
         goto immediate;
     }
-    DEBUG(SSSDBG_TRACE_INTERNAL, "Found %zu ccaches\n", nkeys);
 
-    if (nkeys == 0) {
-        ret = EOK;
+    entry = secdb_entry_by_uuid(uidx, uuid);
+    if (entry == NULL) {
+        ret = ERR_NO_CREDS;
         goto immediate;
     }
 
-    ret = key_by_uuid(state, secdb->sctx, client, uuid, &secdb_key);
-    if (ret == ENOENT) {
-        ret = ERR_NO_CREDS;
-        goto immediate;
-    } else if (ret != EOK) {
+    ret = secdb_container_url_req(state, secdb->sctx, client, &container_req);
+    if (ret != EOK) {
         goto immediate;
     }
 
-    ret = secdb_cc_key_req(state, secdb->sctx, client, secdb_key, &sreq);
+    ret = secdb_cc_key_req(state, secdb->sctx, client, entry->key, &sreq);
     if (ret != EOK) {
         goto immediate;
     }
@@ -1464,7 +2033,11 @@ static struct tevent_req *ccdb_secdb_delete_send(TALLOC_CTX *mem_ctx,
         goto immediate;
     }
 
-    if (nkeys > 1) {
+    /* Pending changes of the ccache are dropped with it */
+    DLIST_REMOVE(uidx->entries, entry);
+    talloc_free(entry);
+
+    if (uidx->entries != NULL) {
         DEBUG(SSSDBG_TRACE_INTERNAL, "There are other ccaches, done\n");
         ret = EOK;
         goto immediate;
@@ -30,6 +30,11 @@ struct kcm_ops_queue_entry {
 
     struct kcm_ops_queue *queue;
 
+    /* The ccache the request works with, NULL for all ccaches of the user */
+    const char *ccname;
+    bool exclusive;
+    bool running;
+
     struct kcm_ops_queue_entry *next;
     struct kcm_ops_queue_entry *prev;
 };
@@ -54,6 +59,15 @@ struct kcm_ops_queue_ctx {
  * hash table entry is kcm_ops_queue structure which in turn contains a
  * linked list of kcm_ops_queue_entry structures * which primarily hold the
  * tevent request being queued.
+ *
+ * The queue is a reader/writer lock for each ccache of the user. Requests
+ * that only read a ccache run in parallel, a request that modifies it
+ * runs alone. A request that works with all the ccaches of the user, such
+ * as listing them, conflicts with requests on any of them.
+ *
+ * A request runs only if it does not conflict with any request queued
+ * before it, running or not. A waiting writer therefore holds back readers
+ * that came after it, so neither readers nor writers can be starved.
  */
 struct kcm_ops_queue_ctx *kcm_ops_queue_create(TALLOC_CTX *mem_ctx)
 {
@@ -113,22 +127,62 @@ void queue_removal_cb(struct tevent_context *ctx,
     talloc_free(kq);
 }
 
+static bool kcm_op_queue_entries_conflict(struct kcm_ops_queue_entry *a,
+                                          struct kcm_ops_queue_entry *b)
+{
+    if (!a->exclusive && !b->exclusive) {
+        return false;
+    }
+
+    if (a->ccname == NULL || b->ccname == NULL) {
+        return true;
+    }
+
+    return strcmp(a->ccname, b->ccname) == 0;
+}
+
+static bool kcm_op_queue_entry_can_run(struct kcm_ops_queue_entry *entry)
+{
+    struct kcm_ops_queue_entry *prev;
+
+    for (prev = entry->queue->head; prev != entry; prev = prev->next) {
+        if (kcm_op_queue_entries_conflict(prev, entry)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void kcm_op_queue_run_ready(struct kcm_ops_queue *kq)
+{
+    struct kcm_ops_queue_entry *entry;
+
+    DLIST_FOR_EACH(entry, kq->head) {
+        if (entry->running || !kcm_op_queue_entry_can_run(entry)) {
+            continue;
+        }
+
+        /* Run the callback in another tevent tick, it must not touch
+         * the queue while we are walking it */
+        entry->running = true;
+        tevent_req_defer_callback(entry->req, kq->ev);
+        tevent_req_done(entry->req);
+    }
+}
+
 static int kcm_op_queue_entry_destructor(struct kcm_ops_queue_entry *entry)
 {
-    struct kcm_ops_queue_entry *next_entry;
     struct tevent_immediate *imm;
 
     if (entry == NULL) {
         return 1;
     }
 
-    /* Take the next entry from the queue */
-    next_entry = entry->next;
-
     /* Remove the current entry from the queue */
     DLIST_REMOVE(entry->queue->head, entry);
 
-    if (next_entry == NULL) {
+    if (entry->queue->head == NULL) {
         /* If there was no other entry, schedule removal of the queue. Do it
          * in another tevent tick to avoid issues with callbacks invoking
          * the destructor while another request is touching the queue
@@ -142,8 +196,8 @@ static int kcm_op_queue_entry_destructor(struct kcm_ops_queue_entry *entry)
         return 0;
     }
 
-    /* Otherwise, mark the current head as done to run the next request */
-    tevent_req_done(next_entry->req);
+    /* Otherwise, run the requests this one was holding back */
+    kcm_op_queue_run_ready(entry->queue);
     return 0;
 }
 
@@ -214,22 +268,27 @@ struct kcm_op_queue_state {
 };
 
 static errno_t kcm_op_queue_add_req(struct kcm_ops_queue *kq,
-                                    struct tevent_req *req);
+                                    struct tevent_req *req,
+                                    const char *ccname,
+                                    bool exclusive);
 
 /*
  * Enqueue a request.
  *
- * If the request queue /for the given ID/ is empty, that is, if this
- * request is the first one in the queue, run the request immediately.
+ * If no request queued before this one /for the given ID/ conflicts with
+ * it, run the request immediately.
  *
- * Otherwise just add it to the queue and wait until the previous request
- * finishes and only at that point mark the current request as done, which
- * will trigger calling the recv function and allow the request to continue.
+ * Otherwise just add it to the queue and wait until the conflicting
+ * requests finish and only at that point mark the current request as done,
+ * which will trigger calling the recv function and allow the request to
+ * continue.
  */
 struct tevent_req *kcm_op_queue_send(TALLOC_CTX *mem_ctx,
                                      struct tevent_context *ev,
                                      struct kcm_ops_queue_ctx *qctx,
-                                     struct cli_creds *client)
+                                     struct cli_creds *client,
+                                     const char *ccname,
+                                     bool exclusive)
 {
     errno_t ret;
     struct tevent_req *req;
@@ -245,7 +304,9 @@ struct tevent_req *kcm_op_queue_send(TALLOC_CTX *mem_ctx,
     }
 
     DEBUG(SSSDBG_FUNC_DATA,
-          "Adding request by %"SPRIuid" to the wait queue\n", uid);
+          "Adding %s request by %"SPRIuid" on %s to the wait queue\n",
+          exclusive ? "write" : "read", uid,
+          ccname != NULL ? ccname : "all ccaches");
 
     kq = kcm_op_queue_get(qctx, ev, uid);
     if (kq == NULL) {
@@ -255,10 +316,10 @@ struct tevent_req *kcm_op_queue_send(TALLOC_CTX *mem_ctx,
         goto immediate;
     }
 
-    ret = kcm_op_queue_add_req(kq, req);
+    ret = kcm_op_queue_add_req(kq, req, ccname, exclusive);
     if (ret == EOK) {
         DEBUG(SSSDBG_TRACE_LIBS,
-              "Queue was empty, running the request immediately\n");
+              "No conflicting request, running the request immediately\n");
         goto immediate;
     } else if (ret != EAGAIN) {
         DEBUG(SSSDBG_OP_FAILURE,
@@ -280,29 +341,44 @@ immediate:
 }
 
 static errno_t kcm_op_queue_add_req(struct kcm_ops_queue *kq,
-                                    struct tevent_req *req)
+                                    struct tevent_req *req,
+                                    const char *ccname,
+                                    bool exclusive)
 {
     errno_t ret;
     struct kcm_op_queue_state *state = tevent_req_data(req,
                                                 struct kcm_op_queue_state);
 
-    state->entry = talloc_zero(kq->qctx->wait_queue_hash, struct kcm_ops_queue_entry);
+    /* Allocated on the request so that a request freed while waiting
+     * leaves the queue */
+    state->entry = talloc_zero(state, struct kcm_ops_queue_entry);
     if (state->entry == NULL) {
         return ENOMEM;
     }
     state->entry->req = req;
     state->entry->queue = kq;
+    state->entry->exclusive = exclusive;
+
+    if (ccname != NULL) {
+        state->entry->ccname = talloc_strdup(state->entry, ccname);
+        if (state->entry->ccname == NULL) {
+            talloc_zfree(state->entry);
+            return ENOMEM;
+        }
+    }
+
+    DLIST_ADD_END(kq->head, state->entry, struct kcm_ops_queue_entry *);
     talloc_set_destructor(state->entry, kcm_op_queue_entry_destructor);
 
-    if (kq->head == NULL) {
-        /* First entry, will run callback at once */
+    if (kcm_op_queue_entry_can_run(state->entry)) {
+        /* Will run callback at once */
+        state->entry->running = true;
         ret = EOK;
     } else {
-        /* Will wait for the previous callbacks to finish */
+        /* Will wait for the conflicting requests to finish */
         ret = EAGAIN;
     }
 
-    DLIST_ADD_END(kq->head, state->entry, struct kcm_ops_queue_entry *);
     return ret;
 }
 
@@ -62,10 +62,22 @@ typedef errno_t
 (*kcm_srv_recv_method)(struct tevent_req *req,
                        uint32_t *_op_ret);
 
+/* Which ccaches an operation works with, this decides which operations
+ * of the same user can run in parallel. Operations on a single ccache
+ * take its name as the first argument. Unless listed otherwise, an
+ * operation is assumed to modify all the ccaches of the user. */
+enum kcm_op_access {
+    KCM_OP_ACCESS_ALL_WRITE = 0,
+    KCM_OP_ACCESS_ALL_READ,
+    KCM_OP_ACCESS_CC_WRITE,
+    KCM_OP_ACCESS_CC_READ,
+};
+
 struct kcm_op {
     const char *name;
     kcm_srv_send_method fn_send;
     kcm_srv_recv_method fn_recv;
+    enum kcm_op_access access;
 };
 
 struct kcm_cmd_state {
@@ -73,12 +85,37 @@ struct kcm_cmd_state {
     struct tevent_context *ev;
 
     struct kcm_ops_queue_entry *queue_entry;
+    struct timeval queued;
     struct kcm_op_ctx *op_ctx;
     struct sss_iobuf *reply;
 
     uint32_t op_ret;
 };
 
+/* The name of the ccache is the first argument of operations on a single
+ * ccache. It is read again by the operation itself. */
+static const char *kcm_cmd_ccname(TALLOC_CTX *mem_ctx,
+                                  struct kcm_op *op,
+                                  struct kcm_data *input)
+{
+    const uint8_t *end;
+
+    if (op->access != KCM_OP_ACCESS_CC_READ
+            && op->access != KCM_OP_ACCESS_CC_WRITE) {
+        return NULL;
+    }
+
+    end = memchr(input->data, '\0', input->length);
+    if (end == NULL) {
+        /* The operation will fail to read the name, lock all ccaches
+         * until then */
+        return NULL;
+    }
+
+    return talloc_strndup(mem_ctx, (const char *) input->data,
+                          end - input->data);
+}
+
 static void kcm_cmd_queue_done(struct tevent_req *subreq);
 static void kcm_cmd_done(struct tevent_req *subreq);
 
@@ -162,7 +199,11 @@ struct tevent_req *kcm_cmd_send(TALLOC_CTX *mem_ctx,
         goto immediate;
     }
 
-    subreq = kcm_op_queue_send(state, ev, qctx, client);
+    state->queued = tevent_timeval_current();
+    subreq = kcm_op_queue_send(state, ev, qctx, client,
+                               kcm_cmd_ccname(state, op, input),
+                               op->access == KCM_OP_ACCESS_ALL_WRITE
+                                    || op->access == KCM_OP_ACCESS_CC_WRITE);
     if (subreq == NULL) {
         ret = ENOMEM;
         goto immediate;
@@ -180,6 +221,7 @@ static void kcm_cmd_queue_done(struct tevent_req *subreq)
 {
     struct tevent_req *req = tevent_req_callback_data(subreq, struct tevent_req);
     struct kcm_cmd_state *state = tevent_req_data(req, struct kcm_cmd_state);
+    struct timeval now;
     errno_t ret;
 
     /* When this request finishes, it frees the queue_entry which unblocks
@@ -193,6 +235,13 @@ static void kcm_cmd_queue_done(struct tevent_req *subreq)
         return;
     }
 
+    now = tevent_timeval_current();
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "KCM operation %s waited %"PRIu64" us in the queue\n",
+          kcm_opt_name(state->op),
+          (uint64_t) (now.tv_sec - state->queued.tv_sec) * 1000000
+                + now.tv_usec - state->queued.tv_usec);
+
     subreq = state->op->fn_send(state, state->ev, state->op_ctx);
     if (subreq == NULL) {
         tevent_req_error(req, ENOMEM);
@@ -2122,27 +2171,41 @@ static struct kcm_op kcm_optable[] = {
     { "NOOP",                NULL, NULL },
     { "GET_NAME",            NULL, NULL },
     { "RESOLVE",             NULL, NULL },
-    { "GEN_NEW",             kcm_op_gen_new_send, NULL },
-    { "INITIALIZE",          kcm_op_initialize_send, kcm_op_initialize_recv },
-    { "DESTROY",             kcm_op_destroy_send, NULL },
-    { "STORE",               kcm_op_store_send, kcm_op_store_recv },
+    { "GEN_NEW",             kcm_op_gen_new_send, NULL,
+                             KCM_OP_ACCESS_ALL_READ },
+    { "INITIALIZE",          kcm_op_initialize_send, kcm_op_initialize_recv,
+                             KCM_OP_ACCESS_ALL_WRITE },
+    { "DESTROY",             kcm_op_destroy_send, NULL,
+                             KCM_OP_ACCESS_ALL_WRITE },
+    { "STORE",               kcm_op_store_send, kcm_op_store_recv,
+                             KCM_OP_ACCESS_CC_WRITE },
     { "RETRIEVE",            NULL, NULL },
-    { "GET_PRINCIPAL",       kcm_op_get_principal_send, NULL },
-    { "GET_CRED_UUID_LIST",  kcm_op_get_cred_uuid_list_send, NULL },
-    { "GET_CRED_BY_UUID",    kcm_op_get_cred_by_uuid_send, NULL },
-    { "REMOVE_CRED",         kcm_op_remove_cred_send, NULL },
+    { "GET_PRINCIPAL",       kcm_op_get_principal_send, NULL,
+                             KCM_OP_ACCESS_CC_READ },
+    { "GET_CRED_UUID_LIST",  kcm_op_get_cred_uuid_list_send, NULL,
+                             KCM_OP_ACCESS_CC_READ },
+    { "GET_CRED_BY_UUID",    kcm_op_get_cred_by_uuid_send, NULL,
+                             KCM_OP_ACCESS_CC_READ },
+    { "REMOVE_CRED",         kcm_op_remove_cred_send, NULL,
+                             KCM_OP_ACCESS_CC_WRITE },
     { "SET_FLAGS",           NULL, NULL },
     { "CHOWN",               NULL, NULL },
     { "CHMOD",               NULL, NULL },
     { "GET_INITIAL_TICKET",  NULL, NULL },
     { "GET_TICKET",          NULL, NULL },
     { "MOVE_CACHE",          NULL, NULL },
-    { "GET_CACHE_UUID_LIST", kcm_op_get_cache_uuid_list_send, NULL },
-    { "GET_CACHE_BY_UUID",   kcm_op_get_cache_by_uuid_send, NULL },
-    { "GET_DEFAULT_CACHE",   kcm_op_get_default_ccache_send, kcm_op_get_default_ccache_recv },
-    { "SET_DEFAULT_CACHE",   kcm_op_set_default_ccache_send, kcm_op_set_default_ccache_recv },
-    { "GET_KDC_OFFSET",      kcm_op_get_kdc_offset_send, NULL },
-    { "SET_KDC_OFFSET",      kcm_op_set_kdc_offset_send, kcm_op_set_kdc_offset_recv },
+    { "GET_CACHE_UUID_LIST", kcm_op_get_cache_uuid_list_send, NULL,
+                             KCM_OP_ACCESS_ALL_READ },
+    { "GET_CACHE_BY_UUID",   kcm_op_get_cache_by_uuid_send, NULL,
+                             KCM_OP_ACCESS_ALL_READ },
+    { "GET_DEFAULT_CACHE",   kcm_op_get_default_ccache_send, kcm_op_get_default_ccache_recv,
+                             KCM_OP_ACCESS_ALL_READ },
+    { "SET_DEFAULT_CACHE",   kcm_op_set_default_ccache_send, kcm_op_set_default_ccache_recv,
+                             KCM_OP_ACCESS_ALL_WRITE },
+    { "GET_KDC_OFFSET",      kcm_op_get_kdc_offset_send, NULL,
+                             KCM_OP_ACCESS_CC_READ },
+    { "SET_KDC_OFFSET",      kcm_op_set_kdc_offset_send, kcm_op_set_kdc_offset_recv,
+                             KCM_OP_ACCESS_CC_WRITE },
     { "ADD_NTLM_CRED",       NULL, NULL },
     { "HAVE_NTLM_CRED",      NULL, NULL },
     { "DEL_NTLM_CRED",       NULL, NULL },
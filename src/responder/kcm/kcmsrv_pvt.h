@@ -82,9 +82,10 @@ int kcm_connection_setup(struct cli_ctx *cctx);
 krb5_error_code sss2krb5_error(errno_t err);
 
 /* We enqueue all requests by the same UID to avoid concurrency issues
- * especially when performing multiple round-trips to sssd-secrets. In
- * future, we should relax the queue to allow multiple read-only operations
- * if no write operations are in progress.
+ * especially when performing multiple round-trips to sssd-secrets.
+ * Requests that only read a ccache run in parallel, a request that
+ * modifies a ccache waits for the other requests on the same ccache.
+ * If ccname is NULL, the request works with all the ccaches of the user.
  */
 struct kcm_ops_queue_entry;
 
@@ -93,7 +94,9 @@ struct kcm_ops_queue_ctx *kcm_ops_queue_create(TALLOC_CTX *mem_ctx);
 struct tevent_req *kcm_op_queue_send(TALLOC_CTX *mem_ctx,
                                      struct tevent_context *ev,
                                      struct kcm_ops_queue_ctx *qctx,
-                                     struct cli_creds *client);
+                                     struct cli_creds *client,
+                                     const char *ccname,
+                                     bool exclusive);
 
 errno_t kcm_op_queue_recv(struct tevent_req *req,
                           TALLOC_CTX *mem_ctx,
@@ -21,6 +21,7 @@
 
 #include "util/util.h"
 #include "util/crypto/sss_crypto.h"
+#include "util/sss_metrics.h"
 #include "confdb/confdb.h"
 #include <sys/mman.h>
 #include <fcntl.h>
@@ -76,6 +77,10 @@ struct sss_mc_ctx {
 
     uint8_t *data_table;    /* data table address (in mmap) */
     uint32_t dt_size;       /* size of data table */
+
+    struct sss_metric *stores;      /* records written */
+    struct sss_metric *evictions;   /* records dropped to make room */
+    struct sss_metric *invalidations; /* records explicitly invalidated */
 };
 
 #define MC_FIND_BIT(base, num) \
@@ -461,6 +466,7 @@ static errno_t sss_mc_find_free_slots(struct sss_mc_ctx *mcc,
 
             /* finally invalidate record completely */
             sss_mc_invalidate_rec(mcc, rec);
+            sss_metric_add(mcc->evictions, 1);
         }
     }
 
@@ -612,6 +618,7 @@ static errno_t sss_mc_get_record(struct sss_mc_ctx **_mcc,
         old_slots = MC_SIZE_TO_SLOTS(old_rec->len);
 
         if (old_slots == num_slots) {
+            sss_metric_add(mcc->stores, 1);
             *_rec = old_rec;
             return EOK;
         }
@@ -649,6 +656,8 @@ static errno_t sss_mc_get_record(struct sss_mc_ctx **_mcc,
         MC_SET_BIT(mcc->free_table, base_slot + i);
     }
 
+    sss_metric_add(mcc->stores, 1);
+
     *_rec = rec;
     return EOK;
 }
@@ -695,6 +704,7 @@ static errno_t sss_mmap_cache_invalidate(struct sss_mc_ctx *mcc,
     }
 
     sss_mc_invalidate_rec(mcc, rec);
+    sss_metric_add(mcc->invalidations, 1);
 
     return EOK;
 }
@@ -836,6 +846,7 @@ errno_t sss_mmap_cache_pw_invalidate_uid(struct sss_mc_ctx *mcc, uid_t uid)
     }
 
     sss_mc_invalidate_rec(mcc, rec);
+    sss_metric_add(mcc->invalidations, 1);
 
     ret = EOK;
 
@@ -975,6 +986,7 @@ errno_t sss_mmap_cache_gr_invalidate_gid(struct sss_mc_ctx *mcc, gid_t gid)
     }
 
     sss_mc_invalidate_rec(mcc, rec);
+    sss_metric_add(mcc->invalidations, 1);
 
     ret = EOK;
 
@@ -1285,6 +1297,12 @@ errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
         goto done;
     }
 
+    /* The metrics are optional, NULL handles are ignored */
+    mc_ctx->stores = sss_metric_counter("mmap_cache.%s.store", name);
+    mc_ctx->evictions = sss_metric_counter("mmap_cache.%s.evict", name);
+    mc_ctx->invalidations = sss_metric_counter("mmap_cache.%s.invalidate",
+                                               name);
+
     mc_ctx->uid = uid;
     mc_ctx->gid = gid;
 
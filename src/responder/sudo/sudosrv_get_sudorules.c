@@ -177,7 +177,7 @@ static errno_t sudosrv_format_rules(struct resp_ctx *rctx,
                                     uint32_t num_rules)
 {
     uint32_t i;
-    errno_t ret;
+    errno_t ret = EOK;
 
 
     for (i = 0; i < num_rules; i++) {
@@ -281,24 +281,130 @@ static errno_t sudosrv_expired_rules(TALLOC_CTX *mem_ctx,
     return ret;
 }
 
-static errno_t sudosrv_cached_rules_by_user(TALLOC_CTX *mem_ctx,
-                                            struct sss_domain_info *domain,
-                                            uid_t cli_uid,
-                                            uid_t orig_uid,
-                                            const char *username,
-                                            char **groupnames,
-                                            struct sysdb_attrs ***_rules,
-                                            uint32_t *_num_rules)
-{
-    TALLOC_CTX *tmp_ctx;
+/*
+ * In-memory index of the cached sudo rules
+ *
+ * Instead of searching the cache with a filter that contains every group of
+ * the user, the responder keeps all rules of a domain indexed by their
+ * sudoUser values. The index is rebuilt when the generation of the rules in
+ * sysdb changes, i.e. after the rules were refreshed.
+ *
+ * The sorted and formatted result is also kept for each user and reused as
+ * long as the user's uid and groups, which are read after initgroups for
+ * each request, stay the same.
+ */
+
+#define SUDOSRV_MAX_CACHED_USERS 1024
+
+struct sudosrv_rule_list {
+    size_t *rules;
+    size_t count;
+    size_t allocated;
+};
+
+struct sudosrv_user_rules {
+    uid_t cli_uid;
+    uid_t orig_uid;
+    char **groups;
+
+    struct sysdb_attrs **rules;
+    uint32_t num_rules;
+};
+
+struct sudosrv_rule_index {
+    uint64_t generation;
+
     struct sysdb_attrs **rules;
     uint32_t num_rules;
+
+    /* sudoUser value -> struct sudosrv_rule_list */
+    hash_table_t *by_user;
+
+    /* rules with a +netgroup sudoUser value */
+    struct sudosrv_rule_list netgroups;
+
+    /* user name -> struct sudosrv_user_rules, allocated on users_ctx */
+    TALLOC_CTX *users_ctx;
+    hash_table_t *users;
+};
+
+static errno_t sudosrv_rule_list_add(TALLOC_CTX *mem_ctx,
+                                     struct sudosrv_rule_list *list,
+                                     size_t rule)
+{
+    size_t *rules;
+
+    /* a rule may list the same value twice, e.g. in lower case */
+    if (list->count > 0 && list->rules[list->count - 1] == rule) {
+        return EOK;
+    }
+
+    if (list->count == list->allocated) {
+        list->allocated = list->allocated == 0 ? 4 : list->allocated * 2;
+        rules = talloc_realloc(mem_ctx, list->rules, size_t, list->allocated);
+        if (rules == NULL) {
+            return ENOMEM;
+        }
+        list->rules = rules;
+    }
+
+    list->rules[list->count] = rule;
+    list->count++;
+
+    return EOK;
+}
+
+static errno_t sudosrv_rule_index_add(struct sudosrv_rule_index *index,
+                                      const char *value,
+                                      size_t rule)
+{
+    struct sudosrv_rule_list *list;
+    hash_key_t key;
+    hash_value_t hvalue;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(value);
+
+    hret = hash_lookup(index->by_user, &key, &hvalue);
+    if (hret == HASH_SUCCESS) {
+        list = talloc_get_type(hvalue.ptr, struct sudosrv_rule_list);
+    } else if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        list = talloc_zero(index, struct sudosrv_rule_list);
+        if (list == NULL) {
+            return ENOMEM;
+        }
+
+        hvalue.type = HASH_VALUE_PTR;
+        hvalue.ptr = list;
+        hret = hash_enter(index->by_user, &key, &hvalue);
+        if (hret != HASH_SUCCESS) {
+            return EIO;
+        }
+    } else {
+        return EIO;
+    }
+
+    return sudosrv_rule_list_add(list, list, rule);
+}
+
+static errno_t sudosrv_rule_index_build(TALLOC_CTX *mem_ctx,
+                                        struct sss_domain_info *domain,
+                                        uint64_t generation,
+                                        struct sudosrv_rule_index **_index)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sudosrv_rule_index *index;
+    struct ldb_message_element *el;
+    const char *value;
+    char *filter;
     uint32_t i;
-    const char *filter;
-    const char *val;
+    unsigned int j;
+    bool netgroup;
     errno_t ret;
     const char *attrs[] = { SYSDB_OBJECTCLASS,
                             SYSDB_SUDO_CACHE_AT_CN,
+                            SYSDB_SUDO_CACHE_AT_USER,
                             SYSDB_SUDO_CACHE_AT_HOST,
                             SYSDB_SUDO_CACHE_AT_COMMAND,
                             SYSDB_SUDO_CACHE_AT_OPTION,
@@ -315,38 +421,70 @@ static errno_t sudosrv_cached_rules_by_user(TALLOC_CTX *mem_ctx,
         return ENOMEM;
     }
 
-    filter = sysdb_sudo_filter_user(tmp_ctx, username, groupnames, orig_uid);
-    if (filter == NULL) {
+    index = talloc_zero(tmp_ctx, struct sudosrv_rule_index);
+    if (index == NULL) {
         ret = ENOMEM;
         goto done;
     }
+    index->generation = generation;
 
-    ret = sudosrv_query_cache(tmp_ctx, domain, attrs, filter,
-                              &rules, &num_rules);
+    ret = sss_hash_create(index, 0, &index->by_user);
     if (ret != EOK) {
         goto done;
     }
 
-    val = talloc_asprintf(tmp_ctx, "#%"SPRIuid, cli_uid);
-    if (val == NULL) {
+    filter = talloc_asprintf(tmp_ctx, "(&(%s=%s)(%s=*))",
+                             SYSDB_OBJECTCLASS, SYSDB_SUDO_CACHE_OC,
+                             SYSDB_SUDO_CACHE_AT_USER);
+    if (filter == NULL) {
         ret = ENOMEM;
         goto done;
     }
 
-    /* Add sudoUser: #uid to prevent conflicts with fqnames. */
-    DEBUG(SSSDBG_TRACE_FUNC, "Replacing sudoUser attribute with "
-          "sudoUser: %s\n", val);
-    for (i = 0; i < num_rules; i++) {
-        ret = sysdb_attrs_add_string(rules[i], SYSDB_SUDO_CACHE_AT_USER, val);
-        if (ret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to alter sudoUser attribute "
-                  "[%d]: %s\n", ret, sss_strerror(ret));
+    ret = sudosrv_query_cache(index, domain, attrs, filter,
+                              &index->rules, &index->num_rules);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    for (i = 0; i < index->num_rules; i++) {
+        ret = sysdb_attrs_get_el_ext(index->rules[i],
+                                     SYSDB_SUDO_CACHE_AT_USER, false, &el);
+        if (ret == ENOENT) {
+            continue;
+        } else if (ret != EOK) {
+            goto done;
+        }
+
+        netgroup = false;
+        for (j = 0; j < el->num_values; j++) {
+            value = (const char *)el->values[j].data;
+            if (value == NULL) {
+                continue;
+            }
+
+            if (value[0] == '+') {
+                netgroup = true;
+            }
+
+            ret = sudosrv_rule_index_add(index, value, i);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+
+        if (netgroup) {
+            ret = sudosrv_rule_list_add(index, &index->netgroups, i);
+            if (ret != EOK) {
+                goto done;
+            }
         }
     }
 
-    *_rules = talloc_steal(mem_ctx, rules);
-    *_num_rules = num_rules;
+    DEBUG(SSSDBG_TRACE_FUNC, "Indexed %u sudo rules of [%s]\n",
+          index->num_rules, domain->name);
 
+    *_index = talloc_steal(mem_ctx, index);
     ret = EOK;
 
 done:
@@ -354,120 +492,350 @@ done:
     return ret;
 }
 
-static errno_t sudosrv_cached_rules_by_ng(TALLOC_CTX *mem_ctx,
-                                          struct sss_domain_info *domain,
-                                          uid_t uid,
-                                          const char *username,
-                                          char **groupnames,
-                                          struct sysdb_attrs ***_rules,
-                                          uint32_t *_num_rules)
+static errno_t sudosrv_rule_index_get(struct sudo_ctx *sudo_ctx,
+                                      struct sss_domain_info *domain,
+                                      struct sudosrv_rule_index **_index)
 {
-    char *filter;
+    struct sudosrv_rule_index *index = NULL;
+    uint64_t generation;
+    hash_key_t key;
+    hash_value_t value;
     errno_t ret;
-    const char *attrs[] = { SYSDB_OBJECTCLASS,
-                            SYSDB_SUDO_CACHE_AT_CN,
-                            SYSDB_SUDO_CACHE_AT_USER,
-                            SYSDB_SUDO_CACHE_AT_HOST,
-                            SYSDB_SUDO_CACHE_AT_COMMAND,
-                            SYSDB_SUDO_CACHE_AT_OPTION,
-                            SYSDB_SUDO_CACHE_AT_RUNAS,
-                            SYSDB_SUDO_CACHE_AT_RUNASUSER,
-                            SYSDB_SUDO_CACHE_AT_RUNASGROUP,
-                            SYSDB_SUDO_CACHE_AT_NOTBEFORE,
-                            SYSDB_SUDO_CACHE_AT_NOTAFTER,
-                            SYSDB_SUDO_CACHE_AT_ORDER,
-                            NULL };
+    int hret;
 
-    filter = sysdb_sudo_filter_netgroups(NULL, username, groupnames, uid);
-    if (filter == NULL) {
+    if (IS_SUBDOMAIN(domain)) {
+        /* rules are stored inside parent domain tree */
+        domain = domain->parent;
+    }
+
+    ret = sysdb_sudo_get_generation(domain, &generation);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to read sudo rules generation "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        return ret;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = domain->name;
+
+    hret = hash_lookup(sudo_ctx->rule_indexes, &key, &value);
+    if (hret == HASH_SUCCESS) {
+        index = talloc_get_type(value.ptr, struct sudosrv_rule_index);
+        if (index->generation == generation) {
+            *_index = index;
+            return EOK;
+        }
+    } else if (hret != HASH_ERROR_KEY_NOT_FOUND) {
+        return EIO;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Sudo rules of [%s] changed, rebuilding "
+          "the rule index\n", domain->name);
+
+    talloc_zfree(index);
+    hash_delete(sudo_ctx->rule_indexes, &key);
+
+    ret = sudosrv_rule_index_build(sudo_ctx, domain, generation, &index);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    value.type = HASH_VALUE_PTR;
+    value.ptr = index;
+    hret = hash_enter(sudo_ctx->rule_indexes, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        talloc_free(index);
+        return EIO;
+    }
+
+    *_index = index;
+    return EOK;
+}
+
+static void sudosrv_rule_index_select(struct sudosrv_rule_index *index,
+                                      const char *value,
+                                      bool *selected,
+                                      size_t *rules,
+                                      size_t *_count)
+{
+    struct sudosrv_rule_list *list;
+    hash_key_t key;
+    hash_value_t hvalue;
+    size_t i;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(value);
+
+    if (hash_lookup(index->by_user, &key, &hvalue) != HASH_SUCCESS) {
+        return;
+    }
+
+    list = talloc_get_type(hvalue.ptr, struct sudosrv_rule_list);
+    for (i = 0; i < list->count; i++) {
+        if (!selected[list->rules[i]]) {
+            selected[list->rules[i]] = true;
+            rules[(*_count)++] = list->rules[i];
+        }
+    }
+}
+
+static bool sudosrv_same_groups(char **a, char **b)
+{
+    size_t i;
+
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+
+    for (i = 0; a[i] != NULL && b[i] != NULL; i++) {
+        if (strcmp(a[i], b[i]) != 0) {
+            return false;
+        }
+    }
+
+    return a[i] == NULL && b[i] == NULL;
+}
+
+static struct sudosrv_user_rules *
+sudosrv_user_rules_lookup(struct sudosrv_rule_index *index,
+                          uid_t cli_uid,
+                          uid_t orig_uid,
+                          const char *username,
+                          char **groups)
+{
+    struct sudosrv_user_rules *user;
+    hash_key_t key;
+    hash_value_t value;
+
+    if (index->users == NULL) {
+        return NULL;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(username);
+
+    if (hash_lookup(index->users, &key, &value) != HASH_SUCCESS) {
+        return NULL;
+    }
+
+    user = talloc_get_type(value.ptr, struct sudosrv_user_rules);
+    if (user->cli_uid != cli_uid || user->orig_uid != orig_uid
+            || !sudosrv_same_groups(user->groups, groups)) {
+        return NULL;
+    }
+
+    return user;
+}
+
+static errno_t sudosrv_copy_rule(TALLOC_CTX *mem_ctx,
+                                 struct sysdb_attrs *src,
+                                 const char *cli_user,
+                                 struct sysdb_attrs **_dst)
+{
+    struct sysdb_attrs *dst;
+    size_t i;
+    unsigned int j;
+    errno_t ret;
+
+    dst = sysdb_new_attrs(mem_ctx);
+    if (dst == NULL) {
         return ENOMEM;
     }
 
-    ret = sudosrv_query_cache(mem_ctx, domain, attrs, filter,
-                              _rules, _num_rules);
-    talloc_free(filter);
+    if (cli_user == NULL) {
+        ret = sysdb_attrs_copy(src, dst);
+        if (ret != EOK) {
+            goto done;
+        }
+    } else {
+        /* Replace sudoUser with #uid to prevent conflicts with fqnames. */
+        for (i = 0; i < src->num; i++) {
+            if (strcasecmp(src->a[i].name, SYSDB_SUDO_CACHE_AT_USER) == 0) {
+                continue;
+            }
+
+            for (j = 0; j < src->a[i].num_values; j++) {
+                ret = sysdb_attrs_add_val(dst, src->a[i].name,
+                                          &src->a[i].values[j]);
+                if (ret != EOK) {
+                    goto done;
+                }
+            }
+        }
+
+        ret = sysdb_attrs_add_string(dst, SYSDB_SUDO_CACHE_AT_USER, cli_user);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to alter sudoUser attribute "
+                  "[%d]: %s\n", ret, sss_strerror(ret));
+            goto done;
+        }
+    }
 
+    *_dst = dst;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(dst);
+    }
     return ret;
 }
 
-static errno_t sudosrv_cached_rules(TALLOC_CTX *mem_ctx,
-                                    struct resp_ctx *rctx,
-                                    struct sss_domain_info *domain,
-                                    uid_t cli_uid,
-                                    uid_t orig_uid,
-                                    const char *username,
-                                    char **groups,
-                                    bool inverse_order,
-                                    struct sysdb_attrs ***_rules,
-                                    uint32_t *_num_rules)
+static errno_t sudosrv_user_rules_build(struct sudo_ctx *sudo_ctx,
+                                        struct sudosrv_rule_index *index,
+                                        uid_t cli_uid,
+                                        uid_t orig_uid,
+                                        const char *username,
+                                        char **groups,
+                                        struct sudosrv_user_rules **_user)
 {
     TALLOC_CTX *tmp_ctx;
-    struct sysdb_attrs **user_rules;
-    struct sysdb_attrs **ng_rules;
-    struct sysdb_attrs **rules;
-    uint32_t num_user_rules;
-    uint32_t num_ng_rules;
-    uint32_t num_rules;
-    uint32_t rule_iter, i;
+    struct sudosrv_user_rules *user;
+    const char *cli_user;
+    const char *value;
+    bool *selected;
+    size_t *rules;
+    size_t num_user_rules;
+    size_t count = 0;
+    size_t i;
+    hash_key_t key;
+    hash_value_t hvalue;
     errno_t ret;
+    int hret;
 
     tmp_ctx = talloc_new(NULL);
     if (tmp_ctx == NULL) {
         return ENOMEM;
     }
 
-    ret = sudosrv_cached_rules_by_user(tmp_ctx, domain,
-                                       cli_uid, orig_uid, username, groups,
-                                       &user_rules, &num_user_rules);
-    if (ret != EOK) {
+    selected = talloc_zero_array(tmp_ctx, bool, index->num_rules + 1);
+    rules = talloc_array(tmp_ctx, size_t, index->num_rules + 1);
+    if (selected == NULL || rules == NULL) {
+        ret = ENOMEM;
         goto done;
     }
 
-    ret = sudosrv_cached_rules_by_ng(tmp_ctx, domain,
-                                     orig_uid, username, groups,
-                                     &ng_rules, &num_ng_rules);
-    if (ret != EOK) {
-        goto done;
+    /* the same values as in sysdb_sudo_filter_user() */
+    sudosrv_rule_index_select(index, "ALL", selected, rules, &count);
+    sudosrv_rule_index_select(index, username, selected, rules, &count);
+
+    if (orig_uid != 0) {
+        value = talloc_asprintf(tmp_ctx, "#%"SPRIuid, orig_uid);
+        if (value == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        sudosrv_rule_index_select(index, value, selected, rules, &count);
     }
 
-    num_rules = num_user_rules + num_ng_rules;
-    if (num_rules == 0) {
-        *_rules = NULL;
-        *_num_rules = 0;
-        ret = EOK;
+    for (i = 0; groups != NULL && groups[i] != NULL; i++) {
+        value = talloc_asprintf(tmp_ctx, "%%%s", groups[i]);
+        if (value == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        sudosrv_rule_index_select(index, value, selected, rules, &count);
+    }
+
+    /* the netgroups are evaluated by sudo itself, see
+     * sysdb_sudo_filter_netgroups() */
+    num_user_rules = count;
+    for (i = 0; i < index->netgroups.count; i++) {
+        if (!selected[index->netgroups.rules[i]]) {
+            selected[index->netgroups.rules[i]] = true;
+            rules[count++] = index->netgroups.rules[i];
+        }
+    }
+
+    if (index->users == NULL
+            || hash_count(index->users) >= SUDOSRV_MAX_CACHED_USERS) {
+        talloc_zfree(index->users_ctx);
+        index->users = NULL;
+
+        index->users_ctx = talloc_new(index);
+        if (index->users_ctx == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = sss_hash_create(index->users_ctx, 0, &index->users);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    user = talloc_zero(tmp_ctx, struct sudosrv_user_rules);
+    if (user == NULL) {
+        ret = ENOMEM;
         goto done;
     }
+    user->cli_uid = cli_uid;
+    user->orig_uid = orig_uid;
+
+    if (groups != NULL) {
+        user->groups = discard_const_p(char *,
+                                dup_string_list(user, (const char **)groups));
+        if (user->groups == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
 
-    rules = talloc_array(tmp_ctx, struct sysdb_attrs *, num_rules);
-    if (rules == NULL) {
+    cli_user = talloc_asprintf(tmp_ctx, "#%"SPRIuid, cli_uid);
+    if (cli_user == NULL) {
         ret = ENOMEM;
         goto done;
     }
 
-    rule_iter = 0;
-    for (i = 0; i < num_user_rules; rule_iter++, i++) {
-        rules[rule_iter] = talloc_steal(rules, user_rules[i]);
+    user->rules = talloc_zero_array(user, struct sysdb_attrs *, count + 1);
+    if (user->rules == NULL) {
+        ret = ENOMEM;
+        goto done;
     }
 
-    for (i = 0; i < num_ng_rules; rule_iter++, i++) {
-        rules[rule_iter] = talloc_steal(rules, ng_rules[i]);
+    for (i = 0; i < count; i++) {
+        ret = sudosrv_copy_rule(user->rules, index->rules[rules[i]],
+                                i < num_user_rules ? cli_user : NULL,
+                                &user->rules[i]);
+        if (ret != EOK) {
+            goto done;
+        }
     }
+    user->num_rules = count;
 
-    ret = sort_sudo_rules(rules, num_rules, inverse_order);
+    ret = sort_sudo_rules(user->rules, user->num_rules,
+                          sudo_ctx->inverse_order);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "Could not sort rules by sudoOrder\n");
         goto done;
     }
 
-    ret = sudosrv_format_rules(rctx, rules, num_rules);
+    ret = sudosrv_format_rules(sudo_ctx->rctx, user->rules, user->num_rules);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "Could not format sudo rules\n");
         goto done;
     }
 
-    *_rules = talloc_steal(mem_ctx, rules);
-    *_num_rules = num_rules;
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(username);
+
+    /* drop the outdated entry of this user, if any */
+    if (hash_lookup(index->users, &key, &hvalue) == HASH_SUCCESS) {
+        talloc_free(hvalue.ptr);
+        hash_delete(index->users, &key);
+    }
+
+    hvalue.type = HASH_VALUE_PTR;
+    hvalue.ptr = user;
 
+    hret = hash_enter(index->users, &key, &hvalue);
+    if (hret != HASH_SUCCESS) {
+        ret = EIO;
+        goto done;
+    }
+    talloc_steal(index->users_ctx, user);
+
+    *_user = user;
     ret = EOK;
 
 done:
@@ -475,6 +843,58 @@ done:
     return ret;
 }
 
+static errno_t sudosrv_cached_rules(TALLOC_CTX *mem_ctx,
+                                    struct sudo_ctx *sudo_ctx,
+                                    struct sss_domain_info *domain,
+                                    uid_t cli_uid,
+                                    uid_t orig_uid,
+                                    const char *username,
+                                    char **groups,
+                                    struct sysdb_attrs ***_rules,
+                                    uint32_t *_num_rules)
+{
+    struct sudosrv_rule_index *index;
+    struct sudosrv_user_rules *user;
+    struct sysdb_attrs **rules;
+    errno_t ret;
+
+    ret = sudosrv_rule_index_get(sudo_ctx, domain, &index);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    user = sudosrv_user_rules_lookup(index, cli_uid, orig_uid,
+                                     username, groups);
+    if (user == NULL) {
+        ret = sudosrv_user_rules_build(sudo_ctx, index, cli_uid, orig_uid,
+                                       username, groups, &user);
+        if (ret != EOK) {
+            return ret;
+        }
+    } else {
+        DEBUG(SSSDBG_TRACE_FUNC, "Using cached rules of [%s@%s]\n",
+              username, domain->name);
+    }
+
+    if (user->num_rules == 0) {
+        *_rules = NULL;
+        *_num_rules = 0;
+        return EOK;
+    }
+
+    /* The rules stay owned by the cache, only the array is returned. */
+    rules = talloc_array(mem_ctx, struct sysdb_attrs *, user->num_rules);
+    if (rules == NULL) {
+        return ENOMEM;
+    }
+    memcpy(rules, user->rules, sizeof(struct sysdb_attrs *) * user->num_rules);
+
+    *_rules = rules;
+    *_num_rules = user->num_rules;
+
+    return EOK;
+}
+
 static errno_t sudosrv_cached_defaults(TALLOC_CTX *mem_ctx,
                                        struct sss_domain_info *domain,
                                        struct sysdb_attrs ***_rules,
@@ -509,14 +929,13 @@ static errno_t sudosrv_cached_defaults(TALLOC_CTX *mem_ctx,
 }
 
 static errno_t sudosrv_fetch_rules(TALLOC_CTX *mem_ctx,
-                                   struct resp_ctx *rctx,
+                                   struct sudo_ctx *sudo_ctx,
                                    enum sss_sudo_type type,
                                    struct sss_domain_info *domain,
                                    uid_t cli_uid,
                                    uid_t orig_uid,
                                    const char *username,
                                    char **groups,
-                                   bool inverse_order,
                                    struct sysdb_attrs ***_rules,
                                    uint32_t *_num_rules)
 {
@@ -531,9 +950,9 @@ static errno_t sudosrv_fetch_rules(TALLOC_CTX *mem_ctx,
               username, domain->name);
         debug_name = "rules";
 
-        ret = sudosrv_cached_rules(mem_ctx, rctx, domain,
+        ret = sudosrv_cached_rules(mem_ctx, sudo_ctx, domain,
                                    cli_uid, orig_uid, username, groups,
-                                   inverse_order, &rules, &num_rules);
+                                   &rules, &num_rules);
 
         break;
     case SSS_SUDO_DEFAULTS:
@@ -723,13 +1142,13 @@ static errno_t sudosrv_refresh_rules_recv(struct tevent_req *req)
 
 struct sudosrv_get_rules_state {
     struct tevent_context *ev;
+    struct sudo_ctx *sudo_ctx;
     struct resp_ctx *rctx;
     enum sss_sudo_type type;
     uid_t cli_uid;
     const char *username;
     struct sss_domain_info *domain;
     char **groups;
-    bool inverse_order;
     int threshold;
 
     uid_t orig_uid;
@@ -761,10 +1180,10 @@ struct tevent_req *sudosrv_get_rules_send(TALLOC_CTX *mem_ctx,
     }
 
     state->ev = ev;
+    state->sudo_ctx = sudo_ctx;
     state->rctx = sudo_ctx->rctx;
     state->type = type;
     state->cli_uid = cli_uid;
-    state->inverse_order = sudo_ctx->inverse_order;
     state->threshold = sudo_ctx->threshold;
 
     DEBUG(SSSDBG_TRACE_FUNC, "Running initgroups for [%s]\n", username);
@@ -863,12 +1282,12 @@ static void sudosrv_get_rules_done(struct tevent_req *subreq)
               "in cache.\n");
     }
 
-    ret = sudosrv_fetch_rules(state, state->rctx, state->type, state->domain,
+    ret = sudosrv_fetch_rules(state, state->sudo_ctx, state->type,
+                              state->domain,
                               state->cli_uid,
                               state->orig_uid,
                               state->orig_username,
                               state->groups,
-                              state->inverse_order,
                               &state->rules, &state->num_rules);
 
     if (ret != EOK) {
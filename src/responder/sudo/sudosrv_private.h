@@ -49,6 +49,9 @@ struct sudo_ctx {
     bool timed;
     bool inverse_order;
     int threshold;
+
+    /* domain name -> in-memory index of the cached rules */
+    hash_table_t *rule_indexes;
 };
 
 struct sudo_cmd_ctx {
@@ -56,6 +56,65 @@ errno_t _sbus_sss_invoker_write_as
     return EOK;
 }
 
+errno_t _sbus_sss_invoker_read_asauauau
+   (TALLOC_CTX *mem_ctx,
+    DBusMessageIter *iter,
+    struct _sbus_sss_invoker_args_asauauau *args)
+{
+    errno_t ret;
+
+    ret = sbus_iterator_read_as(mem_ctx, iter, &args->arg0);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_iterator_read_au(mem_ctx, iter, &args->arg1);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_iterator_read_au(mem_ctx, iter, &args->arg2);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_iterator_read_au(mem_ctx, iter, &args->arg3);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
+errno_t _sbus_sss_invoker_write_asauauau
+   (DBusMessageIter *iter,
+    struct _sbus_sss_invoker_args_asauauau *args)
+{
+    errno_t ret;
+
+    ret = sbus_iterator_write_as(iter, args->arg0);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_iterator_write_au(iter, args->arg1);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_iterator_write_au(iter, args->arg2);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = sbus_iterator_write_au(iter, args->arg3);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return EOK;
+}
+
 errno_t _sbus_sss_invoker_read_b
    (TALLOC_CTX *mem_ctx,
     DBusMessageIter *iter,
@@ -582,10 +641,10 @@ errno_t _sbus_sss_invoker_write_uss
     return EOK;
 }
 
-errno_t _sbus_sss_invoker_read_uusss
+errno_t _sbus_sss_invoker_read_uussss
    (TALLOC_CTX *mem_ctx,
     DBusMessageIter *iter,
-    struct _sbus_sss_invoker_args_uusss *args)
+    struct _sbus_sss_invoker_args_uussss *args)
 {
     errno_t ret;
 
@@ -614,12 +673,17 @@ errno_t _sbus_sss_invoker_read_uusss
         return ret;
     }
 
+    ret = sbus_iterator_read_s(mem_ctx, iter, &args->arg5);
+    if (ret != EOK) {
+        return ret;
+    }
+
     return EOK;
 }
 
-errno_t _sbus_sss_invoker_write_uusss
+errno_t _sbus_sss_invoker_write_uussss
    (DBusMessageIter *iter,
-    struct _sbus_sss_invoker_args_uusss *args)
+    struct _sbus_sss_invoker_args_uussss *args)
 {
     errno_t ret;
 
@@ -648,6 +712,11 @@ errno_t _sbus_sss_invoker_write_uusss
         return ret;
     }
 
+    ret = sbus_iterator_write_s(iter, args->arg5);
+    if (ret != EOK) {
+        return ret;
+    }
+
     return EOK;
 }
 
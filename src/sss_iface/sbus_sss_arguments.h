@@ -43,6 +43,24 @@ _sbus_sss_invoker_write_as
    (DBusMessageIter *iter,
     struct _sbus_sss_invoker_args_as *args);
 
+struct _sbus_sss_invoker_args_asauauau {
+    const char ** arg0;
+    uint32_t * arg1;
+    uint32_t * arg2;
+    uint32_t * arg3;
+};
+
+errno_t
+_sbus_sss_invoker_read_asauauau
+   (TALLOC_CTX *mem_ctx,
+    DBusMessageIter *iter,
+    struct _sbus_sss_invoker_args_asauauau *args);
+
+errno_t
+_sbus_sss_invoker_write_asauauau
+   (DBusMessageIter *iter,
+    struct _sbus_sss_invoker_args_asauauau *args);
+
 struct _sbus_sss_invoker_args_b {
     bool arg0;
 };
@@ -265,23 +283,24 @@ _sbus_sss_invoker_write_uss
    (DBusMessageIter *iter,
     struct _sbus_sss_invoker_args_uss *args);
 
-struct _sbus_sss_invoker_args_uusss {
+struct _sbus_sss_invoker_args_uussss {
     uint32_t arg0;
     uint32_t arg1;
     const char * arg2;
     const char * arg3;
     const char * arg4;
+    const char * arg5;
 };
 
 errno_t
-_sbus_sss_invoker_read_uusss
+_sbus_sss_invoker_read_uussss
    (TALLOC_CTX *mem_ctx,
     DBusMessageIter *iter,
-    struct _sbus_sss_invoker_args_uusss *args);
+    struct _sbus_sss_invoker_args_uussss *args);
 
 errno_t
-_sbus_sss_invoker_write_uusss
+_sbus_sss_invoker_write_uussss
    (DBusMessageIter *iter,
-    struct _sbus_sss_invoker_args_uusss *args);
+    struct _sbus_sss_invoker_args_uussss *args);
 
 #endif /* _SBUS_SSS_ARGUMENTS_H_ */
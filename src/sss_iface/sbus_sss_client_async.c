@@ -500,6 +500,116 @@ sbus_method_in_s_out_as_recv
     return EOK;
 }
 
+struct sbus_method_in_s_out_asauauau_state {
+    struct _sbus_sss_invoker_args_s in;
+    struct _sbus_sss_invoker_args_asauauau *out;
+};
+
+static void sbus_method_in_s_out_asauauau_done(struct tevent_req *subreq);
+
+static struct tevent_req *
+sbus_method_in_s_out_asauauau_send
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_connection *conn,
+     sbus_invoker_keygen keygen,
+     const char *bus,
+     const char *path,
+     const char *iface,
+     const char *method,
+     const char * arg0)
+{
+    struct sbus_method_in_s_out_asauauau_state *state;
+    struct tevent_req *subreq;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct sbus_method_in_s_out_asauauau_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create tevent request!\n");
+        return NULL;
+    }
+
+    state->out = talloc_zero(state, struct _sbus_sss_invoker_args_asauauau);
+    if (state->out == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Unable to allocate space for output parameters!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    state->in.arg0 = arg0;
+
+    subreq = sbus_call_method_send(state, conn, NULL, keygen,
+                                   (sbus_invoker_writer_fn)_sbus_sss_invoker_write_s,
+                                   bus, path, iface, method, &state->in);
+    if (subreq == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create subrequest!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    tevent_req_set_callback(subreq, sbus_method_in_s_out_asauauau_done, req);
+
+    ret = EAGAIN;
+
+done:
+    if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+        tevent_req_post(req, conn->ev);
+    }
+
+    return req;
+}
+
+static void sbus_method_in_s_out_asauauau_done(struct tevent_req *subreq)
+{
+    struct sbus_method_in_s_out_asauauau_state *state;
+    struct tevent_req *req;
+    DBusMessage *reply;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct sbus_method_in_s_out_asauauau_state);
+
+    ret = sbus_call_method_recv(state, subreq, &reply);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    ret = sbus_read_output(state->out, reply, (sbus_invoker_reader_fn)_sbus_sss_invoker_read_asauauau, state->out);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+    return;
+}
+
+static errno_t
+sbus_method_in_s_out_asauauau_recv
+    (TALLOC_CTX *mem_ctx,
+     struct tevent_req *req,
+     const char *** _arg0,
+     uint32_t ** _arg1,
+     uint32_t ** _arg2,
+     uint32_t ** _arg3)
+{
+    struct sbus_method_in_s_out_asauauau_state *state;
+    state = tevent_req_data(req, struct sbus_method_in_s_out_asauauau_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_arg0 = talloc_steal(mem_ctx, state->out->arg0);
+    *_arg1 = talloc_steal(mem_ctx, state->out->arg1);
+    *_arg2 = talloc_steal(mem_ctx, state->out->arg2);
+    *_arg3 = talloc_steal(mem_ctx, state->out->arg3);
+
+    return EOK;
+}
+
 struct sbus_method_in_s_out_b_state {
     struct _sbus_sss_invoker_args_s in;
     struct _sbus_sss_invoker_args_b *out;
@@ -1568,15 +1678,15 @@ sbus_method_in_uss_out_qus_recv
     return EOK;
 }
 
-struct sbus_method_in_uusss_out_qus_state {
-    struct _sbus_sss_invoker_args_uusss in;
+struct sbus_method_in_uussss_out_qus_state {
+    struct _sbus_sss_invoker_args_uussss in;
     struct _sbus_sss_invoker_args_qus *out;
 };
 
-static void sbus_method_in_uusss_out_qus_done(struct tevent_req *subreq);
+static void sbus_method_in_uussss_out_qus_done(struct tevent_req *subreq);
 
 static struct tevent_req *
-sbus_method_in_uusss_out_qus_send
+sbus_method_in_uussss_out_qus_send
     (TALLOC_CTX *mem_ctx,
      struct sbus_connection *conn,
      sbus_invoker_keygen keygen,
@@ -1588,14 +1698,15 @@ sbus_method_in_uusss_out_qus_send
      uint32_t arg1,
      const char * arg2,
      const char * arg3,
-     const char * arg4)
+     const char * arg4,
+     const char * arg5)
 {
-    struct sbus_method_in_uusss_out_qus_state *state;
+    struct sbus_method_in_uussss_out_qus_state *state;
     struct tevent_req *subreq;
     struct tevent_req *req;
     errno_t ret;
 
-    req = tevent_req_create(mem_ctx, &state, struct sbus_method_in_uusss_out_qus_state);
+    req = tevent_req_create(mem_ctx, &state, struct sbus_method_in_uussss_out_qus_state);
     if (req == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create tevent request!\n");
         return NULL;
@@ -1614,9 +1725,10 @@ sbus_method_in_uusss_out_qus_send
     state->in.arg2 = arg2;
     state->in.arg3 = arg3;
     state->in.arg4 = arg4;
+    state->in.arg5 = arg5;
 
     subreq = sbus_call_method_send(state, conn, NULL, keygen,
-                                   (sbus_invoker_writer_fn)_sbus_sss_invoker_write_uusss,
+                                   (sbus_invoker_writer_fn)_sbus_sss_invoker_write_uussss,
                                    bus, path, iface, method, &state->in);
     if (subreq == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create subrequest!\n");
@@ -1624,7 +1736,7 @@ sbus_method_in_uusss_out_qus_send
         goto done;
     }
 
-    tevent_req_set_callback(subreq, sbus_method_in_uusss_out_qus_done, req);
+    tevent_req_set_callback(subreq, sbus_method_in_uussss_out_qus_done, req);
 
     ret = EAGAIN;
 
@@ -1637,15 +1749,15 @@ done:
     return req;
 }
 
-static void sbus_method_in_uusss_out_qus_done(struct tevent_req *subreq)
+static void sbus_method_in_uussss_out_qus_done(struct tevent_req *subreq)
 {
-    struct sbus_method_in_uusss_out_qus_state *state;
+    struct sbus_method_in_uussss_out_qus_state *state;
     struct tevent_req *req;
     DBusMessage *reply;
     errno_t ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
-    state = tevent_req_data(req, struct sbus_method_in_uusss_out_qus_state);
+    state = tevent_req_data(req, struct sbus_method_in_uussss_out_qus_state);
 
     ret = sbus_call_method_recv(state, subreq, &reply);
     talloc_zfree(subreq);
@@ -1665,15 +1777,15 @@ static void sbus_method_in_uusss_out_qus_done(struct tevent_req *subreq)
 }
 
 static errno_t
-sbus_method_in_uusss_out_qus_recv
+sbus_method_in_uussss_out_qus_recv
     (TALLOC_CTX *mem_ctx,
      struct tevent_req *req,
      uint16_t* _arg0,
      uint32_t* _arg1,
      const char ** _arg2)
 {
-    struct sbus_method_in_uusss_out_qus_state *state;
-    state = tevent_req_data(req, struct sbus_method_in_uusss_out_qus_state);
+    struct sbus_method_in_uussss_out_qus_state *state;
+    state = tevent_req_data(req, struct sbus_method_in_uussss_out_qus_state);
 
     TEVENT_REQ_RETURN_ON_ERROR(req);
 
@@ -1844,6 +1956,30 @@ sbus_call_dp_failover_ActiveServer_recv
     return sbus_method_in_s_out_s_recv(mem_ctx, req, _server);
 }
 
+struct tevent_req *
+sbus_call_dp_failover_ListServerScores_send
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_connection *conn,
+     const char *busname,
+     const char *object_path,
+     const char * arg_service_name)
+{
+    return sbus_method_in_s_out_asauauau_send(mem_ctx, conn, _sbus_sss_key_s_0,
+        busname, object_path, "sssd.DataProvider.Failover", "ListServerScores", arg_service_name);
+}
+
+errno_t
+sbus_call_dp_failover_ListServerScores_recv
+    (TALLOC_CTX *mem_ctx,
+     struct tevent_req *req,
+     const char *** _servers,
+     uint32_t ** _rtt_usec,
+     uint32_t ** _error_permille,
+     uint32_t ** _samples)
+{
+    return sbus_method_in_s_out_asauauau_recv(mem_ctx, req, _servers, _rtt_usec, _error_permille, _samples);
+}
+
 struct tevent_req *
 sbus_call_dp_failover_ListServers_send
     (TALLOC_CTX *mem_ctx,
@@ -2034,10 +2170,11 @@ sbus_call_dp_dp_getAccountInfo_send
      uint32_t arg_entry_type,
      const char * arg_filter,
      const char * arg_domain,
-     const char * arg_extra)
+     const char * arg_extra,
+     const char * arg_trace_id)
 {
-    return sbus_method_in_uusss_out_qus_send(mem_ctx, conn, _sbus_sss_key_uusss_0_1_2_3_4,
-        busname, object_path, "sssd.dataprovider", "getAccountInfo", arg_dp_flags, arg_entry_type, arg_filter, arg_domain, arg_extra);
+    return sbus_method_in_uussss_out_qus_send(mem_ctx, conn, _sbus_sss_key_uussss_0_1_2_3_4,
+        busname, object_path, "sssd.dataprovider", "getAccountInfo", arg_dp_flags, arg_entry_type, arg_filter, arg_domain, arg_extra, arg_trace_id);
 }
 
 errno_t
@@ -2048,7 +2185,7 @@ sbus_call_dp_dp_getAccountInfo_recv
      uint32_t* _error,
      const char ** _error_message)
 {
-    return sbus_method_in_uusss_out_qus_recv(mem_ctx, req, _dp_error, _error, _error_message);
+    return sbus_method_in_uussss_out_qus_recv(mem_ctx, req, _dp_error, _error, _error_message);
 }
 
 struct tevent_req *
@@ -132,6 +132,23 @@ sbus_call_dp_failover_ActiveServer_recv
      struct tevent_req *req,
      const char ** _server);
 
+struct tevent_req *
+sbus_call_dp_failover_ListServerScores_send
+    (TALLOC_CTX *mem_ctx,
+     struct sbus_connection *conn,
+     const char *busname,
+     const char *object_path,
+     const char * arg_service_name);
+
+errno_t
+sbus_call_dp_failover_ListServerScores_recv
+    (TALLOC_CTX *mem_ctx,
+     struct tevent_req *req,
+     const char *** _servers,
+     uint32_t ** _rtt_usec,
+     uint32_t ** _error_permille,
+     uint32_t ** _samples);
+
 struct tevent_req *
 sbus_call_dp_failover_ListServers_send
     (TALLOC_CTX *mem_ctx,
@@ -259,7 +276,8 @@ sbus_call_dp_dp_getAccountInfo_send
      uint32_t arg_entry_type,
      const char * arg_filter,
      const char * arg_domain,
-     const char * arg_extra);
+     const char * arg_extra,
+     const char * arg_trace_id);
 
 errno_t
 sbus_call_dp_dp_getAccountInfo_recv
@@ -309,6 +309,28 @@
         (handler_send), (handler_recv), (data)); \
 })
 
+/* Method: sssd.DataProvider.Failover.ListServerScores */
+#define SBUS_METHOD_SYNC_sssd_DataProvider_Failover_ListServerScores(handler, data) ({ \
+    SBUS_CHECK_SYNC((handler), (data), const char *, const char ***, uint32_t **, uint32_t **, uint32_t **); \
+    sbus_method_sync("ListServerScores", \
+        &_sbus_sss_args_sssd_DataProvider_Failover_ListServerScores, \
+        NULL, \
+        _sbus_sss_invoke_in_s_out_asauauau_send, \
+        _sbus_sss_key_s_0, \
+        (handler), (data)); \
+})
+
+#define SBUS_METHOD_ASYNC_sssd_DataProvider_Failover_ListServerScores(handler_send, handler_recv, data) ({ \
+    SBUS_CHECK_SEND((handler_send), (data), const char *); \
+    SBUS_CHECK_RECV((handler_recv), const char ***, uint32_t **, uint32_t **, uint32_t **); \
+    sbus_method_async("ListServerScores", \
+        &_sbus_sss_args_sssd_DataProvider_Failover_ListServerScores, \
+        NULL, \
+        _sbus_sss_invoke_in_s_out_asauauau_send, \
+        _sbus_sss_key_s_0, \
+        (handler_send), (handler_recv), (data)); \
+})
+
 /* Method: sssd.DataProvider.Failover.ListServers */
 #define SBUS_METHOD_SYNC_sssd_DataProvider_Failover_ListServers(handler, data) ({ \
     SBUS_CHECK_SYNC((handler), (data), const char *, const char ***); \
@@ -539,23 +561,23 @@
 
 /* Method: sssd.dataprovider.getAccountInfo */
 #define SBUS_METHOD_SYNC_sssd_dataprovider_getAccountInfo(handler, data) ({ \
-    SBUS_CHECK_SYNC((handler), (data), uint32_t, uint32_t, const char *, const char *, const char *, uint16_t*, uint32_t*, const char **); \
+    SBUS_CHECK_SYNC((handler), (data), uint32_t, uint32_t, const char *, const char *, const char *, const char *, uint16_t*, uint32_t*, const char **); \
     sbus_method_sync("getAccountInfo", \
         &_sbus_sss_args_sssd_dataprovider_getAccountInfo, \
         NULL, \
-        _sbus_sss_invoke_in_uusss_out_qus_send, \
-        _sbus_sss_key_uusss_0_1_2_3_4, \
+        _sbus_sss_invoke_in_uussss_out_qus_send, \
+        _sbus_sss_key_uussss_0_1_2_3_4, \
         (handler), (data)); \
 })
 
 #define SBUS_METHOD_ASYNC_sssd_dataprovider_getAccountInfo(handler_send, handler_recv, data) ({ \
-    SBUS_CHECK_SEND((handler_send), (data), uint32_t, uint32_t, const char *, const char *, const char *); \
+    SBUS_CHECK_SEND((handler_send), (data), uint32_t, uint32_t, const char *, const char *, const char *, const char *); \
     SBUS_CHECK_RECV((handler_recv), uint16_t*, uint32_t*, const char **); \
     sbus_method_async("getAccountInfo", \
         &_sbus_sss_args_sssd_dataprovider_getAccountInfo, \
         NULL, \
-        _sbus_sss_invoke_in_uusss_out_qus_send, \
-        _sbus_sss_key_uusss_0_1_2_3_4, \
+        _sbus_sss_invoke_in_uussss_out_qus_send, \
+        _sbus_sss_key_uussss_0_1_2_3_4, \
         (handler_send), (handler_recv), (data)); \
 })
 
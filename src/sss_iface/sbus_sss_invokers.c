@@ -915,6 +915,187 @@ static void _sbus_sss_invoke_in_s_out_as_done(struct tevent_req *subreq)
     return;
 }
 
+struct _sbus_sss_invoke_in_s_out_asauauau_state {
+    struct _sbus_sss_invoker_args_s *in;
+    struct _sbus_sss_invoker_args_asauauau out;
+    struct {
+        enum sbus_handler_type type;
+        void *data;
+        errno_t (*sync)(TALLOC_CTX *, struct sbus_request *, void *, const char *, const char ***, uint32_t **, uint32_t **, uint32_t **);
+        struct tevent_req * (*send)(TALLOC_CTX *, struct tevent_context *, struct sbus_request *, void *, const char *);
+        errno_t (*recv)(TALLOC_CTX *, struct tevent_req *, const char ***, uint32_t **, uint32_t **, uint32_t **);
+    } handler;
+
+    struct sbus_request *sbus_req;
+    DBusMessageIter *read_iterator;
+    DBusMessageIter *write_iterator;
+};
+
+static void
+_sbus_sss_invoke_in_s_out_asauauau_step
+    (struct tevent_context *ev,
+     struct tevent_timer *te,
+     struct timeval tv,
+     void *private_data);
+
+static void
+_sbus_sss_invoke_in_s_out_asauauau_done
+   (struct tevent_req *subreq);
+
+struct tevent_req *
+_sbus_sss_invoke_in_s_out_asauauau_send
+   (TALLOC_CTX *mem_ctx,
+    struct tevent_context *ev,
+    struct sbus_request *sbus_req,
+    sbus_invoker_keygen keygen,
+    const struct sbus_handler *handler,
+    DBusMessageIter *read_iterator,
+    DBusMessageIter *write_iterator,
+    const char **_key)
+{
+    struct _sbus_sss_invoke_in_s_out_asauauau_state *state;
+    struct tevent_req *req;
+    const char *key;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct _sbus_sss_invoke_in_s_out_asauauau_state);
+    if (req == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create tevent request!\n");
+        return NULL;
+    }
+
+    state->handler.type = handler->type;
+    state->handler.data = handler->data;
+    state->handler.sync = handler->sync;
+    state->handler.send = handler->async_send;
+    state->handler.recv = handler->async_recv;
+
+    state->sbus_req = sbus_req;
+    state->read_iterator = read_iterator;
+    state->write_iterator = write_iterator;
+
+    state->in = talloc_zero(state, struct _sbus_sss_invoker_args_s);
+    if (state->in == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Unable to allocate space for input parameters!\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = _sbus_sss_invoker_read_s(state, read_iterator, state->in);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sbus_invoker_schedule(state, ev, _sbus_sss_invoke_in_s_out_asauauau_step, req);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sbus_request_key(state, keygen, sbus_req, state->in, &key);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    if (_key != NULL) {
+        *_key = talloc_steal(mem_ctx, key);
+    }
+
+    ret = EAGAIN;
+
+done:
+    if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+        tevent_req_post(req, ev);
+    }
+
+    return req;
+}
+
+static void _sbus_sss_invoke_in_s_out_asauauau_step
+   (struct tevent_context *ev,
+    struct tevent_timer *te,
+    struct timeval tv,
+    void *private_data)
+{
+    struct _sbus_sss_invoke_in_s_out_asauauau_state *state;
+    struct tevent_req *subreq;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = talloc_get_type(private_data, struct tevent_req);
+    state = tevent_req_data(req, struct _sbus_sss_invoke_in_s_out_asauauau_state);
+
+    switch (state->handler.type) {
+    case SBUS_HANDLER_SYNC:
+        if (state->handler.sync == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Bug: sync handler is not specified!\n");
+            ret = ERR_INTERNAL;
+            goto done;
+        }
+
+        ret = state->handler.sync(state, state->sbus_req, state->handler.data, state->in->arg0, &state->out.arg0, &state->out.arg1, &state->out.arg2, &state->out.arg3);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        ret = _sbus_sss_invoker_write_asauauau(state->write_iterator, &state->out);
+        goto done;
+    case SBUS_HANDLER_ASYNC:
+        if (state->handler.send == NULL || state->handler.recv == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Bug: async handler is not specified!\n");
+            ret = ERR_INTERNAL;
+            goto done;
+        }
+
+        subreq = state->handler.send(state, ev, state->sbus_req, state->handler.data, state->in->arg0);
+        if (subreq == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create subrequest!\n");
+            ret = ENOMEM;
+            goto done;
+        }
+
+        tevent_req_set_callback(subreq, _sbus_sss_invoke_in_s_out_asauauau_done, req);
+        ret = EAGAIN;
+        goto done;
+    }
+
+    ret = ERR_INTERNAL;
+
+done:
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+    }
+}
+
+static void _sbus_sss_invoke_in_s_out_asauauau_done(struct tevent_req *subreq)
+{
+    struct _sbus_sss_invoke_in_s_out_asauauau_state *state;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = tevent_req_callback_data(subreq, struct tevent_req);
+    state = tevent_req_data(req, struct _sbus_sss_invoke_in_s_out_asauauau_state);
+
+    ret = state->handler.recv(state, subreq, &state->out.arg0, &state->out.arg1, &state->out.arg2, &state->out.arg3);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    ret = _sbus_sss_invoker_write_asauauau(state->write_iterator, &state->out);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+    return;
+}
+
 struct _sbus_sss_invoke_in_s_out_b_state {
     struct _sbus_sss_invoker_args_s *in;
     struct _sbus_sss_invoker_args_b out;
@@ -3047,14 +3228,14 @@ static void _sbus_sss_invoke_in_uss_out_qus_done(struct tevent_req *subreq)
     return;
 }
 
-struct _sbus_sss_invoke_in_uusss_out_qus_state {
-    struct _sbus_sss_invoker_args_uusss *in;
+struct _sbus_sss_invoke_in_uussss_out_qus_state {
+    struct _sbus_sss_invoker_args_uussss *in;
     struct _sbus_sss_invoker_args_qus out;
     struct {
         enum sbus_handler_type type;
         void *data;
-        errno_t (*sync)(TALLOC_CTX *, struct sbus_request *, void *, uint32_t, uint32_t, const char *, const char *, const char *, uint16_t*, uint32_t*, const char **);
-        struct tevent_req * (*send)(TALLOC_CTX *, struct tevent_context *, struct sbus_request *, void *, uint32_t, uint32_t, const char *, const char *, const char *);
+        errno_t (*sync)(TALLOC_CTX *, struct sbus_request *, void *, uint32_t, uint32_t, const char *, const char *, const char *, const char *, uint16_t*, uint32_t*, const char **);
+        struct tevent_req * (*send)(TALLOC_CTX *, struct tevent_context *, struct sbus_request *, void *, uint32_t, uint32_t, const char *, const char *, const char *, const char *);
         errno_t (*recv)(TALLOC_CTX *, struct tevent_req *, uint16_t*, uint32_t*, const char **);
     } handler;
 
@@ -3064,18 +3245,18 @@ struct _sbus_sss_invoke_in_uusss_out_qus_state {
 };
 
 static void
-_sbus_sss_invoke_in_uusss_out_qus_step
+_sbus_sss_invoke_in_uussss_out_qus_step
     (struct tevent_context *ev,
      struct tevent_timer *te,
      struct timeval tv,
      void *private_data);
 
 static void
-_sbus_sss_invoke_in_uusss_out_qus_done
+_sbus_sss_invoke_in_uussss_out_qus_done
    (struct tevent_req *subreq);
 
 struct tevent_req *
-_sbus_sss_invoke_in_uusss_out_qus_send
+_sbus_sss_invoke_in_uussss_out_qus_send
    (TALLOC_CTX *mem_ctx,
     struct tevent_context *ev,
     struct sbus_request *sbus_req,
@@ -3085,12 +3266,12 @@ _sbus_sss_invoke_in_uusss_out_qus_send
     DBusMessageIter *write_iterator,
     const char **_key)
 {
-    struct _sbus_sss_invoke_in_uusss_out_qus_state *state;
+    struct _sbus_sss_invoke_in_uussss_out_qus_state *state;
     struct tevent_req *req;
     const char *key;
     errno_t ret;
 
-    req = tevent_req_create(mem_ctx, &state, struct _sbus_sss_invoke_in_uusss_out_qus_state);
+    req = tevent_req_create(mem_ctx, &state, struct _sbus_sss_invoke_in_uussss_out_qus_state);
     if (req == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create tevent request!\n");
         return NULL;
@@ -3106,7 +3287,7 @@ _sbus_sss_invoke_in_uusss_out_qus_send
     state->read_iterator = read_iterator;
     state->write_iterator = write_iterator;
 
-    state->in = talloc_zero(state, struct _sbus_sss_invoker_args_uusss);
+    state->in = talloc_zero(state, struct _sbus_sss_invoker_args_uussss);
     if (state->in == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "Unable to allocate space for input parameters!\n");
@@ -3114,12 +3295,12 @@ _sbus_sss_invoke_in_uusss_out_qus_send
         goto done;
     }
 
-    ret = _sbus_sss_invoker_read_uusss(state, read_iterator, state->in);
+    ret = _sbus_sss_invoker_read_uussss(state, read_iterator, state->in);
     if (ret != EOK) {
         goto done;
     }
 
-    ret = sbus_invoker_schedule(state, ev, _sbus_sss_invoke_in_uusss_out_qus_step, req);
+    ret = sbus_invoker_schedule(state, ev, _sbus_sss_invoke_in_uussss_out_qus_step, req);
     if (ret != EOK) {
         goto done;
     }
@@ -3144,19 +3325,19 @@ done:
     return req;
 }
 
-static void _sbus_sss_invoke_in_uusss_out_qus_step
+static void _sbus_sss_invoke_in_uussss_out_qus_step
    (struct tevent_context *ev,
     struct tevent_timer *te,
     struct timeval tv,
     void *private_data)
 {
-    struct _sbus_sss_invoke_in_uusss_out_qus_state *state;
+    struct _sbus_sss_invoke_in_uussss_out_qus_state *state;
     struct tevent_req *subreq;
     struct tevent_req *req;
     errno_t ret;
 
     req = talloc_get_type(private_data, struct tevent_req);
-    state = tevent_req_data(req, struct _sbus_sss_invoke_in_uusss_out_qus_state);
+    state = tevent_req_data(req, struct _sbus_sss_invoke_in_uussss_out_qus_state);
 
     switch (state->handler.type) {
     case SBUS_HANDLER_SYNC:
@@ -3166,7 +3347,7 @@ static void _sbus_sss_invoke_in_uusss_out_qus_step
             goto done;
         }
 
-        ret = state->handler.sync(state, state->sbus_req, state->handler.data, state->in->arg0, state->in->arg1, state->in->arg2, state->in->arg3, state->in->arg4, &state->out.arg0, &state->out.arg1, &state->out.arg2);
+        ret = state->handler.sync(state, state->sbus_req, state->handler.data, state->in->arg0, state->in->arg1, state->in->arg2, state->in->arg3, state->in->arg4, state->in->arg5, &state->out.arg0, &state->out.arg1, &state->out.arg2);
         if (ret != EOK) {
             goto done;
         }
@@ -3180,14 +3361,14 @@ static void _sbus_sss_invoke_in_uusss_out_qus_step
             goto done;
         }
 
-        subreq = state->handler.send(state, ev, state->sbus_req, state->handler.data, state->in->arg0, state->in->arg1, state->in->arg2, state->in->arg3, state->in->arg4);
+        subreq = state->handler.send(state, ev, state->sbus_req, state->handler.data, state->in->arg0, state->in->arg1, state->in->arg2, state->in->arg3, state->in->arg4, state->in->arg5);
         if (subreq == NULL) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Unable to create subrequest!\n");
             ret = ENOMEM;
             goto done;
         }
 
-        tevent_req_set_callback(subreq, _sbus_sss_invoke_in_uusss_out_qus_done, req);
+        tevent_req_set_callback(subreq, _sbus_sss_invoke_in_uussss_out_qus_done, req);
         ret = EAGAIN;
         goto done;
     }
@@ -3202,14 +3383,14 @@ done:
     }
 }
 
-static void _sbus_sss_invoke_in_uusss_out_qus_done(struct tevent_req *subreq)
+static void _sbus_sss_invoke_in_uussss_out_qus_done(struct tevent_req *subreq)
 {
-    struct _sbus_sss_invoke_in_uusss_out_qus_state *state;
+    struct _sbus_sss_invoke_in_uussss_out_qus_state *state;
     struct tevent_req *req;
     errno_t ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
-    state = tevent_req_data(req, struct _sbus_sss_invoke_in_uusss_out_qus_state);
+    state = tevent_req_data(req, struct _sbus_sss_invoke_in_uussss_out_qus_state);
 
     ret = state->handler.recv(state, subreq, &state->out.arg0, &state->out.arg1, &state->out.arg2);
     talloc_zfree(subreq);
@@ -44,6 +44,7 @@ _sbus_sss_declare_invoker(pam_data, pam_response);
 _sbus_sss_declare_invoker(raw, qus);
 _sbus_sss_declare_invoker(s, );
 _sbus_sss_declare_invoker(s, as);
+_sbus_sss_declare_invoker(s, asauauau);
 _sbus_sss_declare_invoker(s, b);
 _sbus_sss_declare_invoker(s, qus);
 _sbus_sss_declare_invoker(s, s);
@@ -56,6 +57,6 @@ _sbus_sss_declare_invoker(us, qus);
 _sbus_sss_declare_invoker(usq, );
 _sbus_sss_declare_invoker(uss, );
 _sbus_sss_declare_invoker(uss, qus);
-_sbus_sss_declare_invoker(uusss, qus);
+_sbus_sss_declare_invoker(uussss, qus);
 
 #endif /* _SBUS_SSS_INVOKERS_H_ */
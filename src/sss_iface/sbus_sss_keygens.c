@@ -124,10 +124,10 @@ _sbus_sss_key_uss_0_1_2
 }
 
 const char *
-_sbus_sss_key_uusss_0_1_2_3_4
+_sbus_sss_key_uussss_0_1_2_3_4
    (TALLOC_CTX *mem_ctx,
     struct sbus_request *sbus_req,
-    struct _sbus_sss_invoker_args_uusss *args)
+    struct _sbus_sss_invoker_args_uussss *args)
 {
     if (sbus_req->sender == NULL) {
         return talloc_asprintf(mem_ctx, "-:%u:%s.%s:%s:%" PRIu32 ":%" PRIu32 ":%s:%s:%s",
@@ -154,6 +154,21 @@ _sbus_sss_args_sssd_DataProvider_Failover_ActiveServer = {
     }
 };
 
+const struct sbus_method_arguments
+_sbus_sss_args_sssd_DataProvider_Failover_ListServerScores = {
+    .input = (const struct sbus_argument[]){
+        {.type = "s", .name = "service_name"},
+        {NULL}
+    },
+    .output = (const struct sbus_argument[]){
+        {.type = "as", .name = "servers"},
+        {.type = "au", .name = "rtt_usec"},
+        {.type = "au", .name = "error_permille"},
+        {.type = "au", .name = "samples"},
+        {NULL}
+    }
+};
+
 const struct sbus_method_arguments
 _sbus_sss_args_sssd_DataProvider_Failover_ListServers = {
     .input = (const struct sbus_argument[]){
@@ -266,6 +281,7 @@ _sbus_sss_args_sssd_dataprovider_getAccountInfo = {
         {.type = "s", .name = "filter"},
         {.type = "s", .name = "domain"},
         {.type = "s", .name = "extra"},
+        {.type = "s", .name = "trace_id"},
         {NULL}
     },
     .output = (const struct sbus_argument[]){
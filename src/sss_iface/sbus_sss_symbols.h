@@ -55,6 +55,9 @@ _sbus_sss_args_sssd_DataProvider_Client_Register;
 extern const struct sbus_method_arguments
 _sbus_sss_args_sssd_DataProvider_Failover_ActiveServer;
 
+extern const struct sbus_method_arguments
+_sbus_sss_args_sssd_DataProvider_Failover_ListServerScores;
+
 extern const struct sbus_method_arguments
 _sbus_sss_args_sssd_DataProvider_Failover_ListServers;
 
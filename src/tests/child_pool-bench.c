@@ -0,0 +1,262 @@
+/*
+    SSSD
+
+    Child pool benchmark
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <talloc.h>
+#include <tevent.h>
+#include <popt.h>
+#include <time.h>
+
+#include "util/util.h"
+#include "util/child_common.h"
+
+#define TEST_BIN "dummy-child"
+#define BENCH_PAYLOAD "benchmark request"
+
+#define DEFAULT_REQUESTS 200
+#define DEFAULT_PREFORK  2
+#define DEFAULT_DELAY_MS 5
+
+/* Requests are sent one after the other with a short pause in between, like
+ * logins trickling in. The pause gives the pool time to replace the child
+ * it just used. */
+struct bench_ctx {
+    struct tevent_context *ev;
+    struct sss_child_pool *pool;
+    int requests;
+    int delay_ms;
+
+    int sent;
+    double start;
+    double *latency;
+    errno_t error;
+    bool done;
+};
+
+static double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_request_done(struct tevent_req *req);
+
+static void bench_send(struct tevent_context *ev,
+                       struct tevent_timer *te,
+                       struct timeval tv,
+                       void *pvt)
+{
+    struct bench_ctx *bctx = talloc_get_type(pvt, struct bench_ctx);
+    struct tevent_req *req;
+
+    bctx->start = bench_now();
+    req = sss_child_pool_send(bctx, bctx->ev, bctx->pool,
+                              discard_const(BENCH_PAYLOAD),
+                              sizeof(BENCH_PAYLOAD));
+    if (req == NULL) {
+        bctx->error = ENOMEM;
+        bctx->done = true;
+        return;
+    }
+    tevent_req_set_callback(req, bench_request_done, bctx);
+}
+
+static void bench_request_done(struct tevent_req *req)
+{
+    struct bench_ctx *bctx = tevent_req_callback_data(req, struct bench_ctx);
+    struct tevent_timer *te;
+    uint8_t *buf;
+    ssize_t len;
+    errno_t ret;
+
+    ret = sss_child_pool_recv(req, bctx, &buf, &len, NULL);
+    talloc_free(req);
+    if (ret != EOK || len != sizeof(BENCH_PAYLOAD)) {
+        fprintf(stderr, "Request %d failed [%d]: %s\n",
+                bctx->sent, ret, sss_strerror(ret));
+        bctx->error = ret == EOK ? EIO : ret;
+        bctx->done = true;
+        return;
+    }
+    talloc_free(buf);
+
+    bctx->latency[bctx->sent] = bench_now() - bctx->start;
+    bctx->sent++;
+    if (bctx->sent == bctx->requests) {
+        bctx->done = true;
+        return;
+    }
+
+    te = tevent_add_timer(bctx->ev, bctx,
+                          tevent_timeval_current_ofs(0,
+                                                     bctx->delay_ms * 1000),
+                          bench_send, bctx);
+    if (te == NULL) {
+        bctx->error = ENOMEM;
+        bctx->done = true;
+    }
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static errno_t bench_mode(const char *label, const char *action,
+                          struct sss_child_pool_opts *opts,
+                          int requests, int delay_ms)
+{
+    struct sss_child_pool_stats stats;
+    struct bench_ctx *bctx;
+    double sum = 0;
+    errno_t ret;
+    int i;
+
+    bctx = talloc_zero(NULL, struct bench_ctx);
+    if (bctx == NULL) return ENOMEM;
+    bctx->requests = requests;
+    bctx->delay_ms = delay_ms;
+
+    bctx->latency = talloc_zero_array(bctx, double, requests);
+    bctx->ev = tevent_context_init(bctx);
+    if (bctx->latency == NULL || bctx->ev == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* Inherited by the children the pool starts */
+    setenv("TEST_CHILD_ACTION", action, 1);
+
+    ret = sss_child_pool_create(bctx, bctx->ev, opts, &bctx->pool);
+    if (ret != EOK) {
+        fprintf(stderr, "Cannot create the pool [%d]: %s\n",
+                ret, sss_strerror(ret));
+        goto done;
+    }
+
+    /* Let pre-forked children start before measuring */
+    if (tevent_add_timer(bctx->ev, bctx,
+                         tevent_timeval_current_ofs(0, 100000),
+                         bench_send, bctx) == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    while (!bctx->done) {
+        tevent_loop_once(bctx->ev);
+    }
+    ret = bctx->error;
+    if (ret != EOK) goto done;
+
+    sss_child_pool_get_stats(bctx->pool, &stats);
+
+    for (i = 0; i < requests; i++) {
+        sum += bctx->latency[i];
+    }
+    qsort(bctx->latency, requests, sizeof(double), bench_cmp);
+
+    printf("%-12s mean %8.1f us, p50 %8.1f us, p99 %8.1f us, "
+           "spawned %"PRIu64", warm %"PRIu64", cold %"PRIu64"\n",
+           label, sum * 1e6 / requests,
+           bctx->latency[requests / 2] * 1e6,
+           bctx->latency[(requests * 99) / 100] * 1e6,
+           stats.spawned, stats.warm, stats.cold);
+
+done:
+    talloc_free(bctx);
+    return ret;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int requests = DEFAULT_REQUESTS;
+    int prefork = DEFAULT_PREFORK;
+    int delay_ms = DEFAULT_DELAY_MS;
+    struct sss_child_pool_opts opts = { 0 };
+    errno_t ret;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        { "requests", 'n', POPT_ARG_INT, &requests, 0,
+          "Number of requests per mode", NULL },
+        { "prefork", 'p', POPT_ARG_INT, &prefork, 0,
+          "Number of children started ahead of time", NULL },
+        { "delay", 'w', POPT_ARG_INT, &delay_ms, 0,
+          "Pause between two requests in milliseconds", NULL },
+        POPT_TABLEEND
+    };
+
+    debug_level = SSSDBG_FATAL_FAILURE;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    if (requests <= 0 || prefork <= 0 || delay_ms < 0) {
+        fprintf(stderr, "Invalid counts\n");
+        return 1;
+    }
+
+    opts.name = TEST_BIN;
+    opts.binary = CHILD_DIR"/"TEST_BIN;
+    opts.debug_fd = -1;
+    opts.child_out_fd = 3;
+    opts.timeout = 10;
+
+    printf("requests: %d, pre-forked children: %d, pause: %d ms\n",
+           requests, prefork, delay_ms);
+
+    /* fork and exec for each request, what the children did so far */
+    opts.prefork = 0;
+    opts.max_requests = 1;
+    ret = bench_mode("fork", "echo", &opts, requests, delay_ms);
+    if (ret != EOK) return 1;
+
+    opts.prefork = prefork;
+    ret = bench_mode("pre-forked", "echo", &opts, requests, delay_ms);
+    if (ret != EOK) return 1;
+
+    opts.prefork = 1;
+    opts.max_requests = 0;
+    ret = bench_mode("persistent", "echo_framed", &opts, requests, delay_ms);
+    if (ret != EOK) return 1;
+
+    return 0;
+}
@@ -40,6 +40,7 @@ int main(int argc, const char *argv[])
     ssize_t written;
     errno_t ret;
     uint8_t buf[IN_BUF_SIZE];
+    uint32_t frame_len;
     const char *action = NULL;
     const char *guitar;
     const char *drums;
@@ -132,6 +133,38 @@ int main(int argc, const char *argv[])
                       len, written);
                 _exit(1);
             }
+        } else if (strcasecmp(action, "echo_framed") == 0) {
+            /* Persistent child: echo length-prefixed frames until EOF */
+            while (1) {
+                errno = 0;
+                len = sss_atomic_read_s(STDIN_FILENO, &frame_len,
+                                        sizeof(uint32_t));
+                if (len == 0) {
+                    break;
+                } else if (len != sizeof(uint32_t)
+                               || frame_len > IN_BUF_SIZE) {
+                    DEBUG(SSSDBG_CRIT_FAILURE, "Invalid frame header\n");
+                    _exit(1);
+                }
+
+                len = sss_atomic_read_s(STDIN_FILENO, buf, frame_len);
+                if (len != (ssize_t) frame_len) {
+                    DEBUG(SSSDBG_CRIT_FAILURE, "Short frame\n");
+                    _exit(1);
+                }
+
+                written = sss_atomic_write_s(3, &frame_len, sizeof(uint32_t));
+                if (written != sizeof(uint32_t)) {
+                    DEBUG(SSSDBG_CRIT_FAILURE, "write failed\n");
+                    _exit(1);
+                }
+
+                written = sss_atomic_write_s(3, buf, len);
+                if (written != len) {
+                    DEBUG(SSSDBG_CRIT_FAILURE, "write failed\n");
+                    _exit(1);
+                }
+            }
         }
     }
 
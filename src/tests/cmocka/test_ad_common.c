@@ -35,6 +35,8 @@
 #include "util/crypto/nss/nss_util.h"
 #endif
 #include "util/util_sss_idmap.h"
+#include "providers/ldap/sdap_async_ad.h"
+#include "providers/ldap/sdap_async_private.h"
 
 /* In order to access opaque types */
 #include "providers/ad/ad_common.c"
@@ -186,6 +188,319 @@ static void test_check_if_pac_is_available(void **state)
     talloc_free(ar);
 }
 
+#define TEST_DOM_SID "S-1-5-21-1-2-3"
+#define TEST_GROUP1 "test_group1"
+#define TEST_GROUP2 "test_group2"
+#define TEST_GROUP3 "test_group3"
+
+/* The SID lookups are answered by the tests */
+static struct {
+    int num_sends;
+    int num_freed;
+    struct tevent_req *req;
+} resolve_sids_mock;
+
+struct resolve_sids_mock_state {
+    int dummy;
+};
+
+static int resolve_sids_mock_state_destructor(struct resolve_sids_mock_state *state)
+{
+    resolve_sids_mock.num_freed++;
+    return 0;
+}
+
+struct tevent_req *
+__wrap_sdap_ad_resolve_sids_send(TALLOC_CTX *mem_ctx,
+                                 struct tevent_context *ev,
+                                 struct sdap_id_ctx *id_ctx,
+                                 struct sdap_id_conn_ctx *conn,
+                                 struct sdap_options *opts,
+                                 struct sss_domain_info *domain,
+                                 char **sids)
+{
+    struct resolve_sids_mock_state *state;
+    struct tevent_req *req;
+
+    req = tevent_req_create(mem_ctx, &state, struct resolve_sids_mock_state);
+    assert_non_null(req);
+    talloc_set_destructor(state, resolve_sids_mock_state_destructor);
+
+    resolve_sids_mock.num_sends++;
+    resolve_sids_mock.req = req;
+    return req;
+}
+
+errno_t __wrap_sdap_ad_resolve_sids_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+struct ad_pac_bg_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct ad_options *ad_options;
+    struct sdap_id_ctx *id_ctx;
+};
+
+static int test_ad_pac_bg_setup(void **state)
+{
+    struct ad_pac_bg_test_ctx *test_ctx;
+    struct sss_domain_info *dom;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct ad_pac_bg_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_dom_suite_setup(TESTS_PATH);
+
+    test_ctx->tctx = create_multidom_test_ctx(test_ctx, TESTS_PATH,
+                                              TEST_CONF_DB, domains,
+                                              TEST_ID_PROVIDER, NULL);
+    assert_non_null(test_ctx->tctx);
+    dom = test_ctx->tctx->dom;
+
+    dom->domain_id = talloc_strdup(dom, TEST_DOM_SID);
+    assert_non_null(dom->domain_id);
+
+    test_ctx->ad_options = talloc_zero(test_ctx, struct ad_options);
+    assert_non_null(test_ctx->ad_options);
+
+    test_ctx->id_ctx = talloc_zero(test_ctx, struct sdap_id_ctx);
+    assert_non_null(test_ctx->id_ctx);
+
+    ret = sysdb_add_user(dom, TEST_USER, 123, 456, NULL, NULL,
+                         NULL, NULL, NULL, 0, 0);
+    assert_int_equal(ret, EOK);
+
+    memset(&resolve_sids_mock, 0, sizeof(resolve_sids_mock));
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_ad_pac_bg_teardown(void **state)
+{
+    struct ad_pac_bg_test_ctx *test_ctx =
+        talloc_get_type(*state, struct ad_pac_bg_test_ctx);
+
+    test_multidom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, domains);
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void add_test_group(struct ad_pac_bg_test_ctx *test_ctx,
+                           const char *name, gid_t gid, const char *sid)
+{
+    struct sysdb_attrs *attrs;
+    errno_t ret;
+
+    attrs = sysdb_new_attrs(test_ctx);
+    assert_non_null(attrs);
+
+    ret = sysdb_attrs_add_string(attrs, SYSDB_SID_STR, sid);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_add_group(test_ctx->tctx->dom, name, gid, attrs, 0, 0);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(attrs);
+}
+
+static char **test_group_dns(struct ad_pac_bg_test_ctx *test_ctx,
+                             const char *name)
+{
+    char **dns;
+
+    dns = talloc_zero_array(test_ctx, char *, 2);
+    assert_non_null(dns);
+
+    if (name != NULL) {
+        dns[0] = sysdb_group_strdn(dns, test_ctx->tctx->dom->name, name);
+        assert_non_null(dns[0]);
+    }
+
+    return dns;
+}
+
+/* Stores the memberships the initgroups request writes before the
+ * resolution starts */
+static void set_user_groups(struct ad_pac_bg_test_ctx *test_ctx,
+                            char **group_dns)
+{
+    errno_t ret;
+
+    ret = sdap_ad_tokengroups_update_members(TEST_USER,
+                                             test_ctx->tctx->dom->sysdb,
+                                             test_ctx->tctx->dom,
+                                             group_dns);
+    assert_int_equal(ret, EOK);
+}
+
+static void assert_user_groups(struct ad_pac_bg_test_ctx *test_ctx,
+                               const char **expected)
+{
+    char **groups = NULL;
+    size_t num_groups;
+    size_t c;
+    errno_t ret;
+
+    ret = get_sysdb_grouplist(test_ctx, test_ctx->tctx->dom->sysdb,
+                              test_ctx->tctx->dom, TEST_USER, &groups);
+    assert_int_equal(ret, EOK);
+
+    for (num_groups = 0; groups != NULL && groups[num_groups] != NULL;
+         num_groups++);
+
+    for (c = 0; expected[c] != NULL; c++) {
+        assert_true(string_in_list(expected[c], groups, true));
+    }
+    assert_int_equal(num_groups, c);
+
+    talloc_free(groups);
+}
+
+static void start_resolution(struct ad_pac_bg_test_ctx *test_ctx,
+                             const char *missing_sid,
+                             char **cached_groups)
+{
+    const char *missing_sids[] = { missing_sid, NULL };
+    errno_t ret;
+
+    ret = ad_pac_resolve_sids_background(test_ctx->ad_options,
+                                         test_ctx->id_ctx,
+                                         test_ctx->tctx->ev,
+                                         NULL,
+                                         test_ctx->tctx->dom,
+                                         TEST_USER,
+                                         discard_const(missing_sids),
+                                         cached_groups);
+    assert_int_equal(ret, EOK);
+}
+
+static void test_ad_pac_resolve_sids_background(void **state)
+{
+    struct ad_pac_bg_test_ctx *test_ctx =
+        talloc_get_type(*state, struct ad_pac_bg_test_ctx);
+    const char *expected[] = { TEST_GROUP1, TEST_GROUP2, NULL };
+    char **cached_groups;
+
+    add_test_group(test_ctx, TEST_GROUP1, 1001, TEST_DOM_SID"-1001");
+    cached_groups = test_group_dns(test_ctx, TEST_GROUP1);
+    set_user_groups(test_ctx, cached_groups);
+
+    start_resolution(test_ctx, TEST_DOM_SID"-1002", cached_groups);
+    assert_int_equal(resolve_sids_mock.num_sends, 1);
+    assert_non_null(test_ctx->ad_options->pac_resolve_sids);
+
+    /* The lookup stores the missing group */
+    add_test_group(test_ctx, TEST_GROUP2, 1002, TEST_DOM_SID"-1002");
+    tevent_req_done(resolve_sids_mock.req);
+
+    assert_user_groups(test_ctx, expected);
+    assert_null(test_ctx->ad_options->pac_resolve_sids);
+    assert_int_equal(resolve_sids_mock.num_freed, 1);
+
+    talloc_free(cached_groups);
+}
+
+static void test_ad_pac_resolve_sids_background_dedup(void **state)
+{
+    struct ad_pac_bg_test_ctx *test_ctx =
+        talloc_get_type(*state, struct ad_pac_bg_test_ctx);
+    const char *expected[] = { TEST_GROUP1, TEST_GROUP3, NULL };
+    char **cached_groups;
+
+    add_test_group(test_ctx, TEST_GROUP1, 1001, TEST_DOM_SID"-1001");
+    cached_groups = test_group_dns(test_ctx, TEST_GROUP1);
+    set_user_groups(test_ctx, cached_groups);
+
+    start_resolution(test_ctx, TEST_DOM_SID"-1002", cached_groups);
+    assert_int_equal(resolve_sids_mock.num_sends, 1);
+
+    /* The same PAC again does not start another lookup */
+    start_resolution(test_ctx, TEST_DOM_SID"-1002", cached_groups);
+    assert_int_equal(resolve_sids_mock.num_sends, 1);
+    assert_int_equal(resolve_sids_mock.num_freed, 0);
+
+    /* A newer PAC replaces the running lookup */
+    start_resolution(test_ctx, TEST_DOM_SID"-1003", cached_groups);
+    assert_int_equal(resolve_sids_mock.num_sends, 2);
+    assert_int_equal(resolve_sids_mock.num_freed, 1);
+    assert_non_null(test_ctx->ad_options->pac_resolve_sids);
+
+    add_test_group(test_ctx, TEST_GROUP2, 1002, TEST_DOM_SID"-1002");
+    add_test_group(test_ctx, TEST_GROUP3, 1003, TEST_DOM_SID"-1003");
+    tevent_req_done(resolve_sids_mock.req);
+
+    assert_user_groups(test_ctx, expected);
+    assert_null(test_ctx->ad_options->pac_resolve_sids);
+
+    talloc_free(cached_groups);
+}
+
+static void test_ad_pac_resolve_sids_background_changed(void **state)
+{
+    struct ad_pac_bg_test_ctx *test_ctx =
+        talloc_get_type(*state, struct ad_pac_bg_test_ctx);
+    const char *expected[] = { TEST_GROUP3, NULL };
+    char **cached_groups;
+    char **newer_groups;
+
+    add_test_group(test_ctx, TEST_GROUP1, 1001, TEST_DOM_SID"-1001");
+    add_test_group(test_ctx, TEST_GROUP3, 1003, TEST_DOM_SID"-1003");
+    cached_groups = test_group_dns(test_ctx, TEST_GROUP1);
+    set_user_groups(test_ctx, cached_groups);
+
+    start_resolution(test_ctx, TEST_DOM_SID"-1002", cached_groups);
+    assert_int_equal(resolve_sids_mock.num_sends, 1);
+
+    /* Another lookup stores newer memberships meanwhile */
+    newer_groups = test_group_dns(test_ctx, TEST_GROUP3);
+    set_user_groups(test_ctx, newer_groups);
+
+    add_test_group(test_ctx, TEST_GROUP2, 1002, TEST_DOM_SID"-1002");
+    tevent_req_done(resolve_sids_mock.req);
+
+    /* The result of the older PAC is dropped */
+    assert_user_groups(test_ctx, expected);
+    assert_null(test_ctx->ad_options->pac_resolve_sids);
+
+    talloc_free(cached_groups);
+    talloc_free(newer_groups);
+}
+
+static void test_ad_pac_resolve_sids_background_error(void **state)
+{
+    struct ad_pac_bg_test_ctx *test_ctx =
+        talloc_get_type(*state, struct ad_pac_bg_test_ctx);
+    const char *expected[] = { TEST_GROUP1, NULL };
+    char **cached_groups;
+
+    add_test_group(test_ctx, TEST_GROUP1, 1001, TEST_DOM_SID"-1001");
+    cached_groups = test_group_dns(test_ctx, TEST_GROUP1);
+    set_user_groups(test_ctx, cached_groups);
+
+    start_resolution(test_ctx, TEST_DOM_SID"-1002", cached_groups);
+    tevent_req_error(resolve_sids_mock.req, EIO);
+
+    assert_user_groups(test_ctx, expected);
+    assert_null(test_ctx->ad_options->pac_resolve_sids);
+
+    /* The next lookup of the user tries again */
+    start_resolution(test_ctx, TEST_DOM_SID"-1002", cached_groups);
+    assert_int_equal(resolve_sids_mock.num_sends, 2);
+
+    talloc_free(test_ctx->ad_options->pac_resolve_sids);
+    assert_null(test_ctx->ad_options->pac_resolve_sids);
+
+    talloc_free(cached_groups);
+}
+
 #define TEST_PAC_BASE64 \
     "BQAAAAAAAAABAAAA6AEAAFgAAAAAAAAACgAAABAAAABAAgAAAA" \
     "AAAAwAAAA4AAAAUAIAAAAAAAAGAAAAFAAAAIgCAAAAAAAABwAA" \
@@ -996,6 +1311,18 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_check_if_pac_is_available,
                                         test_ad_sysdb_setup,
                                         test_ad_sysdb_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_pac_resolve_sids_background,
+                                        test_ad_pac_bg_setup,
+                                        test_ad_pac_bg_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_pac_resolve_sids_background_dedup,
+                                        test_ad_pac_bg_setup,
+                                        test_ad_pac_bg_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_pac_resolve_sids_background_changed,
+                                        test_ad_pac_bg_setup,
+                                        test_ad_pac_bg_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_pac_resolve_sids_background_error,
+                                        test_ad_pac_bg_setup,
+                                        test_ad_pac_bg_teardown),
         cmocka_unit_test_setup_teardown(test_ad_get_data_from_pac,
                                         test_ad_common_setup,
                                         test_ad_common_teardown),
@@ -0,0 +1,615 @@
+/*
+    Copyright (C) 2026 Red Hat
+
+    SSSD tests - applying DirSync changes to the cache
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "providers/ad/ad_opts.h"
+
+/* In order to access the static functions */
+#include "providers/ad/ad_dirsync.c"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_ad_dirsync_conf.ldb"
+#define TEST_DOM_NAME "ad_dirsync_test"
+#define TEST_ID_PROVIDER "ad"
+
+/* The changes are read from the whole naming context, only objects below
+ * cn=users are in the search bases */
+#define TEST_BASE_DN "dc=ad,dc=test"
+#define TEST_SEARCH_BASE "cn=users," TEST_BASE_DN
+#define TEST_OTHER_BASE "ou=other," TEST_BASE_DN
+#define TEST_DELETED_BASE "cn=Deleted Objects," TEST_BASE_DN
+
+struct ad_dirsync_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct sdap_options *opts;
+    struct sdap_domain *sdom;
+    struct ad_dirsync_enum_state *state;
+};
+
+static int ad_dirsync_test_setup(void **state)
+{
+    struct ad_dirsync_test_ctx *test_ctx;
+    struct sdap_search_base **bases;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct ad_dirsync_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME, TEST_ID_PROVIDER,
+                                         NULL);
+    assert_non_null(test_ctx->tctx);
+
+    test_ctx->opts = talloc_zero(test_ctx, struct sdap_options);
+    assert_non_null(test_ctx->opts);
+
+    ret = sdap_copy_map(test_ctx->opts, ad_2008r2_user_map, SDAP_OPTS_USER,
+                        &test_ctx->opts->user_map);
+    assert_int_equal(ret, EOK);
+    test_ctx->opts->user_map_cnt = SDAP_OPTS_USER;
+
+    ret = sdap_copy_map(test_ctx->opts, ad_2008r2_group_map, SDAP_OPTS_GROUP,
+                        &test_ctx->opts->group_map);
+    assert_int_equal(ret, EOK);
+
+    test_ctx->sdom = talloc_zero(test_ctx, struct sdap_domain);
+    assert_non_null(test_ctx->sdom);
+    test_ctx->sdom->dom = test_ctx->tctx->dom;
+    test_ctx->sdom->basedn = talloc_strdup(test_ctx->sdom, TEST_BASE_DN);
+    assert_non_null(test_ctx->sdom->basedn);
+
+    bases = talloc_zero_array(test_ctx->sdom, struct sdap_search_base *, 2);
+    assert_non_null(bases);
+    ret = sdap_create_search_base(bases, TEST_SEARCH_BASE,
+                                  LDAP_SCOPE_SUBTREE, NULL, &bases[0]);
+    assert_int_equal(ret, EOK);
+    test_ctx->sdom->user_search_bases = bases;
+    test_ctx->sdom->group_search_bases = bases;
+
+    test_ctx->state = talloc_zero(test_ctx, struct ad_dirsync_enum_state);
+    assert_non_null(test_ctx->state);
+    test_ctx->state->opts = test_ctx->opts;
+    test_ctx->state->sdom = test_ctx->sdom;
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int ad_dirsync_test_teardown(void **state)
+{
+    struct ad_dirsync_test_ctx *test_ctx =
+        talloc_get_type(*state, struct ad_dirsync_test_ctx);
+
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void test_guid(uint8_t num, struct ldb_val *val, char *guid_str)
+{
+    static uint8_t blobs[UINT8_MAX + 1][GUID_BIN_LENGTH];
+    errno_t ret;
+
+    memset(blobs[num], 0, GUID_BIN_LENGTH);
+    blobs[num][GUID_BIN_LENGTH - 1] = num;
+
+    val->data = blobs[num];
+    val->length = GUID_BIN_LENGTH;
+
+    ret = guid_blob_to_string_buf(val->data, guid_str, GUID_STR_BUF_SIZE);
+    assert_int_equal(ret, EOK);
+}
+
+static const char *test_fqname(struct ad_dirsync_test_ctx *test_ctx,
+                               const char *name)
+{
+    char *fqname;
+
+    fqname = sss_create_internal_fqname(test_ctx, name,
+                                        test_ctx->tctx->dom->name);
+    assert_non_null(fqname);
+
+    return fqname;
+}
+
+static const char *test_dn(struct ad_dirsync_test_ctx *test_ctx,
+                           const char *name, const char *base)
+{
+    char *dn;
+
+    dn = talloc_asprintf(test_ctx, "cn=%s,%s", name, base);
+    assert_non_null(dn);
+
+    return dn;
+}
+
+static void store_user(struct ad_dirsync_test_ctx *test_ctx,
+                       const char *name, uid_t uid, uint8_t guid)
+{
+    char guid_str[GUID_STR_BUF_SIZE];
+    struct sysdb_attrs *attrs;
+    struct ldb_val val;
+    errno_t ret;
+
+    test_guid(guid, &val, guid_str);
+
+    attrs = sysdb_new_attrs(test_ctx);
+    assert_non_null(attrs);
+    ret = sysdb_attrs_add_string(attrs, SYSDB_UUID, guid_str);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_store_user(test_ctx->tctx->dom, test_fqname(test_ctx, name),
+                           NULL, uid, uid, NULL, NULL, NULL,
+                           test_dn(test_ctx, name, TEST_SEARCH_BASE),
+                           attrs, NULL, 0, 0);
+    assert_int_equal(ret, EOK);
+    talloc_free(attrs);
+}
+
+static void store_group(struct ad_dirsync_test_ctx *test_ctx,
+                        const char *name, gid_t gid, uint8_t guid)
+{
+    char guid_str[GUID_STR_BUF_SIZE];
+    struct sysdb_attrs *attrs;
+    struct ldb_val val;
+    errno_t ret;
+
+    test_guid(guid, &val, guid_str);
+
+    attrs = sysdb_new_attrs(test_ctx);
+    assert_non_null(attrs);
+    ret = sysdb_attrs_add_string(attrs, SYSDB_UUID, guid_str);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(attrs, SYSDB_ORIG_DN,
+                                 test_dn(test_ctx, name, TEST_SEARCH_BASE));
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_store_group(test_ctx->tctx->dom, test_fqname(test_ctx, name),
+                            gid, attrs, 0, 0);
+    assert_int_equal(ret, EOK);
+    talloc_free(attrs);
+}
+
+static void add_group_member(struct ad_dirsync_test_ctx *test_ctx,
+                             const char *group, const char *user)
+{
+    errno_t ret;
+
+    ret = sysdb_add_group_member(test_ctx->tctx->dom,
+                                 test_fqname(test_ctx, group),
+                                 test_fqname(test_ctx, user),
+                                 SYSDB_MEMBER_USER, false);
+    assert_int_equal(ret, EOK);
+}
+
+/* A change as sdap_dirsync_search_send() returns it */
+static struct sdap_dirsync_entry *
+new_change(struct ad_dirsync_test_ctx *test_ctx, const char *dn, uint8_t guid)
+{
+    char guid_str[GUID_STR_BUF_SIZE];
+    struct sdap_dirsync_entry *entry;
+    struct ldb_val val;
+    errno_t ret;
+
+    entry = talloc_zero(test_ctx, struct sdap_dirsync_entry);
+    assert_non_null(entry);
+    entry->attrs = sysdb_new_attrs(entry);
+    entry->added = sysdb_new_attrs(entry);
+    entry->removed = sysdb_new_attrs(entry);
+    assert_non_null(entry->attrs);
+    assert_non_null(entry->added);
+    assert_non_null(entry->removed);
+
+    ret = sysdb_attrs_add_string(entry->attrs, SYSDB_ORIG_DN, dn);
+    assert_int_equal(ret, EOK);
+
+    test_guid(guid, &val, guid_str);
+    ret = sysdb_attrs_add_val(entry->attrs,
+                    test_ctx->opts->user_map[SDAP_AT_USER_UUID].name, &val);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_attrs_add_string(entry->attrs, AD_DIRSYNC_ATTR_INSTANCE_TYPE,
+                                 "4");
+    assert_int_equal(ret, EOK);
+
+    return entry;
+}
+
+static void change_add_string(struct sysdb_attrs *attrs,
+                              const char *name, const char *value)
+{
+    errno_t ret;
+
+    ret = sysdb_attrs_add_string(attrs, name, value);
+    assert_int_equal(ret, EOK);
+}
+
+static void add_change(struct ad_dirsync_test_ctx *test_ctx,
+                       struct sdap_dirsync_entry *entry)
+{
+    errno_t ret;
+
+    ret = ad_dirsync_add_changes(test_ctx->state, &entry, 1);
+    assert_int_equal(ret, EOK);
+}
+
+static struct ldb_dn *group_sysdb_dn(struct ad_dirsync_test_ctx *test_ctx,
+                                     const char *name)
+{
+    struct ldb_dn *dn;
+
+    dn = sysdb_group_dn(test_ctx, test_ctx->tctx->dom,
+                        test_fqname(test_ctx, name));
+    assert_non_null(dn);
+
+    return dn;
+}
+
+static void assert_group_members(struct ad_dirsync_test_ctx *test_ctx,
+                                 const char *group, const char **users)
+{
+    const char *attrs[] = { SYSDB_MEMBER, NULL };
+    struct ldb_message_element *el;
+    struct ldb_message *msg;
+    char *user_dn;
+    size_t num_members = 0;
+    size_t i;
+    size_t j;
+    errno_t ret;
+
+    ret = sysdb_search_group_by_name(test_ctx, test_ctx->tctx->dom,
+                                     test_fqname(test_ctx, group),
+                                     attrs, &msg);
+    assert_int_equal(ret, EOK);
+
+    el = ldb_msg_find_element(msg, SYSDB_MEMBER);
+    if (el != NULL) {
+        num_members = el->num_values;
+    }
+
+    for (i = 0; users[i] != NULL; i++) {
+        user_dn = sysdb_user_strdn(test_ctx, test_ctx->tctx->dom->name,
+                                   test_fqname(test_ctx, users[i]));
+        assert_non_null(user_dn);
+
+        assert_non_null(el);
+        for (j = 0; j < el->num_values; j++) {
+            if (strcasecmp((const char *) el->values[j].data, user_dn) == 0) {
+                break;
+            }
+        }
+        if (j == el->num_values) {
+            fail_msg("[%s] is not a member of [%s]", users[i], group);
+        }
+    }
+    assert_int_equal(num_members, i);
+
+    talloc_free(msg);
+}
+
+static void assert_user_cached(struct ad_dirsync_test_ctx *test_ctx,
+                               const char *name, bool cached)
+{
+    struct ldb_message *msg;
+    errno_t ret;
+
+    ret = sysdb_search_user_by_name(test_ctx, test_ctx->tctx->dom,
+                                    test_fqname(test_ctx, name), NULL, &msg);
+    assert_int_equal(ret, cached ? EOK : ENOENT);
+    if (ret == EOK) {
+        talloc_free(msg);
+    }
+}
+
+static void assert_group_cached(struct ad_dirsync_test_ctx *test_ctx,
+                                const char *name, bool cached)
+{
+    struct ldb_message *msg;
+    errno_t ret;
+
+    ret = sysdb_search_group_by_name(test_ctx, test_ctx->tctx->dom,
+                                     test_fqname(test_ctx, name), NULL, &msg);
+    assert_int_equal(ret, cached ? EOK : ENOENT);
+    if (ret == EOK) {
+        talloc_free(msg);
+    }
+}
+
+/* member;range=1-1 and member;range=0-0 values are applied without re-reading
+ * the group */
+static void test_patch_members(void **state)
+{
+    struct ad_dirsync_test_ctx *test_ctx =
+        talloc_get_type(*state, struct ad_dirsync_test_ctx);
+    const char *member_attr =
+                    test_ctx->opts->group_map[SDAP_AT_GROUP_MEMBER].name;
+    const char *expected[] = { "user2", "user3", NULL };
+    struct sdap_dirsync_entry *entry;
+    errno_t ret;
+
+    store_user(test_ctx, "user1", 10001, 1);
+    store_user(test_ctx, "user2", 10002, 2);
+    store_user(test_ctx, "user3", 10003, 3);
+    store_group(test_ctx, "group1", 20001, 11);
+    add_group_member(test_ctx, "group1", "user1");
+
+    entry = new_change(test_ctx, test_dn(test_ctx, "group1", TEST_SEARCH_BASE),
+                       11);
+    change_add_string(entry->added, member_attr,
+                      test_dn(test_ctx, "user2", TEST_SEARCH_BASE));
+    change_add_string(entry->added, member_attr,
+                      test_dn(test_ctx, "user3", TEST_SEARCH_BASE));
+    change_add_string(entry->removed, member_attr,
+                      test_dn(test_ctx, "user1", TEST_SEARCH_BASE));
+    /* Removing a member that is not cached is not an error */
+    change_add_string(entry->removed, member_attr,
+                      test_dn(test_ctx, "unknown", TEST_SEARCH_BASE));
+
+    ret = ad_dirsync_patch_members(test_ctx->tctx->dom,
+                                   group_sysdb_dn(test_ctx, "group1"),
+                                   test_ctx->opts, entry);
+    assert_int_equal(ret, EOK);
+
+    assert_group_members(test_ctx, "group1", expected);
+}
+
+static void test_patch_members_uncached(void **state)
+{
+    struct ad_dirsync_test_ctx *test_ctx =
+        talloc_get_type(*state, struct ad_dirsync_test_ctx);
+    const char *member_attr =
+                    test_ctx->opts->group_map[SDAP_AT_GROUP_MEMBER].name;
+    const char *expected[] = { "user1", NULL };
+    struct sdap_dirsync_entry *entry;
+    errno_t ret;
+
+    store_user(test_ctx, "user1", 10001, 1);
+    store_user(test_ctx, "user2", 10002, 2);
+    store_group(test_ctx, "group1", 20001, 11);
+    add_group_member(test_ctx, "group1", "user1");
+
+    entry = new_change(test_ctx, test_dn(test_ctx, "group1", TEST_SEARCH_BASE),
+                       11);
+    change_add_string(entry->added, member_attr,
+                      test_dn(test_ctx, "user2", TEST_SEARCH_BASE));
+    change_add_string(entry->added, member_attr,
+                      test_dn(test_ctx, "unknown", TEST_SEARCH_BASE));
+    change_add_string(entry->removed, member_attr,
+                      test_dn(test_ctx, "user1", TEST_SEARCH_BASE));
+
+    /* The group must be re-read and is left untouched */
+    ret = ad_dirsync_patch_members(test_ctx->tctx->dom,
+                                   group_sysdb_dn(test_ctx, "group1"),
+                                   test_ctx->opts, entry);
+    assert_int_equal(ret, EAGAIN);
+
+    assert_group_members(test_ctx, "group1", expected);
+}
+
+static void test_apply_changes_deleted(void **state)
+{
+    struct ad_dirsync_test_ctx *test_ctx =
+        talloc_get_type(*state, struct ad_dirsync_test_ctx);
+    struct sdap_dirsync_entry *entry;
+    errno_t ret;
+
+    store_user(test_ctx, "user1", 10001, 1);
+    store_user(test_ctx, "user2", 10002, 2);
+    store_group(test_ctx, "group1", 20001, 11);
+
+    /* Deleted objects are moved out of the search bases by the server */
+    entry = new_change(test_ctx,
+                       test_dn(test_ctx, "user1\\0ADEL:1", TEST_DELETED_BASE),
+                       1);
+    change_add_string(entry->attrs, AD_DIRSYNC_ATTR_IS_DELETED, "TRUE");
+    add_change(test_ctx, entry);
+
+    entry = new_change(test_ctx,
+                       test_dn(test_ctx, "group1\\0ADEL:11", TEST_DELETED_BASE),
+                       11);
+    change_add_string(entry->attrs, AD_DIRSYNC_ATTR_IS_DELETED, "TRUE");
+    add_change(test_ctx, entry);
+
+    /* An object which was never cached */
+    entry = new_change(test_ctx,
+                       test_dn(test_ctx, "user9\\0ADEL:9", TEST_DELETED_BASE),
+                       9);
+    change_add_string(entry->attrs, AD_DIRSYNC_ATTR_IS_DELETED, "TRUE");
+    add_change(test_ctx, entry);
+
+    ret = ad_dirsync_apply_changes(test_ctx->state);
+    assert_int_equal(ret, EOK);
+
+    assert_user_cached(test_ctx, "user1", false);
+    assert_user_cached(test_ctx, "user2", true);
+    assert_group_cached(test_ctx, "group1", false);
+    assert_int_equal(test_ctx->state->num_changes, 0);
+    assert_int_equal(test_ctx->state->num_user_guids, 0);
+    assert_int_equal(test_ctx->state->num_group_guids, 0);
+}
+
+static void test_apply_changes_members(void **state)
+{
+    struct ad_dirsync_test_ctx *test_ctx =
+        talloc_get_type(*state, struct ad_dirsync_test_ctx);
+    const char *member_attr =
+                    test_ctx->opts->group_map[SDAP_AT_GROUP_MEMBER].name;
+    const char *expected1[] = { "user2", NULL };
+    const char *expected2[] = { "user1", NULL };
+    struct sdap_dirsync_entry *entry;
+    errno_t ret;
+
+    store_user(test_ctx, "user1", 10001, 1);
+    store_user(test_ctx, "user2", 10002, 2);
+    store_group(test_ctx, "group1", 20001, 11);
+    store_group(test_ctx, "group2", 20002, 12);
+    add_group_member(test_ctx, "group1", "user1");
+    add_group_member(test_ctx, "group2", "user1");
+
+    /* Only members changed and all of them are cached */
+    entry = new_change(test_ctx, test_dn(test_ctx, "group1", TEST_SEARCH_BASE),
+                       11);
+    change_add_string(entry->added, member_attr,
+                      test_dn(test_ctx, "user2", TEST_SEARCH_BASE));
+    change_add_string(entry->removed, member_attr,
+                      test_dn(test_ctx, "user1", TEST_SEARCH_BASE));
+    add_change(test_ctx, entry);
+
+    /* A new member is not cached yet */
+    entry = new_change(test_ctx, test_dn(test_ctx, "group2", TEST_SEARCH_BASE),
+                       12);
+    change_add_string(entry->added, member_attr,
+                      test_dn(test_ctx, "user9", TEST_SEARCH_BASE));
+    add_change(test_ctx, entry);
+
+    /* The user itself changed */
+    entry = new_change(test_ctx, test_dn(test_ctx, "user2", TEST_SEARCH_BASE),
+                       2);
+    change_add_string(entry->attrs,
+                      test_ctx->opts->user_map[SDAP_AT_USER_GECOS].name,
+                      "User Two");
+    add_change(test_ctx, entry);
+
+    ret = ad_dirsync_apply_changes(test_ctx->state);
+    assert_int_equal(ret, EOK);
+
+    assert_group_members(test_ctx, "group1", expected1);
+    assert_group_members(test_ctx, "group2", expected2);
+
+    assert_int_equal(test_ctx->state->num_group_guids, 1);
+    assert_string_equal(test_ctx->state->group_guids[0],
+                        "\\00\\00\\00\\00\\00\\00\\00\\00"
+                        "\\00\\00\\00\\00\\00\\00\\00\\0c");
+    assert_int_equal(test_ctx->state->num_user_guids, 1);
+    assert_string_equal(test_ctx->state->user_guids[0],
+                        "\\00\\00\\00\\00\\00\\00\\00\\00"
+                        "\\00\\00\\00\\00\\00\\00\\00\\02");
+}
+
+static void test_apply_changes_search_bases(void **state)
+{
+    struct ad_dirsync_test_ctx *test_ctx =
+        talloc_get_type(*state, struct ad_dirsync_test_ctx);
+    const char *user_oc = test_ctx->opts->user_map[SDAP_OC_USER].name;
+    struct sdap_dirsync_entry *entry;
+    errno_t ret;
+
+    store_user(test_ctx, "user1", 10001, 1);
+
+    /* A cached user was moved out of the search bases */
+    entry = new_change(test_ctx, test_dn(test_ctx, "user1", TEST_OTHER_BASE),
+                       1);
+    change_add_string(entry->attrs, AD_DIRSYNC_ATTR_PARENT_GUID, "parent");
+    add_change(test_ctx, entry);
+
+    /* A new user outside of the search bases */
+    entry = new_change(test_ctx, test_dn(test_ctx, "user2", TEST_OTHER_BASE),
+                       2);
+    change_add_string(entry->attrs, SYSDB_OBJECTCLASS, "top");
+    change_add_string(entry->attrs, SYSDB_OBJECTCLASS, user_oc);
+    add_change(test_ctx, entry);
+
+    /* A new user inside of the search bases */
+    entry = new_change(test_ctx, test_dn(test_ctx, "user3", TEST_SEARCH_BASE),
+                       3);
+    change_add_string(entry->attrs, SYSDB_OBJECTCLASS, "top");
+    change_add_string(entry->attrs, SYSDB_OBJECTCLASS, user_oc);
+    add_change(test_ctx, entry);
+
+    ret = ad_dirsync_apply_changes(test_ctx->state);
+    assert_int_equal(ret, EOK);
+
+    assert_user_cached(test_ctx, "user1", false);
+    assert_int_equal(test_ctx->state->num_group_guids, 0);
+    assert_int_equal(test_ctx->state->num_user_guids, 1);
+    assert_string_equal(test_ctx->state->user_guids[0],
+                        "\\00\\00\\00\\00\\00\\00\\00\\00"
+                        "\\00\\00\\00\\00\\00\\00\\00\\03");
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    int no_cleanup = 0;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        {"no-cleanup", 'n', POPT_ARG_NONE, &no_cleanup, 0,
+         _("Do not delete the test database after a test run"), NULL },
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_patch_members,
+                                        ad_dirsync_test_setup,
+                                        ad_dirsync_test_teardown),
+        cmocka_unit_test_setup_teardown(test_patch_members_uncached,
+                                        ad_dirsync_test_setup,
+                                        ad_dirsync_test_teardown),
+        cmocka_unit_test_setup_teardown(test_apply_changes_deleted,
+                                        ad_dirsync_test_setup,
+                                        ad_dirsync_test_teardown),
+        cmocka_unit_test_setup_teardown(test_apply_changes_members,
+                                        ad_dirsync_test_setup,
+                                        ad_dirsync_test_teardown),
+        cmocka_unit_test_setup_teardown(test_apply_changes_search_bases,
+                                        ad_dirsync_test_setup,
+                                        ad_dirsync_test_teardown),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old DB to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    test_dom_suite_setup(TESTS_PATH);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    if (rv == 0 && !no_cleanup) {
+        test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    }
+    return rv;
+}
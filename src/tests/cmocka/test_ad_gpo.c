@@ -329,6 +329,78 @@ void test_ad_gpo_ace_includes_client_sid_false(void **state)
                                         ace_dom_sid, false);
 }
 
+void test_ad_gpo_decision_key(void **state)
+{
+    const char *user_sid = "S-1-5-21-1175337206-4250576914-2321192831-1103";
+    const char *group_sids1[] = {"S-1-5-21-2-3-5",
+                                 "S-1-5-11",
+                                 "S-1-5-21-2-3-4"};
+    const char *group_sids2[] = {"S-1-5-21-2-3-4",
+                                 "S-1-5-21-2-3-5",
+                                 "S-1-5-11",
+                                 "S-1-5-21-2-3-4"};
+    char *key1;
+    char *key2;
+    char *key3;
+
+    key1 = ad_gpo_decision_key(test_ctx, GPO_MAP_INTERACTIVE, user_sid,
+                               group_sids1, 3);
+    assert_non_null(key1);
+    key2 = ad_gpo_decision_key(test_ctx, GPO_MAP_INTERACTIVE, user_sid,
+                               group_sids2, 4);
+    assert_non_null(key2);
+    key3 = ad_gpo_decision_key(test_ctx, GPO_MAP_REMOTE_INTERACTIVE,
+                               user_sid, group_sids1, 3);
+    assert_non_null(key3);
+
+    /* the order of the groups does not matter, the logon right does */
+    assert_string_equal(key1, key2);
+    assert_string_not_equal(key1, key3);
+}
+
+void test_ad_gpo_decision_cache(void **state)
+{
+    struct ad_gpo_decision_cache *cache;
+    struct ad_gpo_decision *decision;
+    uint32_t generation;
+    errno_t ret;
+
+    cache = talloc_zero(test_ctx, struct ad_gpo_decision_cache);
+    assert_non_null(cache);
+    cache->timeout = 60;
+    cache->decisions = sss_ptr_hash_create(cache, NULL, NULL);
+    assert_non_null(cache->decisions);
+
+    ret = ad_gpo_decision_cache_set_policy(cache, "cn=gpo1:3:0;");
+    assert_int_equal(ret, EOK);
+    generation = cache->generation;
+
+    ad_gpo_decision_cache_add(cache, "0:S-1-5-21-1", generation,
+                              ERR_ACCESS_DENIED);
+    decision = sss_ptr_hash_lookup(cache->decisions, "0:S-1-5-21-1",
+                                   struct ad_gpo_decision);
+    assert_non_null(decision);
+    assert_int_equal(decision->result, ERR_ACCESS_DENIED);
+
+    /* the same policies keep the decisions */
+    ret = ad_gpo_decision_cache_set_policy(cache, "cn=gpo1:3:0;");
+    assert_int_equal(ret, EOK);
+    assert_int_equal(cache->generation, generation);
+    assert_true(sss_ptr_hash_has_key(cache->decisions, "0:S-1-5-21-1"));
+
+    /* a new GPO version drops them */
+    ret = ad_gpo_decision_cache_set_policy(cache, "cn=gpo1:4:0;");
+    assert_int_equal(ret, EOK);
+    assert_int_not_equal(cache->generation, generation);
+    assert_false(sss_ptr_hash_has_key(cache->decisions, "0:S-1-5-21-1"));
+
+    /* decisions computed from the old policies are not stored */
+    ad_gpo_decision_cache_add(cache, "0:S-1-5-21-1", generation, EOK);
+    assert_false(sss_ptr_hash_has_key(cache->decisions, "0:S-1-5-21-1"));
+
+    talloc_free(cache);
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -364,6 +436,12 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_ad_gpo_ace_includes_client_sid_false,
                                         ad_gpo_test_setup,
                                         ad_gpo_test_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_gpo_decision_key,
+                                        ad_gpo_test_setup,
+                                        ad_gpo_test_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_gpo_decision_cache,
+                                        ad_gpo_test_setup,
+                                        ad_gpo_test_teardown),
     };
 
     /* Set debug level to invalid value so we can decide if -d 0 was used. */
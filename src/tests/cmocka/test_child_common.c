@@ -500,6 +500,236 @@ void sss_child_cb(int pid, int wait_status, void *pvt)
     child_ctx->test_ctx->done = true;
 }
 
+struct pool_test_req {
+    struct child_test_ctx *child_tctx;
+    const char *input;
+    errno_t ret;
+    bool cold;
+    int *pending;
+};
+
+static void pool_test_done(struct tevent_req *req)
+{
+    struct pool_test_req *ptr = tevent_req_callback_data(req,
+                                                         struct pool_test_req);
+    uint8_t *buf;
+    ssize_t len;
+
+    ptr->ret = sss_child_pool_recv(req, ptr, &buf, &len, &ptr->cold);
+    talloc_free(req);
+    if (ptr->ret == EOK) {
+        assert_int_equal(len, strlen(ptr->input) + 1);
+        assert_string_equal(buf, ptr->input);
+    }
+
+    (*ptr->pending)--;
+    if (*ptr->pending == 0) {
+        ptr->child_tctx->test_ctx->done = true;
+    }
+}
+
+static struct pool_test_req *pool_test_send(struct child_test_ctx *child_tctx,
+                                            struct sss_child_pool *pool,
+                                            const char *input,
+                                            int *pending)
+{
+    struct pool_test_req *ptr;
+    struct tevent_req *req;
+
+    ptr = talloc_zero(child_tctx, struct pool_test_req);
+    assert_non_null(ptr);
+    ptr->child_tctx = child_tctx;
+    ptr->input = input;
+    ptr->pending = pending;
+
+    req = sss_child_pool_send(child_tctx, child_tctx->test_ctx->ev, pool,
+                              discard_const(input), strlen(input) + 1);
+    assert_non_null(req);
+    tevent_req_set_callback(req, pool_test_done, ptr);
+    (*pending)++;
+
+    return ptr;
+}
+
+static void pool_test_run(struct child_test_ctx *child_tctx,
+                          struct sss_child_pool *pool,
+                          const char *input,
+                          bool expect_cold)
+{
+    struct pool_test_req *ptr;
+    int pending = 0;
+    errno_t ret;
+
+    child_tctx->test_ctx->done = false;
+    ptr = pool_test_send(child_tctx, pool, input, &pending);
+
+    ret = test_ev_loop(child_tctx->test_ctx);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(ptr->ret, EOK);
+    assert_int_equal(ptr->cold, expect_cold);
+    talloc_free(ptr);
+}
+
+static void pool_test_opts(struct sss_child_pool_opts *opts)
+{
+    memset(opts, 0, sizeof(*opts));
+    opts->name = "dummy-child";
+    opts->binary = CHILD_DIR"/"TEST_BIN;
+    opts->debug_fd = -1;
+    opts->child_out_fd = 3;
+    opts->timeout = 10;
+}
+
+/* A child started ahead of time serves the next request */
+void test_child_pool_prefork(void **state)
+{
+    struct child_test_ctx *child_tctx = talloc_get_type(*state,
+                                                        struct child_test_ctx);
+    struct sss_child_pool_opts opts;
+    struct sss_child_pool_stats stats;
+    struct sss_child_pool *pool;
+    errno_t ret;
+
+    setenv("TEST_CHILD_ACTION", "echo", 1);
+
+    pool_test_opts(&opts);
+    opts.prefork = 1;
+    opts.max_requests = 1;
+
+    ret = sss_child_pool_create(child_tctx, child_tctx->test_ctx->ev,
+                                &opts, &pool);
+    assert_int_equal(ret, EOK);
+
+    /* The first request is faster than the pre-forked child */
+    pool_test_run(child_tctx, pool, ECHO_STR, true);
+    pool_test_run(child_tctx, pool, ECHO_STR" again", false);
+
+    sss_child_pool_get_stats(pool, &stats);
+    assert_int_equal(stats.cold, 1);
+    assert_int_equal(stats.warm, 1);
+    assert_int_equal(stats.died, 0);
+
+    talloc_free(pool);
+}
+
+/* A persistent child serves max_requests requests and is replaced */
+void test_child_pool_persistent(void **state)
+{
+    struct child_test_ctx *child_tctx = talloc_get_type(*state,
+                                                        struct child_test_ctx);
+    struct sss_child_pool_opts opts;
+    struct sss_child_pool_stats stats;
+    struct sss_child_pool *pool;
+    errno_t ret;
+
+    setenv("TEST_CHILD_ACTION", "echo_framed", 1);
+
+    pool_test_opts(&opts);
+    opts.max_running = 1;
+    opts.max_requests = 2;
+
+    ret = sss_child_pool_create(child_tctx, child_tctx->test_ctx->ev,
+                                &opts, &pool);
+    assert_int_equal(ret, EOK);
+
+    pool_test_run(child_tctx, pool, "one", true);
+    pool_test_run(child_tctx, pool, "two", false);
+    pool_test_run(child_tctx, pool, "three", true);
+
+    sss_child_pool_get_stats(pool, &stats);
+    assert_int_equal(stats.spawned, 2);
+    assert_int_equal(stats.recycled, 1);
+    assert_int_equal(stats.warm, 1);
+    assert_int_equal(stats.cold, 2);
+    assert_int_equal(stats.idle, 1);
+
+    talloc_free(pool);
+}
+
+/* Requests over max_running wait, requests over max_queue are rejected */
+void test_child_pool_backpressure(void **state)
+{
+    struct child_test_ctx *child_tctx = talloc_get_type(*state,
+                                                        struct child_test_ctx);
+    struct sss_child_pool_opts opts;
+    struct sss_child_pool_stats stats;
+    struct sss_child_pool *pool;
+    struct pool_test_req *ptr[3];
+    int pending = 0;
+    errno_t ret;
+
+    setenv("TEST_CHILD_ACTION", "echo", 1);
+
+    pool_test_opts(&opts);
+    opts.max_running = 1;
+    opts.max_queue = 1;
+    opts.max_requests = 1;
+
+    ret = sss_child_pool_create(child_tctx, child_tctx->test_ctx->ev,
+                                &opts, &pool);
+    assert_int_equal(ret, EOK);
+
+    ptr[0] = pool_test_send(child_tctx, pool, "first", &pending);
+    ptr[1] = pool_test_send(child_tctx, pool, "second", &pending);
+    ptr[2] = pool_test_send(child_tctx, pool, "third", &pending);
+
+    ret = test_ev_loop(child_tctx->test_ctx);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(ptr[0]->ret, EOK);
+    assert_int_equal(ptr[1]->ret, EOK);
+    assert_int_equal(ptr[2]->ret, EBUSY);
+
+    sss_child_pool_get_stats(pool, &stats);
+    assert_int_equal(stats.queued, 1);
+    assert_int_equal(stats.rejected, 1);
+    assert_int_equal(stats.cold, 2);
+
+    talloc_free(pool);
+}
+
+/* Requests which are still running or waiting fail when the pool is freed */
+void test_child_pool_free_pending(void **state)
+{
+    struct child_test_ctx *child_tctx = talloc_get_type(*state,
+                                                        struct child_test_ctx);
+    struct sss_child_pool_opts opts;
+    struct sss_child_pool_stats stats;
+    struct sss_child_pool *pool;
+    struct pool_test_req *ptr[2];
+    int pending = 0;
+    errno_t ret;
+
+    setenv("TEST_CHILD_ACTION", "echo", 1);
+
+    pool_test_opts(&opts);
+    opts.max_running = 1;
+    opts.max_requests = 1;
+    opts.timeout = 1;
+
+    ret = sss_child_pool_create(child_tctx, child_tctx->test_ctx->ev,
+                                &opts, &pool);
+    assert_int_equal(ret, EOK);
+
+    ptr[0] = pool_test_send(child_tctx, pool, "first", &pending);
+    ptr[1] = pool_test_send(child_tctx, pool, "second", &pending);
+
+    /* The first request is sent to a child, the second one waits */
+    ret = tevent_loop_once(child_tctx->test_ctx->ev);
+    assert_int_equal(ret, 0);
+
+    sss_child_pool_get_stats(pool, &stats);
+    assert_int_equal(stats.busy, 1);
+    assert_int_equal(stats.waiting, 1);
+
+    talloc_free(pool);
+
+    /* Neither of them may wait for the timeout */
+    ret = test_ev_loop(child_tctx->test_ctx);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(ptr[0]->ret, ECANCELED);
+    assert_int_equal(ptr[1]->ret, ECANCELED);
+}
+
 int main(int argc, const char *argv[])
 {
     int rv;
@@ -530,6 +760,18 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_sss_child,
                                         child_test_setup,
                                         child_test_teardown),
+        cmocka_unit_test_setup_teardown(test_child_pool_prefork,
+                                        child_test_setup,
+                                        child_test_teardown),
+        cmocka_unit_test_setup_teardown(test_child_pool_persistent,
+                                        child_test_setup,
+                                        child_test_teardown),
+        cmocka_unit_test_setup_teardown(test_child_pool_backpressure,
+                                        child_test_setup,
+                                        child_test_teardown),
+        cmocka_unit_test_setup_teardown(test_child_pool_free_pending,
+                                        child_test_setup,
+                                        child_test_teardown),
         cmocka_unit_test_setup_teardown(test_exec_child_only_extra_args,
                                         only_extra_args_setup,
                                         only_extra_args_teardown),
@@ -0,0 +1,353 @@
+/*
+    SSSD
+
+    test_debug_buffer - Buffered debug logging tests
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <cmocka.h>
+#include <popt.h>
+
+#include "util/util.h"
+
+#define TEST_LOG_TEMPLATE   "test_debug_buffer.XXXXXX"
+/* More than the 64 KiB the buffer holds */
+#define TEST_LINE_LEN       1000
+#define TEST_LINES          200
+#define TEST_LONG_LEN       (70 * 1024)
+
+extern FILE *debug_file;
+
+struct debug_buffer_test_ctx {
+    char path[sizeof(TEST_LOG_TEMPLATE)];
+    int pending_calls;
+};
+
+static void test_debug_pending(void *pvt)
+{
+    struct debug_buffer_test_ctx *test_ctx = pvt;
+
+    test_ctx->pending_calls++;
+}
+
+static char *read_log(TALLOC_CTX *mem_ctx,
+                      struct debug_buffer_test_ctx *test_ctx)
+{
+    char *log;
+    size_t size = 0;
+    ssize_t len;
+    int fd;
+
+    fd = open(test_ctx->path, O_RDONLY);
+    assert_true(fd != -1);
+
+    log = talloc_array(mem_ctx, char, 1);
+    assert_non_null(log);
+
+    while (true) {
+        log = talloc_realloc(mem_ctx, log, char, size + 4096 + 1);
+        assert_non_null(log);
+
+        len = read(fd, log + size, 4096);
+        assert_true(len >= 0);
+        if (len == 0) {
+            break;
+        }
+        size += len;
+    }
+    log[size] = '\0';
+
+    close(fd);
+    return log;
+}
+
+static size_t count_lines(const char *log)
+{
+    size_t count = 0;
+
+    for (; *log != '\0'; log++) {
+        if (*log == '\n') {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static int test_debug_buffer_setup(void **state)
+{
+    struct debug_buffer_test_ctx *test_ctx;
+    errno_t ret;
+    int fd;
+
+    test_ctx = talloc_zero(NULL, struct debug_buffer_test_ctx);
+    assert_non_null(test_ctx);
+
+    strcpy(test_ctx->path, TEST_LOG_TEMPLATE);
+    fd = mkstemp(test_ctx->path);
+    assert_true(fd != -1);
+
+    ret = set_debug_file_from_fd(fd);
+    assert_int_equal(ret, EOK);
+
+    debug_prg_name = "sssd";
+    debug_level = SSSDBG_MASK_ALL;
+    debug_timestamps = 0;
+    debug_microseconds = 0;
+    debug_to_file = 1;
+    sss_set_logger(sss_logger_str[FILES_LOGGER]);
+
+    debug_enable_buffering(test_debug_pending, test_ctx);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_debug_buffer_teardown(void **state)
+{
+    struct debug_buffer_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct debug_buffer_test_ctx);
+
+    debug_disable_buffering();
+
+    fclose(debug_file);
+    debug_file = NULL;
+
+    unlink(test_ctx->path);
+    talloc_free(test_ctx);
+    return 0;
+}
+
+static void test_debug_buffer_lines(void **state)
+{
+    struct debug_buffer_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct debug_buffer_test_ctx);
+    char *log;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "first line\n");
+    DEBUG(SSSDBG_TRACE_FUNC, "second line\n");
+
+    /* Nothing is written until the main loop flushes */
+    log = read_log(test_ctx, test_ctx);
+    assert_string_equal(log, "");
+    assert_int_equal(test_ctx->pending_calls, 1);
+
+    debug_flush();
+
+    log = read_log(test_ctx, test_ctx);
+    assert_string_equal(log,
+            "[sssd] [test_debug_buffer_lines] (0x0400): first line\n"
+            "[sssd] [test_debug_buffer_lines] (0x0400): second line\n");
+
+    /* The next message asks for a flush again */
+    DEBUG(SSSDBG_TRACE_FUNC, "third line\n");
+    assert_int_equal(test_ctx->pending_calls, 2);
+}
+
+static void test_debug_buffer_error(void **state)
+{
+    struct debug_buffer_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct debug_buffer_test_ctx);
+    char *log;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "trace\n");
+    DEBUG(SSSDBG_OP_FAILURE, "failure\n");
+
+    /* Errors are written right away, after what was buffered before */
+    log = read_log(test_ctx, test_ctx);
+    assert_string_equal(log,
+            "[sssd] [test_debug_buffer_error] (0x0400): trace\n"
+            "[sssd] [test_debug_buffer_error] (0x0040): failure\n");
+}
+
+static void test_debug_buffer_overflow(void **state)
+{
+    struct debug_buffer_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct debug_buffer_test_ctx);
+    char *line;
+    char *log;
+    char *prev;
+    char *eol;
+    size_t len;
+    int i;
+
+    line = talloc_array(test_ctx, char, TEST_LINE_LEN + 1);
+    assert_non_null(line);
+    memset(line, 'x', TEST_LINE_LEN);
+    line[TEST_LINE_LEN] = '\0';
+
+    for (i = 0; i < TEST_LINES; i++) {
+        DEBUG(SSSDBG_TRACE_FUNC, "%03d %s\n", i, line);
+    }
+
+    /* The full buffer was written, messages are never split */
+    log = read_log(test_ctx, test_ctx);
+    len = strlen(log);
+    assert_true(len > 0);
+    assert_int_equal(log[len - 1], '\n');
+    assert_true(count_lines(log) < TEST_LINES);
+
+    debug_flush();
+
+    log = read_log(test_ctx, test_ctx);
+    assert_int_equal(count_lines(log), TEST_LINES);
+
+    /* All lines are complete and in order */
+    prev = log;
+    for (i = 0; i < TEST_LINES; i++) {
+        eol = strchr(prev, '\n');
+        assert_non_null(eol);
+        assert_int_equal(eol - prev,
+                         strlen("[sssd] [test_debug_buffer_overflow] "
+                                "(0x0400): 000 ") + TEST_LINE_LEN);
+        assert_int_equal(strtol(strstr(prev, "): ") + 3, NULL, 10), i);
+        prev = eol + 1;
+    }
+}
+
+static void test_debug_buffer_too_long(void **state)
+{
+    struct debug_buffer_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct debug_buffer_test_ctx);
+    char *line;
+    char *log;
+    char *eol;
+
+    line = talloc_array(test_ctx, char, TEST_LONG_LEN + 1);
+    assert_non_null(line);
+    memset(line, 'y', TEST_LONG_LEN);
+    line[TEST_LONG_LEN] = '\0';
+
+    DEBUG(SSSDBG_TRACE_FUNC, "before\n");
+    /* Does not fit into the buffer at all, it is written directly */
+    DEBUG(SSSDBG_TRACE_FUNC, "%s\n", line);
+
+    log = read_log(test_ctx, test_ctx);
+    assert_int_equal(count_lines(log), 2);
+    assert_true(strncmp(log,
+                    "[sssd] [test_debug_buffer_too_long] (0x0400): before\n",
+                    strlen("[sssd] [test_debug_buffer_too_long] "
+                           "(0x0400): before\n")) == 0);
+    eol = strchr(log, '\n');
+    assert_non_null(strstr(eol + 1, line));
+}
+
+static void test_debug_buffer_exit(void **state)
+{
+    struct debug_buffer_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct debug_buffer_test_ctx);
+    char *log;
+    pid_t pid;
+    int status;
+
+    pid = fork();
+    assert_true(pid != -1);
+    if (pid == 0) {
+        /* The child does not inherit the buffering */
+        debug_enable_buffering(NULL, NULL);
+        DEBUG(SSSDBG_TRACE_FUNC, "written at exit\n");
+        exit(0);
+    }
+
+    assert_int_equal(waitpid(pid, &status, 0), pid);
+    assert_true(WIFEXITED(status));
+    assert_int_equal(WEXITSTATUS(status), 0);
+
+    log = read_log(test_ctx, test_ctx);
+    assert_string_equal(log,
+            "[sssd] [test_debug_buffer_exit] (0x0400): written at exit\n");
+}
+
+static void test_debug_buffer_abort(void **state)
+{
+    struct debug_buffer_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct debug_buffer_test_ctx);
+    struct rlimit no_core = { 0, 0 };
+    char *log;
+    pid_t pid;
+    int status;
+
+    pid = fork();
+    assert_true(pid != -1);
+    if (pid == 0) {
+        setrlimit(RLIMIT_CORE, &no_core);
+        debug_enable_buffering(NULL, NULL);
+        DEBUG(SSSDBG_TRACE_FUNC, "written on abort\n");
+        abort();
+    }
+
+    assert_int_equal(waitpid(pid, &status, 0), pid);
+    assert_true(WIFSIGNALED(status));
+    assert_int_equal(WTERMSIG(status), SIGABRT);
+
+    log = read_log(test_ctx, test_ctx);
+    assert_string_equal(log,
+            "[sssd] [test_debug_buffer_abort] (0x0400): written on abort\n");
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_debug_buffer_lines,
+                                        test_debug_buffer_setup,
+                                        test_debug_buffer_teardown),
+        cmocka_unit_test_setup_teardown(test_debug_buffer_error,
+                                        test_debug_buffer_setup,
+                                        test_debug_buffer_teardown),
+        cmocka_unit_test_setup_teardown(test_debug_buffer_overflow,
+                                        test_debug_buffer_setup,
+                                        test_debug_buffer_teardown),
+        cmocka_unit_test_setup_teardown(test_debug_buffer_too_long,
+                                        test_debug_buffer_setup,
+                                        test_debug_buffer_teardown),
+        cmocka_unit_test_setup_teardown(test_debug_buffer_exit,
+                                        test_debug_buffer_setup,
+                                        test_debug_buffer_teardown),
+        cmocka_unit_test_setup_teardown(test_debug_buffer_abort,
+                                        test_debug_buffer_setup,
+                                        test_debug_buffer_teardown),
+    };
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -23,9 +23,14 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <popt.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include "tests/cmocka/common_mock.h"
+#include "src/providers/ipa/ipa_deskprofile_private.h"
 #include "src/providers/ipa/ipa_deskprofile_rules_util.h"
+#include "src/providers/ipa/ipa_rules_common.h"
 
 #define RULES_DIR "/var/lib/sss/deskprofile"
 #define DOMAIN "domain.example"
@@ -38,6 +43,9 @@
 #define HOST "000000"
 #define HOSTGROUP "000420"
 
+#define FQ_USERNAME USERNAME"@"DOMAIN
+#define USER_DIR IPA_DESKPROFILE_RULES_USER_DIR"/"DOMAIN"/"USERNAME
+
 void test_deskprofile_get_filename_path(void **state)
 {
     TALLOC_CTX *tmp_ctx;
@@ -125,6 +133,217 @@ void test_deskprofile_get_filename_path(void **state)
     talloc_free(tmp_ctx);
 }
 
+static int deskprofile_rules_dir_setup(void **state)
+{
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    ret = mkdir(IPA_DESKPROFILE_RULES_USER_DIR, 0700);
+    assert_int_equal(ret, 0);
+
+    ret = ipa_deskprofile_rules_create_user_dir(FQ_USERNAME,
+                                                getuid(), getgid());
+    assert_int_equal(ret, EOK);
+
+    check_leaks_push(global_talloc_context);
+    return 0;
+}
+
+static int deskprofile_rules_dir_teardown(void **state)
+{
+    errno_t ret;
+
+    assert_true(check_leaks_pop(global_talloc_context));
+
+    ret = sss_remove_tree(IPA_DESKPROFILE_RULES_USER_DIR);
+    assert_int_equal(ret, EOK);
+
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static struct sysdb_attrs *test_deskprofile_rule(TALLOC_CTX *mem_ctx,
+                                                 const char *data)
+{
+    struct sysdb_attrs *rule;
+    errno_t ret;
+
+    rule = sysdb_new_attrs(mem_ctx);
+    assert_non_null(rule);
+
+    ret = sysdb_attrs_add_string(rule, IPA_CN, RULE_NAME);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_uint32(rule, IPA_DESKPROFILE_PRIORITY, 420);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(rule, IPA_USER_CATEGORY, "all");
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(rule, IPA_HOST_CATEGORY, "all");
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(rule, IPA_DESKPROFILE_DATA, data);
+    assert_int_equal(ret, EOK);
+
+    return rule;
+}
+
+static void save_test_rule(TALLOC_CTX *mem_ctx,
+                           const char *data,
+                           struct stat *_st)
+{
+    struct sysdb_attrs *rule;
+    char *filename = NULL;
+    char *path;
+    errno_t ret;
+
+    rule = test_deskprofile_rule(mem_ctx, data);
+
+    ret = ipa_deskprofile_rules_save_rule_to_disk(mem_ctx, 1, rule, NULL,
+                                                  "host."DOMAIN, FQ_USERNAME,
+                                                  getuid(), getgid(),
+                                                  &filename);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(filename, PRIO"_"PRIO"_"PRIO"_"PRIO"_"PRIO"_"
+                                  RULE_NAME"."EXTENSION);
+
+    path = talloc_asprintf(mem_ctx, USER_DIR"/%s", filename);
+    assert_non_null(path);
+
+    ret = stat(path, _st);
+    assert_int_equal(ret, 0);
+    assert_int_equal(_st->st_size, strlen(data));
+
+    talloc_free(rule);
+}
+
+static void assert_dir_entries(const char **expected)
+{
+    DIR *dir;
+    struct dirent *entry;
+    size_t count = 0;
+    size_t i;
+
+    dir = opendir(USER_DIR);
+    assert_non_null(dir);
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0
+                || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        for (i = 0; expected[i] != NULL; i++) {
+            if (strcmp(entry->d_name, expected[i]) == 0) {
+                break;
+            }
+        }
+        assert_non_null(expected[i]);
+        count++;
+    }
+    closedir(dir);
+
+    for (i = 0; expected[i] != NULL; i++);
+    assert_int_equal(count, i);
+}
+
+static void create_test_file(const char *name)
+{
+    char *path;
+    int fd;
+
+    path = talloc_asprintf(global_talloc_context, USER_DIR"/%s", name);
+    assert_non_null(path);
+
+    fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0400);
+    assert_int_not_equal(fd, -1);
+    close(fd);
+
+    talloc_free(path);
+}
+
+void test_deskprofile_save_rule_unchanged(void **state)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct stat first;
+    struct stat second;
+
+    tmp_ctx = talloc_new(global_talloc_context);
+    assert_non_null(tmp_ctx);
+
+    save_test_rule(tmp_ctx, "{\"data\": 1}", &first);
+    assert_int_equal(first.st_mode & 0777, 0400);
+
+    /* the file is replaced by rename(), an untouched file keeps its inode */
+    save_test_rule(tmp_ctx, "{\"data\": 1}", &second);
+    assert_int_equal(first.st_ino, second.st_ino);
+    assert_int_equal(first.st_mtim.tv_sec, second.st_mtim.tv_sec);
+    assert_int_equal(first.st_mtim.tv_nsec, second.st_mtim.tv_nsec);
+
+    talloc_free(tmp_ctx);
+}
+
+void test_deskprofile_save_rule_changed(void **state)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct stat first;
+    struct stat second;
+    const char *expected[] = { PRIO"_"PRIO"_"PRIO"_"PRIO"_"PRIO"_"
+                               RULE_NAME"."EXTENSION, NULL };
+
+    tmp_ctx = talloc_new(global_talloc_context);
+    assert_non_null(tmp_ctx);
+
+    save_test_rule(tmp_ctx, "{\"data\": 1}", &first);
+
+    /* same size, different content */
+    save_test_rule(tmp_ctx, "{\"data\": 2}", &second);
+    assert_int_not_equal(first.st_ino, second.st_ino);
+
+    /* and a different size */
+    save_test_rule(tmp_ctx, "{\"data\": 42}", &first);
+    assert_int_not_equal(first.st_ino, second.st_ino);
+
+    /* no temporary file is left behind */
+    assert_dir_entries(expected);
+
+    talloc_free(tmp_ctx);
+}
+
+void test_deskprofile_remove_stale_files(void **state)
+{
+    errno_t ret;
+    const char *keep[] = { "keep1.json", "keep2.json", NULL };
+    const char *none[] = { NULL };
+
+    create_test_file("keep1.json");
+    create_test_file("keep2.json");
+    create_test_file("stale1.json");
+    create_test_file("stale2.json");
+
+    ret = ipa_deskprofile_rules_remove_stale_files(USER_DIR, keep,
+                                                   getuid(), getgid());
+    assert_int_equal(ret, EOK);
+    assert_dir_entries(keep);
+
+    /* nothing is kept when there are no rules for the user */
+    ret = ipa_deskprofile_rules_remove_stale_files(USER_DIR, NULL,
+                                                   getuid(), getgid());
+    assert_int_equal(ret, EOK);
+    assert_dir_entries(none);
+}
+
+void test_deskprofile_remove_stale_files_no_dir(void **state)
+{
+    errno_t ret;
+
+    ret = ipa_deskprofile_rules_remove_stale_files(USER_DIR"/missing", NULL,
+                                                   getuid(), getgid());
+    assert_int_equal(ret, ENOENT);
+
+    /* the effective ids are restored on failure */
+    assert_int_equal(geteuid(), getuid());
+    assert_int_equal(getegid(), getgid());
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -138,6 +357,19 @@ int main(int argc, const char *argv[])
 
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_deskprofile_get_filename_path),
+        cmocka_unit_test_setup_teardown(test_deskprofile_save_rule_unchanged,
+                                        deskprofile_rules_dir_setup,
+                                        deskprofile_rules_dir_teardown),
+        cmocka_unit_test_setup_teardown(test_deskprofile_save_rule_changed,
+                                        deskprofile_rules_dir_setup,
+                                        deskprofile_rules_dir_teardown),
+        cmocka_unit_test_setup_teardown(test_deskprofile_remove_stale_files,
+                                        deskprofile_rules_dir_setup,
+                                        deskprofile_rules_dir_teardown),
+        cmocka_unit_test_setup_teardown(
+                                    test_deskprofile_remove_stale_files_no_dir,
+                                    deskprofile_rules_dir_setup,
+                                    deskprofile_rules_dir_teardown),
     };
 
     /* Set debug level to invalid value so we can decide if -d 0 was used. */
@@ -157,6 +389,7 @@ int main(int argc, const char *argv[])
 
     DEBUG_CLI_INIT(debug_level);
 
+    tests_set_cwd();
     rv = cmocka_run_group_tests(tests, NULL, NULL);
     return rv;
 }
@@ -212,7 +212,7 @@ int test_fo_srv_data_cmp(void *ud1, void *ud2)
     return strcasecmp((char*) ud1, (char*) ud2);
 }
 
-static int test_fo_setup(void **state)
+static int test_fo_setup_opts(void **state, bool latency_aware)
 {
     struct test_fo_ctx *test_ctx;
     errno_t ret;
@@ -236,6 +236,7 @@ static int test_fo_setup(void **state)
     memset(&fopts, 0, sizeof(fopts));
     fopts.retry_timeout = TEST_FO_TIMEOUT;
     fopts.family_order  = IPV4_FIRST;
+    fopts.latency_aware = latency_aware;
 
     test_ctx->fo_ctx = fo_context_init(test_ctx, &fopts);
     assert_non_null(test_ctx->fo_ctx);
@@ -249,6 +250,11 @@ static int test_fo_setup(void **state)
     return 0;
 }
 
+static int test_fo_setup(void **state)
+{
+    return test_fo_setup_opts(state, false);
+}
+
 static int test_fo_teardown(void **state)
 {
     struct test_fo_ctx *test_ctx =
@@ -260,12 +266,12 @@ static int test_fo_teardown(void **state)
     return 0;
 }
 
-static int test_fo_srv_setup(void **state)
+static int test_fo_srv_setup_opts(void **state, bool latency_aware)
 {
     struct test_fo_ctx *test_ctx;
     bool ok;
 
-    test_fo_setup(state);
+    test_fo_setup_opts(state, latency_aware);
     test_ctx = *state;
 
     test_ctx->srv_ctx = fo_resolve_srv_dns_ctx_init(test_ctx, test_ctx->resolv,
@@ -283,6 +289,16 @@ static int test_fo_srv_setup(void **state)
     return 0;
 }
 
+static int test_fo_srv_setup(void **state)
+{
+    return test_fo_srv_setup_opts(state, false);
+}
+
+static int test_fo_srv_latency_setup(void **state)
+{
+    return test_fo_srv_setup_opts(state, true);
+}
+
 static int test_fo_srv_teardown(void **state)
 {
     test_fo_teardown(state);
@@ -754,6 +770,314 @@ static void test_fo_srv_dup_done(struct tevent_req *req)
     }
 }
 
+/* Servers with the same SRV priority are reordered by their measured
+ * latency once the latency aware selection is enabled
+ */
+static void test_fo_srv_latency_done1(struct tevent_req *req);
+static void test_fo_srv_latency_done2(struct tevent_req *req);
+static void test_fo_srv_latency_done3(struct tevent_req *req);
+
+static void test_fo_srv_latency_resolve(struct test_fo_ctx *test_ctx,
+                                        tevent_req_fn fn)
+{
+    struct tevent_req *req;
+
+    req = fo_resolve_service_send(test_ctx, test_ctx->ctx->ev,
+                                  test_ctx->resolv, test_ctx->fo_ctx,
+                                  test_ctx->fo_svc);
+    assert_non_null(req);
+    tevent_req_set_callback(req, fn, test_ctx);
+}
+
+void test_fo_srv_latency(void **state)
+{
+    errno_t ret;
+    struct ares_srv_reply *s1;
+    struct ares_srv_reply *s2;
+    char *dns_domain;
+    struct test_fo_ctx *test_ctx =
+        talloc_get_type(*state, struct test_fo_ctx);
+
+    s1 = mock_ares_reply(test_ctx, "ldap1.sssd.com", 100, 1, 389);
+    assert_non_null(s1);
+
+    s2 = mock_ares_reply(test_ctx, "ldap2.sssd.com", 100, 1, 389);
+    assert_non_null(s2);
+
+    s1->next = s2;
+
+    dns_domain = talloc_strdup(test_ctx, "sssd.com");
+    assert_non_null(dns_domain);
+
+    mock_srv_results(s1, TEST_SRV_TTL, dns_domain);
+
+    ret = fo_add_srv_server(test_ctx->fo_svc, "_ldap", "sssd.com",
+                            "sssd.local", "tcp", test_ctx);
+    assert_int_equal(ret, ERR_OK);
+
+    fo_set_service_reports_rtt(test_ctx->fo_svc, true);
+
+    test_fo_srv_latency_resolve(test_ctx, test_fo_srv_latency_done1);
+
+    ret = test_ev_loop(test_ctx->ctx);
+    assert_int_equal(ret, ERR_OK);
+}
+
+static void test_fo_srv_latency_done1(struct tevent_req *req)
+{
+    struct test_fo_ctx *test_ctx = \
+        tevent_req_callback_data(req, struct test_fo_ctx);
+    struct fo_server *srv;
+    errno_t ret;
+
+    ret = fo_resolve_service_recv(req, req, &srv);
+    talloc_zfree(req);
+    assert_int_equal(ret, ERR_OK);
+
+    /* Nothing is measured yet, the DNS order is used */
+    check_server(test_ctx, srv, 389, "ldap1.sssd.com");
+
+    fo_add_server_sample(srv, 100000, true);
+    fo_set_port_status(srv, PORT_WORKING);
+
+    test_fo_srv_latency_resolve(test_ctx, test_fo_srv_latency_done2);
+}
+
+static void test_fo_srv_latency_done2(struct tevent_req *req)
+{
+    struct test_fo_ctx *test_ctx = \
+        tevent_req_callback_data(req, struct test_fo_ctx);
+    struct fo_server *srv;
+    errno_t ret;
+
+    ret = fo_resolve_service_recv(req, req, &srv);
+    talloc_zfree(req);
+    assert_int_equal(ret, ERR_OK);
+
+    /* ldap2 has no score yet, it must be probed */
+    check_server(test_ctx, srv, 389, "ldap2.sssd.com");
+
+    fo_add_server_sample(srv, 10000, true);
+
+    test_fo_srv_latency_resolve(test_ctx, test_fo_srv_latency_done3);
+}
+
+static void test_fo_srv_latency_done3(struct tevent_req *req)
+{
+    struct test_fo_ctx *test_ctx = \
+        tevent_req_callback_data(req, struct test_fo_ctx);
+    struct fo_server_score *scores;
+    struct fo_server *srv;
+    size_t count;
+    errno_t ret;
+
+    ret = fo_resolve_service_recv(req, req, &srv);
+    talloc_zfree(req);
+    assert_int_equal(ret, ERR_OK);
+
+    /* ldap2 is much faster than the active ldap1 */
+    check_server(test_ctx, srv, 389, "ldap2.sssd.com");
+
+    scores = fo_svc_server_scores(test_ctx, test_ctx->fo_svc, &count);
+    assert_non_null(scores);
+    assert_int_equal(count, 2);
+    assert_string_equal(scores[0].name, "ldap1.sssd.com");
+    assert_int_equal(scores[0].rtt_usec, 100000);
+    assert_int_equal(scores[0].error_permille, 0);
+    assert_int_equal(scores[0].samples, 1);
+    assert_string_equal(scores[1].name, "ldap2.sssd.com");
+    assert_int_equal(scores[1].rtt_usec, 10000);
+    talloc_free(scores);
+
+    test_ctx->ctx->error = ERR_OK;
+    test_ctx->ctx->done = true;
+}
+
+/* The servers to connect to in parallel are returned in the fail over
+ * order, backup servers last
+ */
+static void test_fo_candidates_done(struct tevent_req *req);
+static void test_fo_candidates_resolved(struct tevent_req *req);
+
+static void check_candidates(struct fo_server **servers, size_t count,
+                             const char **names)
+{
+    size_t i;
+
+    for (i = 0; names[i] != NULL; i++) {
+        assert_true(i < count);
+        assert_string_equal(fo_get_server_name(servers[i]), names[i]);
+    }
+    assert_int_equal(count, i);
+}
+
+void test_fo_candidates(void **state)
+{
+    errno_t ret;
+    struct test_fo_ctx *test_ctx =
+        talloc_get_type(*state, struct test_fo_ctx);
+
+    ret = fo_add_server(test_ctx->fo_svc,
+                        "ldap1.sssd.com", 389, test_ctx, true);
+    assert_int_equal(ret, ERR_OK);
+
+    ret = fo_add_server(test_ctx->fo_svc,
+                        "backup1.sssd.com", 389, test_ctx, false);
+    assert_int_equal(ret, ERR_OK);
+
+    ret = fo_add_server(test_ctx->fo_svc,
+                        "ldap2.sssd.com", 389, test_ctx, true);
+    assert_int_equal(ret, ERR_OK);
+
+    ret = fo_add_server(test_ctx->fo_svc,
+                        "ldap3.sssd.com", 389, test_ctx, true);
+    assert_int_equal(ret, ERR_OK);
+
+    test_fo_srv_latency_resolve(test_ctx, test_fo_candidates_done);
+
+    ret = test_ev_loop(test_ctx->ctx);
+    assert_int_equal(ret, ERR_OK);
+}
+
+static void test_fo_candidates_done(struct tevent_req *req)
+{
+    struct test_fo_ctx *test_ctx = \
+        tevent_req_callback_data(req, struct test_fo_ctx);
+    struct fo_server **servers;
+    struct fo_server *ldap3;
+    struct fo_server *srv;
+    size_t count;
+    errno_t ret;
+    const char *top3[] = { "ldap1.sssd.com", "ldap2.sssd.com",
+                           "ldap3.sssd.com", NULL };
+    const char *all[] = { "ldap1.sssd.com", "ldap2.sssd.com",
+                          "ldap3.sssd.com", "backup1.sssd.com", NULL };
+    const char *working[] = { "ldap3.sssd.com", "ldap1.sssd.com",
+                              "backup1.sssd.com", NULL };
+
+    ret = fo_resolve_service_recv(req, req, &srv);
+    talloc_zfree(req);
+    assert_int_equal(ret, ERR_OK);
+    check_server(test_ctx, srv, 389, "ldap1.sssd.com");
+
+    ret = fo_get_candidate_servers(test_ctx, test_ctx->fo_svc, srv, 3,
+                                   &servers, &count);
+    assert_int_equal(ret, ERR_OK);
+    check_candidates(servers, count, top3);
+    talloc_free(servers);
+
+    ret = fo_get_candidate_servers(test_ctx, test_ctx->fo_svc, srv, 10,
+                                   &servers, &count);
+    assert_int_equal(ret, ERR_OK);
+    check_candidates(servers, count, all);
+
+    /* Broken servers are skipped, the list wraps around */
+    fo_set_port_status(servers[1], PORT_NOT_WORKING);
+    ldap3 = servers[2];
+    fo_ref_server(test_ctx, ldap3);
+    talloc_free(servers);
+
+    ret = fo_get_candidate_servers(test_ctx, test_ctx->fo_svc, ldap3, 10,
+                                   &servers, &count);
+    assert_int_equal(ret, ERR_OK);
+    check_candidates(servers, count, working);
+    talloc_free(servers);
+
+    req = fo_resolve_server_send(test_ctx, test_ctx->ctx->ev,
+                                 test_ctx->resolv, test_ctx->fo_ctx, ldap3);
+    assert_non_null(req);
+    tevent_req_set_callback(req, test_fo_candidates_resolved, test_ctx);
+}
+
+static void test_fo_candidates_resolved(struct tevent_req *req)
+{
+    struct test_fo_ctx *test_ctx = \
+        tevent_req_callback_data(req, struct test_fo_ctx);
+    errno_t ret;
+
+    ret = fo_resolve_server_recv(req);
+    talloc_zfree(req);
+    assert_int_equal(ret, ERR_OK);
+
+    test_ctx->ctx->error = ERR_OK;
+    test_ctx->ctx->done = true;
+}
+
+void test_fo_probe_servers(void **state)
+{
+    errno_t ret;
+    struct test_fo_ctx *test_ctx =
+        talloc_get_type(*state, struct test_fo_ctx);
+    struct fo_server **servers;
+    struct fo_server_score *scores;
+    struct fo_server *ldap1;
+    struct fo_server *ldap2;
+    uint32_t samples;
+    size_t count;
+    const char *all[] = { "ldap1.sssd.com", "ldap2.sssd.com",
+                          "ldap3.sssd.com", NULL };
+    const char *inactive[] = { "ldap2.sssd.com", "ldap3.sssd.com", NULL };
+    const char *working[] = { "ldap1.sssd.com", "ldap3.sssd.com", NULL };
+
+    ret = fo_add_server(test_ctx->fo_svc,
+                        "ldap1.sssd.com", 389, test_ctx, true);
+    assert_int_equal(ret, ERR_OK);
+
+    ret = fo_add_server(test_ctx->fo_svc,
+                        "ldap2.sssd.com", 389, test_ctx, true);
+    assert_int_equal(ret, ERR_OK);
+
+    /* Servers without a port are checked on the default port */
+    ret = fo_add_server(test_ctx->fo_svc,
+                        "ldap3.sssd.com", 0, test_ctx, true);
+    assert_int_equal(ret, ERR_OK);
+
+    servers = fo_svc_probe_servers(test_ctx, test_ctx->fo_svc, &count);
+    assert_non_null(servers);
+    check_candidates(servers, count, all);
+    ldap1 = servers[0];
+    ldap2 = servers[1];
+    fo_ref_server(test_ctx, ldap1);
+    fo_ref_server(test_ctx, ldap2);
+    talloc_free(servers);
+
+    /* The server in use is not checked */
+    fo_set_port_status(ldap1, PORT_WORKING);
+    servers = fo_svc_probe_servers(test_ctx, test_ctx->fo_svc, &count);
+    assert_non_null(servers);
+    check_candidates(servers, count, inactive);
+    talloc_free(servers);
+
+    /* A failed server is not a candidate until a check finds it alive */
+    fo_set_port_status(ldap2, PORT_NOT_WORKING);
+    fo_set_server_status(ldap2, SERVER_NOT_WORKING);
+    ret = fo_get_candidate_servers(test_ctx, test_ctx->fo_svc, ldap1, 10,
+                                   &servers, &count);
+    assert_int_equal(ret, ERR_OK);
+    check_candidates(servers, count, working);
+    talloc_free(servers);
+
+    scores = fo_svc_server_scores(test_ctx, test_ctx->fo_svc, &count);
+    assert_non_null(scores);
+    assert_string_equal(scores[1].name, "ldap2.sssd.com");
+    samples = scores[1].samples;
+    talloc_free(scores);
+
+    fo_set_server_alive(ldap2);
+    ret = fo_get_candidate_servers(test_ctx, test_ctx->fo_svc, ldap1, 10,
+                                   &servers, &count);
+    assert_int_equal(ret, ERR_OK);
+    check_candidates(servers, count, all);
+    talloc_free(servers);
+
+    /* The check is not a sample for the score */
+    scores = fo_svc_server_scores(test_ctx, test_ctx->fo_svc, &count);
+    assert_non_null(scores);
+    assert_int_equal(scores[1].samples, samples);
+    assert_int_equal(scores[1].rtt_usec, 0);
+    talloc_free(scores);
+}
+
 int main(int argc, const char *argv[])
 {
     int rv;
@@ -781,6 +1105,15 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_fo_srv_duplicates,
                                         test_fo_srv_setup,
                                         test_fo_srv_teardown),
+        cmocka_unit_test_setup_teardown(test_fo_srv_latency,
+                                        test_fo_srv_latency_setup,
+                                        test_fo_srv_teardown),
+        cmocka_unit_test_setup_teardown(test_fo_candidates,
+                                        test_fo_setup,
+                                        test_fo_teardown),
+        cmocka_unit_test_setup_teardown(test_fo_probe_servers,
+                                        test_fo_setup,
+                                        test_fo_teardown),
     };
 
     /* Set debug level to invalid value so we can decide if -d 0 was used. */
@@ -0,0 +1,259 @@
+/*
+    Copyright (C) 2026 Red Hat
+
+    SSSD tests: Compiled IPA HBAC rules
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <errno.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "tests/cmocka/common_mock_be.h"
+#include "providers/ipa/ipa_common.h"
+#include "providers/ipa/ipa_opts.h"
+#include "providers/ipa/ipa_hbac_private.h"
+#include "providers/ipa/ipa_rules_common.h"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_ipa_hbac_compiled_conf.ldb"
+#define TEST_DOM_NAME "ipa_hbac_test"
+#define TEST_ID_PROVIDER "ipa"
+
+#define TEST_ALICE_DN "uid=alice,cn=users,cn=accounts,dc=ipa,dc=test"
+
+struct hbac_compiled_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct be_ctx *be_ctx;
+    struct dp_option *ipa_options;
+    struct pam_data *pd;
+
+    struct ipa_hbac_compiled *compiled;
+};
+
+static void store_user(struct hbac_compiled_test_ctx *test_ctx,
+                       const char *shortname, uid_t uid, const char *orig_dn)
+{
+    char *name;
+    errno_t ret;
+
+    name = sss_create_internal_fqname(test_ctx, shortname,
+                                      test_ctx->tctx->dom->name);
+    assert_non_null(name);
+
+    ret = sysdb_store_user(test_ctx->tctx->dom, name, NULL, uid, uid,
+                           NULL, "/home/user", "/bin/sh", orig_dn,
+                           NULL, NULL, 300, time(NULL));
+    assert_int_equal(ret, EOK);
+    talloc_free(name);
+}
+
+static void store_rule(struct hbac_compiled_test_ctx *test_ctx,
+                       const char *rule_name, const char *member_dn)
+{
+    struct sysdb_attrs *attrs;
+    errno_t ret;
+
+    attrs = sysdb_new_attrs(test_ctx);
+    assert_non_null(attrs);
+
+    ret = sysdb_attrs_add_string(attrs, SYSDB_OBJECTCLASS, IPA_HBAC_RULE);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(attrs, IPA_CN, rule_name);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(attrs, IPA_ENABLED_FLAG, "TRUE");
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(attrs, IPA_ACCESS_RULE_TYPE, IPA_HBAC_ALLOW);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(attrs, IPA_MEMBER_USER, member_dn);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(attrs, IPA_SERVICE_CATEGORY, "all");
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(attrs, IPA_HOST_CATEGORY, "all");
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_store_custom(test_ctx->tctx->dom, rule_name,
+                             HBAC_RULES_SUBDIR, attrs);
+    assert_int_equal(ret, EOK);
+    talloc_free(attrs);
+}
+
+static enum hbac_eval_result
+evaluate(struct hbac_compiled_test_ctx *test_ctx, const char *shortname)
+{
+    struct hbac_ctx hbac_ctx;
+    struct hbac_eval_req *eval_req;
+    struct hbac_info *info = NULL;
+    enum hbac_eval_result result;
+    errno_t ret;
+
+    test_ctx->pd->user = sss_create_internal_fqname(test_ctx->pd, shortname,
+                                                    test_ctx->tctx->dom->name);
+    assert_non_null(test_ctx->pd->user);
+
+    hbac_ctx.be_ctx = test_ctx->be_ctx;
+    hbac_ctx.ipa_options = test_ctx->ipa_options;
+    hbac_ctx.pd = test_ctx->pd;
+    hbac_ctx.rule_count = 0;
+    hbac_ctx.rules = NULL;
+
+    ret = ipa_hbac_get_compiled_rules(test_ctx, &hbac_ctx,
+                                      &test_ctx->compiled);
+    assert_int_equal(ret, EOK);
+    assert_non_null(test_ctx->compiled);
+    assert_false(test_ctx->compiled->deny_rules);
+
+    ret = hbac_ctx_to_eval_request(test_ctx, &hbac_ctx, &eval_req);
+    assert_int_equal(ret, EOK);
+
+    result = hbac_evaluate_compiled(test_ctx->compiled->compiled,
+                                    eval_req, &info);
+    hbac_free_info(info);
+    talloc_free(eval_req);
+
+    return result;
+}
+
+static int test_hbac_compiled_setup(void **state)
+{
+    struct hbac_compiled_test_ctx *test_ctx;
+    errno_t ret;
+
+    test_ctx = talloc_zero(NULL, struct hbac_compiled_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME,
+                                         TEST_ID_PROVIDER, NULL);
+    assert_non_null(test_ctx->tctx);
+
+    test_ctx->be_ctx = mock_be_ctx(test_ctx, test_ctx->tctx);
+    assert_non_null(test_ctx->be_ctx);
+
+    ret = dp_copy_defaults(test_ctx, ipa_basic_opts, IPA_OPTS_BASIC,
+                           &test_ctx->ipa_options);
+    assert_int_equal(ret, EOK);
+
+    ret = dp_opt_set_string(test_ctx->ipa_options, IPA_HOSTNAME,
+                            "client.ipa.test");
+    assert_int_equal(ret, EOK);
+
+    test_ctx->pd = talloc_zero(test_ctx, struct pam_data);
+    assert_non_null(test_ctx->pd);
+    test_ctx->pd->cmd = SSS_PAM_ACCT_MGMT;
+    test_ctx->pd->domain = talloc_strdup(test_ctx->pd,
+                                         test_ctx->tctx->dom->name);
+    assert_non_null(test_ctx->pd->domain);
+    test_ctx->pd->service = talloc_strdup(test_ctx->pd, "sshd");
+    assert_non_null(test_ctx->pd->service);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_hbac_compiled_teardown(void **state)
+{
+    talloc_zfree(*state);
+    return 0;
+}
+
+static void test_hbac_compiled_reused(void **state)
+{
+    struct hbac_compiled_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct hbac_compiled_test_ctx);
+    struct ipa_hbac_compiled *compiled;
+
+    store_user(test_ctx, "alice", 10001, TEST_ALICE_DN);
+    store_rule(test_ctx, "allow_alice", TEST_ALICE_DN);
+
+    assert_int_equal(evaluate(test_ctx, "alice"), HBAC_EVAL_ALLOW);
+    compiled = test_ctx->compiled;
+
+    /* Nothing has changed in the cache, the rules are not compiled again */
+    assert_int_equal(evaluate(test_ctx, "alice"), HBAC_EVAL_ALLOW);
+    assert_ptr_equal(test_ctx->compiled, compiled);
+}
+
+static void test_hbac_compiled_user_cached_later(void **state)
+{
+    struct hbac_compiled_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct hbac_compiled_test_ctx);
+
+    store_user(test_ctx, "bob", 10002, NULL);
+    store_rule(test_ctx, "allow_alice", TEST_ALICE_DN);
+
+    /* alice is not cached yet, so the rule applies to nobody */
+    assert_int_equal(evaluate(test_ctx, "bob"), HBAC_EVAL_DENY);
+
+    /* alice is cached after the rules were compiled */
+    store_user(test_ctx, "alice", 10001, TEST_ALICE_DN);
+
+    assert_int_equal(evaluate(test_ctx, "alice"), HBAC_EVAL_ALLOW);
+    assert_int_equal(evaluate(test_ctx, "bob"), HBAC_EVAL_DENY);
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    int no_cleanup = 0;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        {"no-cleanup", 'n', POPT_ARG_NONE, &no_cleanup, 0,
+         _("Do not delete the test database after a test run"), NULL },
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_hbac_compiled_reused,
+                                        test_hbac_compiled_setup,
+                                        test_hbac_compiled_teardown),
+        cmocka_unit_test_setup_teardown(test_hbac_compiled_user_cached_later,
+                                        test_hbac_compiled_setup,
+                                        test_hbac_compiled_teardown),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old DB to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    test_dom_suite_setup(TESTS_PATH);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    if (rv == 0 && !no_cleanup) {
+        test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    }
+    return rv;
+}
@@ -0,0 +1,480 @@
+/*
+    Copyright (C) 2026 Red Hat
+
+    SSSD tests - Pipelined extdom lookups of object lists
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "providers/ipa/ipa_opts.h"
+
+/* In order to access the static functions */
+#include "providers/ipa/ipa_s2n_exop.c"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_ipa_s2n_exop_conf.ldb"
+#define TEST_DOM_NAME "ipa_s2n_exop_test"
+#define TEST_ID_PROVIDER "ipa"
+#define TEST_DOM_SID "S-1-5-21-1-2-3"
+
+#define TEST_MAX_OPS 16
+
+/* An extdom request which was sent to the fake server */
+struct s2n_test_op {
+    char *sid;
+    struct sdap_op *op;
+};
+
+/* Passed to the wrapped ldap_parse_*() calls as the LDAPMessage */
+struct s2n_test_reply {
+    int result;
+    const char *sid;
+};
+
+struct s2n_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct ipa_id_ctx *ipa_ctx;
+    struct sdap_handle *sh;
+
+    /* Indexed by msgid, msgid 0 is not used */
+    struct s2n_test_op ops[TEST_MAX_OPS];
+    int num_sent;
+    int outstanding;
+    int max_outstanding;
+
+    bool done;
+    errno_t error;
+};
+
+static struct s2n_test_ctx *s2n_test;
+
+static int s2n_test_op_destructor(struct sdap_op *op)
+{
+    if (s2n_test->ops[op->msgid].op == op) {
+        s2n_test->ops[op->msgid].op = NULL;
+        s2n_test->outstanding--;
+    }
+
+    return 0;
+}
+
+int __wrap_ldap_extended_operation(LDAP *ld,
+                                   const char *reqoid,
+                                   struct berval *reqdata,
+                                   LDAPControl **sctrls,
+                                   LDAPControl **cctrls,
+                                   int *msgidp)
+{
+    BerElement *ber;
+    ber_tag_t tag;
+    ber_int_t input_type;
+    ber_int_t request_type;
+    char *sid = NULL;
+    int msgid;
+
+    assert_string_equal(reqoid, EXOP_SID2NAME_OID);
+
+    ber = ber_init(reqdata);
+    assert_non_null(ber);
+    tag = ber_scanf(ber, "{eea}", &input_type, &request_type, &sid);
+    assert_int_not_equal(tag, LBER_ERROR);
+    assert_int_equal(input_type, INP_SID);
+    assert_int_equal(request_type, REQ_FULL);
+    ber_free(ber, 1);
+
+    msgid = ++s2n_test->num_sent;
+    assert_true(msgid < TEST_MAX_OPS);
+
+    s2n_test->ops[msgid].sid = talloc_strdup(s2n_test, sid);
+    assert_non_null(s2n_test->ops[msgid].sid);
+    ber_memfree(sid);
+
+    *msgidp = msgid;
+    return LDAP_SUCCESS;
+}
+
+int __wrap_sdap_op_add(TALLOC_CTX *memctx, struct tevent_context *ev,
+                       struct sdap_handle *sh, int msgid,
+                       sdap_op_callback_t *callback, void *data,
+                       int timeout, struct sdap_op **_op)
+{
+    struct sdap_op *op;
+
+    assert_ptr_equal(sh, s2n_test->sh);
+    assert_null(s2n_test->ops[msgid].op);
+
+    op = talloc_zero(memctx, struct sdap_op);
+    assert_non_null(op);
+
+    op->sh = sh;
+    op->msgid = msgid;
+    op->callback = callback;
+    op->data = data;
+    op->ev = ev;
+    talloc_set_destructor(op, s2n_test_op_destructor);
+
+    s2n_test->ops[msgid].op = op;
+    s2n_test->outstanding++;
+    s2n_test->max_outstanding = MAX(s2n_test->max_outstanding,
+                                    s2n_test->outstanding);
+
+    *_op = op;
+    return EOK;
+}
+
+int __wrap_ldap_parse_result(LDAP *ld, LDAPMessage *res, int *errcodep,
+                             char **matcheddnp, char **errmsgp,
+                             char ***referralsp, LDAPControl ***serverctrls,
+                             int freeit)
+{
+    struct s2n_test_reply *reply = (struct s2n_test_reply *) res;
+
+    *errcodep = reply->result;
+    *errmsgp = NULL;
+
+    return LDAP_SUCCESS;
+}
+
+/* The object with the RID n is the group groupn with the GID n */
+int __wrap_ldap_parse_extended_result(LDAP *ld, LDAPMessage *res,
+                                      char **retoidp,
+                                      struct berval **retdatap,
+                                      int freeit)
+{
+    struct s2n_test_reply *reply = (struct s2n_test_reply *) res;
+    BerElement *ber;
+    const char *rid;
+    char *name;
+    int ret;
+
+    rid = strrchr(reply->sid, '-');
+    assert_non_null(rid);
+    rid++;
+
+    name = talloc_asprintf(s2n_test, "group%s", rid);
+    assert_non_null(name);
+
+    ber = ber_alloc_t(LBER_USE_DER);
+    assert_non_null(ber);
+    ret = ber_printf(ber, "{e{ssi}}", RESP_GROUP, s2n_test->tctx->dom->name,
+                     name, atoi(rid));
+    assert_int_not_equal(ret, -1);
+    ret = ber_flatten(ber, retdatap);
+    assert_int_equal(ret, 0);
+    ber_free(ber, 1);
+    talloc_free(name);
+
+    *retoidp = ber_strdup(EXOP_SID2NAME_OID);
+    assert_non_null(*retoidp);
+
+    return LDAP_SUCCESS;
+}
+
+/* Not reached, objects are looked up by SID only */
+struct tevent_req *
+ipa_id_get_account_info_send(TALLOC_CTX *memctx, struct tevent_context *ev,
+                             struct ipa_id_ctx *ipa_ctx,
+                             struct dp_id_data *ar)
+{
+    fail_msg("Unexpected IPA account lookup");
+    return NULL;
+}
+
+int ipa_id_get_account_info_recv(struct tevent_req *req, int *dp_error)
+{
+    fail_msg("Unexpected IPA account lookup");
+    return EINVAL;
+}
+
+/* Delivers the reply to the request with the given msgid, as
+ * sdap_process_result() does */
+static void s2n_test_reply(int msgid, int result, int error)
+{
+    struct s2n_test_reply reply;
+    struct sdap_msg msg;
+    struct sdap_op *op;
+
+    op = s2n_test->ops[msgid].op;
+    assert_non_null(op);
+
+    reply.result = result;
+    reply.sid = s2n_test->ops[msgid].sid;
+    msg.next = NULL;
+    msg.msg = (LDAPMessage *) &reply;
+
+    op->callback(op, error == EOK ? &msg : NULL, error, op->data);
+}
+
+static void s2n_test_list_done(struct tevent_req *req)
+{
+    s2n_test->error = ipa_s2n_get_list_recv(req);
+    s2n_test->done = true;
+    talloc_free(req);
+}
+
+static void s2n_test_get_list(int window, int num_sids)
+{
+    struct tevent_req *req;
+    char **list;
+    int i;
+
+    dp_opt_set_int(s2n_test->ipa_ctx->ipa_options->basic, IPA_EXTDOM_WINDOW,
+                   window);
+
+    list = talloc_zero_array(s2n_test, char *, num_sids + 1);
+    assert_non_null(list);
+    for (i = 0; i < num_sids; i++) {
+        list[i] = talloc_asprintf(list, "%s-%d", TEST_DOM_SID, 1001 + i);
+        assert_non_null(list[i]);
+    }
+
+    req = ipa_s2n_get_list_send(s2n_test, s2n_test->tctx->ev,
+                                s2n_test->ipa_ctx, s2n_test->tctx->dom,
+                                s2n_test->sh, 10, BE_REQ_BY_SECID, REQ_FULL,
+                                REQ_INP_SECID, list, NULL);
+    assert_non_null(req);
+    tevent_req_set_callback(req, s2n_test_list_done, NULL);
+}
+
+static void assert_group_cached(gid_t gid, bool cached)
+{
+    struct ldb_message *msg;
+    errno_t ret;
+
+    ret = sysdb_search_group_by_gid(s2n_test, s2n_test->tctx->dom, gid,
+                                    NULL, &msg);
+    assert_int_equal(ret, cached ? EOK : ENOENT);
+    if (ret == EOK) {
+        talloc_free(msg);
+    }
+}
+
+static int s2n_test_setup(void **state)
+{
+    struct ipa_options *ipa_options;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    s2n_test = talloc_zero(global_talloc_context, struct s2n_test_ctx);
+    assert_non_null(s2n_test);
+
+    s2n_test->tctx = create_dom_test_ctx(s2n_test, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME, TEST_ID_PROVIDER,
+                                         NULL);
+    assert_non_null(s2n_test->tctx);
+    s2n_test->tctx->dom->domain_id = talloc_strdup(s2n_test->tctx->dom,
+                                                   TEST_DOM_SID);
+    assert_non_null(s2n_test->tctx->dom->domain_id);
+
+    ipa_options = talloc_zero(s2n_test, struct ipa_options);
+    assert_non_null(ipa_options);
+    ret = dp_copy_defaults(ipa_options, ipa_basic_opts, IPA_OPTS_BASIC,
+                           &ipa_options->basic);
+    assert_int_equal(ret, EOK);
+
+    s2n_test->ipa_ctx = talloc_zero(s2n_test, struct ipa_id_ctx);
+    assert_non_null(s2n_test->ipa_ctx);
+    s2n_test->ipa_ctx->ipa_options = ipa_options;
+
+    /* Only the V0 extdom operation is supported */
+    s2n_test->sh = talloc_zero(s2n_test, struct sdap_handle);
+    assert_non_null(s2n_test->sh);
+    s2n_test->sh->supported_extensions.num_vals = 1;
+    s2n_test->sh->supported_extensions.vals = talloc_array(s2n_test->sh,
+                                                           char *, 1);
+    assert_non_null(s2n_test->sh->supported_extensions.vals);
+    s2n_test->sh->supported_extensions.vals[0] = discard_const(EXOP_SID2NAME_OID);
+
+    *state = s2n_test;
+    return 0;
+}
+
+static int s2n_test_teardown(void **state)
+{
+    talloc_zfree(s2n_test);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+/* No more than ipa_extdom_window requests are outstanding, a reply makes room
+ * for the next one */
+static void test_s2n_list_window(void **state)
+{
+    int i;
+
+    s2n_test_get_list(2, 5);
+
+    assert_int_equal(s2n_test->num_sent, 2);
+    assert_int_equal(s2n_test->outstanding, 2);
+
+    s2n_test_reply(1, LDAP_SUCCESS, EOK);
+    assert_int_equal(s2n_test->num_sent, 3);
+    assert_int_equal(s2n_test->outstanding, 2);
+    assert_false(s2n_test->done);
+
+    s2n_test_reply(2, LDAP_SUCCESS, EOK);
+    s2n_test_reply(3, LDAP_SUCCESS, EOK);
+    assert_int_equal(s2n_test->num_sent, 5);
+    assert_int_equal(s2n_test->outstanding, 2);
+    assert_false(s2n_test->done);
+
+    s2n_test_reply(4, LDAP_SUCCESS, EOK);
+    assert_false(s2n_test->done);
+    s2n_test_reply(5, LDAP_SUCCESS, EOK);
+
+    assert_true(s2n_test->done);
+    assert_int_equal(s2n_test->error, EOK);
+    assert_int_equal(s2n_test->max_outstanding, 2);
+    assert_int_equal(s2n_test->outstanding, 0);
+
+    for (i = 0; i < 5; i++) {
+        assert_group_cached(1001 + i, true);
+    }
+}
+
+static void test_s2n_list_out_of_order(void **state)
+{
+    int i;
+
+    s2n_test_get_list(8, 4);
+
+    /* The list is shorter than the window, all requests are sent at once */
+    assert_int_equal(s2n_test->num_sent, 4);
+    assert_int_equal(s2n_test->outstanding, 4);
+
+    s2n_test_reply(3, LDAP_SUCCESS, EOK);
+    s2n_test_reply(4, LDAP_SUCCESS, EOK);
+    s2n_test_reply(1, LDAP_SUCCESS, EOK);
+    assert_false(s2n_test->done);
+
+    /* Every reply is saved for the object it was sent for */
+    assert_group_cached(1001, true);
+    assert_group_cached(1002, false);
+    assert_group_cached(1003, true);
+    assert_group_cached(1004, true);
+
+    s2n_test_reply(2, LDAP_SUCCESS, EOK);
+
+    assert_true(s2n_test->done);
+    assert_int_equal(s2n_test->error, EOK);
+    assert_int_equal(s2n_test->num_sent, 4);
+
+    for (i = 0; i < 4; i++) {
+        assert_group_cached(1001 + i, true);
+    }
+}
+
+/* A failed lookup fails the list and cancels the outstanding requests */
+static void test_s2n_list_error(void **state)
+{
+    s2n_test_get_list(2, 4);
+    assert_int_equal(s2n_test->num_sent, 2);
+
+    s2n_test_reply(2, LDAP_NO_SUCH_OBJECT, EOK);
+
+    assert_true(s2n_test->done);
+    assert_int_equal(s2n_test->error, ENOENT);
+    assert_int_equal(s2n_test->num_sent, 2);
+    assert_int_equal(s2n_test->outstanding, 0);
+    assert_null(s2n_test->ops[1].op);
+
+    assert_group_cached(1001, false);
+    assert_group_cached(1002, false);
+}
+
+static void test_s2n_list_op_error(void **state)
+{
+    s2n_test_get_list(2, 4);
+
+    s2n_test_reply(1, LDAP_SUCCESS, EOK);
+    assert_int_equal(s2n_test->num_sent, 3);
+
+    /* E.g. the operation timed out */
+    s2n_test_reply(3, LDAP_SUCCESS, ETIMEDOUT);
+
+    assert_true(s2n_test->done);
+    assert_int_equal(s2n_test->error, ETIMEDOUT);
+    assert_int_equal(s2n_test->num_sent, 3);
+    assert_int_equal(s2n_test->outstanding, 0);
+
+    assert_group_cached(1001, true);
+    assert_group_cached(1002, false);
+    assert_group_cached(1003, false);
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    int no_cleanup = 0;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        {"no-cleanup", 'n', POPT_ARG_NONE, &no_cleanup, 0,
+         _("Do not delete the test database after a test run"), NULL },
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_s2n_list_window,
+                                        s2n_test_setup,
+                                        s2n_test_teardown),
+        cmocka_unit_test_setup_teardown(test_s2n_list_out_of_order,
+                                        s2n_test_setup,
+                                        s2n_test_teardown),
+        cmocka_unit_test_setup_teardown(test_s2n_list_error,
+                                        s2n_test_setup,
+                                        s2n_test_teardown),
+        cmocka_unit_test_setup_teardown(test_s2n_list_op_error,
+                                        s2n_test_setup,
+                                        s2n_test_teardown),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old DB to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    test_dom_suite_setup(TESTS_PATH);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    if (rv == 0 && !no_cleanup) {
+        test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    }
+    return rv;
+}
@@ -0,0 +1,338 @@
+/*
+    SSSD
+
+    Unit tests for remembering the SELinux labels installed by selinux_child
+
+    Copyright (C) 2019 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <popt.h>
+#include <stdio.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "providers/ipa/ipa_selinux_applied.h"
+
+#define TEST_USER "user@test.example"
+#define TEST_SEUSER "staff_u"
+#define TEST_MLS "s0-s0:c0.c1023"
+
+struct selinux_applied_test_ctx {
+    struct ipa_selinux_ctx *selinux_ctx;
+    char *seusers;
+};
+
+/* The seusers file of the policy is replaced by a temporary file */
+static const char *test_seusers_path;
+
+const char *__wrap_selinux_usersconf_path(void)
+{
+    return test_seusers_path;
+}
+
+static void write_seusers(const char *path, const char *content)
+{
+    FILE *f;
+
+    f = fopen(path, "w");
+    assert_non_null(f);
+    assert_int_equal(fputs(content, f) >= 0, true);
+    assert_int_equal(fclose(f), 0);
+}
+
+static int selinux_applied_test_setup(void **state)
+{
+    struct selinux_applied_test_ctx *test_ctx;
+    int fd;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context,
+                           struct selinux_applied_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->selinux_ctx = talloc_zero(test_ctx, struct ipa_selinux_ctx);
+    assert_non_null(test_ctx->selinux_ctx);
+
+    test_ctx->seusers = talloc_strdup(test_ctx, "test_seusers.XXXXXX");
+    assert_non_null(test_ctx->seusers);
+
+    fd = mkstemp(test_ctx->seusers);
+    assert_int_not_equal(fd, -1);
+    close(fd);
+
+    write_seusers(test_ctx->seusers, "__default__:user_u:s0\n");
+    test_seusers_path = test_ctx->seusers;
+
+    check_leaks_push(test_ctx);
+    *state = test_ctx;
+    return 0;
+}
+
+static int selinux_applied_test_teardown(void **state)
+{
+    struct selinux_applied_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_applied_test_ctx);
+
+    /* the memo itself belongs to the SELinux context */
+    talloc_zfree(test_ctx->selinux_ctx->applied);
+    assert_true(check_leaks_pop(test_ctx));
+
+    unlink(test_ctx->seusers);
+    test_seusers_path = NULL;
+
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void test_selinux_applied_empty(void **state)
+{
+    struct selinux_applied_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_applied_test_ctx);
+
+    assert_false(ipa_selinux_label_is_applied(test_ctx->selinux_ctx,
+                                              TEST_USER, TEST_SEUSER,
+                                              TEST_MLS));
+}
+
+static void test_selinux_applied_unchanged(void **state)
+{
+    struct selinux_applied_test_ctx *test_ctx;
+    struct ipa_selinux_ctx *selinux_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_applied_test_ctx);
+    selinux_ctx = test_ctx->selinux_ctx;
+
+    ipa_selinux_label_remember(selinux_ctx, TEST_USER, TEST_SEUSER, TEST_MLS);
+
+    /* the same label is not installed again */
+    assert_true(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                             TEST_SEUSER, TEST_MLS));
+    assert_true(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                             TEST_SEUSER, TEST_MLS));
+
+    /* a different label or user is */
+    assert_false(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                              "user_u", TEST_MLS));
+    assert_false(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                              TEST_SEUSER, "s0"));
+    assert_false(ipa_selinux_label_is_applied(selinux_ctx,
+                                              "other@test.example",
+                                              TEST_SEUSER, TEST_MLS));
+}
+
+static void test_selinux_applied_label_changed(void **state)
+{
+    struct selinux_applied_test_ctx *test_ctx;
+    struct ipa_selinux_ctx *selinux_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_applied_test_ctx);
+    selinux_ctx = test_ctx->selinux_ctx;
+
+    ipa_selinux_label_remember(selinux_ctx, TEST_USER, TEST_SEUSER, TEST_MLS);
+    ipa_selinux_label_remember(selinux_ctx, TEST_USER, "user_u", "s0");
+
+    /* only the label installed last is remembered */
+    assert_false(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                              TEST_SEUSER, TEST_MLS));
+    assert_true(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                             "user_u", "s0"));
+    assert_int_equal(hash_count(selinux_ctx->applied), 1);
+}
+
+static void test_selinux_applied_seusers_modified(void **state)
+{
+    struct selinux_applied_test_ctx *test_ctx;
+    struct ipa_selinux_ctx *selinux_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_applied_test_ctx);
+    selinux_ctx = test_ctx->selinux_ctx;
+
+    ipa_selinux_label_remember(selinux_ctx, TEST_USER, TEST_SEUSER, TEST_MLS);
+    assert_true(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                             TEST_SEUSER, TEST_MLS));
+
+    /* somebody else changed the login mappings, the label is installed
+     * again */
+    write_seusers(test_ctx->seusers,
+                  "__default__:user_u:s0\nroot:unconfined_u:s0-s0:c0.c1023\n");
+    assert_false(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                              TEST_SEUSER, TEST_MLS));
+
+    /* and skipped once it was */
+    ipa_selinux_label_remember(selinux_ctx, TEST_USER, TEST_SEUSER, TEST_MLS);
+    assert_true(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                             TEST_SEUSER, TEST_MLS));
+}
+
+static void test_selinux_applied_seusers_replaced(void **state)
+{
+    struct selinux_applied_test_ctx *test_ctx;
+    struct ipa_selinux_ctx *selinux_ctx;
+    char *replacement;
+    int fd;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_applied_test_ctx);
+    selinux_ctx = test_ctx->selinux_ctx;
+
+    ipa_selinux_label_remember(selinux_ctx, TEST_USER, TEST_SEUSER, TEST_MLS);
+
+    /* semanage writes a new file and renames it over the old one, the
+     * content may even have the same size */
+    replacement = talloc_strdup(test_ctx, "test_seusers_new.XXXXXX");
+    assert_non_null(replacement);
+    fd = mkstemp(replacement);
+    assert_int_not_equal(fd, -1);
+    close(fd);
+    write_seusers(replacement, "__default__:user_u:s1\n");
+    assert_int_equal(rename(replacement, test_ctx->seusers), 0);
+    talloc_free(replacement);
+
+    assert_false(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                              TEST_SEUSER, TEST_MLS));
+}
+
+static void test_selinux_applied_forget(void **state)
+{
+    struct selinux_applied_test_ctx *test_ctx;
+    struct ipa_selinux_ctx *selinux_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_applied_test_ctx);
+    selinux_ctx = test_ctx->selinux_ctx;
+
+    ipa_selinux_label_remember(selinux_ctx, TEST_USER, TEST_SEUSER, TEST_MLS);
+
+    /* selinux_child failed, the label must be installed next time */
+    ipa_selinux_label_forget(selinux_ctx, TEST_USER);
+    assert_false(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                              TEST_SEUSER, TEST_MLS));
+
+    /* forgetting an unknown user is harmless */
+    ipa_selinux_label_forget(selinux_ctx, "other@test.example");
+}
+
+static void test_selinux_applied_no_seusers(void **state)
+{
+    struct selinux_applied_test_ctx *test_ctx;
+    struct ipa_selinux_ctx *selinux_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_applied_test_ctx);
+    selinux_ctx = test_ctx->selinux_ctx;
+
+    /* without the seusers file there is nothing to compare against */
+    assert_int_equal(unlink(test_ctx->seusers), 0);
+    ipa_selinux_label_remember(selinux_ctx, TEST_USER, TEST_SEUSER, TEST_MLS);
+    assert_false(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                              TEST_SEUSER, TEST_MLS));
+
+    /* the same holds when the file vanishes after the label was installed */
+    write_seusers(test_ctx->seusers, "__default__:user_u:s0\n");
+    ipa_selinux_label_remember(selinux_ctx, TEST_USER, TEST_SEUSER, TEST_MLS);
+    assert_true(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                             TEST_SEUSER, TEST_MLS));
+    assert_int_equal(unlink(test_ctx->seusers), 0);
+    assert_false(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                              TEST_SEUSER, TEST_MLS));
+}
+
+static void test_selinux_applied_limit(void **state)
+{
+    struct selinux_applied_test_ctx *test_ctx;
+    struct ipa_selinux_ctx *selinux_ctx;
+    char *username;
+    size_t i;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_applied_test_ctx);
+    selinux_ctx = test_ctx->selinux_ctx;
+
+    for (i = 0; i < SELINUX_APPLIED_MAX; i++) {
+        username = talloc_asprintf(test_ctx, "user%zu@test.example", i);
+        assert_non_null(username);
+        ipa_selinux_label_remember(selinux_ctx, username,
+                                   TEST_SEUSER, TEST_MLS);
+        talloc_free(username);
+    }
+    assert_int_equal(hash_count(selinux_ctx->applied), SELINUX_APPLIED_MAX);
+
+    /* the memo is started over instead of growing without bounds */
+    ipa_selinux_label_remember(selinux_ctx, TEST_USER, TEST_SEUSER, TEST_MLS);
+    assert_int_equal(hash_count(selinux_ctx->applied), 1);
+    assert_true(ipa_selinux_label_is_applied(selinux_ctx, TEST_USER,
+                                             TEST_SEUSER, TEST_MLS));
+    assert_false(ipa_selinux_label_is_applied(selinux_ctx,
+                                              "user0@test.example",
+                                              TEST_SEUSER, TEST_MLS));
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_selinux_applied_empty,
+                                        selinux_applied_test_setup,
+                                        selinux_applied_test_teardown),
+        cmocka_unit_test_setup_teardown(test_selinux_applied_unchanged,
+                                        selinux_applied_test_setup,
+                                        selinux_applied_test_teardown),
+        cmocka_unit_test_setup_teardown(test_selinux_applied_label_changed,
+                                        selinux_applied_test_setup,
+                                        selinux_applied_test_teardown),
+        cmocka_unit_test_setup_teardown(test_selinux_applied_seusers_modified,
+                                        selinux_applied_test_setup,
+                                        selinux_applied_test_teardown),
+        cmocka_unit_test_setup_teardown(test_selinux_applied_seusers_replaced,
+                                        selinux_applied_test_setup,
+                                        selinux_applied_test_teardown),
+        cmocka_unit_test_setup_teardown(test_selinux_applied_forget,
+                                        selinux_applied_test_setup,
+                                        selinux_applied_test_teardown),
+        cmocka_unit_test_setup_teardown(test_selinux_applied_no_seusers,
+                                        selinux_applied_test_setup,
+                                        selinux_applied_test_teardown),
+        cmocka_unit_test_setup_teardown(test_selinux_applied_limit,
+                                        selinux_applied_test_setup,
+                                        selinux_applied_test_teardown),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    tests_set_cwd();
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -68,8 +68,16 @@
 #define ONEWAY_PRINC    DOM_FLAT"$"
 #define ONEWAY_AUTHID   ONEWAY_PRINC"@"SUBDOM_REALM
 
+/* One more forest than can be set up at the same time */
+#define NUM_FORESTS (IPA_TRUST_SETUP_MAX_RUNNING + 1)
+
 static bool global_rename_called;
 
+/* Keytab retrievals started and not finished yet */
+static int global_kt_started;
+static int global_kt_running;
+static int global_kt_max_running;
+
 #ifdef HAVE_SELINUX
 /* Provide faster implementation of Kerberos function
  * krb5int_labeled_[f]?open. Real functions take care also
@@ -151,6 +159,10 @@ errno_t __wrap_sss_unique_filename(TALLOC_CTX *owner, char *path_tmpl)
 
         sret = setenv("TEST_KT_ENV", path_tmpl, 1);
         assert_int_equal(sret, 0);
+
+        global_kt_started++;
+        global_kt_running++;
+        global_kt_max_running = MAX(global_kt_max_running, global_kt_running);
     }
     return ret;
 }
@@ -160,6 +172,7 @@ int __real_rename(const char *old, const char *new);
 int __wrap_rename(const char *old, const char *new)
 {
     global_rename_called = true;
+    global_kt_running--;
     return __real_rename(old, new);
 }
 
@@ -314,6 +327,9 @@ static int test_ipa_server_create_trusts_setup(void **state)
     mock_keytab_with_contents(test_ctx, KEYTAB_PATH, KEYTAB_TEST_PRINC);
 
     global_rename_called = false;
+    global_kt_started = 0;
+    global_kt_running = 0;
+    global_kt_max_running = 0;
 
     *state = test_ctx;
     return 0;
@@ -907,6 +923,109 @@ static void test_ipa_server_trust_oneway_init(void **state)
     assert_non_null(test_ctx->ipa_ctx->server_mode->trusts);
 }
 
+static void add_test_forests(struct trust_test_ctx *test_ctx)
+{
+    const char *name;
+    const char *realm;
+    const char *flat;
+    const char *sid;
+    errno_t ret;
+    int i;
+
+    for (i = 0; i < NUM_FORESTS; i++) {
+        name = talloc_asprintf(test_ctx, "forest%d.test", i);
+        realm = talloc_asprintf(test_ctx, "FOREST%d.TEST", i);
+        flat = talloc_asprintf(test_ctx, "FOREST%d", i);
+        sid = talloc_asprintf(test_ctx, "S-1-5-21-1-2-%d", i);
+        assert_non_null(name);
+        assert_non_null(realm);
+        assert_non_null(flat);
+        assert_non_null(sid);
+
+        ret = sysdb_subdomain_store(test_ctx->tctx->sysdb,
+                                    name, realm, flat, sid,
+                                    MPG_ENABLED, false, realm,
+                                    0x1 | 0x2, NULL);
+        assert_int_equal(ret, EOK);
+    }
+
+    /* A child domain shares the keytab of its forest */
+    ret = sysdb_subdomain_store(test_ctx->tctx->sysdb,
+                                "child.forest0.test", "CHILD.FOREST0.TEST",
+                                "CHILD0", "S-1-5-21-1-2-0-1",
+                                MPG_ENABLED, false, "FOREST0.TEST",
+                                0x1 | 0x2, NULL);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_update_subdomains(test_ctx->tctx->dom, test_ctx->tctx->confdb);
+    assert_int_equal(ret, EOK);
+}
+
+static void test_ipa_server_create_forests_done(struct tevent_req *req);
+
+static void test_ipa_server_create_forests(void **state)
+{
+    struct trust_test_ctx *test_ctx =
+        talloc_get_type(*state, struct trust_test_ctx);
+    struct tevent_req *req;
+    char *keytab;
+    errno_t ret;
+    int i;
+
+    add_test_forests(test_ctx);
+
+    req = ipa_server_create_trusts_send(test_ctx,
+                                        test_ctx->tctx->ev,
+                                        test_ctx->be_ctx,
+                                        test_ctx->ipa_ctx,
+                                        test_ctx->be_ctx->domain);
+    assert_non_null(req);
+
+    /* The first forests are set up at the same time, the last one waits
+     * until one of them is done */
+    assert_int_equal(global_kt_running, IPA_TRUST_SETUP_MAX_RUNNING);
+
+    tevent_req_set_callback(req, test_ipa_server_create_forests_done,
+                            test_ctx);
+
+    ret = test_ev_loop(test_ctx->tctx);
+    assert_int_equal(ret, ERR_OK);
+
+    for (i = 0; i < NUM_FORESTS; i++) {
+        keytab = talloc_asprintf(test_ctx, "%s/FOREST%d.TEST.keytab",
+                                 IPA_TRUST_KEYTAB_DIR, i);
+        assert_non_null(keytab);
+        ret = unlink(keytab);
+        assert_int_equal(ret, 0);
+        talloc_free(keytab);
+    }
+}
+
+static void test_ipa_server_create_forests_done(struct tevent_req *req)
+{
+    struct trust_test_ctx *test_ctx = \
+        tevent_req_callback_data(req, struct trust_test_ctx);
+    struct ipa_ad_server_ctx *trust;
+    size_t num_trusts = 0;
+    errno_t ret;
+
+    ret = ipa_server_create_trusts_recv(req);
+    talloc_zfree(req);
+    assert_int_equal(ret, EOK);
+
+    /* One keytab per forest, never more retrievals at once than allowed */
+    assert_int_equal(global_kt_started, NUM_FORESTS);
+    assert_int_equal(global_kt_running, 0);
+    assert_int_equal(global_kt_max_running, IPA_TRUST_SETUP_MAX_RUNNING);
+
+    DLIST_FOR_EACH(trust, test_ctx->ipa_ctx->server_mode->trusts) {
+        num_trusts++;
+    }
+    assert_int_equal(num_trusts, NUM_FORESTS + 1);
+
+    test_ev_done(test_ctx->tctx, EOK);
+}
+
 static void test_ipa_trust_dir2str(void **state)
 {
     /* Just make sure the caller can rely on getting a valid string.. */
@@ -955,6 +1074,9 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_ipa_server_create_trusts,
                                         test_ipa_server_create_trusts_setup,
                                         test_ipa_server_create_trusts_teardown),
+        cmocka_unit_test_setup_teardown(test_ipa_server_create_forests,
+                                        test_ipa_server_create_trusts_setup,
+                                        test_ipa_server_create_trusts_teardown),
 
         cmocka_unit_test_setup_teardown(test_get_trust_direction_inbound,
                                         test_get_trust_direction_setup,
@@ -0,0 +1,422 @@
+/*
+    Copyright (C) 2026 Red Hat
+
+    SSSD tests: Test KCM binary ccache marshalling
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <popt.h>
+
+#include "util/util_creds.h"
+#include "responder/kcm/kcmsrv_ccache.h"
+#include "responder/kcm/kcmsrv_ccache_be.h"
+#include "tests/cmocka/common_mock.h"
+
+#define TEST_REALM                "TESTREALM"
+#define TEST_PRINC_COMPONENT      "PRINC_NAME"
+
+#define TEST_CREDS                "TESTCREDS"
+
+const struct kcm_ccdb_ops ccdb_mem_ops;
+const struct kcm_ccdb_ops ccdb_sec_ops;
+
+struct kcm_marshalling_test_ctx {
+    krb5_context kctx;
+    krb5_principal princ;
+};
+
+static int setup_kcm_marshalling(void **state)
+{
+    struct kcm_marshalling_test_ctx *test_ctx;
+    krb5_error_code kerr;
+
+    test_ctx = talloc_zero(NULL, struct kcm_marshalling_test_ctx);
+    assert_non_null(test_ctx);
+
+    kerr = krb5_init_context(&test_ctx->kctx);
+    assert_int_equal(kerr, 0);
+
+    kerr = krb5_build_principal(test_ctx->kctx,
+                                &test_ctx->princ,
+                                sizeof(TEST_REALM)-1, TEST_REALM,
+                                TEST_PRINC_COMPONENT, NULL);
+    assert_int_equal(kerr, 0);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int teardown_kcm_marshalling(void **state)
+{
+    struct kcm_marshalling_test_ctx *test_ctx = talloc_get_type(*state,
+                                        struct kcm_marshalling_test_ctx);
+    assert_non_null(test_ctx);
+
+    krb5_free_principal(test_ctx->kctx, test_ctx->princ);
+    krb5_free_context(test_ctx->kctx);
+    talloc_free(test_ctx);
+    return 0;
+}
+
+static void assert_cc_name_equal(struct kcm_ccache *cc1,
+                                 struct kcm_ccache *cc2)
+{
+    const char *name1, *name2;
+
+    name1 = kcm_cc_get_name(cc1);
+    name2 = kcm_cc_get_name(cc2);
+    assert_string_equal(name1, name2);
+}
+
+static void assert_cc_uuid_equal(struct kcm_ccache *cc1,
+                                 struct kcm_ccache *cc2)
+{
+    uuid_t u1, u2;
+    errno_t ret;
+
+    ret = kcm_cc_get_uuid(cc1, u1);
+    assert_int_equal(ret, EOK);
+    ret = kcm_cc_get_uuid(cc2, u2);
+    assert_int_equal(ret, EOK);
+    ret = uuid_compare(u1, u2);
+    assert_int_equal(ret, 0);
+}
+
+static void assert_cc_princ_equal(struct kcm_ccache *cc1,
+                                  struct kcm_ccache *cc2)
+{
+    krb5_principal p1;
+    krb5_principal p2;
+    char *name1;
+    char *name2;
+    krb5_error_code kerr;
+
+    p1 = kcm_cc_get_client_principal(cc1);
+    p2 = kcm_cc_get_client_principal(cc2);
+
+    if (p1 != NULL && p2 != NULL) {
+        kerr = krb5_unparse_name(NULL, p1, &name1);
+        assert_int_equal(kerr, 0);
+        kerr = krb5_unparse_name(NULL, p2, &name2);
+        assert_int_equal(kerr, 0);
+
+        assert_string_equal(name1, name2);
+        krb5_free_unparsed_name(NULL, name1);
+        krb5_free_unparsed_name(NULL, name2);
+    } else {
+        /* Either both principals must be NULL or both
+         * non-NULL and represent the same principals
+         */
+        assert_null(p1);
+        assert_null(p2);
+    }
+}
+
+static void assert_cc_offset_equal(struct kcm_ccache *cc1,
+                                   struct kcm_ccache *cc2)
+{
+    int32_t off1;
+    int32_t off2;
+
+    off1 = kcm_cc_get_offset(cc1);
+    off2 = kcm_cc_get_offset(cc2);
+    assert_int_equal(off1, off2);
+}
+
+static void assert_cc_equal(struct kcm_ccache *cc1,
+                            struct kcm_ccache *cc2)
+{
+    assert_cc_name_equal(cc1, cc2);
+    assert_cc_uuid_equal(cc1, cc2);
+    assert_cc_princ_equal(cc1, cc2);
+    assert_cc_offset_equal(cc1, cc2);
+}
+
+static void assert_cred_blob_equal(struct kcm_cred *crd,
+                                   const char *blob)
+{
+    struct sss_iobuf *cred_blob;
+
+    assert_non_null(crd);
+    cred_blob = kcm_cred_get_creds(crd);
+    assert_non_null(cred_blob);
+    assert_int_equal(sss_iobuf_get_size(cred_blob), strlen(blob) + 1);
+    assert_string_equal((const char *) sss_iobuf_get_data(cred_blob), blob);
+}
+
+static void store_test_cred(struct kcm_ccache *cc, const char *blob)
+{
+    struct sss_iobuf *cred_blob;
+    errno_t ret;
+
+    cred_blob = sss_iobuf_init_readonly(cc, (const uint8_t *) blob,
+                                        strlen(blob) + 1);
+    assert_non_null(cred_blob);
+
+    ret = kcm_cc_store_cred_blob(cc, cred_blob);
+    assert_int_equal(ret, EOK);
+}
+
+static void test_kcm_ccache_binary(void **state)
+{
+    struct kcm_marshalling_test_ctx *test_ctx = talloc_get_type(*state,
+                                        struct kcm_marshalling_test_ctx);
+    errno_t ret;
+    struct cli_creds owner;
+    struct kcm_ccache *cc;
+    struct kcm_ccache *cc2;
+    struct kcm_cred *crd;
+    struct sss_iobuf *payload;
+    struct sss_iobuf *payload2;
+    struct sss_iobuf *json_payload;
+    struct sss_iobuf *cred_blob;
+    const char *name;
+    const char *key;
+    uuid_t uuid;
+
+    owner.ucred.uid = getuid();
+    owner.ucred.gid = getuid();
+
+    name = talloc_asprintf(test_ctx, "%"SPRIuid, getuid());
+    assert_non_null(name);
+
+    ret = kcm_cc_new(test_ctx,
+                     test_ctx->kctx,
+                     &owner,
+                     name,
+                     test_ctx->princ,
+                     &cc);
+    assert_int_equal(ret, EOK);
+
+    store_test_cred(cc, TEST_CREDS"1");
+    store_test_cred(cc, TEST_CREDS"2");
+
+    ret = kcm_ccache_to_sec_binary(test_ctx, cc, &payload);
+    assert_int_equal(ret, EOK);
+    assert_true(kcm_ccache_sec_value_is_binary(payload));
+
+    ret = kcm_cc_get_uuid(cc, uuid);
+    assert_int_equal(ret, EOK);
+    key = sec_key_create(test_ctx, name, uuid);
+    assert_non_null(key);
+
+    ret = sec_binary_to_ccache(test_ctx, key, payload, &owner, &cc2);
+    assert_int_equal(ret, EOK);
+    assert_cc_equal(cc, cc2);
+
+    /* The newest credential comes first, like in the original ccache */
+    crd = kcm_cc_get_cred(cc2);
+    assert_cred_blob_equal(crd, TEST_CREDS"2");
+    crd = kcm_cc_next_cred(crd);
+    assert_cred_blob_equal(crd, TEST_CREDS"1");
+    assert_null(kcm_cc_next_cred(crd));
+
+    /* Appending a credential does not touch the others */
+    cred_blob = sss_iobuf_init_readonly(test_ctx,
+                                        (const uint8_t *) TEST_CREDS"3",
+                                        sizeof(TEST_CREDS"3"));
+    assert_non_null(cred_blob);
+    uuid_generate(uuid);
+    crd = kcm_cred_new(test_ctx, uuid, cred_blob);
+    assert_non_null(crd);
+
+    ret = kcm_ccache_sec_binary_add_cred(test_ctx, payload, crd, &payload2);
+    assert_int_equal(ret, EOK);
+    assert_memory_equal(sss_iobuf_get_data(payload2),
+                        sss_iobuf_get_data(payload),
+                        sss_iobuf_get_size(payload));
+
+    talloc_free(cc2);
+    ret = sec_binary_to_ccache(test_ctx, key, payload2, &owner, &cc2);
+    assert_int_equal(ret, EOK);
+    assert_cc_equal(cc, cc2);
+
+    crd = kcm_cc_get_cred(cc2);
+    assert_cred_blob_equal(crd, TEST_CREDS"3");
+    crd = kcm_cc_next_cred(crd);
+    assert_cred_blob_equal(crd, TEST_CREDS"2");
+    crd = kcm_cc_next_cred(crd);
+    assert_cred_blob_equal(crd, TEST_CREDS"1");
+    assert_null(kcm_cc_next_cred(crd));
+
+    /* A truncated value must be rejected */
+    payload2 = sss_iobuf_init_readonly(test_ctx,
+                                       sss_iobuf_get_data(payload),
+                                       sss_iobuf_get_size(payload) - 1);
+    assert_non_null(payload2);
+    ret = sec_binary_to_ccache(test_ctx, key, payload2, &owner, &cc2);
+    assert_int_not_equal(ret, EOK);
+
+    /* Values in the old format are recognized as such */
+    ret = kcm_ccache_to_sec_input(test_ctx, cc, &owner, &json_payload);
+    assert_int_equal(ret, EOK);
+    assert_false(kcm_ccache_sec_value_is_binary(json_payload));
+    ret = kcm_ccache_sec_binary_add_cred(test_ctx, json_payload, crd,
+                                         &payload2);
+    assert_int_equal(ret, EINVAL);
+}
+
+static void test_kcm_ccache_binary_no_princ(void **state)
+{
+    struct kcm_marshalling_test_ctx *test_ctx = talloc_get_type(*state,
+                                        struct kcm_marshalling_test_ctx);
+    errno_t ret;
+    struct cli_creds owner;
+    struct kcm_ccache *cc;
+    struct kcm_ccache *cc2;
+    struct sss_iobuf *payload;
+    const char *name;
+    const char *key;
+    uuid_t uuid;
+
+    owner.ucred.uid = getuid();
+    owner.ucred.gid = getuid();
+
+    name = talloc_asprintf(test_ctx, "%"SPRIuid, getuid());
+    assert_non_null(name);
+
+    ret = kcm_cc_new(test_ctx,
+                     test_ctx->kctx,
+                     &owner,
+                     name,
+                     NULL,
+                     &cc);
+    assert_int_equal(ret, EOK);
+
+    ret = kcm_ccache_to_sec_binary(test_ctx, cc, &payload);
+    assert_int_equal(ret, EOK);
+
+    ret = kcm_cc_get_uuid(cc, uuid);
+    assert_int_equal(ret, EOK);
+    key = sec_key_create(test_ctx, name, uuid);
+    assert_non_null(key);
+
+    ret = sec_binary_to_ccache(test_ctx, key, payload, &owner, &cc2);
+    assert_int_equal(ret, EOK);
+
+    assert_null(kcm_cc_get_client_principal(cc2));
+    assert_null(kcm_cc_get_cred(cc2));
+    assert_cc_equal(cc, cc2);
+}
+
+/* Principal components are counted data, not strings */
+static void test_kcm_ccache_binary_nul_in_princ(void **state)
+{
+    struct kcm_marshalling_test_ctx *test_ctx = talloc_get_type(*state,
+                                        struct kcm_marshalling_test_ctx);
+    const char component[] = { 'a', '\0', 'b' };
+    errno_t ret;
+    krb5_error_code kerr;
+    krb5_principal princ;
+    krb5_principal princ2;
+    struct cli_creds owner;
+    struct kcm_ccache *cc;
+    struct kcm_ccache *cc2;
+    struct sss_iobuf *payload;
+    const char *name;
+    const char *key;
+    uuid_t uuid;
+
+    owner.ucred.uid = getuid();
+    owner.ucred.gid = getuid();
+
+    name = talloc_asprintf(test_ctx, "%"SPRIuid, getuid());
+    assert_non_null(name);
+
+    kerr = krb5_build_principal_ext(test_ctx->kctx, &princ,
+                                    sizeof(TEST_REALM) - 1, TEST_REALM,
+                                    sizeof(component), component,
+                                    0);
+    assert_int_equal(kerr, 0);
+
+    ret = kcm_cc_new(test_ctx,
+                     test_ctx->kctx,
+                     &owner,
+                     name,
+                     princ,
+                     &cc);
+    krb5_free_principal(test_ctx->kctx, princ);
+    assert_int_equal(ret, EOK);
+
+    ret = kcm_ccache_to_sec_binary(test_ctx, cc, &payload);
+    assert_int_equal(ret, EOK);
+
+    ret = kcm_cc_get_uuid(cc, uuid);
+    assert_int_equal(ret, EOK);
+    key = sec_key_create(test_ctx, name, uuid);
+    assert_non_null(key);
+
+    ret = sec_binary_to_ccache(test_ctx, key, payload, &owner, &cc2);
+    assert_int_equal(ret, EOK);
+
+    princ2 = kcm_cc_get_client_principal(cc2);
+    assert_non_null(princ2);
+    assert_int_equal(princ2->length, 1);
+    assert_int_equal(princ2->data[0].length, sizeof(component));
+    assert_memory_equal(princ2->data[0].data, component, sizeof(component));
+    assert_int_equal(princ2->data[0].data[sizeof(component)], '\0');
+    assert_int_equal(princ2->realm.length, sizeof(TEST_REALM) - 1);
+    assert_string_equal(princ2->realm.data, TEST_REALM);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    int rv;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_kcm_ccache_binary,
+                                        setup_kcm_marshalling,
+                                        teardown_kcm_marshalling),
+        cmocka_unit_test_setup_teardown(test_kcm_ccache_binary_no_princ,
+                                        setup_kcm_marshalling,
+                                        teardown_kcm_marshalling),
+        cmocka_unit_test_setup_teardown(test_kcm_ccache_binary_nul_in_princ,
+                                        setup_kcm_marshalling,
+                                        teardown_kcm_marshalling),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    tests_set_cwd();
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+
+    return rv;
+}
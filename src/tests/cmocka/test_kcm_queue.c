@@ -30,6 +30,10 @@
 #define INVALID_ID      -1
 #define FAST_REQ_ID     0
 #define SLOW_REQ_ID     1
+#define LATE_REQ_ID     2
+
+#define TEST_CCNAME     "1000:1"
+#define TEST_CCNAME2    "1000:2"
 
 #define FAST_REQ_DELAY  1
 #define SLOW_REQ_DELAY  2
@@ -54,6 +58,8 @@ static struct tevent_req *timed_request_send(TALLOC_CTX *mem_ctx,
                                              struct tevent_context *ev,
                                              struct kcm_ops_queue_ctx *qctx,
                                              struct cli_creds *client,
+                                             const char *ccname,
+                                             bool exclusive,
                                              int delay,
                                              int req_id)
 {
@@ -73,7 +79,7 @@ static struct tevent_req *timed_request_send(TALLOC_CTX *mem_ctx,
 
     DEBUG(SSSDBG_TRACE_ALL, "Request %p with delay %d\n", req, delay);
 
-    subreq = kcm_op_queue_send(state, ev, qctx, client);
+    subreq = kcm_op_queue_send(state, ev, qctx, client, ccname, exclusive);
     if (subreq == NULL) {
         return NULL;
     }
@@ -211,7 +217,7 @@ static void test_kcm_queue_single(void **state)
     req = timed_request_send(test_ctx,
                              test_ctx->ev,
                              test_ctx->qctx,
-                             &client, 1, 0);
+                             &client, NULL, true, 1, 0);
     assert_non_null(req);
     tevent_req_set_callback(req, test_kcm_queue_done, test_ctx);
 
@@ -244,6 +250,7 @@ static void test_kcm_queue_multi_same_id(void **state)
                              test_ctx->ev,
                              test_ctx->qctx,
                              &client,
+                             NULL, true,
                              SLOW_REQ_DELAY,
                              SLOW_REQ_ID);
     assert_non_null(req);
@@ -253,6 +260,7 @@ static void test_kcm_queue_multi_same_id(void **state)
                              test_ctx->ev,
                              test_ctx->qctx,
                              &client,
+                             NULL, true,
                              FAST_REQ_DELAY,
                              FAST_REQ_ID);
     assert_non_null(req);
@@ -289,6 +297,7 @@ static void test_kcm_queue_multi_different_id(void **state)
                              test_ctx->ev,
                              test_ctx->qctx,
                              &client,
+                             NULL, true,
                              SLOW_REQ_DELAY,
                              SLOW_REQ_ID);
     assert_non_null(req);
@@ -301,6 +310,7 @@ static void test_kcm_queue_multi_different_id(void **state)
                              test_ctx->ev,
                              test_ctx->qctx,
                              &client,
+                             NULL, true,
                              FAST_REQ_DELAY,
                              FAST_REQ_ID);
     assert_non_null(req);
@@ -315,6 +325,110 @@ static void test_kcm_queue_multi_different_id(void **state)
     assert_int_equal(test_ctx->error, EOK);
 }
 
+static void test_kcm_queue_add(struct test_ctx *test_ctx,
+                               const char *ccname,
+                               bool exclusive,
+                               int delay,
+                               int req_id)
+{
+    struct tevent_req *req;
+    struct cli_creds client;
+
+    client.ucred.uid = getuid();
+    client.ucred.gid = getgid();
+
+    req = timed_request_send(test_ctx,
+                             test_ctx->ev,
+                             test_ctx->qctx,
+                             &client,
+                             ccname, exclusive,
+                             delay, req_id);
+    assert_non_null(req);
+    tevent_req_set_callback(req, test_kcm_queue_done, test_ctx);
+}
+
+static void test_kcm_queue_run(struct test_ctx *test_ctx,
+                               int *req_ids,
+                               int num_requests)
+{
+    test_ctx->num_requests = num_requests;
+    test_ctx->req_ids = req_ids;
+
+    while (test_ctx->done == false) {
+        tevent_loop_once(test_ctx->ev);
+    }
+    assert_int_equal(test_ctx->error, EOK);
+}
+
+/*
+ * Test that requests reading the same ccache run concurrently
+ */
+static void test_kcm_queue_readers(void **state)
+{
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+    static int req_ids[] = { FAST_REQ_ID, SLOW_REQ_ID };
+
+    test_kcm_queue_add(test_ctx, TEST_CCNAME, false,
+                       SLOW_REQ_DELAY, SLOW_REQ_ID);
+    test_kcm_queue_add(test_ctx, TEST_CCNAME, false,
+                       FAST_REQ_DELAY, FAST_REQ_ID);
+
+    test_kcm_queue_run(test_ctx, req_ids, 2);
+}
+
+/*
+ * Test that a request modifying a ccache waits for the readers
+ */
+static void test_kcm_queue_writer_waits(void **state)
+{
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+    static int req_ids[] = { SLOW_REQ_ID, FAST_REQ_ID };
+
+    test_kcm_queue_add(test_ctx, TEST_CCNAME, false,
+                       SLOW_REQ_DELAY, SLOW_REQ_ID);
+    test_kcm_queue_add(test_ctx, TEST_CCNAME, true,
+                       FAST_REQ_DELAY, FAST_REQ_ID);
+
+    test_kcm_queue_run(test_ctx, req_ids, 2);
+}
+
+/*
+ * Test that requests modifying different ccaches run concurrently, but
+ * a request on all ccaches of the user waits for both
+ */
+static void test_kcm_queue_different_ccache(void **state)
+{
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+    static int req_ids[] = { FAST_REQ_ID, SLOW_REQ_ID, LATE_REQ_ID };
+
+    test_kcm_queue_add(test_ctx, TEST_CCNAME, true,
+                       SLOW_REQ_DELAY, SLOW_REQ_ID);
+    test_kcm_queue_add(test_ctx, TEST_CCNAME2, true,
+                       FAST_REQ_DELAY, FAST_REQ_ID);
+    test_kcm_queue_add(test_ctx, NULL, false,
+                       FAST_REQ_DELAY, LATE_REQ_ID);
+
+    test_kcm_queue_run(test_ctx, req_ids, 3);
+}
+
+/*
+ * Test that a waiting writer is not starved by readers that come after it
+ */
+static void test_kcm_queue_no_starvation(void **state)
+{
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+    static int req_ids[] = { SLOW_REQ_ID, FAST_REQ_ID, LATE_REQ_ID };
+
+    test_kcm_queue_add(test_ctx, TEST_CCNAME, false,
+                       SLOW_REQ_DELAY, SLOW_REQ_ID);
+    test_kcm_queue_add(test_ctx, TEST_CCNAME, true,
+                       FAST_REQ_DELAY, FAST_REQ_ID);
+    test_kcm_queue_add(test_ctx, TEST_CCNAME, false,
+                       FAST_REQ_DELAY, LATE_REQ_ID);
+
+    test_kcm_queue_run(test_ctx, req_ids, 3);
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -336,6 +450,18 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_kcm_queue_multi_different_id,
                                         setup_kcm_queue,
                                         teardown_kcm_queue),
+        cmocka_unit_test_setup_teardown(test_kcm_queue_readers,
+                                        setup_kcm_queue,
+                                        teardown_kcm_queue),
+        cmocka_unit_test_setup_teardown(test_kcm_queue_writer_waits,
+                                        setup_kcm_queue,
+                                        teardown_kcm_queue),
+        cmocka_unit_test_setup_teardown(test_kcm_queue_different_ccache,
+                                        setup_kcm_queue,
+                                        teardown_kcm_queue),
+        cmocka_unit_test_setup_teardown(test_kcm_queue_no_starvation,
+                                        setup_kcm_queue,
+                                        teardown_kcm_queue),
     };
 
     /* Set debug level to invalid value so we can decide if -d 0 was used. */
@@ -0,0 +1,850 @@
+/*
+    SSSD
+
+    KCM Server - tests of the libsss_secrets ccache back end
+
+    Copyright (C) Red Hat, 2019
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <popt.h>
+
+#include "util/util.h"
+#include "util/util_creds.h"
+#include "util/secrets/secrets.h"
+#include "responder/kcm/kcmsrv_ccache.h"
+#include "responder/kcm/kcmsrv_ccache_be.h"
+#include "tests/cmocka/common_mock.h"
+
+#define TEST_REALM            "TESTREALM"
+#define TEST_PRINC_COMPONENT  "PRINC_NAME"
+
+const struct kcm_ccdb_ops ccdb_mem_ops;
+const struct kcm_ccdb_ops ccdb_sec_ops;
+
+/* libsss_secrets is replaced by an in-memory store that counts the
+ * operations and can be told to fail writes */
+struct sss_sec_ctx {
+    struct sss_sec_quota quota;
+};
+
+struct sss_sec_req {
+    struct sss_sec_ctx *sctx;
+    char *url;
+};
+
+struct fake_secret {
+    struct fake_secret *prev;
+    struct fake_secret *next;
+
+    char *url;
+    /* NULL for containers */
+    char *value;
+};
+
+struct fake_sec {
+    TALLOC_CTX *mem_ctx;
+    struct fake_secret *secrets;
+
+    /* in kB, the default is used if 0 */
+    int max_payload_size;
+    /* the next number of writes fail */
+    unsigned int fail_writes;
+
+    unsigned int num_lists;
+    unsigned int num_gets;
+    unsigned int num_writes;
+};
+
+static struct fake_sec fake_sec;
+
+static struct fake_secret *fake_secret_find(const char *url)
+{
+    struct fake_secret *secret;
+
+    DLIST_FOR_EACH(secret, fake_sec.secrets) {
+        if (strcmp(secret->url, url) == 0) {
+            return secret;
+        }
+    }
+
+    return NULL;
+}
+
+static errno_t fake_secret_check_write(struct sss_sec_req *req,
+                                       const char *value)
+{
+    int max_payload_size = req->sctx->quota.max_payload_size * 1024;
+
+    fake_sec.num_writes++;
+
+    if (fake_sec.fail_writes > 0) {
+        fake_sec.fail_writes--;
+        return EIO;
+    }
+
+    if (max_payload_size > 0 && strlen(value) > max_payload_size) {
+        return ERR_SEC_PAYLOAD_SIZE_IS_TOO_LARGE;
+    }
+
+    return EOK;
+}
+
+static errno_t fake_secret_add(const char *url, const char *value)
+{
+    struct fake_secret *secret;
+
+    secret = talloc_zero(fake_sec.mem_ctx, struct fake_secret);
+    if (secret == NULL) {
+        return ENOMEM;
+    }
+
+    secret->url = talloc_strdup(secret, url);
+    if (secret->url == NULL) {
+        talloc_free(secret);
+        return ENOMEM;
+    }
+
+    if (value != NULL) {
+        secret->value = talloc_strdup(secret, value);
+        if (secret->value == NULL) {
+            talloc_free(secret);
+            return ENOMEM;
+        }
+    }
+
+    DLIST_ADD_END(fake_sec.secrets, secret, struct fake_secret *);
+    return EOK;
+}
+
+errno_t sss_sec_get_quota(struct confdb_ctx *cdb,
+                          const char *section_config_path,
+                          struct sss_sec_quota_opt *dfl_max_containers_nest_level,
+                          struct sss_sec_quota_opt *dfl_max_num_secrets,
+                          struct sss_sec_quota_opt *dfl_max_num_uid_secrets,
+                          struct sss_sec_quota_opt *dfl_max_payload,
+                          struct sss_sec_quota *quota)
+{
+    quota->containers_nest_level = dfl_max_containers_nest_level->default_value;
+    quota->max_secrets = dfl_max_num_secrets->default_value;
+    quota->max_uid_secrets = dfl_max_num_uid_secrets->default_value;
+    quota->max_payload_size = fake_sec.max_payload_size != 0 ?
+                                    fake_sec.max_payload_size :
+                                    dfl_max_payload->default_value;
+    return EOK;
+}
+
+errno_t sss_sec_init(TALLOC_CTX *mem_ctx,
+                     struct sss_sec_hive_config **config_list,
+                     struct sss_sec_ctx **_sec_ctx)
+{
+    struct sss_sec_ctx *sctx;
+
+    sctx = talloc_zero(mem_ctx, struct sss_sec_ctx);
+    if (sctx == NULL) {
+        return ENOMEM;
+    }
+    sctx->quota = config_list[0]->quota;
+
+    *_sec_ctx = sctx;
+    return EOK;
+}
+
+errno_t sss_sec_new_req(TALLOC_CTX *mem_ctx,
+                        struct sss_sec_ctx *sec_ctx,
+                        const char *url,
+                        uid_t client,
+                        struct sss_sec_req **_req)
+{
+    struct sss_sec_req *req;
+
+    req = talloc_zero(mem_ctx, struct sss_sec_req);
+    if (req == NULL) {
+        return ENOMEM;
+    }
+
+    req->sctx = sec_ctx;
+    req->url = talloc_strdup(req, url);
+    if (req->url == NULL) {
+        talloc_free(req);
+        return ENOMEM;
+    }
+
+    *_req = req;
+    return EOK;
+}
+
+errno_t sss_sec_list(TALLOC_CTX *mem_ctx,
+                     struct sss_sec_req *req,
+                     char ***_keys,
+                     size_t *num_keys)
+{
+    struct fake_secret *secret;
+    size_t len = strlen(req->url);
+    char **keys = NULL;
+    size_t count = 0;
+    const char *key;
+
+    fake_sec.num_lists++;
+
+    DLIST_FOR_EACH(secret, fake_sec.secrets) {
+        if (strncmp(secret->url, req->url, len) != 0) {
+            continue;
+        }
+
+        key = secret->url + len;
+        if (*key == '\0' || strchr(key, '/') != NULL) {
+            continue;
+        }
+
+        keys = talloc_realloc(mem_ctx, keys, char *, count + 1);
+        if (keys == NULL) {
+            return ENOMEM;
+        }
+        keys[count] = talloc_strdup(keys, key);
+        if (keys[count] == NULL) {
+            talloc_free(keys);
+            return ENOMEM;
+        }
+        count++;
+    }
+
+    if (count == 0) {
+        return ENOENT;
+    }
+
+    *_keys = keys;
+    *num_keys = count;
+    return EOK;
+}
+
+errno_t sss_sec_get(TALLOC_CTX *mem_ctx,
+                    struct sss_sec_req *req,
+                    char **_secret)
+{
+    struct fake_secret *secret;
+
+    fake_sec.num_gets++;
+
+    secret = fake_secret_find(req->url);
+    if (secret == NULL || secret->value == NULL) {
+        return ENOENT;
+    }
+
+    *_secret = talloc_strdup(mem_ctx, secret->value);
+    if (*_secret == NULL) {
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+errno_t sss_sec_put(struct sss_sec_req *req,
+                    const char *secret)
+{
+    errno_t ret;
+
+    if (fake_secret_find(req->url) != NULL) {
+        return EEXIST;
+    }
+
+    ret = fake_secret_check_write(req, secret);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return fake_secret_add(req->url, secret);
+}
+
+errno_t sss_sec_update(struct sss_sec_req *req,
+                       const char *secret)
+{
+    struct fake_secret *stored;
+    char *value;
+    errno_t ret;
+
+    stored = fake_secret_find(req->url);
+    if (stored == NULL) {
+        return ENOENT;
+    }
+
+    ret = fake_secret_check_write(req, secret);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    value = talloc_strdup(stored, secret);
+    if (value == NULL) {
+        return ENOMEM;
+    }
+    talloc_free(stored->value);
+    stored->value = value;
+
+    return EOK;
+}
+
+errno_t sss_sec_delete(struct sss_sec_req *req)
+{
+    struct fake_secret *secret;
+
+    secret = fake_secret_find(req->url);
+    if (secret == NULL) {
+        return ENOENT;
+    }
+
+    DLIST_REMOVE(fake_sec.secrets, secret);
+    talloc_free(secret);
+    return EOK;
+}
+
+errno_t sss_sec_create_container(struct sss_sec_req *req)
+{
+    if (fake_secret_find(req->url) != NULL) {
+        return EEXIST;
+    }
+
+    return fake_secret_add(req->url, NULL);
+}
+
+struct kcm_secdb_test_ctx {
+    struct tevent_context *ev;
+    struct kcm_ccdb *db;
+    struct cli_creds client;
+
+    krb5_context kctx;
+    krb5_principal princ;
+};
+
+static struct kcm_ccdb *test_ccdb_init(struct kcm_secdb_test_ctx *test_ctx)
+{
+    struct kcm_ccdb *db;
+
+    db = kcm_ccdb_init(test_ctx, test_ctx->ev, NULL, NULL, CCDB_BE_SECDB);
+    assert_non_null(db);
+
+    return db;
+}
+
+/* Starts over with what is stored in the database, like a restarted KCM
+ * responder. Pending changes are written before. */
+static void test_ccdb_restart(struct kcm_secdb_test_ctx *test_ctx)
+{
+    talloc_free(test_ctx->db);
+    test_ctx->db = test_ccdb_init(test_ctx);
+}
+
+static void test_reset_counters(void)
+{
+    fake_sec.num_lists = 0;
+    fake_sec.num_gets = 0;
+    fake_sec.num_writes = 0;
+}
+
+/* Runs the event loop until the delayed write is done */
+static void test_run_flush(struct kcm_secdb_test_ctx *test_ctx)
+{
+    int ret;
+
+    ret = tevent_loop_once(test_ctx->ev);
+    assert_int_equal(ret, 0);
+}
+
+static int setup_kcm_secdb(void **state)
+{
+    struct kcm_secdb_test_ctx *test_ctx;
+    krb5_error_code kerr;
+
+    memset(&fake_sec, 0, sizeof(fake_sec));
+    fake_sec.mem_ctx = talloc_new(NULL);
+    assert_non_null(fake_sec.mem_ctx);
+
+    test_ctx = talloc_zero(NULL, struct kcm_secdb_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->ev = tevent_context_init(test_ctx);
+    assert_non_null(test_ctx->ev);
+
+    test_ctx->client.ucred.uid = getuid();
+    test_ctx->client.ucred.gid = getgid();
+
+    kerr = krb5_init_context(&test_ctx->kctx);
+    assert_int_equal(kerr, 0);
+
+    kerr = krb5_build_principal(test_ctx->kctx,
+                                &test_ctx->princ,
+                                sizeof(TEST_REALM)-1, TEST_REALM,
+                                TEST_PRINC_COMPONENT, NULL);
+    assert_int_equal(kerr, 0);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int setup_kcm_secdb_ccdb(void **state)
+{
+    struct kcm_secdb_test_ctx *test_ctx;
+
+    setup_kcm_secdb(state);
+    test_ctx = talloc_get_type(*state, struct kcm_secdb_test_ctx);
+    test_ctx->db = test_ccdb_init(test_ctx);
+    return 0;
+}
+
+/* A payload quota of 1 kB, so that a few credentials come close to it */
+static int setup_kcm_secdb_quota(void **state)
+{
+    struct kcm_secdb_test_ctx *test_ctx;
+
+    setup_kcm_secdb(state);
+    fake_sec.max_payload_size = 1;
+
+    test_ctx = talloc_get_type(*state, struct kcm_secdb_test_ctx);
+    test_ctx->db = test_ccdb_init(test_ctx);
+    return 0;
+}
+
+static int teardown_kcm_secdb(void **state)
+{
+    struct kcm_secdb_test_ctx *test_ctx = talloc_get_type(*state,
+                                            struct kcm_secdb_test_ctx);
+    assert_non_null(test_ctx);
+
+    talloc_zfree(test_ctx->db);
+    krb5_free_principal(test_ctx->kctx, test_ctx->princ);
+    krb5_free_context(test_ctx->kctx);
+    talloc_free(test_ctx);
+
+    talloc_free(fake_sec.mem_ctx);
+    return 0;
+}
+
+static void test_create_cc(struct kcm_secdb_test_ctx *test_ctx,
+                           const char *name,
+                           uuid_t _uuid)
+{
+    struct kcm_ccache *cc;
+    struct tevent_req *req;
+    errno_t ret;
+
+    ret = kcm_cc_new(test_ctx, test_ctx->kctx, &test_ctx->client,
+                     name, test_ctx->princ, &cc);
+    assert_int_equal(ret, EOK);
+
+    ret = kcm_cc_get_uuid(cc, _uuid);
+    assert_int_equal(ret, EOK);
+
+    req = kcm_ccdb_create_cc_send(test_ctx, test_ctx->ev, test_ctx->db,
+                                  &test_ctx->client, cc);
+    assert_non_null(req);
+    assert_true(tevent_req_poll(req, test_ctx->ev));
+    ret = kcm_ccdb_create_cc_recv(req);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(req);
+    talloc_free(cc);
+}
+
+static struct kcm_ccache *test_getbyname(struct kcm_secdb_test_ctx *test_ctx,
+                                         const char *name)
+{
+    struct kcm_ccache *cc;
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = kcm_ccdb_getbyname_send(test_ctx, test_ctx->ev, test_ctx->db,
+                                  &test_ctx->client, name);
+    assert_non_null(req);
+    assert_true(tevent_req_poll(req, test_ctx->ev));
+    ret = kcm_ccdb_getbyname_recv(req, test_ctx, &cc);
+    assert_int_equal(ret, EOK);
+    assert_non_null(cc);
+
+    talloc_free(req);
+    return cc;
+}
+
+static errno_t test_store_cred(struct kcm_secdb_test_ctx *test_ctx,
+                               uuid_t uuid,
+                               size_t size)
+{
+    struct sss_iobuf *blob;
+    struct tevent_req *req;
+    uint8_t *data;
+    errno_t ret;
+
+    data = talloc_size(test_ctx, size);
+    assert_non_null(data);
+    memset(data, 'x', size);
+
+    blob = sss_iobuf_init_readonly(test_ctx, data, size);
+    assert_non_null(blob);
+
+    req = kcm_ccdb_store_cred_blob_send(test_ctx, test_ctx->ev, test_ctx->db,
+                                        &test_ctx->client, uuid, blob);
+    assert_non_null(req);
+    assert_true(tevent_req_poll(req, test_ctx->ev));
+    ret = kcm_ccdb_store_cred_blob_recv(req);
+
+    talloc_free(req);
+    talloc_free(blob);
+    talloc_free(data);
+    return ret;
+}
+
+static void test_set_offset(struct kcm_secdb_test_ctx *test_ctx,
+                            uuid_t uuid,
+                            int32_t offset)
+{
+    struct kcm_mod_ctx *mod_ctx;
+    struct tevent_req *req;
+    errno_t ret;
+
+    mod_ctx = kcm_mod_ctx_new(test_ctx);
+    assert_non_null(mod_ctx);
+    mod_ctx->kdc_offset = offset;
+
+    req = kcm_ccdb_mod_cc_send(test_ctx, test_ctx->ev, test_ctx->db,
+                               &test_ctx->client, uuid, mod_ctx);
+    assert_non_null(req);
+    assert_true(tevent_req_poll(req, test_ctx->ev));
+    ret = kcm_ccdb_mod_cc_recv(req);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(req);
+    talloc_free(mod_ctx);
+}
+
+static void test_set_default(struct kcm_secdb_test_ctx *test_ctx,
+                             uuid_t uuid)
+{
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = kcm_ccdb_set_default_send(test_ctx, test_ctx->ev, test_ctx->db,
+                                    &test_ctx->client, uuid);
+    assert_non_null(req);
+    assert_true(tevent_req_poll(req, test_ctx->ev));
+    ret = kcm_ccdb_set_default_recv(req);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(req);
+}
+
+static void assert_default(struct kcm_secdb_test_ctx *test_ctx,
+                           uuid_t expected)
+{
+    struct tevent_req *req;
+    uuid_t uuid;
+    errno_t ret;
+
+    req = kcm_ccdb_get_default_send(test_ctx, test_ctx->ev, test_ctx->db,
+                                    &test_ctx->client);
+    assert_non_null(req);
+    assert_true(tevent_req_poll(req, test_ctx->ev));
+    ret = kcm_ccdb_get_default_recv(req, &uuid);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(uuid_compare(uuid, expected), 0);
+
+    talloc_free(req);
+}
+
+static size_t count_creds(struct kcm_ccache *cc)
+{
+    struct kcm_cred *crd;
+    size_t count = 0;
+
+    for (crd = kcm_cc_get_cred(cc); crd != NULL; crd = kcm_cc_next_cred(crd)) {
+        count++;
+    }
+
+    return count;
+}
+
+static char *test_cc_name(struct kcm_secdb_test_ctx *test_ctx,
+                          unsigned int num)
+{
+    char *name;
+
+    name = talloc_asprintf(test_ctx, "%"SPRIuid":%u", getuid(), num);
+    assert_non_null(name);
+
+    return name;
+}
+
+/* After the ccaches of the user were loaded, reading them does not go to
+ * the database */
+static void test_kcm_secdb_read_from_memory(void **state)
+{
+    struct kcm_secdb_test_ctx *test_ctx = talloc_get_type(*state,
+                                            struct kcm_secdb_test_ctx);
+    struct kcm_ccache *cc;
+    struct tevent_req *req;
+    uuid_t *uuid_list;
+    uuid_t uuid;
+    const char *name;
+    errno_t ret;
+
+    name = test_cc_name(test_ctx, 1);
+    test_create_cc(test_ctx, name, uuid);
+    test_reset_counters();
+
+    cc = test_getbyname(test_ctx, name);
+    assert_string_equal(kcm_cc_get_name(cc), name);
+    talloc_free(cc);
+
+    req = kcm_ccdb_list_send(test_ctx, test_ctx->ev, test_ctx->db,
+                             &test_ctx->client);
+    assert_non_null(req);
+    assert_true(tevent_req_poll(req, test_ctx->ev));
+    ret = kcm_ccdb_list_recv(req, test_ctx, &uuid_list);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(uuid_compare(uuid_list[0], uuid), 0);
+    assert_true(uuid_is_null(uuid_list[1]));
+    talloc_free(req);
+
+    assert_int_equal(fake_sec.num_lists, 0);
+    assert_int_equal(fake_sec.num_gets, 0);
+    assert_int_equal(fake_sec.num_writes, 0);
+
+    /* A restarted responder lists the ccaches and reads the default once,
+     * each ccache is read on its first use */
+    test_ccdb_restart(test_ctx);
+    test_reset_counters();
+
+    cc = test_getbyname(test_ctx, name);
+    talloc_free(cc);
+    assert_int_equal(fake_sec.num_lists, 1);
+    assert_int_equal(fake_sec.num_gets, 2);
+
+    cc = test_getbyname(test_ctx, name);
+    talloc_free(cc);
+    assert_int_equal(fake_sec.num_lists, 1);
+    assert_int_equal(fake_sec.num_gets, 2);
+}
+
+/* A sequence of changes is written at once after the delay */
+static void test_kcm_secdb_coalesce(void **state)
+{
+    struct kcm_secdb_test_ctx *test_ctx = talloc_get_type(*state,
+                                            struct kcm_secdb_test_ctx);
+    struct kcm_ccache *cc;
+    uuid_t uuid;
+    const char *name;
+    errno_t ret;
+
+    name = test_cc_name(test_ctx, 1);
+    test_create_cc(test_ctx, name, uuid);
+    test_reset_counters();
+
+    ret = test_store_cred(test_ctx, uuid, 64);
+    assert_int_equal(ret, EOK);
+    ret = test_store_cred(test_ctx, uuid, 64);
+    assert_int_equal(ret, EOK);
+    ret = test_store_cred(test_ctx, uuid, 64);
+    assert_int_equal(ret, EOK);
+    test_set_default(test_ctx, uuid);
+    assert_int_equal(fake_sec.num_writes, 0);
+
+    /* The changes are visible before they are written */
+    cc = test_getbyname(test_ctx, name);
+    assert_int_equal(count_creds(cc), 3);
+    talloc_free(cc);
+    assert_default(test_ctx, uuid);
+
+    /* One write for the ccache, one for the default */
+    test_run_flush(test_ctx);
+    assert_int_equal(fake_sec.num_writes, 2);
+
+    test_ccdb_restart(test_ctx);
+    assert_int_equal(fake_sec.num_writes, 2);
+
+    cc = test_getbyname(test_ctx, name);
+    assert_int_equal(count_creds(cc), 3);
+    talloc_free(cc);
+    assert_default(test_ctx, uuid);
+}
+
+/* A failed write is retried, the changes of other ccaches are written
+ * regardless and nothing is read from the database again */
+static void test_kcm_secdb_flush_retry(void **state)
+{
+    struct kcm_secdb_test_ctx *test_ctx = talloc_get_type(*state,
+                                            struct kcm_secdb_test_ctx);
+    struct kcm_ccache *cc;
+    uuid_t uuid1;
+    uuid_t uuid2;
+    const char *name1;
+    const char *name2;
+
+    name1 = test_cc_name(test_ctx, 1);
+    name2 = test_cc_name(test_ctx, 2);
+    test_create_cc(test_ctx, name1, uuid1);
+    test_create_cc(test_ctx, name2, uuid2);
+
+    test_set_offset(test_ctx, uuid1, 42);
+    test_set_offset(test_ctx, uuid2, 43);
+    test_reset_counters();
+
+    fake_sec.fail_writes = 1;
+    test_run_flush(test_ctx);
+    assert_int_equal(fake_sec.num_writes, 2);
+
+    /* The change that was not written is still there */
+    cc = test_getbyname(test_ctx, name1);
+    assert_int_equal(kcm_cc_get_offset(cc), 42);
+    talloc_free(cc);
+    assert_int_equal(fake_sec.num_lists, 0);
+    assert_int_equal(fake_sec.num_gets, 0);
+
+    /* and it is written with the next attempt */
+    test_run_flush(test_ctx);
+    assert_int_equal(fake_sec.num_writes, 3);
+
+    test_ccdb_restart(test_ctx);
+    assert_int_equal(fake_sec.num_writes, 3);
+
+    cc = test_getbyname(test_ctx, name1);
+    assert_int_equal(kcm_cc_get_offset(cc), 42);
+    talloc_free(cc);
+    cc = test_getbyname(test_ctx, name2);
+    assert_int_equal(kcm_cc_get_offset(cc), 43);
+    talloc_free(cc);
+}
+
+/* A ccache that cannot be written at all is read from the database again */
+static void test_kcm_secdb_flush_give_up(void **state)
+{
+    struct kcm_secdb_test_ctx *test_ctx = talloc_get_type(*state,
+                                            struct kcm_secdb_test_ctx);
+    struct kcm_ccache *cc;
+    uuid_t uuid;
+    const char *name;
+
+    name = test_cc_name(test_ctx, 1);
+    test_create_cc(test_ctx, name, uuid);
+    test_set_offset(test_ctx, uuid, 42);
+    test_reset_counters();
+
+    fake_sec.fail_writes = 3;
+    test_run_flush(test_ctx);
+    test_run_flush(test_ctx);
+    test_run_flush(test_ctx);
+    assert_int_equal(fake_sec.num_writes, 3);
+
+    cc = test_getbyname(test_ctx, name);
+    assert_int_equal(kcm_cc_get_offset(cc), 0);
+    talloc_free(cc);
+    assert_int_equal(fake_sec.num_gets, 1);
+
+    /* nothing is written at shutdown */
+    test_ccdb_restart(test_ctx);
+    assert_int_equal(fake_sec.num_writes, 3);
+}
+
+/* A change close to the quota is written right away, one that does not
+ * fit is reported to the client and not kept */
+static void test_kcm_secdb_quota(void **state)
+{
+    struct kcm_secdb_test_ctx *test_ctx = talloc_get_type(*state,
+                                            struct kcm_secdb_test_ctx);
+    struct kcm_ccache *cc;
+    uuid_t uuid;
+    const char *name;
+    errno_t ret;
+
+    name = test_cc_name(test_ctx, 1);
+    test_create_cc(test_ctx, name, uuid);
+    test_reset_counters();
+
+    /* far from the quota */
+    ret = test_store_cred(test_ctx, uuid, 64);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(fake_sec.num_writes, 0);
+
+    /* close to the quota, written together with the pending change */
+    ret = test_store_cred(test_ctx, uuid, 600);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(fake_sec.num_writes, 1);
+
+    /* over the quota */
+    ret = test_store_cred(test_ctx, uuid, 600);
+    assert_int_equal(ret, ERR_SEC_PAYLOAD_SIZE_IS_TOO_LARGE);
+    assert_int_equal(fake_sec.num_writes, 2);
+
+    cc = test_getbyname(test_ctx, name);
+    assert_int_equal(count_creds(cc), 2);
+    talloc_free(cc);
+
+    /* the failed change is not written later */
+    test_ccdb_restart(test_ctx);
+    assert_int_equal(fake_sec.num_writes, 2);
+
+    cc = test_getbyname(test_ctx, name);
+    assert_int_equal(count_creds(cc), 2);
+    talloc_free(cc);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    int rv;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_kcm_secdb_read_from_memory,
+                                        setup_kcm_secdb_ccdb,
+                                        teardown_kcm_secdb),
+        cmocka_unit_test_setup_teardown(test_kcm_secdb_coalesce,
+                                        setup_kcm_secdb_ccdb,
+                                        teardown_kcm_secdb),
+        cmocka_unit_test_setup_teardown(test_kcm_secdb_flush_retry,
+                                        setup_kcm_secdb_ccdb,
+                                        teardown_kcm_secdb),
+        cmocka_unit_test_setup_teardown(test_kcm_secdb_flush_give_up,
+                                        setup_kcm_secdb_ccdb,
+                                        teardown_kcm_secdb),
+        cmocka_unit_test_setup_teardown(test_kcm_secdb_quota,
+                                        setup_kcm_secdb_quota,
+                                        teardown_kcm_secdb),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    return rv;
+}
@@ -0,0 +1,353 @@
+/*
+    Copyright (C) 2026 Red Hat
+
+    SSSD tests: Sudo responder rule index
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "tests/cmocka/common_mock_resp.h"
+#include "db/sysdb_sudo.h"
+
+/* In order to access opaque types */
+#include "responder/sudo/sudosrv_get_sudorules.c"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_responder_sudo_rules_conf.ldb"
+#define TEST_DOM_NAME "responder_sudo_rules_test"
+#define TEST_ID_PROVIDER "ldap"
+
+#define TEST_USER_NAME "alice"
+#define TEST_USER_UID 10001
+#define TEST_CLI_UID 20001
+
+struct sudo_rules_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct sudo_ctx *sudo_ctx;
+};
+
+static void store_rule(struct sudo_rules_test_ctx *test_ctx,
+                       const char *rule_name,
+                       const char *sudo_user)
+{
+    struct sysdb_attrs *rule;
+    errno_t ret;
+
+    rule = sysdb_new_attrs(test_ctx);
+    assert_non_null(rule);
+
+    ret = sysdb_attrs_add_string(rule, SYSDB_SUDO_CACHE_AT_CN, rule_name);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(rule, SYSDB_SUDO_CACHE_AT_HOST, "ALL");
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(rule, SYSDB_SUDO_CACHE_AT_COMMAND, "ALL");
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(rule, SYSDB_SUDO_CACHE_AT_USER, sudo_user);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_sudo_store(test_ctx->tctx->dom, &rule, 1);
+    assert_int_equal(ret, EOK);
+    talloc_free(rule);
+}
+
+static void store_rules(struct sudo_rules_test_ctx *test_ctx)
+{
+    store_rule(test_ctx, "rule_all", "ALL");
+    store_rule(test_ctx, "rule_name", TEST_USER_NAME);
+    store_rule(test_ctx, "rule_uid", "#10001");
+    store_rule(test_ctx, "rule_group", "%admins");
+    store_rule(test_ctx, "rule_netgroup", "+sudoers");
+    store_rule(test_ctx, "rule_other", "bob");
+}
+
+static void get_rules(struct sudo_rules_test_ctx *test_ctx,
+                      const char *username,
+                      char **groups,
+                      struct sysdb_attrs ***_rules,
+                      uint32_t *_num_rules)
+{
+    errno_t ret;
+
+    ret = sudosrv_cached_rules(test_ctx, test_ctx->sudo_ctx,
+                               test_ctx->tctx->dom, TEST_CLI_UID,
+                               TEST_USER_UID, username, groups,
+                               _rules, _num_rules);
+    assert_int_equal(ret, EOK);
+}
+
+static struct sysdb_attrs *find_rule(struct sysdb_attrs **rules,
+                                     uint32_t num_rules,
+                                     const char *rule_name)
+{
+    const char *name;
+    uint32_t i;
+    errno_t ret;
+
+    for (i = 0; i < num_rules; i++) {
+        ret = sysdb_attrs_get_string(rules[i], SYSDB_SUDO_CACHE_AT_CN, &name);
+        assert_int_equal(ret, EOK);
+
+        if (strcmp(name, rule_name) == 0) {
+            return rules[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void assert_sudo_user(struct sysdb_attrs *rule, const char *expected)
+{
+    struct ldb_message_element *el;
+    errno_t ret;
+
+    assert_non_null(rule);
+
+    ret = sysdb_attrs_get_el_ext(rule, SYSDB_SUDO_CACHE_AT_USER, false, &el);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(el->num_values, 1);
+    assert_string_equal((const char *)el->values[0].data, expected);
+}
+
+static int test_sudo_rules_setup(void **state)
+{
+    struct sudo_rules_test_ctx *test_ctx;
+    errno_t ret;
+
+    test_ctx = talloc_zero(NULL, struct sudo_rules_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME,
+                                         TEST_ID_PROVIDER, NULL);
+    assert_non_null(test_ctx->tctx);
+
+    test_ctx->sudo_ctx = talloc_zero(test_ctx, struct sudo_ctx);
+    assert_non_null(test_ctx->sudo_ctx);
+
+    test_ctx->sudo_ctx->rctx = mock_rctx(test_ctx, test_ctx->tctx->ev,
+                                         test_ctx->tctx->dom,
+                                         test_ctx->sudo_ctx);
+    assert_non_null(test_ctx->sudo_ctx->rctx);
+
+    ret = sss_hash_create(test_ctx->sudo_ctx, 0,
+                          &test_ctx->sudo_ctx->rule_indexes);
+    assert_int_equal(ret, EOK);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_sudo_rules_teardown(void **state)
+{
+    talloc_zfree(*state);
+    return 0;
+}
+
+static void test_sudo_rules_lookup(void **state)
+{
+    struct sudo_rules_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct sudo_rules_test_ctx);
+    const char *groups[] = { "users", "admins", NULL };
+    struct sysdb_attrs **rules;
+    uint32_t num_rules;
+
+    store_rules(test_ctx);
+
+    get_rules(test_ctx, TEST_USER_NAME, discard_const(groups),
+              &rules, &num_rules);
+    assert_int_equal(num_rules, 5);
+
+    /* sudoUser of the rules matched by the user is replaced with #uid */
+    assert_sudo_user(find_rule(rules, num_rules, "rule_all"), "#20001");
+    assert_sudo_user(find_rule(rules, num_rules, "rule_name"), "#20001");
+    assert_sudo_user(find_rule(rules, num_rules, "rule_uid"), "#20001");
+    assert_sudo_user(find_rule(rules, num_rules, "rule_group"), "#20001");
+
+    /* netgroups are evaluated by sudo itself */
+    assert_sudo_user(find_rule(rules, num_rules, "rule_netgroup"), "+sudoers");
+
+    assert_null(find_rule(rules, num_rules, "rule_other"));
+
+    talloc_free(rules);
+}
+
+static void test_sudo_rules_no_match(void **state)
+{
+    struct sudo_rules_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct sudo_rules_test_ctx);
+    struct sysdb_attrs **rules;
+    uint32_t num_rules;
+
+    store_rule(test_ctx, "rule_other", "bob");
+
+    get_rules(test_ctx, TEST_USER_NAME, NULL, &rules, &num_rules);
+    assert_int_equal(num_rules, 0);
+    assert_null(rules);
+}
+
+static void test_sudo_rules_user_cached(void **state)
+{
+    struct sudo_rules_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct sudo_rules_test_ctx);
+    const char *groups[] = { "admins", NULL };
+    const char *same_groups[] = { "admins", NULL };
+    const char *other_groups[] = { "users", NULL };
+    struct sysdb_attrs **rules;
+    struct sysdb_attrs **cached;
+    uint32_t num_rules;
+    uint32_t num_cached;
+
+    store_rules(test_ctx);
+
+    get_rules(test_ctx, TEST_USER_NAME, discard_const(groups),
+              &rules, &num_rules);
+    assert_int_equal(num_rules, 5);
+
+    /* The same user with the same groups gets the cached rules */
+    get_rules(test_ctx, TEST_USER_NAME, discard_const(same_groups),
+              &cached, &num_cached);
+    assert_int_equal(num_cached, num_rules);
+    assert_ptr_equal(find_rule(cached, num_cached, "rule_group"),
+                     find_rule(rules, num_rules, "rule_group"));
+    talloc_free(cached);
+
+    /* Different groups select the rules again */
+    get_rules(test_ctx, TEST_USER_NAME, discard_const(other_groups),
+              &cached, &num_cached);
+    assert_int_equal(num_cached, 4);
+    assert_null(find_rule(cached, num_cached, "rule_group"));
+    talloc_free(cached);
+
+    talloc_free(rules);
+}
+
+static void test_sudo_rules_generation(void **state)
+{
+    struct sudo_rules_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct sudo_rules_test_ctx);
+    struct sysdb_attrs **rules;
+    uint32_t num_rules;
+
+    store_rule(test_ctx, "rule_name", TEST_USER_NAME);
+
+    get_rules(test_ctx, TEST_USER_NAME, NULL, &rules, &num_rules);
+    assert_int_equal(num_rules, 1);
+    talloc_free(rules);
+
+    /* Storing a rule changes the generation and the index is rebuilt */
+    store_rule(test_ctx, "rule_uid", "#10001");
+
+    get_rules(test_ctx, TEST_USER_NAME, NULL, &rules, &num_rules);
+    assert_int_equal(num_rules, 2);
+    assert_non_null(find_rule(rules, num_rules, "rule_name"));
+    assert_non_null(find_rule(rules, num_rules, "rule_uid"));
+    talloc_free(rules);
+}
+
+static void test_sudo_rules_max_users(void **state)
+{
+    struct sudo_rules_test_ctx *test_ctx =
+        talloc_get_type_abort(*state, struct sudo_rules_test_ctx);
+    struct sudosrv_rule_index *index;
+    struct sysdb_attrs **rules;
+    uint32_t num_rules;
+    char *username;
+    int i;
+
+    store_rule(test_ctx, "rule_all", "ALL");
+
+    for (i = 0; i <= SUDOSRV_MAX_CACHED_USERS; i++) {
+        username = talloc_asprintf(test_ctx, "user%d", i);
+        assert_non_null(username);
+
+        get_rules(test_ctx, username, NULL, &rules, &num_rules);
+        assert_int_equal(num_rules, 1);
+        talloc_free(rules);
+        talloc_free(username);
+    }
+
+    /* The users were dropped when the limit was reached */
+    assert_int_equal(sudosrv_rule_index_get(test_ctx->sudo_ctx,
+                                            test_ctx->tctx->dom, &index),
+                     EOK);
+    assert_int_equal(hash_count(index->users), 1);
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    int no_cleanup = 0;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        {"no-cleanup", 'n', POPT_ARG_NONE, &no_cleanup, 0,
+         _("Do not delete the test database after a test run"), NULL },
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_sudo_rules_lookup,
+                                        test_sudo_rules_setup,
+                                        test_sudo_rules_teardown),
+        cmocka_unit_test_setup_teardown(test_sudo_rules_no_match,
+                                        test_sudo_rules_setup,
+                                        test_sudo_rules_teardown),
+        cmocka_unit_test_setup_teardown(test_sudo_rules_user_cached,
+                                        test_sudo_rules_setup,
+                                        test_sudo_rules_teardown),
+        cmocka_unit_test_setup_teardown(test_sudo_rules_generation,
+                                        test_sudo_rules_setup,
+                                        test_sudo_rules_teardown),
+        cmocka_unit_test_setup_teardown(test_sudo_rules_max_users,
+                                        test_sudo_rules_setup,
+                                        test_sudo_rules_teardown),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old DB to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    test_dom_suite_setup(TESTS_PATH);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    if (rv == 0 && !no_cleanup) {
+        test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    }
+    return rv;
+}
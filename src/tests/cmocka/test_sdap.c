@@ -475,6 +475,76 @@ void test_parse_dups(void **state)
     talloc_free(attrs);
 }
 
+/* The precompiled map index must give the same results as the plain map,
+ * including attributes mapped more than once and case differences */
+void test_parse_with_map_idx(void **state)
+{
+    int ret;
+    struct sysdb_attrs *attrs;
+    struct parse_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                      struct parse_test_ctx);
+    struct mock_ldap_entry test_idx_user;
+    struct sdap_attr_map *map;
+    struct sdap_attr_map_index *idx;
+    struct ldb_message_element *el;
+    int i;
+
+    const char *oc_values[] = { "posixAccount", NULL };
+    const char *uid_values[] = { "tuser1", NULL };
+    const char *id_values[] = { "1234", NULL };
+    const char *extra_values[] = { "extra", NULL };
+    const char *multi_values[] = { "svc1", "", "svc2", NULL };
+    struct mock_ldap_attr test_idx_user_attrs[] = {
+        { .name = "objectClass", .values = oc_values },
+        { .name = "UID", .values = uid_values },
+        { .name = "idNumber", .values = id_values },
+        { .name = "extra", .values = extra_values },
+        { .name = "authorizedService", .values = multi_values },
+        { NULL, NULL }
+    };
+
+    test_idx_user.dn = "cn=idxuser,dc=example,dc=com";
+    test_idx_user.attrs = test_idx_user_attrs;
+    set_entry_parse(&test_idx_user);
+
+    ret = sdap_copy_map(test_ctx, rfc2307_user_map, SDAP_OPTS_USER, &map);
+    assert_int_equal(ret, ERR_OK);
+    for (i = 0; i < SDAP_OPTS_USER; i++) {
+        if (map[i].name == NULL) continue;
+
+        if (strcmp(map[i].name, "uidNumber") == 0
+             || strcmp(map[i].name, "gidNumber") == 0) {
+            map[i].name = discard_const("idNumber");
+        }
+    }
+
+    ret = sdap_attr_map_index_create(test_ctx, map, SDAP_OPTS_USER, &idx);
+    assert_int_equal(ret, ERR_OK);
+
+    ret = sdap_parse_entry_idx(test_ctx, &test_ctx->sh, &test_ctx->sm,
+                               idx, &attrs, false);
+    assert_int_equal(ret, ERR_OK);
+
+    assert_int_equal(attrs->num, 5);
+    assert_entry_has_attr(attrs, SYSDB_ORIG_DN,
+                          "cn=idxuser,dc=example,dc=com");
+    assert_entry_has_attr(attrs, SYSDB_NAME, "tuser1");
+    assert_entry_has_attr(attrs, SYSDB_UIDNUM, "1234");
+    assert_entry_has_attr(attrs, SYSDB_GIDNUM, "1234");
+    assert_entry_has_no_attr(attrs, "extra");
+
+    /* Empty values are skipped */
+    ret = sysdb_attrs_get_el_ext(attrs, SYSDB_AUTHORIZED_SERVICE, false, &el);
+    assert_int_equal(ret, ERR_OK);
+    assert_int_equal(el->num_values, 2);
+    assert_string_equal((const char *) el->values[0].data, "svc1");
+    assert_string_equal((const char *) el->values[1].data, "svc2");
+
+    talloc_free(idx);
+    talloc_free(map);
+    talloc_free(attrs);
+}
+
 void test_parse_deref(void **state)
 {
     errno_t ret;
@@ -1119,6 +1189,37 @@ static void test_sdap_copy_objects_in_dom_nofilter(void **state)
                      test_ctx->dom_objects);
 }
 
+static void test_sdap_adapt_page_size(void **state)
+{
+    /* Fast full pages grow, but at most twice per step and not above max */
+    assert_int_equal(sdap_adapt_page_size(100, 1000, 100, 100 * 1024,
+                                          1000, 1000000), 200);
+    assert_int_equal(sdap_adapt_page_size(800, 1000, 800, 800 * 1024,
+                                          1000, 1000000), 1000);
+
+    /* A short page that was fast enough does not change anything */
+    assert_int_equal(sdap_adapt_page_size(500, 1000, 10, 10 * 1024,
+                                          1000, 1000000), 500);
+
+    /* Slow pages shrink proportionally, but at most by half per step */
+    assert_int_equal(sdap_adapt_page_size(1000, 1000, 1000, 1000 * 1024,
+                                          1250000, 1000000), 800);
+    assert_int_equal(sdap_adapt_page_size(1000, 1000, 1000, 1000 * 1024,
+                                          10000000, 1000000), 500);
+
+    /* Large entries limit the size of the page */
+    assert_int_equal(sdap_adapt_page_size(1000, 1000, 1000, 1000 * 16384,
+                                          1000, 1000000),
+                     SDAP_PAGE_MAX_BYTES / 16384);
+
+    /* Never below the minimum, unless max is lower */
+    assert_int_equal(sdap_adapt_page_size(60, 1000, 60, 60 * 1024,
+                                          10000000, 1000000),
+                     SDAP_PAGE_SIZE_MIN);
+    assert_int_equal(sdap_adapt_page_size(10, 10, 10, 10 * 1024,
+                                          10000000, 1000000), 10);
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -1142,6 +1243,9 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_parse_dups,
                                         parse_entry_test_setup,
                                         parse_entry_test_teardown),
+        cmocka_unit_test_setup_teardown(test_parse_with_map_idx,
+                                        parse_entry_test_setup,
+                                        parse_entry_test_teardown),
         cmocka_unit_test_setup_teardown(test_parse_deref,
                                         parse_entry_test_setup,
                                         parse_entry_test_teardown),
@@ -1194,6 +1298,9 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_sdap_copy_objects_in_dom_nofilter,
                                         sdap_copy_objects_in_dom_setup,
                                         sdap_copy_objects_in_dom_teardown),
+
+        /* Adaptive paging */
+        cmocka_unit_test(test_sdap_adapt_page_size),
     };
 
     /* Set debug level to invalid value so we can decide if -d 0 was used. */
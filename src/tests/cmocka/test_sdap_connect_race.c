@@ -0,0 +1,566 @@
+/*
+    Copyright (C) 2026 Red Hat
+
+    SSSD tests - Connecting to several LDAP servers in parallel
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "providers/ldap/ldap_common.h"
+#include "providers/ldap/ldap_opts.h"
+#include "providers/ldap/sdap_async_private.h"
+
+#define TEST_RACE_DELAY 50
+
+/* The fail over servers are replaced by these, the race only passes them
+ * back to the fail over calls faked below */
+struct race_test_server {
+    const char *uri;
+
+    /* What happens when the race tries this server */
+    errno_t tls_error;
+    errno_t resolve_error;
+    errno_t connect_error;
+    int connect_delay;
+
+    /* What the race did */
+    int start_order;
+    bool cancelled;
+    bool marked_failed;
+    bool sampled;
+};
+
+struct race_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct sdap_options *opts;
+    struct be_ctx *be;
+    struct sdap_service *service;
+
+    struct race_test_server *servers;
+    size_t num_servers;
+    int started;
+    struct race_test_server *used;
+
+    struct sdap_handle *sh;
+    struct fo_server *srv;
+};
+
+static struct race_test_ctx *race_test;
+
+#define FO_SERVER(s) ((struct fo_server *) (s))
+#define TEST_SERVER(s) ((struct race_test_server *) (s))
+
+static struct race_test_server *find_server(const char *uri)
+{
+    size_t i;
+
+    for (i = 0; i < race_test->num_servers; i++) {
+        if (strcmp(race_test->servers[i].uri, uri) == 0) {
+            return &race_test->servers[i];
+        }
+    }
+
+    fail_msg("Unknown server %s", uri);
+    return NULL;
+}
+
+errno_t __wrap_be_fo_get_candidate_servers(TALLOC_CTX *mem_ctx,
+                                           struct be_ctx *ctx,
+                                           const char *service_name,
+                                           struct fo_server *first,
+                                           size_t max,
+                                           struct fo_server ***_servers,
+                                           size_t *_num_servers)
+{
+    struct fo_server **servers;
+    size_t num;
+    size_t i;
+
+    assert_ptr_equal(first, FO_SERVER(&race_test->servers[0]));
+
+    num = MIN(max, race_test->num_servers);
+    servers = talloc_zero_array(mem_ctx, struct fo_server *, num);
+    assert_non_null(servers);
+
+    for (i = 0; i < num; i++) {
+        servers[i] = FO_SERVER(&race_test->servers[i]);
+    }
+
+    *_servers = servers;
+    *_num_servers = num;
+    return EOK;
+}
+
+struct tevent_req *__wrap_be_resolve_candidate_send(TALLOC_CTX *memctx,
+                                                    struct tevent_context *ev,
+                                                    struct be_ctx *ctx,
+                                                    struct fo_server *srv)
+{
+    struct tevent_req *req;
+    int *dummy;
+
+    req = tevent_req_create(memctx, &dummy, int);
+    assert_non_null(req);
+
+    if (TEST_SERVER(srv)->resolve_error != EOK) {
+        tevent_req_error(req, TEST_SERVER(srv)->resolve_error);
+    } else {
+        tevent_req_done(req);
+    }
+
+    return tevent_req_post(req, ev);
+}
+
+int __wrap_be_resolve_candidate_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+errno_t __wrap_be_fo_run_server_callbacks(struct be_ctx *ctx,
+                                          const char *service_name,
+                                          struct fo_server *srv)
+{
+    /* The provider callbacks point the service to the server */
+    race_test->service->uri = discard_const(TEST_SERVER(srv)->uri);
+    return EOK;
+}
+
+errno_t __wrap_decide_tls_usage(enum connect_tls force_tls,
+                                struct dp_option *basic,
+                                const char *uri, bool *_use_tls)
+{
+    *_use_tls = false;
+    return find_server(uri)->tls_error;
+}
+
+struct fake_connect_state {
+    struct race_test_server *srv;
+    bool finished;
+};
+
+static int fake_connect_state_destructor(struct fake_connect_state *state)
+{
+    if (!state->finished) {
+        state->srv->cancelled = true;
+    }
+
+    return 0;
+}
+
+static void fake_connect_done(struct tevent_context *ev,
+                              struct tevent_timer *te,
+                              struct timeval tv, void *pvt)
+{
+    struct tevent_req *req = talloc_get_type(pvt, struct tevent_req);
+    struct fake_connect_state *state;
+
+    state = tevent_req_data(req, struct fake_connect_state);
+    state->finished = true;
+
+    if (state->srv->connect_error != EOK) {
+        tevent_req_error(req, state->srv->connect_error);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+struct tevent_req *__wrap_sdap_connect_send(TALLOC_CTX *memctx,
+                                            struct tevent_context *ev,
+                                            struct sdap_options *opts,
+                                            const char *uri,
+                                            struct sockaddr_storage *sockaddr,
+                                            bool use_start_tls)
+{
+    struct fake_connect_state *state;
+    struct tevent_timer *te;
+    struct tevent_req *req;
+    struct timeval tv;
+
+    req = tevent_req_create(memctx, &state, struct fake_connect_state);
+    assert_non_null(req);
+
+    state->srv = find_server(uri);
+    state->srv->start_order = ++race_test->started;
+    talloc_set_destructor(state, fake_connect_state_destructor);
+
+    tv = tevent_timeval_current_ofs(state->srv->connect_delay / 1000,
+                                    (state->srv->connect_delay % 1000) * 1000);
+    te = tevent_add_timer(ev, state, tv, fake_connect_done, req);
+    assert_non_null(te);
+
+    return req;
+}
+
+int __wrap_sdap_connect_recv(struct tevent_req *req,
+                             TALLOC_CTX *memctx,
+                             struct sdap_handle **sh)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *sh = talloc_zero(memctx, struct sdap_handle);
+    assert_non_null(*sh);
+    return EOK;
+}
+
+void __wrap__be_fo_set_port_status(struct be_ctx *ctx,
+                                   const char *service_name,
+                                   struct fo_server *server,
+                                   enum port_status status,
+                                   int line,
+                                   const char *file,
+                                   const char *function)
+{
+    assert_int_equal(status, PORT_NOT_WORKING);
+    TEST_SERVER(server)->marked_failed = true;
+}
+
+void __wrap_fo_add_server_sample(struct fo_server *server,
+                                 uint64_t rtt_usec,
+                                 bool success)
+{
+    assert_true(success);
+    TEST_SERVER(server)->sampled = true;
+}
+
+errno_t __wrap_be_fo_use_server(struct be_ctx *ctx,
+                                const char *service_name,
+                                struct fo_server *srv)
+{
+    race_test->used = TEST_SERVER(srv);
+    return EOK;
+}
+
+const char *__wrap_fo_get_server_str_name(struct fo_server *server)
+{
+    return TEST_SERVER(server)->uri;
+}
+
+void __wrap_fo_ref_server(TALLOC_CTX *ref_ctx, struct fo_server *server)
+{
+    return;
+}
+
+static int test_race_setup(void **state)
+{
+    struct race_test_ctx *test_ctx;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct race_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_ev_test_ctx(test_ctx);
+    assert_non_null(test_ctx->tctx);
+
+    test_ctx->opts = talloc_zero(test_ctx, struct sdap_options);
+    assert_non_null(test_ctx->opts);
+
+    ret = dp_copy_defaults(test_ctx->opts, default_basic_opts,
+                           SDAP_OPTS_BASIC, &test_ctx->opts->basic);
+    assert_int_equal(ret, EOK);
+
+    ret = dp_opt_set_int(test_ctx->opts->basic,
+                         SDAP_CONNECTION_RACE_DELAY, TEST_RACE_DELAY);
+    assert_int_equal(ret, EOK);
+
+    test_ctx->be = talloc_zero(test_ctx, struct be_ctx);
+    assert_non_null(test_ctx->be);
+
+    test_ctx->service = talloc_zero(test_ctx, struct sdap_service);
+    assert_non_null(test_ctx->service);
+    test_ctx->service->name = talloc_strdup(test_ctx->service, "LDAP");
+    assert_non_null(test_ctx->service->name);
+
+    race_test = test_ctx;
+    check_leaks_push(test_ctx);
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_race_teardown(void **state)
+{
+    struct race_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct race_test_ctx);
+
+    talloc_zfree(test_ctx->sh);
+    assert_true(check_leaks_pop(test_ctx));
+
+    race_test = NULL;
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void test_race_set_servers(struct race_test_ctx *test_ctx,
+                                  struct race_test_server *servers,
+                                  size_t num_servers)
+{
+    errno_t ret;
+
+    test_ctx->servers = servers;
+    test_ctx->num_servers = num_servers;
+
+    ret = dp_opt_set_int(test_ctx->opts->basic,
+                         SDAP_CONNECTION_RACE_SERVERS, num_servers);
+    assert_int_equal(ret, EOK);
+}
+
+static void test_race_done(struct tevent_req *req)
+{
+    struct race_test_ctx *test_ctx;
+    bool use_tls;
+    errno_t ret;
+
+    test_ctx = tevent_req_callback_data(req, struct race_test_ctx);
+
+    ret = sdap_connect_race_recv(req, test_ctx, &test_ctx->sh,
+                                 &test_ctx->srv, &use_tls);
+    talloc_zfree(req);
+
+    test_ev_done(test_ctx->tctx, ret);
+}
+
+static errno_t test_race_run(struct race_test_ctx *test_ctx)
+{
+    struct tevent_req *req;
+
+    req = sdap_connect_race_send(test_ctx, test_ctx->tctx->ev,
+                                 test_ctx->opts, test_ctx->be,
+                                 test_ctx->service,
+                                 FO_SERVER(&test_ctx->servers[0]),
+                                 CON_TLS_DFL);
+    assert_non_null(req);
+    tevent_req_set_callback(req, test_race_done, test_ctx);
+
+    return test_ev_loop(test_ctx->tctx);
+}
+
+/* A server that answers within the delay is the only one tried */
+static void test_race_first_wins(void **state)
+{
+    struct race_test_ctx *test_ctx;
+    struct race_test_server servers[] = {
+        { .uri = "ldap://a.example.com" },
+        { .uri = "ldap://b.example.com" },
+        { .uri = "ldap://c.example.com" },
+    };
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct race_test_ctx);
+    test_race_set_servers(test_ctx, servers, 3);
+
+    ret = test_race_run(test_ctx);
+    assert_int_equal(ret, EOK);
+    assert_non_null(test_ctx->sh);
+    assert_ptr_equal(test_ctx->srv, FO_SERVER(&servers[0]));
+    assert_ptr_equal(test_ctx->used, &servers[0]);
+
+    assert_int_equal(servers[0].start_order, 1);
+    assert_true(servers[0].sampled);
+    assert_int_equal(servers[1].start_order, 0);
+    assert_int_equal(servers[2].start_order, 0);
+}
+
+/* A slow server does not hold up the next one, the loser is cancelled
+ * without being marked as failed */
+static void test_race_slow_first(void **state)
+{
+    struct race_test_ctx *test_ctx;
+    struct race_test_server servers[] = {
+        { .uri = "ldap://a.example.com", .connect_delay = 1000 },
+        { .uri = "ldap://b.example.com" },
+        { .uri = "ldap://c.example.com" },
+    };
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct race_test_ctx);
+    test_race_set_servers(test_ctx, servers, 3);
+
+    ret = test_race_run(test_ctx);
+    assert_int_equal(ret, EOK);
+    assert_ptr_equal(test_ctx->srv, FO_SERVER(&servers[1]));
+    assert_ptr_equal(test_ctx->used, &servers[1]);
+
+    assert_int_equal(servers[0].start_order, 1);
+    assert_true(servers[0].cancelled);
+    assert_false(servers[0].marked_failed);
+    assert_false(servers[0].sampled);
+
+    assert_int_equal(servers[1].start_order, 2);
+    assert_true(servers[1].sampled);
+
+    /* The winner was found before the delay of the third server passed */
+    assert_int_equal(servers[2].start_order, 0);
+}
+
+/* A failed attempt starts the next server without waiting for the delay */
+static void test_race_failure_starts_next(void **state)
+{
+    struct race_test_ctx *test_ctx;
+    struct race_test_server servers[] = {
+        { .uri = "ldap://a.example.com", .connect_error = ECONNREFUSED },
+        { .uri = "ldap://b.example.com" },
+        { .uri = "ldap://c.example.com" },
+    };
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct race_test_ctx);
+    test_race_set_servers(test_ctx, servers, 3);
+    ret = dp_opt_set_int(test_ctx->opts->basic,
+                         SDAP_CONNECTION_RACE_DELAY, 60000);
+    assert_int_equal(ret, EOK);
+
+    ret = test_race_run(test_ctx);
+    assert_int_equal(ret, EOK);
+    assert_ptr_equal(test_ctx->srv, FO_SERVER(&servers[1]));
+
+    assert_true(servers[0].marked_failed);
+    assert_false(servers[0].cancelled);
+    assert_int_equal(servers[1].start_order, 2);
+    assert_false(servers[1].marked_failed);
+    assert_int_equal(servers[2].start_order, 0);
+}
+
+/* The first server cannot even be tried, the others still can win */
+static void test_race_sync_failure(void **state)
+{
+    struct race_test_ctx *test_ctx;
+    struct race_test_server servers[] = {
+        { .uri = "ldap://a.example.com", .tls_error = EINVAL },
+        { .uri = "ldap://b.example.com" },
+    };
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct race_test_ctx);
+    test_race_set_servers(test_ctx, servers, 2);
+
+    ret = test_race_run(test_ctx);
+    assert_int_equal(ret, EOK);
+    assert_ptr_equal(test_ctx->srv, FO_SERVER(&servers[1]));
+
+    assert_int_equal(servers[0].start_order, 0);
+    assert_int_equal(servers[1].start_order, 1);
+}
+
+/* The race fails only when every server failed, a server that could not be
+ * resolved is left to the fail over code */
+static void test_race_all_fail(void **state)
+{
+    struct race_test_ctx *test_ctx;
+    struct race_test_server servers[] = {
+        { .uri = "ldap://a.example.com", .connect_error = ECONNREFUSED },
+        { .uri = "ldap://b.example.com", .connect_error = ETIMEDOUT,
+          .connect_delay = 100 },
+        { .uri = "ldap://c.example.com", .resolve_error = ENOENT },
+    };
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct race_test_ctx);
+    test_race_set_servers(test_ctx, servers, 3);
+
+    ret = test_race_run(test_ctx);
+    assert_int_equal(ret, ETIMEDOUT);
+    assert_null(test_ctx->sh);
+    assert_null(test_ctx->used);
+
+    assert_true(servers[0].marked_failed);
+    assert_true(servers[1].marked_failed);
+    assert_false(servers[2].marked_failed);
+    assert_int_equal(servers[2].start_order, 0);
+}
+
+/* With ldap_connection_race_servers = 1 only the given server is tried */
+static void test_race_disabled(void **state)
+{
+    struct race_test_ctx *test_ctx;
+    struct race_test_server servers[] = {
+        { .uri = "ldap://a.example.com", .connect_error = ECONNREFUSED },
+        { .uri = "ldap://b.example.com" },
+    };
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct race_test_ctx);
+    test_race_set_servers(test_ctx, servers, 2);
+    ret = dp_opt_set_int(test_ctx->opts->basic,
+                         SDAP_CONNECTION_RACE_SERVERS, 1);
+    assert_int_equal(ret, EOK);
+
+    ret = test_race_run(test_ctx);
+    assert_int_equal(ret, ECONNREFUSED);
+    assert_true(servers[0].marked_failed);
+    assert_int_equal(servers[1].start_order, 0);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_race_first_wins,
+                                        test_race_setup,
+                                        test_race_teardown),
+        cmocka_unit_test_setup_teardown(test_race_slow_first,
+                                        test_race_setup,
+                                        test_race_teardown),
+        cmocka_unit_test_setup_teardown(test_race_failure_starts_next,
+                                        test_race_setup,
+                                        test_race_teardown),
+        cmocka_unit_test_setup_teardown(test_race_sync_failure,
+                                        test_race_setup,
+                                        test_race_teardown),
+        cmocka_unit_test_setup_teardown(test_race_all_fail,
+                                        test_race_setup,
+                                        test_race_teardown),
+        cmocka_unit_test_setup_teardown(test_race_disabled,
+                                        test_race_setup,
+                                        test_race_teardown),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    tests_set_cwd();
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,158 @@
+/*
+    Copyright (C) 2026 Red Hat
+
+    SSSD tests - DirSync control handling
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+#include <ldap.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "providers/ldap/sdap_async.h"
+
+/* The response control has the same layout as the request control, the
+ * first integer is the "more data" flag instead of the request flags */
+static void test_dirsync_control_roundtrip(void **state)
+{
+    const uint8_t cookie[] = { 0x4d, 0x53, 0x44, 0x53, 0x00, 0x03, 0xff };
+    struct berval *value = NULL;
+    uint8_t *parsed_cookie;
+    size_t parsed_len;
+    bool more;
+    errno_t ret;
+
+    ret = sdap_dirsync_create_control_value(1, SDAP_DIRSYNC_MAX_BYTES,
+                                            cookie, sizeof(cookie), &value);
+    assert_int_equal(ret, EOK);
+    assert_non_null(value);
+
+    ret = sdap_dirsync_parse_control_value(global_talloc_context, value,
+                                           &more, &parsed_cookie,
+                                           &parsed_len);
+    ber_bvfree(value);
+    assert_int_equal(ret, EOK);
+    assert_true(more);
+    assert_int_equal(parsed_len, sizeof(cookie));
+    assert_memory_equal(parsed_cookie, cookie, sizeof(cookie));
+    talloc_free(parsed_cookie);
+}
+
+static void test_dirsync_control_no_cookie(void **state)
+{
+    struct berval *value = NULL;
+    uint8_t *parsed_cookie;
+    size_t parsed_len;
+    bool more;
+    errno_t ret;
+
+    ret = sdap_dirsync_create_control_value(0, 0, NULL, 0, &value);
+    assert_int_equal(ret, EOK);
+
+    ret = sdap_dirsync_parse_control_value(global_talloc_context, value,
+                                           &more, &parsed_cookie,
+                                           &parsed_len);
+    ber_bvfree(value);
+    assert_int_equal(ret, EOK);
+    assert_false(more);
+    assert_null(parsed_cookie);
+    assert_int_equal(parsed_len, 0);
+}
+
+static void test_dirsync_control_malformed(void **state)
+{
+    char garbage[] = { 0x04, 0x01, 0x00 };
+    struct berval value = { sizeof(garbage), garbage };
+    uint8_t *parsed_cookie;
+    size_t parsed_len;
+    bool more;
+    errno_t ret;
+
+    ret = sdap_dirsync_parse_control_value(global_talloc_context, &value,
+                                           &more, &parsed_cookie,
+                                           &parsed_len);
+    assert_int_equal(ret, EINVAL);
+
+    ret = sdap_dirsync_parse_control_value(global_talloc_context, NULL,
+                                           &more, &parsed_cookie,
+                                           &parsed_len);
+    assert_int_equal(ret, EINVAL);
+}
+
+static void check_attr_desc(const char *desc, const char *exp_base,
+                            enum sdap_dirsync_value_op exp_op)
+{
+    enum sdap_dirsync_value_op op;
+    char *base;
+    errno_t ret;
+
+    ret = sdap_dirsync_parse_attr_desc(global_talloc_context, desc,
+                                       &base, &op);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(base, exp_base);
+    assert_int_equal(op, exp_op);
+    talloc_free(base);
+}
+
+static void test_dirsync_attr_desc(void **state)
+{
+    check_attr_desc("member", "member", SDAP_DIRSYNC_VALUE_REPLACE);
+    check_attr_desc("member;range=1-1", "member", SDAP_DIRSYNC_VALUE_ADD);
+    check_attr_desc("member;range=0-0", "member", SDAP_DIRSYNC_VALUE_DELETE);
+    check_attr_desc("Member;RANGE=1-1", "Member", SDAP_DIRSYNC_VALUE_ADD);
+    check_attr_desc("member;range=0-1499", "member;range=0-1499",
+                    SDAP_DIRSYNC_VALUE_REPLACE);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_dirsync_control_roundtrip),
+        cmocka_unit_test(test_dirsync_control_no_cookie),
+        cmocka_unit_test(test_dirsync_control_malformed),
+        cmocka_unit_test(test_dirsync_attr_desc),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
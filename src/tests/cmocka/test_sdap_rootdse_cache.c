@@ -0,0 +1,702 @@
+/*
+    Copyright (C) 2026 Red Hat
+
+    SSSD tests - Caching the rootDSE of the LDAP servers
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "tests/cmocka/common_mock_be.h"
+#include "tests/cmocka/common_mock_sdap.h"
+#include "providers/ldap/ldap_common.h"
+#include "providers/ldap/sdap_id_op.h"
+#include "providers/data_provider/dp.h"
+
+/* In order to access the static functions */
+#include "providers/ldap/sdap_async_connection.c"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_sdap_rootdse_cache_conf.ldb"
+#define TEST_DOM_NAME "sdap_rootdse_cache_test"
+#define TEST_ID_PROVIDER "ldap"
+
+#define TEST_URI "ldap://ldap.rootdse.test"
+#define TEST_NAMING_CONTEXT "dc=rootdse,dc=test"
+#define TEST_CACHE_TIMEOUT 600
+
+struct rootdse_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct be_ctx *be;
+    struct sdap_options *opts;
+    struct sdap_service *service;
+    struct sdap_id_ctx *id_ctx;
+    struct sdap_id_conn_ctx *conn;
+
+    /* What the server returns */
+    const char *last_usn;
+    errno_t rootdse_error;
+
+    /* What the server saw */
+    int searches;
+    int replies;
+    int reinit_cleanups;
+
+    /* Result of the last connect */
+    bool done;
+    errno_t error;
+    struct sdap_handle *sh;
+    struct sdap_server_opts *srv_opts;
+};
+
+static struct rootdse_test_ctx *rootdse_test;
+
+/* The single fake server */
+static int rootdse_test_server;
+#define TEST_FO_SERVER ((struct fo_server *) &rootdse_test_server)
+
+struct tevent_req *__wrap_be_resolve_server_send(TALLOC_CTX *memctx,
+                                                 struct tevent_context *ev,
+                                                 struct be_ctx *ctx,
+                                                 const char *service_name,
+                                                 bool first_try)
+{
+    struct tevent_req *req;
+    int *dummy;
+
+    req = tevent_req_create(memctx, &dummy, int);
+    assert_non_null(req);
+
+    rootdse_test->service->uri = discard_const(TEST_URI);
+
+    tevent_req_done(req);
+    return tevent_req_post(req, ev);
+}
+
+int __wrap_be_resolve_server_recv(struct tevent_req *req,
+                                  TALLOC_CTX *ref_ctx,
+                                  struct fo_server **srv)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *srv = TEST_FO_SERVER;
+    return EOK;
+}
+
+struct tevent_req *
+__wrap_sdap_connect_race_send(TALLOC_CTX *memctx,
+                              struct tevent_context *ev,
+                              struct sdap_options *opts,
+                              struct be_ctx *be,
+                              struct sdap_service *service,
+                              struct fo_server *srv,
+                              enum connect_tls force_tls)
+{
+    struct tevent_req *req;
+    int *dummy;
+
+    req = tevent_req_create(memctx, &dummy, int);
+    assert_non_null(req);
+
+    tevent_req_done(req);
+    return tevent_req_post(req, ev);
+}
+
+int __wrap_sdap_connect_race_recv(struct tevent_req *req,
+                                  TALLOC_CTX *memctx,
+                                  struct sdap_handle **_sh,
+                                  struct fo_server **_srv,
+                                  bool *_use_tls)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    /* Connected already, so that nothing tries to set up the fd */
+    *_sh = talloc_zero(memctx, struct sdap_handle);
+    assert_non_null(*_sh);
+    (*_sh)->connected = true;
+
+    *_srv = TEST_FO_SERVER;
+    *_use_tls = false;
+    return EOK;
+}
+
+void __wrap_fo_ref_server(TALLOC_CTX *ref_ctx, struct fo_server *server)
+{
+    return;
+}
+
+void __wrap__be_fo_set_port_status(struct be_ctx *ctx,
+                                   const char *service_name,
+                                   struct fo_server *server,
+                                   enum port_status status,
+                                   int line,
+                                   const char *file,
+                                   const char *function)
+{
+    return;
+}
+
+struct fake_rootdse_state {
+    struct sysdb_attrs *rootdse;
+};
+
+static struct sysdb_attrs *server_rootdse(TALLOC_CTX *mem_ctx)
+{
+    struct sysdb_attrs *rootdse;
+    errno_t ret;
+
+    rootdse = sysdb_new_attrs(mem_ctx);
+    assert_non_null(rootdse);
+
+    ret = sysdb_attrs_add_string(rootdse, SDAP_ROOTDSE_ATTR_NAMING_CONTEXTS,
+                                 TEST_NAMING_CONTEXT);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(rootdse,
+                                 SDAP_ROOTDSE_ATTR_DEFAULT_NAMING_CONTEXT,
+                                 TEST_NAMING_CONTEXT);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(rootdse, "supportedLDAPVersion", "3");
+    assert_int_equal(ret, EOK);
+    ret = sysdb_attrs_add_string(rootdse, SDAP_IPA_LAST_USN,
+                                 rootdse_test->last_usn);
+    assert_int_equal(ret, EOK);
+    /* Not used by sdap_cli_use_rootdse(), so not cached */
+    ret = sysdb_attrs_add_string(rootdse, "vendorName", "rootdse test");
+    assert_int_equal(ret, EOK);
+
+    return rootdse;
+}
+
+struct tevent_req *__wrap_sdap_get_rootdse_send(TALLOC_CTX *memctx,
+                                                struct tevent_context *ev,
+                                                struct sdap_options *opts,
+                                                struct sdap_handle *sh)
+{
+    struct fake_rootdse_state *state;
+    struct tevent_req *req;
+
+    req = tevent_req_create(memctx, &state, struct fake_rootdse_state);
+    assert_non_null(req);
+
+    rootdse_test->searches++;
+
+    if (rootdse_test->rootdse_error != EOK) {
+        tevent_req_error(req, rootdse_test->rootdse_error);
+    } else {
+        state->rootdse = server_rootdse(state);
+        tevent_req_done(req);
+    }
+
+    return tevent_req_post(req, ev);
+}
+
+int __wrap_sdap_get_rootdse_recv(struct tevent_req *req,
+                                 TALLOC_CTX *memctx,
+                                 struct sysdb_attrs **rootdse)
+{
+    struct fake_rootdse_state *state = tevent_req_data(req,
+                                                struct fake_rootdse_state);
+
+    rootdse_test->replies++;
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *rootdse = talloc_steal(memctx, state->rootdse);
+    return EOK;
+}
+
+struct tevent_req *__wrap_sdap_reinit_cleanup_send(TALLOC_CTX *mem_ctx,
+                                                   struct be_ctx *be_ctx,
+                                                   struct sdap_id_ctx *id_ctx)
+{
+    struct tevent_req *req;
+    int *dummy;
+
+    req = tevent_req_create(mem_ctx, &dummy, int);
+    assert_non_null(req);
+
+    rootdse_test->reinit_cleanups++;
+
+    tevent_req_done(req);
+    return tevent_req_post(req, be_ctx->ev);
+}
+
+errno_t __wrap_sdap_reinit_cleanup_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
+
+static void rootdse_test_connect_done(struct tevent_req *req)
+{
+    talloc_zfree(rootdse_test->sh);
+    talloc_zfree(rootdse_test->srv_opts);
+
+    /* Keep the handle, the refresh of the rootDSE runs on it */
+    rootdse_test->error = sdap_cli_connect_recv(req, rootdse_test, NULL,
+                                                &rootdse_test->sh,
+                                                &rootdse_test->srv_opts);
+    rootdse_test->done = true;
+    talloc_free(req);
+}
+
+static void rootdse_test_connect(void)
+{
+    struct tevent_req *req;
+
+    rootdse_test->done = false;
+    req = sdap_cli_connect_send(rootdse_test, rootdse_test->tctx->ev,
+                                rootdse_test->opts, rootdse_test->be,
+                                rootdse_test->service, false, CON_TLS_DFL,
+                                false);
+    assert_non_null(req);
+    tevent_req_set_callback(req, rootdse_test_connect_done, NULL);
+
+    while (!rootdse_test->done) {
+        tevent_loop_once(rootdse_test->tctx->ev);
+    }
+    assert_int_equal(rootdse_test->error, EOK);
+}
+
+/* Waits for the background refresh of the rootDSE */
+static void rootdse_test_wait_refresh(void)
+{
+    while (rootdse_test->replies < rootdse_test->searches) {
+        tevent_loop_once(rootdse_test->tctx->ev);
+    }
+}
+
+static struct sdap_rootdse_cache_entry *cache_entry(void)
+{
+    assert_non_null(rootdse_test->opts->rootdse_cache);
+
+    return sdap_rootdse_cache_find(rootdse_test->opts->rootdse_cache,
+                                   TEST_URI);
+}
+
+static void assert_cached_usn(const char *last_usn)
+{
+    struct sdap_rootdse_cache_entry *entry;
+    const char *value;
+    errno_t ret;
+
+    entry = cache_entry();
+    assert_non_null(entry);
+
+    ret = sysdb_attrs_get_string(entry->rootdse, SDAP_IPA_LAST_USN, &value);
+    assert_int_equal(ret, EOK);
+    assert_string_equal(value, last_usn);
+}
+
+static void assert_expire(time_t expire, time_t timeout)
+{
+    time_t now = time(NULL);
+
+    assert_true(expire >= now + timeout - 5);
+    assert_true(expire <= now + timeout);
+}
+
+static void set_srv_opts(unsigned long last_usn)
+{
+    struct sdap_server_opts *srv_opts;
+
+    srv_opts = talloc_zero(rootdse_test->id_ctx, struct sdap_server_opts);
+    assert_non_null(srv_opts);
+    srv_opts->server_id = talloc_strdup(srv_opts, TEST_URI);
+    assert_non_null(srv_opts->server_id);
+    srv_opts->supports_usn = true;
+    srv_opts->last_usn = last_usn;
+    srv_opts->max_user_value = talloc_strdup(srv_opts, "10");
+    assert_non_null(srv_opts->max_user_value);
+    srv_opts->max_group_value = talloc_strdup(srv_opts, "10");
+    assert_non_null(srv_opts->max_group_value);
+
+    talloc_zfree(rootdse_test->id_ctx->srv_opts);
+    rootdse_test->id_ctx->srv_opts = srv_opts;
+}
+
+static int rootdse_test_setup(void **state)
+{
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    rootdse_test = talloc_zero(global_talloc_context, struct rootdse_test_ctx);
+    assert_non_null(rootdse_test);
+
+    rootdse_test->tctx = create_dom_test_ctx(rootdse_test, TESTS_PATH,
+                                             TEST_CONF_DB, TEST_DOM_NAME,
+                                             TEST_ID_PROVIDER, NULL);
+    assert_non_null(rootdse_test->tctx);
+
+    rootdse_test->be = mock_be_ctx(rootdse_test, rootdse_test->tctx);
+    rootdse_test->opts = mock_sdap_options_ldap(rootdse_test,
+                                                rootdse_test->tctx->dom,
+                                                rootdse_test->tctx->confdb,
+                                                rootdse_test->tctx->conf_dom_path);
+    assert_non_null(rootdse_test->opts);
+
+    ret = dp_opt_set_int(rootdse_test->opts->basic,
+                         SDAP_ROOTDSE_CACHE_TIMEOUT, TEST_CACHE_TIMEOUT);
+    assert_int_equal(ret, EOK);
+
+    rootdse_test->service = talloc_zero(rootdse_test, struct sdap_service);
+    assert_non_null(rootdse_test->service);
+    rootdse_test->service->name = discard_const("LDAP");
+
+    rootdse_test->id_ctx = mock_sdap_id_ctx(rootdse_test, rootdse_test->be,
+                                            rootdse_test->opts);
+
+    rootdse_test->conn = talloc_zero(rootdse_test->id_ctx,
+                                     struct sdap_id_conn_ctx);
+    assert_non_null(rootdse_test->conn);
+    rootdse_test->conn->id_ctx = rootdse_test->id_ctx;
+    rootdse_test->conn->service = rootdse_test->service;
+    ret = sdap_id_conn_cache_create(rootdse_test->conn, rootdse_test->conn,
+                                    &rootdse_test->conn->conn_cache);
+    assert_int_equal(ret, EOK);
+    rootdse_test->id_ctx->conn = rootdse_test->conn;
+
+    rootdse_test->last_usn = "100";
+
+    *state = rootdse_test;
+    return 0;
+}
+
+static int rootdse_test_teardown(void **state)
+{
+    talloc_zfree(rootdse_test);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void test_rootdse_cache_disabled(void **state)
+{
+    dp_opt_set_int(rootdse_test->opts->basic, SDAP_ROOTDSE_CACHE_TIMEOUT, 0);
+
+    rootdse_test_connect();
+    rootdse_test_connect();
+
+    assert_int_equal(rootdse_test->searches, 2);
+    assert_null(rootdse_test->opts->rootdse_cache);
+    assert_false(rootdse_test->srv_opts->cached_last_usn);
+}
+
+static void test_rootdse_cache_valid(void **state)
+{
+    struct sdap_rootdse_cache_entry *entry;
+    const char *value;
+    errno_t ret;
+
+    rootdse_test_connect();
+    assert_int_equal(rootdse_test->searches, 1);
+    assert_false(rootdse_test->srv_opts->cached_last_usn);
+
+    entry = cache_entry();
+    assert_non_null(entry);
+    assert_expire(entry->expire, TEST_CACHE_TIMEOUT);
+    assert_cached_usn("100");
+    ret = sysdb_attrs_get_string(entry->rootdse, "vendorName", &value);
+    assert_int_equal(ret, ENOENT);
+
+    /* The server is not asked again while the copy is valid */
+    rootdse_test->last_usn = "200";
+    rootdse_test_connect();
+    assert_int_equal(rootdse_test->searches, 1);
+    assert_true(rootdse_test->srv_opts->cached_last_usn);
+    assert_true(rootdse_test->srv_opts->supports_usn);
+    assert_int_equal(rootdse_test->srv_opts->last_usn, 100);
+
+    /* After a restart of the backend the copy is read from sysdb */
+    talloc_zfree(rootdse_test->opts->rootdse_cache);
+    rootdse_test_connect();
+    assert_int_equal(rootdse_test->searches, 1);
+    assert_true(rootdse_test->srv_opts->cached_last_usn);
+    assert_int_equal(rootdse_test->srv_opts->last_usn, 100);
+    assert_expire(cache_entry()->expire, TEST_CACHE_TIMEOUT);
+}
+
+/* An expired copy is still used to connect and refreshed afterwards */
+static void test_rootdse_cache_expired(void **state)
+{
+    struct sdap_rootdse_cache_entry *entry;
+    int search_timeout;
+
+    search_timeout = dp_opt_get_int(rootdse_test->opts->basic,
+                                    SDAP_SEARCH_TIMEOUT);
+
+    rootdse_test_connect();
+    assert_int_equal(rootdse_test->searches, 1);
+
+    entry = cache_entry();
+    entry->expire = time(NULL) - 1;
+    rootdse_test->last_usn = "200";
+
+    rootdse_test_connect();
+
+    /* The connection was set up with the stale copy */
+    assert_true(rootdse_test->srv_opts->cached_last_usn);
+    assert_int_equal(rootdse_test->srv_opts->last_usn, 100);
+
+    /* Other connections keep using it while the refresh runs */
+    assert_int_equal(rootdse_test->searches, 2);
+    assert_int_equal(rootdse_test->replies, 1);
+    assert_expire(cache_entry()->expire, search_timeout);
+    assert_cached_usn("100");
+
+    rootdse_test_wait_refresh();
+
+    assert_cached_usn("200");
+    assert_expire(cache_entry()->expire, TEST_CACHE_TIMEOUT);
+
+    /* The next connection uses the refreshed copy */
+    rootdse_test_connect();
+    assert_int_equal(rootdse_test->searches, 2);
+    assert_int_equal(rootdse_test->srv_opts->last_usn, 200);
+}
+
+static void test_rootdse_cache_refresh_error(void **state)
+{
+    int search_timeout;
+
+    search_timeout = dp_opt_get_int(rootdse_test->opts->basic,
+                                    SDAP_SEARCH_TIMEOUT);
+
+    rootdse_test_connect();
+    cache_entry()->expire = time(NULL) - 1;
+
+    rootdse_test->rootdse_error = EIO;
+    rootdse_test_connect();
+    rootdse_test_wait_refresh();
+    assert_int_equal(rootdse_test->searches, 2);
+
+    /* The stale copy is kept and tried again after the grace period */
+    assert_cached_usn("100");
+    assert_expire(cache_entry()->expire, search_timeout);
+}
+
+/* The refresh goes away together with the connection */
+static void test_rootdse_cache_refresh_cancelled(void **state)
+{
+    rootdse_test_connect();
+    cache_entry()->expire = time(NULL) - 1;
+    rootdse_test->last_usn = "200";
+
+    rootdse_test_connect();
+    assert_int_equal(rootdse_test->searches, 2);
+    talloc_zfree(rootdse_test->sh);
+
+    /* Runs the event loop, the copy is within its grace period */
+    rootdse_test_connect();
+    assert_int_equal(rootdse_test->searches, 2);
+    assert_int_equal(rootdse_test->replies, 1);
+    assert_cached_usn("100");
+}
+
+static void rootdse_test_id_op_done(struct tevent_req *req)
+{
+    int dp_error;
+
+    rootdse_test->error = sdap_id_op_connect_recv(req, &dp_error);
+    rootdse_test->done = true;
+}
+
+static struct sdap_id_op *rootdse_test_id_op_connect(void)
+{
+    struct sdap_id_op *op;
+    struct tevent_req *req;
+    errno_t ret;
+
+    op = sdap_id_op_create(rootdse_test, rootdse_test->conn->conn_cache);
+    assert_non_null(op);
+
+    rootdse_test->done = false;
+    req = sdap_id_op_connect_send(op, op, &ret);
+    assert_non_null(req);
+    assert_int_equal(ret, EOK);
+    tevent_req_set_callback(req, rootdse_test_id_op_done, NULL);
+
+    while (!rootdse_test->done) {
+        tevent_loop_once(rootdse_test->tctx->ev);
+    }
+    assert_int_equal(rootdse_test->error, EOK);
+
+    return op;
+}
+
+/* A lower USN in a cached rootDSE does not mean the server was
+ * re-initialized, it is just old */
+static void test_rootdse_cache_usn_cached(void **state)
+{
+    struct sdap_id_op *op;
+
+    /* Cache the rootDSE with USN 100 */
+    rootdse_test_connect();
+    assert_int_equal(rootdse_test->searches, 1);
+
+    set_srv_opts(500);
+
+    op = rootdse_test_id_op_connect();
+    assert_int_equal(rootdse_test->searches, 1);
+
+    assert_int_equal(rootdse_test->reinit_cleanups, 0);
+    assert_int_equal(rootdse_test->id_ctx->srv_opts->last_usn, 500);
+    assert_string_equal(rootdse_test->id_ctx->srv_opts->max_user_value, "10");
+    assert_string_equal(rootdse_test->id_ctx->srv_opts->max_group_value,
+                        "10");
+
+    talloc_free(op);
+}
+
+static void test_rootdse_cache_usn_reinit(void **state)
+{
+    struct sdap_id_op *op;
+
+    /* The rootDSE is read from the server, the lower USN is real */
+    set_srv_opts(500);
+
+    op = rootdse_test_id_op_connect();
+    assert_int_equal(rootdse_test->searches, 1);
+    tevent_loop_once(rootdse_test->tctx->ev);
+
+    assert_int_equal(rootdse_test->reinit_cleanups, 1);
+    assert_int_equal(rootdse_test->id_ctx->srv_opts->last_usn, 100);
+    assert_null(rootdse_test->id_ctx->srv_opts->max_user_value);
+    assert_null(rootdse_test->id_ctx->srv_opts->max_group_value);
+
+    talloc_free(op);
+}
+
+static void rootdse_test_online_check_done(struct tevent_req *req)
+{
+    struct dp_reply_std reply;
+
+    rootdse_test->error = sdap_online_check_handler_recv(rootdse_test, req,
+                                                         &reply);
+    if (rootdse_test->error == EOK) {
+        rootdse_test->error = reply.error;
+    }
+    rootdse_test->done = true;
+    talloc_free(req);
+}
+
+/* The online check does not trust the cached copy, the server might have
+ * been re-initialized while we were offline */
+static void test_rootdse_cache_online_check(void **state)
+{
+    struct dp_req_params params = { 0 };
+    struct tevent_req *req;
+
+    rootdse_test_connect();
+    assert_int_equal(rootdse_test->searches, 1);
+
+    set_srv_opts(500);
+    params.ev = rootdse_test->tctx->ev;
+
+    rootdse_test->done = false;
+    req = sdap_online_check_handler_send(rootdse_test, rootdse_test->id_ctx,
+                                         NULL, &params);
+    assert_non_null(req);
+    tevent_req_set_callback(req, rootdse_test_online_check_done, NULL);
+
+    while (!rootdse_test->done) {
+        tevent_loop_once(rootdse_test->tctx->ev);
+    }
+    assert_int_equal(rootdse_test->error, EOK);
+
+    assert_int_equal(rootdse_test->searches, 2);
+    assert_int_equal(rootdse_test->reinit_cleanups, 1);
+    assert_int_equal(rootdse_test->id_ctx->srv_opts->last_usn, 100);
+    assert_null(rootdse_test->id_ctx->srv_opts->max_user_value);
+
+    /* The fresh copy is cached again */
+    assert_expire(cache_entry()->expire, TEST_CACHE_TIMEOUT);
+}
+
+int main(int argc, const char *argv[])
+{
+    int rv;
+    int no_cleanup = 0;
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        {"no-cleanup", 'n', POPT_ARG_NONE, &no_cleanup, 0,
+         _("Do not delete the test database after a test run"), NULL },
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_rootdse_cache_disabled,
+                                        rootdse_test_setup,
+                                        rootdse_test_teardown),
+        cmocka_unit_test_setup_teardown(test_rootdse_cache_valid,
+                                        rootdse_test_setup,
+                                        rootdse_test_teardown),
+        cmocka_unit_test_setup_teardown(test_rootdse_cache_expired,
+                                        rootdse_test_setup,
+                                        rootdse_test_teardown),
+        cmocka_unit_test_setup_teardown(test_rootdse_cache_refresh_error,
+                                        rootdse_test_setup,
+                                        rootdse_test_teardown),
+        cmocka_unit_test_setup_teardown(test_rootdse_cache_refresh_cancelled,
+                                        rootdse_test_setup,
+                                        rootdse_test_teardown),
+        cmocka_unit_test_setup_teardown(test_rootdse_cache_usn_cached,
+                                        rootdse_test_setup,
+                                        rootdse_test_teardown),
+        cmocka_unit_test_setup_teardown(test_rootdse_cache_usn_reinit,
+                                        rootdse_test_setup,
+                                        rootdse_test_teardown),
+        cmocka_unit_test_setup_teardown(test_rootdse_cache_online_check,
+                                        rootdse_test_setup,
+                                        rootdse_test_teardown),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old DB to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    test_dom_suite_setup(TESTS_PATH);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    if (rv == 0 && !no_cleanup) {
+        test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    }
+    return rv;
+}
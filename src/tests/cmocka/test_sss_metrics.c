@@ -0,0 +1,166 @@
+/*
+    SSSD
+
+    test_sss_metrics - Runtime performance metrics tests
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <unistd.h>
+#include <cmocka.h>
+#include <popt.h>
+#include <tevent.h>
+
+#include "util/util.h"
+#include "util/sss_metrics.h"
+
+#define TEST_SNAPSHOT "tp_" BASE_FILE_STEM SSS_METRICS_SNAPSHOT_SUFFIX
+
+static void test_sss_metrics_counter(void **state)
+{
+    struct sss_metric *counter;
+
+    counter = sss_metric_counter("test.%s.counter", "a");
+    assert_non_null(counter);
+    assert_int_equal(sss_metric_value(counter), 0);
+
+    sss_metric_add(counter, 2);
+    sss_metrics_inc("test.a.counter");
+    assert_ptr_equal(sss_metric_counter("test.a.counter"), counter);
+    assert_int_equal(sss_metric_value(counter), 3);
+
+    /* The name is already taken by a counter */
+    assert_null(sss_metric_histogram("test.a.counter"));
+
+    /* Must not crash */
+    sss_metric_add(NULL, 1);
+    sss_metric_observe(NULL, 1);
+    assert_int_equal(sss_metric_value(NULL), 0);
+}
+
+static void test_sss_metrics_histogram(void **state)
+{
+    struct sss_metric *histogram;
+    struct timeval start;
+    uint64_t i;
+
+    histogram = sss_metric_histogram("test.histogram");
+    assert_non_null(histogram);
+    assert_int_equal(sss_metric_percentile(histogram, 50), 0);
+
+    for (i = 1; i <= 1000; i++) {
+        sss_metric_observe(histogram, i);
+    }
+
+    assert_int_equal(sss_metric_value(histogram), 1000);
+    /* Upper bounds of the buckets 480-511, 896-959 and 960-1023 */
+    assert_int_equal(sss_metric_percentile(histogram, 50), 511);
+    assert_int_equal(sss_metric_percentile(histogram, 90), 959);
+    assert_int_equal(sss_metric_percentile(histogram, 99), 1000);
+
+    /* Small values are exact */
+    histogram = sss_metric_histogram("test.histogram.small");
+    assert_non_null(histogram);
+    sss_metric_observe(histogram, 3);
+    sss_metric_observe(histogram, 12);
+    assert_int_equal(sss_metric_percentile(histogram, 50), 3);
+    assert_int_equal(sss_metric_percentile(histogram, 100), 12);
+
+    /* A start in the future is counted as zero */
+    histogram = sss_metric_histogram("test.histogram.since");
+    assert_non_null(histogram);
+    start = tevent_timeval_current_ofs(10, 0);
+    sss_metric_observe_since(histogram, &start);
+    assert_int_equal(sss_metric_value(histogram), 1);
+    assert_int_equal(sss_metric_percentile(histogram, 100), 0);
+}
+
+static void test_sss_metrics_snapshot(void **state)
+{
+    struct sss_metric *counter;
+    struct sss_metric *histogram;
+    char *report;
+    errno_t ret;
+
+    counter = sss_metric_counter("test.snapshot.counter");
+    assert_non_null(counter);
+    sss_metric_add(counter, 5);
+
+    histogram = sss_metric_histogram("test.snapshot.latency");
+    assert_non_null(histogram);
+    sss_metric_observe(histogram, 100);
+    sss_metric_observe(histogram, 100000);
+
+    ret = sss_metrics_write(TEST_SNAPSHOT);
+    assert_int_equal(ret, EOK);
+
+    /* Reading the snapshot back merges it with the current values */
+    ret = sss_metrics_read(TEST_SNAPSHOT);
+    unlink(TEST_SNAPSHOT);
+    assert_int_equal(ret, EOK);
+
+    assert_int_equal(sss_metric_value(counter), 10);
+    assert_int_equal(sss_metric_value(histogram), 4);
+    assert_int_equal(sss_metric_percentile(histogram, 50), 103);
+    assert_int_equal(sss_metric_percentile(histogram, 100), 100000);
+
+    report = sss_metrics_report(NULL);
+    assert_non_null(report);
+    assert_non_null(strstr(report, "test.snapshot.counter"));
+    assert_non_null(strstr(report, "test.snapshot.latency"));
+    talloc_free(report);
+
+    assert_int_not_equal(sss_metrics_read(TEST_SNAPSHOT), EOK);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_sss_metrics_counter),
+        cmocka_unit_test(test_sss_metrics_histogram),
+        cmocka_unit_test(test_sss_metrics_snapshot),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,137 @@
+/*
+    SSSD
+
+    test_sss_trace - Request latency tracing tests
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <string.h>
+#include <cmocka.h>
+#include <popt.h>
+#include <tevent.h>
+
+#include "util/util.h"
+#include "util/sss_trace.h"
+
+static void test_sss_trace_find(void **state)
+{
+    TALLOC_CTX *mem_ctx;
+    struct sss_trace *trace;
+    struct sss_trace *inner;
+    TALLOC_CTX *child;
+    TALLOC_CTX *grandchild;
+
+    mem_ctx = talloc_new(NULL);
+    assert_non_null(mem_ctx);
+
+    trace = sss_trace_new(mem_ctx, "nss:%d:%u", 100, 5);
+    assert_non_null(trace);
+    assert_string_equal(sss_trace_id(trace), "nss:100:5");
+
+    child = talloc_new(trace);
+    assert_non_null(child);
+    grandchild = talloc_new(child);
+    assert_non_null(grandchild);
+
+    assert_ptr_equal(sss_trace_find(trace), trace);
+    assert_ptr_equal(sss_trace_find(grandchild), trace);
+    assert_null(sss_trace_find(mem_ctx));
+    assert_null(sss_trace_find(NULL));
+    assert_null(sss_trace_id(NULL));
+
+    /* The closest trace wins */
+    inner = sss_trace_new(grandchild, "%s", sss_trace_id(trace));
+    assert_non_null(inner);
+    child = talloc_new(inner);
+    assert_non_null(child);
+    assert_ptr_equal(sss_trace_find(child), inner);
+    assert_string_equal(sss_trace_id(inner), "nss:100:5");
+
+    talloc_free(mem_ctx);
+}
+
+static void test_sss_trace_record(void **state)
+{
+    struct sss_trace *trace;
+    struct timeval start;
+    char *record;
+
+    trace = sss_trace_new(NULL, "be:%d:%u", 200, 7);
+    assert_non_null(trace);
+
+    start = tevent_timeval_current();
+    start.tv_sec -= 2;
+    sss_trace_add(trace, SSS_TRACE_LDAP, &start);
+    sss_trace_add(trace, SSS_TRACE_LDAP, &start);
+
+    /* A start in the future is counted as zero */
+    start = tevent_timeval_current_ofs(10, 0);
+    sss_trace_add(trace, SSS_TRACE_CONNECT, &start);
+
+    /* Must not crash */
+    sss_trace_add(NULL, SSS_TRACE_CACHE, &start);
+    sss_trace_report(NULL, "Account #1", NULL, EOK);
+
+    record = sss_trace_record(trace, trace, "Account #7", NULL, ENOENT);
+    assert_non_null(record);
+
+    assert_true(strncmp(record, SSS_TRACE_RECORD " id=be:200:7 total=",
+                        strlen(SSS_TRACE_RECORD " id=be:200:7 total=")) == 0);
+    assert_non_null(strstr(record, "us ret=2 cache=0/0us backend=0/0us "
+                                   "connect=1/0us ldap=2/"));
+    assert_null(strstr(record, "ldap=2/0us"));
+    assert_non_null(strstr(record, " request=[Account #7] object=[-]"));
+
+    talloc_free(trace);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_sss_trace_find),
+        cmocka_unit_test(test_sss_trace_record),
+    };
+
+    /* Set debug level to invalid value so we can decide if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,192 @@
+/*
+    SSSD
+
+    Debug logging benchmark
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <popt.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "util/util.h"
+
+#define DEFAULT_LINES   200000
+#define DEFAULT_ROUNDS  5
+
+#define BENCH_FILTER    "(&(objectClass=posixAccount)(uid=user1234))"
+
+static double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Roughly what sssd_be logs for every lookup with debug_level = 6 */
+static double bench_run(int lines, bool buffered)
+{
+    double start;
+    int i;
+
+    if (buffered) {
+        debug_enable_buffering(NULL, NULL);
+    }
+
+    start = bench_now();
+    for (i = 0; i < lines; i++) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Searching for entry %d in domain %s with filter %s\n",
+              i, "example.com", BENCH_FILTER);
+    }
+    debug_flush();
+
+    if (buffered) {
+        debug_disable_buffering();
+    }
+
+    return bench_now() - start;
+}
+
+/* The same messages with debug_level = 2, they are not logged but kept in
+ * the backtrace ring if it is enabled */
+static double bench_backtrace(int lines, bool enabled)
+{
+    int old_level = debug_level;
+    double start;
+    int i;
+
+    debug_level = SSSDBG_FATAL_FAILURE | SSSDBG_CRIT_FAILURE
+                  | SSSDBG_OP_FAILURE;
+    debug_backtrace_enable(enabled);
+
+    start = bench_now();
+    for (i = 0; i < lines; i++) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Searching for entry %d in domain %s with filter %s\n",
+              i, "example.com", BENCH_FILTER);
+    }
+    start = bench_now() - start;
+
+    debug_backtrace_enable(false);
+    debug_level = old_level;
+
+    return start;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int lines = DEFAULT_LINES;
+    int rounds = DEFAULT_ROUNDS;
+    char log_path[] = "/tmp/sssd-debug-bench.XXXXXX";
+    double direct;
+    double buffered;
+    double skipped;
+    double kept;
+    double best_direct = 0;
+    double best_buffered = 0;
+    double best_skipped = 0;
+    double best_kept = 0;
+    struct stat st;
+    int fd;
+    int ret;
+    int i;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        { "lines", 'n', POPT_ARG_INT, &lines, 0,
+          "Number of messages logged per round", NULL },
+        { "rounds", 'r', POPT_ARG_INT, &rounds, 0,
+          "How many times the messages are logged", NULL },
+        POPT_TABLEEND
+    };
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    if (lines <= 0 || rounds <= 0) {
+        fprintf(stderr, "All counts must be positive\n");
+        return 1;
+    }
+
+    fd = mkstemp(log_path);
+    if (fd == -1) {
+        fprintf(stderr, "Cannot create the log file\n");
+        return 1;
+    }
+
+    ret = set_debug_file_from_fd(fd);
+    if (ret != EOK) {
+        fprintf(stderr, "Cannot use the log file\n");
+        close(fd);
+        unlink(log_path);
+        return 1;
+    }
+
+    debug_prg_name = "debug-bench";
+    debug_level = SSSDBG_MASK_ALL;
+    debug_timestamps = 1;
+    debug_microseconds = 1;
+
+    for (i = 0; i < rounds; i++) {
+        direct = bench_run(lines, false);
+        buffered = bench_run(lines, true);
+        skipped = bench_backtrace(lines, false);
+        kept = bench_backtrace(lines, true);
+
+        if (i == 0 || direct < best_direct) best_direct = direct;
+        if (i == 0 || buffered < best_buffered) best_buffered = buffered;
+        if (i == 0 || skipped < best_skipped) best_skipped = skipped;
+        if (i == 0 || kept < best_kept) best_kept = kept;
+    }
+
+    ret = fstat(fd, &st);
+    unlink(log_path);
+    if (ret != 0 || st.st_size == 0) {
+        fprintf(stderr, "Nothing was written to the log file\n");
+        return 1;
+    }
+
+    printf("messages: %d, best of %d rounds, %lld bytes written\n",
+           lines, rounds, (long long) st.st_size);
+    printf("direct:   %10.0f lines/s, %8.3f us/line\n",
+           lines / best_direct, best_direct * 1e6 / lines);
+    printf("buffered: %10.0f lines/s, %8.3f us/line\n",
+           lines / best_buffered, best_buffered * 1e6 / lines);
+    printf("below the debug level:\n");
+    printf("skipped:  %10.0f lines/s, %8.3f us/line\n",
+           lines / best_skipped, best_skipped * 1e6 / lines);
+    printf("in ring:  %10.0f lines/s, %8.3f us/line\n",
+           lines / best_kept, best_kept * 1e6 / lines);
+
+    return 0;
+}
@@ -661,6 +661,76 @@ START_TEST(test_debug_is_set_false)
 }
 END_TEST
 
+START_TEST(test_debug_backtrace)
+{
+    char filename[24] = {'\0'};
+    char content[2048];
+    const char *first;
+    const char *error;
+    const char *second;
+    mode_t old_umask;
+    FILE *file;
+    size_t len;
+    int fd;
+    int ret;
+
+    strncpy(filename, "sssd_debug_tests.XXXXXX", 24);
+
+    old_umask = umask(SSS_DFL_UMASK);
+    fd = mkstemp(filename);
+    umask(old_umask);
+    fail_if(fd == -1, "mkstemp failed");
+
+    file = fdopen(fd, "r");
+    fail_if(file == NULL, "fdopen failed");
+
+    ret = set_debug_file_from_fd(fd);
+    fail_unless(ret == EOK, "set_debug_file_from_fd failed");
+
+    debug_timestamps = 0;
+    debug_microseconds = 0;
+    debug_prg_name = "sssd";
+    sss_set_logger(sss_logger_str[FILES_LOGGER]);
+    debug_level = SSSDBG_FATAL_FAILURE | SSSDBG_CRIT_FAILURE;
+    debug_backtrace_enable(true);
+
+    DEBUG(SSSDBG_TRACE_FUNC, "first message\n");
+    DEBUG(SSSDBG_TRACE_ALL, "message not kept\n");
+    DEBUG(SSSDBG_CRIT_FAILURE, "error message\n");
+    /* Nothing new to write */
+    DEBUG(SSSDBG_CRIT_FAILURE, "another error message\n");
+    DEBUG(SSSDBG_OP_FAILURE, "second message\n");
+    debug_backtrace_dump();
+
+    debug_backtrace_enable(false);
+
+    /* The offset is shared with the debug file */
+    rewind(file);
+    len = fread(content, 1, sizeof(content) - 1, file);
+    content[len] = '\0';
+    fclose(file);
+    remove(filename);
+
+    first = strstr(content, "first message");
+    error = strstr(content, "error message");
+    second = strstr(content, "second message");
+    fail_if(first == NULL || error == NULL || second == NULL,
+            "Message missing in [%s]", content);
+    fail_unless(first < error && error < second,
+                "Messages in wrong order in [%s]", content);
+    fail_unless(strstr(content, "message not kept") == NULL,
+                "Unexpected message in [%s]", content);
+
+    /* One backtrace before the error, one requested */
+    first = strstr(content, "BEGIN BACKTRACE: 1 messages");
+    fail_if(first == NULL, "No backtrace in [%s]", content);
+    fail_if(strstr(first + 1, "BEGIN BACKTRACE: 1 messages") == NULL,
+            "No second backtrace in [%s]", content);
+    fail_unless(first < strstr(content, "first message"),
+                "Backtrace does not precede the error in [%s]", content);
+}
+END_TEST
+
 Suite *debug_suite(void)
 {
     Suite *s = suite_create("debug");
@@ -677,6 +747,7 @@ Suite *debug_suite(void)
     tcase_add_test(tc_debug, test_debug_is_notset_timestamp_microseconds);
     tcase_add_test(tc_debug, test_debug_is_set_true);
     tcase_add_test(tc_debug, test_debug_is_set_false);
+    tcase_add_test(tc_debug, test_debug_backtrace);
     tcase_set_timeout(tc_debug, 60);
 
     suite_add_tcase(s, tc_debug);
@@ -0,0 +1,336 @@
+/*
+    SSSD
+
+    HBAC evaluation benchmark
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <talloc.h>
+#include <popt.h>
+#include <time.h>
+
+#include "util/util.h"
+#include "lib/ipa_hbac/ipa_hbac.h"
+
+#define DEFAULT_RULES    10000
+#define DEFAULT_REQUESTS 1000
+#define DEFAULT_ROUNDS   5
+
+#define BENCH_USERS      5000
+#define BENCH_GROUPS     500
+#define BENCH_SERVICES   20
+#define BENCH_HOSTS      2000
+#define BENCH_HOSTGROUPS 100
+#define BENCH_REQ_GROUPS 10
+
+static const char **bench_list(TALLOC_CTX *mem_ctx, const char *fmt,
+                               size_t first, size_t count, size_t modulo)
+{
+    const char **list;
+    size_t i;
+
+    list = talloc_zero_array(mem_ctx, const char *, count + 1);
+    if (list == NULL) return NULL;
+
+    for (i = 0; i < count; i++) {
+        list[i] = talloc_asprintf(list, fmt, (first + i) % modulo);
+        if (list[i] == NULL) return NULL;
+    }
+
+    return list;
+}
+
+static struct hbac_rule_element *bench_element(TALLOC_CTX *mem_ctx,
+                                               bool category_all,
+                                               const char *name_fmt,
+                                               size_t name,
+                                               size_t num_names,
+                                               const char *group_fmt,
+                                               size_t group,
+                                               size_t num_groups)
+{
+    struct hbac_rule_element *el;
+
+    el = talloc_zero(mem_ctx, struct hbac_rule_element);
+    if (el == NULL) return NULL;
+
+    if (category_all) {
+        el->category = HBAC_CATEGORY_ALL;
+        return el;
+    }
+
+    el->names = bench_list(el, name_fmt, name, 1, num_names);
+    el->groups = bench_list(el, group_fmt, group, 1, num_groups);
+    if (el->names == NULL || el->groups == NULL) return NULL;
+
+    return el;
+}
+
+/* Rules in the shape of a large IPA deployment: each rule grants one user
+ * and one user group access to one service on one host and one hostgroup.
+ * A few rules apply to all services. */
+static struct hbac_rule **bench_create_rules(TALLOC_CTX *mem_ctx,
+                                             size_t num_rules)
+{
+    struct hbac_rule **rules;
+    struct hbac_rule *rule;
+    size_t n;
+
+    rules = talloc_zero_array(mem_ctx, struct hbac_rule *, num_rules + 1);
+    if (rules == NULL) return NULL;
+
+    for (n = 0; n < num_rules; n++) {
+        rule = talloc_zero(rules, struct hbac_rule);
+        if (rule == NULL) return NULL;
+
+        rule->name = talloc_asprintf(rule, "rule%zu", n);
+        rule->enabled = true;
+        rule->users = bench_element(rule, false,
+                                    "user%zu", n * 7, BENCH_USERS,
+                                    "group%zu", n * 3, BENCH_GROUPS);
+        rule->services = bench_element(rule, n % 50 == 0,
+                                       "svc%zu", n, BENCH_SERVICES,
+                                       "svcgroup%zu", n, BENCH_SERVICES);
+        rule->targethosts = bench_element(rule, false,
+                                          "host%zu.example.com", n * 11,
+                                          BENCH_HOSTS,
+                                          "hostgroup%zu", n * 13,
+                                          BENCH_HOSTGROUPS);
+        rule->srchosts = bench_element(rule, true, NULL, 0, 0, NULL, 0, 0);
+        if (rule->name == NULL || rule->users == NULL
+                || rule->services == NULL || rule->targethosts == NULL
+                || rule->srchosts == NULL) {
+            return NULL;
+        }
+
+        rules[n] = rule;
+    }
+
+    return rules;
+}
+
+static struct hbac_eval_req *bench_create_request(TALLOC_CTX *mem_ctx,
+                                                  size_t n)
+{
+    struct hbac_eval_req *req;
+    const char **names;
+
+    req = talloc_zero(mem_ctx, struct hbac_eval_req);
+    if (req == NULL) return NULL;
+
+    req->user = talloc_zero(req, struct hbac_request_element);
+    req->service = talloc_zero(req, struct hbac_request_element);
+    req->targethost = talloc_zero(req, struct hbac_request_element);
+    req->srchost = talloc_zero(req, struct hbac_request_element);
+    if (req->user == NULL || req->service == NULL
+            || req->targethost == NULL || req->srchost == NULL) {
+        return NULL;
+    }
+
+    names = bench_list(req, "USER%zu", n * 31, 1, BENCH_USERS);
+    if (names == NULL) return NULL;
+    req->user->name = names[0];
+    req->user->groups = bench_list(req, "group%zu", n * 17,
+                                   BENCH_REQ_GROUPS, BENCH_GROUPS);
+
+    names = bench_list(req, "svc%zu", n, 1, BENCH_SERVICES);
+    if (names == NULL) return NULL;
+    req->service->name = names[0];
+    req->service->groups = bench_list(req, "svcgroup%zu", n, 1,
+                                      BENCH_SERVICES);
+
+    names = bench_list(req, "host%zu.example.com", n * 5, 1, BENCH_HOSTS);
+    if (names == NULL) return NULL;
+    req->targethost->name = names[0];
+    req->targethost->groups = bench_list(req, "hostgroup%zu", n, 2,
+                                         BENCH_HOSTGROUPS);
+
+    req->srchost->name = "client.example.com";
+    req->srchost->groups = bench_list(req, "hostgroup%zu", 0, 0, 1);
+
+    if (req->user->groups == NULL || req->service->groups == NULL
+            || req->targethost->groups == NULL
+            || req->srchost->groups == NULL) {
+        return NULL;
+    }
+
+    req->request_time = time(NULL);
+
+    return req;
+}
+
+static double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static errno_t bench_run(struct hbac_rule **rules,
+                         struct hbac_compiled_rules *compiled,
+                         struct hbac_eval_req **reqs,
+                         size_t num_reqs,
+                         size_t *_allowed,
+                         double *_elapsed)
+{
+    enum hbac_eval_result result;
+    struct hbac_info *info;
+    size_t allowed = 0;
+    double start;
+    size_t n;
+
+    start = bench_now();
+    for (n = 0; n < num_reqs; n++) {
+        info = NULL;
+        if (compiled != NULL) {
+            result = hbac_evaluate_compiled(compiled, reqs[n], &info);
+        } else {
+            result = hbac_evaluate(rules, reqs[n], &info);
+        }
+        hbac_free_info(info);
+
+        if (result == HBAC_EVAL_ALLOW) {
+            allowed++;
+        } else if (result != HBAC_EVAL_DENY) {
+            fprintf(stderr, "Cannot evaluate request %zu: %s\n",
+                    n, hbac_result_string(result));
+            return EIO;
+        }
+    }
+    *_elapsed = bench_now() - start;
+    *_allowed = allowed;
+
+    return EOK;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int num_rules = DEFAULT_RULES;
+    int requests = DEFAULT_REQUESTS;
+    int rounds = DEFAULT_ROUNDS;
+    struct hbac_rule **rules;
+    struct hbac_compiled_rules *compiled = NULL;
+    struct hbac_eval_req **reqs;
+    size_t allowed_plain;
+    size_t allowed_compiled;
+    double compile;
+    double plain;
+    double indexed;
+    double best_plain = 0;
+    double best_indexed = 0;
+    TALLOC_CTX *mem_ctx;
+    errno_t ret;
+    int i;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        { "rules", 'n', POPT_ARG_INT, &num_rules, 0,
+          "Number of HBAC rules", NULL },
+        { "requests", 'q', POPT_ARG_INT, &requests, 0,
+          "Number of access requests per round", NULL },
+        { "rounds", 'r', POPT_ARG_INT, &rounds, 0,
+          "How many times the requests are evaluated", NULL },
+        POPT_TABLEEND
+    };
+
+    debug_level = SSSDBG_FATAL_FAILURE;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    if (num_rules <= 0 || requests <= 0 || rounds <= 0) {
+        fprintf(stderr, "All counts must be positive\n");
+        return 1;
+    }
+
+    mem_ctx = talloc_new(NULL);
+    if (mem_ctx == NULL) return 1;
+
+    rules = bench_create_rules(mem_ctx, num_rules);
+    reqs = talloc_zero_array(mem_ctx, struct hbac_eval_req *, requests);
+    if (rules == NULL || reqs == NULL) {
+        fprintf(stderr, "Cannot create the rules\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < requests; i++) {
+        reqs[i] = bench_create_request(reqs, i);
+        if (reqs[i] == NULL) {
+            fprintf(stderr, "Cannot create the requests\n");
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    compile = bench_now();
+    if (hbac_compile_rules(rules, &compiled) != HBAC_SUCCESS) {
+        fprintf(stderr, "Cannot compile the rules\n");
+        ret = ENOMEM;
+        goto done;
+    }
+    compile = bench_now() - compile;
+
+    for (i = 0; i < rounds; i++) {
+        ret = bench_run(rules, NULL, reqs, requests, &allowed_plain, &plain);
+        if (ret != EOK) goto done;
+
+        ret = bench_run(rules, compiled, reqs, requests, &allowed_compiled,
+                        &indexed);
+        if (ret != EOK) goto done;
+
+        if (allowed_plain != allowed_compiled) {
+            fprintf(stderr, "Results differ: %zu vs. %zu requests allowed\n",
+                    allowed_plain, allowed_compiled);
+            ret = EINVAL;
+            goto done;
+        }
+
+        if (i == 0 || plain < best_plain) best_plain = plain;
+        if (i == 0 || indexed < best_indexed) best_indexed = indexed;
+    }
+
+    printf("rules: %d, requests: %d (%zu allowed), best of %d rounds\n",
+           num_rules, requests, allowed_plain, rounds);
+    printf("compile:    %.3f ms\n", compile * 1e3);
+    printf("rule scan:  %.3f ms/round, %.3f us/request\n",
+           best_plain * 1e3, best_plain * 1e6 / requests);
+    printf("rule index: %.3f ms/round, %.3f us/request\n",
+           best_indexed * 1e3, best_indexed * 1e6 / requests);
+
+done:
+    hbac_free_compiled_rules(compiled);
+    talloc_free(mem_ctx);
+    return ret == EOK ? 0 : 1;
+}
@@ -20,6 +20,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include <unistd.h>
 #include <sys/types.h>
@@ -820,6 +821,141 @@ START_TEST(ipa_hbac_test_allow_srchostgroup)
 }
 END_TEST
 
+START_TEST(ipa_hbac_test_compiled)
+{
+    enum hbac_eval_result result;
+    enum hbac_eval_result expected;
+    enum hbac_error_code code;
+    TALLOC_CTX *test_ctx;
+    struct hbac_rule **rules;
+    struct hbac_compiled_rules *compiled;
+    struct hbac_eval_req *eval_req;
+    struct hbac_info *info = NULL;
+
+    test_ctx = talloc_new(global_talloc_context);
+
+    /* Create a request */
+    eval_req = talloc_zero(test_ctx, struct hbac_eval_req);
+    fail_if (eval_req == NULL);
+
+    get_test_user(eval_req, &eval_req->user);
+    get_test_service(eval_req, &eval_req->service);
+    get_test_srchost(eval_req, &eval_req->srchost);
+
+    /* The index is only used if all indexed elements are present */
+    eval_req->targethost = talloc_zero(eval_req, struct hbac_request_element);
+    fail_if (eval_req->targethost == NULL);
+    eval_req->targethost->name = HBAC_TEST_SRCHOST;
+    eval_req->targethost->groups = talloc_zero_array(eval_req->targethost,
+                                                     const char *, 1);
+    fail_if (eval_req->targethost->groups == NULL);
+
+    /* Create the rules to evaluate against */
+    rules = talloc_array(test_ctx, struct hbac_rule *, 5);
+    fail_if (rules == NULL);
+
+    get_allow_all_rule(rules, &rules[0]);
+    rules[0]->name = "Disabled";
+    rules[0]->enabled = false;
+
+    get_allow_all_rule(rules, &rules[1]);
+    rules[1]->name = "Other user";
+    rules[1]->users->category = HBAC_CATEGORY_NULL;
+    rules[1]->users->names = talloc_array(rules[1], const char *, 2);
+    fail_if(rules[1]->users->names == NULL);
+    rules[1]->users->names[0] = HBAC_TEST_INVALID_USER;
+    rules[1]->users->names[1] = NULL;
+
+    get_allow_all_rule(rules, &rules[2]);
+    rules[2]->name = "Group and service";
+    rules[2]->users->category = HBAC_CATEGORY_NULL;
+    rules[2]->users->groups = talloc_array(rules[2], const char *, 2);
+    fail_if(rules[2]->users->groups == NULL);
+    rules[2]->users->groups[0] = "TestGroup2";
+    rules[2]->users->groups[1] = NULL;
+    rules[2]->services->category = HBAC_CATEGORY_NULL;
+    rules[2]->services->names = talloc_array(rules[2], const char *, 2);
+    fail_if(rules[2]->services->names == NULL);
+    rules[2]->services->names[0] = HBAC_TEST_SERVICE;
+    rules[2]->services->names[1] = NULL;
+
+    get_allow_all_rule(rules, &rules[3]);
+    rules[3]->name = "Allow all";
+
+    rules[4] = NULL;
+
+    /* The first matching rule in list order wins */
+    code = hbac_compile_rules(rules, &compiled);
+    fail_unless(code == HBAC_SUCCESS, "hbac_compile_rules failed");
+
+    result = hbac_evaluate_compiled(compiled, eval_req, &info);
+    fail_unless(result == HBAC_EVAL_ALLOW,
+                "Expected [%s], got [%s]",
+                hbac_result_string(HBAC_EVAL_ALLOW),
+                hbac_result_string(result));
+    fail_unless(strcmp(info->rule_name, "Group and service") == 0,
+                "Expected rule [Group and service], got [%s]",
+                info->rule_name);
+    hbac_free_info(info);
+    info = NULL;
+    hbac_free_compiled_rules(compiled);
+
+    /* The compiled rules must be rebuilt when the rules change */
+    rules[2]->services->names[0] = HBAC_TEST_INVALID_SERVICE;
+    code = hbac_compile_rules(rules, &compiled);
+    fail_unless(code == HBAC_SUCCESS, "hbac_compile_rules failed");
+
+    result = hbac_evaluate_compiled(compiled, eval_req, &info);
+    fail_unless(result == HBAC_EVAL_ALLOW,
+                "Expected [%s], got [%s]",
+                hbac_result_string(HBAC_EVAL_ALLOW),
+                hbac_result_string(result));
+    fail_unless(strcmp(info->rule_name, "Allow all") == 0,
+                "Expected rule [Allow all], got [%s]",
+                info->rule_name);
+    hbac_free_info(info);
+    info = NULL;
+    hbac_free_compiled_rules(compiled);
+
+    /* Negative test */
+    rules[3]->enabled = false;
+    code = hbac_compile_rules(rules, &compiled);
+    fail_unless(code == HBAC_SUCCESS, "hbac_compile_rules failed");
+
+    result = hbac_evaluate_compiled(compiled, eval_req, &info);
+    expected = hbac_evaluate(rules, eval_req, NULL);
+    fail_unless(result == HBAC_EVAL_DENY && result == expected,
+                "Expected [%s], got [%s]",
+                hbac_result_string(HBAC_EVAL_DENY),
+                hbac_result_string(result));
+    hbac_free_info(info);
+    info = NULL;
+
+    /* Names outside of ASCII are compared the same way as by
+     * hbac_evaluate() */
+    rules[1]->users->names[0] = (const char *) user_utf8_upcase;
+    eval_req->user->name = (const char *) user_utf8_lowcase;
+    hbac_free_compiled_rules(compiled);
+
+    code = hbac_compile_rules(rules, &compiled);
+    fail_unless(code == HBAC_SUCCESS, "hbac_compile_rules failed");
+
+    result = hbac_evaluate_compiled(compiled, eval_req, &info);
+    fail_unless(result == HBAC_EVAL_ALLOW,
+                "Expected [%s], got [%s]",
+                hbac_result_string(HBAC_EVAL_ALLOW),
+                hbac_result_string(result));
+    fail_unless(strcmp(info->rule_name, "Other user") == 0,
+                "Expected rule [Other user], got [%s]",
+                info->rule_name);
+    hbac_free_info(info);
+    info = NULL;
+    hbac_free_compiled_rules(compiled);
+
+    talloc_free(test_ctx);
+}
+END_TEST
+
 START_TEST(ipa_hbac_test_incomplete)
 {
     TALLOC_CTX *test_ctx;
@@ -860,6 +996,7 @@ Suite *hbac_test_suite (void)
     tcase_add_test(tc_hbac, ipa_hbac_test_allow_srchost);
     tcase_add_test(tc_hbac, ipa_hbac_test_allow_srchostgroup);
     tcase_add_test(tc_hbac, ipa_hbac_test_allow_utf8);
+    tcase_add_test(tc_hbac, ipa_hbac_test_compiled);
     tcase_add_test(tc_hbac, ipa_hbac_test_incomplete);
 
     suite_add_tcase(s, tc_hbac);
@@ -0,0 +1,325 @@
+/*
+    SSSD
+
+    KCM ccache marshalling benchmark
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <talloc.h>
+#include <popt.h>
+#include <time.h>
+
+#include "util/util.h"
+#include "util/util_creds.h"
+#include "responder/kcm/kcmsrv_ccache.h"
+#include "responder/kcm/kcmsrv_ccache_be.h"
+
+#define DEFAULT_CREDS       300
+#define DEFAULT_CRED_SIZE   1500
+#define DEFAULT_ROUNDS      5
+
+#define BENCH_PRINC         "user@EXAMPLE.COM"
+
+/* Referenced by kcmsrv_ccache.c, no database is used here */
+const struct kcm_ccdb_ops ccdb_mem_ops;
+const struct kcm_ccdb_ops ccdb_sec_ops;
+const struct kcm_ccdb_ops ccdb_secdb_ops;
+
+static double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static struct sss_iobuf *bench_cred_blob(TALLOC_CTX *mem_ctx,
+                                         int n, int size)
+{
+    struct sss_iobuf *blob;
+    uint8_t *data;
+    int i;
+
+    data = talloc_array(mem_ctx, uint8_t, size);
+    if (data == NULL) return NULL;
+
+    for (i = 0; i < size; i++) {
+        data[i] = (uint8_t) (n + i);
+    }
+
+    blob = sss_iobuf_init_readonly(mem_ctx, data, size);
+    talloc_free(data);
+    return blob;
+}
+
+/* What storing a credential costs with JSON: the stored value is parsed,
+ * the credential added and the whole ccache converted back */
+static errno_t bench_json(TALLOC_CTX *mem_ctx,
+                          struct kcm_ccache *empty,
+                          struct cli_creds *client,
+                          const char *key,
+                          int num_creds,
+                          int cred_size,
+                          double *_store,
+                          double *_read,
+                          size_t *_size)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sss_iobuf *value;
+    struct sss_iobuf *blob;
+    struct kcm_ccache *cc;
+    double start;
+    errno_t ret;
+    int i;
+
+    tmp_ctx = talloc_new(mem_ctx);
+    if (tmp_ctx == NULL) return ENOMEM;
+
+    ret = kcm_ccache_to_sec_input(tmp_ctx, empty, client, &value);
+    if (ret != EOK) goto done;
+
+    start = bench_now();
+    for (i = 0; i < num_creds; i++) {
+        ret = sec_kv_to_ccache(tmp_ctx, key,
+                               (const char *) sss_iobuf_get_data(value),
+                               client, &cc);
+        if (ret != EOK) goto done;
+
+        blob = bench_cred_blob(cc, i, cred_size);
+        if (blob == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = kcm_cc_store_cred_blob(cc, blob);
+        if (ret != EOK) goto done;
+
+        talloc_free(value);
+        ret = kcm_ccache_to_sec_input(tmp_ctx, cc, client, &value);
+        talloc_free(cc);
+        if (ret != EOK) goto done;
+    }
+    *_store = bench_now() - start;
+
+    start = bench_now();
+    ret = sec_kv_to_ccache(tmp_ctx, key,
+                           (const char *) sss_iobuf_get_data(value),
+                           client, &cc);
+    if (ret != EOK) goto done;
+    *_read = bench_now() - start;
+    *_size = sss_iobuf_get_size(value);
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+/* With the binary format the credential is appended to the stored value */
+static errno_t bench_binary(TALLOC_CTX *mem_ctx,
+                            struct kcm_ccache *empty,
+                            struct cli_creds *client,
+                            const char *key,
+                            int num_creds,
+                            int cred_size,
+                            double *_store,
+                            double *_read,
+                            size_t *_size)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sss_iobuf *value;
+    struct sss_iobuf *new_value;
+    struct sss_iobuf *blob;
+    struct kcm_ccache *cc;
+    struct kcm_cred *crd;
+    uuid_t uuid;
+    double start;
+    errno_t ret;
+    int i;
+
+    tmp_ctx = talloc_new(mem_ctx);
+    if (tmp_ctx == NULL) return ENOMEM;
+
+    ret = kcm_ccache_to_sec_binary(tmp_ctx, empty, &value);
+    if (ret != EOK) goto done;
+
+    start = bench_now();
+    for (i = 0; i < num_creds; i++) {
+        blob = bench_cred_blob(tmp_ctx, i, cred_size);
+        if (blob == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        uuid_generate(uuid);
+        crd = kcm_cred_new(tmp_ctx, uuid, blob);
+        if (crd == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = kcm_ccache_sec_binary_add_cred(tmp_ctx, value, crd, &new_value);
+        talloc_free(crd);
+        if (ret != EOK) goto done;
+
+        talloc_free(value);
+        value = new_value;
+    }
+    *_store = bench_now() - start;
+
+    start = bench_now();
+    ret = sec_binary_to_ccache(tmp_ctx, key, value, client, &cc);
+    if (ret != EOK) goto done;
+    *_read = bench_now() - start;
+    *_size = sss_iobuf_get_size(value);
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int num_creds = DEFAULT_CREDS;
+    int cred_size = DEFAULT_CRED_SIZE;
+    int rounds = DEFAULT_ROUNDS;
+    krb5_context kctx = NULL;
+    krb5_principal princ = NULL;
+    krb5_error_code kerr;
+    struct cli_creds client;
+    struct kcm_ccache *empty;
+    const char *name;
+    const char *key;
+    uuid_t uuid;
+    double store, read;
+    double best_json_store = 0, best_json_read = 0;
+    double best_bin_store = 0, best_bin_read = 0;
+    size_t json_size = 0, bin_size = 0;
+    TALLOC_CTX *mem_ctx;
+    errno_t ret;
+    int i;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        { "creds", 'n', POPT_ARG_INT, &num_creds, 0,
+          "Number of credentials stored in the ccache", NULL },
+        { "size", 's', POPT_ARG_INT, &cred_size, 0,
+          "Size of one credential in bytes", NULL },
+        { "rounds", 'r', POPT_ARG_INT, &rounds, 0,
+          "How many times the ccache is filled", NULL },
+        POPT_TABLEEND
+    };
+
+    debug_level = SSSDBG_FATAL_FAILURE;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    if (num_creds <= 0 || cred_size <= 0 || rounds <= 0) {
+        fprintf(stderr, "All counts must be positive\n");
+        return 1;
+    }
+
+    mem_ctx = talloc_new(NULL);
+    if (mem_ctx == NULL) return 1;
+
+    kerr = krb5_init_context(&kctx);
+    if (kerr == 0) {
+        kerr = krb5_parse_name(kctx, BENCH_PRINC, &princ);
+    }
+    if (kerr != 0) {
+        fprintf(stderr, "Cannot create the principal\n");
+        ret = EIO;
+        goto done;
+    }
+
+    client.ucred.uid = getuid();
+    client.ucred.gid = getgid();
+
+    name = talloc_asprintf(mem_ctx, "%"SPRIuid, getuid());
+    if (name == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = kcm_cc_new(mem_ctx, kctx, &client, name, princ, &empty);
+    if (ret != EOK) {
+        fprintf(stderr, "Cannot create the ccache\n");
+        goto done;
+    }
+
+    kcm_cc_get_uuid(empty, uuid);
+    key = sec_key_create(mem_ctx, name, uuid);
+    if (key == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < rounds; i++) {
+        ret = bench_json(mem_ctx, empty, &client, key, num_creds, cred_size,
+                         &store, &read, &json_size);
+        if (ret != EOK) {
+            fprintf(stderr, "JSON round failed [%d]: %s\n",
+                    ret, sss_strerror(ret));
+            goto done;
+        }
+        if (i == 0 || store < best_json_store) best_json_store = store;
+        if (i == 0 || read < best_json_read) best_json_read = read;
+
+        ret = bench_binary(mem_ctx, empty, &client, key, num_creds, cred_size,
+                           &store, &read, &bin_size);
+        if (ret != EOK) {
+            fprintf(stderr, "Binary round failed [%d]: %s\n",
+                    ret, sss_strerror(ret));
+            goto done;
+        }
+        if (i == 0 || store < best_bin_store) best_bin_store = store;
+        if (i == 0 || read < best_bin_read) best_bin_read = read;
+    }
+
+    printf("credentials: %d of %d bytes, best of %d rounds\n",
+           num_creds, cred_size, rounds);
+    printf("json:   store %8.3f ms total, %8.3f us/cred, "
+           "read %8.3f ms, value %zu bytes\n",
+           best_json_store * 1e3, best_json_store * 1e6 / num_creds,
+           best_json_read * 1e3, json_size);
+    printf("binary: store %8.3f ms total, %8.3f us/cred, "
+           "read %8.3f ms, value %zu bytes\n",
+           best_bin_store * 1e3, best_bin_store * 1e6 / num_creds,
+           best_bin_read * 1e3, bin_size);
+
+done:
+    if (princ != NULL) krb5_free_principal(kctx, princ);
+    if (kctx != NULL) krb5_free_context(kctx);
+    talloc_free(mem_ctx);
+    return ret == EOK ? 0 : 1;
+}
@@ -0,0 +1,339 @@
+/*
+    SSSD
+
+    sdap_parse_entry() microbenchmark
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <talloc.h>
+#include <popt.h>
+#include <time.h>
+
+#include "util/util.h"
+#include "providers/ldap/ldap_opts.h"
+#include "providers/ldap/sdap.h"
+
+#define DEFAULT_ENTRIES 10000
+#define DEFAULT_MEMBERS 50
+#define DEFAULT_ROUNDS  5
+
+/* A synthetic page of LDAP entries. The libldap calls used by
+ * sdap_parse_entry() are wrapped at link time and serve the entry the
+ * benchmark currently points to. */
+struct bench_attr {
+    const char *name;
+    size_t num_values;
+    struct berval **values;
+};
+
+struct bench_entry {
+    const char *dn;
+    size_t num_attrs;
+    struct bench_attr *attrs;
+};
+
+static struct bench_entry *cur_entry;
+static size_t cur_attr;
+
+int __wrap_ldap_set_option(LDAP *ld, int option, void *invalue)
+{
+    return LDAP_OPT_SUCCESS;
+}
+
+char *__wrap_ldap_get_dn(LDAP *ld, LDAPMessage *entry)
+{
+    return discard_const(cur_entry->dn);
+}
+
+void __wrap_ldap_memfree(void *p)
+{
+    return;
+}
+
+struct berval **__wrap_ldap_get_values_len(LDAP *ld,
+                                           LDAPMessage *entry,
+                                           LDAP_CONST char *target)
+{
+    size_t i;
+
+    for (i = 0; i < cur_entry->num_attrs; i++) {
+        if (strcasecmp(cur_entry->attrs[i].name, target) == 0) {
+            /* Like libldap, hand out a fresh copy of the values */
+            return talloc_memdup(NULL, cur_entry->attrs[i].values,
+                            sizeof(struct berval *)
+                                * (cur_entry->attrs[i].num_values + 1));
+        }
+    }
+
+    return NULL;
+}
+
+void __wrap_ldap_value_free_len(struct berval **vals)
+{
+    talloc_free(vals);
+}
+
+char *__wrap_ldap_first_attribute(LDAP *ld,
+                                  LDAPMessage *entry,
+                                  BerElement **berout)
+{
+    cur_attr = 0;
+    *berout = NULL;
+    return discard_const(cur_entry->attrs[0].name);
+}
+
+char *__wrap_ldap_next_attribute(LDAP *ld,
+                                 LDAPMessage *entry,
+                                 BerElement *ber)
+{
+    cur_attr++;
+    if (cur_attr >= cur_entry->num_attrs) {
+        return NULL;
+    }
+
+    return discard_const(cur_entry->attrs[cur_attr].name);
+}
+
+/* Avoid linking the whole LDAP provider */
+errno_t sdap_parse_search_base(TALLOC_CTX *mem_ctx,
+                               struct dp_option *opts, int class,
+                               struct sdap_search_base ***_search_bases)
+{
+    return EOK;
+}
+
+static struct berval *bench_berval(TALLOC_CTX *mem_ctx, const char *fmt,
+                                   size_t n)
+{
+    struct berval *bv;
+
+    bv = talloc_zero(mem_ctx, struct berval);
+    if (bv == NULL) return NULL;
+
+    bv->bv_val = talloc_asprintf(bv, fmt, n);
+    if (bv->bv_val == NULL) return NULL;
+    bv->bv_len = strlen(bv->bv_val);
+
+    return bv;
+}
+
+static errno_t bench_add_attr(struct bench_entry *e, const char *name,
+                              const char *fmt, size_t n, size_t num_values)
+{
+    struct bench_attr *a = &e->attrs[e->num_attrs];
+    size_t i;
+
+    a->name = name;
+    a->num_values = num_values;
+    a->values = talloc_zero_array(e->attrs, struct berval *, num_values + 1);
+    if (a->values == NULL) return ENOMEM;
+
+    for (i = 0; i < num_values; i++) {
+        a->values[i] = bench_berval(a->values, fmt, n * num_values + i);
+        if (a->values[i] == NULL) return ENOMEM;
+    }
+
+    e->num_attrs++;
+    return EOK;
+}
+
+/* Users with the usual AD attributes, some of them not in the map, and a
+ * long multi-valued memberOf */
+static struct bench_entry *bench_create_page(TALLOC_CTX *mem_ctx,
+                                             size_t num_entries,
+                                             size_t num_members)
+{
+    struct bench_entry *page;
+    struct bench_entry *e;
+    errno_t ret = EOK;
+    size_t n;
+
+    page = talloc_zero_array(mem_ctx, struct bench_entry, num_entries);
+    if (page == NULL) return NULL;
+
+    for (n = 0; n < num_entries && ret == EOK; n++) {
+        e = &page[n];
+        e->dn = talloc_asprintf(page, "CN=user%zu,CN=Users,DC=ad,DC=example",
+                                n);
+        e->attrs = talloc_zero_array(page, struct bench_attr, 16);
+        if (e->dn == NULL || e->attrs == NULL) return NULL;
+
+        ret = bench_add_attr(e, "objectClass", "user", n, 1);
+        if (ret == EOK) ret = bench_add_attr(e, "sAMAccountName", "user%zu", n, 1);
+        if (ret == EOK) ret = bench_add_attr(e, "uidNumber", "%zu", n + 10000, 1);
+        if (ret == EOK) ret = bench_add_attr(e, "gidNumber", "%zu", n + 10000, 1);
+        if (ret == EOK) ret = bench_add_attr(e, "gecos", "User %zu", n, 1);
+        if (ret == EOK) ret = bench_add_attr(e, "unixHomeDirectory",
+                                             "/home/user%zu", n, 1);
+        if (ret == EOK) ret = bench_add_attr(e, "loginShell", "/bin/bash", n, 1);
+        if (ret == EOK) ret = bench_add_attr(e, "userPrincipalName",
+                                             "user%zu@AD.EXAMPLE", n, 1);
+        if (ret == EOK) ret = bench_add_attr(e, "objectSID",
+                                             "S-1-5-21-1-2-3-%zu", n, 1);
+        if (ret == EOK) ret = bench_add_attr(e, "uSNChanged", "%zu", n, 1);
+        if (ret == EOK) ret = bench_add_attr(e, "whenChanged",
+                                             "2026%010zu.0Z", n, 1);
+        if (ret == EOK) ret = bench_add_attr(e, "description",
+                                             "not mapped %zu", n, 1);
+        if (ret == EOK) ret = bench_add_attr(e, "memberOf",
+                                  "CN=group%zu,CN=Users,DC=ad,DC=example",
+                                  n, num_members);
+    }
+
+    return ret == EOK ? page : NULL;
+}
+
+static double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static errno_t bench_run(struct bench_entry *page, size_t num_entries,
+                         struct sdap_attr_map *map,
+                         struct sdap_attr_map_index *idx,
+                         double *_elapsed)
+{
+    struct sdap_handle sh = { 0 };
+    struct sdap_msg sm = { 0 };
+    struct sysdb_attrs *attrs;
+    TALLOC_CTX *tmp_ctx;
+    double start;
+    size_t n;
+    errno_t ret = EOK;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) return ENOMEM;
+
+    start = bench_now();
+    for (n = 0; n < num_entries; n++) {
+        cur_entry = &page[n];
+        if (idx != NULL) {
+            ret = sdap_parse_entry_idx(tmp_ctx, &sh, &sm, idx, &attrs, false);
+        } else {
+            ret = sdap_parse_entry(tmp_ctx, &sh, &sm, map, SDAP_OPTS_USER,
+                                   &attrs, false);
+        }
+        if (ret != EOK) {
+            fprintf(stderr, "Cannot parse entry %zu [%d]: %s\n",
+                    n, ret, sss_strerror(ret));
+            break;
+        }
+    }
+    *_elapsed = bench_now() - start;
+
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int entries = DEFAULT_ENTRIES;
+    int members = DEFAULT_MEMBERS;
+    int rounds = DEFAULT_ROUNDS;
+    struct sdap_attr_map *map;
+    struct sdap_attr_map_index *idx;
+    struct bench_entry *page;
+    double plain;
+    double indexed;
+    double best_plain = 0;
+    double best_indexed = 0;
+    TALLOC_CTX *mem_ctx;
+    errno_t ret;
+    int i;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        { "entries", 'n', POPT_ARG_INT, &entries, 0,
+          "Number of entries in the page", NULL },
+        { "members", 'm', POPT_ARG_INT, &members, 0,
+          "Number of memberOf values per entry", NULL },
+        { "rounds", 'r', POPT_ARG_INT, &rounds, 0,
+          "How many times the page is parsed", NULL },
+        POPT_TABLEEND
+    };
+
+    debug_level = SSSDBG_FATAL_FAILURE;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    if (entries <= 0 || members <= 0 || rounds <= 0) {
+        fprintf(stderr, "All counts must be positive\n");
+        return 1;
+    }
+
+    mem_ctx = talloc_new(NULL);
+    if (mem_ctx == NULL) return 1;
+
+    ret = sdap_copy_map(mem_ctx, gen_ad2008r2_user_map, SDAP_OPTS_USER,
+                        &map);
+    if (ret == EOK) {
+        ret = sdap_attr_map_index_create(mem_ctx, map, SDAP_OPTS_USER, &idx);
+    }
+    if (ret != EOK) {
+        fprintf(stderr, "Cannot set up the attribute map\n");
+        goto done;
+    }
+
+    page = bench_create_page(mem_ctx, entries, members);
+    if (page == NULL) {
+        fprintf(stderr, "Cannot create the LDAP page\n");
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < rounds; i++) {
+        ret = bench_run(page, entries, map, NULL, &plain);
+        if (ret != EOK) goto done;
+
+        ret = bench_run(page, entries, map, idx, &indexed);
+        if (ret != EOK) goto done;
+
+        if (i == 0 || plain < best_plain) best_plain = plain;
+        if (i == 0 || indexed < best_indexed) best_indexed = indexed;
+    }
+
+    printf("entries: %d, memberOf values: %d, best of %d rounds\n",
+           entries, members, rounds);
+    printf("map scan:  %.3f ms/page, %.3f us/entry\n",
+           best_plain * 1e3, best_plain * 1e6 / entries);
+    printf("map index: %.3f ms/page, %.3f us/entry\n",
+           best_indexed * 1e3, best_indexed * 1e6 / entries);
+
+done:
+    talloc_free(mem_ctx);
+    return ret == EOK ? 0 : 1;
+}
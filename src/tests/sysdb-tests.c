@@ -3868,6 +3868,45 @@ START_TEST (test_sysdb_set_get_uint)
 }
 END_TEST
 
+START_TEST (test_sysdb_enum_checkpoint)
+{
+    struct sysdb_test_ctx *test_ctx;
+    uint32_t checkpoint;
+    int ret;
+
+    /* Setup */
+    ret = setup_sysdb_tests(&test_ctx);
+    if (ret != EOK) {
+        fail("Could not set up the test");
+        return;
+    }
+
+    /* No checkpoint means starting from the beginning */
+    ret = sysdb_get_enum_checkpoint(test_ctx->domain,
+                                    SYSDB_ENUM_USERS_CHECKPOINT, &checkpoint);
+    fail_unless(ret == EOK, "sysdb_get_enum_checkpoint failed %d:[%s]",
+                ret, sss_strerror(ret));
+    fail_unless(checkpoint == 0);
+
+    ret = sysdb_set_enum_checkpoint(test_ctx->domain,
+                                    SYSDB_ENUM_USERS_CHECKPOINT, 7);
+    fail_unless(ret == EOK);
+
+    ret = sysdb_get_enum_checkpoint(test_ctx->domain,
+                                    SYSDB_ENUM_USERS_CHECKPOINT, &checkpoint);
+    fail_unless(ret == EOK);
+    fail_unless(checkpoint == 7);
+
+    /* Users and groups are tracked separately */
+    ret = sysdb_get_enum_checkpoint(test_ctx->domain,
+                                    SYSDB_ENUM_GROUPS_CHECKPOINT, &checkpoint);
+    fail_unless(ret == EOK);
+    fail_unless(checkpoint == 0);
+
+    talloc_free(test_ctx);
+}
+END_TEST
+
 START_TEST (test_sysdb_attrs_to_list)
 {
     struct sysdb_attrs *attrs_list[3];
@@ -7716,6 +7755,7 @@ Suite *create_sysdb_suite(void)
 /* ===== Misc ===== */
     tcase_add_test(tc_sysdb, test_sysdb_set_get_bool);
     tcase_add_test(tc_sysdb, test_sysdb_set_get_uint);
+    tcase_add_test(tc_sysdb, test_sysdb_enum_checkpoint);
     tcase_add_test(tc_sysdb, test_sysdb_mark_entry_as_expired_ldb_dn);
 
 /* Add all test cases to the test suite */
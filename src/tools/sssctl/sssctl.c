@@ -279,6 +279,9 @@ int main(int argc, const char **argv)
         SSS_TOOL_COMMAND("logs-remove", "Remove existing SSSD log files", 0, sssctl_logs_remove),
         SSS_TOOL_COMMAND("logs-fetch", "Archive SSSD log files in tarball", 0, sssctl_logs_fetch),
         SSS_TOOL_COMMAND("debug-level", "Change SSSD debug level", 0, sssctl_debug_level),
+        SSS_TOOL_COMMAND("debug-backtrace", "Write debug messages kept in memory to SSSD log files", 0, sssctl_debug_backtrace),
+        SSS_TOOL_COMMAND("trace-slowest", "Show the slowest requests found in SSSD log files", 0, sssctl_trace_slowest),
+        SSS_TOOL_COMMAND("metrics-show", "Show performance metrics of SSSD processes", 0, sssctl_metrics_show),
 #ifdef HAVE_LIBINI_CONFIG_V1_3
         SSS_TOOL_DELIMITER("Configuration files tools:"),
         SSS_TOOL_COMMAND_FLAGS("config-check", "Perform static analysis of SSSD configuration", 0, sssctl_config_check, SSS_TOOL_FLAG_SKIP_CMD_INIT),
@@ -245,6 +245,9 @@ sssctl_domain_status_server_list(struct sbus_sync_connection *conn,
     TALLOC_CTX *tmp_ctx;
     const char **servers;
     const char **services;
+    uint32_t *rtt_usec;
+    uint32_t *error_permille;
+    uint32_t *samples;
     errno_t ret;
     int i, j;
 
@@ -272,8 +275,9 @@ sssctl_domain_status_server_list(struct sbus_sync_connection *conn,
     for (i = 0; services[i] != NULL; i++) {
         PRINT("Discovered %s servers:\n", proper_service_name(services[i]));
 
-        ret = sbus_call_ifp_domain_ListServers(tmp_ctx, conn, IFP_BUS,
-                  domain_path, services[i], &servers);
+        ret = sbus_call_ifp_domain_ListServerScores(tmp_ctx, conn, IFP_BUS,
+                  domain_path, services[i], &servers, &rtt_usec,
+                  &error_permille, &samples);
         if (ret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Unable to get domain servers [%d]: %s\n",
                   ret, sss_strerror(ret));
@@ -287,7 +291,15 @@ sssctl_domain_status_server_list(struct sbus_sync_connection *conn,
         }
 
         for (j = 0; servers[j] != NULL; j++) {
-            printf("- %s\n", servers[j]);
+            if (samples == NULL || samples[j] == 0) {
+                printf("- %s\n", servers[j]);
+                continue;
+            }
+
+            printf("- %s ", servers[j]);
+            PRINT("(rtt %.1f ms, errors %.1f %%, samples %u)\n",
+                  rtt_usec[j] / 1000.0, error_permille[j] / 10.0,
+                  samples[j]);
         }
 
         printf("\n");
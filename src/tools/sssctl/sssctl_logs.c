@@ -34,6 +34,8 @@
 #include <signal.h>
 
 #include "util/util.h"
+#include "util/sss_trace.h"
+#include "util/sss_metrics.h"
 #include "tools/common/sss_process.h"
 #include "tools/sssctl/sssctl.h"
 #include "tools/tools_util.h"
@@ -369,3 +371,348 @@ fini:
     talloc_free(ctx);
     return ret;
 }
+
+errno_t sssctl_debug_backtrace(struct sss_cmdline *cmdline,
+                               struct sss_tool_ctx *tool_ctx,
+                               void *pvt)
+{
+    errno_t ret;
+
+    ret = sss_tool_popt(cmdline, NULL, SSS_TOOL_OPT_OPTIONAL, NULL, NULL);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to parse command arguments\n");
+        return ret;
+    }
+
+    CHECK_ROOT(ret, debug_prg_name);
+
+    /* The monitor passes the signal on to the services */
+    ret = sss_signal(SSSDBG_BACKTRACE_SIGNAL);
+    CHECK(ret != EOK, fini,
+          "Could not tell sssd processes to write the debug backtrace. "
+          "Is sssd running?");
+
+    PRINT("Debug backtrace was written to the SSSD log files\n");
+
+fini:
+    return ret;
+}
+
+#define SSSCTL_TRACE_DEFAULT_COUNT 10
+
+struct sssctl_trace_opts {
+    int count;
+    const char *id;
+};
+
+struct sssctl_trace_record {
+    const char *file;
+    const char *id;
+    uint64_t total;
+    const char *text;
+};
+
+static errno_t sssctl_trace_parse(TALLOC_CTX *mem_ctx,
+                                  const char *file,
+                                  const char *line,
+                                  struct sssctl_trace_record *_record)
+{
+    const char *text;
+    const char *id;
+    const char *end;
+    char *endptr;
+    uint64_t total;
+
+    text = strstr(line, SSS_TRACE_RECORD " id=");
+    if (text == NULL) {
+        return ENOENT;
+    }
+
+    /* Skip the prefix and the following space */
+    text += sizeof(SSS_TRACE_RECORD);
+    id = text + strlen("id=");
+
+    end = strchr(id, ' ');
+    if (end == NULL || strncmp(end, " total=", strlen(" total=")) != 0) {
+        return EINVAL;
+    }
+
+    errno = 0;
+    total = strtoull(end + strlen(" total="), &endptr, 10);
+    if (errno != 0 || strncmp(endptr, "us", 2) != 0) {
+        return EINVAL;
+    }
+
+    _record->file = file;
+    _record->total = total;
+    _record->id = talloc_strndup(mem_ctx, id, end - id);
+    _record->text = talloc_strndup(mem_ctx, text, strcspn(text, "\n"));
+    if (_record->id == NULL || _record->text == NULL) {
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+static errno_t sssctl_trace_read_log(TALLOC_CTX *mem_ctx,
+                                     const char *file,
+                                     struct sssctl_trace_record **_records,
+                                     size_t *_num_records)
+{
+    struct sssctl_trace_record *records = *_records;
+    size_t num_records = *_num_records;
+    struct sssctl_trace_record record;
+    const char *path;
+    char *line = NULL;
+    size_t linelen = 0;
+    FILE *fp;
+    errno_t ret;
+
+    path = talloc_asprintf(mem_ctx, "%s/%s", LOG_PATH, file);
+    if (path == NULL) {
+        return ENOMEM;
+    }
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        ret = errno;
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to open %s [%d]: %s\n",
+              path, ret, sss_strerror(ret));
+        return ret;
+    }
+
+    while (getline(&line, &linelen, fp) != -1) {
+        ret = sssctl_trace_parse(mem_ctx, file, line, &record);
+        if (ret == ENOENT || ret == EINVAL) {
+            continue;
+        } else if (ret != EOK) {
+            goto done;
+        }
+
+        records = talloc_realloc(mem_ctx, records, struct sssctl_trace_record,
+                                 num_records + 1);
+        if (records == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        records[num_records] = record;
+        num_records++;
+    }
+
+    ret = EOK;
+
+done:
+    free(line);
+    fclose(fp);
+
+    if (ret == EOK) {
+        *_records = records;
+        *_num_records = num_records;
+    }
+
+    return ret;
+}
+
+static int sssctl_trace_cmp(const void *a, const void *b)
+{
+    const struct sssctl_trace_record *ra = a;
+    const struct sssctl_trace_record *rb = b;
+
+    if (ra->total == rb->total) {
+        return 0;
+    }
+
+    /* Slowest first */
+    return ra->total < rb->total ? 1 : -1;
+}
+
+errno_t sssctl_trace_slowest(struct sss_cmdline *cmdline,
+                             struct sss_tool_ctx *tool_ctx,
+                             void *pvt)
+{
+    struct sssctl_trace_opts opts = {SSSCTL_TRACE_DEFAULT_COUNT, NULL};
+    struct sssctl_trace_record *records = NULL;
+    size_t num_records = 0;
+    struct dirent *dent;
+    TALLOC_CTX *tmp_ctx;
+    const char *file;
+    size_t len;
+    size_t i;
+    int shown;
+    DIR *dir;
+    errno_t ret;
+
+    /* Parse command line. */
+    struct poptOption options[] = {
+        {"count", 'n', POPT_ARG_INT, &opts.count, 0, _("Number of requests to show"), NULL },
+        {"id", 'i', POPT_ARG_STRING, &opts.id, 0, _("Show all records of this request"), NULL },
+        POPT_TABLEEND
+    };
+
+    ret = sss_tool_popt(cmdline, options, SSS_TOOL_OPT_OPTIONAL, NULL, NULL);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to parse command arguments\n");
+        return ret;
+    }
+
+    if (opts.count <= 0) {
+        ERROR("The number of requests must be positive\n");
+        return EINVAL;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    dir = opendir(LOG_PATH);
+    if (dir == NULL) {
+        ret = errno;
+        ERROR("Unable to open the log directory\n");
+        goto done;
+    }
+
+    while ((dent = readdir(dir)) != NULL) {
+        len = strlen(dent->d_name);
+        if (len <= 4 || strcmp(dent->d_name + len - 4, ".log") != 0) {
+            continue;
+        }
+
+        file = talloc_strdup(tmp_ctx, dent->d_name);
+        if (file == NULL) {
+            closedir(dir);
+            ret = ENOMEM;
+            goto done;
+        }
+
+        /* Unreadable logs are skipped */
+        ret = sssctl_trace_read_log(tmp_ctx, file, &records, &num_records);
+        if (ret == ENOMEM) {
+            closedir(dir);
+            goto done;
+        }
+    }
+    closedir(dir);
+
+    if (num_records == 0) {
+        PRINT("No request records were found. Requests are logged with "
+              "debug level 6 or when they are slow.\n");
+        ret = EOK;
+        goto done;
+    }
+
+    qsort(records, num_records, sizeof(struct sssctl_trace_record),
+          sssctl_trace_cmp);
+
+    for (i = 0, shown = 0; i < num_records; i++) {
+        if (opts.id != NULL) {
+            if (strcmp(records[i].id, opts.id) != 0) {
+                continue;
+            }
+        } else if (shown == opts.count) {
+            break;
+        }
+
+        PRINT("%s: %s\n", records[i].file, records[i].text);
+        shown++;
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+errno_t sssctl_metrics_show(struct sss_cmdline *cmdline,
+                            struct sss_tool_ctx *tool_ctx,
+                            void *pvt)
+{
+    const char *service = NULL;
+    struct dirent *dent;
+    TALLOC_CTX *tmp_ctx;
+    const char *path;
+    size_t suffix_len;
+    size_t len;
+    int num_snapshots = 0;
+    char *report;
+    DIR *dir;
+    errno_t ret;
+
+    /* Parse command line. */
+    struct poptOption options[] = {
+        {"service", 's', POPT_ARG_STRING, &service, 0, _("Show only metrics of this process, e.g. sssd_nss"), NULL },
+        POPT_TABLEEND
+    };
+
+    ret = sss_tool_popt(cmdline, options, SSS_TOOL_OPT_OPTIONAL, NULL, NULL);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to parse command arguments\n");
+        return ret;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    dir = opendir(METRICS_PATH);
+    if (dir == NULL) {
+        ret = errno;
+        ERROR("Unable to open the metrics directory\n");
+        goto done;
+    }
+
+    /* Every process writes its own snapshot, the metrics of all processes
+     * are merged here. */
+    suffix_len = strlen(SSS_METRICS_SNAPSHOT_SUFFIX);
+    while ((dent = readdir(dir)) != NULL) {
+        len = strlen(dent->d_name);
+        if (len <= suffix_len
+                || strcmp(dent->d_name + len - suffix_len,
+                          SSS_METRICS_SNAPSHOT_SUFFIX) != 0) {
+            continue;
+        }
+
+        if (service != NULL
+                && (len - suffix_len != strlen(service)
+                    || strncmp(dent->d_name, service, len - suffix_len) != 0)) {
+            continue;
+        }
+
+        path = talloc_asprintf(tmp_ctx, "%s/%s", METRICS_PATH, dent->d_name);
+        if (path == NULL) {
+            closedir(dir);
+            ret = ENOMEM;
+            goto done;
+        }
+
+        /* Unreadable snapshots are skipped */
+        ret = sss_metrics_read(path);
+        if (ret == EOK) {
+            num_snapshots++;
+        }
+    }
+    closedir(dir);
+
+    if (num_snapshots == 0) {
+        PRINT("No metrics were found. Metrics are written every "
+              "metrics_snapshot_interval seconds.\n");
+        ret = EOK;
+        goto done;
+    }
+
+    report = sss_metrics_report(tmp_ctx);
+    if (report == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    PRINT("%s", report);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
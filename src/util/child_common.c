@@ -33,6 +33,7 @@
 #include "util/find_uid.h"
 #include "db/sysdb.h"
 #include "util/child_common.h"
+#include "util/probes.h"
 
 struct sss_sigchild_ctx {
     struct tevent_context *ev;
@@ -831,3 +832,966 @@ errno_t child_debug_init(const char *logfile, int *debug_fd)
 
     return EOK;
 }
+
+/* Child pool */
+
+/* Delay before idle children are started again after one of them died or
+ * could not be started */
+#define CHILD_POOL_RETRY_DELAY 5
+/* Upper bound of a response of a child in the persistent mode */
+#define CHILD_POOL_MAX_FRAME (1024 * 1024)
+
+struct sss_child_pool_state;
+
+/* Allocated on the event context so that it stays around until the SIGCHLD
+ * handler of the child has run, even if the worker is gone already. */
+struct sss_child_pool_proc {
+    struct sss_child_pool_worker *worker;
+    struct sss_child_ctx_old *child_ctx;
+    pid_t pid;
+};
+
+struct sss_child_pool_worker {
+    struct sss_child_pool_worker *prev;
+    struct sss_child_pool_worker *next;
+
+    struct sss_child_pool *pool;
+    struct sss_child_pool_proc *proc;
+    struct child_io_fds *io;
+    struct tevent_timer *idle_timer;
+    struct sss_child_pool_state *active;
+    pid_t pid;
+    bool busy;
+    unsigned int served;
+};
+
+struct sss_child_pool {
+    struct tevent_context *ev;
+    struct sss_child_pool_opts opts;
+
+    struct sss_child_pool_worker *idle;
+    struct sss_child_pool_worker *busy;
+    struct sss_child_pool_state *waiting;
+
+    struct tevent_immediate *im;
+    struct tevent_timer *backoff;
+    struct sss_child_pool_stats stats;
+};
+
+struct sss_child_pool_state {
+    struct sss_child_pool_state *prev;
+    struct sss_child_pool_state *next;
+
+    struct tevent_context *ev;
+    struct tevent_req *req;
+    struct sss_child_pool *pool;
+    struct sss_child_pool_worker *worker;
+    struct tevent_req *io_req;
+    struct tevent_timer *timeout;
+    struct timeval start;
+
+    uint8_t *frame;
+    size_t frame_len;
+    bool waiting;
+    bool retried;
+    bool cold;
+
+    uint8_t *buf;
+    ssize_t len;
+};
+
+static bool child_pool_oneshot(struct sss_child_pool *pool)
+{
+    return pool->opts.max_requests == 1;
+}
+
+static bool child_pool_has_room(struct sss_child_pool *pool)
+{
+    return pool->opts.max_running == 0
+            || pool->stats.busy < (size_t) pool->opts.max_running;
+}
+
+static void child_pool_run(struct tevent_context *ev,
+                           struct tevent_immediate *im,
+                           void *pvt);
+
+static void child_pool_schedule(struct sss_child_pool *pool)
+{
+    tevent_schedule_immediate(pool->im, pool->ev, child_pool_run, pool);
+}
+
+static void child_pool_backoff_done(struct tevent_context *ev,
+                                    struct tevent_timer *te,
+                                    struct timeval tv,
+                                    void *pvt)
+{
+    struct sss_child_pool *pool = talloc_get_type(pvt, struct sss_child_pool);
+
+    pool->backoff = NULL;
+    child_pool_schedule(pool);
+}
+
+/* Stops starting idle children for a while so that a child which fails
+ * right away is not started over and over again */
+static void child_pool_backoff(struct sss_child_pool *pool)
+{
+    if (pool->backoff != NULL) {
+        return;
+    }
+
+    pool->backoff = tevent_add_timer(pool->ev, pool,
+                                     tevent_timeval_current_ofs(
+                                                CHILD_POOL_RETRY_DELAY, 0),
+                                     child_pool_backoff_done, pool);
+    if (pool->backoff == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_add_timer failed.\n");
+    }
+}
+
+/* Removes the worker from the pool and frees it. A child which is not killed
+ * exits once it reads EOF on stdin. */
+static void child_pool_worker_stop(struct sss_child_pool_worker *worker,
+                                   bool kill_child)
+{
+    struct sss_child_pool *pool = worker->pool;
+
+    if (worker->busy) {
+        DLIST_REMOVE(pool->busy, worker);
+        pool->stats.busy--;
+    } else {
+        DLIST_REMOVE(pool->idle, worker);
+        pool->stats.idle--;
+    }
+
+    if (worker->proc != NULL) {
+        if (kill_child) {
+            child_handler_destroy(worker->proc->child_ctx);
+            talloc_free(worker->proc);
+        } else {
+            worker->proc->worker = NULL;
+        }
+        worker->proc = NULL;
+    }
+
+    /* closes the pipes */
+    talloc_free(worker);
+}
+
+static void child_pool_exited(int child_status,
+                              struct tevent_signal *sige,
+                              void *pvt)
+{
+    struct sss_child_pool_proc *proc;
+    struct sss_child_pool_worker *worker;
+    struct sss_child_pool *pool;
+
+    proc = talloc_get_type(pvt, struct sss_child_pool_proc);
+    worker = proc->worker;
+
+    if (worker != NULL) {
+        worker->proc = NULL;
+
+        /* A busy child is noticed by the I/O of its request, a one-shot
+         * child exits anyway after it wrote its response. */
+        if (worker->active == NULL) {
+            pool = worker->pool;
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Idle %s [%d] exited with status [%d].\n",
+                  pool->opts.name, proc->pid, child_status);
+            pool->stats.died++;
+            child_pool_worker_stop(worker, false);
+            child_pool_backoff(pool);
+        }
+    }
+
+    talloc_free(proc);
+}
+
+static errno_t child_pool_spawn(struct sss_child_pool *pool,
+                                struct sss_child_pool_worker **_worker)
+{
+    struct sss_child_pool_worker *worker;
+    struct sss_child_pool_proc *proc = NULL;
+    int pipefd_to_child[2] = PIPE_INIT;
+    int pipefd_from_child[2] = PIPE_INIT;
+    pid_t pid;
+    errno_t ret;
+
+    worker = talloc_zero(pool, struct sss_child_pool_worker);
+    if (worker == NULL) {
+        return ENOMEM;
+    }
+    worker->pool = pool;
+
+    worker->io = talloc(worker, struct child_io_fds);
+    if (worker->io == NULL) {
+        ret = ENOMEM;
+        goto fail;
+    }
+    worker->io->write_to_child_fd = -1;
+    worker->io->read_from_child_fd = -1;
+    talloc_set_destructor((void *) worker->io, child_io_destructor);
+
+    proc = talloc_zero(pool->ev, struct sss_child_pool_proc);
+    if (proc == NULL) {
+        ret = ENOMEM;
+        goto fail;
+    }
+
+    ret = pipe(pipefd_from_child);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "pipe failed [%d][%s].\n", ret, strerror(ret));
+        goto fail;
+    }
+    ret = pipe(pipefd_to_child);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "pipe failed [%d][%s].\n", ret, strerror(ret));
+        goto fail;
+    }
+
+    pid = fork();
+
+    if (pid == 0) { /* child */
+        exec_child_ex(worker, pipefd_to_child, pipefd_from_child,
+                      pool->opts.binary, pool->opts.debug_fd,
+                      pool->opts.extra_argv, false,
+                      STDIN_FILENO, pool->opts.child_out_fd);
+
+        /* We should never get here */
+        DEBUG(SSSDBG_CRIT_FAILURE, "BUG: Could not exec %s\n",
+              pool->opts.binary);
+        exit(EXIT_FAILURE);
+    } else if (pid < 0) { /* error */
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "fork failed [%d][%s].\n", ret, strerror(ret));
+        goto fail;
+    }
+
+    worker->io->read_from_child_fd = pipefd_from_child[0];
+    PIPE_FD_CLOSE(pipefd_from_child[1]);
+    worker->io->write_to_child_fd = pipefd_to_child[1];
+    PIPE_FD_CLOSE(pipefd_to_child[0]);
+    sss_fd_nonblocking(worker->io->read_from_child_fd);
+    sss_fd_nonblocking(worker->io->write_to_child_fd);
+
+    ret = child_handler_setup(pool->ev, pid, child_pool_exited, proc,
+                              &proc->child_ctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Could not set up child signal handler\n");
+        kill(pid, SIGKILL);
+        goto fail;
+    }
+
+    proc->pid = pid;
+    proc->worker = worker;
+    worker->proc = proc;
+    worker->pid = pid;
+    pool->stats.spawned++;
+
+    DEBUG(SSSDBG_TRACE_INTERNAL, "Started %s [%d].\n", pool->opts.name, pid);
+
+    *_worker = worker;
+    return EOK;
+
+fail:
+    PIPE_CLOSE(pipefd_from_child);
+    PIPE_CLOSE(pipefd_to_child);
+    talloc_free(proc);
+    talloc_free(worker);
+    return ret;
+}
+
+static void child_pool_idle_expired(struct tevent_context *ev,
+                                    struct tevent_timer *te,
+                                    struct timeval tv,
+                                    void *pvt)
+{
+    struct sss_child_pool_worker *worker;
+    struct sss_child_pool *pool;
+
+    worker = talloc_get_type(pvt, struct sss_child_pool_worker);
+    pool = worker->pool;
+    worker->idle_timer = NULL;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Stopping idle %s [%d] after [%u] requests.\n",
+          pool->opts.name, worker->pid, worker->served);
+
+    pool->stats.recycled++;
+    child_pool_worker_stop(worker, false);
+
+    /* replaces the child if it was started ahead of time */
+    child_pool_schedule(pool);
+}
+
+static void child_pool_worker_idle(struct sss_child_pool_worker *worker)
+{
+    struct sss_child_pool *pool = worker->pool;
+
+    worker->busy = false;
+    worker->active = NULL;
+
+    /* The most recently used child is reused first, so that the children
+     * which are not needed anymore reach the idle timeout */
+    DLIST_ADD(pool->idle, worker);
+    pool->stats.idle++;
+
+    if (pool->opts.idle_timeout > 0) {
+        worker->idle_timer = tevent_add_timer(pool->ev, worker,
+                                   tevent_timeval_current_ofs(
+                                                pool->opts.idle_timeout, 0),
+                                   child_pool_idle_expired, worker);
+        if (worker->idle_timer == NULL) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Cannot set up idle timer.\n");
+        }
+    }
+}
+
+/* Hands the worker of a finished request back to the pool */
+static void child_pool_release(struct sss_child_pool_worker *worker,
+                               bool kill_child)
+{
+    struct sss_child_pool *pool = worker->pool;
+
+    worker->active = NULL;
+
+    if (kill_child || child_pool_oneshot(pool)) {
+        child_pool_worker_stop(worker, kill_child);
+    } else if (pool->opts.max_requests > 0
+                && worker->served >= pool->opts.max_requests) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Replacing %s [%d] after [%u] requests.\n",
+              pool->opts.name, worker->pid, worker->served);
+        pool->stats.recycled++;
+        child_pool_worker_stop(worker, false);
+    } else {
+        DLIST_REMOVE(pool->busy, worker);
+        pool->stats.busy--;
+        child_pool_worker_idle(worker);
+    }
+
+    child_pool_schedule(pool);
+}
+
+static void child_pool_finish(struct sss_child_pool_state *state, errno_t ret)
+{
+    struct timeval now;
+    uint64_t duration_us;
+
+    talloc_zfree(state->timeout);
+
+    now = tevent_timeval_current();
+    duration_us = (now.tv_sec - state->start.tv_sec) * 1000000
+                  + now.tv_usec - state->start.tv_usec;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "%s request finished in %"PRIu64" us "
+          "(%s): [%d]: %s\n", state->pool->opts.name, duration_us,
+          state->cold ? "cold" : "warm", ret, sss_strerror(ret));
+    PROBE(CHILD_POOL_DONE, state->pool->opts.name, ret, duration_us,
+          state->cold);
+
+    state->worker = NULL;
+    state->pool = NULL;
+
+    if (ret != EOK) {
+        tevent_req_error(state->req, ret);
+        return;
+    }
+
+    tevent_req_done(state->req);
+}
+
+/* The request is removed from the pool. A child which is working on the
+ * request is in an unknown state, so it is killed. */
+static void child_pool_abort(struct sss_child_pool_state *state)
+{
+    struct sss_child_pool *pool = state->pool;
+
+    if (pool == NULL) {
+        return;
+    }
+
+    if (state->waiting) {
+        DLIST_REMOVE(pool->waiting, state);
+        pool->stats.waiting--;
+        state->waiting = false;
+    } else if (state->worker != NULL) {
+        talloc_zfree(state->io_req);
+        child_pool_release(state->worker, true);
+        state->worker = NULL;
+    }
+
+    state->pool = NULL;
+}
+
+static int child_pool_state_destructor(struct sss_child_pool_state *state)
+{
+    child_pool_abort(state);
+    return 0;
+}
+
+static void child_pool_timeout(struct tevent_context *ev,
+                               struct tevent_timer *te,
+                               struct timeval tv,
+                               void *pvt)
+{
+    struct sss_child_pool_state *state;
+
+    state = talloc_get_type(pvt, struct sss_child_pool_state);
+    state->timeout = NULL;
+
+    DEBUG(SSSDBG_CRIT_FAILURE, "Timeout for %s [%d] reached.\n",
+          state->pool->opts.name,
+          state->worker != NULL ? state->worker->pid : -1);
+
+    state->pool->stats.timeouts++;
+    child_pool_abort(state);
+    tevent_req_error(state->req, ETIMEDOUT);
+}
+
+/* Reads one response prefixed with its length without blocking */
+struct child_pool_read_frame_state {
+    int fd;
+    uint8_t hdr[sizeof(uint32_t)];
+    bool have_hdr;
+    uint8_t *buf;
+    size_t len;
+    size_t nread;
+};
+
+static void child_pool_read_frame_handler(struct tevent_context *ev,
+                                          struct tevent_fd *fde,
+                                          uint16_t flags,
+                                          void *pvt);
+
+static struct tevent_req *
+child_pool_read_frame_send(TALLOC_CTX *mem_ctx,
+                           struct tevent_context *ev,
+                           int fd)
+{
+    struct child_pool_read_frame_state *state;
+    struct tevent_req *req;
+    struct tevent_fd *fde;
+
+    req = tevent_req_create(mem_ctx, &state,
+                            struct child_pool_read_frame_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->fd = fd;
+
+    fde = tevent_add_fd(ev, state, fd, TEVENT_FD_READ,
+                        child_pool_read_frame_handler, req);
+    if (fde == NULL) {
+        talloc_free(req);
+        return NULL;
+    }
+
+    return req;
+}
+
+static void child_pool_read_frame_handler(struct tevent_context *ev,
+                                          struct tevent_fd *fde,
+                                          uint16_t flags,
+                                          void *pvt)
+{
+    struct tevent_req *req;
+    struct child_pool_read_frame_state *state;
+    uint32_t len;
+    uint8_t *dst;
+    size_t want;
+    ssize_t nread;
+    errno_t ret;
+
+    req = talloc_get_type(pvt, struct tevent_req);
+    state = tevent_req_data(req, struct child_pool_read_frame_state);
+
+    if (state->have_hdr) {
+        dst = state->buf + state->nread;
+        want = state->len - state->nread;
+    } else {
+        dst = state->hdr + state->nread;
+        want = sizeof(state->hdr) - state->nread;
+    }
+
+    errno = 0;
+    nread = read(state->fd, dst, want);
+    if (nread == -1) {
+        ret = errno;
+        if (ret == EAGAIN || ret == EINTR) {
+            return;
+        }
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "read failed [%d][%s].\n", ret, strerror(ret));
+        tevent_req_error(req, ret);
+        return;
+    } else if (nread == 0) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "The child closed its output.\n");
+        tevent_req_error(req, EPIPE);
+        return;
+    }
+
+    state->nread += nread;
+
+    if (!state->have_hdr) {
+        if (state->nread < sizeof(state->hdr)) {
+            return;
+        }
+
+        SAFEALIGN_COPY_UINT32(&len, state->hdr, NULL);
+        if (len > CHILD_POOL_MAX_FRAME) {
+            DEBUG(SSSDBG_CRIT_FAILURE,
+                  "Response of the child is too long [%u].\n", len);
+            tevent_req_error(req, EIO);
+            return;
+        }
+
+        state->buf = talloc_size(state, len);
+        if (state->buf == NULL) {
+            tevent_req_error(req, ENOMEM);
+            return;
+        }
+
+        state->len = len;
+        state->nread = 0;
+        state->have_hdr = true;
+    }
+
+    if (state->nread < state->len) {
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+static errno_t child_pool_read_frame_recv(struct tevent_req *req,
+                                          TALLOC_CTX *mem_ctx,
+                                          uint8_t **_buf,
+                                          ssize_t *_len)
+{
+    struct child_pool_read_frame_state *state;
+
+    state = tevent_req_data(req, struct child_pool_read_frame_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_buf = talloc_steal(mem_ctx, state->buf);
+    *_len = state->len;
+    return EOK;
+}
+
+static void child_pool_written(struct tevent_req *subreq);
+static void child_pool_read_done(struct tevent_req *subreq);
+
+static void child_pool_dispatch(struct sss_child_pool_state *state)
+{
+    struct sss_child_pool *pool = state->pool;
+    struct sss_child_pool_worker *worker;
+    struct tevent_req *subreq;
+    errno_t ret;
+
+    worker = pool->idle;
+    if (worker != NULL) {
+        DLIST_REMOVE(pool->idle, worker);
+        pool->stats.idle--;
+        talloc_zfree(worker->idle_timer);
+        pool->stats.warm++;
+    } else {
+        ret = child_pool_spawn(pool, &worker);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Cannot start %s [%d]: %s\n",
+                  pool->opts.name, ret, sss_strerror(ret));
+            child_pool_finish(state, ret);
+            return;
+        }
+        state->cold = true;
+        pool->stats.cold++;
+    }
+
+    worker->busy = true;
+    worker->active = state;
+    DLIST_ADD(pool->busy, worker);
+    pool->stats.busy++;
+    state->worker = worker;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "%s [%d] (%s): idle [%zu] busy [%zu] "
+          "waiting [%zu] spawned [%"PRIu64"] warm [%"PRIu64"] "
+          "cold [%"PRIu64"] queued [%"PRIu64"] rejected [%"PRIu64"] "
+          "died [%"PRIu64"] recycled [%"PRIu64"] timeouts [%"PRIu64"]\n",
+          pool->opts.name, worker->pid, state->cold ? "cold" : "warm",
+          pool->stats.idle, pool->stats.busy, pool->stats.waiting,
+          pool->stats.spawned, pool->stats.warm, pool->stats.cold,
+          pool->stats.queued, pool->stats.rejected, pool->stats.died,
+          pool->stats.recycled, pool->stats.timeouts);
+    PROBE(CHILD_POOL_REQUEST, pool->opts.name, worker->pid, !state->cold,
+          pool->stats.idle, pool->stats.busy, pool->stats.waiting);
+
+    if (state->timeout == NULL && pool->opts.timeout > 0) {
+        state->timeout = tevent_add_timer(state->ev, state,
+                                          tevent_timeval_current_ofs(
+                                                    pool->opts.timeout, 0),
+                                          child_pool_timeout, state);
+        if (state->timeout == NULL) {
+            ret = ENOMEM;
+            goto fail;
+        }
+    }
+
+    subreq = write_pipe_send(state, state->ev, state->frame, state->frame_len,
+                             worker->io->write_to_child_fd);
+    if (subreq == NULL) {
+        ret = ENOMEM;
+        goto fail;
+    }
+    tevent_req_set_callback(subreq, child_pool_written, state);
+    state->io_req = subreq;
+
+    return;
+
+fail:
+    child_pool_release(worker, true);
+    child_pool_finish(state, ret);
+}
+
+static void child_pool_run(struct tevent_context *ev,
+                           struct tevent_immediate *im,
+                           void *pvt)
+{
+    struct sss_child_pool *pool = talloc_get_type(pvt, struct sss_child_pool);
+    struct sss_child_pool_worker *worker;
+    struct sss_child_pool_state *state;
+    errno_t ret;
+
+    while (pool->waiting != NULL && child_pool_has_room(pool)) {
+        state = pool->waiting;
+        DLIST_REMOVE(pool->waiting, state);
+        pool->stats.waiting--;
+        state->waiting = false;
+
+        child_pool_dispatch(state);
+    }
+
+    while (pool->stats.idle < (size_t) pool->opts.prefork
+            && pool->backoff == NULL) {
+        ret = child_pool_spawn(pool, &worker);
+        if (ret != EOK) {
+            child_pool_backoff(pool);
+            break;
+        }
+
+        child_pool_worker_idle(worker);
+    }
+}
+
+/* A child which is gone before it got the request is replaced by another
+ * one, a request which failed after that is only repeated if the pool
+ * allows it */
+static void child_pool_failed(struct sss_child_pool_state *state,
+                              errno_t ret, bool unsent)
+{
+    struct sss_child_pool *pool = state->pool;
+
+    DEBUG(SSSDBG_MINOR_FAILURE, "Communication with %s [%d] failed "
+          "[%d]: %s\n", pool->opts.name, state->worker->pid,
+          ret, sss_strerror(ret));
+
+    pool->stats.died++;
+    child_pool_release(state->worker, true);
+    state->worker = NULL;
+
+    if (!state->retried && (pool->opts.retry || (unsent && !state->cold))) {
+        state->retried = true;
+        child_pool_dispatch(state);
+        return;
+    }
+
+    child_pool_finish(state, ret);
+}
+
+static void child_pool_written(struct tevent_req *subreq)
+{
+    struct sss_child_pool_state *state;
+    struct child_io_fds *io;
+    errno_t ret;
+
+    state = tevent_req_callback_data(subreq, struct sss_child_pool_state);
+    io = state->worker->io;
+
+    ret = write_pipe_recv(subreq);
+    talloc_zfree(subreq);
+    state->io_req = NULL;
+    if (ret != EOK) {
+        child_pool_failed(state, ret, true);
+        return;
+    }
+
+    if (child_pool_oneshot(state->pool)) {
+        PIPE_FD_CLOSE(io->write_to_child_fd);
+        subreq = read_pipe_send(state, state->ev, io->read_from_child_fd);
+    } else {
+        subreq = child_pool_read_frame_send(state, state->ev,
+                                            io->read_from_child_fd);
+    }
+    if (subreq == NULL) {
+        child_pool_failed(state, ENOMEM, false);
+        return;
+    }
+    tevent_req_set_callback(subreq, child_pool_read_done, state);
+    state->io_req = subreq;
+}
+
+static void child_pool_read_done(struct tevent_req *subreq)
+{
+    struct sss_child_pool_state *state;
+    errno_t ret;
+
+    state = tevent_req_callback_data(subreq, struct sss_child_pool_state);
+
+    if (child_pool_oneshot(state->pool)) {
+        ret = read_pipe_recv(subreq, state, &state->buf, &state->len);
+    } else {
+        ret = child_pool_read_frame_recv(subreq, state, &state->buf,
+                                         &state->len);
+    }
+    talloc_zfree(subreq);
+    state->io_req = NULL;
+    if (ret != EOK) {
+        child_pool_failed(state, ret, false);
+        return;
+    }
+
+    state->worker->served++;
+    child_pool_release(state->worker, false);
+    child_pool_finish(state, EOK);
+}
+
+struct tevent_req *sss_child_pool_send(TALLOC_CTX *mem_ctx,
+                                       struct tevent_context *ev,
+                                       struct sss_child_pool *pool,
+                                       uint8_t *buf, size_t len)
+{
+    struct sss_child_pool_state *state;
+    struct tevent_req *req;
+    size_t rp = 0;
+    errno_t ret;
+
+    req = tevent_req_create(mem_ctx, &state, struct sss_child_pool_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->ev = ev;
+    state->req = req;
+    state->start = tevent_timeval_current();
+
+    /* The request is kept until it is done, it might be sent again */
+    if (child_pool_oneshot(pool)) {
+        state->frame_len = len;
+        state->frame = talloc_memdup(state, buf, len);
+    } else {
+        if (len > CHILD_POOL_MAX_FRAME) {
+            ret = EINVAL;
+            goto immediately;
+        }
+        state->frame_len = sizeof(uint32_t) + len;
+        state->frame = talloc_size(state, state->frame_len);
+        if (state->frame != NULL) {
+            SAFEALIGN_SET_UINT32(&state->frame[rp], len, &rp);
+            safealign_memcpy(&state->frame[rp], buf, len, &rp);
+        }
+    }
+    if (state->frame == NULL && state->frame_len > 0) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    /* The requests are dispatched from an immediate event, so the waiting
+     * requests are counted as well */
+    if (pool->opts.max_running > 0
+            && pool->stats.busy + pool->stats.waiting
+                    >= (size_t) pool->opts.max_running) {
+        if (pool->opts.max_queue > 0
+                && pool->stats.busy + pool->stats.waiting
+                    >= (size_t) (pool->opts.max_running
+                                    + pool->opts.max_queue)) {
+            DEBUG(SSSDBG_OP_FAILURE, "Too many requests are waiting for "
+                  "%s, rejecting the request.\n", pool->opts.name);
+            pool->stats.rejected++;
+            ret = EBUSY;
+            goto immediately;
+        }
+
+        DEBUG(SSSDBG_TRACE_FUNC, "[%zu] %s requests running, "
+              "queueing request.\n", pool->stats.busy, pool->opts.name);
+        pool->stats.queued++;
+    }
+
+    state->pool = pool;
+    state->waiting = true;
+    DLIST_ADD_END(pool->waiting, state, struct sss_child_pool_state *);
+    pool->stats.waiting++;
+    talloc_set_destructor(state, child_pool_state_destructor);
+
+    child_pool_schedule(pool);
+
+    return req;
+
+immediately:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+    return req;
+}
+
+errno_t sss_child_pool_recv(struct tevent_req *req, TALLOC_CTX *mem_ctx,
+                            uint8_t **_buf, ssize_t *_len, bool *_cold)
+{
+    struct sss_child_pool_state *state;
+
+    state = tevent_req_data(req, struct sss_child_pool_state);
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *_buf = talloc_steal(mem_ctx, state->buf);
+    *_len = state->len;
+    if (_cold != NULL) {
+        *_cold = state->cold;
+    }
+
+    return EOK;
+}
+
+void sss_child_pool_get_stats(struct sss_child_pool *pool,
+                              struct sss_child_pool_stats *_stats)
+{
+    *_stats = pool->stats;
+}
+
+/* The request is left without a pool, it fails once the caller is back in
+ * the main loop */
+static void child_pool_cancel(struct sss_child_pool_state *state)
+{
+    talloc_zfree(state->timeout);
+    talloc_zfree(state->io_req);
+    state->waiting = false;
+    state->worker = NULL;
+    state->pool = NULL;
+
+    tevent_req_defer_callback(state->req, state->ev);
+    tevent_req_error(state->req, ECANCELED);
+}
+
+static int child_pool_destructor(struct sss_child_pool *pool)
+{
+    struct sss_child_pool_worker *worker;
+    struct sss_child_pool_state *state;
+
+    while ((state = pool->waiting) != NULL) {
+        DLIST_REMOVE(pool->waiting, state);
+        child_pool_cancel(state);
+    }
+
+    while ((worker = pool->busy) != NULL) {
+        state = worker->active;
+        if (state != NULL) {
+            child_pool_cancel(state);
+        }
+        worker->active = NULL;
+        child_pool_worker_stop(worker, true);
+    }
+
+    while (pool->idle != NULL) {
+        child_pool_worker_stop(pool->idle, false);
+    }
+
+    return 0;
+}
+
+errno_t sss_child_pool_create(TALLOC_CTX *mem_ctx,
+                              struct tevent_context *ev,
+                              const struct sss_child_pool_opts *opts,
+                              struct sss_child_pool **_pool)
+{
+    struct sss_child_pool *pool;
+    size_t c;
+    errno_t ret;
+
+    if (opts->binary == NULL || opts->prefork < 0 || opts->max_running < 0
+            || opts->max_queue < 0 || opts->max_requests < 0
+            || opts->timeout < 0 || opts->idle_timeout < 0) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Invalid child pool options.\n");
+        return EINVAL;
+    }
+
+    pool = talloc_zero(mem_ctx, struct sss_child_pool);
+    if (pool == NULL) {
+        return ENOMEM;
+    }
+
+    pool->ev = ev;
+    pool->opts = *opts;
+
+    pool->opts.binary = talloc_strdup(pool, opts->binary);
+    pool->opts.name = talloc_strdup(pool, opts->name != NULL ? opts->name
+                                                             : opts->binary);
+    if (pool->opts.binary == NULL || pool->opts.name == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (opts->extra_argv != NULL) {
+        for (c = 0; opts->extra_argv[c] != NULL; c++);
+
+        pool->opts.extra_argv = talloc_zero_array(pool, const char *, c + 1);
+        if (pool->opts.extra_argv == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        for (c = 0; opts->extra_argv[c] != NULL; c++) {
+            pool->opts.extra_argv[c] = talloc_strdup(pool->opts.extra_argv,
+                                                     opts->extra_argv[c]);
+            if (pool->opts.extra_argv[c] == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+        }
+    }
+
+    if (pool->opts.max_running > 0
+            && pool->opts.prefork > pool->opts.max_running) {
+        pool->opts.prefork = pool->opts.max_running;
+    }
+
+    pool->im = tevent_create_immediate(pool);
+    if (pool->im == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    talloc_set_destructor(pool, child_pool_destructor);
+
+    DEBUG(SSSDBG_CONF_SETTINGS, "%s pool: prefork [%d] max_running [%d] "
+          "max_queue [%d] max_requests [%d] timeout [%d] idle_timeout [%d]\n",
+          pool->opts.name, pool->opts.prefork, pool->opts.max_running,
+          pool->opts.max_queue, pool->opts.max_requests, pool->opts.timeout,
+          pool->opts.idle_timeout);
+
+    if (pool->opts.prefork > 0) {
+        child_pool_schedule(pool);
+    }
+
+    *_pool = pool;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(pool);
+    }
+
+    return ret;
+}
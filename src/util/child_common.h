@@ -117,6 +117,86 @@ void exec_child(TALLOC_CTX *mem_ctx,
                 int *pipefd_to_child, int *pipefd_from_child,
                 const char *binary, int debug_fd);
 
+/* CHILD POOL
+ *
+ * A pool of children started from the same binary. It can start children
+ * ahead of time, caps the number of requests handled at the same time,
+ * queues the other requests and replaces children which died, timed out or
+ * served a given number of requests.
+ */
+struct sss_child_pool;
+
+struct sss_child_pool_opts {
+    /* Used in debug messages and probes */
+    const char *name;
+    const char *binary;
+    const char **extra_argv;
+    int debug_fd;
+    /* The file descriptor the child writes its response to */
+    int child_out_fd;
+
+    /* Number of idle children started ahead of time */
+    int prefork;
+    /* Maximal number of requests handled at the same time, 0 for no limit */
+    int max_running;
+    /* Maximal number of requests waiting for a child, 0 for no limit.
+     * Requests over the limit fail with EBUSY. */
+    int max_queue;
+    /* A child is replaced after it served this many requests. The value 1
+     * keeps the plain protocol of the SSSD children: the request is written
+     * to stdin which is closed afterwards and the response is read until
+     * EOF. Otherwise, 0 meaning no limit, each request and response is
+     * prefixed with its length as uint32_t and the child serves requests
+     * until its stdin is closed. */
+    int max_requests;
+    /* Timeout of a request in seconds once it got a child, 0 for none */
+    int timeout;
+    /* Idle children are stopped after this many seconds, 0 for never */
+    int idle_timeout;
+    /* Repeat a request once with a new child if the child failed. Only
+     * useful if the request is idempotent. */
+    bool retry;
+};
+
+struct sss_child_pool_stats {
+    /* children started */
+    uint64_t spawned;
+    /* requests handed to a child which was already running */
+    uint64_t warm;
+    /* requests which had to start a child */
+    uint64_t cold;
+    /* requests which waited because max_running was reached */
+    uint64_t queued;
+    /* requests which failed because max_queue was reached */
+    uint64_t rejected;
+    /* children which exited while idle or failed a request */
+    uint64_t died;
+    /* children stopped after max_requests or idle_timeout */
+    uint64_t recycled;
+    uint64_t timeouts;
+
+    size_t idle;
+    size_t busy;
+    size_t waiting;
+};
+
+errno_t sss_child_pool_create(TALLOC_CTX *mem_ctx,
+                              struct tevent_context *ev,
+                              const struct sss_child_pool_opts *opts,
+                              struct sss_child_pool **_pool);
+
+struct tevent_req *sss_child_pool_send(TALLOC_CTX *mem_ctx,
+                                       struct tevent_context *ev,
+                                       struct sss_child_pool *pool,
+                                       uint8_t *buf, size_t len);
+
+/* _cold is set to true if a child had to be started for the request */
+errno_t sss_child_pool_recv(struct tevent_req *req, TALLOC_CTX *mem_ctx,
+                            uint8_t **_buf, ssize_t *_len, bool *_cold);
+
+void sss_child_pool_get_stats(struct sss_child_pool *pool,
+                              struct sss_child_pool_stats *_stats);
+
 int child_io_destructor(void *ptr);
 
 errno_t child_debug_init(const char *logfile, int *debug_fd);
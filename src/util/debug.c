@@ -25,10 +25,17 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <unistd.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #ifdef WITH_JOURNALD
 #include <systemd/sd-journal.h>
@@ -43,6 +50,7 @@ int debug_timestamps = SSSDBG_TIMESTAMP_UNRESOLVED;
 int debug_microseconds = SSSDBG_MICROSECONDS_UNRESOLVED;
 int debug_to_file = 0;
 int debug_to_stderr = 0;
+int debug_backtrace_levels = 0;
 enum sss_logger_t sss_logger;
 const char *debug_log_file = "sssd";
 FILE *debug_file = NULL;
@@ -56,6 +64,66 @@ const char *sss_logger_str[] = {
         NULL,
 };
 
+/* Messages are formatted into this buffer and written out in batches: when
+ * it fills up, when an error is logged and when the main loop calls
+ * debug_flush() from a timer. SSSD processes are single-threaded, so the
+ * buffer needs no locking. */
+#define DEBUG_BUFFER_SIZE           (64 * 1024)
+#define DEBUG_PREFIX_SIZE           256
+#define DEBUG_FLUSH_LEVELS          (SSSDBG_FATAL_FAILURE | \
+                                     SSSDBG_CRIT_FAILURE | \
+                                     SSSDBG_OP_FAILURE)
+
+static struct {
+    bool enabled;
+    pid_t pid;
+    sss_debug_pending_fn pending_fn;
+    void *pending_pvt;
+
+    size_t used;
+    uint64_t messages;
+    /* Messages that could not be written */
+    uint64_t dropped;
+
+    char data[DEBUG_BUFFER_SIZE];
+} debug_buffer;
+
+/* The date and time part of the timestamp only changes once a second */
+static struct {
+    time_t sec;
+    char datetime[20];
+    int year;
+} debug_time_cache = { .sec = -1 };
+
+/* Messages that are not logged go to this ring. Only the message itself is
+ * formatted when it is added, the prefix is formatted when the ring is
+ * written out. The oldest messages are overwritten when it is full. */
+#define DEBUG_BACKTRACE_SIZE        (1024 * 1024)
+#define DEBUG_BACKTRACE_MSG_SIZE    1024
+#define DEBUG_BACKTRACE_DUMP_LEVELS (SSSDBG_FATAL_FAILURE | \
+                                     SSSDBG_CRIT_FAILURE)
+#define DEBUG_BACKTRACE_ALIGN(len)  (((len) + 7) & ~((size_t) 7))
+
+struct debug_backtrace_record {
+    struct timeval tv;
+    const char *function;
+    int level;
+    size_t len;
+    /* followed by len bytes of the message */
+};
+
+/* The records are in [first, end) followed by [0, next) when the ring has
+ * wrapped, in [0, next) otherwise */
+static struct {
+    char *data;
+    size_t first;
+    size_t next;
+    size_t end;
+    bool wrapped;
+    size_t count;
+    bool dumping;
+} debug_backtrace;
+
 #ifdef WITH_JOURNALD
 #define JOURNALD_STR " journald,"
 #else
@@ -105,6 +173,8 @@ errno_t set_debug_file_from_fd(const int fd)
     FILE *dummy;
     errno_t ret;
 
+    debug_flush();
+
     errno = 0;
     dummy = fdopen(fd, "a");
     if (dummy == NULL) {
@@ -260,19 +330,272 @@ journal_done:
 }
 #endif /* WiTH_JOURNALD */
 
-void sss_vdebug_fn(const char *file,
-                   long line,
-                   const char *function,
-                   int level,
-                   int flags,
-                   const char *format,
-                   va_list ap)
+static void debug_get_datetime(const struct timeval *tv)
 {
-    struct timeval tv;
     struct tm *tm;
-    char datetime[20];
-    int year;
 
+    if (tv->tv_sec == debug_time_cache.sec) {
+        return;
+    }
+
+    tm = localtime(&tv->tv_sec);
+    debug_time_cache.year = tm->tm_year + 1900;
+    /* get date time without year */
+    memcpy(debug_time_cache.datetime, ctime(&tv->tv_sec), 19);
+    debug_time_cache.datetime[19] = '\0';
+    debug_time_cache.sec = tv->tv_sec;
+}
+
+/* tv is the time the message was created, NULL for now */
+static int debug_format_prefix(char *buf, size_t size,
+                               const struct timeval *tv,
+                               const char *function, int level)
+{
+    struct timeval now;
+
+    if (!debug_timestamps) {
+        return snprintf(buf, size, "[%s] [%s] (%#.4x): ",
+                        debug_prg_name, function, level);
+    }
+
+    if (tv == NULL) {
+        gettimeofday(&now, NULL);
+        tv = &now;
+    }
+    debug_get_datetime(tv);
+
+    if (debug_microseconds) {
+        return snprintf(buf, size, "(%s:%.6ld %d) [%s] [%s] (%#.4x): ",
+                        debug_time_cache.datetime, (long) tv->tv_usec,
+                        debug_time_cache.year, debug_prg_name,
+                        function, level);
+    }
+
+    return snprintf(buf, size, "(%s %d) [%s] [%s] (%#.4x): ",
+                    debug_time_cache.datetime, debug_time_cache.year,
+                    debug_prg_name, function, level);
+}
+
+/* A forked process inherits the buffer, the parent writes it out. The
+ * child logs directly, it does not run the timer that flushes. */
+static void debug_buffer_forked(void)
+{
+    debug_buffer.used = 0;
+    debug_buffer.messages = 0;
+    debug_buffer.dropped = 0;
+    debug_buffer.enabled = false;
+    debug_buffer.pending_fn = NULL;
+    debug_buffer.pending_pvt = NULL;
+}
+
+void debug_flush(void)
+{
+    FILE *f = debug_file ? debug_file : stderr;
+    int ret;
+
+    if (debug_buffer.used == 0 && debug_buffer.dropped == 0) {
+        return;
+    }
+
+    if (debug_buffer.pid != getpid()) {
+        debug_buffer_forked();
+        return;
+    }
+
+    if (debug_buffer.dropped > 0) {
+        ret = fprintf(f, "[%s] [%s] (%#.4x): %"PRIu64" debug messages "
+                      "were dropped\n", debug_prg_name, __FUNCTION__,
+                      SSSDBG_CRIT_FAILURE, debug_buffer.dropped);
+        if (ret > 0) {
+            debug_buffer.dropped = 0;
+        }
+    }
+
+    if (debug_buffer.used > 0) {
+        /* Rather drop the messages than retry and block the process */
+        if (fwrite(debug_buffer.data, 1, debug_buffer.used, f)
+                != debug_buffer.used) {
+            debug_buffer.dropped += debug_buffer.messages;
+        }
+        debug_buffer.used = 0;
+        debug_buffer.messages = 0;
+    }
+
+    debug_fflush();
+}
+
+static void debug_atexit(void)
+{
+    debug_flush();
+}
+
+void debug_flush_on_signal(void)
+{
+    int saved_errno = errno;
+    size_t done = 0;
+    ssize_t n;
+    int fd;
+
+    if (debug_buffer.used == 0 || debug_buffer.pid != getpid()) {
+        return;
+    }
+
+    /* Only async-signal-safe calls, stdio must not be used here */
+    fd = fileno(debug_file ? debug_file : stderr);
+    while (done < debug_buffer.used) {
+        n = write(fd, debug_buffer.data + done, debug_buffer.used - done);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+
+    debug_buffer.used = 0;
+    debug_buffer.messages = 0;
+    errno = saved_errno;
+}
+
+static void debug_fatal_signal(int sig)
+{
+    debug_flush_on_signal();
+
+    /* The default action was restored when the signal was delivered */
+    raise(sig);
+}
+
+/* A crash must not take the last buffered messages with it. Signals that
+ * somebody else already handles are left alone. */
+static void debug_catch_fatal_signals(void)
+{
+    const int signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+    struct sigaction old;
+    struct sigaction sa;
+    size_t i;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = debug_fatal_signal;
+    sa.sa_flags = SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&sa.sa_mask);
+
+    for (i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+        if (sigaction(signals[i], NULL, &old) != 0
+                || old.sa_handler != SIG_DFL) {
+            continue;
+        }
+
+        sigaction(signals[i], &sa, NULL);
+    }
+}
+
+void debug_enable_buffering(sss_debug_pending_fn pending_fn, void *pvt)
+{
+    static bool handlers_set = false;
+
+    debug_flush();
+
+    if (!handlers_set) {
+        /* Messages would be lost at exit */
+        if (atexit(debug_atexit) != 0) {
+            return;
+        }
+#ifdef HAVE_PTHREAD
+        if (pthread_atfork(NULL, NULL, debug_buffer_forked) != 0) {
+            return;
+        }
+#endif
+        debug_catch_fatal_signals();
+        handlers_set = true;
+    }
+
+    debug_buffer.pid = getpid();
+    debug_buffer.pending_fn = pending_fn;
+    debug_buffer.pending_pvt = pvt;
+    debug_buffer.enabled = true;
+}
+
+void debug_disable_buffering(void)
+{
+    debug_flush();
+
+    debug_buffer.enabled = false;
+    debug_buffer.pending_fn = NULL;
+    debug_buffer.pending_pvt = NULL;
+}
+
+/* Returns false if the message does not fit into the buffer even when it
+ * is empty, the caller writes it directly then */
+static bool debug_buffer_append(const struct timeval *tv,
+                                const char *function,
+                                int level,
+                                int flags,
+                                const char *format,
+                                va_list ap)
+{
+    va_list ap_copy;
+    bool was_empty;
+    size_t avail;
+    size_t plen = 0;
+    size_t len = 0;
+    char *pos;
+    int ret;
+
+    while (true) {
+        was_empty = (debug_buffer.used == 0);
+        pos = debug_buffer.data + debug_buffer.used;
+        avail = DEBUG_BUFFER_SIZE - debug_buffer.used;
+
+        ret = debug_format_prefix(pos, avail, tv, function, level);
+        if (ret >= 0 && (size_t) ret < avail) {
+            plen = ret;
+
+            va_copy(ap_copy, ap);
+            ret = vsnprintf(pos + plen, avail - plen, format, ap_copy);
+            va_end(ap_copy);
+
+            /* Leave room for the line feed */
+            if (ret >= 0 && (size_t) ret + 1 < avail - plen) {
+                len = ret;
+                break;
+            }
+        }
+
+        if (was_empty) {
+            return false;
+        }
+
+        debug_flush();
+        if (!debug_buffer.enabled) {
+            return false;
+        }
+    }
+
+    debug_buffer.used += plen + len;
+    if (flags & APPEND_LINE_FEED) {
+        debug_buffer.data[debug_buffer.used++] = '\n';
+    }
+    debug_buffer.messages++;
+
+    if (level & DEBUG_FLUSH_LEVELS) {
+        debug_flush();
+    } else if (was_empty && debug_buffer.pending_fn != NULL) {
+        debug_buffer.pending_fn(debug_buffer.pending_pvt);
+    }
+
+    return true;
+}
+
+static void debug_vwrite(const struct timeval *tv,
+                         const char *file,
+                         long line,
+                         const char *function,
+                         int level,
+                         int flags,
+                         const char *format,
+                         va_list ap)
+{
+    char prefix[DEBUG_PREFIX_SIZE];
 #ifdef WITH_JOURNALD
     errno_t ret;
     va_list ap_fallback;
@@ -297,28 +620,16 @@ void sss_vdebug_fn(const char *file,
     }
 #endif
 
-    if (debug_timestamps) {
-        gettimeofday(&tv, NULL);
-        tm = localtime(&tv.tv_sec);
-        year = tm->tm_year + 1900;
-        /* get date time without year */
-        memcpy(datetime, ctime(&tv.tv_sec), 19);
-        datetime[19] = '\0';
-        if (debug_microseconds) {
-            debug_printf("(%s:%.6ld %d) [%s] [%s] (%#.4x): ",
-                         datetime, tv.tv_usec,
-                         year, debug_prg_name,
-                         function, level);
-        } else {
-            debug_printf("(%s %d) [%s] [%s] (%#.4x): ",
-                         datetime, year,
-                         debug_prg_name, function, level);
+    if (debug_buffer.enabled) {
+        if (debug_buffer_append(tv, function, level, flags, format, ap)) {
+            return;
         }
-    } else {
-        debug_printf("[%s] [%s] (%#.4x): ",
-                     debug_prg_name, function, level);
+        /* Too long for the buffer, which is empty now, write it directly */
     }
 
+    debug_format_prefix(prefix, sizeof(prefix), tv, function, level);
+    debug_printf("%s", prefix);
+
     debug_vprintf(format, ap);
     if (flags & APPEND_LINE_FEED) {
         debug_printf("\n");
@@ -326,6 +637,195 @@ void sss_vdebug_fn(const char *file,
     debug_fflush();
 }
 
+static void debug_write(const struct timeval *tv,
+                        const char *function,
+                        int level,
+                        const char *format, ...) SSS_ATTRIBUTE_PRINTF(4, 5);
+
+static void debug_write(const struct timeval *tv,
+                        const char *function,
+                        int level,
+                        const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    debug_vwrite(tv, __FILE__, __LINE__, function, level, 0, format, ap);
+    va_end(ap);
+}
+
+static void debug_backtrace_reset(void)
+{
+    debug_backtrace.first = 0;
+    debug_backtrace.next = 0;
+    debug_backtrace.end = 0;
+    debug_backtrace.wrapped = false;
+    debug_backtrace.count = 0;
+}
+
+void debug_backtrace_enable(bool enable)
+{
+    if (enable && debug_backtrace.data == NULL) {
+        debug_backtrace.data = malloc(DEBUG_BACKTRACE_SIZE);
+        if (debug_backtrace.data == NULL) {
+            return;
+        }
+        debug_backtrace_reset();
+    } else if (!enable) {
+        free(debug_backtrace.data);
+        debug_backtrace.data = NULL;
+    }
+
+    debug_backtrace_levels = enable ? SSSDBG_BACKTRACE_LEVELS : 0;
+}
+
+/* Makes room for a record of size bytes by dropping the oldest ones */
+static char *debug_backtrace_reserve(size_t size)
+{
+    struct debug_backtrace_record rec;
+
+    while (true) {
+        if (!debug_backtrace.wrapped) {
+            /* first is always 0 here */
+            if (debug_backtrace.next + size <= DEBUG_BACKTRACE_SIZE) {
+                break;
+            }
+
+            if (debug_backtrace.count == 0) {
+                debug_backtrace_reset();
+                continue;
+            }
+
+            debug_backtrace.end = debug_backtrace.next;
+            debug_backtrace.next = 0;
+            debug_backtrace.wrapped = true;
+            continue;
+        }
+
+        if (debug_backtrace.next + size <= debug_backtrace.first) {
+            break;
+        }
+
+        memcpy(&rec, debug_backtrace.data + debug_backtrace.first,
+               sizeof(rec));
+        debug_backtrace.first += DEBUG_BACKTRACE_ALIGN(sizeof(rec) + rec.len);
+        debug_backtrace.count--;
+        if (debug_backtrace.first >= debug_backtrace.end) {
+            debug_backtrace.first = 0;
+            debug_backtrace.wrapped = false;
+        }
+    }
+
+    return debug_backtrace.data + debug_backtrace.next;
+}
+
+static void debug_backtrace_add(const char *function,
+                                int level,
+                                int flags,
+                                const char *format,
+                                va_list ap)
+{
+    struct debug_backtrace_record rec;
+    char *pos;
+    int len;
+
+    if (debug_backtrace.data == NULL || debug_backtrace.dumping) {
+        return;
+    }
+
+    /* Room for the longest message, it is formatted right into the ring */
+    pos = debug_backtrace_reserve(sizeof(rec) + DEBUG_BACKTRACE_MSG_SIZE);
+
+    len = vsnprintf(pos + sizeof(rec), DEBUG_BACKTRACE_MSG_SIZE, format, ap);
+    if (len < 0) {
+        return;
+    }
+    if (len >= DEBUG_BACKTRACE_MSG_SIZE) {
+        /* Truncated, the line feed is lost */
+        len = DEBUG_BACKTRACE_MSG_SIZE - 1;
+        flags |= APPEND_LINE_FEED;
+    }
+    if (flags & APPEND_LINE_FEED) {
+        pos[sizeof(rec) + len++] = '\n';
+    }
+
+    gettimeofday(&rec.tv, NULL);
+    rec.function = function;
+    rec.level = level;
+    rec.len = len;
+    memcpy(pos, &rec, sizeof(rec));
+
+    debug_backtrace.next += DEBUG_BACKTRACE_ALIGN(sizeof(rec) + len);
+    debug_backtrace.count++;
+}
+
+static size_t debug_backtrace_write(size_t pos, size_t end)
+{
+    struct debug_backtrace_record rec;
+
+    while (pos < end) {
+        memcpy(&rec, debug_backtrace.data + pos, sizeof(rec));
+        debug_write(&rec.tv, rec.function, rec.level, "%.*s",
+                    (int) rec.len, debug_backtrace.data + pos + sizeof(rec));
+        pos += DEBUG_BACKTRACE_ALIGN(sizeof(rec) + rec.len);
+    }
+
+    return pos;
+}
+
+void debug_backtrace_dump(void)
+{
+    if (debug_backtrace.data == NULL || debug_backtrace.count == 0
+            || debug_backtrace.dumping) {
+        return;
+    }
+
+    /* Messages logged while writing must not change the ring */
+    debug_backtrace.dumping = true;
+
+    debug_write(NULL, __FUNCTION__, SSSDBG_CRIT_FAILURE,
+                "********** BEGIN BACKTRACE: %zu messages below the "
+                "debug level **********\n",
+                debug_backtrace.count);
+
+    if (debug_backtrace.wrapped) {
+        debug_backtrace_write(debug_backtrace.first, debug_backtrace.end);
+    }
+    debug_backtrace_write(0, debug_backtrace.next);
+
+    debug_write(NULL, __FUNCTION__, SSSDBG_CRIT_FAILURE,
+                "********** END BACKTRACE **********\n");
+
+    /* Each message is written only once */
+    debug_backtrace_reset();
+    debug_backtrace.dumping = false;
+
+    debug_flush();
+}
+
+void sss_vdebug_fn(const char *file,
+                   long line,
+                   const char *function,
+                   int level,
+                   int flags,
+                   const char *format,
+                   va_list ap)
+{
+    if (!DEBUG_IS_SET(level)) {
+        if (DEBUG_BACKTRACE_IS_SET(level)) {
+            debug_backtrace_add(function, level, flags, format, ap);
+        }
+        return;
+    }
+
+    /* Show what led to the error first */
+    if (level & DEBUG_BACKTRACE_DUMP_LEVELS) {
+        debug_backtrace_dump();
+    }
+
+    debug_vwrite(NULL, file, line, function, level, flags, format, ap);
+}
+
 void sss_debug_fn(const char *file,
                   long line,
                   const char *function,
@@ -359,7 +859,7 @@ void ldb_debug_messages(void *context, enum ldb_debug_level level,
         break;
     }
 
-    if (DEBUG_IS_SET(loglevel)) {
+    if (DEBUG_IS_SET(loglevel) || DEBUG_BACKTRACE_IS_SET(loglevel)) {
         sss_vdebug_fn(__FILE__, __LINE__, "ldb", loglevel, APPEND_LINE_FEED,
                       fmt, ap);
     }
@@ -426,7 +926,10 @@ int open_debug_file_ex(const char *filename, FILE **filep, bool want_cloexec)
         return ENOMEM;
     }
 
-    if (debug_file && !filep) fclose(debug_file);
+    if (debug_file && !filep) {
+        debug_flush();
+        fclose(debug_file);
+    }
 
     old_umask = umask(SSS_DFL_UMASK);
     errno = 0;
@@ -472,6 +975,8 @@ int rotate_debug_files(void)
 
     if (sss_logger != FILES_LOGGER) return EOK;
 
+    debug_flush();
+
     do {
         error = 0;
         ret = fclose(debug_file);
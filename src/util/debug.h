@@ -24,6 +24,7 @@
 #include "config.h"
 
 #include <stdarg.h>
+#include <signal.h>
 
 #ifdef HAVE_FUNCTION_ATTRIBUTE_FORMAT
 #define SSS_ATTRIBUTE_PRINTF(a1, a2) __attribute__((format (printf, a1, a2)))
@@ -48,6 +49,7 @@ extern int debug_timestamps;
 extern int debug_microseconds;
 extern int debug_to_file;
 extern int debug_to_stderr;
+extern int debug_backtrace_levels;
 extern enum sss_logger_t sss_logger;
 extern const char *debug_log_file;
 
@@ -69,6 +71,25 @@ int debug_convert_old_level(int old_level);
 errno_t set_debug_file_from_fd(const int fd);
 int get_fd_from_debug_file(void);
 
+/* Called when the first message is added to an empty debug buffer. The
+ * main loop uses it to schedule debug_flush(). */
+typedef void (*sss_debug_pending_fn)(void *pvt);
+
+/* Format debug messages into a buffer and write them in batches instead
+ * of one by one. Errors are still written right away. */
+void debug_enable_buffering(sss_debug_pending_fn pending_fn, void *pvt);
+void debug_disable_buffering(void);
+void debug_flush(void);
+/* Writes the buffered messages from a signal handler before the process
+ * dies, using only async-signal-safe calls */
+void debug_flush_on_signal(void);
+
+/* Keep the messages that are not logged because of the debug level in a
+ * memory ring. The ring is written to the log when an error is logged or
+ * debug_backtrace_dump() is called. */
+void debug_backtrace_enable(bool enable);
+void debug_backtrace_dump(void);
+
 #define SSS_DOM_ENV           "_SSS_DOM"
 
 #define SSSDBG_FATAL_FAILURE  0x0010   /* level 0 */
@@ -88,6 +109,19 @@ int get_fd_from_debug_file(void);
 #define SSSDBG_UNRESOLVED     0
 #define SSSDBG_MASK_ALL       0xFFF0   /* enable all debug levels */
 #define SSSDBG_DEFAULT        SSSDBG_FATAL_FAILURE
+/* Levels kept in the backtrace ring, everything up to level 8 */
+#define SSSDBG_BACKTRACE_LEVELS (SSSDBG_FATAL_FAILURE | \
+                                 SSSDBG_CRIT_FAILURE | \
+                                 SSSDBG_OP_FAILURE | \
+                                 SSSDBG_MINOR_FAILURE | \
+                                 SSSDBG_CONF_SETTINGS | \
+                                 SSSDBG_FUNC_DATA | \
+                                 SSSDBG_TRACE_FUNC | \
+                                 SSSDBG_TRACE_LIBS | \
+                                 SSSDBG_TRACE_INTERNAL)
+
+/* Sent to an SSSD process to make it write its backtrace ring */
+#define SSSDBG_BACKTRACE_SIGNAL (SIGRTMIN)
 
 #define SSSDBG_TIMESTAMP_UNRESOLVED   -1
 #define SSSDBG_TIMESTAMP_DEFAULT       1
@@ -95,6 +129,8 @@ int get_fd_from_debug_file(void);
 #define SSSDBG_MICROSECONDS_UNRESOLVED   -1
 #define SSSDBG_MICROSECONDS_DEFAULT       0
 
+#define SSSDBG_BACKTRACE_DEFAULT          0
+
 #define SSSD_LOGGER_OPTS \
         {"logger", '\0', POPT_ARG_STRING, &opt_logger, 0, \
          _("Set logger"), "stderr|files|journald"},
@@ -122,7 +158,8 @@ int get_fd_from_debug_file(void);
 */
 #define DEBUG(level, format, ...) do { \
     int __debug_macro_level = level; \
-    if (DEBUG_IS_SET(__debug_macro_level)) { \
+    if (DEBUG_IS_SET(__debug_macro_level) || \
+            DEBUG_BACKTRACE_IS_SET(__debug_macro_level)) { \
         sss_debug_fn(__FILE__, __LINE__, __FUNCTION__, \
                      __debug_macro_level, \
                      format, ##__VA_ARGS__); \
@@ -139,6 +176,13 @@ int get_fd_from_debug_file(void);
                                             (level & (SSSDBG_FATAL_FAILURE | \
                                                       SSSDBG_CRIT_FAILURE))))
 
+/** \def DEBUG_BACKTRACE_IS_SET(level)
+    \brief checks whether messages of level are kept in the backtrace ring
+
+    \param level the debug level, please use one of the SSSDBG*_ macros
+*/
+#define DEBUG_BACKTRACE_IS_SET(level) (debug_backtrace_levels & (level))
+
 #define DEBUG_INIT(dbg_lvl) do { \
     if (dbg_lvl != SSSDBG_INVALID) { \
         debug_level = debug_convert_old_level(dbg_lvl); \
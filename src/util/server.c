@@ -33,6 +33,7 @@
 #include <ldb.h>
 #include "util/util.h"
 #include "confdb/confdb.h"
+#include "util/sss_metrics.h"
 
 #ifdef HAVE_PRCTL
 #include <sys/prctl.h>
@@ -342,6 +343,66 @@ int die_if_parent_died(void)
     return EOK;
 }
 
+/* Buffered debug messages are written at most this many seconds late */
+#define SERVER_DEBUG_FLUSH_DELAY 1
+
+struct debug_flush_ctx {
+    struct tevent_context *ev;
+    struct tevent_timer *te;
+};
+
+static void server_debug_flush(struct tevent_context *ev,
+                               struct tevent_timer *te,
+                               struct timeval current_time,
+                               void *pvt)
+{
+    struct debug_flush_ctx *fctx = talloc_get_type(pvt,
+                                                   struct debug_flush_ctx);
+
+    fctx->te = NULL;
+    debug_flush();
+}
+
+static void server_debug_pending(void *pvt)
+{
+    struct debug_flush_ctx *fctx = talloc_get_type(pvt,
+                                                   struct debug_flush_ctx);
+
+    if (fctx->te != NULL) {
+        return;
+    }
+
+    fctx->te = tevent_add_timer(fctx->ev, fctx,
+                                tevent_timeval_current_ofs(
+                                                SERVER_DEBUG_FLUSH_DELAY, 0),
+                                server_debug_flush, fctx);
+    if (fctx->te == NULL) {
+        /* Better now than never */
+        debug_flush();
+    }
+}
+
+static int debug_flush_ctx_destructor(struct debug_flush_ctx *fctx)
+{
+    debug_disable_buffering();
+    return 0;
+}
+
+static errno_t server_setup_debug_buffering(struct tevent_context *ev)
+{
+    struct debug_flush_ctx *fctx;
+
+    fctx = talloc_zero(ev, struct debug_flush_ctx);
+    if (fctx == NULL) {
+        return ENOMEM;
+    }
+    fctx->ev = ev;
+    talloc_set_destructor(fctx, debug_flush_ctx_destructor);
+
+    debug_enable_buffering(server_debug_pending, fctx);
+    return EOK;
+}
+
 struct logrotate_ctx {
     struct confdb_ctx *confdb;
     const char *confdb_path;
@@ -358,7 +419,7 @@ static void te_server_hup(struct tevent_context *ev,
     struct logrotate_ctx *lctx =
             talloc_get_type(private_data, struct logrotate_ctx);
 
-    DEBUG(SSSDBG_CRIT_FAILURE, "Received SIGHUP. Rotating logfiles.\n");
+    DEBUG(SSSDBG_IMPORTANT_INFO, "Received SIGHUP. Rotating logfiles.\n");
 
     ret = server_common_rotate_logs(lctx->confdb, lctx->confdb_path);
     if (ret != EOK) {
@@ -367,6 +428,16 @@ static void te_server_hup(struct tevent_context *ev,
     }
 }
 
+static void te_server_backtrace(struct tevent_context *ev,
+                                struct tevent_signal *se,
+                                int signum,
+                                int count,
+                                void *siginfo,
+                                void *private_data)
+{
+    debug_backtrace_dump();
+}
+
 errno_t server_common_rotate_logs(struct confdb_ctx *confdb,
                                   const char *conf_path)
 {
@@ -427,6 +498,49 @@ static const char *get_pid_path(void)
 #endif
 }
 
+static const char *get_metrics_path(void)
+{
+#ifdef UNIT_TESTING
+#ifdef TEST_METRICS_PATH
+    return TEST_METRICS_PATH;
+#else
+    #error "TEST_METRICS_PATH must be defined when unit testing server.c!"
+#endif /* TEST_METRICS_PATH */
+#else
+    return METRICS_PATH;
+#endif
+}
+
+static errno_t server_setup_metrics(struct main_context *ctx,
+                                    const char *conf_entry)
+{
+    const char *path;
+    int interval;
+    errno_t ret;
+
+    ret = confdb_get_int(ctx->confdb_ctx, conf_entry,
+                         CONFDB_SERVICE_METRICS_SNAPSHOT_INTERVAL,
+                         SSS_METRICS_SNAPSHOT_INTERVAL_DEFAULT, &interval);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (interval <= 0) {
+        DEBUG(SSSDBG_CONF_SETTINGS, "Metrics snapshots are disabled\n");
+        return EOK;
+    }
+
+    path = talloc_asprintf(ctx, "%s/%s%s", get_metrics_path(),
+                           debug_log_file, SSS_METRICS_SNAPSHOT_SUFFIX);
+    if (path == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sss_metrics_snapshot_setup(ctx, ctx->event_ctx, path, interval);
+    talloc_free(discard_const(path));
+    return ret;
+}
+
 int server_setup(const char *name, int flags,
                  uid_t uid, gid_t gid,
                  const char *conf_entry,
@@ -440,6 +554,7 @@ int server_setup(const char *name, int flags,
     bool dt;
     bool dl = false;
     bool dm;
+    bool db;
     struct tevent_signal *tes;
     struct logrotate_ctx *lctx;
     char *locale;
@@ -626,6 +741,17 @@ int server_setup(const char *name, int flags,
         else debug_microseconds = 0;
     }
 
+    /* keep the messages below the debug level in memory */
+    ret = confdb_get_bool(ctx->confdb_ctx, conf_entry,
+                          CONFDB_SERVICE_DEBUG_BACKTRACE_ENABLED,
+                          SSSDBG_BACKTRACE_DEFAULT, &db);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE, "Error reading from confdb (%d) [%s]\n",
+                                     ret, strerror(ret));
+        return ret;
+    }
+    debug_backtrace_enable(db);
+
     /* same for debug to file */
     ret = confdb_get_bool(ctx->confdb_ctx, conf_entry,
                           CONFDB_SERVICE_DEBUG_TO_FILES,
@@ -653,6 +779,13 @@ int server_setup(const char *name, int flags,
         return EIO;
     }
 
+    /* sssctl asks for the debug backtrace through the monitor */
+    tes = tevent_add_signal(ctx->event_ctx, ctx, SSSDBG_BACKTRACE_SIGNAL, 0,
+                            te_server_backtrace, NULL);
+    if (tes == NULL) {
+        return EIO;
+    }
+
     /* open log file if told so */
     if (sss_logger == FILES_LOGGER) {
         ret = open_debug_file();
@@ -661,6 +794,14 @@ int server_setup(const char *name, int flags,
                                          "[%s]\n", ret, strerror(ret));
             return ret;
         }
+
+        /* Write the debug log in batches from the main loop */
+        ret = server_setup_debug_buffering(ctx->event_ctx);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE, "Error setting up logging (%d) "
+                                         "[%s]\n", ret, strerror(ret));
+            return ret;
+        }
     }
 
     /* Setup the internal watchdog */
@@ -681,6 +822,14 @@ int server_setup(const char *name, int flags,
         }
     }
 
+    /* Write a snapshot of the metrics periodically for sssctl */
+    ret = server_setup_metrics(ctx, conf_entry);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to set up metrics snapshots, "
+              "metrics will not be available (%d) [%s]\n",
+              ret, sss_strerror(ret));
+    }
+
     sss_log(SSS_LOG_INFO, "Starting up");
 
     DEBUG(SSSDBG_TRACE_FUNC, "CONFDB: %s\n", conf_db);
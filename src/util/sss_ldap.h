@@ -59,6 +59,19 @@ int sss_ldap_get_diagnostic_msg(TALLOC_CTX *mem_ctx,
 #define LDAP_SERVER_SD_OID "1.2.840.113556.1.4.801"
 #endif /* LDAP_SERVER_SD_OID */
 
+#ifndef LDAP_SERVER_DIRSYNC_OID
+#define LDAP_SERVER_DIRSYNC_OID "1.2.840.113556.1.4.841"
+#endif /* LDAP_SERVER_DIRSYNC_OID */
+
+/*
+ * DirSync request flags
+ * (see https://msdn.microsoft.com/en-us/library/cc223347.aspx)
+ */
+#define LDAP_DIRSYNC_OBJECT_SECURITY ( 0x00000001 )
+#define LDAP_DIRSYNC_ANCESTORS_FIRST_ORDER ( 0x00000800 )
+#define LDAP_DIRSYNC_PUBLIC_DATA_ONLY ( 0x00002000 )
+#define LDAP_DIRSYNC_INCREMENTAL_VALUES ( 0x80000000 )
+
 
 /*
  * The following four flags specify which security descriptor parts to retrieve
@@ -0,0 +1,703 @@
+/*
+    SSSD
+
+    Runtime performance metrics
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <dhash.h>
+
+#include "util/util.h"
+#include "util/atomic_io.h"
+#include "util/sss_metrics.h"
+
+/* Values below 2 * SSS_METRIC_SUB_BUCKETS get a bucket of their own. The
+ * larger ones share a power of two range split in SSS_METRIC_SUB_BUCKETS
+ * linear buckets. Values above 2^SSS_METRIC_MAX_BITS are counted in the
+ * last bucket. */
+#define SSS_METRIC_SUB_BITS 3
+#define SSS_METRIC_SUB_BUCKETS (1 << SSS_METRIC_SUB_BITS)
+#define SSS_METRIC_MAX_BITS 40
+#define SSS_METRIC_MAX_VALUE ((UINT64_C(1) << SSS_METRIC_MAX_BITS) - 1)
+#define SSS_METRIC_BUCKETS \
+    ((SSS_METRIC_MAX_BITS - SSS_METRIC_SUB_BITS + 1) * SSS_METRIC_SUB_BUCKETS)
+
+enum sss_metric_type {
+    SSS_METRIC_COUNTER,
+    SSS_METRIC_HISTOGRAM
+};
+
+struct sss_metric {
+    const char *name;
+    enum sss_metric_type type;
+
+    /* Counter value or number of recorded values */
+    uint64_t value;
+
+    /* Histograms only */
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t *buckets;
+};
+
+struct sss_metrics_registry {
+    hash_table_t *table;
+    struct sss_metric **list;
+    size_t count;
+};
+
+static struct sss_metrics_registry *metrics;
+
+static const char *sss_metric_type_str[] = {
+    [SSS_METRIC_COUNTER] = "counter",
+    [SSS_METRIC_HISTOGRAM] = "histogram",
+};
+
+static int sss_metric_bucket(uint64_t value)
+{
+    int shift = 0;
+
+    if (value > SSS_METRIC_MAX_VALUE) {
+        value = SSS_METRIC_MAX_VALUE;
+    }
+
+    while ((value >> shift) >= 2 * SSS_METRIC_SUB_BUCKETS) {
+        shift++;
+    }
+
+    return shift * SSS_METRIC_SUB_BUCKETS + (value >> shift);
+}
+
+static uint64_t sss_metric_bucket_high(int bucket)
+{
+    uint64_t mantissa;
+    int shift;
+
+    if (bucket < 2 * SSS_METRIC_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    shift = bucket / SSS_METRIC_SUB_BUCKETS - 1;
+    mantissa = bucket - shift * SSS_METRIC_SUB_BUCKETS;
+
+    return ((mantissa + 1) << shift) - 1;
+}
+
+static struct sss_metrics_registry *sss_metrics_get_registry(void)
+{
+    struct sss_metrics_registry *registry;
+    errno_t ret;
+
+    if (metrics != NULL) {
+        return metrics;
+    }
+
+    registry = talloc_zero(NULL, struct sss_metrics_registry);
+    if (registry == NULL) {
+        return NULL;
+    }
+
+    ret = sss_hash_create(registry, 0, &registry->table);
+    if (ret != EOK) {
+        talloc_free(registry);
+        return NULL;
+    }
+
+    metrics = registry;
+    return metrics;
+}
+
+static struct sss_metric *sss_metric_vget(enum sss_metric_type type,
+                                          const char *name_fmt,
+                                          va_list ap)
+{
+    struct sss_metrics_registry *registry;
+    struct sss_metric **list;
+    struct sss_metric *metric;
+    char name[SSS_METRIC_NAME_MAX];
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+    int len;
+
+    len = vsnprintf(name, sizeof(name), name_fmt, ap);
+    if (len < 0 || len >= sizeof(name)) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Metric name is too long\n");
+        return NULL;
+    }
+
+    registry = sss_metrics_get_registry();
+    if (registry == NULL) {
+        return NULL;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = name;
+
+    hret = hash_lookup(registry->table, &key, &value);
+    if (hret == HASH_SUCCESS) {
+        metric = talloc_get_type(value.ptr, struct sss_metric);
+        if (metric == NULL || metric->type != type) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Metric %s is not a %s\n",
+                  name, sss_metric_type_str[type]);
+            return NULL;
+        }
+
+        return metric;
+    } else if (hret != HASH_ERROR_KEY_NOT_FOUND) {
+        return NULL;
+    }
+
+    metric = talloc_zero(registry, struct sss_metric);
+    if (metric == NULL) {
+        return NULL;
+    }
+
+    metric->type = type;
+    metric->name = talloc_strdup(metric, name);
+    if (metric->name == NULL) {
+        goto fail;
+    }
+
+    if (type == SSS_METRIC_HISTOGRAM) {
+        metric->buckets = talloc_zero_array(metric, uint64_t,
+                                            SSS_METRIC_BUCKETS);
+        if (metric->buckets == NULL) {
+            goto fail;
+        }
+    }
+
+    list = talloc_realloc(registry, registry->list, struct sss_metric *,
+                          registry->count + 1);
+    if (list == NULL) {
+        goto fail;
+    }
+    registry->list = list;
+
+    key.str = discard_const(metric->name);
+    value.type = HASH_VALUE_PTR;
+    value.ptr = metric;
+    hret = hash_enter(registry->table, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        goto fail;
+    }
+
+    registry->list[registry->count] = metric;
+    registry->count++;
+
+    return metric;
+
+fail:
+    talloc_free(metric);
+    return NULL;
+}
+
+struct sss_metric *sss_metric_counter(const char *name_fmt, ...)
+{
+    struct sss_metric *metric;
+    va_list ap;
+
+    va_start(ap, name_fmt);
+    metric = sss_metric_vget(SSS_METRIC_COUNTER, name_fmt, ap);
+    va_end(ap);
+
+    return metric;
+}
+
+struct sss_metric *sss_metric_histogram(const char *name_fmt, ...)
+{
+    struct sss_metric *metric;
+    va_list ap;
+
+    va_start(ap, name_fmt);
+    metric = sss_metric_vget(SSS_METRIC_HISTOGRAM, name_fmt, ap);
+    va_end(ap);
+
+    return metric;
+}
+
+void sss_metric_add(struct sss_metric *metric, uint64_t value)
+{
+    if (metric == NULL || metric->type != SSS_METRIC_COUNTER) {
+        return;
+    }
+
+    metric->value += value;
+}
+
+static void sss_metric_merge(struct sss_metric *metric,
+                             int bucket,
+                             uint64_t count,
+                             uint64_t sum,
+                             uint64_t min,
+                             uint64_t max)
+{
+    if (metric->value == 0 || min < metric->min) {
+        metric->min = min;
+    }
+
+    if (max > metric->max) {
+        metric->max = max;
+    }
+
+    metric->value += count;
+    metric->sum += sum;
+    metric->buckets[bucket] += count;
+}
+
+void sss_metric_observe(struct sss_metric *metric, uint64_t value)
+{
+    if (metric == NULL || metric->type != SSS_METRIC_HISTOGRAM) {
+        return;
+    }
+
+    sss_metric_merge(metric, sss_metric_bucket(value), 1, value, value, value);
+}
+
+void sss_metric_observe_since(struct sss_metric *metric,
+                              const struct timeval *start)
+{
+    struct timeval now;
+
+    if (metric == NULL) {
+        return;
+    }
+
+    now = tevent_timeval_current();
+    if (tevent_timeval_compare(&now, start) <= 0) {
+        sss_metric_observe(metric, 0);
+        return;
+    }
+
+    sss_metric_observe(metric, (now.tv_sec - start->tv_sec) * 1000000
+                               + now.tv_usec - start->tv_usec);
+}
+
+void sss_metrics_inc(const char *name)
+{
+    sss_metric_add(sss_metric_counter("%s", name), 1);
+}
+
+uint64_t sss_metric_value(struct sss_metric *metric)
+{
+    return metric == NULL ? 0 : metric->value;
+}
+
+uint64_t sss_metric_percentile(struct sss_metric *metric, double percent)
+{
+    uint64_t target;
+    uint64_t seen = 0;
+    uint64_t high;
+    int i;
+
+    if (metric == NULL || metric->type != SSS_METRIC_HISTOGRAM
+            || metric->value == 0) {
+        return 0;
+    }
+
+    target = (uint64_t) (metric->value * percent / 100.0 + 0.5);
+    if (target == 0) {
+        target = 1;
+    }
+
+    for (i = 0; i < SSS_METRIC_BUCKETS; i++) {
+        seen += metric->buckets[i];
+        if (seen >= target) {
+            break;
+        }
+    }
+
+    high = sss_metric_bucket_high(i < SSS_METRIC_BUCKETS ? i
+                                                         : SSS_METRIC_BUCKETS - 1);
+    return high < metric->max ? high : metric->max;
+}
+
+static int sss_metric_cmp(const void *a, const void *b)
+{
+    const struct sss_metric *ma = *(struct sss_metric * const *) a;
+    const struct sss_metric *mb = *(struct sss_metric * const *) b;
+
+    if (ma->type != mb->type) {
+        return ma->type < mb->type ? -1 : 1;
+    }
+
+    return strcmp(ma->name, mb->name);
+}
+
+static void sss_metrics_sort(void)
+{
+    if (metrics == NULL || metrics->count == 0) {
+        return;
+    }
+
+    qsort(metrics->list, metrics->count, sizeof(struct sss_metric *),
+          sss_metric_cmp);
+}
+
+/* Snapshot format, one metric per line:
+ *   counter <name> <value>
+ *   histogram <name> <count> <sum> <min> <max> [<bucket>:<count> ...]
+ */
+static char *sss_metrics_snapshot(TALLOC_CTX *mem_ctx)
+{
+    struct sss_metric *metric;
+    char *snapshot;
+    size_t i;
+    int b;
+
+    snapshot = talloc_asprintf(mem_ctx, "# pid %d time %ld\n",
+                               getpid(), (long) time(NULL));
+
+    sss_metrics_sort();
+
+    for (i = 0; metrics != NULL && i < metrics->count; i++) {
+        if (snapshot == NULL) {
+            return NULL;
+        }
+
+        metric = metrics->list[i];
+        if (metric->type == SSS_METRIC_COUNTER) {
+            snapshot = talloc_asprintf_append(snapshot, "counter %s %"PRIu64
+                                              "\n", metric->name,
+                                              metric->value);
+            continue;
+        }
+
+        snapshot = talloc_asprintf_append(snapshot, "histogram %s %"PRIu64
+                                          " %"PRIu64" %"PRIu64" %"PRIu64,
+                                          metric->name, metric->value,
+                                          metric->sum, metric->min,
+                                          metric->max);
+        for (b = 0; b < SSS_METRIC_BUCKETS && snapshot != NULL; b++) {
+            if (metric->buckets[b] == 0) {
+                continue;
+            }
+
+            snapshot = talloc_asprintf_append(snapshot, " %d:%"PRIu64,
+                                              b, metric->buckets[b]);
+        }
+
+        if (snapshot != NULL) {
+            snapshot = talloc_strdup_append(snapshot, "\n");
+        }
+    }
+
+    return snapshot;
+}
+
+errno_t sss_metrics_write(const char *path)
+{
+    TALLOC_CTX *tmp_ctx;
+    char *snapshot;
+    char *tmp_path;
+    ssize_t written;
+    size_t len;
+    int fd = -1;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    snapshot = sss_metrics_snapshot(tmp_ctx);
+    tmp_path = talloc_asprintf(tmp_ctx, "%sXXXXXX", path);
+    if (snapshot == NULL || tmp_path == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    fd = sss_unique_file(tmp_ctx, tmp_path, &ret);
+    if (fd == -1) {
+        goto done;
+    }
+
+    len = strlen(snapshot);
+    errno = 0;
+    written = sss_atomic_write_s(fd, snapshot, len);
+    if (written == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    if (written != len) {
+        ret = EIO;
+        goto done;
+    }
+
+    ret = fchmod(fd, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+    if (ret == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    ret = rename(tmp_path, path);
+    if (ret == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to write metrics to %s [%d]: %s\n",
+              path, ret, sss_strerror(ret));
+    }
+
+    if (fd != -1) {
+        close(fd);
+    }
+
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t sss_metrics_read_histogram(const char *name, char *values)
+{
+    struct sss_metric *metric;
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t n;
+    char *bucket;
+    char *saveptr;
+    int b;
+
+    if (sscanf(values, "%"SCNu64" %"SCNu64" %"SCNu64" %"SCNu64,
+               &count, &sum, &min, &max) != 4) {
+        return EINVAL;
+    }
+
+    metric = sss_metric_histogram("%s", name);
+    if (metric == NULL) {
+        return EINVAL;
+    }
+
+    if (count == 0) {
+        return EOK;
+    }
+
+    /* Buckets are merged one by one, count the totals only once */
+    sss_metric_merge(metric, 0, 0, sum, min, max);
+
+    for (bucket = strtok_r(values, " ", &saveptr);
+         bucket != NULL;
+         bucket = strtok_r(NULL, " ", &saveptr)) {
+        if (sscanf(bucket, "%d:%"SCNu64, &b, &n) != 2) {
+            continue;
+        }
+
+        if (b < 0 || b >= SSS_METRIC_BUCKETS) {
+            return EINVAL;
+        }
+
+        metric->buckets[b] += n;
+        metric->value += n;
+    }
+
+    return EOK;
+}
+
+errno_t sss_metrics_read(const char *path)
+{
+    char name[SSS_METRIC_NAME_MAX];
+    char type[16];
+    char *line = NULL;
+    size_t linelen = 0;
+    uint64_t value;
+    int offset;
+    FILE *fp;
+    errno_t ret = EOK;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        ret = errno;
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to open %s [%d]: %s\n",
+              path, ret, sss_strerror(ret));
+        return ret;
+    }
+
+    while (getline(&line, &linelen, fp) != -1) {
+        if (line[0] == '#') {
+            continue;
+        }
+
+        if (sscanf(line, "%15s %255s %n", type, name, &offset) != 2) {
+            ret = EINVAL;
+            break;
+        }
+
+        if (strcmp(type, sss_metric_type_str[SSS_METRIC_COUNTER]) == 0) {
+            if (sscanf(line + offset, "%"SCNu64, &value) != 1) {
+                ret = EINVAL;
+                break;
+            }
+            sss_metric_add(sss_metric_counter("%s", name), value);
+        } else if (strcmp(type,
+                          sss_metric_type_str[SSS_METRIC_HISTOGRAM]) == 0) {
+            ret = sss_metrics_read_histogram(name, line + offset);
+            if (ret != EOK) {
+                break;
+            }
+        }
+    }
+
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Malformed metrics snapshot %s\n", path);
+    }
+
+    free(line);
+    fclose(fp);
+    return ret;
+}
+
+char *sss_metrics_report(TALLOC_CTX *mem_ctx)
+{
+    struct sss_metric *metric;
+    enum sss_metric_type type = SSS_METRIC_COUNTER;
+    char *report;
+    size_t i;
+
+    report = talloc_strdup(mem_ctx, "");
+
+    sss_metrics_sort();
+
+    for (i = 0; metrics != NULL && i < metrics->count; i++) {
+        if (report == NULL) {
+            return NULL;
+        }
+
+        metric = metrics->list[i];
+        if (i == 0 || metric->type != type) {
+            type = metric->type;
+            if (type == SSS_METRIC_COUNTER) {
+                report = talloc_asprintf_append(report, "%-56s %12s\n",
+                                                "Counters", "value");
+            } else {
+                report = talloc_asprintf_append(report,
+                             "%s%-56s %12s %10s %10s %10s %10s\n",
+                             i == 0 ? "" : "\n", "Histograms (usec)",
+                             "count", "p50", "p90", "p99", "max");
+            }
+            if (report == NULL) {
+                return NULL;
+            }
+        }
+
+        if (type == SSS_METRIC_COUNTER) {
+            report = talloc_asprintf_append(report, "%-56s %12"PRIu64"\n",
+                                            metric->name, metric->value);
+        } else {
+            report = talloc_asprintf_append(report,
+                         "%-56s %12"PRIu64" %10"PRIu64" %10"PRIu64
+                         " %10"PRIu64" %10"PRIu64"\n",
+                         metric->name, metric->value,
+                         sss_metric_percentile(metric, 50),
+                         sss_metric_percentile(metric, 90),
+                         sss_metric_percentile(metric, 99),
+                         metric->max);
+        }
+    }
+
+    return report;
+}
+
+struct sss_metrics_snapshot_ctx {
+    struct tevent_context *ev;
+    const char *path;
+    uint32_t interval;
+};
+
+static errno_t sss_metrics_snapshot_schedule(struct sss_metrics_snapshot_ctx *ctx);
+
+static void sss_metrics_snapshot_timer(struct tevent_context *ev,
+                                       struct tevent_timer *te,
+                                       struct timeval current_time,
+                                       void *pvt)
+{
+    struct sss_metrics_snapshot_ctx *ctx;
+    errno_t ret;
+
+    ctx = talloc_get_type(pvt, struct sss_metrics_snapshot_ctx);
+
+    /* Errors are logged, the next snapshot may succeed */
+    sss_metrics_write(ctx->path);
+
+    ret = sss_metrics_snapshot_schedule(ctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to schedule metrics snapshot, "
+              "metrics will not be written anymore\n");
+    }
+}
+
+static errno_t sss_metrics_snapshot_schedule(struct sss_metrics_snapshot_ctx *ctx)
+{
+    struct tevent_timer *te;
+
+    te = tevent_add_timer(ctx->ev, ctx,
+                          tevent_timeval_current_ofs(ctx->interval, 0),
+                          sss_metrics_snapshot_timer, ctx);
+    if (te == NULL) {
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+errno_t sss_metrics_snapshot_setup(TALLOC_CTX *mem_ctx,
+                                   struct tevent_context *ev,
+                                   const char *path,
+                                   uint32_t interval)
+{
+    struct sss_metrics_snapshot_ctx *ctx;
+    errno_t ret;
+
+    if (interval == 0) {
+        return EINVAL;
+    }
+
+    ctx = talloc_zero(mem_ctx, struct sss_metrics_snapshot_ctx);
+    if (ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ctx->ev = ev;
+    ctx->interval = interval;
+    ctx->path = talloc_strdup(ctx, path);
+    if (ctx->path == NULL) {
+        talloc_free(ctx);
+        return ENOMEM;
+    }
+
+    ret = sss_metrics_snapshot_schedule(ctx);
+    if (ret != EOK) {
+        talloc_free(ctx);
+        return ret;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Writing metrics to %s every %u seconds\n",
+          path, interval);
+
+    return EOK;
+}
@@ -0,0 +1,123 @@
+/*
+    SSSD
+
+    Runtime performance metrics
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SSS_METRICS_H_
+#define _SSS_METRICS_H_
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <talloc.h>
+#include <tevent.h>
+
+#include "util/util.h"
+
+/* Every process keeps its own set of metrics. A metric is identified by
+ * its name, e.g. "cache_req.hit" or "dp_req.id.account.latency", which
+ * must not contain white space. Metrics are never freed, so the pointers
+ * returned below can be kept for the lifetime of the process.
+ *
+ * Counters hold a single value. Histograms record values, usually
+ * latencies in microseconds, in logarithmic buckets with eight linear
+ * sub-buckets each, so percentiles are accurate to 12.5 %. */
+struct sss_metric;
+
+#define SSS_METRIC_NAME_MAX 256
+
+/* Snapshots are written by each process every this many seconds */
+#define SSS_METRICS_SNAPSHOT_INTERVAL_DEFAULT 60
+
+/* Suffix of the snapshot files in METRICS_PATH */
+#define SSS_METRICS_SNAPSHOT_SUFFIX ".metrics"
+
+/**
+ * Find or create a counter.
+ *
+ * @return The counter or NULL if it cannot be created or a histogram with
+ *         the same name exists. The update functions accept NULL.
+ */
+struct sss_metric *sss_metric_counter(const char *name_fmt, ...)
+    SSS_ATTRIBUTE_PRINTF(1, 2);
+
+/**
+ * Find or create a histogram.
+ */
+struct sss_metric *sss_metric_histogram(const char *name_fmt, ...)
+    SSS_ATTRIBUTE_PRINTF(1, 2);
+
+/**
+ * Add @value to a counter.
+ */
+void sss_metric_add(struct sss_metric *metric, uint64_t value);
+
+/**
+ * Record @value in a histogram.
+ */
+void sss_metric_observe(struct sss_metric *metric, uint64_t value);
+
+/**
+ * Record the microseconds elapsed since @start in a histogram.
+ */
+void sss_metric_observe_since(struct sss_metric *metric,
+                              const struct timeval *start);
+
+/**
+ * Increment the counter called @name.
+ */
+void sss_metrics_inc(const char *name);
+
+/**
+ * @return The value of a counter or the number of values recorded in a
+ *         histogram.
+ */
+uint64_t sss_metric_value(struct sss_metric *metric);
+
+/**
+ * @return The upper bound of the bucket that holds the @percent percentile
+ *         of a histogram, never more than the largest recorded value.
+ */
+uint64_t sss_metric_percentile(struct sss_metric *metric, double percent);
+
+/**
+ * Write all metrics of this process to @path. The file is replaced
+ * atomically.
+ */
+errno_t sss_metrics_write(const char *path);
+
+/**
+ * Merge a snapshot written by sss_metrics_write() into the metrics of
+ * this process. Counters are summed and histograms merged.
+ */
+errno_t sss_metrics_read(const char *path);
+
+/**
+ * Format all metrics of this process as a human readable table.
+ */
+char *sss_metrics_report(TALLOC_CTX *mem_ctx);
+
+/**
+ * Write a snapshot to @path every @interval seconds.
+ */
+errno_t sss_metrics_snapshot_setup(TALLOC_CTX *mem_ctx,
+                                   struct tevent_context *ev,
+                                   const char *path,
+                                   uint32_t interval);
+
+#endif /* _SSS_METRICS_H_ */
@@ -0,0 +1,178 @@
+/*
+    SSSD
+
+    Request latency tracing
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdarg.h>
+#include <tevent.h>
+
+#include "util/util.h"
+#include "util/probes.h"
+#include "util/sss_trace.h"
+
+struct sss_trace_stat {
+    unsigned int count;
+    uint64_t usec;
+};
+
+struct sss_trace {
+    const char *id;
+    struct timeval start;
+    struct sss_trace_stat stages[SSS_TRACE_STAGE_MAX];
+};
+
+static const char *sss_trace_stage_names[SSS_TRACE_STAGE_MAX] = {
+    [SSS_TRACE_CACHE] = "cache",
+    [SSS_TRACE_BACKEND] = "backend",
+    [SSS_TRACE_CONNECT] = "connect",
+    [SSS_TRACE_LDAP] = "ldap",
+};
+
+static uint64_t sss_trace_usec_since(const struct timeval *start)
+{
+    struct timeval now;
+
+    now = tevent_timeval_current();
+    if (tevent_timeval_compare(&now, start) <= 0) {
+        return 0;
+    }
+
+    return (now.tv_sec - start->tv_sec) * 1000000
+           + now.tv_usec - start->tv_usec;
+}
+
+struct sss_trace *sss_trace_new(TALLOC_CTX *mem_ctx, const char *id_fmt, ...)
+{
+    struct sss_trace *trace;
+    va_list ap;
+
+    trace = talloc_zero(mem_ctx, struct sss_trace);
+    if (trace == NULL) {
+        return NULL;
+    }
+
+    va_start(ap, id_fmt);
+    trace->id = talloc_vasprintf(trace, id_fmt, ap);
+    va_end(ap);
+    if (trace->id == NULL) {
+        talloc_free(trace);
+        return NULL;
+    }
+
+    trace->start = tevent_timeval_current();
+
+    return trace;
+}
+
+struct sss_trace *sss_trace_find(const void *ptr)
+{
+    if (ptr == NULL) {
+        return NULL;
+    }
+
+    return talloc_find_parent_bytype(ptr, struct sss_trace);
+}
+
+const char *sss_trace_id(struct sss_trace *trace)
+{
+    if (trace == NULL) {
+        return NULL;
+    }
+
+    return trace->id;
+}
+
+void sss_trace_add(struct sss_trace *trace,
+                   enum sss_trace_stage stage,
+                   const struct timeval *start)
+{
+    if (trace == NULL || stage >= SSS_TRACE_STAGE_MAX) {
+        return;
+    }
+
+    trace->stages[stage].count++;
+    trace->stages[stage].usec += sss_trace_usec_since(start);
+}
+
+char *sss_trace_record(TALLOC_CTX *mem_ctx,
+                       struct sss_trace *trace,
+                       const char *request,
+                       const char *object,
+                       errno_t ret)
+{
+    char *record;
+    int i;
+
+    record = talloc_asprintf(mem_ctx, SSS_TRACE_RECORD " id=%s total=%"PRIu64
+                             "us ret=%d", trace->id,
+                             sss_trace_usec_since(&trace->start), ret);
+
+    for (i = 0; i < SSS_TRACE_STAGE_MAX && record != NULL; i++) {
+        record = talloc_asprintf_append(record, " %s=%u/%"PRIu64"us",
+                                        sss_trace_stage_names[i],
+                                        trace->stages[i].count,
+                                        trace->stages[i].usec);
+    }
+
+    if (record == NULL) {
+        return NULL;
+    }
+
+    return talloc_asprintf_append(record, " request=[%s] object=[%s]",
+                                  request == NULL ? "-" : request,
+                                  object == NULL ? "-" : object);
+}
+
+void sss_trace_report(struct sss_trace *trace,
+                      const char *request,
+                      const char *object,
+                      errno_t ret)
+{
+    uint64_t total;
+    char *record;
+    int level;
+
+    if (trace == NULL) {
+        return;
+    }
+
+    total = sss_trace_usec_since(&trace->start);
+
+    PROBE(TRACE_REPORT, trace->id, PROBE_SAFE_STR(request),
+          PROBE_SAFE_STR(object), ret, total,
+          trace->stages[SSS_TRACE_CACHE].usec,
+          trace->stages[SSS_TRACE_BACKEND].usec,
+          trace->stages[SSS_TRACE_CONNECT].usec,
+          trace->stages[SSS_TRACE_LDAP].usec);
+
+    level = total >= SSS_TRACE_SLOW_USEC ? SSSDBG_IMPORTANT_INFO
+                                         : SSSDBG_TRACE_FUNC;
+    if (!DEBUG_IS_SET(level) && !DEBUG_BACKTRACE_IS_SET(level)) {
+        return;
+    }
+
+    record = sss_trace_record(NULL, trace, request, object, ret);
+    if (record == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to format trace record\n");
+        return;
+    }
+
+    DEBUG(level, "%s\n", record);
+    talloc_free(record);
+}
@@ -0,0 +1,109 @@
+/*
+    SSSD
+
+    Request latency tracing
+
+    Copyright (C) 2026 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _SSS_TRACE_H_
+#define _SSS_TRACE_H_
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <talloc.h>
+
+#include "util/util.h"
+
+/* A trace collects the time one request spent in each stage. It is a
+ * talloc context: everything allocated under it is part of the request,
+ * so the code deeper in the stack finds it with sss_trace_find() without
+ * having to pass it around explicitly. */
+struct sss_trace;
+
+enum sss_trace_stage {
+    SSS_TRACE_CACHE,    /* Responder: searching the sysdb cache */
+    SSS_TRACE_BACKEND,  /* Responder: waiting for the data provider */
+    SSS_TRACE_CONNECT,  /* Backend: connecting to the server */
+    SSS_TRACE_LDAP,     /* Backend: LDAP operations */
+
+    SSS_TRACE_STAGE_MAX
+};
+
+/* Requests slower than this are logged with SSSDBG_IMPORTANT_INFO */
+#define SSS_TRACE_SLOW_USEC 1000000
+
+/* Prefix of the record written by sss_trace_report() */
+#define SSS_TRACE_RECORD "[sss_trace]"
+
+/**
+ * Create new trace.
+ *
+ * @param mem_ctx  Memory context.
+ * @param id_fmt   Format of the trace identifier. The same identifier is
+ *                 used by all processes that take part in the request so
+ *                 their records can be matched. It must not contain spaces.
+ * @return New trace or NULL on failure.
+ */
+struct sss_trace *sss_trace_new(TALLOC_CTX *mem_ctx, const char *id_fmt, ...)
+    SSS_ATTRIBUTE_PRINTF(2, 3);
+
+/**
+ * Find the trace that @ptr belongs to.
+ *
+ * @return @ptr itself if it is a trace, its closest talloc ancestor that is
+ *         a trace or NULL if the memory is not part of a traced request.
+ */
+struct sss_trace *sss_trace_find(const void *ptr);
+
+/**
+ * @return Identifier of the trace or NULL if @trace is NULL.
+ */
+const char *sss_trace_id(struct sss_trace *trace);
+
+/**
+ * Account the time from @start until now to @stage. @trace may be NULL.
+ */
+void sss_trace_add(struct sss_trace *trace,
+                   enum sss_trace_stage stage,
+                   const struct timeval *start);
+
+/**
+ * Format the record of the trace.
+ *
+ * @param mem_ctx  Memory context.
+ * @param trace    The trace.
+ * @param request  Name of the request.
+ * @param object   Object the request was looking up, may be NULL.
+ * @param ret      Result of the request.
+ * @return The record or NULL on failure.
+ */
+char *sss_trace_record(TALLOC_CTX *mem_ctx,
+                       struct sss_trace *trace,
+                       const char *request,
+                       const char *object,
+                       errno_t ret);
+
+/**
+ * Write the record of a finished request into the debug log and fire the
+ * trace_report systemtap probe. @trace may be NULL.
+ */
+void sss_trace_report(struct sss_trace *trace,
+                      const char *request,
+                      const char *object,
+                      errno_t ret);
+
+#endif /* _SSS_TRACE_H_ */
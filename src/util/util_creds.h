@@ -70,8 +70,8 @@ struct cli_creds {
     SELINUX_CTX selinux_ctx;
 };
 
-#define cli_creds_get_uid(x) x->ucred.uid
-#define cli_creds_get_gid(x) x->ucred.gid
+#define cli_creds_get_uid(x) (x)->ucred.uid
+#define cli_creds_get_gid(x) (x)->ucred.gid
 
 #else /* not HAVE_UCRED */
 struct cli_creds {
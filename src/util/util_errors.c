@@ -136,6 +136,7 @@ struct err_string error_to_str[] = {
     { "Unknown property" }, /* ERR_SBUS_UNKNOWN_PROPERTY */
     { "Unknown bus owner" }, /* ERR_SBUS_UNKNOWN_OWNER */
     { "No reply was received" }, /* ERR_SBUS_NO_REPLY */
+    { "The server rejected the DirSync cookie" }, /* ERR_DIRSYNC_COOKIE_REJECTED */
 
     { "ERR_LAST" } /* ERR_LAST */
 };
@@ -157,6 +157,7 @@ enum sssd_errors {
     ERR_SBUS_UNKNOWN_PROPERTY,
     ERR_SBUS_UNKNOWN_OWNER,
     ERR_SBUS_NO_REPLY,
+    ERR_DIRSYNC_COOKIE_REJECTED,
 
     ERR_LAST            /* ALWAYS LAST */
 };
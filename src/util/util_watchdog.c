@@ -76,6 +76,7 @@ static void watchdog_handler(int sig)
         if (getpid() == getpgrp()) {
             kill(-getpgrp(), SIGTERM);
         } else {
+            debug_flush_on_signal();
             _exit(1);
         }
     }